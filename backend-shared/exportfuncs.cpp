@@ -3,6 +3,7 @@
 #include <QDir>
 #include <QtConcurrent>
 #include "core/membuffer.h"
+#include "core/parallel.h"
 #include "core/dive.h"
 #include "core/divesite.h"
 #include "core/gettextfromc.h"
@@ -23,6 +24,8 @@ void exportProfile(QString filename, bool selected_only)
 	struct dive *dive;
 	int i;
 	int count = 0;
+	std::vector<const struct dive *> dives;
+	std::vector<QString> filenames;
 	if (!filename.endsWith(".png", Qt::CaseInsensitive))
 		filename = filename.append(".png");
 	QFileInfo fi(filename);
@@ -30,12 +33,138 @@ void exportProfile(QString filename, bool selected_only)
 	for_each_dive (i, dive) {
 		if (selected_only && !dive->selected)
 			continue;
+		dives.push_back(dive);
 		if (count)
-			exportProfile(dive, fi.path() + QDir::separator() + fi.completeBaseName().append(QString("-%1.").arg(count)) + fi.suffix());
+			filenames.push_back(fi.path() + QDir::separator() + fi.completeBaseName().append(QString("-%1.").arg(count)) + fi.suffix());
 		else
-			exportProfile(dive, filename);
+			filenames.push_back(filename);
 		++count;
 	}
+	exportProfiles(dives, filenames);
+}
+
+// The fragment of one dive. The fragments are created in parallel, so static
+// buffers like the one of gasname() must not be used.
+static void exportTeXDive(struct membuffer *b, const struct dive *dive, const char *ssrf)
+{
+	const char *unit;
+	char gas[64];
+	struct tm tm;
+	utc_mkdate(dive->when, &tm);
+
+	dive_site *site = dive->dive_site;
+	QRegExp ct("countrytag: (\\w+)");
+	QString country;
+	if (site && ct.indexIn(site->notes) >= 0)
+		country = ct.cap(1);
+	else
+		country = "";
+
+	pressure_t delta_p = {.mbar = 0};
+
+	QString star = "*";
+	QString viz = star.repeated(dive->visibility);
+	QString rating = star.repeated(dive->rating);
+
+	int i;
+	int qty_cyl;
+	int qty_weight;
+	double total_weight;
+
+	put_format(b, "\n%% Time, Date, and location:\n");
+	put_format(b, "\\def\\%sdate{%04u-%02u-%02u}\n", ssrf,
+	      tm.tm_year, tm.tm_mon+1, tm.tm_mday);
+	put_format(b, "\\def\\%shour{%02u}\n", ssrf, tm.tm_hour);
+	put_format(b, "\\def\\%sminute{%02u}\n", ssrf, tm.tm_min);
+	put_format(b, "\\def\\%snumber{%d}\n", ssrf, dive->number);
+	put_format(b, "\\def\\%splace{%s}\n", ssrf, site ? site->name : "");
+	put_format(b, "\\def\\%sspot{}\n", ssrf);
+	put_format(b, "\\def\\%ssitename{%s}\n", ssrf, site ? site->name : "");
+	site ? put_format(b, "\\def\\%sgpslat{%f}\n", ssrf, site->location.lat.udeg / 1000000.0) : put_format(b, "\\def\\%sgpslat{}\n", ssrf);
+	site ? put_format(b, "\\def\\%sgpslon{%f}\n", ssrf, site->location.lon.udeg / 1000000.0) : put_format(b, "\\def\\gpslon{}\n");
+	put_format(b, "\\def\\%scomputer{%s}\n", ssrf, dive->dc.model);
+	put_format(b, "\\def\\%scountry{%s}\n", ssrf, qPrintable(country));
+	put_format(b, "\\def\\%stime{%u:%02u}\n", ssrf, FRACTION(dive->duration.seconds, 60));
+
+	put_format(b, "\n%% Dive Profile Details:\n");
+	dive->maxtemp.mkelvin ? put_format(b, "\\def\\%smaxtemp{%.1f\\%stemperatureunit}\n", ssrf, get_temp_units(dive->maxtemp.mkelvin, &unit), ssrf) : put_format(b, "\\def\\%smaxtemp{}\n", ssrf);
+	dive->mintemp.mkelvin ? put_format(b, "\\def\\%smintemp{%.1f\\%stemperatureunit}\n", ssrf, get_temp_units(dive->mintemp.mkelvin, &unit), ssrf) : put_format(b, "\\def\\%ssrfmintemp{}\n", ssrf);
+	dive->watertemp.mkelvin ? put_format(b, "\\def\\%swatertemp{%.1f\\%stemperatureunit}\n", ssrf, get_temp_units(dive->watertemp.mkelvin, &unit), ssrf) : put_format(b, "\\def\\%swatertemp{}\n", ssrf);
+	dive->airtemp.mkelvin ? put_format(b, "\\def\\%sairtemp{%.1f\\%stemperatureunit}\n", ssrf, get_temp_units(dive->airtemp.mkelvin, &unit), ssrf) : put_format(b, "\\def\\%sairtemp{}\n", ssrf);
+	dive->maxdepth.mm ? put_format(b, "\\def\\%smaximumdepth{%.1f\\%sdepthunit}\n", ssrf, get_depth_units(dive->maxdepth.mm, NULL, &unit), ssrf) : put_format(b, "\\def\\%smaximumdepth{}\n", ssrf);
+	dive->meandepth.mm ? put_format(b, "\\def\\%smeandepth{%.1f\\%sdepthunit}\n", ssrf, get_depth_units(dive->meandepth.mm, NULL, &unit), ssrf) : put_format(b, "\\def\\%smeandepth{}\n", ssrf);
+
+	struct tag_entry *tag = dive->tag_list;
+	QString tags;
+	if (tag) {
+		tags = tag->tag->name;
+		while ((tag = tag->next))
+			tags += QString(", ") + QString(tag->tag->name);
+	}
+	put_format(b, "\\def\\%stype{%s}\n", ssrf, qPrintable(tags));
+	put_format(b, "\\def\\%sviz{%s}\n", ssrf, qPrintable(viz));
+	put_format(b, "\\def\\%srating{%s}\n", ssrf, qPrintable(rating));
+	put_format(b, "\\def\\%splot{\\includegraphics[width=9cm,height=4cm]{profile%d}}\n", ssrf, dive->number);
+	put_format(b, "\\def\\%sprofilename{profile%d}\n", ssrf, dive->number);
+	put_format(b, "\\def\\%scomment{%s}\n", ssrf, dive->notes ? dive->notes : "");
+	put_format(b, "\\def\\%sbuddy{%s}\n", ssrf, dive->buddy ? dive->buddy : "");
+	put_format(b, "\\def\\%sdivemaster{%s}\n", ssrf, dive->divemaster ? dive->divemaster : "");
+	put_format(b, "\\def\\%ssuit{%s}\n", ssrf, dive->suit ? dive->suit : "");
+
+	// Print cylinder data
+	put_format(b, "\n%% Gas use information:\n");
+	qty_cyl = 0;
+	for (i = 0; i < dive->cylinders.nr; i++){
+		const cylinder_t &cyl = *get_cylinder(dive, i);
+		if (is_cylinder_used(dive, i) || (prefs.display_unused_tanks && cyl.type.description)){
+			put_format(b, "\\def\\%scyl%cdescription{%s}\n", ssrf, 'a' + i, cyl.type.description);
+			get_gas_string(cyl.gasmix, gas, sizeof(gas));
+			put_format(b, "\\def\\%scyl%cgasname{%s}\n", ssrf, 'a' + i, gas);
+			put_format(b, "\\def\\%scyl%cmixO2{%.1f\\%%}\n", ssrf, 'a' + i, get_o2(cyl.gasmix)/10.0);
+			put_format(b, "\\def\\%scyl%cmixHe{%.1f\\%%}\n", ssrf, 'a' + i, get_he(cyl.gasmix)/10.0);
+			put_format(b, "\\def\\%scyl%cmixN2{%.1f\\%%}\n", ssrf, 'a' + i, (100.0 - (get_o2(cyl.gasmix)/10.0) - (get_he(cyl.gasmix)/10.0)));
+			delta_p.mbar += cyl.start.mbar - cyl.end.mbar;
+			put_format(b, "\\def\\%scyl%cstartpress{%.1f\\%spressureunit}\n", ssrf, 'a' + i, get_pressure_units(cyl.start.mbar, &unit)/1.0, ssrf);
+			put_format(b, "\\def\\%scyl%cendpress{%.1f\\%spressureunit}\n", ssrf, 'a' + i, get_pressure_units(cyl.end.mbar, &unit)/1.0, ssrf);
+			qty_cyl += 1;
+		} else {
+			put_format(b, "\\def\\%scyl%cdescription{}\n", ssrf, 'a' + i);
+			put_format(b, "\\def\\%scyl%cgasname{}\n", ssrf, 'a' + i);
+			put_format(b, "\\def\\%scyl%cmixO2{}\n", ssrf, 'a' + i);
+			put_format(b, "\\def\\%scyl%cmixHe{}\n", ssrf, 'a' + i);
+			put_format(b, "\\def\\%scyl%cmixN2{}\n", ssrf, 'a' + i);
+			delta_p.mbar += cyl.start.mbar - cyl.end.mbar;
+			put_format(b, "\\def\\%scyl%cstartpress{}\n", ssrf, 'a' + i);
+			put_format(b, "\\def\\%scyl%cendpress{}\n", ssrf, 'a' + i);
+			qty_cyl += 1;
+		}
+	}
+	put_format(b, "\\def\\%sqtycyl{%d}\n", ssrf, qty_cyl);
+	put_format(b, "\\def\\%sgasuse{%.1f\\%spressureunit}\n", ssrf, get_pressure_units(delta_p.mbar, &unit)/1.0, ssrf);
+	put_format(b, "\\def\\%ssac{%.2f\\%svolumeunit/min}\n", ssrf, get_volume_units(dive->sac, NULL, &unit), ssrf);
+
+	//Code block prints all weights listed in dive.
+	put_format(b, "\n%% Weighting information:\n");
+	qty_weight = 0;
+	total_weight = 0;
+	for (i = 0; i < dive->weightsystems.nr; i++) {
+		weightsystem_t w = dive->weightsystems.weightsystems[i];
+		put_format(b, "\\def\\%sweight%ctype{%s}\n", ssrf, 'a' + i, w.description);
+		put_format(b, "\\def\\%sweight%camt{%.3f\\%sweightunit}\n", ssrf, 'a' + i, get_weight_units(w.weight.grams, NULL, &unit), ssrf);
+		qty_weight += 1;
+		total_weight += get_weight_units(w.weight.grams, NULL, &unit);
+	}
+	put_format(b, "\\def\\%sqtyweights{%d}\n", ssrf, qty_weight);
+	put_format(b, "\\def\\%stotalweight{%.2f\\%sweightunit}\n", ssrf, total_weight, ssrf);
+	unit = "";
+
+	// Legacy fields
+	put_format(b, "\\def\\%sspot{}\n", ssrf);
+	put_format(b, "\\def\\%sentrance{}\n", ssrf);
+	put_format(b, "\\def\\%splace{%s}\n", ssrf, site ? site->name : "");
+	dive->maxdepth.mm ? put_format(b, "\\def\\%sdepth{%.1f\\%sdepthunit}\n", ssrf, get_depth_units(dive->maxdepth.mm, NULL, &unit), ssrf) : put_format(b, "\\def\\%sdepth{}\n", ssrf);
+
+	put_format(b, "\\%spage\n", ssrf);
 }
 
 void export_TeX(const char *filename, bool selected_only, bool plain)
@@ -44,10 +173,10 @@ void export_TeX(const char *filename, bool selected_only, bool plain)
 	QDir texdir = QFileInfo(filename).dir();
 	struct dive *dive;
 	const struct units *units = get_units();
-	const char *unit;
 	const char *ssrf;
 	int i;
-	bool need_pagebreak = false;
+	std::vector<const struct dive *> profileDives;
+	std::vector<QString> profileFiles;
 
 	struct membuffer buf = {};
 
@@ -94,132 +223,23 @@ void export_TeX(const char *filename, bool selected_only, bool plain)
 	for_each_dive (i, dive) {
 		if (selected_only && !dive->selected)
 			continue;
+		profileDives.push_back(dive);
+		profileFiles.push_back(texdir.filePath(QString("profile%1.png").arg(dive->number)));
+	}
 
-		exportProfile(dive, texdir.filePath(QString("profile%1.png").arg(dive->number)));
-		struct tm tm;
-		utc_mkdate(dive->when, &tm);
-
-		dive_site *site = dive->dive_site;
-		QRegExp ct("countrytag: (\\w+)");
-		QString country;
-		if (site && ct.indexIn(site->notes) >= 0)
-			country = ct.cap(1);
-		else
-			country = "";
-
-		pressure_t delta_p = {.mbar = 0};
-
-		QString star = "*";
-		QString viz = star.repeated(dive->visibility);
-		QString rating = star.repeated(dive->rating);
-
-		int i;
-		int qty_cyl;
-		int qty_weight;
-		double total_weight;
-
-		if (need_pagebreak) {
+	std::vector<struct membuffer> fragments(profileDives.size(), membuffer());
+	parallel_for((int)profileDives.size(), [&fragments, &profileDives, ssrf](int i) {
+		exportTeXDive(&fragments[i], profileDives[i], ssrf);
+	});
+	for (struct membuffer &fragment: fragments) {
+		if (&fragment != &fragments[0]) {
 			if (plain)
 				put_format(&buf, "\\vfill\\eject\n");
-
 			else
 				put_format(&buf, "\\newpage\n");
 		}
-		need_pagebreak = true;
-		put_format(&buf, "\n%% Time, Date, and location:\n");
-		put_format(&buf, "\\def\\%sdate{%04u-%02u-%02u}\n", ssrf,
-		      tm.tm_year, tm.tm_mon+1, tm.tm_mday);
-		put_format(&buf, "\\def\\%shour{%02u}\n", ssrf, tm.tm_hour);
-		put_format(&buf, "\\def\\%sminute{%02u}\n", ssrf, tm.tm_min);
-		put_format(&buf, "\\def\\%snumber{%d}\n", ssrf, dive->number);
-		put_format(&buf, "\\def\\%splace{%s}\n", ssrf, site ? site->name : "");
-		put_format(&buf, "\\def\\%sspot{}\n", ssrf);
-		put_format(&buf, "\\def\\%ssitename{%s}\n", ssrf, site ? site->name : "");
-		site ? put_format(&buf, "\\def\\%sgpslat{%f}\n", ssrf, site->location.lat.udeg / 1000000.0) : put_format(&buf, "\\def\\%sgpslat{}\n", ssrf);
-		site ? put_format(&buf, "\\def\\%sgpslon{%f}\n", ssrf, site->location.lon.udeg / 1000000.0) : put_format(&buf, "\\def\\gpslon{}\n");
-		put_format(&buf, "\\def\\%scomputer{%s}\n", ssrf, dive->dc.model);
-		put_format(&buf, "\\def\\%scountry{%s}\n", ssrf, qPrintable(country));
-		put_format(&buf, "\\def\\%stime{%u:%02u}\n", ssrf, FRACTION(dive->duration.seconds, 60));
-
-		put_format(&buf, "\n%% Dive Profile Details:\n");
-		dive->maxtemp.mkelvin ? put_format(&buf, "\\def\\%smaxtemp{%.1f\\%stemperatureunit}\n", ssrf, get_temp_units(dive->maxtemp.mkelvin, &unit), ssrf) : put_format(&buf, "\\def\\%smaxtemp{}\n", ssrf);
-		dive->mintemp.mkelvin ? put_format(&buf, "\\def\\%smintemp{%.1f\\%stemperatureunit}\n", ssrf, get_temp_units(dive->mintemp.mkelvin, &unit), ssrf) : put_format(&buf, "\\def\\%ssrfmintemp{}\n", ssrf);
-		dive->watertemp.mkelvin ? put_format(&buf, "\\def\\%swatertemp{%.1f\\%stemperatureunit}\n", ssrf, get_temp_units(dive->watertemp.mkelvin, &unit), ssrf) : put_format(&buf, "\\def\\%swatertemp{}\n", ssrf);
-		dive->airtemp.mkelvin ? put_format(&buf, "\\def\\%sairtemp{%.1f\\%stemperatureunit}\n", ssrf, get_temp_units(dive->airtemp.mkelvin, &unit), ssrf) : put_format(&buf, "\\def\\%sairtemp{}\n", ssrf);
-		dive->maxdepth.mm ? put_format(&buf, "\\def\\%smaximumdepth{%.1f\\%sdepthunit}\n", ssrf, get_depth_units(dive->maxdepth.mm, NULL, &unit), ssrf) : put_format(&buf, "\\def\\%smaximumdepth{}\n", ssrf);
-		dive->meandepth.mm ? put_format(&buf, "\\def\\%smeandepth{%.1f\\%sdepthunit}\n", ssrf, get_depth_units(dive->meandepth.mm, NULL, &unit), ssrf) : put_format(&buf, "\\def\\%smeandepth{}\n", ssrf);
-
-		struct tag_entry *tag = dive->tag_list;
-		QString tags;
-		if (tag) {
-			tags = tag->tag->name;
-			while ((tag = tag->next))
-				tags += QString(", ") + QString(tag->tag->name);
-		}
-		put_format(&buf, "\\def\\%stype{%s}\n", ssrf, qPrintable(tags));
-		put_format(&buf, "\\def\\%sviz{%s}\n", ssrf, qPrintable(viz));
-		put_format(&buf, "\\def\\%srating{%s}\n", ssrf, qPrintable(rating));
-		put_format(&buf, "\\def\\%splot{\\includegraphics[width=9cm,height=4cm]{profile%d}}\n", ssrf, dive->number);
-		put_format(&buf, "\\def\\%sprofilename{profile%d}\n", ssrf, dive->number);
-		put_format(&buf, "\\def\\%scomment{%s}\n", ssrf, dive->notes ? dive->notes : "");
-		put_format(&buf, "\\def\\%sbuddy{%s}\n", ssrf, dive->buddy ? dive->buddy : "");
-		put_format(&buf, "\\def\\%sdivemaster{%s}\n", ssrf, dive->divemaster ? dive->divemaster : "");
-		put_format(&buf, "\\def\\%ssuit{%s}\n", ssrf, dive->suit ? dive->suit : "");
-
-		// Print cylinder data
-		put_format(&buf, "\n%% Gas use information:\n");
-		qty_cyl = 0;
-		for (i = 0; i < dive->cylinders.nr; i++){
-			const cylinder_t &cyl = *get_cylinder(dive, i);
-			if (is_cylinder_used(dive, i) || (prefs.display_unused_tanks && cyl.type.description)){
-				put_format(&buf, "\\def\\%scyl%cdescription{%s}\n", ssrf, 'a' + i, cyl.type.description);
-				put_format(&buf, "\\def\\%scyl%cgasname{%s}\n", ssrf, 'a' + i, gasname(cyl.gasmix));
-				put_format(&buf, "\\def\\%scyl%cmixO2{%.1f\\%%}\n", ssrf, 'a' + i, get_o2(cyl.gasmix)/10.0);
-				put_format(&buf, "\\def\\%scyl%cmixHe{%.1f\\%%}\n", ssrf, 'a' + i, get_he(cyl.gasmix)/10.0);
-				put_format(&buf, "\\def\\%scyl%cmixN2{%.1f\\%%}\n", ssrf, 'a' + i, (100.0 - (get_o2(cyl.gasmix)/10.0) - (get_he(cyl.gasmix)/10.0)));
-				delta_p.mbar += cyl.start.mbar - cyl.end.mbar;
-				put_format(&buf, "\\def\\%scyl%cstartpress{%.1f\\%spressureunit}\n", ssrf, 'a' + i, get_pressure_units(cyl.start.mbar, &unit)/1.0, ssrf);
-				put_format(&buf, "\\def\\%scyl%cendpress{%.1f\\%spressureunit}\n", ssrf, 'a' + i, get_pressure_units(cyl.end.mbar, &unit)/1.0, ssrf);
-				qty_cyl += 1;
-			} else {
-				put_format(&buf, "\\def\\%scyl%cdescription{}\n", ssrf, 'a' + i);
-				put_format(&buf, "\\def\\%scyl%cgasname{}\n", ssrf, 'a' + i);
-				put_format(&buf, "\\def\\%scyl%cmixO2{}\n", ssrf, 'a' + i);
-				put_format(&buf, "\\def\\%scyl%cmixHe{}\n", ssrf, 'a' + i);
-				put_format(&buf, "\\def\\%scyl%cmixN2{}\n", ssrf, 'a' + i);
-				delta_p.mbar += cyl.start.mbar - cyl.end.mbar;
-				put_format(&buf, "\\def\\%scyl%cstartpress{}\n", ssrf, 'a' + i);
-				put_format(&buf, "\\def\\%scyl%cendpress{}\n", ssrf, 'a' + i);
-				qty_cyl += 1;
-			}
-		}
-		put_format(&buf, "\\def\\%sqtycyl{%d}\n", ssrf, qty_cyl);
-		put_format(&buf, "\\def\\%sgasuse{%.1f\\%spressureunit}\n", ssrf, get_pressure_units(delta_p.mbar, &unit)/1.0, ssrf);
-		put_format(&buf, "\\def\\%ssac{%.2f\\%svolumeunit/min}\n", ssrf, get_volume_units(dive->sac, NULL, &unit), ssrf);
-
-		//Code block prints all weights listed in dive.
-		put_format(&buf, "\n%% Weighting information:\n");
-		qty_weight = 0;
-		total_weight = 0;
-		for (i = 0; i < dive->weightsystems.nr; i++) {
-			weightsystem_t w = dive->weightsystems.weightsystems[i];
-			put_format(&buf, "\\def\\%sweight%ctype{%s}\n", ssrf, 'a' + i, w.description);
-			put_format(&buf, "\\def\\%sweight%camt{%.3f\\%sweightunit}\n", ssrf, 'a' + i, get_weight_units(w.weight.grams, NULL, &unit), ssrf);
-			qty_weight += 1;
-			total_weight += get_weight_units(w.weight.grams, NULL, &unit);
-		}
-		put_format(&buf, "\\def\\%sqtyweights{%d}\n", ssrf, qty_weight);
-		put_format(&buf, "\\def\\%stotalweight{%.2f\\%sweightunit}\n", ssrf, total_weight, ssrf);
-		unit = "";
-
-		// Legacy fields
-		put_format(&buf, "\\def\\%sspot{}\n", ssrf);
-		put_format(&buf, "\\def\\%sentrance{}\n", ssrf);
-		put_format(&buf, "\\def\\%splace{%s}\n", ssrf, site ? site->name : "");
-		dive->maxdepth.mm ? put_format(&buf, "\\def\\%sdepth{%.1f\\%sdepthunit}\n", ssrf, get_depth_units(dive->maxdepth.mm, NULL, &unit), ssrf) : put_format(&buf, "\\def\\%sdepth{}\n", ssrf);
-
-		put_format(&buf, "\\%spage\n", ssrf);
-
+		put_bytes(&buf, fragment.buffer, fragment.len);
+		free_buffer(&fragment);
 	}
 
 	if (plain)
@@ -227,6 +247,8 @@ void export_TeX(const char *filename, bool selected_only, bool plain)
 	else
 		put_format(&buf, "\\end{document}\n");
 
+	exportProfiles(profileDives, profileFiles);
+
 	f = subsurface_fopen(filename, "w+");
 	if (!f) {
 		report_error(qPrintable(gettextFromC::tr("Can't open file %s")), filename);
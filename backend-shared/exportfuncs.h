@@ -4,6 +4,7 @@
 
 #include <QString>
 #include <QFuture>
+#include <vector>
 
 struct dive_site;
 
@@ -17,12 +18,13 @@ QFuture<int> exportUsingStyleSheet(QString filename, bool doExport, int units, Q
 // prepareDivesForUploadDiveShare
 
 // WARNING
-// exportProfile uses the UI and are therefore different between
+// exportProfiles uses the UI and are therefore different between
 // Desktop (UI) and Mobile (QML)
 // In order to solve this difference, the actual implementations
 // are done in
 // desktop-widgets/divelogexportdialog.cpp and
 // mobile-widgets/qmlmanager.cpp
-void exportProfile(const struct dive *dive, const QString filename);
+// The profile of dives[i] is saved as filenames[i].
+void exportProfiles(const std::vector<const struct dive *> &dives, const std::vector<QString> &filenames);
 
 #endif // EXPORT_FUNCS_H
@@ -126,7 +126,7 @@ void PlannerShared::set_o2narcotic(bool value)
 {
 	qPrefDivePlanner::set_o2narcotic(value);
 	DivePlannerPointsModel::instance()->emitDataChanged();
-	DivePlannerPointsModel::instance()->cylindersModel()->emitDataChanged();
+	DivePlannerPointsModel::instance()->cylindersModel()->updateMods();
 }
 
 double PlannerShared::bottompo2()
@@ -137,6 +137,7 @@ void PlannerShared::set_bottompo2(double value)
 {
 	qPrefDivePlanner::set_bottompo2((int) (value * 1000.0));
 	DivePlannerPointsModel::instance()->cylindersModel()->updateBestMixes();
+	DivePlannerPointsModel::instance()->cylindersModel()->updateMods();
 }
 
 double PlannerShared::decopo2()
@@ -160,4 +161,5 @@ void PlannerShared::set_bestmixend(int value)
 {
 	qPrefDivePlanner::set_bestmixend(units_to_depth(value).mm);
 	DivePlannerPointsModel::instance()->cylindersModel()->updateBestMixes();
+	DivePlannerPointsModel::instance()->cylindersModel()->updateMods();
 }
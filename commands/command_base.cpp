@@ -9,12 +9,19 @@ namespace Command {
 
 static QUndoStack undoStack;
 
+// Commands that delete, merge or split dives own full copies of these dives.
+// Without a limit, the undo stack grows for the whole session. The oldest
+// commands of the stack are freed once this many commands were executed.
+static const int undoLimit = 200;
+
 // forward declaration
 QString changesMade();
 
 // General commands
 void init()
 {
+	// Note: the limit can only be set while the stack is empty.
+	undoStack.setUndoLimit(undoLimit);
 	QObject::connect(&undoStack, &QUndoStack::cleanChanged, &updateWindowTitle);
 	changesCallback = &changesMade;
 }
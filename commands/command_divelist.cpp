@@ -10,6 +10,7 @@
 #include "core/divefilter.h"
 
 #include <array>
+#include <unordered_set>
 
 namespace Command {
 
@@ -21,41 +22,6 @@ static void remove_trip_from_backend(dive_trip *trip)
 	remove_trip(trip, &trip_table);	// Remove trip from backend
 }
 
-// This helper function removes a dive, takes ownership of the dive and adds it to a DiveToAdd structure.
-// If the trip the dive belongs to becomes empty, it is removed and added to the tripsToAdd vector.
-// It is crucial that dives are added in reverse order of deletion, so that the indices are correctly
-// set and that the trips are added before they are used!
-DiveToAdd DiveListBase::removeDive(struct dive *d, std::vector<OwningTripPtr> &tripsToAdd)
-{
-	// If the dive was the current dive, reset the current dive. The calling
-	// command is responsible of finding a new dive.
-	if (d == current_dive)
-		current_dive = nullptr;
-
-	// remove dive from trip and site - if this is the last dive in the trip
-	// remove the whole trip.
-	DiveToAdd res;
-	res.trip = unregister_dive_from_trip(d);
-	if (d->dive_site)
-		diveSiteCountChanged(d->dive_site);
-	res.site = unregister_dive_from_dive_site(d);
-	if (res.trip && res.trip->dives.nr == 0) {
-		remove_trip_from_backend(res.trip);	// Remove trip from backend
-		tripsToAdd.emplace_back(res.trip);	// Take ownership of trip
-	}
-
-	int idx = get_divenr(d);
-	if (idx < 0)
-		qWarning("Deletion of unknown dive!");
-
-	if (!d->hidden_by_filter)
-		--shown_dives;
-
-	res.dive.reset(unregister_dive(idx));		// Remove dive from backend
-
-	return res;
-}
-
 void DiveListBase::diveSiteCountChanged(struct dive_site *ds)
 {
 	if (std::find(sitesCountChanged.begin(), sitesCountChanged.end(), ds) == sitesCountChanged.end())
@@ -63,7 +29,8 @@ void DiveListBase::diveSiteCountChanged(struct dive_site *ds)
 }
 
 // This helper function adds a dive and returns ownership to the backend. It may also add a dive trip.
-// It is crucial that dives are added in reverse order of deletion (see comment above)!
+// It is crucial that dives are added in reverse order of deletion, so that the indices are correctly
+// set and that the trips are added before they are used!
 // Returns pointer to added dive (which is owned by the backend!)
 dive *DiveListBase::addDive(DiveToAdd &d)
 {
@@ -118,10 +85,11 @@ void processByTrip(std::vector<std::pair<dive_trip *, dive *>> &dives, Function
 	}
 }
 
-// This helper function calls removeDive() on a list of dives to be removed and
-// returns a vector of corresponding DiveToAdd objects, which can later be readded.
-// Moreover, a vector of deleted trips is returned, if trips became empty.
-// The passed in vector is cleared.
+// This helper function removes a list of dives and takes ownership of them. It returns a
+// vector of corresponding DiveToAdd objects, which can later be readded. Moreover, a vector
+// of deleted trips is returned, if trips became empty. The passed in vector is cleared.
+// The dives are removed from the dive table, their trips and dive sites in one go, so that
+// deleting many dives doesn't shift the tables once per dive.
 DivesAndTripsToAdd DiveListBase::removeDives(DivesAndSitesToRemove &divesAndSitesToDelete)
 {
 	std::vector<DiveToAdd> divesToAdd;
@@ -138,10 +106,35 @@ DivesAndTripsToAdd DiveListBase::removeDives(DivesAndSitesToRemove &divesAndSite
 	// in the core list.
 	std::sort(divesAndSitesToDelete.dives.begin(), divesAndSitesToDelete.dives.end(), dive_less_than);
 
-	for (dive *d: divesAndSitesToDelete.dives)
-		divesToAdd.push_back(removeDive(d, tripsToAdd));
+	for (dive *d: divesAndSitesToDelete.dives) {
+		// If the dive was the current dive, reset the current dive. The calling
+		// command is responsible of finding a new dive.
+		if (d == current_dive)
+			current_dive = nullptr;
+		if (d->dive_site)
+			diveSiteCountChanged(d->dive_site);
+		if (!d->hidden_by_filter)
+			--shown_dives;
+		DiveToAdd res;
+		res.trip = d->divetrip;
+		res.site = d->dive_site;
+		res.dive.reset(d);
+		divesToAdd.push_back(std::move(res));
+	}
+	unregister_dives(divesAndSitesToDelete.dives.data(), (int)divesAndSitesToDelete.dives.size());
 	divesAndSitesToDelete.dives.clear();
 
+	// If this was the last dive in the trip, remove the whole trip.
+	for (const DiveToAdd &entry: divesToAdd) {
+		dive_trip *trip = entry.trip;
+		if (trip && trip->dives.nr == 0 &&
+		    std::find_if(tripsToAdd.begin(), tripsToAdd.end(), [trip](const OwningTripPtr &ptr)
+				 { return ptr.get() == trip; }) == tripsToAdd.end()) {
+			remove_trip_from_backend(trip);		// Remove trip from backend
+			tripsToAdd.emplace_back(trip);		// Take ownership of trip
+		}
+	}
+
 	for (dive_site *ds: divesAndSitesToDelete.sites) {
 		int idx = unregister_dive_site(ds);
 		sitesToAdd.emplace_back(ds);
@@ -249,6 +242,9 @@ static void renumberDives(QVector<QPair<dive *, int>> &divesToRenumber)
 		if (!d)
 			continue;
 		std::swap(d->number, pair.second);
+		// Renumbering all dives typically changes only a few of them
+		if (d->number == pair.second)
+			continue;
 		dives.push_back(d);
 		invalidate_dive_cache(d);
 	}
@@ -643,20 +639,43 @@ ShiftTime::ShiftTime(std::vector<dive *> changedDives, int amount)
 	setText(QStringLiteral("%1 [%2]").arg(Command::Base::tr("shift time of %n dives", "", changedDives.size())).arg(getListOfDives(changedDives)));
 }
 
+// The dives that were shifted by the same amount are still sorted among themselves,
+// as are the other dives. Therefore, merge them instead of sorting the whole table.
+// Only if dives at the same time were sorted by the dates of their trips, which may
+// have changed, can the result be out of order. Then sort the table.
+static void mergeShiftedDives(dive_table &table, const std::unordered_set<const dive *> &shifted)
+{
+	std::vector<dive *> kept, moved;
+	kept.reserve(table.nr);
+	for (int i = 0; i < table.nr; ++i)
+		(shifted.count(table.dives[i]) ? moved : kept).push_back(table.dives[i]);
+	if (moved.empty())
+		return;
+	std::merge(kept.begin(), kept.end(), moved.begin(), moved.end(), table.dives, dive_less_than);
+	if (!std::is_sorted(table.dives, table.dives + table.nr, dive_less_than))
+		sort_dive_table(&table);
+}
+
 void ShiftTime::redoit()
 {
 	std::vector<dive_trip *> trips;
+	std::unordered_set<const dive *> shifted;
+	shifted.reserve(diveList.size());
 	for (dive *d: diveList) {
 		d->when += timeChanged;
-		if (d->divetrip && std::find(trips.begin(), trips.end(), d->divetrip) == trips.end())
+		shifted.insert(d);
+		if (d->divetrip)
 			trips.push_back(d->divetrip);
 	}
+	std::sort(trips.begin(), trips.end());
+	trips.erase(std::unique(trips.begin(), trips.end()), trips.end());
 
-	// Changing times may have unsorted the dive and trip tables
-	sort_dive_table(&dive_table);
-	sort_trip_table(&trip_table);
+	// Changing times may have unsorted the dive and trip tables. The trips come
+	// first, because dives at the same time are sorted by the dates of their trips.
 	for (dive_trip *trip: trips)
-		sort_dive_table(&trip->dives); // Keep the trip-table in order
+		mergeShiftedDives(trip->dives, shifted); // Keep the trip-table in order
+	mergeShiftedDives(dive_table, shifted);
+	sort_trip_table(&trip_table);
 
 	// Send signals
 	QVector<dive *> dives = stdToQt<dive *>(diveList);
@@ -199,6 +199,7 @@ bool EditDiveSiteName::workToBeDone()
 void EditDiveSiteName::redo()
 {
 	swap(ds->name, value);
+	invalidate_dive_site_table_cache(&dive_site_table); // Ensure that dive sites are written in git_save()
 	emit diveListNotifier.diveSiteChanged(ds, LocationInformationModel::NAME); // Inform frontend of changed dive site.
 }
 
@@ -222,6 +223,7 @@ bool EditDiveSiteDescription::workToBeDone()
 void EditDiveSiteDescription::redo()
 {
 	swap(ds->description, value);
+	invalidate_dive_site_table_cache(&dive_site_table); // Ensure that dive sites are written in git_save()
 	emit diveListNotifier.diveSiteChanged(ds, LocationInformationModel::DESCRIPTION); // Inform frontend of changed dive site.
 }
 
@@ -245,6 +247,7 @@ bool EditDiveSiteNotes::workToBeDone()
 void EditDiveSiteNotes::redo()
 {
 	swap(ds->notes, value);
+	invalidate_dive_site_table_cache(&dive_site_table); // Ensure that dive sites are written in git_save()
 	emit diveListNotifier.diveSiteChanged(ds, LocationInformationModel::NOTES); // Inform frontend of changed dive site.
 }
 
@@ -270,6 +273,7 @@ void EditDiveSiteCountry::redo()
 	QString old = taxonomy_get_country(&ds->taxonomy);
 	taxonomy_set_country(&ds->taxonomy, qPrintable(value), taxonomy_origin::GEOMANUAL);
 	value = old;
+	invalidate_dive_site_table_cache(&dive_site_table); // Ensure that dive sites are written in git_save()
 	emit diveListNotifier.diveSiteChanged(ds, LocationInformationModel::TAXONOMY); // Inform frontend of changed dive site.
 }
 
@@ -297,6 +301,7 @@ bool EditDiveSiteLocation::workToBeDone()
 void EditDiveSiteLocation::redo()
 {
 	std::swap(value, ds->location);
+	invalidate_dive_site_table_cache(&dive_site_table); // Ensure that dive sites are written in git_save()
 	emit diveListNotifier.diveSiteChanged(ds, LocationInformationModel::LOCATION); // Inform frontend of changed dive site.
 }
 
@@ -328,6 +333,7 @@ bool EditDiveSiteTaxonomy::workToBeDone()
 void EditDiveSiteTaxonomy::redo()
 {
 	std::swap(value, ds->taxonomy);
+	invalidate_dive_site_table_cache(&dive_site_table); // Ensure that dive sites are written in git_save()
 	emit diveListNotifier.diveSiteChanged(ds, LocationInformationModel::TAXONOMY); // Inform frontend of changed dive site.
 }
 
@@ -406,6 +412,7 @@ ApplyGPSFixes::ApplyGPSFixes(const std::vector<DiveAndLocation> &fixes)
 		} else {
 			ds = create_dive_site(qPrintable(dl.name), &dive_site_table);
 			ds->location = dl.location;
+			invalidate_dive_site_gps_index();
 			add_dive_to_dive_site(dl.d, ds);
 			dl.d->dive_site = nullptr; // This will be set on redo()
 			sitesToAdd.emplace_back(ds);
@@ -422,6 +429,7 @@ void ApplyGPSFixes::editDiveSites()
 {
 	for (SiteAndLocation &sl: siteLocations) {
 		std::swap(sl.location, sl.ds->location);
+		invalidate_dive_site_table_cache(&dive_site_table); // Ensure that dive sites are written in git_save()
 		emit diveListNotifier.diveSiteChanged(sl.ds, LocationInformationModel::LOCATION); // Inform frontend of changed dive site.
 	}
 }
@@ -383,6 +383,7 @@ static struct dive_site *createDiveSite(const QString &name)
 		location_t loc = dive_get_gps_location(current_dive);
 		if (has_location(&loc))
 			ds->location = loc;
+			invalidate_dive_site_gps_index();
 	}
 
 	ds->name = copy_qstring(name);
@@ -1399,6 +1400,7 @@ void EditDive::editDs()
 {
 	if (siteToEdit) {
 		std::swap(siteToEdit->location, dsLocation);
+		invalidate_dive_site_table_cache(&dive_site_table); // Ensure that dive sites are written in git_save()
 		emit diveListNotifier.diveSiteChanged(siteToEdit, LocationInformationModel::LOCATION); // Inform frontend of changed dive site.
 	}
 }
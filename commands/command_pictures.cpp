@@ -3,6 +3,7 @@
 #include "command_pictures.h"
 #include "core/subsurface-qt/divelistnotifier.h"
 #include "qt-models/divelocationmodel.h"
+#include <unordered_set>
 
 namespace Command {
 
@@ -100,16 +101,21 @@ static std::vector<PictureListForDeletion> addPictures(std::vector<PictureListFo
 		QVector<PictureObj> picsForSignal;
 		PictureListForDeletion toRemove;
 		toRemove.d = list.d;
+		// The pictures are added in one go, so that the table is sorted only once
+		std::unordered_set<std::string> filenames;
+		for (int i = 0; i < list.d->pictures.nr; ++i)
+			filenames.insert(list.d->pictures.pictures[i].filename ?: "");
+		std::vector<picture> corePics;
 		for (const PictureObj &pic: list.pics) {
-			int idx = get_picture_idx(&list.d->pictures, pic.filename.c_str()); // This should *not* already exist!
-			if (idx >= 0) {
+			if (!filenames.insert(pic.filename).second) { // This should *not* already exist!
 				fprintf(stderr, "addPictures(): picture disappeared!");
 				continue; // Huh? We made sure that this can't happen by filtering out existing pictures.
 			}
 			picsForSignal.push_back(pic);
-			add_picture(&list.d->pictures, pic.toCore());
+			corePics.push_back(pic.toCore());
 			toRemove.filenames.push_back(pic.filename);
 		}
+		add_pictures(&list.d->pictures, corePics.data(), (int)corePics.size());
 		if (!toRemove.filenames.empty())
 			res.push_back(toRemove);
 		invalidate_dive_cache(list.d);
@@ -206,6 +212,7 @@ void AddPictures::swapDiveSites()
 
 	for (DiveSiteEditEntry &entry: sitesToEdit) {
 		std::swap(entry.ds->location, entry.location);
+		invalidate_dive_site_table_cache(&dive_site_table); // Ensure that dive sites are written in git_save()
 		emit diveListNotifier.diveSiteChanged(entry.ds, LocationInformationModel::LOCATION); // Inform frontend of changed dive site.
 	}
 }
@@ -3,21 +3,27 @@
 #include "btdiscovery.h"
 #include "downloadfromdcthread.h"
 #include "core/libdivecomputer.h"
+#include "core/settings/qPrefDiveComputer.h"
 #include <QTimer>
 #include <QDebug>
 #include <QLoggingCategory>
 #include <QRegularExpression>
-#include <QElapsedTimer>
 #include <QCoreApplication>
+#include <QEventLoop>
+#include <QMutex>
 
 extern QMap<QString, dc_descriptor_t *> descriptorLookup;
 
 namespace {
+	// Written on the main thread, read by the download thread
+	QMutex btDeviceInfoMutex;
 	QHash<QString, QBluetoothDeviceInfo> btDeviceInfo;
+	// Results of resolveDeviceType(), only used on the main thread
+	QHash<QString, dc_descriptor_t *> deviceTypeCache;
 }
 BTDiscovery *BTDiscovery::m_instance = NULL;
 
-static dc_descriptor_t *getDeviceType(QString btName)
+static dc_descriptor_t *resolveDeviceType(const QString &btName)
 // central function to convert a BT name to a Subsurface known vendor/model pair
 {
 	QString vendor, product;
@@ -141,6 +147,19 @@ static dc_descriptor_t *getDeviceType(QString btName)
 	return nullptr;
 }
 
+// The same devices are seen over and over during a scan, don't match their names every time
+static dc_descriptor_t *getDeviceType(const QString &btName)
+{
+	auto it = deviceTypeCache.constFind(btName);
+	if (it != deviceTypeCache.cend())
+		return *it;
+	dc_descriptor_t *descriptor = resolveDeviceType(btName);
+	// Before the computer list is filled, nothing can be found
+	if (!descriptorLookup.isEmpty())
+		deviceTypeCache.insert(btName, descriptor);
+	return descriptor;
+}
+
 bool matchesKnownDiveComputerNames(QString btName)
 {
 	return getDeviceType(btName) != nullptr;
@@ -206,6 +225,8 @@ void BTDiscovery::BTDiscoveryReDiscover()
 			btDeviceDiscoveredMain(btPairedDevices[i], true);
 #else
 		qDebug() << "starting BT/BLE discovery";
+		btDCs.clear();
+		addRememberedDevices();
 		discoveryAgent->start();
 		for (int i = 0; i < btPairedDevices.length(); i++)
 			qDebug() << "Paired =" << btPairedDevices[i].name << btPairedDevices[i].address;
@@ -239,6 +260,37 @@ BTDiscovery *BTDiscovery::instance()
 }
 
 #if defined(BT_SUPPORT)
+// The dive computers that were downloaded from before can be selected right
+// away, without waiting for the scan to find them. Their vendor and product
+// are known, so their names don't have to be matched.
+void BTDiscovery::addRememberedDevices()
+{
+	const QString vendors[] = { qPrefDiveComputer::vendor(), qPrefDiveComputer::vendor1(), qPrefDiveComputer::vendor2(),
+				    qPrefDiveComputer::vendor3(), qPrefDiveComputer::vendor4() };
+	const QString products[] = { qPrefDiveComputer::product(), qPrefDiveComputer::product1(), qPrefDiveComputer::product2(),
+				     qPrefDiveComputer::product3(), qPrefDiveComputer::product4() };
+	const QString devices[] = { qPrefDiveComputer::device(), qPrefDiveComputer::device1(), qPrefDiveComputer::device2(),
+				    qPrefDiveComputer::device3(), qPrefDiveComputer::device4() };
+	const QString names[] = { qPrefDiveComputer::device_name(), qPrefDiveComputer::device_name1(), qPrefDiveComputer::device_name2(),
+				  qPrefDiveComputer::device_name3(), qPrefDiveComputer::device_name4() };
+	for (int i = 0; i < 5; i++) {
+		if (!isBluetoothAddress(devices[i]))
+			continue;
+		dc_descriptor_t *descriptor = descriptorLookup.value(vendors[i].toLower() + products[i].toLower());
+		if (!descriptor)
+			continue;
+		btVendorProduct btVP;
+		btVP.btpdi.address = extractBluetoothAddress(devices[i]);
+		btVP.btpdi.name = names[i];
+		btVP.dcDescriptor = descriptor;
+		btVP.vendorIdx = vendorList.indexOf(vendors[i]);
+		btVP.productIdx = productList[vendors[i]].indexOf(products[i]);
+		btDCs << btVP;
+		qDebug() << "Remembered device:" << products[i] << btVP.btpdi.address;
+		connectionListModel.addAddress(products[i] + " " + btVP.btpdi.address);
+	}
+}
+
 extern void addBtUuid(QBluetoothUuid uuid);
 extern QHash<QString, QStringList> productList;
 extern QStringList vendorList;
@@ -290,6 +342,12 @@ void BTDiscovery::btDeviceDiscovered(const QBluetoothDeviceInfo &device)
 #endif
 
 	btDeviceDiscoveredMain(this_d, false);
+
+	// Nothing else is needed once the dive computer that will be downloaded from is seen
+	if (extractBluetoothAddress(qPrefDiveComputer::device()) == this_d.address && getDeviceType(this_d.name)) {
+		qDebug() << "found the current dive computer" << this_d.name << "stopping discovery";
+		stopAgent();
+	}
 }
 
 void BTDiscovery::btDeviceDiscoveredMain(const btPairedDevice &device, bool fromPaired)
@@ -311,6 +369,13 @@ void BTDiscovery::btDeviceDiscoveredMain(const btPairedDevice &device, bool from
 		btVP.dcDescriptor = newDC;
 		btVP.vendorIdx = vendorList.indexOf(vendor);
 		btVP.productIdx = productList[vendor].indexOf(newDevice);
+		// Remembered devices and devices seen by an earlier scan are already known
+		for (int i = 0; i < btDCs.size(); ++i) {
+			if (btDCs[i].btpdi.address == device.address) {
+				btDCs.removeAt(i);
+				break;
+			}
+		}
 		btDCs << btVP;
 		connectionListModel.addAddress(newDevice + " " + device.address);
 		return;
@@ -419,7 +484,8 @@ void BTDiscovery::discoverAddress(QString address)
 	QString btAddress;
 	btAddress = extractBluetoothAddress(address);
 
-	if (!btDeviceInfo.keys().contains(address) && !discoveryAgent->isActive()) {
+	QMutexLocker locker(&btDeviceInfoMutex);
+	if (!btDeviceInfo.contains(address) && !discoveryAgent->isActive()) {
 		qDebug() << "restarting discovery agent";
 		discoveryAgent->start();
 	}
@@ -466,31 +532,48 @@ QString extractBluetoothNameAddress(const QString &address, QString &name)
 
 void saveBtDeviceInfo(const QString &devaddr, QBluetoothDeviceInfo deviceInfo)
 {
-	btDeviceInfo[devaddr] = deviceInfo;
+	{
+		QMutexLocker locker(&btDeviceInfoMutex);
+		btDeviceInfo[devaddr] = deviceInfo;
+	}
+	emit BTDiscovery::instance()->btDeviceInfoSaved(devaddr);
+}
+
+static bool findBtDeviceInfo(const QString &devaddr, QBluetoothDeviceInfo &info)
+{
+	QMutexLocker locker(&btDeviceInfoMutex);
+	auto it = btDeviceInfo.constFind(devaddr);
+	if (it == btDeviceInfo.cend())
+		return false;
+	info = *it;
+	return true;
 }
 
 QBluetoothDeviceInfo getBtDeviceInfo(const QString &devaddr)
 {
-	if (btDeviceInfo.contains(devaddr)) {
-		BTDiscovery::instance()->stopAgent();
-		return btDeviceInfo[devaddr];
-	}
-	if(!btDeviceInfo.keys().contains(devaddr)) {
+	QBluetoothDeviceInfo info;
+	if (!findBtDeviceInfo(devaddr, info)) {
 		qDebug() << "still looking scan is still running, we should just wait for a few moments";
 		// wait for a maximum of 30 more seconds
 		// yes, that seems crazy, but on my Mac I see this take more than 20 seconds
-		QElapsedTimer timer;
-		timer.start();
-		do {
-			if (btDeviceInfo.keys().contains(devaddr)) {
-				BTDiscovery::instance()->stopAgent();
-				return btDeviceInfo[devaddr];
-			}
-			QCoreApplication::processEvents(QEventLoop::AllEvents, 100);
-			QThread::msleep(100);
-		} while (timer.elapsed() < 30000);
+		// The loop lives in the calling thread, which usually is the download thread,
+		// therefore the signal of the discovery on the main thread is queued to it.
+		QEventLoop loop;
+		QTimer timeout;
+		timeout.setSingleShot(true);
+		QObject::connect(&timeout, &QTimer::timeout, &loop, &QEventLoop::quit);
+		QObject::connect(BTDiscovery::instance(), &BTDiscovery::btDeviceInfoSaved, &loop,
+				 [&loop, &devaddr](const QString &addr) { if (addr == devaddr) loop.quit(); });
+		timeout.start(30000);
+		// It might have been found before the connection was made
+		if (!findBtDeviceInfo(devaddr, info))
+			loop.exec();
+		if (!findBtDeviceInfo(devaddr, info)) {
+			qDebug() << "notify user that we can't find" << devaddr;
+			return QBluetoothDeviceInfo();
+		}
 	}
-	qDebug() << "notify user that we can't find" << devaddr;
-	return QBluetoothDeviceInfo();
+	BTDiscovery::instance()->stopAgent();
+	return info;
 }
 #endif // BT_SUPPORT
@@ -73,7 +73,10 @@ private:
 	QList<struct btPairedDevice> btPairedDevices;
 	QBluetoothDeviceDiscoveryAgent *discoveryAgent;
 
+	void addRememberedDevices();
+
 signals:
+	void btDeviceInfoSaved(const QString &devaddr);
 	void dcVendorChanged();
 	void dcProductChanged();
 	void dcBtChanged();
@@ -4,6 +4,11 @@
 #include <QNetworkAccessManager>
 #include <QNetworkReply>
 #include <QEventLoop>
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QMutex>
+#include <QPointer>
+#include <QThread>
 
 #include "pref.h"
 #include "qthelper.h"
@@ -22,6 +27,56 @@ CheckCloudConnection::CheckCloudConnection(QObject *parent) :
 #define TEAPOT "/make-latte?number-of-shots=3"
 #define HTTP_I_AM_A_TEAPOT 418
 #define MILK "Linus does not like non-fat milk"
+
+static const qint64 successValidMsecs = 5 * 60 * 1000;
+static const qint64 failureValidMsecs = 30 * 1000;
+
+static QMutex statusLock;
+static QElapsedTimer statusAge;		// Invalid if there was no check yet
+static bool statusReachable = false;
+static QString statusUrl;
+
+void rememberCloudConnection(bool reachable)
+{
+	QMutexLocker locker(&statusLock);
+	statusAge.start();
+	statusReachable = reachable;
+	statusUrl = prefs.cloud_base_url;
+}
+
+// 1 if reachable, 0 if unreachable and -1 if not checked recently
+static int recentCloudConnection()
+{
+	QMutexLocker locker(&statusLock);
+	if (!statusAge.isValid() || statusUrl != prefs.cloud_base_url ||
+	    statusAge.elapsed() > (statusReachable ? successValidMsecs : failureValidMsecs))
+		return -1;
+	return statusReachable ? 1 : 0;
+}
+
+bool cloudRecentlyUnreachable()
+{
+	return recentCloudConnection() == 0;
+}
+
+static bool isTeapot(QNetworkReply *reply)
+{
+	return reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt() == HTTP_I_AM_A_TEAPOT &&
+	       reply->readAll() == QByteArray(MILK);
+}
+
+QNetworkReply *CheckCloudConnection::sendRequest(QNetworkAccessManager *mgr)
+{
+	QNetworkRequest request;
+	request.setRawHeader("Accept", "text/plain");
+	request.setRawHeader("User-Agent", getUserAgent().toUtf8());
+	request.setRawHeader("Client-Id", getUUID().toUtf8());
+	request.setUrl(QString(prefs.cloud_base_url) + TEAPOT);
+	QNetworkReply *res = mgr->get(request);
+	connect(res, &QNetworkReply::sslErrors, this, &CheckCloudConnection::sslErrors);
+	return res;
+}
+
 bool CheckCloudConnection::checkServer()
 {
 	if (verbose)
@@ -30,26 +85,20 @@ bool CheckCloudConnection::checkServer()
 	QTimer timer;
 	timer.setSingleShot(true);
 	QEventLoop loop;
-	QNetworkRequest request;
-	request.setRawHeader("Accept", "text/plain");
-	request.setRawHeader("User-Agent", getUserAgent().toUtf8());
-	request.setRawHeader("Client-Id", getUUID().toUtf8());
-	request.setUrl(QString(prefs.cloud_base_url) + TEAPOT);
 	QNetworkAccessManager *mgr = new QNetworkAccessManager();
-	reply = mgr->get(request);
+	reply = sendRequest(mgr);
 	connect(&timer, &QTimer::timeout, &loop, &QEventLoop::quit);
 	connect(reply, &QNetworkReply::finished, &loop, &QEventLoop::quit);
-	connect(reply, &QNetworkReply::sslErrors, this, &CheckCloudConnection::sslErrors);
 	for (int seconds = 1; seconds <= prefs.cloud_timeout; seconds++) {
 		timer.start(1000); // wait the given number of seconds (default 5)
 		loop.exec();
 		if (timer.isActive()) {
 			// didn't time out, did we get the right response?
 			timer.stop();
-			if (reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt() == HTTP_I_AM_A_TEAPOT &&
-			    reply->readAll() == QByteArray(MILK)) {
+			if (isTeapot(reply)) {
 				reply->deleteLater();
 				mgr->deleteLater();
+				rememberCloudConnection(true);
 				if (verbose > 1)
 					qWarning() << "Cloud storage: successfully checked connection to cloud server";
 				return true;
@@ -64,6 +113,7 @@ bool CheckCloudConnection::checkServer()
 	}
 	git_storage_update_progress(qPrintable(tr("Cloud connection failed")));
 	git_local_only = true;
+	rememberCloudConnection(false);
 	if (verbose)
 		qDebug() << "connection test to cloud server failed" <<
 			    reply->error() << reply->errorString() <<
@@ -76,6 +126,42 @@ bool CheckCloudConnection::checkServer()
 	return false;
 }
 
+void CheckCloudConnection::startCheck()
+{
+	QNetworkAccessManager *mgr = new QNetworkAccessManager(this);
+	reply = sendRequest(mgr);
+	connect(reply, &QNetworkReply::finished, this, &CheckCloudConnection::checkFinished);
+	// An aborted reply finishes with an error
+	QTimer::singleShot(prefs.cloud_timeout * 1000, reply, &QNetworkReply::abort);
+}
+
+void CheckCloudConnection::checkFinished()
+{
+	bool reachable = isTeapot(reply);
+	rememberCloudConnection(reachable);
+	if (verbose)
+		qWarning() << "Cloud storage: background check of the connection to the cloud server" << (reachable ? "succeeded" : "failed");
+	emit finished(reachable);
+	// The network access manager and the reply are children of this object
+	deleteLater();
+}
+
+// The check that is running in the background. Only accessed from the main thread.
+static QPointer<CheckCloudConnection> backgroundCheck;
+
+static bool onMainThread()
+{
+	return QCoreApplication::instance() && QThread::currentThread() == QCoreApplication::instance()->thread();
+}
+
+void checkCloudConnectionInBackground()
+{
+	if (!onMainThread() || backgroundCheck || recentCloudConnection() >= 0)
+		return;
+	backgroundCheck = new CheckCloudConnection;
+	backgroundCheck->startCheck();
+}
+
 void CheckCloudConnection::sslErrors(const QList<QSslError> &errorList)
 {
 	qDebug() << "Received error response trying to set up https connection with cloud storage backend:";
@@ -86,6 +172,22 @@ void CheckCloudConnection::sslErrors(const QList<QSslError> &errorList)
 // helper to be used from C code
 extern "C" bool canReachCloudServer()
 {
+	int recent = recentCloudConnection();
+	if (recent < 0 && onMainThread() && backgroundCheck) {
+		// Wait for the remaining time of the check that is already running
+		git_storage_update_progress(qPrintable(QCoreApplication::translate("CheckCloudConnection", "Waiting for cloud connection")));
+		QEventLoop loop;
+		QObject::connect(backgroundCheck.data(), &CheckCloudConnection::finished, &loop, &QEventLoop::quit);
+		loop.exec();
+		recent = recentCloudConnection();
+	}
+	if (recent >= 0) {
+		if (verbose)
+			qWarning() << "Cloud storage: cloud server was" << (recent ? "reachable" : "unreachable") << "recently";
+		if (!recent)
+			git_local_only = true;
+		return recent == 1;
+	}
 	if (verbose)
 		qWarning() << "Cloud storage: checking connection to cloud server";
 	return CheckCloudConnection().checkServer();
@@ -11,11 +11,25 @@ class CheckCloudConnection : public QObject {
 public:
 	CheckCloudConnection(QObject *parent = 0);
 	bool checkServer();
+	void startCheck();	// Doesn't block, the object deletes itself when done
+signals:
+	void finished(bool reachable);
 private:
 	QNetworkReply *reply;
+	QNetworkReply *sendRequest(QNetworkAccessManager *mgr);
 private
 slots:
 	void sslErrors(const QList<QSslError> &errorList);
+	void checkFinished();
 };
 
+// The result of the last check is shared by all cloud operations, so that they
+// don't each wait for an unreachable server. A success is trusted for a few
+// minutes, a failure only briefly, to notice soon when the connection is back.
+void rememberCloudConnection(bool reachable);
+bool cloudRecentlyUnreachable();
+// Check the connection without blocking, e.g. while the local data is loaded.
+// canReachCloudServer() then waits only for the remaining time of this check.
+void checkCloudConnectionInBackground();
+
 #endif // CHECKCLOUDCONNECTION_H
@@ -1,5 +1,6 @@
 // SPDX-License-Identifier: GPL-2.0
 #include "cloudstorage.h"
+#include "checkcloudconnection.h"
 #include "pref.h"
 #include "qthelper.h"
 #include "errorhelper.h"
@@ -50,6 +51,8 @@ void CloudStorageAuthenticate::uploadFinished()
 
 	QString cloudAuthReply(reply->readAll());
 	qDebug() << "Completed connection with cloud storage backend, response" << cloudAuthReply;
+	if (reply->error() == QNetworkReply::NoError)
+		rememberCloudConnection(true);
 
 	if (cloudAuthReply == QLatin1String("[VERIFIED]") || cloudAuthReply == QLatin1String("[OK]")) {
 		qPrefCloudStorage::set_cloud_verification_status(qPrefCloudStorage::CS_VERIFIED);
@@ -22,6 +22,7 @@
 #include "gettext.h"
 #include "cochran.h"
 #include "divelist.h"
+#include "parallel.h"
 
 #include <libdivecomputer/parser.h>
 
@@ -602,9 +603,10 @@ static void cochran_parse_samples(struct dive *dive, const unsigned char *log,
 		*duration = sample_cnt * profile_period - 1;
 }
 
-static void cochran_parse_dive(const unsigned char *decode, unsigned mod,
-			       const unsigned char *in, unsigned size,
-			       struct dive_table *table)
+/* Returns NULL if the dive is corrupt. Only reads the configuration of the
+ * header, so that the dives can be decoded in parallel. */
+static struct dive *cochran_parse_dive(const unsigned char *decode, unsigned mod,
+				       const unsigned char *in, unsigned size)
 {
 	unsigned char *buf = malloc(size);
 	struct dive *dive;
@@ -640,7 +642,7 @@ static void cochran_parse_dive(const unsigned char *decode, unsigned mod,
 	if (size < 0x4914 + config.logbook_size) {
 		// Analyst calls this a "Corrupt Beginning Summary"
 		free(buf);
-		return;
+		return NULL;
 	}
 
 	// Decode log entry (512 bytes + random prefix)
@@ -794,9 +796,23 @@ static void cochran_parse_dive(const unsigned char *decode, unsigned mod,
 		dc->duration.seconds = duration;
 	}
 
-	record_dive_to_table(dive, table);
-
 	free(buf);
+	return dive;
+}
+
+struct cochran_dives {
+	const unsigned char *decode;
+	unsigned mod;
+	const unsigned char *buffer;
+	const unsigned int *offsets;
+	struct dive **dives;
+};
+
+static void cochran_parse_dive_idx(int idx, void *data)
+{
+	struct cochran_dives *d = data;
+	d->dives[idx] = cochran_parse_dive(d->decode, d->mod, d->buffer + d->offsets[idx],
+					   d->offsets[idx + 1] - d->offsets[idx]);
 }
 
 int try_to_open_cochran(const char *filename, struct memblock *mem, struct dive_table *table, struct trip_table *trips, struct dive_site_table *sites)
@@ -822,7 +838,7 @@ int try_to_open_cochran(const char *filename, struct memblock *mem, struct dive_
 	mod = decode[0x100] + 1;
 	cochran_parse_header(decode, mod, mem->buffer + 0x40000, dive1 - 0x40000);
 
-	// Decode each dive
+	// Find the dives in the index, they end where the next one starts
 	for (i = 0; i < 65534; i++) {
 		dive1 = offsets[i];
 		dive2 = offsets[i + 1];
@@ -830,10 +846,18 @@ int try_to_open_cochran(const char *filename, struct memblock *mem, struct dive_
 			break;
 		if (dive2 > mem->size)
 			break;
+	}
 
-		cochran_parse_dive(decode, mod, mem->buffer + dive1,
-						dive2 - dive1, table);
+	// Decode the dives in parallel and add them in the order of the file
+	struct cochran_dives dives = { decode, mod, mem->buffer, offsets, calloc(i + 1, sizeof(struct dive *)) };
+	if (!dives.dives)
+		exit(1);
+	parallel_for(i, cochran_parse_dive_idx, &dives);
+	for (unsigned int j = 0; j < i; j++) {
+		if (dives.dives[j])
+			record_dive_to_table(dives.dives[j], table);
 	}
+	free(dives.dives);
 
 	return 1; // no further processing needed
 }
@@ -5,6 +5,9 @@
 #include "libdivecomputer.h"
 #include "units.h"
 #include "errorhelper.h"
+#include <QHash>
+#include <QMutex>
+#include <string.h>
 
 #define OSTC3_GAS1			0x10
 #define OSTC3_GAS2			0x11
@@ -148,7 +151,75 @@ static void write_ostc_cf(unsigned char data[], unsigned char cf, unsigned char
 		progress_cb(device, DC_EVENT_PROGRESS, &progress, userdata); \
 	} while (0)
 
-static dc_status_t read_suunto_vyper_settings(dc_device_t *device, DeviceDetails *m_deviceDetails, dc_event_callback_t progress_cb, void *userdata)
+// The configuration values of a dive computer as last read from or written to it,
+// indexed by their config id or address. Every value takes a round trip to the
+// device, which is slow over Bluetooth, so values that the device is known to
+// have already are not written again.
+struct DeviceConfig {
+	QHash<unsigned int, QByteArray> values;
+	QString customText;
+};
+
+static QMutex deviceConfigMutex;
+static QHash<QString, DeviceConfig> deviceConfigs;	// indexed by model and serial number
+
+static QString deviceConfigKey(const DeviceDetails *details)
+{
+	return details->model + "/" + details->serialNo;
+}
+
+static DeviceConfig knownDeviceConfig(const DeviceDetails *details)
+{
+	QMutexLocker lock(&deviceConfigMutex);
+	return deviceConfigs.value(deviceConfigKey(details));
+}
+
+static void storeDeviceConfig(const DeviceDetails *details, const DeviceConfig &config)
+{
+	QMutexLocker lock(&deviceConfigMutex);
+	deviceConfigs[deviceConfigKey(details)] = config;
+}
+
+// After a reset or a firmware update, nothing is known about the settings
+static void forgetDeviceConfigs()
+{
+	QMutexLocker lock(&deviceConfigMutex);
+	deviceConfigs.clear();
+}
+
+static void learnValue(DeviceConfig &config, dc_status_t rc, unsigned int param, const unsigned char data[], unsigned int size)
+{
+	if (rc == DC_STATUS_SUCCESS)
+		config.values[param] = QByteArray((const char *)data, size);
+	else
+		config.values.remove(param);
+}
+
+// Some values are read with a bigger buffer than they are written,
+// so compare only the written part.
+static bool knownValue(const DeviceConfig &config, unsigned int param, const unsigned char data[], unsigned int size)
+{
+	auto it = config.values.find(param);
+	return it != config.values.end() && it->left(size) == QByteArray((const char *)data, size);
+}
+
+static dc_status_t vyper_read(dc_device_t *device, DeviceConfig &config, unsigned int address, unsigned char data[], unsigned int size)
+{
+	dc_status_t rc = dc_device_read(device, address, data, size);
+	learnValue(config, rc, address, data, size);
+	return rc;
+}
+
+static dc_status_t vyper_write(dc_device_t *device, DeviceConfig &config, unsigned int address, const unsigned char data[], unsigned int size)
+{
+	if (knownValue(config, address, data, size))
+		return DC_STATUS_SUCCESS;
+	dc_status_t rc = dc_device_write(device, address, data, size);
+	learnValue(config, rc, address, data, size);
+	return rc;
+}
+
+static dc_status_t read_suunto_vyper_settings(dc_device_t *device, DeviceDetails *m_deviceDetails, DeviceConfig &config, dc_event_callback_t progress_cb, void *userdata)
 {
 	unsigned char data[SUUNTO_VYPER_CUSTOM_TEXT_LENGTH + 1];
 	dc_status_t rc;
@@ -156,7 +227,7 @@ static dc_status_t read_suunto_vyper_settings(dc_device_t *device, DeviceDetails
 	progress.current = 0;
 	progress.maximum = 16;
 
-	rc = dc_device_read(device, SUUNTO_VYPER_COMPUTER_TYPE, data, 1);
+	rc = vyper_read(device, config, SUUNTO_VYPER_COMPUTER_TYPE, data, 1);
 	if (rc == DC_STATUS_SUCCESS) {
 		dc_descriptor_t *desc = get_descriptor(DC_FAMILY_SUUNTO_VYPER, data[0]);
 
@@ -171,7 +242,7 @@ static dc_status_t read_suunto_vyper_settings(dc_device_t *device, DeviceDetails
 	}
 	EMIT_PROGRESS();
 
-	rc = dc_device_read(device, SUUNTO_VYPER_MAXDEPTH, data, 2);
+	rc = vyper_read(device, config, SUUNTO_VYPER_MAXDEPTH, data, 2);
 	if (rc != DC_STATUS_SUCCESS)
 		return rc;
 	// in ft * 128.0
@@ -179,86 +250,86 @@ static dc_status_t read_suunto_vyper_settings(dc_device_t *device, DeviceDetails
 	m_deviceDetails->maxDepth = depth;
 	EMIT_PROGRESS();
 
-	rc = dc_device_read(device, SUUNTO_VYPER_TOTAL_TIME, data, 2);
+	rc = vyper_read(device, config, SUUNTO_VYPER_TOTAL_TIME, data, 2);
 	if (rc != DC_STATUS_SUCCESS)
 		return rc;
 	int total_time = data[0] << 8 ^ data[1];
 	m_deviceDetails->totalTime = total_time;
 	EMIT_PROGRESS();
 
-	rc = dc_device_read(device, SUUNTO_VYPER_NUMBEROFDIVES, data, 2);
+	rc = vyper_read(device, config, SUUNTO_VYPER_NUMBEROFDIVES, data, 2);
 	if (rc != DC_STATUS_SUCCESS)
 		return rc;
 	int number_of_dives = data[0] << 8 ^ data[1];
 	m_deviceDetails->numberOfDives = number_of_dives;
 	EMIT_PROGRESS();
 
-	rc = dc_device_read(device, SUUNTO_VYPER_FIRMWARE, data, 1);
+	rc = vyper_read(device, config, SUUNTO_VYPER_FIRMWARE, data, 1);
 	if (rc != DC_STATUS_SUCCESS)
 		return rc;
 	m_deviceDetails->firmwareVersion = QString::number(data[0]) + ".0.0";
 	EMIT_PROGRESS();
 
-	rc = dc_device_read(device, SUUNTO_VYPER_SERIALNUMBER, data, 4);
+	rc = vyper_read(device, config, SUUNTO_VYPER_SERIALNUMBER, data, 4);
 	if (rc != DC_STATUS_SUCCESS)
 		return rc;
 	int serial_number = data[0] * 1000000 + data[1] * 10000 + data[2] * 100 + data[3];
 	m_deviceDetails->serialNo = QString::number(serial_number);
 	EMIT_PROGRESS();
 
-	rc = dc_device_read(device, SUUNTO_VYPER_CUSTOM_TEXT, data, SUUNTO_VYPER_CUSTOM_TEXT_LENGTH);
+	rc = vyper_read(device, config, SUUNTO_VYPER_CUSTOM_TEXT, data, SUUNTO_VYPER_CUSTOM_TEXT_LENGTH);
 	if (rc != DC_STATUS_SUCCESS)
 		return rc;
 	data[SUUNTO_VYPER_CUSTOM_TEXT_LENGTH] = 0;
 	m_deviceDetails->customText = (const char *)data;
 	EMIT_PROGRESS();
 
-	rc = dc_device_read(device, SUUNTO_VYPER_SAMPLING_RATE, data, 1);
+	rc = vyper_read(device, config, SUUNTO_VYPER_SAMPLING_RATE, data, 1);
 	if (rc != DC_STATUS_SUCCESS)
 		return rc;
 	m_deviceDetails->samplingRate = (int)data[0];
 	EMIT_PROGRESS();
 
-	rc = dc_device_read(device, SUUNTO_VYPER_ALTITUDE_SAFETY, data, 1);
+	rc = vyper_read(device, config, SUUNTO_VYPER_ALTITUDE_SAFETY, data, 1);
 	if (rc != DC_STATUS_SUCCESS)
 		return rc;
 	m_deviceDetails->altitude = data[0] & 0x03;
 	m_deviceDetails->personalSafety = data[0] >> 2 & 0x03;
 	EMIT_PROGRESS();
 
-	rc = dc_device_read(device, SUUNTO_VYPER_TIMEFORMAT, data, 1);
+	rc = vyper_read(device, config, SUUNTO_VYPER_TIMEFORMAT, data, 1);
 	if (rc != DC_STATUS_SUCCESS)
 		return rc;
 	m_deviceDetails->timeFormat = data[0] & 0x01;
 	EMIT_PROGRESS();
 
-	rc = dc_device_read(device, SUUNTO_VYPER_UNITS, data, 1);
+	rc = vyper_read(device, config, SUUNTO_VYPER_UNITS, data, 1);
 	if (rc != DC_STATUS_SUCCESS)
 		return rc;
 	m_deviceDetails->units = data[0] & 0x01;
 	EMIT_PROGRESS();
 
-	rc = dc_device_read(device, SUUNTO_VYPER_MODEL, data, 1);
+	rc = vyper_read(device, config, SUUNTO_VYPER_MODEL, data, 1);
 	if (rc != DC_STATUS_SUCCESS)
 		return rc;
 	m_deviceDetails->diveMode = data[0] & 0x03;
 	EMIT_PROGRESS();
 
-	rc = dc_device_read(device, SUUNTO_VYPER_LIGHT, data, 1);
+	rc = vyper_read(device, config, SUUNTO_VYPER_LIGHT, data, 1);
 	if (rc != DC_STATUS_SUCCESS)
 		return rc;
 	m_deviceDetails->lightEnabled = data[0] >> 7;
 	m_deviceDetails->light = data[0] & 0x7F;
 	EMIT_PROGRESS();
 
-	rc = dc_device_read(device, SUUNTO_VYPER_ALARM_DEPTH_TIME, data, 1);
+	rc = vyper_read(device, config, SUUNTO_VYPER_ALARM_DEPTH_TIME, data, 1);
 	if (rc != DC_STATUS_SUCCESS)
 		return rc;
 	m_deviceDetails->alarmTimeEnabled = data[0] & 0x01;
 	m_deviceDetails->alarmDepthEnabled = data[0] >> 1 & 0x01;
 	EMIT_PROGRESS();
 
-	rc = dc_device_read(device, SUUNTO_VYPER_ALARM_TIME, data, 2);
+	rc = vyper_read(device, config, SUUNTO_VYPER_ALARM_TIME, data, 2);
 	if (rc != DC_STATUS_SUCCESS)
 		return rc;
 	int time = data[0] << 8 ^ data[1];
@@ -268,7 +339,7 @@ static dc_status_t read_suunto_vyper_settings(dc_device_t *device, DeviceDetails
 	m_deviceDetails->alarmTime = time;
 	EMIT_PROGRESS();
 
-	rc = dc_device_read(device, SUUNTO_VYPER_ALARM_DEPTH, data, 2);
+	rc = vyper_read(device, config, SUUNTO_VYPER_ALARM_DEPTH, data, 2);
 	if (rc != DC_STATUS_SUCCESS)
 		return rc;
 	depth = feet_to_mm(data[0] << 8 ^ data[1]) / 128;
@@ -278,7 +349,7 @@ static dc_status_t read_suunto_vyper_settings(dc_device_t *device, DeviceDetails
 	return DC_STATUS_SUCCESS;
 }
 
-static dc_status_t write_suunto_vyper_settings(dc_device_t *device, DeviceDetails *m_deviceDetails, dc_event_callback_t progress_cb, void *userdata)
+static dc_status_t write_suunto_vyper_settings(dc_device_t *device, DeviceDetails *m_deviceDetails, DeviceConfig &config, dc_event_callback_t progress_cb, void *userdata)
 {
 	dc_status_t rc;
 	dc_event_progress_t progress;
@@ -293,7 +364,7 @@ static dc_status_t write_suunto_vyper_settings(dc_device_t *device, DeviceDetail
 	if (m_deviceDetails->model == "")
 		return DC_STATUS_UNSUPPORTED;
 
-	rc = dc_device_write(device, SUUNTO_VYPER_CUSTOM_TEXT,
+	rc = vyper_write(device, config, SUUNTO_VYPER_CUSTOM_TEXT,
 			     // Convert the customText to a 30 char wide padded with " "
 			     (const unsigned char *)qPrintable(QString("%1").arg(m_deviceDetails->customText, -30, QChar(' '))),
 			     SUUNTO_VYPER_CUSTOM_TEXT_LENGTH);
@@ -302,43 +373,43 @@ static dc_status_t write_suunto_vyper_settings(dc_device_t *device, DeviceDetail
 	EMIT_PROGRESS();
 
 	data = m_deviceDetails->samplingRate;
-	rc = dc_device_write(device, SUUNTO_VYPER_SAMPLING_RATE, &data, 1);
+	rc = vyper_write(device, config, SUUNTO_VYPER_SAMPLING_RATE, &data, 1);
 	if (rc != DC_STATUS_SUCCESS)
 		return rc;
 	EMIT_PROGRESS();
 
 	data = m_deviceDetails->personalSafety << 2 ^ m_deviceDetails->altitude;
-	rc = dc_device_write(device, SUUNTO_VYPER_ALTITUDE_SAFETY, &data, 1);
+	rc = vyper_write(device, config, SUUNTO_VYPER_ALTITUDE_SAFETY, &data, 1);
 	if (rc != DC_STATUS_SUCCESS)
 		return rc;
 	EMIT_PROGRESS();
 
 	data = m_deviceDetails->timeFormat;
-	rc = dc_device_write(device, SUUNTO_VYPER_TIMEFORMAT, &data, 1);
+	rc = vyper_write(device, config, SUUNTO_VYPER_TIMEFORMAT, &data, 1);
 	if (rc != DC_STATUS_SUCCESS)
 		return rc;
 	EMIT_PROGRESS();
 
 	data = m_deviceDetails->units;
-	rc = dc_device_write(device, SUUNTO_VYPER_UNITS, &data, 1);
+	rc = vyper_write(device, config, SUUNTO_VYPER_UNITS, &data, 1);
 	if (rc != DC_STATUS_SUCCESS)
 		return rc;
 	EMIT_PROGRESS();
 
 	data = m_deviceDetails->diveMode;
-	rc = dc_device_write(device, SUUNTO_VYPER_MODEL, &data, 1);
+	rc = vyper_write(device, config, SUUNTO_VYPER_MODEL, &data, 1);
 	if (rc != DC_STATUS_SUCCESS)
 		return rc;
 	EMIT_PROGRESS();
 
 	data = m_deviceDetails->lightEnabled << 7 ^ (m_deviceDetails->light & 0x7F);
-	rc = dc_device_write(device, SUUNTO_VYPER_LIGHT, &data, 1);
+	rc = vyper_write(device, config, SUUNTO_VYPER_LIGHT, &data, 1);
 	if (rc != DC_STATUS_SUCCESS)
 		return rc;
 	EMIT_PROGRESS();
 
 	data = m_deviceDetails->alarmDepthEnabled << 1 ^ m_deviceDetails->alarmTimeEnabled;
-	rc = dc_device_write(device, SUUNTO_VYPER_ALARM_DEPTH_TIME, &data, 1);
+	rc = vyper_write(device, config, SUUNTO_VYPER_ALARM_DEPTH_TIME, &data, 1);
 	if (rc != DC_STATUS_SUCCESS)
 		return rc;
 	EMIT_PROGRESS();
@@ -349,19 +420,44 @@ static dc_status_t write_suunto_vyper_settings(dc_device_t *device, DeviceDetail
 		time *= 60;
 	data2[0] = time >> 8;
 	data2[1] = time & 0xFF;
-	rc = dc_device_write(device, SUUNTO_VYPER_ALARM_TIME, data2, 2);
+	rc = vyper_write(device, config, SUUNTO_VYPER_ALARM_TIME, data2, 2);
 	if (rc != DC_STATUS_SUCCESS)
 		return rc;
 	EMIT_PROGRESS();
 
 	data2[0] = (int)(mm_to_feet(m_deviceDetails->alarmDepth) * 128) >> 8;
 	data2[1] = (int)(mm_to_feet(m_deviceDetails->alarmDepth) * 128) & 0x0FF;
-	rc = dc_device_write(device, SUUNTO_VYPER_ALARM_DEPTH, data2, 2);
+	rc = vyper_write(device, config, SUUNTO_VYPER_ALARM_DEPTH, data2, 2);
 	EMIT_PROGRESS();
 	return rc;
 }
 
-static dc_status_t read_ostc4_settings(dc_device_t *device, DeviceDetails *m_deviceDetails, dc_event_callback_t progress_cb, void *userdata)
+static dc_status_t ostc3_config_read(dc_device_t *device, DeviceConfig &config, unsigned int param, unsigned char data[], unsigned int size)
+{
+	dc_status_t rc = hw_ostc3_device_config_read(device, param, data, size);
+	learnValue(config, rc, param, data, size);
+	return rc;
+}
+
+static dc_status_t ostc3_config_write(dc_device_t *device, DeviceConfig &config, unsigned int param, unsigned char data[], unsigned int size)
+{
+	if (knownValue(config, param, data, size))
+		return DC_STATUS_SUCCESS;
+	dc_status_t rc = hw_ostc3_device_config_write(device, param, data, size);
+	learnValue(config, rc, param, data, size);
+	return rc;
+}
+
+static dc_status_t ostc3_customtext(dc_device_t *device, DeviceConfig &config, const QString &text)
+{
+	if (!config.customText.isNull() && config.customText == text)
+		return DC_STATUS_SUCCESS;
+	dc_status_t rc = hw_ostc3_device_customtext(device, qPrintable(text));
+	config.customText = rc == DC_STATUS_SUCCESS ? text : QString();
+	return rc;
+}
+
+static dc_status_t read_ostc4_settings(dc_device_t *device, DeviceDetails *m_deviceDetails, DeviceConfig &config, dc_event_callback_t progress_cb, void *userdata)
 {
 	// This code is really similar to the OSTC3 code, but there are minor
 	// differences in what the data means, and how to communicate with the
@@ -381,7 +477,7 @@ static dc_status_t read_ostc4_settings(dc_device_t *device, DeviceDetails *m_dev
 	gas gas5;
 	unsigned char gasData[4] = { 0, 0, 0, 0 };
 
-	rc = hw_ostc3_device_config_read(device, OSTC3_GAS1, gasData, sizeof(gasData));
+	rc = ostc3_config_read(device, config, OSTC3_GAS1, gasData, sizeof(gasData));
 	if (rc != DC_STATUS_SUCCESS)
 		return rc;
 	gas1.oxygen = gasData[0];
@@ -390,7 +486,7 @@ static dc_status_t read_ostc4_settings(dc_device_t *device, DeviceDetails *m_dev
 	gas1.depth = gasData[3];
 	EMIT_PROGRESS();
 
-	rc = hw_ostc3_device_config_read(device, OSTC3_GAS2, gasData, sizeof(gasData));
+	rc = ostc3_config_read(device, config, OSTC3_GAS2, gasData, sizeof(gasData));
 	if (rc != DC_STATUS_SUCCESS)
 		return rc;
 	gas2.oxygen = gasData[0];
@@ -399,7 +495,7 @@ static dc_status_t read_ostc4_settings(dc_device_t *device, DeviceDetails *m_dev
 	gas2.depth = gasData[3];
 	EMIT_PROGRESS();
 
-	rc = hw_ostc3_device_config_read(device, OSTC3_GAS3, gasData, sizeof(gasData));
+	rc = ostc3_config_read(device, config, OSTC3_GAS3, gasData, sizeof(gasData));
 	if (rc != DC_STATUS_SUCCESS)
 		return rc;
 	gas3.oxygen = gasData[0];
@@ -408,7 +504,7 @@ static dc_status_t read_ostc4_settings(dc_device_t *device, DeviceDetails *m_dev
 	gas3.depth = gasData[3];
 	EMIT_PROGRESS();
 
-	rc = hw_ostc3_device_config_read(device, OSTC3_GAS4, gasData, sizeof(gasData));
+	rc = ostc3_config_read(device, config, OSTC3_GAS4, gasData, sizeof(gasData));
 	if (rc != DC_STATUS_SUCCESS)
 		return rc;
 	gas4.oxygen = gasData[0];
@@ -417,7 +513,7 @@ static dc_status_t read_ostc4_settings(dc_device_t *device, DeviceDetails *m_dev
 	gas4.depth = gasData[3];
 	EMIT_PROGRESS();
 
-	rc = hw_ostc3_device_config_read(device, OSTC3_GAS5, gasData, sizeof(gasData));
+	rc = ostc3_config_read(device, config, OSTC3_GAS5, gasData, sizeof(gasData));
 	if (rc != DC_STATUS_SUCCESS)
 		return rc;
 	gas5.oxygen = gasData[0];
@@ -441,7 +537,7 @@ static dc_status_t read_ostc4_settings(dc_device_t *device, DeviceDetails *m_dev
 	gas dil5;
 	unsigned char dilData[4] = { 0, 0, 0, 0 };
 
-	rc = hw_ostc3_device_config_read(device, OSTC3_DIL1, dilData, sizeof(dilData));
+	rc = ostc3_config_read(device, config, OSTC3_DIL1, dilData, sizeof(dilData));
 	if (rc != DC_STATUS_SUCCESS)
 		return rc;
 	dil1.oxygen = dilData[0];
@@ -450,7 +546,7 @@ static dc_status_t read_ostc4_settings(dc_device_t *device, DeviceDetails *m_dev
 	dil1.depth = dilData[3];
 	EMIT_PROGRESS();
 
-	rc = hw_ostc3_device_config_read(device, OSTC3_DIL2, dilData, sizeof(dilData));
+	rc = ostc3_config_read(device, config, OSTC3_DIL2, dilData, sizeof(dilData));
 	if (rc != DC_STATUS_SUCCESS)
 		return rc;
 	dil2.oxygen = dilData[0];
@@ -459,7 +555,7 @@ static dc_status_t read_ostc4_settings(dc_device_t *device, DeviceDetails *m_dev
 	dil2.depth = dilData[3];
 	EMIT_PROGRESS();
 
-	rc = hw_ostc3_device_config_read(device, OSTC3_DIL3, dilData, sizeof(dilData));
+	rc = ostc3_config_read(device, config, OSTC3_DIL3, dilData, sizeof(dilData));
 	if (rc != DC_STATUS_SUCCESS)
 		return rc;
 	dil3.oxygen = dilData[0];
@@ -468,7 +564,7 @@ static dc_status_t read_ostc4_settings(dc_device_t *device, DeviceDetails *m_dev
 	dil3.depth = dilData[3];
 	EMIT_PROGRESS();
 
-	rc = hw_ostc3_device_config_read(device, OSTC3_DIL4, dilData, sizeof(dilData));
+	rc = ostc3_config_read(device, config, OSTC3_DIL4, dilData, sizeof(dilData));
 	if (rc != DC_STATUS_SUCCESS)
 		return rc;
 	dil4.oxygen = dilData[0];
@@ -477,7 +573,7 @@ static dc_status_t read_ostc4_settings(dc_device_t *device, DeviceDetails *m_dev
 	dil4.depth = dilData[3];
 	EMIT_PROGRESS();
 
-	rc = hw_ostc3_device_config_read(device, OSTC3_DIL5, dilData, sizeof(dilData));
+	rc = ostc3_config_read(device, config, OSTC3_DIL5, dilData, sizeof(dilData));
 	if (rc != DC_STATUS_SUCCESS)
 		return rc;
 	dil5.oxygen = dilData[0];
@@ -500,35 +596,35 @@ static dc_status_t read_ostc4_settings(dc_device_t *device, DeviceDetails *m_dev
 	setpoint sp5;
 	unsigned char spData[4] = { 0, 0, 0, 0};
 
-	rc = hw_ostc3_device_config_read(device, OSTC3_SP1, spData, sizeof(spData));
+	rc = ostc3_config_read(device, config, OSTC3_SP1, spData, sizeof(spData));
 	if (rc != DC_STATUS_SUCCESS)
 		return rc;
 	sp1.sp = spData[0];
 	sp1.depth = spData[1];
 	EMIT_PROGRESS();
 
-	rc = hw_ostc3_device_config_read(device, OSTC3_SP2, spData, sizeof(spData));
+	rc = ostc3_config_read(device, config, OSTC3_SP2, spData, sizeof(spData));
 	if (rc != DC_STATUS_SUCCESS)
 		return rc;
 	sp2.sp = spData[0];
 	sp2.depth = spData[1];
 	EMIT_PROGRESS();
 
-	rc = hw_ostc3_device_config_read(device, OSTC3_SP3, spData, sizeof(spData));
+	rc = ostc3_config_read(device, config, OSTC3_SP3, spData, sizeof(spData));
 	if (rc != DC_STATUS_SUCCESS)
 		return rc;
 	sp3.sp = spData[0];
 	sp3.depth = spData[1];
 	EMIT_PROGRESS();
 
-	rc = hw_ostc3_device_config_read(device, OSTC3_SP4, spData, sizeof(spData));
+	rc = ostc3_config_read(device, config, OSTC3_SP4, spData, sizeof(spData));
 	if (rc != DC_STATUS_SUCCESS)
 		return rc;
 	sp4.sp = spData[0];
 	sp4.depth = spData[1];
 	EMIT_PROGRESS();
 
-	rc = hw_ostc3_device_config_read(device, OSTC3_SP5, spData, sizeof(spData));
+	rc = ostc3_config_read(device, config, OSTC3_SP5, spData, sizeof(spData));
 	if (rc != DC_STATUS_SUCCESS)
 		return rc;
 	sp5.sp = spData[0];
@@ -546,7 +642,7 @@ static dc_status_t read_ostc4_settings(dc_device_t *device, DeviceDetails *m_dev
 
 #define READ_SETTING(_OSTC4_SETTING, _DEVICE_DETAIL)                                            \
 	do {                                                                                    \
-		rc = hw_ostc3_device_config_read(device, _OSTC4_SETTING, uData, sizeof(uData)); \
+		rc = ostc3_config_read(device, config, _OSTC4_SETTING, uData, sizeof(uData)); \
 		if (rc != DC_STATUS_SUCCESS)                                                    \
 			return rc;                                                              \
 		m_deviceDetails->_DEVICE_DETAIL = uData[0];                                     \
@@ -593,14 +689,14 @@ static dc_status_t read_ostc4_settings(dc_device_t *device, DeviceDetails *m_dev
 
 #undef READ_SETTING
 
-	rc = hw_ostc3_device_config_read(device, OSTC3_PRESSURE_SENSOR_OFFSET, uData, sizeof(uData));
+	rc = ostc3_config_read(device, config, OSTC3_PRESSURE_SENSOR_OFFSET, uData, sizeof(uData));
 	if (rc != DC_STATUS_SUCCESS)
 		return rc;
 	// OSTC3 stores the pressureSensorOffset in two-complement
 	m_deviceDetails->pressureSensorOffset = (signed char)uData[0];
 	EMIT_PROGRESS();
 
-	rc = hw_ostc3_device_config_read(device, OSTC3_TEMP_SENSOR_OFFSET, uData, sizeof(uData));
+	rc = ostc3_config_read(device, config, OSTC3_TEMP_SENSOR_OFFSET, uData, sizeof(uData));
 	if (rc != DC_STATUS_SUCCESS)
 		return rc;
 	// OSTC3 stores the tempSensorOffset in two-complement
@@ -623,12 +719,13 @@ static dc_status_t read_ostc4_settings(dc_device_t *device, DeviceDetails *m_dev
 	m_deviceDetails->firmwareVersion = QString("%1.%2.%3%4").arg(X).arg(Y).arg(Z).arg(beta?" beta":"");
 	QByteArray ar((char *)fData + 4, 60);
 	m_deviceDetails->customText = ar.trimmed();
+	config.customText = m_deviceDetails->customText;
 	EMIT_PROGRESS();
 
 	return rc;
 }
 
-static dc_status_t write_ostc4_settings(dc_device_t *device, DeviceDetails *m_deviceDetails, dc_event_callback_t progress_cb, void *userdata)
+static dc_status_t write_ostc4_settings(dc_device_t *device, DeviceDetails *m_deviceDetails, DeviceConfig &config, dc_event_callback_t progress_cb, void *userdata)
 {
 	// This code is really similar to the OSTC3 code, but there are minor
 	// differences in what the data means, and how to communicate with the
@@ -674,27 +771,27 @@ static dc_status_t write_ostc4_settings(dc_device_t *device, DeviceDetails *m_de
 		m_deviceDetails->gas5.depth
 	};
 	//gas 1
-	rc = hw_ostc3_device_config_write(device, OSTC3_GAS1, gas1Data, sizeof(gas1Data));
+	rc = ostc3_config_write(device, config, OSTC3_GAS1, gas1Data, sizeof(gas1Data));
 	if (rc != DC_STATUS_SUCCESS)
 		return rc;
 	EMIT_PROGRESS();
 	//gas 2
-	rc = hw_ostc3_device_config_write(device, OSTC3_GAS2, gas2Data, sizeof(gas2Data));
+	rc = ostc3_config_write(device, config, OSTC3_GAS2, gas2Data, sizeof(gas2Data));
 	if (rc != DC_STATUS_SUCCESS)
 		return rc;
 	EMIT_PROGRESS();
 	//gas 3
-	rc = hw_ostc3_device_config_write(device, OSTC3_GAS3, gas3Data, sizeof(gas3Data));
+	rc = ostc3_config_write(device, config, OSTC3_GAS3, gas3Data, sizeof(gas3Data));
 	if (rc != DC_STATUS_SUCCESS)
 		return rc;
 	EMIT_PROGRESS();
 	//gas 4
-	rc = hw_ostc3_device_config_write(device, OSTC3_GAS4, gas4Data, sizeof(gas4Data));
+	rc = ostc3_config_write(device, config, OSTC3_GAS4, gas4Data, sizeof(gas4Data));
 	if (rc != DC_STATUS_SUCCESS)
 		return rc;
 	EMIT_PROGRESS();
 	//gas 5
-	rc = hw_ostc3_device_config_write(device, OSTC3_GAS5, gas5Data, sizeof(gas5Data));
+	rc = ostc3_config_write(device, config, OSTC3_GAS5, gas5Data, sizeof(gas5Data));
 	if (rc != DC_STATUS_SUCCESS)
 		return rc;
 	EMIT_PROGRESS();
@@ -726,27 +823,27 @@ static dc_status_t write_ostc4_settings(dc_device_t *device, DeviceDetails *m_de
 	};
 
 	//sp 1
-	rc = hw_ostc3_device_config_write(device, OSTC3_SP1, sp1Data, sizeof(sp1Data));
+	rc = ostc3_config_write(device, config, OSTC3_SP1, sp1Data, sizeof(sp1Data));
 	if (rc != DC_STATUS_SUCCESS)
 		return rc;
 	EMIT_PROGRESS();
 	//sp 2
-	rc = hw_ostc3_device_config_write(device, OSTC3_SP2, sp2Data, sizeof(sp2Data));
+	rc = ostc3_config_write(device, config, OSTC3_SP2, sp2Data, sizeof(sp2Data));
 	if (rc != DC_STATUS_SUCCESS)
 		return rc;
 	EMIT_PROGRESS();
 	//sp 3
-	rc = hw_ostc3_device_config_write(device, OSTC3_SP3, sp3Data, sizeof(sp3Data));
+	rc = ostc3_config_write(device, config, OSTC3_SP3, sp3Data, sizeof(sp3Data));
 	if (rc != DC_STATUS_SUCCESS)
 		return rc;
 	EMIT_PROGRESS();
 	//sp 4
-	rc = hw_ostc3_device_config_write(device, OSTC3_SP4, sp4Data, sizeof(sp4Data));
+	rc = ostc3_config_write(device, config, OSTC3_SP4, sp4Data, sizeof(sp4Data));
 	if (rc != DC_STATUS_SUCCESS)
 		return rc;
 	EMIT_PROGRESS();
 	//sp 5
-	rc = hw_ostc3_device_config_write(device, OSTC3_SP5, sp5Data, sizeof(sp5Data));
+	rc = ostc3_config_write(device, config, OSTC3_SP5, sp5Data, sizeof(sp5Data));
 	if (rc != DC_STATUS_SUCCESS)
 		return rc;
 	EMIT_PROGRESS();
@@ -787,34 +884,34 @@ static dc_status_t write_ostc4_settings(dc_device_t *device, DeviceDetails *m_de
 		m_deviceDetails->dil5.depth
 	};
 	//dil 1
-	rc = hw_ostc3_device_config_write(device, OSTC3_DIL1, dil1Data, sizeof(gas1Data));
+	rc = ostc3_config_write(device, config, OSTC3_DIL1, dil1Data, sizeof(gas1Data));
 	if (rc != DC_STATUS_SUCCESS)
 		return rc;
 	EMIT_PROGRESS();
 	//dil 2
-	rc = hw_ostc3_device_config_write(device, OSTC3_DIL2, dil2Data, sizeof(dil2Data));
+	rc = ostc3_config_write(device, config, OSTC3_DIL2, dil2Data, sizeof(dil2Data));
 	if (rc != DC_STATUS_SUCCESS)
 		return rc;
 	EMIT_PROGRESS();
 	//dil 3
-	rc = hw_ostc3_device_config_write(device, OSTC3_DIL3, dil3Data, sizeof(dil3Data));
+	rc = ostc3_config_write(device, config, OSTC3_DIL3, dil3Data, sizeof(dil3Data));
 	if (rc != DC_STATUS_SUCCESS)
 		return rc;
 	EMIT_PROGRESS();
 	//dil 4
-	rc = hw_ostc3_device_config_write(device, OSTC3_DIL4, dil4Data, sizeof(dil4Data));
+	rc = ostc3_config_write(device, config, OSTC3_DIL4, dil4Data, sizeof(dil4Data));
 	if (rc != DC_STATUS_SUCCESS)
 		return rc;
 	EMIT_PROGRESS();
 	//dil 5
-	rc = hw_ostc3_device_config_write(device, OSTC3_DIL5, dil5Data, sizeof(dil5Data));
+	rc = ostc3_config_write(device, config, OSTC3_DIL5, dil5Data, sizeof(dil5Data));
 	if (rc != DC_STATUS_SUCCESS)
 		return rc;
 	EMIT_PROGRESS();
 
 	//write general settings
 	//custom text
-	rc = hw_ostc3_device_customtext(device, qPrintable(m_deviceDetails->customText));
+	rc = ostc3_customtext(device, config, m_deviceDetails->customText);
 	if (rc != DC_STATUS_SUCCESS)
 		return rc;
 	EMIT_PROGRESS();
@@ -823,7 +920,7 @@ static dc_status_t write_ostc4_settings(dc_device_t *device, DeviceDetails *m_de
 #define WRITE_SETTING(_OSTC4_SETTING, _DEVICE_DETAIL)                                          \
 	do {                                                                                   \
 		data[0] = m_deviceDetails->_DEVICE_DETAIL;                                     \
-		rc = hw_ostc3_device_config_write(device, _OSTC4_SETTING, data, sizeof(data)); \
+		rc = ostc3_config_write(device, config, _OSTC4_SETTING, data, sizeof(data)); \
 		if (rc != DC_STATUS_SUCCESS)                                                   \
 			return rc;                                                             \
 		EMIT_PROGRESS();                                                               \
@@ -871,14 +968,14 @@ static dc_status_t write_ostc4_settings(dc_device_t *device, DeviceDetails *m_de
 
 	// OSTC3 stores the pressureSensorOffset in two-complement
 	data[0] = (unsigned char)m_deviceDetails->pressureSensorOffset;
-	rc = hw_ostc3_device_config_write(device, OSTC3_PRESSURE_SENSOR_OFFSET, data, sizeof(data));
+	rc = ostc3_config_write(device, config, OSTC3_PRESSURE_SENSOR_OFFSET, data, sizeof(data));
 	if (rc != DC_STATUS_SUCCESS)
 		return rc;
 	EMIT_PROGRESS();
 
 	// OSTC3 stores the tempSensorOffset in two-complement
 	data[0] = (unsigned char)m_deviceDetails->tempSensorOffset;
-	rc = hw_ostc3_device_config_write(device, OSTC3_TEMP_SENSOR_OFFSET, data, sizeof(data));
+	rc = ostc3_config_write(device, config, OSTC3_TEMP_SENSOR_OFFSET, data, sizeof(data));
 	if (rc != DC_STATUS_SUCCESS)
 		return rc;
 	EMIT_PROGRESS();
@@ -897,7 +994,7 @@ static dc_status_t write_ostc4_settings(dc_device_t *device, DeviceDetails *m_de
 	return rc;
 }
 
-static dc_status_t read_ostc3_settings(dc_device_t *device, DeviceDetails *m_deviceDetails, dc_event_callback_t progress_cb, void *userdata)
+static dc_status_t read_ostc3_settings(dc_device_t *device, DeviceDetails *m_deviceDetails, DeviceConfig &config, dc_event_callback_t progress_cb, void *userdata)
 {
 	dc_status_t rc;
 	dc_event_progress_t progress;
@@ -919,7 +1016,7 @@ static dc_status_t read_ostc3_settings(dc_device_t *device, DeviceDetails *m_dev
 	}
 
 	if (m_deviceDetails->model == "OSTC 4")
-		return read_ostc4_settings(device, m_deviceDetails, progress_cb, userdata);
+		return read_ostc4_settings(device, m_deviceDetails, config, progress_cb, userdata);
 
 	EMIT_PROGRESS();
 
@@ -931,7 +1028,7 @@ static dc_status_t read_ostc3_settings(dc_device_t *device, DeviceDetails *m_dev
 	gas gas5;
 	unsigned char gasData[4] = { 0, 0, 0, 0 };
 
-	rc = hw_ostc3_device_config_read(device, OSTC3_GAS1, gasData, sizeof(gasData));
+	rc = ostc3_config_read(device, config, OSTC3_GAS1, gasData, sizeof(gasData));
 	if (rc != DC_STATUS_SUCCESS)
 		return rc;
 	gas1.oxygen = gasData[0];
@@ -940,7 +1037,7 @@ static dc_status_t read_ostc3_settings(dc_device_t *device, DeviceDetails *m_dev
 	gas1.depth = gasData[3];
 	EMIT_PROGRESS();
 
-	rc = hw_ostc3_device_config_read(device, OSTC3_GAS2, gasData, sizeof(gasData));
+	rc = ostc3_config_read(device, config, OSTC3_GAS2, gasData, sizeof(gasData));
 	if (rc != DC_STATUS_SUCCESS)
 		return rc;
 	gas2.oxygen = gasData[0];
@@ -949,7 +1046,7 @@ static dc_status_t read_ostc3_settings(dc_device_t *device, DeviceDetails *m_dev
 	gas2.depth = gasData[3];
 	EMIT_PROGRESS();
 
-	rc = hw_ostc3_device_config_read(device, OSTC3_GAS3, gasData, sizeof(gasData));
+	rc = ostc3_config_read(device, config, OSTC3_GAS3, gasData, sizeof(gasData));
 	if (rc != DC_STATUS_SUCCESS)
 		return rc;
 	gas3.oxygen = gasData[0];
@@ -958,7 +1055,7 @@ static dc_status_t read_ostc3_settings(dc_device_t *device, DeviceDetails *m_dev
 	gas3.depth = gasData[3];
 	EMIT_PROGRESS();
 
-	rc = hw_ostc3_device_config_read(device, OSTC3_GAS4, gasData, sizeof(gasData));
+	rc = ostc3_config_read(device, config, OSTC3_GAS4, gasData, sizeof(gasData));
 	if (rc != DC_STATUS_SUCCESS)
 		return rc;
 	gas4.oxygen = gasData[0];
@@ -967,7 +1064,7 @@ static dc_status_t read_ostc3_settings(dc_device_t *device, DeviceDetails *m_dev
 	gas4.depth = gasData[3];
 	EMIT_PROGRESS();
 
-	rc = hw_ostc3_device_config_read(device, OSTC3_GAS5, gasData, sizeof(gasData));
+	rc = ostc3_config_read(device, config, OSTC3_GAS5, gasData, sizeof(gasData));
 	if (rc != DC_STATUS_SUCCESS)
 		return rc;
 	gas5.oxygen = gasData[0];
@@ -991,7 +1088,7 @@ static dc_status_t read_ostc3_settings(dc_device_t *device, DeviceDetails *m_dev
 	gas dil5;
 	unsigned char dilData[4] = { 0, 0, 0, 0 };
 
-	rc = hw_ostc3_device_config_read(device, OSTC3_DIL1, dilData, sizeof(dilData));
+	rc = ostc3_config_read(device, config, OSTC3_DIL1, dilData, sizeof(dilData));
 	if (rc != DC_STATUS_SUCCESS)
 		return rc;
 	dil1.oxygen = dilData[0];
@@ -1000,7 +1097,7 @@ static dc_status_t read_ostc3_settings(dc_device_t *device, DeviceDetails *m_dev
 	dil1.depth = dilData[3];
 	EMIT_PROGRESS();
 
-	rc = hw_ostc3_device_config_read(device, OSTC3_DIL2, dilData, sizeof(dilData));
+	rc = ostc3_config_read(device, config, OSTC3_DIL2, dilData, sizeof(dilData));
 	if (rc != DC_STATUS_SUCCESS)
 		return rc;
 	dil2.oxygen = dilData[0];
@@ -1009,7 +1106,7 @@ static dc_status_t read_ostc3_settings(dc_device_t *device, DeviceDetails *m_dev
 	dil2.depth = dilData[3];
 	EMIT_PROGRESS();
 
-	rc = hw_ostc3_device_config_read(device, OSTC3_DIL3, dilData, sizeof(dilData));
+	rc = ostc3_config_read(device, config, OSTC3_DIL3, dilData, sizeof(dilData));
 	if (rc != DC_STATUS_SUCCESS)
 		return rc;
 	dil3.oxygen = dilData[0];
@@ -1018,7 +1115,7 @@ static dc_status_t read_ostc3_settings(dc_device_t *device, DeviceDetails *m_dev
 	dil3.depth = dilData[3];
 	EMIT_PROGRESS();
 
-	rc = hw_ostc3_device_config_read(device, OSTC3_DIL4, dilData, sizeof(dilData));
+	rc = ostc3_config_read(device, config, OSTC3_DIL4, dilData, sizeof(dilData));
 	if (rc != DC_STATUS_SUCCESS)
 		return rc;
 	dil4.oxygen = dilData[0];
@@ -1027,7 +1124,7 @@ static dc_status_t read_ostc3_settings(dc_device_t *device, DeviceDetails *m_dev
 	dil4.depth = dilData[3];
 	EMIT_PROGRESS();
 
-	rc = hw_ostc3_device_config_read(device, OSTC3_DIL5, dilData, sizeof(dilData));
+	rc = ostc3_config_read(device, config, OSTC3_DIL5, dilData, sizeof(dilData));
 	if (rc != DC_STATUS_SUCCESS)
 		return rc;
 	dil5.oxygen = dilData[0];
@@ -1050,35 +1147,35 @@ static dc_status_t read_ostc3_settings(dc_device_t *device, DeviceDetails *m_dev
 	setpoint sp5;
 	unsigned char spData[2] = { 0, 0 };
 
-	rc = hw_ostc3_device_config_read(device, OSTC3_SP1, spData, sizeof(spData));
+	rc = ostc3_config_read(device, config, OSTC3_SP1, spData, sizeof(spData));
 	if (rc != DC_STATUS_SUCCESS)
 		return rc;
 	sp1.sp = spData[0];
 	sp1.depth = spData[1];
 	EMIT_PROGRESS();
 
-	rc = hw_ostc3_device_config_read(device, OSTC3_SP2, spData, sizeof(spData));
+	rc = ostc3_config_read(device, config, OSTC3_SP2, spData, sizeof(spData));
 	if (rc != DC_STATUS_SUCCESS)
 		return rc;
 	sp2.sp = spData[0];
 	sp2.depth = spData[1];
 	EMIT_PROGRESS();
 
-	rc = hw_ostc3_device_config_read(device, OSTC3_SP3, spData, sizeof(spData));
+	rc = ostc3_config_read(device, config, OSTC3_SP3, spData, sizeof(spData));
 	if (rc != DC_STATUS_SUCCESS)
 		return rc;
 	sp3.sp = spData[0];
 	sp3.depth = spData[1];
 	EMIT_PROGRESS();
 
-	rc = hw_ostc3_device_config_read(device, OSTC3_SP4, spData, sizeof(spData));
+	rc = ostc3_config_read(device, config, OSTC3_SP4, spData, sizeof(spData));
 	if (rc != DC_STATUS_SUCCESS)
 		return rc;
 	sp4.sp = spData[0];
 	sp4.depth = spData[1];
 	EMIT_PROGRESS();
 
-	rc = hw_ostc3_device_config_read(device, OSTC3_SP5, spData, sizeof(spData));
+	rc = ostc3_config_read(device, config, OSTC3_SP5, spData, sizeof(spData));
 	if (rc != DC_STATUS_SUCCESS)
 		return rc;
 	sp5.sp = spData[0];
@@ -1096,7 +1193,7 @@ static dc_status_t read_ostc3_settings(dc_device_t *device, DeviceDetails *m_dev
 
 #define READ_SETTING(_OSTC3_SETTING, _DEVICE_DETAIL)                                            \
 	do {                                                                                    \
-		rc = hw_ostc3_device_config_read(device, _OSTC3_SETTING, uData, sizeof(uData)); \
+		rc = ostc3_config_read(device, config, _OSTC3_SETTING, uData, sizeof(uData)); \
 		if (rc != DC_STATUS_SUCCESS)                                                    \
 			return rc;                                                              \
 		m_deviceDetails->_DEVICE_DETAIL = uData[0];                                     \
@@ -1143,14 +1240,14 @@ static dc_status_t read_ostc3_settings(dc_device_t *device, DeviceDetails *m_dev
 
 #undef READ_SETTING
 
-	rc = hw_ostc3_device_config_read(device, OSTC3_PRESSURE_SENSOR_OFFSET, uData, sizeof(uData));
+	rc = ostc3_config_read(device, config, OSTC3_PRESSURE_SENSOR_OFFSET, uData, sizeof(uData));
 	if (rc != DC_STATUS_SUCCESS)
 		return rc;
 	// OSTC3 stores the pressureSensorOffset in two-complement
 	m_deviceDetails->pressureSensorOffset = (signed char)uData[0];
 	EMIT_PROGRESS();
 
-	rc = hw_ostc3_device_config_read(device, OSTC3_TEMP_SENSOR_OFFSET, uData, sizeof(uData));
+	rc = ostc3_config_read(device, config, OSTC3_TEMP_SENSOR_OFFSET, uData, sizeof(uData));
 	if (rc != DC_STATUS_SUCCESS)
 		return rc;
 	// OSTC3 stores the tempSensorOffset in two-complement
@@ -1167,12 +1264,13 @@ static dc_status_t read_ostc3_settings(dc_device_t *device, DeviceDetails *m_dev
 	m_deviceDetails->firmwareVersion = QString::number(fData[2]) + "." + QString::number(fData[3]);
 	QByteArray ar((char *)fData + 4, 60);
 	m_deviceDetails->customText = ar.trimmed();
+	config.customText = m_deviceDetails->customText;
 	EMIT_PROGRESS();
 
 	return rc;
 }
 
-static dc_status_t write_ostc3_settings(dc_device_t *device, DeviceDetails *m_deviceDetails, dc_event_callback_t progress_cb, void *userdata)
+static dc_status_t write_ostc3_settings(dc_device_t *device, DeviceDetails *m_deviceDetails, DeviceConfig &config, dc_event_callback_t progress_cb, void *userdata)
 {
 	dc_status_t rc;
 	dc_event_progress_t progress;
@@ -1215,27 +1313,27 @@ static dc_status_t write_ostc3_settings(dc_device_t *device, DeviceDetails *m_de
 		m_deviceDetails->gas5.depth
 	};
 	//gas 1
-	rc = hw_ostc3_device_config_write(device, OSTC3_GAS1, gas1Data, sizeof(gas1Data));
+	rc = ostc3_config_write(device, config, OSTC3_GAS1, gas1Data, sizeof(gas1Data));
 	if (rc != DC_STATUS_SUCCESS)
 		return rc;
 	EMIT_PROGRESS();
 	//gas 2
-	rc = hw_ostc3_device_config_write(device, OSTC3_GAS2, gas2Data, sizeof(gas2Data));
+	rc = ostc3_config_write(device, config, OSTC3_GAS2, gas2Data, sizeof(gas2Data));
 	if (rc != DC_STATUS_SUCCESS)
 		return rc;
 	EMIT_PROGRESS();
 	//gas 3
-	rc = hw_ostc3_device_config_write(device, OSTC3_GAS3, gas3Data, sizeof(gas3Data));
+	rc = ostc3_config_write(device, config, OSTC3_GAS3, gas3Data, sizeof(gas3Data));
 	if (rc != DC_STATUS_SUCCESS)
 		return rc;
 	EMIT_PROGRESS();
 	//gas 4
-	rc = hw_ostc3_device_config_write(device, OSTC3_GAS4, gas4Data, sizeof(gas4Data));
+	rc = ostc3_config_write(device, config, OSTC3_GAS4, gas4Data, sizeof(gas4Data));
 	if (rc != DC_STATUS_SUCCESS)
 		return rc;
 	EMIT_PROGRESS();
 	//gas 5
-	rc = hw_ostc3_device_config_write(device, OSTC3_GAS5, gas5Data, sizeof(gas5Data));
+	rc = ostc3_config_write(device, config, OSTC3_GAS5, gas5Data, sizeof(gas5Data));
 	if (rc != DC_STATUS_SUCCESS)
 		return rc;
 	EMIT_PROGRESS();
@@ -1267,27 +1365,27 @@ static dc_status_t write_ostc3_settings(dc_device_t *device, DeviceDetails *m_de
 	};
 
 	//sp 1
-	rc = hw_ostc3_device_config_write(device, OSTC3_SP1, sp1Data, sizeof(sp1Data));
+	rc = ostc3_config_write(device, config, OSTC3_SP1, sp1Data, sizeof(sp1Data));
 	if (rc != DC_STATUS_SUCCESS)
 		return rc;
 	EMIT_PROGRESS();
 	//sp 2
-	rc = hw_ostc3_device_config_write(device, OSTC3_SP2, sp2Data, sizeof(sp2Data));
+	rc = ostc3_config_write(device, config, OSTC3_SP2, sp2Data, sizeof(sp2Data));
 	if (rc != DC_STATUS_SUCCESS)
 		return rc;
 	EMIT_PROGRESS();
 	//sp 3
-	rc = hw_ostc3_device_config_write(device, OSTC3_SP3, sp3Data, sizeof(sp3Data));
+	rc = ostc3_config_write(device, config, OSTC3_SP3, sp3Data, sizeof(sp3Data));
 	if (rc != DC_STATUS_SUCCESS)
 		return rc;
 	EMIT_PROGRESS();
 	//sp 4
-	rc = hw_ostc3_device_config_write(device, OSTC3_SP4, sp4Data, sizeof(sp4Data));
+	rc = ostc3_config_write(device, config, OSTC3_SP4, sp4Data, sizeof(sp4Data));
 	if (rc != DC_STATUS_SUCCESS)
 		return rc;
 	EMIT_PROGRESS();
 	//sp 5
-	rc = hw_ostc3_device_config_write(device, OSTC3_SP5, sp5Data, sizeof(sp5Data));
+	rc = ostc3_config_write(device, config, OSTC3_SP5, sp5Data, sizeof(sp5Data));
 	if (rc != DC_STATUS_SUCCESS)
 		return rc;
 	EMIT_PROGRESS();
@@ -1328,34 +1426,34 @@ static dc_status_t write_ostc3_settings(dc_device_t *device, DeviceDetails *m_de
 		m_deviceDetails->dil5.depth
 	};
 	//dil 1
-	rc = hw_ostc3_device_config_write(device, OSTC3_DIL1, dil1Data, sizeof(gas1Data));
+	rc = ostc3_config_write(device, config, OSTC3_DIL1, dil1Data, sizeof(gas1Data));
 	if (rc != DC_STATUS_SUCCESS)
 		return rc;
 	EMIT_PROGRESS();
 	//dil 2
-	rc = hw_ostc3_device_config_write(device, OSTC3_DIL2, dil2Data, sizeof(dil2Data));
+	rc = ostc3_config_write(device, config, OSTC3_DIL2, dil2Data, sizeof(dil2Data));
 	if (rc != DC_STATUS_SUCCESS)
 		return rc;
 	EMIT_PROGRESS();
 	//dil 3
-	rc = hw_ostc3_device_config_write(device, OSTC3_DIL3, dil3Data, sizeof(dil3Data));
+	rc = ostc3_config_write(device, config, OSTC3_DIL3, dil3Data, sizeof(dil3Data));
 	if (rc != DC_STATUS_SUCCESS)
 		return rc;
 	EMIT_PROGRESS();
 	//dil 4
-	rc = hw_ostc3_device_config_write(device, OSTC3_DIL4, dil4Data, sizeof(dil4Data));
+	rc = ostc3_config_write(device, config, OSTC3_DIL4, dil4Data, sizeof(dil4Data));
 	if (rc != DC_STATUS_SUCCESS)
 		return rc;
 	EMIT_PROGRESS();
 	//dil 5
-	rc = hw_ostc3_device_config_write(device, OSTC3_DIL5, dil5Data, sizeof(dil5Data));
+	rc = ostc3_config_write(device, config, OSTC3_DIL5, dil5Data, sizeof(dil5Data));
 	if (rc != DC_STATUS_SUCCESS)
 		return rc;
 	EMIT_PROGRESS();
 
 	//write general settings
 	//custom text
-	rc = hw_ostc3_device_customtext(device, qPrintable(m_deviceDetails->customText));
+	rc = ostc3_customtext(device, config, m_deviceDetails->customText);
 	if (rc != DC_STATUS_SUCCESS)
 		return rc;
 
@@ -1363,7 +1461,7 @@ static dc_status_t write_ostc3_settings(dc_device_t *device, DeviceDetails *m_de
 #define WRITE_SETTING(_OSTC3_SETTING, _DEVICE_DETAIL)                                          \
 	do {                                                                                   \
 		data[0] = m_deviceDetails->_DEVICE_DETAIL;                                     \
-		rc = hw_ostc3_device_config_write(device, _OSTC3_SETTING, data, sizeof(data)); \
+		rc = ostc3_config_write(device, config, _OSTC3_SETTING, data, sizeof(data)); \
 		if (rc != DC_STATUS_SUCCESS)                                                   \
 			return rc;                                                             \
 		EMIT_PROGRESS();                                                               \
@@ -1411,14 +1509,14 @@ static dc_status_t write_ostc3_settings(dc_device_t *device, DeviceDetails *m_de
 
 	// OSTC3 stores the pressureSensorOffset in two-complement
 	data[0] = (unsigned char)m_deviceDetails->pressureSensorOffset;
-	rc = hw_ostc3_device_config_write(device, OSTC3_PRESSURE_SENSOR_OFFSET, data, sizeof(data));
+	rc = ostc3_config_write(device, config, OSTC3_PRESSURE_SENSOR_OFFSET, data, sizeof(data));
 	if (rc != DC_STATUS_SUCCESS)
 		return rc;
 	EMIT_PROGRESS();
 
 	// OSTC3 stores the tempSensorOffset in two-complement
 	data[0] = (unsigned char)m_deviceDetails->tempSensorOffset;
-	rc = hw_ostc3_device_config_write(device, OSTC3_TEMP_SENSOR_OFFSET, data, sizeof(data));
+	rc = ostc3_config_write(device, config, OSTC3_TEMP_SENSOR_OFFSET, data, sizeof(data));
 	if (rc != DC_STATUS_SUCCESS)
 		return rc;
 	EMIT_PROGRESS();
@@ -1756,6 +1854,14 @@ static dc_status_t read_ostc_settings(dc_device_t *device, DeviceDetails *m_devi
 	return rc;
 }
 
+// Every bank is read before it is written, only those with changes are written back
+static dc_status_t ostc_eeprom_write_changed(dc_device_t *device, unsigned char bank, unsigned char data[], const unsigned char original[], unsigned int size)
+{
+	if (!memcmp(data, original, size))
+		return DC_STATUS_SUCCESS;
+	return hw_ostc_device_eeprom_write(device, bank, data, size);
+}
+
 static dc_status_t write_ostc_settings(dc_device_t *device, DeviceDetails *m_deviceDetails, dc_event_callback_t progress_cb, void *userdata)
 {
 	dc_status_t rc;
@@ -1763,6 +1869,7 @@ static dc_status_t write_ostc_settings(dc_device_t *device, DeviceDetails *m_dev
 	progress.current = 0;
 	progress.maximum = 7;
 	unsigned char data[256] = {};
+	unsigned char original[256];
 	unsigned char max_CF = 0;
 
 	// Because we write whole memory blocks, we read all the current
@@ -1770,6 +1877,7 @@ static dc_status_t write_ostc_settings(dc_device_t *device, DeviceDetails *m_dev
 	rc = hw_ostc_device_eeprom_read(device, 0, data, sizeof(data));
 	if (rc != DC_STATUS_SUCCESS)
 		return rc;
+	memcpy(original, data, sizeof(data));
 	EMIT_PROGRESS();
 	//Byte5-6:
 	//Gas 1 default (%O2=21, %He=0)
@@ -1985,7 +2093,7 @@ static dc_status_t write_ostc_settings(dc_device_t *device, DeviceDetails *m_dev
 	for (int cf = 0; cf <= 31 && cf <= max_CF; cf++)
 		printf("CF %d: %d\n", cf, read_ostc_cf(data, cf));
 #endif
-	rc = hw_ostc_device_eeprom_write(device, 0, data, sizeof(data));
+	rc = ostc_eeprom_write_changed(device, 0, data, original, sizeof(data));
 	if (rc != DC_STATUS_SUCCESS)
 		return rc;
 	EMIT_PROGRESS();
@@ -1993,6 +2101,7 @@ static dc_status_t write_ostc_settings(dc_device_t *device, DeviceDetails *m_dev
 	rc = hw_ostc_device_eeprom_read(device, 1, data, sizeof(data));
 	if (rc != DC_STATUS_SUCCESS)
 		return rc;
+	memcpy(original, data, sizeof(data));
 	EMIT_PROGRESS();
 	// Byte1:
 	// Logbook version indicator (Not writable!)
@@ -2022,7 +2131,7 @@ static dc_status_t write_ostc_settings(dc_device_t *device, DeviceDetails *m_dev
 	for (int cf = 32; cf <= 63 && cf <= max_CF; cf++)
 		printf("CF %d: %d\n", cf, read_ostc_cf(data, cf));
 #endif
-	rc = hw_ostc_device_eeprom_write(device, 1, data, sizeof(data));
+	rc = ostc_eeprom_write_changed(device, 1, data, original, sizeof(data));
 	if (rc != DC_STATUS_SUCCESS)
 		return rc;
 	EMIT_PROGRESS();
@@ -2030,6 +2139,7 @@ static dc_status_t write_ostc_settings(dc_device_t *device, DeviceDetails *m_dev
 	rc = hw_ostc_device_eeprom_read(device, 2, data, sizeof(data));
 	if (rc != DC_STATUS_SUCCESS)
 		return rc;
+	memcpy(original, data, sizeof(data));
 	EMIT_PROGRESS();
 	// Byte1-4:
 	// not used/reserved (Not writable!)
@@ -2063,7 +2173,7 @@ static dc_status_t write_ostc_settings(dc_device_t *device, DeviceDetails *m_dev
 	for (int cf = 64; cf <= 95 && cf <= max_CF; cf++)
 		printf("CF %d: %d\n", cf, read_ostc_cf(data, cf));
 #endif
-	rc = hw_ostc_device_eeprom_write(device, 2, data, sizeof(data));
+	rc = ostc_eeprom_write_changed(device, 2, data, original, sizeof(data));
 	if (rc != DC_STATUS_SUCCESS)
 		return rc;
 	EMIT_PROGRESS();
@@ -2118,12 +2228,14 @@ ReadSettingsThread::ReadSettingsThread(QObject *parent, device_data_t *data) : D
 void ReadSettingsThread::run()
 {
 	dc_status_t rc;
+	DeviceConfig config;
 
 	DeviceDetails *m_deviceDetails = new DeviceDetails(0);
 	switch (dc_device_get_type(m_data->device)) {
 	case DC_FAMILY_SUUNTO_VYPER:
-		rc = read_suunto_vyper_settings(m_data->device, m_deviceDetails, DeviceThread::event_cb, this);
+		rc = read_suunto_vyper_settings(m_data->device, m_deviceDetails, config, DeviceThread::event_cb, this);
 		if (rc == DC_STATUS_SUCCESS) {
+			storeDeviceConfig(m_deviceDetails, config);
 			emit devicedetails(m_deviceDetails);
 		} else if (rc == DC_STATUS_UNSUPPORTED) {
 			emit error(tr("This feature is not yet available for the selected dive computer."));
@@ -2132,11 +2244,13 @@ void ReadSettingsThread::run()
 		}
 		break;
 	case DC_FAMILY_HW_OSTC3:
-		rc = read_ostc3_settings(m_data->device, m_deviceDetails, DeviceThread::event_cb, this);
-		if (rc == DC_STATUS_SUCCESS)
+		rc = read_ostc3_settings(m_data->device, m_deviceDetails, config, DeviceThread::event_cb, this);
+		if (rc == DC_STATUS_SUCCESS) {
+			storeDeviceConfig(m_deviceDetails, config);
 			emit devicedetails(m_deviceDetails);
-		else
+		} else {
 			emit error(tr("Failed!"));
+		}
 		break;
 
 #ifdef DEBUG_OSTC
@@ -2169,10 +2283,13 @@ void WriteSettingsThread::setDeviceDetails(DeviceDetails *details)
 void WriteSettingsThread::run()
 {
 	dc_status_t rc;
+	// Also after a failure, the values that were written are known
+	DeviceConfig config = knownDeviceConfig(m_deviceDetails);
 
 	switch (dc_device_get_type(m_data->device)) {
 	case DC_FAMILY_SUUNTO_VYPER:
-		rc = write_suunto_vyper_settings(m_data->device, m_deviceDetails, DeviceThread::event_cb, this);
+		rc = write_suunto_vyper_settings(m_data->device, m_deviceDetails, config, DeviceThread::event_cb, this);
+		storeDeviceConfig(m_deviceDetails, config);
 		if (rc == DC_STATUS_UNSUPPORTED) {
 			emit error(tr("This feature is not yet available for the selected dive computer."));
 		} else if (rc != DC_STATUS_SUCCESS) {
@@ -2182,9 +2299,10 @@ void WriteSettingsThread::run()
 	case DC_FAMILY_HW_OSTC3:
 		// Is this the best way?
 		if (m_deviceDetails->model == "OSTC 4")
-			rc = write_ostc4_settings(m_data->device, m_deviceDetails, DeviceThread::event_cb, this);
+			rc = write_ostc4_settings(m_data->device, m_deviceDetails, config, DeviceThread::event_cb, this);
 		else
-			rc = write_ostc3_settings(m_data->device, m_deviceDetails, DeviceThread::event_cb, this);
+			rc = write_ostc3_settings(m_data->device, m_deviceDetails, config, DeviceThread::event_cb, this);
+		storeDeviceConfig(m_deviceDetails, config);
 		if (rc != DC_STATUS_SUCCESS)
 			emit error(tr("Failed!"));
 		break;
@@ -2216,6 +2334,7 @@ void FirmwareUpdateThread::run()
 		emit error("Error registering the event handler.");
 		return;
 	}
+	forgetDeviceConfigs();
 	switch (dc_device_get_type(m_data->device)) {
 	case DC_FAMILY_HW_OSTC3:
 		rc = hw_ostc3_device_fwupdate(m_data->device, qPrintable(m_fileName));
@@ -2244,6 +2363,7 @@ void ResetSettingsThread::run()
 
 	if (dc_device_get_type(m_data->device) == DC_FAMILY_HW_OSTC3) {
 		rc = hw_ostc3_device_config_reset(m_data->device);
+		forgetDeviceConfigs();
 		emit progress(100);
 	}
 	if (rc != DC_STATUS_SUCCESS) {
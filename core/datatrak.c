@@ -702,8 +702,7 @@ int datatrak_import(struct memblock *mem, struct memblock *wl_mem, struct dive_t
 		int compl_dives_n = wlog_header_parser(wl_mem);
 		if (compl_dives_n != numdives) {
 			report_error("ERROR: Not the same number of dives in .log %d and .add file %d.\nWill not parse .add file", numdives , compl_dives_n);
-			free(wl_mem->buffer);
-			wl_mem->buffer = NULL;
+			free_memblock(wl_mem);
 			wl_mem = NULL;
 		}
 	}
@@ -289,11 +289,24 @@ double tissue_tolerance_calc(struct deco_state *ds, const struct dive *dive, dou
 	return ret_tolerance_limit_ambient_pressure;
 }
 
+/*
+ * Saturation factors of the periods up to FACTOR_CACHE_PERIODS seconds,
+ * filled on first use. A factor of a positive period is never 0.0, so
+ * every entry is its own "not yet calculated" flag. Since calculating
+ * an entry always gives the same result, threads that happen to fill
+ * the same entry concurrently don't step on each other's toes.
+ */
+#define FACTOR_CACHE_PERIODS 600
+static double n2_factor_cache[FACTOR_CACHE_PERIODS + 1][16];
+static double he_factor_cache[FACTOR_CACHE_PERIODS + 1][16];
+
 /*
  * Return Buehlmann factor for a particular period and tissue index.
  */
 static double factor(int period_in_seconds, int ci, enum gas_component gas)
 {
+	double *cached;
+
 	if (period_in_seconds == 1) {
 		if (gas == N2)
 			return buehlmann_N2_factor_expositon_one_second[ci];
@@ -301,11 +314,24 @@ static double factor(int period_in_seconds, int ci, enum gas_component gas)
 			return buehlmann_He_factor_expositon_one_second[ci];
 	}
 
+	if (period_in_seconds <= 0 || period_in_seconds > FACTOR_CACHE_PERIODS)
+		cached = NULL;
+	else if (gas == N2)
+		cached = &n2_factor_cache[period_in_seconds][ci];
+	else
+		cached = &he_factor_cache[period_in_seconds][ci];
+	if (cached && *cached != 0.0)
+		return *cached;
+
 	// ln(2)/60 = 1.155245301e-02
+	double res;
 	if (gas == N2)
-		return 1.0 - exp(-period_in_seconds * 1.155245301e-02 / buehlmann_N2_t_halflife[ci]);
+		res = 1.0 - exp(-period_in_seconds * 1.155245301e-02 / buehlmann_N2_t_halflife[ci]);
 	else
-		return 1.0 - exp(-period_in_seconds * 1.155245301e-02 / buehlmann_He_t_halflife[ci]);
+		res = 1.0 - exp(-period_in_seconds * 1.155245301e-02 / buehlmann_He_t_halflife[ci]);
+	if (cached)
+		*cached = res;
+	return res;
 }
 
 static double calc_surface_phase(double surface_pressure, double he_pressure, double n2_pressure, double he_time_constant, double n2_time_constant)
@@ -450,26 +476,42 @@ void add_segment(struct deco_state *ds, double pressure, struct gasmix gasmix, i
 	int ci;
 	struct gas_pressures pressures;
 	bool icd = false;
+	double satmult = buehlmann_config.satmult;
+	double desatmult = buehlmann_config.desatmult;
 	fill_pressures(&pressures, pressure - ((in_planner() && (decoMode() == VPMB)) ? WV_PRESSURE_SCHREINER : WV_PRESSURE),
 		       gasmix, (double) ccpo2 / 1000.0, divemode);
 
+	// add_segment() is mostly called with the same period over and over
+	// again, so only recalculate the factors if the period changed.
+	// A zeroed state is consistent, since the factors for 0s are 0.0.
+	if (period_in_seconds != ds->factor_period) {
+		for (ci = 0; ci < 16; ci++) {
+			ds->n2_factor[ci] = factor(period_in_seconds, ci, N2);
+			ds->he_factor[ci] = factor(period_in_seconds, ci, HE);
+		}
+		ds->factor_period = period_in_seconds;
+	}
+
+	// Report ICD if N2 is more on-gasing than He off-gasing in leading tissue
+	ci = ds->ci_pointing_to_guiding_tissue;
+	if (ci >= 0 && ci < 16) {
+		double pn2_oversat = pressures.n2 - ds->tissue_n2_sat[ci];
+		double phe_oversat = pressures.he - ds->tissue_he_sat[ci];
+
+		icd = pn2_oversat > 0.0 && phe_oversat < 0.0 &&
+		      pn2_oversat * satmult * ds->n2_factor[ci] + phe_oversat * desatmult * ds->he_factor[ci] > 0;
+	}
+
+	// No branches and no calls, so that the compiler can vectorize this loop
 	for (ci = 0; ci < 16; ci++) {
 		double pn2_oversat = pressures.n2 - ds->tissue_n2_sat[ci];
 		double phe_oversat = pressures.he - ds->tissue_he_sat[ci];
-		double n2_f = factor(period_in_seconds, ci, N2);
-		double he_f = factor(period_in_seconds, ci, HE);
-		double n2_satmult = pn2_oversat > 0 ? buehlmann_config.satmult : buehlmann_config.desatmult;
-		double he_satmult = phe_oversat > 0 ? buehlmann_config.satmult : buehlmann_config.desatmult;
-
-		// Report ICD if N2 is more on-gasing than He off-gasing in leading tissue
-		if (ci == ds->ci_pointing_to_guiding_tissue && pn2_oversat > 0.0 && phe_oversat < 0.0 &&
-		    pn2_oversat * n2_satmult * n2_f + phe_oversat * he_satmult * he_f > 0)
-			icd = true;
-
-		ds->tissue_n2_sat[ci] += n2_satmult * pn2_oversat * n2_f;
-		ds->tissue_he_sat[ci] += he_satmult * phe_oversat * he_f;
-		ds->tissue_inertgas_saturation[ci] = ds->tissue_n2_sat[ci] + ds->tissue_he_sat[ci];
+		double n2_satmult = pn2_oversat > 0 ? satmult : desatmult;
+		double he_satmult = phe_oversat > 0 ? satmult : desatmult;
 
+		ds->tissue_n2_sat[ci] += n2_satmult * pn2_oversat * ds->n2_factor[ci];
+		ds->tissue_he_sat[ci] += he_satmult * phe_oversat * ds->he_factor[ci];
+		ds->tissue_inertgas_saturation[ci] = ds->tissue_n2_sat[ci] + ds->tissue_he_sat[ci];
 	}
 	if (decoMode() == VPMB)
 		calc_crushing_pressure(ds, pressure);
@@ -577,6 +619,15 @@ void set_gf(short gflow, short gfhigh)
 		buehlmann_config.gf_high = (double)gfhigh / 100.0;
 }
 
+void get_deco_settings(struct deco_settings *settings)
+{
+	settings->vpmb = decoMode() == VPMB;
+	settings->planner = in_planner();
+	settings->conservatism = vpmb_config.conservatism;
+	settings->satmult = buehlmann_config.satmult;
+	settings->desatmult = buehlmann_config.desatmult;
+}
+
 void set_vpmb_conservatism(short conservatism)
 {
 	if (conservatism < 0)
@@ -45,10 +45,25 @@ struct deco_state {
 	long sumx, sumxx;
 	double sumy, sumxy;
 	int plot_depth;
+
+	// Saturation factors of the last period passed to add_segment()
+	int factor_period;
+	double n2_factor[16];
+	double he_factor[16];
 };
 
 extern const double buehlmann_N2_t_halflife[];
 
+// The global settings that add_segment() and clear_deco() depend on,
+// for callers that keep deco states around between calculations.
+struct deco_settings {
+	bool vpmb;
+	bool planner;
+	short conservatism;
+	double satmult, desatmult;
+};
+extern void get_deco_settings(struct deco_settings *settings);
+
 extern int deco_allowed_depth(double tissues_tolerance, double surface_pressure, const struct dive *dive, bool smooth);
 
 double get_gf(struct deco_state *ds, double ambpressure_bar, const struct dive *dive);
@@ -0,0 +1,53 @@
+// SPDX-License-Identifier: GPL-2.0
+#include "decochain.h"
+#include "divelist.h"
+#include "dive.h"
+#include <QHash>
+#include <QMutex>
+
+struct DecoChainEntry {
+	deco_chain_key key;
+	unsigned int serial;
+	deco_state ds;
+};
+
+static QHash<int, DecoChainEntry> decoChain;
+static QMutex lock;
+static unsigned int lastSerial = 0;
+
+static bool sameSettings(const deco_settings &a, const deco_settings &b)
+{
+	return a.vpmb == b.vpmb && a.planner == b.planner && a.conservatism == b.conservatism &&
+	       a.satmult == b.satmult && a.desatmult == b.desatmult;
+}
+
+static bool sameKey(const deco_chain_key &a, const deco_chain_key &b)
+{
+	return a.fingerprint == b.fingerprint && a.trip == b.trip && a.divemode == b.divemode &&
+	       sameSettings(a.settings, b.settings) && a.prev_id == b.prev_id && a.prev_serial == b.prev_serial;
+}
+
+extern "C" unsigned int get_cached_deco_chain_state(int dive_id, const struct deco_chain_key *key, struct deco_state *ds)
+{
+	QMutexLocker l(&lock);
+	auto it = decoChain.find(dive_id);
+	if (it == decoChain.end() || !sameKey(it->key, *key))
+		return 0;
+	*ds = it->ds;
+	return it->serial;
+}
+
+extern "C" unsigned int cache_deco_chain_state(int dive_id, const struct deco_chain_key *key, const struct deco_state *ds)
+{
+	QMutexLocker l(&lock);
+
+	// Entries of deleted dives are never looked up again. Instead of
+	// tracking deletions, start from scratch once there are too many.
+	if (decoChain.size() > 2 * dive_table.nr + 100 && !decoChain.contains(dive_id))
+		decoChain.clear();
+
+	if (++lastSerial == 0)
+		++lastSerial;
+	decoChain[dive_id] = { *key, lastSerial, *ds };
+	return lastSerial;
+}
@@ -0,0 +1,40 @@
+// SPDX-License-Identifier: GPL-2.0
+#ifndef DECOCHAIN_H
+#define DECOCHAIN_H
+
+// Cache of the tissue states at the end of dives, as calculated by
+// init_decompression() when walking the previous dives of a dive.
+// Every state is linked to the state of the previous dive it was
+// calculated from, so that changing a dive implicitly invalidates
+// the states of all following dives. Access is thread safe.
+
+#include "deco.h"
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct dive_trip;
+
+struct deco_chain_key {
+	uint64_t fingerprint;		// of the dive data that the tissues depend on
+	const struct dive_trip *trip;	// only dives of this trip are considered, if set
+	enum divemode_t divemode;	// dive mode used for the surface intervals
+	struct deco_settings settings;
+	int prev_id;			// previous dive of the chain, 0 if none
+	unsigned int prev_serial;	// serial of the state of the previous dive
+};
+
+// If a state matching key is cached for the dive, copy it to ds and
+// return its serial. Otherwise return 0 and leave ds untouched.
+extern unsigned int get_cached_deco_chain_state(int dive_id, const struct deco_chain_key *key, struct deco_state *ds);
+
+// Cache the state at the end of the dive and return its serial.
+extern unsigned int cache_deco_chain_state(int dive_id, const struct deco_chain_key *key, const struct deco_state *ds);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -19,9 +19,14 @@ bool device::operator==(const device &a) const
 	       nickName == a.nickName;
 }
 
+static bool same_device(const device &dev, uint32_t deviceId, const char *model)
+{
+	return dev.deviceId == deviceId && strcoll(dev.model.c_str(), model) == 0;
+}
+
 static bool same_device(const device &dev1, const device &dev2)
 {
-	return dev1.deviceId == dev2.deviceId && strcoll(dev1.model.c_str(), dev2.model.c_str()) == 0;
+	return same_device(dev1, dev2.deviceId, dev2.model.c_str());
 }
 
 bool device::operator<(const device &a) const
@@ -34,18 +39,33 @@ bool device::operator<(const device &a) const
 	return strcoll(model.c_str(), a.model.c_str()) < 0;
 }
 
+// The index of the first device that is not before (deviceId, model) in the sort order of
+// device::operator<. This is called for every dive computer of every loaded dive, therefore
+// the model string is compared in place instead of creating a device to search for.
+static size_t device_index(const std::vector<device> &dcs, uint32_t deviceId, const char *model)
+{
+	auto it = std::lower_bound(dcs.begin(), dcs.end(), deviceId,
+				   [model](const device &dev, uint32_t id) {
+		if (dev.deviceId != id)
+			return dev.deviceId < id;
+		return strcoll(dev.model.c_str(), model) < 0;
+	});
+	return it - dcs.begin();
+}
+
 extern "C" const struct device *get_device_for_dc(const struct device_table *table, const struct divecomputer *dc)
 {
 	const std::vector<device> &dcs = table->devices;
-	device dev { dc->model, dc->deviceid, {}, {}, {} };
-	auto it = std::lower_bound(dcs.begin(), dcs.end(), dev);
-	return it != dcs.end() && same_device(*it, dev) ? &*it : NULL;
+	const char *model = dc->model ?: "";
+	size_t idx = device_index(dcs, dc->deviceid, model);
+	return idx < dcs.size() && same_device(dcs[idx], dc->deviceid, model) ? &dcs[idx] : NULL;
 }
 
 extern "C" bool device_exists(const struct device_table *device_table, const struct device *dev)
 {
-	auto it = std::lower_bound(device_table->devices.begin(), device_table->devices.end(), *dev);
-	return it != device_table->devices.end() && same_device(*it, *dev);
+	const std::vector<device> &dcs = device_table->devices;
+	size_t idx = device_index(dcs, dev->deviceId, dev->model.c_str());
+	return idx < dcs.size() && same_device(dcs[idx], *dev);
 }
 
 /*
@@ -91,9 +111,8 @@ static void addDC(std::vector<device> &dcs, const std::string &m, uint32_t d, co
 {
 	if (m.empty() || d == 0)
 		return;
-	device dev { m, d, {}, {}, {} };
-	auto it = std::lower_bound(dcs.begin(), dcs.end(), dev);
-	if (it != dcs.end() && same_device(*it, dev)) {
+	auto it = dcs.begin() + device_index(dcs, d, m.c_str());
+	if (it != dcs.end() && same_device(*it, d, m.c_str())) {
 		// debugging: show changes
 		if (verbose)
 			it->showchanges(n, s, f);
@@ -23,6 +23,7 @@ struct plot_info {
 	double maxpp;
 	struct plot_data *entry;
 	struct plot_pressure_data *pressures; /* cylinders.nr blocks of nr entries. */
+	struct plot_tissue_data *tissues; /* nr entries, NULL if no deco information was calculated. */
 };
 
 extern struct divecomputer *select_dc(struct dive *);
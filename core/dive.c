@@ -5,6 +5,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <limits.h>
+#include <stdatomic.h>
 #include "dive.h"
 #include "gettext.h"
 #include "subsurface-string.h"
@@ -24,6 +25,8 @@
 #include "trip.h"
 #include "structured_list.h"
 #include "fulltext.h"
+#include "parallel.h"
+#include "tablesnapshot.h"
 
 /* one could argue about the best place to have this variable -
  * it's used in the UI, but it seems to make the most sense to have it
@@ -159,11 +162,11 @@ struct gasmix get_gasmix_from_event(const struct dive *dive, const struct event
 
 // we need this to be uniq. oh, and it has no meaning whatsoever
 // - that's why we have the silly initial number and increment by 3 :-)
+/* Dives are allocated by importers running in parallel */
 int dive_getUniqID()
 {
-	static int maxId = 83529;
-	maxId += 3;
-	return maxId;
+	static atomic_int maxId = 83529;
+	return atomic_fetch_add(&maxId, 3) + 3;
 }
 
 struct dive *alloc_dive(void)
@@ -178,13 +181,6 @@ struct dive *alloc_dive(void)
 	return dive;
 }
 
-/* copy an element in a list of dive computer extra data */
-static void copy_extra_data(struct extra_data *sed, struct extra_data *ded)
-{
-	ded->key = copy_string(sed->key);
-	ded->value = copy_string(sed->value);
-}
-
 /* this is very different from the copy_divecomputer later in this file;
  * this function actually makes full copies of the content */
 static void copy_dc(const struct divecomputer *sdc, struct divecomputer *ddc)
@@ -195,7 +191,7 @@ static void copy_dc(const struct divecomputer *sdc, struct divecomputer *ddc)
 	ddc->fw_version = copy_string(sdc->fw_version);
 	copy_samples(sdc, ddc);
 	copy_events(sdc, ddc);
-	STRUCTURED_LIST_COPY(struct extra_data, sdc->extra_data, ddc->extra_data, copy_extra_data);
+	copy_extra_data(sdc, ddc);
 }
 
 static void dc_cylinder_renumber(struct dive *dive, struct divecomputer *dc, const int mapping[]);
@@ -238,12 +234,25 @@ static void free_dive_structures(struct dive *d)
 	free(d->pictures.pictures);
 }
 
-void free_dive(struct dive *d)
+static void free_dive_now(void *d)
 {
 	free_dive_structures(d);
 	free(d);
 }
 
+/* A dive removed from the table might still be used by a worker
+ * through a table snapshot. Only the full text index, which belongs
+ * to the UI thread, forgets it right away. */
+void free_dive(struct dive *d)
+{
+	if (!d)
+		return;
+	fulltext_unregister(d);
+	if (defer_free_for_snapshots(&free_dive_now, d))
+		return;
+	free_dive_now(d);
+}
+
 /* copy_dive makes duplicates of many components of a dive;
  * in order not to leak memory, we need to free those .
  * copy_dive doesn't play with the divetrip and forward/backward pointers
@@ -476,14 +485,14 @@ static bool has_unknown_used_cylinders(const struct dive *dive, const struct div
 	}
 
 	/* And we have possible switches to other gases */
-	ev = get_next_event(dc->events, "gaschange");
+	ev = get_next_event(dc->events, EVENT_NAME_GASCHANGE);
 	while (ev && num > 0) {
 		idx = get_cylinder_index(dive, ev);
 		if (idx >= 0 && used_and_unknown[idx]) {
 			used_and_unknown[idx] = false;
 			num--;
 		}
-		ev = get_next_event(ev->next, "gaschange");
+		ev = get_next_event(ev->next, EVENT_NAME_GASCHANGE);
 	}
 
 	free(used_and_unknown);
@@ -543,7 +552,7 @@ void per_cylinder_mean_depth(const struct dive *dive, struct divecomputer *dc, i
 	free(used_cylinders);
 	if (!dc->samples)
 		fake_dc(dc);
-	const struct event *ev = get_next_event(dc->events, "gaschange");
+	const struct event *ev = get_next_event(dc->events, EVENT_NAME_GASCHANGE);
 	depthtime = malloc(dive->cylinders.nr * sizeof(*depthtime));
 	memset(depthtime, 0, dive->cylinders.nr * sizeof(*depthtime));
 	for (i = 0; i < dc->samples; i++) {
@@ -554,7 +563,7 @@ void per_cylinder_mean_depth(const struct dive *dive, struct divecomputer *dc, i
 		/* Make sure to move the event past 'lasttime' */
 		while (ev && lasttime >= ev->time.seconds) {
 			idx = get_cylinder_index(dive, ev);
-			ev = get_next_event(ev->next, "gaschange");
+			ev = get_next_event(ev->next, EVENT_NAME_GASCHANGE);
 		}
 
 		/* Do we need to fake a midway sample at an event? */
@@ -613,7 +622,7 @@ int explicit_first_cylinder(const struct dive *dive, const struct divecomputer *
 	if (!dive->cylinders.nr)
 		return -1;
 	if (dc) {
-		const struct event *ev = get_next_event(dc->events, "gaschange");
+		const struct event *ev = get_next_event(dc->events, EVENT_NAME_GASCHANGE);
 		if (ev && ((dc->sample && ev->time.seconds == dc->sample[0].time.seconds) || ev->time.seconds <= 1))
 			res = get_cylinder_index(dive, ev);
 		else if (dc->divemode == CCR)
@@ -642,16 +651,16 @@ void update_setpoint_events(const struct dive *dive, struct divecomputer *dc)
 		// by mistake when it's actually CCR is _bad_
 		// So we make sure, this comes from a Predator or Petrel and we only remove
 		// pO2 values we would have computed anyway.
-		const struct event *ev = get_next_event(dc->events, "gaschange");
+		const struct event *ev = get_next_event(dc->events, EVENT_NAME_GASCHANGE);
 		struct gasmix gasmix = get_gasmix_from_event(dive, ev);
-		const struct event *next = get_next_event(ev, "gaschange");
+		const struct event *next = get_next_event(ev, EVENT_NAME_GASCHANGE);
 
 		for (int i = 0; i < dc->samples; i++) {
 			struct gas_pressures pressures;
 			if (next && dc->sample[i].time.seconds >= next->time.seconds) {
 				ev = next;
 				gasmix = get_gasmix_from_event(dive, ev);
-				next = get_next_event(ev, "gaschange");
+				next = get_next_event(ev, EVENT_NAME_GASCHANGE);
 			}
 			fill_pressures(&pressures, calculate_depth_to_mbar(dc->sample[i].depth.mm, dc->surface_pressure, 0), gasmix ,0, dc->divemode);
 			if (abs(dc->sample[i].setpoint.mbar - (int)(1000 * pressures.o2)) <= 50)
@@ -662,7 +671,7 @@ void update_setpoint_events(const struct dive *dive, struct divecomputer *dc)
 	// an "SP change" event at t=0 is currently our marker for OC vs CCR
 	// this will need to change to a saner setup, but for now we can just
 	// check if such an event is there and adjust it, or add that event
-	ev = get_next_event_mutable(dc->events, "SP change");
+	ev = get_next_event_mutable(dc->events, EVENT_NAME_SP_CHANGE);
 	if (ev && ev->time.seconds == 0) {
 		ev->value = new_setpoint;
 	} else {
@@ -760,11 +769,11 @@ static void sanitize_cylinder_info(struct dive *dive)
 /* some events should never be thrown away */
 static bool is_potentially_redundant(const struct event *event)
 {
-	if (!strcmp(event->name, "gaschange"))
+	if (event->name_id == EVENT_NAME_GASCHANGE)
 		return false;
-	if (!strcmp(event->name, "bookmark"))
+	if (event->name_id == EVENT_NAME_BOOKMARK)
 		return false;
-	if (!strcmp(event->name, "heading"))
+	if (event->name_id == EVENT_NAME_HEADING)
 		return false;
 	return true;
 }
@@ -775,10 +784,10 @@ static struct event *find_previous_event(struct divecomputer *dc, struct event *
 	struct event *ev = dc->events;
 	struct event *previous = NULL;
 
-	if (empty_string(event->name))
+	if (event->name_id == EVENT_NAME_NONE)
 		return NULL;
 	while (ev && ev != event) {
-		if (same_string(ev->name, event->name))
+		if (ev->name_id == event->name_id)
 			previous = ev;
 		ev = ev->next;
 	}
@@ -932,36 +941,91 @@ static void fixup_dc_events(struct divecomputer *dc)
 	}
 }
 
-static int interpolate_depth(struct divecomputer *dc, int idx, int lastdepth, int lasttime, int now)
+/*
+ * Interpolate the depth of a sample without valid depth. "next" is the index
+ * of the next sample with a valid depth, or dc->samples if there is none.
+ */
+static int interpolate_depth(struct divecomputer *dc, int next, int lastdepth, int lasttime, int now)
 {
-	int i;
 	int nextdepth = lastdepth;
 	int nexttime = now;
 
-	for (i = idx+1; i < dc->samples; i++) {
-		struct sample *sample = dc->sample + i;
-		if (sample->depth.mm < 0)
-			continue;
-		nextdepth = sample->depth.mm;
-		nexttime = sample->time.seconds;
-		break;
+	if (next < dc->samples) {
+		nextdepth = dc->sample[next].depth.mm;
+		nexttime = dc->sample[next].time.seconds;
 	}
 	return interpolate(lastdepth, nextdepth, now-lasttime, nexttime-lasttime);
 }
 
-static void fixup_dc_depths(struct dive *dive, struct divecomputer *dc)
+/* Do we need a sensor -> cylinder mapping? */
+static void fixup_start_pressure(struct dive *dive, int idx, pressure_t p)
 {
-	int i;
+	if (idx >= 0 && idx < dive->cylinders.nr) {
+		cylinder_t *cyl = get_cylinder(dive, idx);
+		if (p.mbar && !cyl->sample_start.mbar)
+			cyl->sample_start = p;
+	}
+}
+
+static void fixup_end_pressure(struct dive *dive, int idx, pressure_t p)
+{
+	if (idx >= 0 && idx < dive->cylinders.nr) {
+		cylinder_t *cyl = get_cylinder(dive, idx);
+		if (p.mbar && !cyl->sample_end.mbar)
+			cyl->sample_end = p;
+	}
+}
+
+/*
+ * Fix up the samples of a divecomputer in a single pass over them:
+ *  - interpolate the depths of samples without valid depth
+ *    and update the maximum depth and CNS,
+ *  - mark the NDL of the samples before the first one with NDL as unknown,
+ *  - throw away consecutive identical temperature readings
+ *    and update the temperatures,
+ *  - fill in the overall cylinder pressures from the pressure samples
+ *    and remove the redundant pressure information.
+ *
+ * We ignore surface samples for tank pressure information.
+ *
+ * At the beginning of the dive, let the cylinder cool down
+ * if the diver starts off at the surface. And at the end
+ * of the dive, there may be surface pressures where the
+ * diver has already turned off the air supply (especially
+ * for computers like the Uemis Zurich that end up saving
+ * quite a bit of samples after the dive has ended).
+ * The start and end pressures are taken before the
+ * redundant pressures are removed.
+ */
+static void fixup_dc_samples(struct dive *dive, struct divecomputer *dc)
+{
+	int i, j;
 	int maxdepth = dc->maxdepth.mm;
 	int lasttime = 0, lastdepth = 0;
+	int next = 0;
+	bool ndl_seen = false;
+	int mintemp = 0, lasttemp = 0;
+	int lastindex[MAX_SENSORS] = { -1, -1 };
+	int lastpressure[MAX_SENSORS] = { 0 };
+	/* the last pressure at depth, indexed by sensor id */
+	pressure_t end_pressure[256] = { 0 };
 
 	for (i = 0; i < dc->samples; i++) {
 		struct sample *sample = dc->sample + i;
 		int time = sample->time.seconds;
 		int depth = sample->depth.mm;
+		int temp = sample->temperature.mkelvin;
 
 		if (depth < 0) {
-			depth = interpolate_depth(dc, i, lastdepth, lasttime, time);
+			/* Remember the next valid sample, so that runs of
+			 * invalid samples are not rescanned for every sample */
+			if (next <= i) {
+				for (next = i + 1; next < dc->samples; next++) {
+					if (dc->sample[next].depth.mm >= 0)
+						break;
+				}
+			}
+			depth = interpolate_depth(dc, next, lastdepth, lasttime, time);
 			sample->depth.mm = depth;
 		}
 
@@ -974,34 +1038,13 @@ static void fixup_dc_depths(struct dive *dive, struct divecomputer *dc)
 		lasttime = time;
 		if (sample->cns > dive->maxcns)
 			dive->maxcns = sample->cns;
-	}
-
-	update_depth(&dc->maxdepth, maxdepth);
-	if (maxdepth > dive->maxdepth.mm)
-		dive->maxdepth.mm = maxdepth;
-}
-
-static void fixup_dc_ndl(struct divecomputer *dc)
-{
-	int i;
 
-	for (i = 0; i < dc->samples; i++) {
-		struct sample *sample = dc->sample + i;
-		if (sample->ndl.seconds != 0)
-			break;
-		if (sample->ndl.seconds == 0)
-			sample->ndl.seconds = -1;
-	}
-}
-
-static void fixup_dc_temp(struct dive *dive, struct divecomputer *dc)
-{
-	int i;
-	int mintemp = 0, lasttemp = 0;
-
-	for (i = 0; i < dc->samples; i++) {
-		struct sample *sample = dc->sample + i;
-		int temp = sample->temperature.mkelvin;
+		if (!ndl_seen) {
+			if (sample->ndl.seconds != 0)
+				ndl_seen = true;
+			else
+				sample->ndl.seconds = -1;
+		}
 
 		if (temp) {
 			/*
@@ -1017,23 +1060,17 @@ static void fixup_dc_temp(struct dive *dive, struct divecomputer *dc)
 			if (!mintemp || temp < mintemp)
 				mintemp = temp;
 		}
-
 		update_min_max_temperatures(dive, sample->temperature);
-	}
-	update_temperature(&dc->watertemp, mintemp);
-	update_min_max_temperatures(dive, dc->watertemp);
-}
 
-/* Remove redundant pressure information */
-static void simplify_dc_pressures(struct divecomputer *dc)
-{
-	int i;
-	int lastindex[2] = { -1, -1 };
-	int lastpressure[2] = { 0 };
-
-	for (i = 0; i < dc->samples; i++) {
-		int j;
-		struct sample *sample = dc->sample + i;
+		if (depth >= SURFACE_THRESHOLD) {
+			for (j = 0; j < MAX_SENSORS; j++)
+				fixup_start_pressure(dive, sample->sensor[j], sample->pressure[j]);
+			/* Within a sample, the first sensor wins for the end pressure as well */
+			for (j = MAX_SENSORS - 1; j >= 0; j--) {
+				if (sample->pressure[j].mbar)
+					end_pressure[sample->sensor[j]] = sample->pressure[j];
+			}
+		}
 
 		for (j = 0; j < MAX_SENSORS; j++) {
 			int pressure = sample->pressure[j].mbar;
@@ -1048,69 +1085,16 @@ static void simplify_dc_pressures(struct divecomputer *dc)
 			lastpressure[j] = pressure;
 		}
 	}
-}
-
-/* Do we need a sensor -> cylinder mapping? */
-static void fixup_start_pressure(struct dive *dive, int idx, pressure_t p)
-{
-	if (idx >= 0 && idx < dive->cylinders.nr) {
-		cylinder_t *cyl = get_cylinder(dive, idx);
-		if (p.mbar && !cyl->sample_start.mbar)
-			cyl->sample_start = p;
-	}
-}
-
-static void fixup_end_pressure(struct dive *dive, int idx, pressure_t p)
-{
-	if (idx >= 0 && idx < dive->cylinders.nr) {
-		cylinder_t *cyl = get_cylinder(dive, idx);
-		if (p.mbar && !cyl->sample_end.mbar)
-			cyl->sample_end = p;
-	}
-}
-
-/*
- * Check the cylinder pressure sample information and fill in the
- * overall cylinder pressures from those.
- *
- * We ignore surface samples for tank pressure information.
- *
- * At the beginning of the dive, let the cylinder cool down
- * if the diver starts off at the surface. And at the end
- * of the dive, there may be surface pressures where the
- * diver has already turned off the air supply (especially
- * for computers like the Uemis Zurich that end up saving
- * quite a bit of samples after the dive has ended).
- */
-static void fixup_dive_pressures(struct dive *dive, struct divecomputer *dc)
-{
-	int i;
-
-	/* Walk the samples from the beginning to find starting pressures.. */
-	for (i = 0; i < dc->samples; i++) {
-		int idx;
-		struct sample *sample = dc->sample + i;
-
-		if (sample->depth.mm < SURFACE_THRESHOLD)
-			continue;
-
-		for (idx = 0; idx < MAX_SENSORS; idx++)
-			fixup_start_pressure(dive, sample->sensor[idx], sample->pressure[idx]);
-	}
 
-	/* ..and from the end for ending pressures */
-	for (i = dc->samples; --i >= 0; ) {
-		int idx;
-		struct sample *sample = dc->sample + i;
-
-		if (sample->depth.mm < SURFACE_THRESHOLD)
-			continue;
+	update_depth(&dc->maxdepth, maxdepth);
+	if (maxdepth > dive->maxdepth.mm)
+		dive->maxdepth.mm = maxdepth;
 
-		for (idx = 0; idx < MAX_SENSORS; idx++)
-			fixup_end_pressure(dive, sample->sensor[idx], sample->pressure[idx]);
-	}
+	update_temperature(&dc->watertemp, mintemp);
+	update_min_max_temperatures(dive, dc->watertemp);
 
-	simplify_dc_pressures(dc);
+	for (i = 0; i < dive->cylinders.nr && i < 256; i++)
+		fixup_end_pressure(dive, i, end_pressure[i]);
 }
 
 /*
@@ -1209,28 +1193,23 @@ static void fixup_dive_dc(struct dive *dive, struct divecomputer *dc)
 	/* Fixup duration and mean depth */
 	fixup_dc_duration(dc);
 
-	/* Fix up sample depth data */
-	fixup_dc_depths(dive, dc);
-
-	/* Fix up first sample ndl data */
-	fixup_dc_ndl(dc);
-
-	/* Fix up dive temperatures based on dive computer samples */
-	fixup_dc_temp(dive, dc);
+	/* Fix up sample depth, ndl, temperature and pressure data */
+	fixup_dc_samples(dive, dc);
 
 	/* Fix up gas switch events */
 	fixup_dc_gasswitch(dive, dc);
 
-	/* Fix up cylinder pressures based on DC info */
-	fixup_dive_pressures(dive, dc);
-
 	fixup_dc_events(dc);
 
 	/* Fixup CCR / PSCR dives with o2sensor values, but without no_o2sensors */
 	fixup_no_o2sensors(dc);
 }
 
-struct dive *fixup_dive(struct dive *dive)
+/*
+ * The part of fixup_dive() that only touches the dive itself
+ * and can therefore be done for many dives in parallel.
+ */
+static void fixup_dive_data(struct dive *dive)
 {
 	int i;
 	struct divecomputer *dc;
@@ -1257,12 +1236,23 @@ struct dive *fixup_dive(struct dive *dive)
 	fixup_airtemp(dive);
 	for (i = 0; i < dive->cylinders.nr; i++) {
 		cylinder_t *cyl = get_cylinder(dive, i);
-		add_cylinder_description(&cyl->type);
 		if (same_rounded_pressure(cyl->sample_start, cyl->start))
 			cyl->start.mbar = 0;
 		if (same_rounded_pressure(cyl->sample_end, cyl->end))
 			cyl->end.mbar = 0;
 	}
+}
+
+/*
+ * The part of fixup_dive() that registers the equipment of the dive
+ * in the global tables and that may look at other dives (for the CNS).
+ */
+static void fixup_dive_shared(struct dive *dive)
+{
+	int i;
+
+	for (i = 0; i < dive->cylinders.nr; i++)
+		add_cylinder_description(&get_cylinder(dive, i)->type);
 	update_cylinder_related_info(dive);
 	for (i = 0; i < dive->weightsystems.nr; i++) {
 		weightsystem_t *ws = &dive->weightsystems.weightsystems[i];
@@ -1272,10 +1262,38 @@ struct dive *fixup_dive(struct dive *dive)
 	 * but we want to make sure... */
 	if (!dive->id)
 		dive->id = dive_getUniqID();
+}
 
+struct dive *fixup_dive(struct dive *dive)
+{
+	fixup_dive_data(dive);
+	fixup_dive_shared(dive);
 	return dive;
 }
 
+struct fixup_dives_data {
+	struct dive_table *table;
+	int first;
+};
+
+static void fixup_one_dive_data(int idx, void *_data)
+{
+	struct fixup_dives_data *data = _data;
+	fixup_dive_data(data->table->dives[data->first + idx]);
+}
+
+/* Same as calling fixup_dive() for all dives of the table from index first on */
+void fixup_dives(struct dive_table *table, int first)
+{
+	struct fixup_dives_data data = { table, first };
+
+	if (first >= table->nr)
+		return;
+	parallel_for(table->nr - first, fixup_one_dive_data, &data);
+	for (int i = first; i < table->nr; i++)
+		fixup_dive_shared(table->dives[i]);
+}
+
 /* Don't pick a zero for MERGE_MIN() */
 #define MERGE_MAX(res, a, b, n) res->n = MAX(a->n, b->n)
 #define MERGE_MIN(res, a, b, n) res->n = (a->n) ? (b->n) ? MIN(a->n, b->n) : (a->n) : (b->n)
@@ -1351,6 +1369,11 @@ static void merge_samples(struct divecomputer *res,
 		cylinders_map_b = cylinders_map_tmp;
 	}
 
+	/* Reserve room for all samples at once, only the surface samples
+	 * added between non-overlapping dives may need more */
+	if (res)
+		alloc_samples(res, res->samples + asamples + bsamples);
+
 	for (;;) {
 		int j;
 		int at, bt;
@@ -1363,8 +1386,10 @@ static void merge_samples(struct divecomputer *res,
 		bt = bsamples ? bs->time.seconds + offset : -1;
 
 		/* No samples? All done! */
-		if (at < 0 && bt < 0)
+		if (at < 0 && bt < 0) {
+			shrink_samples(res);
 			return;
+		}
 
 		/* Only samples from a? */
 		if (bt < 0) {
@@ -1442,9 +1467,8 @@ static void merge_samples(struct divecomputer *res,
  */
 static bool extra_data_exists(const struct extra_data *ed, const struct divecomputer *dc)
 {
-	const struct extra_data *p;
-
-	for (p = dc->extra_data; p; p = p->next) {
+	for (int i = 0; i < dc->nr_extra_data; i++) {
+		const struct extra_data *p = &dc->extra_data[i];
 		if (strcmp(p->key, ed->key))
 			continue;
 		if (strcmp(p->value, ed->value))
@@ -1463,25 +1487,11 @@ static bool extra_data_exists(const struct extra_data *ed, const struct divecomp
 static void merge_extra_data(struct divecomputer *res,
 			  const struct divecomputer *a, const struct divecomputer *b)
 {
-	struct extra_data **ed, *src;
-
-	// Find the place to add things in the result
-	ed = &res->extra_data;
-	while (*ed)
-		ed = &(*ed)->next;
-
-	for (src = b->extra_data; src; src = src->next) {
-		if (extra_data_exists(src, a))
-			continue;
-		*ed = malloc(sizeof(struct extra_data));
-		if (!*ed)
-			break;
-		copy_extra_data(src, *ed);
-		ed = &(*ed)->next;
+	for (int i = 0; i < b->nr_extra_data; i++) {
+		const struct extra_data *src = &b->extra_data[i];
+		if (!extra_data_exists(src, a))
+			add_extra_data(res, src->key, src->value);
 	}
-
-	// Terminate the result list
-	*ed = NULL;
 }
 
 static char *merge_text(const char *a, const char *b, const char *sep)
@@ -1636,7 +1646,7 @@ static void add_initial_gaschange(struct dive *dive, struct divecomputer *dc, in
 	/* if there is a gaschange event up to 30 sec after the initial event,
 	 * refrain from adding the initial event */
 	const struct event *ev = dc->events;
-	while(ev && (ev = get_next_event(ev, "gaschange")) != NULL) {
+	while(ev && (ev = get_next_event(ev, EVENT_NAME_GASCHANGE)) != NULL) {
 		if (ev->time.seconds > offset + 30)
 			break;
 		else if (ev->time.seconds > offset)
@@ -2437,7 +2447,7 @@ static void copy_dive_computer(struct divecomputer *res, const struct divecomput
 	res->model = copy_string(a->model);
 	res->serial = copy_string(a->serial);
 	res->fw_version = copy_string(a->fw_version);
-	STRUCTURED_LIST_COPY(struct extra_data, a->extra_data, res->extra_data, copy_extra_data);
+	copy_extra_data(a, res);
 	res->samples = res->alloc_samples = 0;
 	res->sample = NULL;
 	res->events = NULL;
@@ -2620,8 +2630,8 @@ struct dive *merge_dives(const struct dive *a, const struct dive *b, int offset,
 	return res;
 }
 
-// copy_dive(), but retaining the new ID for the copied dive
-static struct dive *create_new_copy(const struct dive *from)
+// copy_dive_nodc(), but retaining the new ID for the copied dive
+static struct dive *create_new_copy_nodc(const struct dive *from)
 {
 	struct dive *to = alloc_dive();
 	int id;
@@ -2629,7 +2639,7 @@ static struct dive *create_new_copy(const struct dive *from)
 	// alloc_dive() gave us a new ID, we just need to
 	// make sure it's not overwritten.
 	id = to->id;
-	copy_dive(from, to);
+	copy_dive_nodc(from, to);
 	to->id = id;
 	return to;
 }
@@ -2695,13 +2705,55 @@ static void force_fixup_dive(struct dive *d)
  * Moreover, on failure both output dives are set to NULL.
  * On success, the newly allocated dives are returned in out1 and out2.
  */
+/*
+ * Copy a dive computer, but only the samples first .. first + nr - 1 and
+ * the events from time 'start' up to, but not including, time 'end'.
+ * The dive computer of the copy starts at time 'start'.
+ */
+static void copy_dc_part(const struct divecomputer *sdc, struct divecomputer *ddc, int first, int nr, int start, int end)
+{
+	const struct event *ev;
+	struct event **evp;
+	int i;
+
+	copy_dive_computer(ddc, sdc);
+	ddc->when += start;
+	if (nr > 0) {
+		ddc->sample = malloc(nr * sizeof(struct sample));
+		if (ddc->sample) {
+			memcpy(ddc->sample, sdc->sample + first, nr * sizeof(struct sample));
+			ddc->samples = ddc->alloc_samples = nr;
+			for (i = 0; i < nr; i++)
+				ddc->sample[i].time.seconds -= start;
+		}
+	}
+	evp = &ddc->events;
+	for (ev = sdc->events; ev; ev = ev->next) {
+		if (ev->time.seconds < start || ev->time.seconds >= end)
+			continue;
+		*evp = clone_event(ev);
+		(*evp)->time.seconds -= start;
+		evp = &(*evp)->next;
+	}
+	*evp = NULL;
+}
+
+/* The first sample at or after time 't' */
+static int first_sample_at(const struct divecomputer *dc, int t)
+{
+	int i = 0;
+	while (i < dc->samples && dc->sample[i].time.seconds < t)
+		++i;
+	return i;
+}
+
 static int split_dive_at(const struct dive *dive, int a, int b, struct dive **out1, struct dive **out2)
 {
-	int i, nr;
+	int nr, i;
 	uint32_t t;
 	struct dive *d1, *d2;
+	const struct divecomputer *sdc;
 	struct divecomputer *dc1, *dc2;
-	struct event *event, **evp;
 
 	/* if we can't find the dive in the dive list, don't bother */
 	if ((nr = get_divenr(dive)) < 0)
@@ -2711,9 +2763,10 @@ static int split_dive_at(const struct dive *dive, int a, int b, struct dive **ou
 	if (a < 3 || b > dive->dc.samples - 4)
 		return -1;
 
-	/* We're not trying to be efficient here.. */
-	d1 = create_new_copy(dive);
-	d2 = create_new_copy(dive);
+	/* Copy everything but the dive computers, these only get their part
+	 * of the samples and events */
+	d1 = create_new_copy_nodc(dive);
+	d2 = create_new_copy_nodc(dive);
 	d1->divetrip = d2->divetrip = 0;
 
 	/* now unselect the first first segment so we don't keep all
@@ -2721,68 +2774,26 @@ static int split_dive_at(const struct dive *dive, int a, int b, struct dive **ou
 	 * so the algorithm keeps splitting the dive further */
 	d1->selected = false;
 
-	dc1 = &d1->dc;
-	dc2 = &d2->dc;
 	/*
-	 * Cut off the samples of d1 at the beginning
-	 * of the interval.
+	 * The samples of d1 end at the beginning of the interval, the ones
+	 * of d2 start with sample 'b'. Everything in d2 is shifted by the
+	 * time of that sample. The secondary dive computers are split at that time.
 	 */
-	dc1->samples = a;
-
-	/* And get rid of the 'b' first samples of d2 */
-	dc2->samples -= b;
-	memmove(dc2->sample, dc2->sample+b, dc2->samples * sizeof(struct sample));
-
-	/* Now the secondary dive computers */
-	t = dc2->sample[0].time.seconds;
-	while ((dc1 = dc1->next))	{
-		i = 0;
-		while (dc1->samples < i && dc1->sample[i].time.seconds <= t)
-			++i;
-		dc1->samples = i;
-	}
-	while ((dc2 = dc2->next)) {
-		i = 0;
-		while (dc2->samples < i && dc2->sample[i].time.seconds < t)
-			++i;
-		dc2->samples -= i;
-		memmove(dc2->sample, dc2->sample + i, dc2->samples * sizeof(struct sample));
-	}
+	t = dive->dc.sample[b].time.seconds;
+	d2->when += t;
+	copy_dc_part(&dive->dc, &d1->dc, 0, a, 0, t);
+	copy_dc_part(&dive->dc, &d2->dc, b, dive->dc.samples - b, t, INT_MAX);
 	dc1 = &d1->dc;
 	dc2 = &d2->dc;
-	/*
-	 * This is where we cut off events from d1,
-	 * and shift everything in d2
-	 */
-	d2->when += t;
-	while (dc1 && dc2) {
-		dc2->when += t;
-		for (i = 0; i < dc2->samples; i++)
-			dc2->sample[i].time.seconds -= t;
-
-		/* Remove the events past 't' from d1 */
-		evp = &dc1->events;
-		while ((event = *evp) != NULL && event->time.seconds < t)
-			evp = &event->next;
-		*evp = NULL;
-		while (event) {
-			struct event *next = event->next;
-			free(event);
-			event = next;
-		}
-
-		/* Remove the events before 't' from d2, and shift the rest */
-		evp = &dc2->events;
-		while ((event = *evp) != NULL) {
-			if (event->time.seconds < t) {
-				*evp = event->next;
-				free(event);
-			} else {
-				event->time.seconds -= t;
-			}
-		}
+	for (sdc = dive->dc.next; sdc; sdc = sdc->next) {
+		i = first_sample_at(sdc, t);
+		dc1->next = calloc(1, sizeof(struct divecomputer));
+		dc2->next = calloc(1, sizeof(struct divecomputer));
 		dc1 = dc1->next;
 		dc2 = dc2->next;
+		/* Keep a sample at exactly the split time in both parts */
+		copy_dc_part(sdc, dc1, 0, i < sdc->samples && sdc->sample[i].time.seconds == (int)t ? i + 1 : i, 0, t);
+		copy_dc_part(sdc, dc2, i, sdc->samples - i, t, INT_MAX);
 	}
 
 	force_fixup_dive(d1);
@@ -3042,30 +3053,27 @@ struct dive *make_first_dc(const struct dive *d, int dc_number)
 	return res;
 }
 
-static void delete_divecomputer(struct dive *d, int num)
+/* Copy a dive without dive computer num. The samples and events of the
+ * deleted dive computer aren't copied in the first place. Refuses to
+ * delete the last dive computer */
+static void copy_dive_delete_dc(const struct dive *s, struct dive *d, int num)
 {
+	const struct divecomputer *sdc;
+	struct divecomputer *ddc = NULL;
 	int i;
 
-	/* Refuse to delete the last dive computer */
-	if (!d->dc.next)
-		return;
-
-	if (num == 0) {
-		/* remove the first one, so copy the second one in place of the first and free the second one
-		 * be careful about freeing the no longer needed structures - since we copy things around we can't use free_dc()*/
-		struct divecomputer *fdc = d->dc.next;
-		free_dc_contents(&d->dc);
-		memcpy(&d->dc, fdc, sizeof(struct divecomputer));
-		free(fdc);
-	} else {
-		struct divecomputer *pdc = &d->dc;
-		for (i = 0; i < num - 1 && pdc; i++)
-			pdc = pdc->next;
-		if (pdc && pdc->next) {
-			struct divecomputer *dc = pdc->next;
-			pdc->next = dc->next;
-			free_dc(dc);
+	copy_dive_nodc(s, d);
+	for (i = 0, sdc = &s->dc; sdc; i++, sdc = sdc->next) {
+		if (i == num && s->dc.next)
+			continue;
+		if (!ddc) {
+			ddc = &d->dc;
+		} else {
+			ddc->next = calloc(1, sizeof(struct divecomputer));
+			ddc = ddc->next;
 		}
+		copy_dc(sdc, ddc);
+		ddc->next = NULL;
 	}
 }
 
@@ -3076,13 +3084,11 @@ struct dive *clone_delete_divecomputer(const struct dive *d, int dc_number)
 
 	/* copy the dive */
 	res = alloc_dive();
-	copy_dive(d, res);
+	copy_dive_delete_dc(d, res, dc_number);
 
 	/* make a new unique id, since we still can't handle two equal ids */
 	res->id = dive_getUniqID();
 
-	delete_divecomputer(res, dc_number);
-
 	return res;
 }
 
@@ -3105,11 +3111,12 @@ void split_divecomputer(const struct dive *src, int num, struct dive **out1, str
 		(*out2)->id = 0;
 		fixup_dive(*out2);
 
-		// Copy the dive with all dive computers
-		*out1 = create_new_copy(src);
-
-		// .. and then delete the split-out dive computer
-		delete_divecomputer(*out1, num);
+		// Copy the dive with all dive computers but the split-out one,
+		// retaining the new ID like create_new_copy_nodc()
+		*out1 = alloc_dive();
+		int id = (*out1)->id;
+		copy_dive_delete_dc(src, *out1, num);
+		(*out1)->id = id;
 
 		(*out1)->divetrip = (*out2)->divetrip = NULL;
 	} else {
@@ -3316,13 +3323,7 @@ struct divecomputer *get_dive_dc(struct dive *dive, int nr)
 
 struct dive *get_dive_by_uniq_id(int id)
 {
-	int i;
-	struct dive *dive = NULL;
-
-	for_each_dive (i, dive) {
-		if (dive->id == id)
-			break;
-	}
+	struct dive *dive = get_dive(get_divenr_by_uniq_id(id));
 #ifdef DEBUG
 	if (dive == NULL) {
 		fprintf(stderr, "Invalid id %x passed to get_dive_by_diveid, try to fix the code\n", id);
@@ -3368,7 +3369,8 @@ static location_t dc_get_gps_location(const struct divecomputer *dc)
 {
 	location_t res = { };
 
-	for (struct extra_data *data = dc->extra_data; data; data = data->next) {
+	for (int i = 0; i < dc->nr_extra_data; i++) {
+		const struct extra_data *data = &dc->extra_data[i];
 		if (!strcmp(data->key, "GPS1")) {
 			parse_location(data->value, &res);
 			/* If we found a valid GPS1 field exit early since
@@ -3423,14 +3425,14 @@ struct gasmix get_gasmix(const struct dive *dive, const struct divecomputer *dc,
 		/* on first invocation, get initial gas mix and first event (if any) */
 		int cyl = explicit_first_cylinder(dive, dc);
 		res = get_cylinder(dive, cyl)->gasmix;
-		ev = dc ? get_next_event(dc->events, "gaschange") : NULL;
+		ev = dc ? get_next_event(dc->events, EVENT_NAME_GASCHANGE) : NULL;
 	} else {
 		res = gasmix;
 	}
 
 	while (ev && ev->time.seconds <= time) {
 		res = get_gasmix_from_event(dive, ev);
-		ev = get_next_event(ev->next, "gaschange");
+		ev = get_next_event(ev->next, EVENT_NAME_GASCHANGE);
 	}
 	*evp = ev;
 	return res;
@@ -3444,3 +3446,70 @@ struct gasmix get_gasmix_at_time(const struct dive *d, const struct divecomputer
 	struct gasmix gasmix = gasmix_air;
 	return get_gasmix(d, dc, time.seconds, &ev, gasmix);
 }
+
+/*
+ * Collect the gas mixes of a dive computer, so that loops over samples or
+ * plot entries don't have to walk the event list for every step.
+ * Same as for get_gasmix(), the gas changes are applied in the order of the
+ * event list up to the first one after the requested time. Therefore, the
+ * segments are keyed by the running maximum of the event times.
+ */
+void init_gas_timeline(struct gas_timeline *tl, const struct dive *dive, const struct divecomputer *dc)
+{
+	const struct event *ev;
+	int nr = 1, time = INT_MIN;
+
+	tl->pos = 0;
+	tl->nr = 1;
+	for (ev = dc ? get_next_event(dc->events, EVENT_NAME_GASCHANGE) : NULL; ev; ev = get_next_event(ev->next, EVENT_NAME_GASCHANGE))
+		nr++;
+	tl->segments = malloc(nr * sizeof(*tl->segments));
+	if (!tl->segments)
+		exit(1);
+	tl->segments[0].time = INT_MIN;
+
+	/* if there is no cylinder, it's air */
+	if (dive->cylinders.nr <= 0) {
+		tl->segments[0].gasmix = gasmix_air;
+		return;
+	}
+
+	tl->segments[0].gasmix = get_cylinder(dive, explicit_first_cylinder(dive, dc))->gasmix;
+	for (ev = dc ? get_next_event(dc->events, EVENT_NAME_GASCHANGE) : NULL; ev; ev = get_next_event(ev->next, EVENT_NAME_GASCHANGE)) {
+		time = MAX(time, (int)ev->time.seconds);
+		tl->segments[tl->nr].time = time;
+		tl->segments[tl->nr].gasmix = get_gasmix_from_event(dive, ev);
+		tl->nr++;
+	}
+}
+
+void free_gas_timeline(struct gas_timeline *tl)
+{
+	free(tl->segments);
+	tl->segments = NULL;
+	tl->nr = 0;
+}
+
+/* If there is a gasswitch at that time, it returns the new gas.
+ * Steps forward from the previous lookup, which makes increasing times cheap. */
+struct gasmix gasmix_in_timeline(struct gas_timeline *tl, int time)
+{
+	int pos = tl->pos;
+
+	if (tl->segments[pos].time > time) {
+		/* Going back in time: bisect for the last segment starting at or before "time" */
+		int lo = 0, hi = pos;
+		while (hi - lo > 1) {
+			int mid = lo + (hi - lo) / 2;
+			if (tl->segments[mid].time <= time)
+				lo = mid;
+			else
+				hi = mid;
+		}
+		pos = lo;
+	}
+	while (pos + 1 < tl->nr && tl->segments[pos + 1].time <= time)
+		pos++;
+	tl->pos = pos;
+	return tl->segments[pos].gasmix;
+}
@@ -58,6 +58,8 @@ struct dive {
 	bool selected;
 	bool hidden_by_filter;
 	struct full_text_cache *full_text; /* word cache for full text search */
+	uint64_t cns_fingerprint; /* CNS of this dive alone, see calculate_cns() */
+	double cns_of_dive;
 	bool invalid;
 };
 
@@ -176,6 +178,7 @@ extern int legacy_format_o2pressures(const struct dive *dive, const struct divec
 extern bool dive_less_than(const struct dive *a, const struct dive *b);
 extern bool dive_or_trip_less_than(struct dive_or_trip a, struct dive_or_trip b);
 extern struct dive *fixup_dive(struct dive *dive);
+extern void fixup_dives(struct dive_table *table, int first);
 extern pressure_t calculate_surface_pressure(const struct dive *dive);
 extern pressure_t un_fixup_surface_pressure(const struct dive *d);
 extern int get_dive_salinity(const struct dive *dive);
@@ -219,6 +222,24 @@ extern struct gasmix get_gasmix(const struct dive *dive, const struct divecomput
 /* Get gasmix at a given time */
 extern struct gasmix get_gasmix_at_time(const struct dive *dive, const struct divecomputer *dc, duration_t time);
 
+/* The gas mixes of a dive computer over time, for loops that need the gasmix
+ * at many points in time. Lookups at increasing times are cheapest, but any
+ * order gives the same result as get_gasmix_at_time().
+ */
+struct gas_segment {
+	int time;
+	struct gasmix gasmix;
+};
+
+struct gas_timeline {
+	int nr, pos;
+	struct gas_segment *segments;
+};
+
+extern void init_gas_timeline(struct gas_timeline *tl, const struct dive *dive, const struct divecomputer *dc);
+extern void free_gas_timeline(struct gas_timeline *tl);
+extern struct gasmix gasmix_in_timeline(struct gas_timeline *tl, int time);
+
 extern char *get_dive_date_c_string(timestamp_t when);
 extern void update_setpoint_events(const struct dive *dive, struct divecomputer *dc);
 
@@ -205,14 +205,14 @@ enum divemode_t get_current_divemode(const struct divecomputer *dc, int time, co
 	if (dc) {
 		if (*divemode == UNDEF_COMP_TYPE) {
 			*divemode = dc->divemode;
-			ev = get_next_event(dc->events, "modechange");
+			ev = get_next_event(dc->events, EVENT_NAME_MODECHANGE);
 		}
 	} else {
 		ev = NULL;
 	}
 	while (ev && ev->time.seconds < time) {
 		*divemode = (enum divemode_t) ev->value;
-		ev = get_next_event(ev->next, "modechange");
+		ev = get_next_event(ev->next, EVENT_NAME_MODECHANGE);
 	}
 	*evp = ev;
 	return *divemode;
@@ -254,6 +254,25 @@ void alloc_samples(struct divecomputer *dc, int num)
 	}
 }
 
+/* release the room reserved for further samples, once a dive is complete.
+ * This may move the sample array, so don't keep pointers to samples around. */
+void shrink_samples(struct divecomputer *dc)
+{
+	struct sample *sample;
+
+	if (dc->alloc_samples <= dc->samples)
+		return;
+	if (!dc->samples) {
+		free_samples(dc);
+		return;
+	}
+	sample = realloc(dc->sample, dc->samples * sizeof(struct sample));
+	if (!sample)
+		return;
+	dc->sample = sample;
+	dc->alloc_samples = dc->samples;
+}
+
 void free_samples(struct divecomputer *dc)
 {
 	if (dc) {
@@ -471,17 +490,40 @@ void remove_event_from_dc(struct divecomputer *dc, struct event *event)
 	}
 }
 
+/* The extra data are kept in an array, like the samples: there are only
+ * a few of them per dive computer and they are copied with every dive. */
 void add_extra_data(struct divecomputer *dc, const char *key, const char *value)
 {
-	struct extra_data **ed = &dc->extra_data;
-
-	while (*ed)
-		ed = &(*ed)->next;
-	*ed = malloc(sizeof(struct extra_data));
-	if (*ed) {
-		(*ed)->key = strdup(key);
-		(*ed)->value = strdup(value);
-		(*ed)->next = NULL;
+	struct extra_data *ed;
+
+	if (dc->nr_extra_data >= dc->alloc_extra_data) {
+		int alloc = dc->alloc_extra_data * 3 / 2 + 4;
+		ed = realloc(dc->extra_data, alloc * sizeof(struct extra_data));
+		if (!ed)
+			return;
+		dc->extra_data = ed;
+		dc->alloc_extra_data = alloc;
+	}
+	ed = &dc->extra_data[dc->nr_extra_data++];
+	ed->key = copy_string(key);
+	ed->value = copy_string(value);
+}
+
+void copy_extra_data(const struct divecomputer *s, struct divecomputer *d)
+{
+	int nr = s->nr_extra_data;
+
+	d->nr_extra_data = d->alloc_extra_data = 0;
+	d->extra_data = NULL;
+	if (!nr)
+		return;
+	d->extra_data = malloc(nr * sizeof(struct extra_data));
+	if (!d->extra_data)
+		return;
+	d->nr_extra_data = d->alloc_extra_data = nr;
+	for (int i = 0; i < nr; i++) {
+		d->extra_data[i].key = copy_string(s->extra_data[i].key);
+		d->extra_data[i].value = copy_string(s->extra_data[i].value);
 	}
 }
 
@@ -519,12 +561,6 @@ int match_one_dc(const struct divecomputer *a, const struct divecomputer *b)
 	return a->diveid == b->diveid && a->when == b->when ? 1 : -1;
 }
 
-static void free_extra_data(struct extra_data *ed)
-{
-	free((void *)ed->key);
-	free((void *)ed->value);
-}
-
 void free_dc_contents(struct divecomputer *dc)
 {
 	free(dc->sample);
@@ -532,7 +568,11 @@ void free_dc_contents(struct divecomputer *dc)
 	free((void *)dc->serial);
 	free((void *)dc->fw_version);
 	free_events(dc->events);
-	STRUCTURED_LIST_FREE(struct extra_data, dc->extra_data, free_extra_data);
+	for (int i = 0; i < dc->nr_extra_data; i++) {
+		free((void *)dc->extra_data[i].key);
+		free((void *)dc->extra_data[i].value);
+	}
+	free(dc->extra_data);
 }
 
 void free_dc(struct divecomputer *dc)
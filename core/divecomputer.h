@@ -42,6 +42,7 @@ struct divecomputer {
 	int samples, alloc_samples;
 	struct sample *sample;
 	struct event *events;
+	int nr_extra_data, alloc_extra_data;
 	struct extra_data *extra_data;
 	struct divecomputer *next;
 };
@@ -53,6 +54,7 @@ extern enum divemode_t get_current_divemode(const struct divecomputer *dc, int t
 extern int get_depth_at_time(const struct divecomputer *dc, unsigned int time);
 extern void free_dive_dcs(struct divecomputer *dc);
 extern void alloc_samples(struct divecomputer *dc, int num);
+extern void shrink_samples(struct divecomputer *dc);
 extern void free_samples(struct divecomputer *dc);
 extern struct sample *prepare_sample(struct divecomputer *dc);
 extern void finish_sample(struct divecomputer *dc);
@@ -67,6 +69,7 @@ extern void add_event_to_dc(struct divecomputer *dc, struct event *ev);
 extern struct event *add_event(struct divecomputer *dc, unsigned int time, int type, int flags, int value, const char *name);
 extern void remove_event_from_dc(struct divecomputer *dc, struct event *event);
 extern void add_extra_data(struct divecomputer *dc, const char *key, const char *value);
+extern void copy_extra_data(const struct divecomputer *s, struct divecomputer *d);
 extern bool is_dc_planner(const struct divecomputer *dc);
 
 /* Check if two dive computer entries are the exact same dive (-1=no/0=maybe/1=yes) */
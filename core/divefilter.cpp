@@ -3,8 +3,10 @@
 #include "divefilter.h"
 #include "divelist.h" // for filter_dive
 #include "gettextfromc.h"
+#include "parallel.h"
 #include "qthelper.h"
 #include "subsurface-qt/divelistnotifier.h"
+#include "trace.h"
 #ifndef SUBSURFACE_MOBILE
 #include "desktop-widgets/mapwidget.h"
 #include "desktop-widgets/mainwindow.h"
@@ -38,6 +40,9 @@ ShownChange DiveFilter::update(const QVector<dive *> &dives) const
 {
 	dive *old_current = current_dive;
 
+	// The dives were changed, therefore the cached matches are stale
+	invalidateCache();
+
 	ShownChange res;
 	bool doDS = diveSiteMode();
 	bool doFullText = filterData.fullText.doit();
@@ -54,6 +59,7 @@ ShownChange DiveFilter::update(const QVector<dive *> &dives) const
 
 ShownChange DiveFilter::updateAll() const
 {
+	TraceSpan span("DiveFilter::updateAll");
 	dive *old_current = current_dive;
 
 	ShownChange res;
@@ -65,17 +71,33 @@ ShownChange DiveFilter::updateAll() const
 			bool newStatus = dive_sites.contains(d->dive_site);
 			updateDiveStatus(d, newStatus, res);
 		}
-	} else if (filterData.fullText.doit()) {
-		FullTextResult ft = fulltext_find_dives(filterData.fullText, filterData.fulltextStringMode);
-		for_each_dive(i, d) {
-			bool newStatus = ft.dive_matches(d) && showDive(d);
-			updateDiveStatus(d, newStatus, res);
-		}
 	} else {
-		for_each_dive(i, d) {
-			bool newStatus = showDive(d);
-			updateDiveStatus(d, newStatus, res);
+		// Matching the dives only reads them, so distribute that over all cores.
+		// Applying the new status changes the dives and is done on this thread.
+		bool doFullText = filterData.fullText.doit();
+		FullTextResult ft;
+		if (doFullText)
+			ft = fulltext_find_dives(filterData.fullText, filterData.fulltextStringMode);
+		if (cachedDives.size() != (size_t)dive_table.nr ||
+		    !std::equal(cachedDives.begin(), cachedDives.end(), dive_table.dives))
+			invalidateCache();
+		std::vector<const std::vector<char> *> matches;
+		if (filterData.validFilter()) {
+			for (const filter_constraint &c: filterData.constraints)
+				cacheConstraintMatches(c, filterData.constraints.size());
+			for (const filter_constraint &c: filterData.constraints)
+				matches.push_back(&findConstraintMatches(c)->matches);
 		}
+		std::vector<char> newStatus(dive_table.nr);
+		parallel_for(dive_table.nr, [doFullText, &ft, &matches, &newStatus](int idx) {
+			const dive *d = dive_table.dives[idx];
+			newStatus[idx] = (!d->invalid || prefs.display_invalid_dives) &&
+					 (!doFullText || ft.dive_matches(d)) &&
+					 std::all_of(matches.begin(), matches.end(),
+						     [idx](const std::vector<char> *m) { return (*m)[idx]; });
+		});
+		for_each_dive(i, d)
+			updateDiveStatus(d, newStatus[i], res);
 	}
 	res.currentChanged = old_current != current_dive;
 	return res;
@@ -91,6 +113,46 @@ DiveFilter::DiveFilter() : diveSiteRefCount(0)
 {
 }
 
+void DiveFilter::invalidateCache() const
+{
+	cachedDives.clear();
+	constraintCache.clear();
+}
+
+DiveFilter::ConstraintMatches *DiveFilter::findConstraintMatches(const filter_constraint &c) const
+{
+	auto it = std::find_if(constraintCache.begin(), constraintCache.end(),
+			       [&c](const ConstraintMatches &m) { return m.constraint == c; });
+	return it != constraintCache.end() ? &*it : nullptr;
+}
+
+// Remember which dives of the dive table match a constraint. Only evaluated if the constraint
+// isn't in the cache of recently used constraints. To not drop any of the constraints
+// of the current filter, at least numConstraints entries are kept.
+void DiveFilter::cacheConstraintMatches(const filter_constraint &c, size_t numConstraints) const
+{
+	static const size_t maxCachedConstraints = 16;
+
+	if (cachedDives.empty())
+		cachedDives.assign(dive_table.dives, dive_table.dives + dive_table.nr);
+
+	ConstraintMatches *cached = findConstraintMatches(c);
+	if (cached) {
+		// Move to the end, so that the least recently used constraint is dropped first
+		auto it = constraintCache.begin() + (cached - constraintCache.data());
+		std::rotate(it, it + 1, constraintCache.end());
+		return;
+	}
+
+	if (constraintCache.size() >= std::max(maxCachedConstraints, numConstraints))
+		constraintCache.erase(constraintCache.begin());
+	std::vector<char> matches(cachedDives.size());
+	parallel_for((int)cachedDives.size(), [&c, &matches, this](int idx) {
+		matches[idx] = filter_constraint_match_dive(c, cachedDives[idx]);
+	});
+	constraintCache.push_back({ c, std::move(matches) });
+}
+
 bool DiveFilter::showDive(const struct dive *d) const
 {
 	if (d->invalid && !prefs.display_invalid_dives)
@@ -50,6 +50,7 @@ public:
 	void setFilter(const FilterData &data);
 	ShownChange update(const QVector<dive *> &dives) const; // Update filter status of given dives and return dives whose status changed
 	ShownChange updateAll() const; // Update filter status of all dives and return dives whose status changed
+	void invalidateCache() const; // Call when the dives were changed without updating their filter status
 private:
 	DiveFilter();
 	bool showDive(const struct dive *d) const; // Should that dive be shown?
@@ -57,6 +58,18 @@ private:
 	QVector<dive_site *> dive_sites;
 	FilterData filterData;
 
+	// To avoid reevaluating the constraints that didn't change, updateAll() remembers
+	// which dives matched the most recently used constraints. The cache is valid
+	// for the dive table as it was in cachedDives, until the dives are changed.
+	struct ConstraintMatches {
+		filter_constraint constraint;
+		std::vector<char> matches;
+	};
+	mutable std::vector<dive *> cachedDives;
+	mutable std::vector<ConstraintMatches> constraintCache; // most recently used last
+	ConstraintMatches *findConstraintMatches(const filter_constraint &c) const;
+	void cacheConstraintMatches(const filter_constraint &c, size_t numConstraints) const;
+
 	// We use ref-counting for the dive site mode. The reason is that when switching
 	// between two tabs that both need dive site mode, the following course of
 	// events may happen:
@@ -4,6 +4,7 @@
 #include "divelist.h"
 #include "subsurface-string.h"
 #include "deco.h"
+#include "decochain.h"
 #include "device.h"
 #include "divesite.h"
 #include "dive.h"
@@ -18,6 +19,7 @@
 #include "selection.h"
 #include "sample.h"
 #include "table.h"
+#include "trace.h"
 #include "trip.h"
 
 bool autogroup = false;
@@ -79,12 +81,64 @@ int total_weight(const struct dive *dive)
 	return total_grams;
 }
 
-static int active_o2(const struct dive *dive, const struct divecomputer *dc, duration_t time)
+static int active_o2(struct gas_timeline *gases, duration_t time)
 {
-	struct gasmix gas = get_gasmix_at_time(dive, dc, time);
+	struct gasmix gas = gasmix_in_timeline(gases, time.seconds);
 	return get_o2(gas);
 }
 
+/* Mix a value into a hash, see deco_fingerprint() */
+static uint64_t hash_value(uint64_t h, int64_t value)
+{
+	h = (h ^ (uint64_t)value) * 0x9e3779b97f4a7c15u;
+	return h ^ (h >> 29);
+}
+
+/* Hash of all the data of a dive that add_dive_to_deco(), the following
+ * surface interval and calculate_cns_dive() depend on. Much cheaper than
+ * these calculations, therefore it is used to validate their cached results. */
+static uint64_t deco_fingerprint(const struct dive *dive)
+{
+	const struct divecomputer *dc = &dive->dc;
+	const struct event *ev;
+	uint64_t h = 14695981039346656037u;
+	int i;
+
+	h = hash_value(h, dive->when);
+	h = hash_value(h, dive_endtime(dive));
+	h = hash_value(h, dive->surface_pressure.mbar);
+	h = hash_value(h, dive->salinity);
+	h = hash_value(h, dc->divemode);
+	h = hash_value(h, dive->cylinders.nr);
+	for (i = 0; i < dive->cylinders.nr; i++) {
+		const cylinder_t *cyl = get_cylinder(dive, i);
+		h = hash_value(h, cyl->gasmix.o2.permille);
+		h = hash_value(h, cyl->gasmix.he.permille);
+	}
+	h = hash_value(h, dc->samples);
+	for (i = 0; i < dc->samples; i++) {
+		const struct sample *sample = dc->sample + i;
+		h = hash_value(h, sample->time.seconds);
+		h = hash_value(h, sample->depth.mm);
+		h = hash_value(h, sample->setpoint.mbar);
+		h = hash_value(h, sample->o2sensor[0].mbar);
+	}
+	for (ev = dc->events; ev; ev = ev->next) {
+		const char *p;
+		h = hash_value(h, ev->time.seconds);
+		h = hash_value(h, ev->type);
+		h = hash_value(h, ev->flags);
+		h = hash_value(h, ev->value);
+		h = hash_value(h, ev->deleted);
+		h = hash_value(h, ev->gas.index);
+		h = hash_value(h, ev->gas.mix.o2.permille);
+		h = hash_value(h, ev->gas.mix.he.permille);
+		for (p = ev->name; *p; p++)
+			h = hash_value(h, *p);
+	}
+	return h;
+}
+
 /* Calculate OTU for a dive - this only takes the first divecomputer into account.
    Implement the protocol in Erik Baker's document "Oxygen Toxicity Calculations". This code
    implements a third-order continuous approximation of Baker's Eq. 2 and enables OTU
@@ -97,6 +151,9 @@ static int calculate_otu(const struct dive *dive)
 	int i;
 	double otu = 0.0;
 	const struct divecomputer *dc = &dive->dc;
+	struct gas_timeline gases;
+
+	init_gas_timeline(&gases, dive, dc);
 	for (i = 1; i < dc->samples; i++) {
 		int t;
 		int po2i, po2f;
@@ -112,7 +169,7 @@ static int calculate_otu(const struct dive *dive)
 				po2i = psample->setpoint.mbar;		// if CCR has no o2 sensors then use setpoint
 				po2f = sample->setpoint.mbar;
 			} else {						// For OC and rebreather without o2 sensor/setpoint
-				int o2 = active_o2(dive, dc, psample->time);	// 	... calculate po2 from depth and FiO2.
+				int o2 = active_o2(&gases, psample->time);	// 	... calculate po2 from depth and FiO2.
 				po2i = lrint(o2 * depth_to_atm(psample->depth.mm, dive));	// (initial) po2 at start of segment
 				po2f = lrint(o2 * depth_to_atm(sample->depth.mm, dive));	// (final) po2 at end of segment
 			}
@@ -132,6 +189,7 @@ static int calculate_otu(const struct dive *dive)
 			otu += t / 60.0 * pow(pm, 5.0/6.0) * (1.0 - 5.0 * (po2f - po2i) * (po2f - po2i) / 216000000.0 / (pm * pm));
 		}
 	}
+	free_gas_timeline(&gases);
 	return lrint(otu);
 }
 
@@ -144,12 +202,15 @@ static int calculate_otu(const struct dive *dive)
    po2 for each segment. Empirical testing showed that, for large changes in depth, the cns calculation for the mean po2
    value is extremely close, if not identical to the additive calculations for 0.1 bar increments in po2 from the start
    to the end of the segment, assuming a constant rate of change in po2 (i.e. depth) with time. */
-static double calculate_cns_dive(const struct dive *dive)
+double calculate_cns_dive(const struct dive *dive)
 {
 	int n;
 	const struct divecomputer *dc = &dive->dc;
 	double cns = 0.0;
 	double rate;
+	struct gas_timeline gases;
+
+	init_gas_timeline(&gases, dive, dc);
 	/* Calculate the CNS for each sample in this dive and sum them */
 	for (n = 1; n < dc->samples; n++) {
 		int t;
@@ -169,7 +230,7 @@ static double calculate_cns_dive(const struct dive *dive)
 			trueo2 = true;
 		}
 		if (!trueo2) {
-			int o2 = active_o2(dive, dc, psample->time);			// For OC and rebreather without o2 sensor:
+			int o2 = active_o2(&gases, psample->time);			// For OC and rebreather without o2 sensor:
 			po2i = lrint(o2 * depth_to_atm(psample->depth.mm, dive));	// (initial) po2 at start of segment
 			po2f = lrint(o2 * depth_to_atm(sample->depth.mm, dive));	// (final) po2 at end of segment
 		}
@@ -182,9 +243,22 @@ static double calculate_cns_dive(const struct dive *dive)
 		rate = po2i <= 1500 ? exp(-11.7853 + 0.00193873 * po2i) : exp(-23.6349 + 0.00980829 * po2i);
 		cns += (double) t * rate * 100.0;
 	}
+	free_gas_timeline(&gases);
 	return cns;
 }
 
+/* The CNS of a single dive, only recalculated if the dive changed */
+static double cached_cns_dive(struct dive *dive)
+{
+	uint64_t fingerprint = deco_fingerprint(dive);
+
+	if (fingerprint != dive->cns_fingerprint) {
+		dive->cns_of_dive = calculate_cns_dive(dive);
+		dive->cns_fingerprint = fingerprint;
+	}
+	return dive->cns_of_dive;
+}
+
 /* this only gets called if dive->maxcns == 0 which means we know that
  * none of the divecomputers has tracked any CNS for us
  * so we calculated it "by hand" */
@@ -206,20 +280,9 @@ static int calculate_cns(struct dive *dive)
 	else
 		printf("\n\n*** CNS for dive #%d\n", i);
 #endif
-	/* Look at next dive in dive list table and correct i when needed */
-	while (i < dive_table.nr - 1) {
-		struct dive *pdive = get_dive(i);
-		if (!pdive || pdive->when > dive->when)
-			break;
-		i++;
-	}
-	/* Look at previous dive in dive list table and correct i when needed */
-	while (i > 0) {
-		struct dive *pdive = get_dive(i - 1);
-		if (!pdive || pdive->when < dive->when)
-			break;
-		i--;
-	}
+	/* Start at the first dive that doesn't start before this one,
+	 * even if the dive (not yet) has its place in the dive table */
+	i = first_dive_at_or_after(dive->when);
 #if DECO_CALC_DEBUG & 2
 	printf("Dive number corrected to #%d\n", i);
 #endif
@@ -289,7 +352,7 @@ static int calculate_cns(struct dive *dive)
 		printf("CNS after surface interval: %f\n", cns);
 #endif
 
-		cns += calculate_cns_dive(pdive);
+		cns += cached_cns_dive(pdive);
 #if DECO_CALC_DEBUG & 2
 		printf("CNS after previous dive: %f\n", cns);
 #endif
@@ -305,7 +368,7 @@ static int calculate_cns(struct dive *dive)
 	printf("CNS after last surface interval: %f\n", cns);
 #endif
 
-	cns += calculate_cns_dive(dive);
+	cns += cached_cns_dive(dive);
 #if DECO_CALC_DEBUG & 2
 	printf("CNS after dive: %f\n", cns);
 #endif
@@ -372,17 +435,18 @@ static int calculate_sac(const struct dive *dive)
 }
 
 /* for now we do this based on the first divecomputer */
-static void add_dive_to_deco(struct deco_state *ds, struct dive *dive)
+void add_dive_to_deco(struct deco_state *ds, struct dive *dive)
 {
 	struct divecomputer *dc = &dive->dc;
-	struct gasmix gasmix = gasmix_air;
+	struct gas_timeline gases;
 	int i;
-	const struct event *ev = NULL, *evd = NULL;
+	const struct event *evd = NULL;
 	enum divemode_t current_divemode = UNDEF_COMP_TYPE;
 
 	if (!dc)
 		return;
 
+	init_gas_timeline(&gases, dive, dc);
 	for (i = 1; i < dc->samples; i++) {
 		struct sample *psample = dc->sample + i - 1;
 		struct sample *sample = dc->sample + i;
@@ -392,24 +456,83 @@ static void add_dive_to_deco(struct deco_state *ds, struct dive *dive)
 
 		for (j = t0; j < t1; j++) {
 			int depth = interpolate(psample->depth.mm, sample->depth.mm, j - t0, t1 - t0);
-			gasmix = get_gasmix(dive, dc, j, &ev, gasmix);
+			struct gasmix gasmix = gasmix_in_timeline(&gases, j);
 			add_segment(ds, depth_to_bar(depth, dive), gasmix, 1, sample->setpoint.mbar,
 				get_current_divemode(&dive->dc, j, &evd, &current_divemode), dive->sac);
 		}
 	}
+	free_gas_timeline(&gases);
+}
+
+/*
+ * Index-of cache for the global dive table: a hash of dive ids to
+ * positions in the table. The entries are verified on lookup and the
+ * whole cache is rebuilt if it is stale. Therefore, it doesn't have to
+ * be kept up to date when dives are added, removed or resorted - at
+ * worst, the first lookup after a change costs as much as a linear scan.
+ */
+struct id_index_entry {
+	int id, idx;
+};
+static struct id_index_entry *id_index;
+static unsigned int id_index_mask;
+
+static unsigned int id_hash(int id)
+{
+	return ((unsigned int)id * 2654435761u) & id_index_mask;
+}
+
+static void rebuild_id_index(void)
+{
+	unsigned int size = 64;
+
+	while (size < 2u * dive_table.nr)
+		size *= 2;
+	if (!id_index || size != id_index_mask + 1) {
+		free(id_index);
+		id_index = malloc(size * sizeof(*id_index));
+		if (!id_index)
+			exit(1);
+		id_index_mask = size - 1;
+	}
+	memset(id_index, 0xff, size * sizeof(*id_index));
+	for (int i = 0; i < dive_table.nr; i++) {
+		unsigned int h = id_hash(dive_table.dives[i]->id);
+		while (id_index[h].idx >= 0)
+			h = (h + 1) & id_index_mask;
+		id_index[h].id = dive_table.dives[i]->id;
+		id_index[h].idx = i;
+	}
+}
+
+static int lookup_id_index(int id)
+{
+	if (!id_index)
+		return -1;
+	for (unsigned int h = id_hash(id); id_index[h].idx >= 0; h = (h + 1) & id_index_mask) {
+		if (id_index[h].id == id)
+			return id_index[h].idx;
+	}
+	return -1;
+}
+
+int get_divenr_by_uniq_id(int id)
+{
+	int idx = lookup_id_index(id);
+	if (idx >= 0 && idx < dive_table.nr && dive_table.dives[idx]->id == id)
+		return idx;
+
+	/* Not found or stale: rebuild the cache and try again */
+	rebuild_id_index();
+	idx = lookup_id_index(id);
+	return idx >= 0 && dive_table.dives[idx]->id == id ? idx : -1;
 }
 
 int get_divenr(const struct dive *dive)
 {
-	int i;
-	const struct dive *d;
 	// tempting as it may be, don't die when called with dive=NULL
-	if (dive)
-		for_each_dive(i, d) {
-			if (d->id == dive->id) // don't compare pointers, we could be passing in a copy of the dive
-				return i;
-		}
-	return -1;
+	// don't compare pointers, we could be passing in a copy of the dive
+	return dive ? get_divenr_by_uniq_id(dive->id) : -1;
 }
 
 static struct gasmix air = { .o2.permille = O2_IN_AIR, .he.permille = 0 };
@@ -419,13 +542,17 @@ static struct gasmix air = { .o2.permille = O2_IN_AIR, .he.permille = 0 };
 /* return negative surface time if dives are overlapping */
 /* The place you call this function is likely the place where you want
  * to create the deco_state */
+/* The tissues at the end of the previous dives are cached, so that only
+ * the dives starting with the first changed one have to be recalculated */
 int init_decompression(struct deco_state *ds, struct dive *dive)
 {
 	int i, divenr = -1;
 	int surface_time = 48 * 60 * 60;
 	timestamp_t last_endtime = 0, last_starttime = 0;
 	bool deco_init = false;
+	bool use_cache = true;
 	double surface_pressure;
+	struct deco_chain_key key = { 0 };
 
 	if (!dive)
 		return false;
@@ -438,20 +565,9 @@ int init_decompression(struct deco_state *ds, struct dive *dive)
 	else
 		printf("\n\n*** Init deco for dive #%d\n", i);
 #endif
-	/* Look at next dive in dive list table and correct i when needed */
-	while (i < dive_table.nr - 1) {
-		struct dive *pdive = get_dive(i);
-		if (!pdive || pdive->when > dive->when)
-			break;
-		i++;
-	}
-	/* Look at previous dive in dive list table and correct i when needed */
-	while (i > 0) {
-		struct dive *pdive = get_dive(i - 1);
-		if (!pdive || pdive->when < dive->when)
-			break;
-		i--;
-	}
+	/* Start at the first dive that doesn't start before this one,
+	 * even if the dive (not yet) has its place in the dive table */
+	i = first_dive_at_or_after(dive->when);
 #if DECO_CALC_DEBUG & 2
 	printf("Dive number corrected to #%d\n", i);
 #endif
@@ -483,6 +599,9 @@ int init_decompression(struct deco_state *ds, struct dive *dive)
 		printf("Yes\n");
 #endif
 	}
+	key.trip = dive->divetrip;
+	key.divemode = dive->dc.divemode;
+	get_deco_settings(&key.settings);
 	/* Walk forward an add dives and surface intervals to deco */
 	while (++i < dive_table.nr) {
 #if DECO_CALC_DEBUG & 2
@@ -514,6 +633,24 @@ int init_decompression(struct deco_state *ds, struct dive *dive)
 		printf("Yes\n");
 #endif
 
+		/* As long as the previous dives are unchanged, take their tissues from the cache */
+		key.fingerprint = deco_fingerprint(pdive);
+		if (use_cache) {
+			unsigned int serial = get_cached_deco_chain_state(pdive->id, &key, ds);
+			if (serial) {
+#if DECO_CALC_DEBUG & 2
+				printf("Tissues after dive #%d taken from cache\n", pdive->number);
+#endif
+				key.prev_id = pdive->id;
+				key.prev_serial = serial;
+				deco_init = true;
+				last_starttime = pdive->when;
+				last_endtime = dive_endtime(pdive);
+				continue;
+			}
+			use_cache = false;
+		}
+
 		surface_pressure = get_surface_pressure_in_mbar(pdive, true) / 1000.0;
 		/* Is it the first dive we add? */
 		if (!deco_init) {
@@ -546,6 +683,8 @@ int init_decompression(struct deco_state *ds, struct dive *dive)
 		last_starttime = pdive->when;
 		last_endtime = dive_endtime(pdive);
 		clear_vpmb_state(ds);
+		key.prev_serial = cache_deco_chain_state(pdive->id, &key, ds);
+		key.prev_id = pdive->id;
 #if DECO_CALC_DEBUG & 2
 		printf("Tissues after added dive #%d:\n", pdive->number);
 		dump_tissues(ds);
@@ -698,11 +837,26 @@ static MAKE_GROW_TABLE(dive_table, struct dive *, dives)
 MAKE_GET_INSERTION_INDEX(dive_table, struct dive *, dives, dive_less_than)
 MAKE_ADD_TO(dive_table, struct dive *, dives)
 static MAKE_REMOVE_FROM(dive_table, dives)
-static MAKE_GET_IDX(dive_table, struct dive *, dives)
+
+/* The tables are sorted, so try a binary search before falling back to
+ * a linear scan. The latter is only needed while a table is being resorted. */
+static int get_idx_in_dive_table(const struct dive_table *table, const struct dive *dive)
+{
+	int idx = dive_table_get_insertion_index((struct dive_table *)table, (struct dive *)dive) - 1;
+	if (idx >= 0 && table->dives[idx] == dive)
+		return idx;
+	for (int i = 0; i < table->nr; ++i) {
+		if (table->dives[i] == dive)
+			return i;
+	}
+	return -1;
+}
+
 MAKE_SORT(dive_table, struct dive *, dives, comp_dives)
 MAKE_REMOVE(dive_table, struct dive *, dive)
 MAKE_CLEAR_TABLE(dive_table, dives, dive)
 MAKE_MOVE_TABLE(dive_table, dives)
+static MAKE_MERGE_TABLE(dive_table, struct dive *, dives, dive_less_than)
 
 void insert_dive(struct dive_table *table, struct dive *d)
 {
@@ -772,6 +926,117 @@ struct dive *unregister_dive(int idx)
 	return dive;
 }
 
+static int comp_pointers(const void *_a, const void *_b)
+{
+	uintptr_t a = (uintptr_t)*(const void * const *)_a;
+	uintptr_t b = (uintptr_t)*(const void * const *)_b;
+	return a < b ? -1 : a > b ? 1 : 0;
+}
+
+/* Remove the dives that are in "sorted" (sorted by address) from the table in
+ * one pass, keeping the order of the remaining dives. "removed" is called for
+ * each dive that was removed. */
+static void remove_dives_from_table(struct dive_table *table, struct dive **sorted, int nr,
+				    void (*removed)(struct dive *))
+{
+	int i, j = 0;
+
+	for (i = 0; i < table->nr; i++) {
+		struct dive *d = table->dives[i];
+		if (bsearch(&d, sorted, nr, sizeof(*sorted), comp_pointers))
+			removed(d);
+		else
+			table->dives[j++] = d;
+	}
+	memset(&table->dives[j], 0, (table->nr - j) * sizeof(table->dives[0]));
+	table->nr = j;
+}
+
+static void removed_from_dive_table(struct dive *dive)
+{
+	fulltext_unregister(dive);
+	if (dive->selected)
+		amount_selected--;
+	dive->selected = false;
+}
+
+static void removed_from_trip(struct dive *dive)
+{
+	invalidate_trip_cache(dive->divetrip);
+	dive->divetrip = NULL;
+}
+
+static void removed_from_dive_site(struct dive *dive)
+{
+	dive->dive_site = NULL;
+}
+
+/* Like unregister_dive(), unregister_dive_from_trip() and unregister_dive_from_dive_site()
+ * for many dives at once. Removing the dives one by one shifts the tables for each dive,
+ * here every table is compacted only once. Trips that become empty are not removed. */
+void unregister_dives(struct dive **dives, int nr)
+{
+	int i;
+	struct dive **sorted;
+
+	if (nr <= 0)
+		return;
+	sorted = malloc(nr * sizeof(*sorted));
+	if (!sorted)
+		exit(1);
+	memcpy(sorted, dives, nr * sizeof(*sorted));
+	qsort(sorted, nr, sizeof(*sorted), comp_pointers);
+
+	/* All dives of a trip or site are removed when the first one is
+	 * found, this resets the trip and site of the others as well */
+	for (i = 0; i < nr; i++) {
+		struct dive *d = sorted[i];
+		if (d->divetrip)
+			remove_dives_from_table(&d->divetrip->dives, sorted, nr, removed_from_trip);
+		if (d->dive_site)
+			remove_dives_from_table(&d->dive_site->dives, sorted, nr, removed_from_dive_site);
+	}
+	remove_dives_from_table(&dive_table, sorted, nr, removed_from_dive_table);
+	free(sorted);
+}
+
+/* Like delete_single_dive() for many dives at once. The dives may
+ * be passed in the dive table itself, therefore they are copied. */
+void delete_dives(struct dive **dives_in, int nr)
+{
+	int i;
+	struct dive **dives;
+	struct dive_trip **trips;
+
+	if (nr <= 0)
+		return;
+	dives = malloc(nr * sizeof(*dives));
+	trips = malloc(nr * sizeof(*trips));
+	if (!dives || !trips)
+		exit(1);
+	memcpy(dives, dives_in, nr * sizeof(*dives));
+	for (i = 0; i < nr; i++) {
+		if (dives[i]->selected)
+			deselect_dive(dives[i]);
+		trips[i] = dives[i]->divetrip;
+	}
+	unregister_dives(dives, nr);
+
+	/* Delete the trips that became empty, each one only once */
+	qsort(trips, nr, sizeof(*trips), comp_pointers);
+	for (i = 0; i < nr; i++) {
+		if (trips[i] && (i == 0 || trips[i] != trips[i - 1]) && trips[i]->dives.nr == 0) {
+			remove_trip(trips[i], &trip_table);
+			free_trip(trips[i]);
+		}
+	}
+	free(trips);
+
+	for (i = 0; i < nr; i++)
+		free_dive(dives[i]);
+	free(dives);
+}
+
 /* this implements the mechanics of removing the dive from the global
  * dive table and the trip, but doesn't deal with updating dive trips, etc */
 void delete_single_dive(int idx)
@@ -802,10 +1067,21 @@ bool filter_dive(struct dive *d, bool shown)
 	return changed;
 }
 
+/* The sample arrays grow by 50% when full, so after loading a log
+ * up to a third of the sample memory may be unused */
+static void shrink_dive_samples(struct dive *dive)
+{
+	struct divecomputer *dc;
+
+	for_each_dc (dive, dc)
+		shrink_samples(dc);
+}
+
 void process_loaded_dives()
 {
 	int i;
 	struct dive *dive;
+	struct trace_span span = trace_begin("process_loaded_dives");
 
 	/* Register dive computer nick names and count shown dives. */
 	shown_dives = 0;
@@ -813,6 +1089,7 @@ void process_loaded_dives()
 		if (!dive->hidden_by_filter)
 			shown_dives++;
 		add_devices_of_dive(dive, &device_table);
+		shrink_dive_samples(dive);
 	}
 
 	sort_dive_table(&dive_table);
@@ -822,6 +1099,7 @@ void process_loaded_dives()
 	autogroup_dives(&dive_table, &trip_table);
 
 	fulltext_populate();
+	trace_end(span);
 
 	/* Inform frontend of reset data. This should reset all the models. */
 	emit_reset_signal();
@@ -903,6 +1181,31 @@ static bool dive_is_after_last(struct dive *d)
 	return dive_less_than(dive_table.dives[dive_table.nr - 1], d);
 }
 
+/* Starting at index "j" of a sorted table, find the first dive that is not less
+ * than "d". Imported dives are usually close to each other, therefore first
+ * search with exponentially increasing steps and then bisect. */
+static int gallop_to_insertion_index(const struct dive_table *table, int j, const struct dive *d)
+{
+	int lo, hi, step;
+
+	if (j >= table->nr || !dive_less_than(table->dives[j], d))
+		return j;
+
+	/* Invariant: table->dives[lo] is less than d */
+	lo = j;
+	for (step = 1; lo + step < table->nr && dive_less_than(table->dives[lo + step], d); step *= 2)
+		lo += step;
+	hi = MIN(lo + step, table->nr);
+	while (hi - lo > 1) {
+		int mid = lo + (hi - lo) / 2;
+		if (dive_less_than(table->dives[mid], d))
+			lo = mid;
+		else
+			hi = mid;
+	}
+	return hi;
+}
+
 /* Merge dives from "dives_from" into "dives_to". Overlapping dives will be merged,
  * non-overlapping dives will be moved. The results will be added to the "dives_to_add"
  * table. Dives that were merged are added to the "dives_to_remove" table.
@@ -941,8 +1244,7 @@ static bool merge_dive_tables(struct dive_table *dives_from, struct dive_table *
 			remove_dive(dive_to_add, delete_from);
 
 		/* Find insertion point. */
-		while (j < dives_to->nr && dive_less_than(dives_to->dives[j], dive_to_add))
-			j++;
+		j = gallop_to_insertion_index(dives_to, j, dive_to_add);
 
 		/* Try to merge into previous dive.
 		 * We are extra-careful to not merge into the same dive twice, as that
@@ -993,7 +1295,7 @@ void add_imported_dives(struct dive_table *import_table, struct trip_table *impo
 			struct dive_site_table *import_sites_table, struct device_table *import_device_table,
 			int flags)
 {
-	int i, idx;
+	int i;
 	struct dive_table dives_to_add = empty_dive_table;
 	struct dive_table dives_to_remove = empty_dive_table;
 	struct trip_table trips_to_add = empty_trip_table;
@@ -1018,16 +1320,11 @@ void add_imported_dives(struct dive_table *import_table, struct trip_table *impo
 	}
 
 	/* Remove old dives */
-	for (i = 0; i < dives_to_remove.nr; i++) {
-		idx = get_divenr(dives_to_remove.dives[i]);
-		delete_single_dive(idx);
-	}
+	delete_dives(dives_to_remove.dives, dives_to_remove.nr);
 	dives_to_remove.nr = 0;
 
-	/* Add new dives */
-	for (i = 0; i < dives_to_add.nr; i++)
-		insert_dive(&dive_table, dives_to_add.dives[i]);
-	dives_to_add.nr = 0;
+	/* Add new dives. Both tables are sorted, so merge them in one go. */
+	merge_dive_table(&dives_to_add, &dive_table);
 
 	/* Add new trips */
 	for (i = 0; i < trips_to_add.nr; i++)
@@ -1070,22 +1367,17 @@ bool try_to_merge_trip(struct dive_trip *trip_import, struct dive_table *import_
 		       struct dive_table *dives_to_add, struct dive_table *dives_to_remove,
 		       bool *sequence_changed, int *start_renumbering_at)
 {
-	int i;
-	struct dive_trip *trip_old;
-
-	for (i = 0; i < trip_table.nr; i++) {
-		trip_old = trip_table.trips[i];
-		if (trips_overlap(trip_import, trip_old)) {
-			*sequence_changed |= merge_dive_tables(&trip_import->dives, import_table, &trip_old->dives,
-							       prefer_imported, trip_old,
-							       dives_to_add, dives_to_remove,
-							       start_renumbering_at);
-			free_trip(trip_import); /* All dives in trip have been consumed -> free */
-			return true;
-		}
-	}
+	struct dive_trip *trip_old = get_overlapping_trip(trip_import, &trip_table);
 
-	return false;
+	if (!trip_old)
+		return false;
+
+	*sequence_changed |= merge_dive_tables(&trip_import->dives, import_table, &trip_old->dives,
+					       prefer_imported, trip_old,
+					       dives_to_add, dives_to_remove,
+					       start_renumbering_at);
+	free_trip(trip_import); /* All dives in trip have been consumed -> free */
+	return true;
 }
 
 /* Process imported dives: take a table of dives to be imported and
@@ -1121,6 +1413,79 @@ bool try_to_merge_trip(struct dive_trip *trip_import, struct dive_table *import_
  * - If IMPORT_ADD_TO_NEW_TRIP is true, dives that are not assigned
  *   to a trip will be added to a newly generated trip.
  */
+/*
+ * Dive sites of the import that already exist are replaced by the existing
+ * ones, new ones are added to sites_to_add and unused ones are freed.
+ * When importing many files, there can be many sites and dives.
+ * Therefore, look up the sites of the dives in sorted arrays instead of
+ * scanning all dives for every site.
+ */
+struct site_replacement {
+	struct dive_site *new_ds, *old_ds;
+};
+
+static int comp_site_ptr(const void *_a, const void *_b)
+{
+	uintptr_t a = (uintptr_t)*(struct dive_site * const *)_a;
+	uintptr_t b = (uintptr_t)*(struct dive_site * const *)_b;
+	return a < b ? -1 : a > b ? 1 : 0;
+}
+
+static void merge_imported_dive_sites(struct dive_table *import_table, struct dive_site_table *import_sites_table,
+				      struct dive_site_table *sites_to_add)
+{
+	int i, nr_replacements = 0;
+	struct dive_site **used_sites;
+	struct site_replacement *replacements;
+
+	used_sites = malloc((import_table->nr + 1) * sizeof(*used_sites));
+	replacements = malloc((import_sites_table->nr + 1) * sizeof(*replacements));
+	if (!used_sites || !replacements)
+		exit(1);
+	for (i = 0; i < import_table->nr; i++)
+		used_sites[i] = import_table->dives[i]->dive_site;
+	qsort(used_sites, import_table->nr, sizeof(*used_sites), comp_site_ptr);
+
+	for (i = 0; i  < import_sites_table->nr; i++) {
+		struct dive_site *new_ds = import_sites_table->dive_sites[i];
+		struct dive_site *old_ds;
+
+		/* Check if it dive site is actually used by new dives. */
+		if (!bsearch(&new_ds, used_sites, import_table->nr, sizeof(*used_sites), comp_site_ptr)) {
+			/* Dive site not even used - free it and go to next. */
+			free_dive_site(new_ds);
+			continue;
+		}
+
+		old_ds = get_same_dive_site(new_ds);
+		if (!old_ds) {
+			/* Dive site doesn't exist. Add it to list of dive sites to be added. */
+			new_ds->dives.nr = 0; /* Caller is responsible for adding dives to site */
+			add_dive_site_to_table(new_ds, sites_to_add);
+			continue;
+		}
+		/* Dive site already exists - use the old and free the new. */
+		replacements[nr_replacements].new_ds = new_ds;
+		replacements[nr_replacements].old_ds = old_ds;
+		nr_replacements++;
+	}
+	import_sites_table->nr = 0; /* All dive sites were consumed */
+
+	/* The new dive site is the first member, so the comparison function can be reused */
+	qsort(replacements, nr_replacements, sizeof(*replacements), comp_site_ptr);
+	for (i = 0; i < import_table->nr && nr_replacements > 0; i++) {
+		struct dive *d = import_table->dives[i];
+		struct site_replacement *r = bsearch(&d->dive_site, replacements, nr_replacements, sizeof(*replacements), comp_site_ptr);
+		if (r)
+			d->dive_site = r->old_ds;
+	}
+	for (i = 0; i < nr_replacements; i++)
+		free_dive_site(replacements[i].new_ds);
+
+	free(used_sites);
+	free(replacements);
+}
+
 void process_imported_dives(struct dive_table *import_table, struct trip_table *import_trip_table,
 			    struct dive_site_table *import_sites_table, struct device_table *import_device_table,
 			    int flags,
@@ -1163,6 +1528,10 @@ void process_imported_dives(struct dive_table *import_table, struct trip_table *
 	if (!import_table->nr)
 		return;
 
+	/* The imported dives are complete - give back unused sample memory */
+	for (i = 0; i < import_table->nr; i++)
+		shrink_dive_samples(import_table->dives[i]);
+
 	/* Add only the devices that we don't know about yet. */
 	for (i = 0; i < nr_devices(import_device_table); i++) {
 		const struct device *dev = get_device(import_device_table, i);
@@ -1191,36 +1560,7 @@ void process_imported_dives(struct dive_table *import_table, struct trip_table *
 		autogroup_dives(import_table, import_trip_table);
 
 	/* If dive sites already exist, use the existing versions. */
-	for (i = 0; i  < import_sites_table->nr; i++) {
-		struct dive_site *new_ds = import_sites_table->dive_sites[i];
-		struct dive_site *old_ds = get_same_dive_site(new_ds);
-
-		/* Check if it dive site is actually used by new dives. */
-		for (j = 0; j < import_table->nr; j++) {
-			if (import_table->dives[j]->dive_site == new_ds)
-				break;
-		}
-
-		if (j == import_table->nr) {
-			/* Dive site not even used - free it and go to next. */
-			free_dive_site(new_ds);
-			continue;
-		}
-
-		if (!old_ds) {
-			/* Dive site doesn't exist. Add it to list of dive sites to be added. */
-			new_ds->dives.nr = 0; /* Caller is responsible for adding dives to site */
-			add_dive_site_to_table(new_ds, sites_to_add);
-			continue;
-		}
-		/* Dive site already exists - use the old and free the new. */
-		for (j = 0; j < import_table->nr; j++) {
-			if (import_table->dives[j]->dive_site == new_ds)
-				import_table->dives[j]->dive_site = old_ds;
-		}
-		free_dive_site(new_ds);
-	}
-	import_sites_table->nr = 0; /* All dive sites were consumed */
+	merge_imported_dive_sites(import_table, import_sites_table, sites_to_add);
 
 	/* Merge overlapping trips. Since both trip tables are sorted, we
 	 * could be smarter here, but realistically not a whole lot of trips
@@ -1356,8 +1696,7 @@ int get_dive_id_closest_to(timestamp_t when)
 	else if (nr == 1)
 		return dive_table.dives[0]->id;
 
-	for (i = 0; i < nr && dive_table.dives[i]->when <= when; i++)
-		; // nothing
+	i = first_dive_after(when);
 
 	// again, capture the two edge cases first
 	if (i == nr)
@@ -1371,26 +1710,17 @@ int get_dive_id_closest_to(timestamp_t when)
 		return dive_table.dives[i]->id;
 }
 
-void clear_dive_file_data()
+/* Reset everything but the dive, trip and dive site tables */
+static void clear_dive_file_state()
 {
-	fulltext_unregister_all();
-	clear_selection();
-
-	while (dive_table.nr)
-		delete_single_dive(0);
 	current_dive = NULL;
 	shown_dives = 0;
-	while (dive_site_table.nr)
-		delete_dive_site(get_dive_site(0, &dive_site_table), &dive_site_table);
-	if (trip_table.nr != 0) {
-		fprintf(stderr, "Warning: trip table not empty in clear_dive_file_data()!\n");
-		trip_table.nr = 0;
-	}
 
 	clear_dive(&displayed_dive);
 	clear_device_table(&device_table);
 	clear_events();
 	clear_filter_presets();
+	invalidate_dive_site_table_cache(&dive_site_table);
 
 	reset_min_datafile_version();
 	clear_git_id();
@@ -1399,6 +1729,53 @@ void clear_dive_file_data()
 	emit_reset_signal();
 }
 
+void clear_dive_file_data()
+{
+	fulltext_unregister_all();
+	clear_selection();
+
+	delete_dives(dive_table.dives, dive_table.nr);
+	while (dive_site_table.nr)
+		delete_dive_site(get_dive_site(0, &dive_site_table), &dive_site_table);
+	if (trip_table.nr != 0) {
+		fprintf(stderr, "Warning: trip table not empty in clear_dive_file_data()!\n");
+		trip_table.nr = 0;
+	}
+
+	clear_dive_file_state();
+}
+
+/*
+ * Like clear_dive_file_data(), but the dives, trips and dive sites are
+ * moved to the given tables instead of being freed. Thus, unchanged
+ * dives can be reused when reloading, see git_load_dives_reuse().
+ * The tables have to be freed with clear_detached_dive_file_data().
+ */
+void detach_dive_file_data(struct dive_table *dives, struct trip_table *trips, struct dive_site_table *sites)
+{
+	fulltext_unregister_all();
+	clear_selection();
+
+	move_dive_table(&dive_table, dives);
+	move_trip_table(&trip_table, trips);
+	move_dive_site_table(&dive_site_table, sites);
+
+	clear_dive_file_state();
+}
+
+void clear_detached_dive_file_data(struct dive_table *dives, struct trip_table *trips, struct dive_site_table *sites)
+{
+	clear_dive_table(dives);
+	free(dives->dives);
+	*dives = empty_dive_table;
+	clear_trip_table(trips);
+	free(trips->trips);
+	*trips = empty_trip_table;
+	clear_dive_site_table(sites);
+	free(sites->dive_sites);
+	*sites = empty_dive_site_table;
+}
+
 bool dive_less_than(const struct dive *a, const struct dive *b)
 {
 	return comp_dives(a, b) < 0;
@@ -1443,6 +1820,46 @@ bool dive_or_trip_less_than(struct dive_or_trip a, struct dive_or_trip b)
 	return comp_dive_or_trip(a, b) < 0;
 }
 
+/*
+ * Index of the first dive in the dive table that starts after "when",
+ * or at "when" if "inclusive" is set. The dive table is sorted by start
+ * time, so do a binary search.
+ */
+static int bisect_dive_table(timestamp_t when, bool inclusive)
+{
+	int lo = 0, hi = dive_table.nr;
+
+	while (lo < hi) {
+		int mid = lo + (hi - lo) / 2;
+		timestamp_t t = dive_table.dives[mid]->when;
+		if (t < when || (!inclusive && t == when))
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return lo;
+}
+
+int first_dive_at_or_after(timestamp_t when)
+{
+	return bisect_dive_table(when, true);
+}
+
+int first_dive_after(timestamp_t when)
+{
+	return bisect_dive_table(when, false);
+}
+
+/* The dives that start in the interval [start, end) */
+struct dive_range dives_in_time_range(timestamp_t start, timestamp_t end)
+{
+	struct dive_range range;
+
+	range.first = first_dive_at_or_after(start);
+	range.last = end > start ? first_dive_at_or_after(end) : range.first;
+	return range;
+}
+
 /*
  * Calculate surface interval for dive starting at "when". Currently, we
  * might display dives which are not yet in the divelist, therefore the
@@ -1458,11 +1875,8 @@ timestamp_t get_surface_interval(timestamp_t when)
 	int i;
 	timestamp_t prev_end;
 
-	/* find previous dive. might want to use a binary search. */
-	for (i = dive_table.nr - 1; i >= 0; --i) {
-		if (dive_table.dives[i]->when < when)
-			break;
-	}
+	/* find previous dive */
+	i = first_dive_at_or_after(when) - 1;
 	if (i < 0)
 		return -1;
 
@@ -1481,11 +1895,7 @@ struct dive *find_next_visible_dive(timestamp_t when)
 	if (!dive_table.nr)
 		return NULL;
 
-	/* we might want to use binary search here */
-	for (i = 0; i < dive_table.nr; i++) {
-		if (when <= get_dive(i)->when)
-			break;
-	}
+	i = first_dive_at_or_after(when);
 
 	for (j = i - 1; j > 0; j--) {
 		if (!get_dive(j)->hidden_by_filter)
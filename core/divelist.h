@@ -28,6 +28,8 @@ extern struct dive_table dive_table;
 extern void sort_dive_table(struct dive_table *table);
 extern void update_cylinder_related_info(struct dive *);
 extern int init_decompression(struct deco_state *ds, struct dive *dive);
+extern void add_dive_to_deco(struct deco_state *ds, struct dive *dive);
+extern double calculate_cns_dive(const struct dive *dive);
 
 /* divelist core logic functions */
 extern void process_loaded_dives();
@@ -52,10 +54,20 @@ extern void add_to_dive_table(struct dive_table *table, int idx, struct dive *di
 extern void insert_dive(struct dive_table *table, struct dive *d);
 extern void get_dive_gas(const struct dive *dive, int *o2_p, int *he_p, int *o2low_p);
 extern int get_divenr(const struct dive *dive);
+extern int get_divenr_by_uniq_id(int id);
 extern int remove_dive(const struct dive *dive, struct dive_table *table);
 extern bool filter_dive(struct dive *d, bool shown); /* returns true if status changed */
 extern int get_dive_nr_at_idx(int idx);
 extern void set_dive_nr_for_current_dive();
+extern int first_dive_at_or_after(timestamp_t when);
+extern int first_dive_after(timestamp_t when);
+/* Range of indices into the dive table: first <= idx < last */
+struct dive_range {
+	int first, last;
+};
+extern struct dive_range dives_in_time_range(timestamp_t start, timestamp_t end);
+#define for_each_dive_in_range(_i, _x, _range) \
+	for ((_i) = (_range).first; (_i) < (_range).last && ((_x) = dive_table.dives[_i]) != NULL; (_i)++)
 extern timestamp_t get_surface_interval(timestamp_t when);
 extern void delete_dive_from_table(struct dive_table *table, int idx);
 extern struct dive *find_next_visible_dive(timestamp_t when);
@@ -67,10 +79,14 @@ void reset_min_datafile_version();
 void report_datafile_version(int version);
 int get_dive_id_closest_to(timestamp_t when);
 void clear_dive_file_data();
+void detach_dive_file_data(struct dive_table *dives, struct trip_table *trips, struct dive_site_table *sites);
+void clear_detached_dive_file_data(struct dive_table *dives, struct trip_table *trips, struct dive_site_table *sites);
 void clear_dive_table(struct dive_table *table);
 void move_dive_table(struct dive_table *src, struct dive_table *dst);
 struct dive *unregister_dive(int idx);
+extern void unregister_dives(struct dive **dives, int nr);
 extern void delete_single_dive(int idx);
+extern void delete_dives(struct dive **dives, int nr);
 
 #ifdef __cplusplus
 }
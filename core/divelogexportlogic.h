@@ -6,6 +6,7 @@ struct htmlExportSetting {
 	bool exportPhotos;
 	bool selectedOnly;
 	bool listOnly;
+	int maxSamples; // reduce the profiles to this many samples, 0 exports all
 	QString fontFamily;
 	QString fontSize;
 	int themeSelection;
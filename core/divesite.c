@@ -6,34 +6,142 @@
 #include "divelist.h"
 #include "membuffer.h"
 #include "table.h"
+#include "tablesnapshot.h"
 #include "sha1.h"
 
+#include <limits.h>
 #include <math.h>
 
 struct dive_site_table dive_site_table;
 
+/* The table is sorted by UUID (see add_dive_site_to_table()), so do a binary search */
+static int dive_site_uuid_index(uint32_t uuid, const struct dive_site_table *ds_table)
+{
+	int lo = 0, hi = ds_table->nr;
+	while (lo < hi) {
+		int mid = lo + (hi - lo) / 2;
+		if (ds_table->dive_sites[mid]->uuid < uuid)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return lo < ds_table->nr && ds_table->dive_sites[lo]->uuid == uuid ? lo : -1;
+}
+
 int get_divesite_idx(const struct dive_site *ds, struct dive_site_table *ds_table)
 {
 	int i;
-	const struct dive_site *d;
 	// tempting as it may be, don't die when called with ds=NULL
-	if (ds)
-		for_each_dive_site(i, d, ds_table) {
-			if (d == ds)
-				return i;
-		}
-	return -1;
+	if (!ds)
+		return -1;
+	i = dive_site_uuid_index(ds->uuid, ds_table);
+	return i >= 0 && ds_table->dive_sites[i] == ds ? i : -1;
 }
 
-// TODO: keep table sorted by UUID and do a binary search?
 struct dive_site *get_dive_site_by_uuid(uint32_t uuid, struct dive_site_table *ds_table)
 {
-	int i;
-	struct dive_site *ds;
-	for_each_dive_site (i, ds, ds_table)
-		if (ds->uuid == uuid)
-			return get_dive_site(i, ds_table);
-	return NULL;
+	return get_dive_site(dive_site_uuid_index(uuid, ds_table), ds_table);
+}
+
+static int get_idx_in_dive_site_table(const struct dive_site_table *ds_table, const struct dive_site *ds)
+{
+	return get_divesite_idx(ds, (struct dive_site_table *)ds_table);
+}
+
+/*
+ * Index of the dive site names, sorted by a hash of the name and position in
+ * the table. Like the GPS index below, it is kept for the table that was queried
+ * last and only built after a few queries without intervening changes.
+ *
+ * Adding or removing sites invalidates the index. Code that changes the name
+ * of a site that is already in a table has to call invalidate_dive_site_name_index().
+ */
+#define NAME_INDEX_MIN_QUERIES 4
+
+struct name_index_entry {
+	unsigned int hash;
+	int idx;
+};
+
+static struct {
+	const struct dive_site_table *table;
+	struct dive_site **dive_sites;
+	int table_nr;
+	int queries;
+	bool valid;
+	int nr, allocated;
+	struct name_index_entry *entries;
+} name_index;
+
+void invalidate_dive_site_name_index(void)
+{
+	name_index.valid = false;
+	name_index.queries = 0;
+}
+
+/* FNV-1a, a missing name is the same as the empty string (see same_string()) */
+static unsigned int name_hash(const char *name)
+{
+	unsigned int hash = 2166136261u;
+	for (const unsigned char *p = (const unsigned char *)(name ?: ""); *p; p++)
+		hash = (hash ^ *p) * 16777619u;
+	return hash;
+}
+
+static int name_index_entry_cmp(const void *a, const void *b)
+{
+	const struct name_index_entry *e1 = a, *e2 = b;
+	if (e1->hash != e2->hash)
+		return e1->hash < e2->hash ? -1 : 1;
+	return e1->idx - e2->idx;
+}
+
+/* Returns false if the caller should do a linear search instead */
+static bool get_name_index(const struct dive_site_table *ds_table)
+{
+	if (name_index.table != ds_table || name_index.dive_sites != ds_table->dive_sites ||
+	    name_index.table_nr != ds_table->nr) {
+		invalidate_dive_site_name_index();
+		name_index.table = ds_table;
+		name_index.dive_sites = ds_table->dive_sites;
+		name_index.table_nr = ds_table->nr;
+	}
+	if (name_index.valid)
+		return true;
+	if (++name_index.queries < NAME_INDEX_MIN_QUERIES)
+		return false;
+
+	if (name_index.allocated < ds_table->nr) {
+		free(name_index.entries);
+		name_index.allocated = ds_table->nr;
+		name_index.entries = malloc(name_index.allocated * sizeof(*name_index.entries));
+		if (!name_index.entries) {
+			name_index.allocated = 0;
+			return false;
+		}
+	}
+	for (int i = 0; i < ds_table->nr; i++) {
+		name_index.entries[i].hash = name_hash(ds_table->dive_sites[i]->name);
+		name_index.entries[i].idx = i;
+	}
+	name_index.nr = ds_table->nr;
+	qsort(name_index.entries, name_index.nr, sizeof(*name_index.entries), name_index_entry_cmp);
+	name_index.valid = true;
+	return true;
+}
+
+/* Index of the first entry that is not smaller than the given hash */
+static int name_index_lower_bound(unsigned int hash)
+{
+	int lo = 0, hi = name_index.nr;
+	while (lo < hi) {
+		int mid = lo + (hi - lo) / 2;
+		if (name_index.entries[mid].hash < hash)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return lo;
 }
 
 /* there could be multiple sites of the same name - return the first one */
@@ -41,6 +149,15 @@ struct dive_site *get_dive_site_by_name(const char *name, struct dive_site_table
 {
 	int i;
 	struct dive_site *ds;
+	if (get_name_index(ds_table)) {
+		unsigned int hash = name_hash(name);
+		for (i = name_index_lower_bound(hash); i < name_index.nr && name_index.entries[i].hash == hash; i++) {
+			ds = ds_table->dive_sites[name_index.entries[i].idx];
+			if (same_string(ds->name, name))
+				return ds;
+		}
+		return NULL;
+	}
 	for_each_dive_site (i, ds, ds_table) {
 		if (same_string(ds->name, name))
 			return ds;
@@ -48,11 +165,116 @@ struct dive_site *get_dive_site_by_name(const char *name, struct dive_site_table
 	return NULL;
 }
 
+/*
+ * Index of the dive sites with GPS location, sorted by latitude, longitude
+ * and position in the table. There is only one index, kept for the table
+ * that was queried last. It is built after a few queries without intervening
+ * changes, so that alternating additions and queries, as during parsing, don't
+ * pay for rebuilding the index over and over again.
+ *
+ * Adding or removing sites invalidates the index. Code that changes the
+ * location of a site that is already in a table has to call
+ * invalidate_dive_site_gps_index().
+ */
+#define GPS_INDEX_MIN_QUERIES 4
+
+struct gps_index_entry {
+	int lat, lon;
+	int idx;
+};
+
+static struct {
+	const struct dive_site_table *table;
+	struct dive_site **dive_sites;
+	int table_nr;
+	int queries;
+	bool valid;
+	int nr, allocated;
+	struct gps_index_entry *entries;
+} gps_index;
+
+void invalidate_dive_site_gps_index(void)
+{
+	gps_index.valid = false;
+	gps_index.queries = 0;
+}
+
+static int gps_index_entry_cmp(const void *a, const void *b)
+{
+	const struct gps_index_entry *e1 = a, *e2 = b;
+	if (e1->lat != e2->lat)
+		return e1->lat < e2->lat ? -1 : 1;
+	if (e1->lon != e2->lon)
+		return e1->lon < e2->lon ? -1 : 1;
+	return e1->idx - e2->idx;
+}
+
+/* Returns false if the caller should do a linear search instead */
+static bool get_gps_index(const struct dive_site_table *ds_table)
+{
+	if (gps_index.table != ds_table || gps_index.dive_sites != ds_table->dive_sites ||
+	    gps_index.table_nr != ds_table->nr) {
+		invalidate_dive_site_gps_index();
+		gps_index.table = ds_table;
+		gps_index.dive_sites = ds_table->dive_sites;
+		gps_index.table_nr = ds_table->nr;
+	}
+	if (gps_index.valid)
+		return true;
+	if (++gps_index.queries < GPS_INDEX_MIN_QUERIES)
+		return false;
+
+	if (gps_index.allocated < ds_table->nr) {
+		free(gps_index.entries);
+		gps_index.allocated = ds_table->nr;
+		gps_index.entries = malloc(gps_index.allocated * sizeof(*gps_index.entries));
+		if (!gps_index.entries) {
+			gps_index.allocated = 0;
+			return false;
+		}
+	}
+	gps_index.nr = 0;
+	for (int i = 0; i < ds_table->nr; i++) {
+		const struct dive_site *ds = ds_table->dive_sites[i];
+		if (!dive_site_has_gps_location(ds))
+			continue;
+		gps_index.entries[gps_index.nr].lat = ds->location.lat.udeg;
+		gps_index.entries[gps_index.nr].lon = ds->location.lon.udeg;
+		gps_index.entries[gps_index.nr].idx = i;
+		gps_index.nr++;
+	}
+	qsort(gps_index.entries, gps_index.nr, sizeof(*gps_index.entries), gps_index_entry_cmp);
+	gps_index.valid = true;
+	return true;
+}
+
+/* Index of the first entry that is not smaller than the given coordinates */
+static int gps_index_lower_bound(int64_t lat, int lon)
+{
+	int lo = 0, hi = gps_index.nr;
+	while (lo < hi) {
+		int mid = lo + (hi - lo) / 2;
+		const struct gps_index_entry *e = &gps_index.entries[mid];
+		if (e->lat < lat || (e->lat == lat && e->lon < lon))
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return lo;
+}
+
 /* there could be multiple sites at the same GPS fix - return the first one */
 struct dive_site *get_dive_site_by_gps(const location_t *loc, struct dive_site_table *ds_table)
 {
 	int i;
 	struct dive_site *ds;
+	if (has_location(loc) && get_gps_index(ds_table)) {
+		i = gps_index_lower_bound(loc->lat.udeg, loc->lon.udeg);
+		if (i < gps_index.nr && gps_index.entries[i].lat == loc->lat.udeg &&
+		    gps_index.entries[i].lon == loc->lon.udeg)
+			return ds_table->dive_sites[gps_index.entries[i].idx];
+		return NULL;
+	}
 	for_each_dive_site (i, ds, ds_table) {
 		if (same_location(loc, &ds->location))
 			return ds;
@@ -67,6 +289,16 @@ struct dive_site *get_dive_site_by_gps_and_name(char *name, const location_t *lo
 {
 	int i;
 	struct dive_site *ds;
+	if (has_location(loc) && get_gps_index(ds_table)) {
+		for (i = gps_index_lower_bound(loc->lat.udeg, loc->lon.udeg);
+		     i < gps_index.nr && gps_index.entries[i].lat == loc->lat.udeg &&
+		     gps_index.entries[i].lon == loc->lon.udeg; i++) {
+			ds = ds_table->dive_sites[gps_index.entries[i].idx];
+			if (same_string(ds->name, name))
+				return ds;
+		}
+		return NULL;
+	}
 	for_each_dive_site (i, ds, ds_table) {
 		if (same_location(loc, &ds->location) && same_string(ds->name, name))
 			return ds;
@@ -98,6 +330,22 @@ struct dive_site *get_dive_site_by_gps_proximity(const location_t *loc, int dist
 	int i;
 	struct dive_site *ds, *res = NULL;
 	unsigned int cur_distance, min_distance = distance;
+	if (distance > 0 && get_gps_index(ds_table)) {
+		/* The distance is at least the difference in latitude - add one
+		 * microdegree to be safe from rounding errors */
+		int64_t lat_range = (int64_t)ceil(distance * 180e6 / (M_PI * 6371000)) + 1;
+		int res_idx = -1;
+		for (i = gps_index_lower_bound(loc->lat.udeg - lat_range, INT_MIN);
+		     i < gps_index.nr && gps_index.entries[i].lat <= loc->lat.udeg + lat_range; i++) {
+			int idx = gps_index.entries[i].idx;
+			cur_distance = get_distance(&ds_table->dive_sites[idx]->location, loc);
+			if (cur_distance < min_distance || (cur_distance == min_distance && idx < res_idx)) {
+				min_distance = cur_distance;
+				res_idx = idx;
+			}
+		}
+		return get_dive_site(res_idx, ds_table);
+	}
 	for_each_dive_site (i, ds, ds_table) {
 		if (dive_site_has_gps_location(ds) &&
 		    (cur_distance = get_distance(&ds->location, loc)) < min_distance) {
@@ -127,7 +375,6 @@ static MAKE_GROW_TABLE(dive_site_table, struct dive_site *, dive_sites)
 static MAKE_GET_INSERTION_INDEX(dive_site_table, struct dive_site *, dive_sites, site_less_than)
 static MAKE_ADD_TO(dive_site_table, struct dive_site *, dive_sites)
 static MAKE_REMOVE_FROM(dive_site_table, dive_sites)
-static MAKE_GET_IDX(dive_site_table, struct dive_site *, dive_sites)
 MAKE_SORT(dive_site_table, struct dive_site *, dive_sites, compare_sites)
 static MAKE_REMOVE(dive_site_table, struct dive_site *, dive_site)
 MAKE_CLEAR_TABLE(dive_site_table, dive_sites, dive_site)
@@ -159,6 +406,7 @@ int add_dive_site_to_table(struct dive_site *ds, struct dive_site_table *ds_tabl
 
 	int idx = dive_site_table_get_insertion_index(ds_table, ds);
 	add_to_dive_site_table(ds_table, idx, ds);
+	invalidate_dive_site_table_cache(ds_table);
 	return idx;
 }
 
@@ -218,20 +466,27 @@ bool is_dive_site_selected(struct dive_site *ds)
 	return false;
 }
 
+static void free_dive_site_now(void *p)
+{
+	struct dive_site *ds = p;
+	free(ds->name);
+	free(ds->notes);
+	free(ds->description);
+	free(ds->dives.dives);
+	free_taxonomy(&ds->taxonomy);
+	free(ds);
+}
+
+/* The dive site might still be used by a worker through a table snapshot */
 void free_dive_site(struct dive_site *ds)
 {
-	if (ds) {
-		free(ds->name);
-		free(ds->notes);
-		free(ds->description);
-		free(ds->dives.dives);
-		free_taxonomy(&ds->taxonomy);
-		free(ds);
-	}
+	if (ds && !defer_free_for_snapshots(&free_dive_site_now, ds))
+		free_dive_site_now(ds);
 }
 
 int unregister_dive_site(struct dive_site *ds)
 {
+	invalidate_dive_site_table_cache(&dive_site_table);
 	return remove_dive_site(ds, &dive_site_table);
 }
 
@@ -240,9 +495,23 @@ void delete_dive_site(struct dive_site *ds, struct dive_site_table *ds_table)
 	if (!ds)
 		return;
 	remove_dive_site(ds, ds_table);
+	invalidate_dive_site_table_cache(ds_table);
 	free_dive_site(ds);
 }
 
+void invalidate_dive_site_table_cache(struct dive_site_table *ds_table)
+{
+	invalidate_dive_site_gps_index();
+	invalidate_dive_site_name_index();
+	memset(ds_table->git_id, 0, 20);
+}
+
+bool dive_site_table_cache_is_valid(const struct dive_site_table *ds_table)
+{
+	static const unsigned char null_id[20] = { 0, };
+	return !!memcmp(ds_table->git_id, null_id, 20);
+}
+
 /* allocate a new site and add it to the table */
 struct dive_site *create_dive_site(const char *name, struct dive_site_table *ds_table)
 {
@@ -276,7 +545,9 @@ void copy_dive_site(struct dive_site *orig, struct dive_site *copy)
 	free(copy->description);
 
 	copy->location = orig->location;
+	invalidate_dive_site_gps_index();
 	copy->name = copy_string(orig->name);
+	invalidate_dive_site_name_index();
 	copy->notes = copy_string(orig->notes);
 	copy->description = copy_string(orig->description);
 	copy_taxonomy(&orig->taxonomy, &copy->taxonomy);
@@ -315,10 +586,21 @@ static bool same_dive_site(const struct dive_site *a, const struct dive_site *b)
 	    && same_string(a->notes, b->notes);
 }
 
+/* Equivalent sites have the same name, so only the sites found by the name index
+ * have to be compared. This makes importing many sites linear in their number. */
 struct dive_site *get_same_dive_site(const struct dive_site *site)
 {
 	int i;
 	struct dive_site *ds;
+	if (get_name_index(&dive_site_table)) {
+		unsigned int hash = name_hash(site->name);
+		for (i = name_index_lower_bound(hash); i < name_index.nr && name_index.entries[i].hash == hash; i++) {
+			ds = dive_site_table.dive_sites[name_index.entries[i].idx];
+			if (same_dive_site(ds, site))
+				return ds;
+		}
+		return NULL;
+	}
 	for_each_dive_site (i, ds, &dive_site_table)
 		if (same_dive_site(ds, site))
 			return ds;
@@ -327,8 +609,12 @@ struct dive_site *get_same_dive_site(const struct dive_site *site)
 
 void merge_dive_site(struct dive_site *a, struct dive_site *b)
 {
-	if (!has_location(&a->location)) a->location = b->location;
+	if (!has_location(&a->location)) {
+		a->location = b->location;
+		invalidate_dive_site_gps_index();
+	}
 	merge_string(&a->name, &b->name);
+	invalidate_dive_site_name_index();
 	merge_string(&a->notes, &b->notes);
 	merge_string(&a->description, &b->description);
 
@@ -340,12 +626,7 @@ void merge_dive_site(struct dive_site *a, struct dive_site *b)
 
 struct dive_site *find_or_create_dive_site_with_name(const char *name, struct dive_site_table *ds_table)
 {
-	int i;
-	struct dive_site *ds;
-	for_each_dive_site(i,ds, ds_table) {
-		if (same_string(name, ds->name))
-			break;
-	}
+	struct dive_site *ds = get_dive_site_by_name(name, ds_table);
 	if (ds)
 		return ds;
 	return create_dive_site(name, ds_table);
@@ -353,17 +634,21 @@ struct dive_site *find_or_create_dive_site_with_name(const char *name, struct di
 
 void purge_empty_dive_sites(struct dive_site_table *ds_table)
 {
-	int i, j;
+	int i;
 	struct dive *d;
 	struct dive_site *ds;
 
+	/* The sites know their dives, there is no need to search them in the dive table */
 	for (i = 0; i < ds_table->nr; i++) {
 		ds = get_dive_site(i, ds_table);
 		if (!dive_site_is_empty(ds))
 			continue;
-		for_each_dive(j, d) {
-			if (d->dive_site == ds)
-				unregister_dive_from_dive_site(d);
+		while (ds->dives.nr > 0) {
+			d = ds->dives.dives[ds->dives.nr - 1];
+			if (d->dive_site != ds)
+				break;
+			unregister_dive_from_dive_site(d);
+			invalidate_dive_cache(d);
 		}
 	}
 }
@@ -29,6 +29,8 @@ struct dive_site
 typedef struct dive_site_table {
 	int nr, allocated;
 	struct dive_site **dive_sites;
+	/* Tree id of the dive site directory in git storage: zero if any site changed since */
+	unsigned char git_id[20];
 } dive_site_table_t;
 
 static const dive_site_table_t empty_dive_site_table = { 0, 0, (struct dive_site **)0 };
@@ -76,6 +78,10 @@ struct dive_site *find_or_create_dive_site_with_name(const char *name, struct di
 void purge_empty_dive_sites(struct dive_site_table *ds_table);
 void clear_dive_site_table(struct dive_site_table *ds_table);
 void move_dive_site_table(struct dive_site_table *src, struct dive_site_table *dst);
+void invalidate_dive_site_table_cache(struct dive_site_table *ds_table);
+void invalidate_dive_site_gps_index(void);
+void invalidate_dive_site_name_index(void);
+bool dive_site_table_cache_is_valid(const struct dive_site_table *ds_table);
 void add_dive_to_dive_site(struct dive *d, struct dive_site *ds);
 struct dive_site *unregister_dive_from_dive_site(struct dive *d);
 
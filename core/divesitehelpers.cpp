@@ -18,45 +18,14 @@
 #include <QNetworkRequest>
 #include <QNetworkAccessManager>
 #include <QUrlQuery>
+#include <QHash>
 #include <QEventLoop>
 #include <QTimer>
 #include <memory>
+#include <vector>
 
-/** Performs a REST get request to a service returning a JSON object. */
-static QJsonObject doAsyncRESTGetRequest(const QString& url, int msTimeout)
+static QJsonObject parseRESTReply(const QString &url, QNetworkReply *reply)
 {
-	// By making the QNetworkAccessManager static and local to this function,
-	// only one manager exists for all geo-lookups and it is only initialized
-	// on first call to this function.
-	static QNetworkAccessManager rgl;
-	QNetworkRequest request;
-	QEventLoop loop;
-	QTimer timer;
-
-	request.setRawHeader("Accept", "text/json");
-	request.setRawHeader("User-Agent", getUserAgent().toUtf8());
-	QObject::connect(&timer, SIGNAL(timeout()), &loop, SLOT(quit()));
-
-	request.setUrl(url);
-
-	// By using a std::unique_ptr<>, we can exit from the function at any point
-	// and the reply will be freed. Likewise, when overwriting the pointer with
-	// a new value. According to Qt's documentation it is fine the delete the
-	// reply as long as we're not in a slot connected to error() or finish().
-	std::unique_ptr<QNetworkReply> reply(rgl.get(request));
-	timer.setSingleShot(true);
-	QObject::connect(&*reply, SIGNAL(finished()), &loop, SLOT(quit()));
-	timer.start(msTimeout);
-	loop.exec();
-
-	if (!timer.isActive()) {
-		report_error("timeout accessing %s", qPrintable(url));
-		QObject::disconnect(&*reply, SIGNAL(finished()), &loop, SLOT(quit()));
-		reply->abort();
-		return QJsonObject{};
-	}
-
-	timer.stop();
 	if (reply->error() > 0) {
 		report_error("got error accessing %s: %s", qPrintable(url), qPrintable(reply->errorString()));
 		return QJsonObject{};
@@ -76,6 +45,62 @@ static QJsonObject doAsyncRESTGetRequest(const QString& url, int msTimeout)
 	return jsonDoc.object();
 }
 
+/** Performs REST get requests to services returning JSON objects.
+ *  The requests run concurrently, the results are returned in the order of the urls. */
+static QVector<QJsonObject> doAsyncRESTGetRequests(const QStringList &urls, int msTimeout)
+{
+	// By making the QNetworkAccessManager static and local to this function,
+	// only one manager exists for all geo-lookups and it is only initialized
+	// on first call to this function.
+	static QNetworkAccessManager rgl;
+	QVector<QJsonObject> res(urls.size());
+	QEventLoop loop;
+	QTimer timer;
+	int pending = urls.size();
+
+	QObject::connect(&timer, SIGNAL(timeout()), &loop, SLOT(quit()));
+
+	// By using std::unique_ptr<>s, we can exit from the function at any point
+	// and the replies will be freed. According to Qt's documentation it is fine
+	// the delete the reply as long as we're not in a slot connected to error()
+	// or finish().
+	std::vector<std::unique_ptr<QNetworkReply>> replies;
+	for (const QString &url: urls) {
+		QNetworkRequest request;
+		request.setRawHeader("Accept", "text/json");
+		request.setRawHeader("User-Agent", getUserAgent().toUtf8());
+		request.setUrl(url);
+		replies.emplace_back(rgl.get(request));
+		QObject::connect(&*replies.back(), &QNetworkReply::finished, &loop, [&pending, &loop]() {
+			if (--pending == 0)
+				loop.quit();
+		});
+	}
+	timer.setSingleShot(true);
+	timer.start(msTimeout);
+	if (pending > 0)
+		loop.exec();
+	timer.stop();
+
+	for (int i = 0; i < urls.size(); ++i) {
+		QNetworkReply *reply = &*replies[i];
+		if (!reply->isFinished()) {
+			report_error("timeout accessing %s", qPrintable(urls[i]));
+			QObject::disconnect(reply, &QNetworkReply::finished, &loop, nullptr);
+			reply->abort();
+			continue;
+		}
+		res[i] = parseRESTReply(urls[i], reply);
+	}
+	return res;
+}
+
+/** Performs a REST get request to a service returning a JSON object. */
+static QJsonObject doAsyncRESTGetRequest(const QString& url, int msTimeout)
+{
+	return doAsyncRESTGetRequests(QStringList{ url }, msTimeout)[0];
+}
+
 /// Performs a reverse-geo-lookup of the coordinates and returns the taxonomy data.
 taxonomy_data reverseGeoLookup(degrees_t latitude, degrees_t longitude)
 {
@@ -86,21 +111,34 @@ taxonomy_data reverseGeoLookup(degrees_t latitude, degrees_t longitude)
 	QString url;
 	QJsonObject obj;
 	taxonomy_data taxonomy = { 0, 0 };
+	QString language = getUiLanguage().section(QRegExp("[-_ ]"), 0, 0);
+
+	// Sites are often looked up repeatedly, e.g. when editing their coordinates back
+	// and forth. Only called on the GUI thread, because of the event loops below.
+	static QHash<QString, taxonomy_data> cache;
+	QString key = QStringLiteral("%1 %2 %3").arg(language).arg(latitude.udeg).arg(longitude.udeg);
+	auto it = cache.find(key);
+	if (it != cache.end()) {
+		copy_taxonomy(&*it, &taxonomy);
+		return taxonomy;
+	}
 
-	// check the oceans API to figure out the body of water
-	url = geonamesOceanURL.arg(getUiLanguage().section(QRegExp("[-_ ]"), 0, 0)).arg(latitude.udeg / 1000000.0).arg(longitude.udeg / 1000000.0);
-	obj = doAsyncRESTGetRequest(url, 5000); // 5 secs. timeout
-	QVariantMap oceanName = obj.value("ocean").toVariant().toMap();
+	// check the oceans API to figure out the body of water and the findNearbyPlaces
+	// API from geonames - that should give us country, state, city. The two requests
+	// are independent and run concurrently.
+	QStringList urls {
+		geonamesOceanURL.arg(language).arg(latitude.udeg / 1000000.0).arg(longitude.udeg / 1000000.0),
+		geonamesNearbyPlaceNameURL.arg(language).arg(latitude.udeg / 1000000.0).arg(longitude.udeg / 1000000.0)
+	};
+	QVector<QJsonObject> objs = doAsyncRESTGetRequests(urls, 5000); // 5 secs. timeout
+	QVariantMap oceanName = objs[0].value("ocean").toVariant().toMap();
 	if (oceanName["name"].isValid())
 		taxonomy_set_category(&taxonomy, TC_OCEAN, qPrintable(oceanName["name"].toString()), taxonomy_origin::GEOCODED);
 
-	// check the findNearbyPlaces API from geonames - that should give us country, state, city
-	url = geonamesNearbyPlaceNameURL.arg(getUiLanguage().section(QRegExp("[-_ ]"), 0, 0)).arg(latitude.udeg / 1000000.0).arg(longitude.udeg / 1000000.0);
-	obj = doAsyncRESTGetRequest(url, 5000); // 5 secs. timeout
-	QVariantList geoNames = obj.value("geonames").toVariant().toList();
+	QVariantList geoNames = objs[1].value("geonames").toVariant().toList();
 	if (geoNames.count() == 0) {
 		// check the findNearby API from geonames if the previous search came up empty - that should give us country, state, location
-		url = geonamesNearbyURL.arg(getUiLanguage().section(QRegExp("[-_ ]"), 0, 0)).arg(latitude.udeg / 1000000.0).arg(longitude.udeg / 1000000.0);
+		url = geonamesNearbyURL.arg(language).arg(latitude.udeg / 1000000.0).arg(longitude.udeg / 1000000.0);
 		obj = doAsyncRESTGetRequest(url, 5000); // 5 secs. timeout
 		geoNames = obj.value("geonames").toVariant().toList();
 	}
@@ -122,6 +160,9 @@ taxonomy_data reverseGeoLookup(degrees_t latitude, degrees_t longitude)
 			// then we copy the town into the city
 			taxonomy_set_category(&taxonomy, TC_ADMIN_L3, lt, taxonomy_origin::GEOCOPIED);
 		}
+		// only remember complete answers, the ocean request may have timed out
+		if (!objs[0].isEmpty())
+			copy_taxonomy(&taxonomy, &cache[key]);
 	} else {
 		report_error("geonames.org did not provide reverse lookup information");
 		//qDebug() << "no reverse geo lookup; geonames returned\n" << fullReply;
@@ -3,6 +3,7 @@
 #include "core/qthelper.h"
 #include "core/settings/qPrefDiveComputer.h"
 #include "core/divelist.h"
+#include "core/taskqueue.h"
 #include <QDebug>
 #if defined(Q_OS_ANDROID)
 #include "core/subsurface-string.h"
@@ -137,6 +138,102 @@ void DownloadThread::run()
 	updateRememberedDCs();
 }
 
+// The state of one of the parallel downloads. The strings must live as long as the download.
+struct DownloadJob {
+	int idx;
+	const DownloadProgressFn *progress;
+	QByteArray vendor, product, devname;
+	device_data_t data;
+};
+
+static void downloadProgress(device_data_t *data, double fraction, const char *text)
+{
+	DownloadJob *job = (DownloadJob *)data->progress_userdata;
+	if (*job->progress)
+		(*job->progress)(job->idx, fraction, text ? QString::fromUtf8(text) : QString());
+}
+
+static void downloadOne(DeviceDownload &download, DownloadJob &job)
+{
+	device_data_t *data = &job.data;
+	data->descriptor = descriptorLookup.value(download.vendor.toLower() + download.product.toLower());
+	if (!data->descriptor) {
+		download.error = DownloadThread::tr("Unknown dive computer %1 %2").arg(download.vendor, download.product);
+		return;
+	}
+	// The Uemis download keeps its state in global variables
+	if (download.vendor == "Uemis") {
+		download.error = DownloadThread::tr("%1 %2 can't be downloaded at the same time as other dive computers")
+				 .arg(download.vendor, download.product);
+		return;
+	}
+	job.vendor = download.vendor.toUtf8();
+	job.product = download.product.toUtf8();
+	job.devname = download.devName.toUtf8();
+	data->vendor = job.vendor.constData();
+	data->product = job.product.constData();
+	data->devname = job.devname.constData();
+	data->force_download = download.forceDownload;
+	// The log and dump files have global names
+	data->libdc_log = false;
+	data->libdc_dump = false;
+	data->download_table = &download.dives;
+	data->sites = &download.sites;
+	data->devices = &download.devices;
+	data->progress_cb = &downloadProgress;
+	data->progress_userdata = &job;
+
+	unsigned int transports = dc_descriptor_get_transports(data->descriptor) & ~(DC_TRANSPORT_BLE | DC_TRANSPORT_BLUETOOTH);
+	if (transports == DC_TRANSPORT_USBHID)
+		data->devname = "";
+	qDebug() << "Starting parallel download from" << download.vendor << download.product << "on" << getTransportString(transports);
+
+	const char *errorText = do_libdivecomputer_import(data);
+	if (errorText)
+		download.error = str_error(errorText, data->devname, data->vendor, data->product);
+	qDebug() << "Finished parallel download from" << download.vendor << download.product << ":"
+		 << download.dives.nr << "dives" << download.error;
+}
+
+void download_in_parallel(std::vector<DeviceDownload> &downloads, const DownloadProgressFn &progress)
+{
+	if (downloads.empty())
+		return;
+	// The downloads mostly wait for the devices, they get a thread each
+	TaskQueue queue(TaskClass::BulkIO, (int)downloads.size());
+	std::vector<DownloadJob> jobs(downloads.size());
+	import_thread_cancelled = false;
+	for (size_t i = 0; i < downloads.size(); ++i) {
+		jobs[i].idx = (int)i;
+		jobs[i].progress = &progress;
+		memset(&jobs[i].data, 0, sizeof(jobs[i].data));
+		DeviceDownload *download = &downloads[i];
+		DownloadJob *job = &jobs[i];
+		queue.run([download, job]() { downloadOne(*download, *job); });
+	}
+	queue.waitForDone();
+}
+
+void merge_downloads(std::vector<DeviceDownload> &downloads, struct dive_table *dives,
+		     struct dive_site_table *sites, struct device_table *devices)
+{
+	for (DeviceDownload &download: downloads) {
+		// The dives and dive sites are moved, therefore the pointers between them stay valid
+		for (int i = 0; i < download.dives.nr; ++i)
+			insert_dive(dives, download.dives.dives[i]);
+		download.dives.nr = 0;
+		for (int i = 0; i < download.sites.nr; ++i)
+			add_dive_site_to_table(download.sites.dive_sites[i], sites);
+		download.sites.nr = 0;
+		for (int i = 0; i < nr_devices(&download.devices); ++i) {
+			const struct device *dev = get_device(&download.devices, i);
+			if (!device_exists(devices, dev))
+				add_to_device_table(devices, dev);
+		}
+		clear_device_table(&download.devices);
+	}
+}
+
 void fill_computer_list()
 {
 	dc_iterator_t *iterator = NULL;
@@ -5,7 +5,10 @@
 #include <QMap>
 #include <QHash>
 #include <QLoggingCategory>
+#include <functional>
+#include <vector>
 
+#include "divelist.h"
 #include "divesite.h"
 #include "device.h"
 #include "libdivecomputer.h"
@@ -84,6 +87,29 @@ private:
 	DCDeviceData *m_data;
 };
 
+/* One of the downloads of download_in_parallel() */
+struct DeviceDownload {
+	QString vendor, product, devName;
+	bool forceDownload = false;
+	QString error;
+	struct dive_table dives = empty_dive_table;
+	struct dive_site_table sites = empty_dive_site_table;
+	struct device_table devices;
+};
+
+/* Called on the download threads with the index of the download, fraction < 0 if it didn't change */
+using DownloadProgressFn = std::function<void(int idx, double fraction, const QString &text)>;
+
+/*
+ * Download from all given dive computers at the same time, each on a thread of its own.
+ * Only for dive computers on different ports that don't need Bluetooth, the Uemis isn't supported.
+ * Returns when all downloads are finished, the dives are in the tables of each download.
+ */
+void download_in_parallel(std::vector<DeviceDownload> &downloads, const DownloadProgressFn &progress);
+/* Move the downloaded dives, dive sites and devices into the given tables */
+void merge_downloads(std::vector<DeviceDownload> &downloads, struct dive_table *dives,
+		     struct dive_site_table *sites, struct device_table *devices);
+
 //TODO: C++ify descriptor?
 struct mydescriptor {
 	const char *vendor;
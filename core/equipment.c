@@ -84,6 +84,77 @@ int cylinderuse_from_text(const char *text)
 	return -1;
 }
 
+/*
+ * The tank and weight system types are looked up by name for every cylinder and
+ * weight system of every loaded dive. Hash tables with open addressing map the
+ * names to the indexes in tank_info and ws_info. Types are only ever appended,
+ * so the indexes are stable. The models append types by setting the name of the
+ * next entry, the index picks these up on the next lookup.
+ */
+#define INFO_HASH_SIZE 256	/* power of two, more than twice MAX_TANK_INFO and MAX_WS_INFO */
+
+struct info_index {
+	short slots[INFO_HASH_SIZE];	/* index + 1, 0 for an empty slot */
+	int nr;				/* number of entries in the hash table */
+};
+
+static struct info_index tank_info_index, ws_info_index;
+
+static const char *tank_info_name(int idx)
+{
+	return tank_info[idx].name;
+}
+
+static const char *ws_info_name(int idx)
+{
+	return ws_info[idx].name;
+}
+
+static unsigned int info_slot(const char *name)
+{
+	unsigned int hash = 2166136261u;
+	for (const unsigned char *p = (const unsigned char *)name; *p; p++)
+		hash = (hash ^ *p) * 16777619u;
+	return hash & (INFO_HASH_SIZE - 1);
+}
+
+/* Returns the first entry with that name, like a search from the start of the table */
+static int info_index_find(struct info_index *index, const char *(*name_of)(int), int max, const char *name)
+{
+	while (index->nr < max && name_of(index->nr)) {
+		unsigned int slot = info_slot(name_of(index->nr));
+		while (index->slots[slot])
+			slot = (slot + 1) & (INFO_HASH_SIZE - 1);
+		index->slots[slot] = ++index->nr;
+	}
+	for (unsigned int slot = info_slot(name); index->slots[slot]; slot = (slot + 1) & (INFO_HASH_SIZE - 1)) {
+		int idx = index->slots[slot] - 1;
+		if (strcmp(name_of(idx), name) == 0)
+			return idx;
+	}
+	return -1;
+}
+
+int find_tank_info(const char *name)
+{
+	return name ? info_index_find(&tank_info_index, &tank_info_name, MAX_TANK_INFO, name) : -1;
+}
+
+int find_ws_info(const char *name)
+{
+	return name ? info_index_find(&ws_info_index, &ws_info_name, MAX_WS_INFO, name) : -1;
+}
+
+void invalidate_tank_info_index()
+{
+	memset(&tank_info_index, 0, sizeof(tank_info_index));
+}
+
+void invalidate_ws_info_index()
+{
+	memset(&ws_info_index, 0, sizeof(ws_info_index));
+}
+
 /* placeholders for a few functions that we need to redesign for the Qt UI */
 void add_cylinder_description(const cylinder_type_t *type)
 {
@@ -91,12 +162,10 @@ void add_cylinder_description(const cylinder_type_t *type)
 	int i;
 
 	desc = type->description;
-	if (!desc)
+	if (!desc || find_tank_info(desc) >= 0)
 		return;
-	for (i = 0; i < MAX_TANK_INFO && tank_info[i].name != NULL; i++) {
-		if (strcmp(tank_info[i].name, desc) == 0)
-			return;
-	}
+	for (i = 0; i < MAX_TANK_INFO && tank_info[i].name != NULL; i++)
+		;
 	if (i < MAX_TANK_INFO) {
 		// FIXME: leaked on exit
 		tank_info[i].name = strdup(desc);
@@ -113,12 +182,13 @@ void add_weightsystem_description(const weightsystem_t *weightsystem)
 	desc = weightsystem->description;
 	if (!desc)
 		return;
-	for (i = 0; i < MAX_WS_INFO && ws_info[i].name != NULL; i++) {
-		if (strcmp(ws_info[i].name, desc) == 0) {
-			ws_info[i].grams = weightsystem->weight.grams;
-			return;
-		}
+	i = find_ws_info(desc);
+	if (i >= 0) {
+		ws_info[i].grams = weightsystem->weight.grams;
+		return;
 	}
+	for (i = 0; i < MAX_WS_INFO && ws_info[i].name != NULL; i++)
+		;
 	if (i < MAX_WS_INFO) {
 		// FIXME: leaked on exit
 		ws_info[i].name = strdup(desc);
@@ -402,19 +472,14 @@ cylinder_t *get_or_create_cylinder(struct dive *d, int idx)
 void fill_default_cylinder(const struct dive *dive, cylinder_t *cyl)
 {
 	const char *cyl_name = prefs.default_cylinder;
-	struct tank_info_t *ti = tank_info;
+	const struct tank_info_t *ti;
 	pressure_t pO2 = {.mbar = lrint(prefs.modpO2 * 1000.0)};
+	int idx = find_tank_info(cyl_name);
 
-	if (!cyl_name)
-		return;
-	while (ti->name != NULL && ti < tank_info + MAX_TANK_INFO) {
-		if (strcmp(ti->name, cyl_name) == 0)
-			break;
-		ti++;
-	}
-	if (ti->name == NULL)
+	if (idx < 0)
 		/* didn't find it */
 		return;
+	ti = &tank_info[idx];
 	cyl->type.description = strdup(ti->name);
 	if (ti->ml) {
 		cyl->type.size.mliter = ti->ml;
@@ -122,6 +122,12 @@ struct ws_info_t {
 };
 extern struct ws_info_t ws_info[MAX_WS_INFO];
 
+/* index of the type with that name or -1, renaming a type requires invalidating the index */
+extern int find_tank_info(const char *name);
+extern int find_ws_info(const char *name);
+extern void invalidate_tank_info_index(void);
+extern void invalidate_ws_info_index(void);
+
 #ifdef __cplusplus
 }
 #endif
@@ -13,7 +13,7 @@ int event_is_gaschange(const struct event *ev)
 
 bool event_is_divemodechange(const struct event *ev)
 {
-	return same_string(ev->name, "modechange");
+	return ev->name_id == EVENT_NAME_MODECHANGE;
 }
 
 struct event *clone_event(const struct event *src_ev)
@@ -22,11 +22,10 @@ struct event *clone_event(const struct event *src_ev)
 	if (!src_ev)
 		return NULL;
 
-	size_t size = sizeof(*src_ev) + strlen(src_ev->name) + 1;
-	ev = (struct event*) malloc(size);
+	ev = (struct event*) malloc(sizeof(*ev));
 	if (!ev)
 		exit(1);
-	memcpy(ev, src_ev, size);
+	*ev = *src_ev;
 	ev->next = NULL;
 
 	return ev;
@@ -45,14 +44,11 @@ struct event *create_event(unsigned int time, int type, int flags, int value, co
 {
 	int gas_index = -1;
 	struct event *ev;
-	unsigned int size, len = strlen(name);
 
-	size = sizeof(*ev) + len + 1;
-	ev = malloc(size);
+	ev = calloc(1, sizeof(*ev));
 	if (!ev)
 		return NULL;
-	memset(ev, 0, size);
-	memcpy(ev->name, name, len);
+	ev->name_id = intern_event_name(name, &ev->name);
 	ev->time.seconds = time;
 	ev->type = type;
 	ev->flags = flags;
@@ -97,7 +93,7 @@ bool same_event(const struct event *a, const struct event *b)
 		return 0;
 	if (a->value != b->value)
 		return 0;
-	return !strcmp(a->name, b->name);
+	return a->name_id == b->name_id;
 }
 
 /* collect all event names and whether we display them */
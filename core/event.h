@@ -3,6 +3,7 @@
 #define EVENT_H
 
 #include "divemode.h"
+#include "eventname.h"
 #include "gas.h"
 #include "units.h"
 
@@ -36,7 +37,8 @@ struct event {
 		} gas;
 	};
 	bool deleted;
-	char name[];
+	int name_id;		/* enum event_name_id for the names that the code looks for */
+	const char *name;	/* in the table of event names, shared by all events */
 };
 
 struct ev_select {
@@ -58,9 +60,10 @@ extern bool same_event(const struct event *a, const struct event *b);
 extern void remember_event(const char *eventname);
 extern void clear_events(void);
 
-/* Since C doesn't have parameter-based overloading, two versions of get_next_event. */
-extern const struct event *get_next_event(const struct event *event, const char *name);
-extern struct event *get_next_event_mutable(struct event *event, const char *name);
+/* Since C doesn't have parameter-based overloading, two versions of get_next_event.
+ * The events are looked for by id, see event_name_id. */
+extern const struct event *get_next_event(const struct event *event, int name_id);
+extern struct event *get_next_event_mutable(struct event *event, int name_id);
 
 
 #ifdef __cplusplus
@@ -0,0 +1,43 @@
+// SPDX-License-Identifier: GPL-2.0
+#include "eventname.h"
+#include <QHash>
+#include <QMutex>
+#include <string.h>
+
+struct EventName {
+	int id;
+	const char *name;
+};
+
+static const char *fixedNames[EVENT_NAME_FIXED_NR] = {
+	"", "gaschange", "modechange", "SP change", "bookmark", "heading", "surface"
+};
+
+// Each name is a separate allocation, so that the events can keep pointers
+// to it while the table grows. Logs only use a few dozen different names.
+static QHash<QByteArray, EventName> makeFixedNames()
+{
+	QHash<QByteArray, EventName> res;
+	for (int i = 0; i < EVENT_NAME_FIXED_NR; ++i)
+		res.insert(QByteArray(fixedNames[i]), { i, fixedNames[i] });
+	return res;
+}
+
+static QHash<QByteArray, EventName> eventNames = makeFixedNames();
+static QMutex lock;
+
+extern "C" int intern_event_name(const char *name, const char **interned)
+{
+	if (!name)
+		name = "";
+	// The key doesn't have to be copied for the lookup
+	QByteArray key = QByteArray::fromRawData(name, (int)strlen(name));
+	QMutexLocker l(&lock);
+	auto it = eventNames.find(key);
+	if (it == eventNames.end()) {
+		const char *copy = strdup(name);
+		it = eventNames.insert(QByteArray(copy), { eventNames.size(), copy });
+	}
+	*interned = it->name;
+	return it->id;
+}
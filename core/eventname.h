@@ -0,0 +1,35 @@
+// SPDX-License-Identifier: GPL-2.0
+// The names of the events are kept in a global table, each different
+// name only once. An event refers to its entry, so that looking for
+// events of a given kind compares integers instead of strings.
+#ifndef EVENTNAME_H
+#define EVENTNAME_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* The names that the code looks for have fixed ids */
+enum event_name_id {
+	EVENT_NAME_NONE,		/* "" */
+	EVENT_NAME_GASCHANGE,		/* "gaschange" */
+	EVENT_NAME_MODECHANGE,		/* "modechange" */
+	EVENT_NAME_SP_CHANGE,		/* "SP change" */
+	EVENT_NAME_BOOKMARK,		/* "bookmark" */
+	EVENT_NAME_HEADING,		/* "heading" */
+	EVENT_NAME_SURFACE,		/* "surface" */
+	EVENT_NAME_FIXED_NR
+};
+
+/*
+ * Returns the id of the name, adding the name to the table if needed.
+ * The stored copy of the name is returned in "interned", it is never freed.
+ * Can be called from any thread.
+ */
+extern int intern_event_name(const char *name, const char **interned);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -5,7 +5,6 @@
 struct extra_data {
 	const char *key;
 	const char *value;
-	struct extra_data *next;
 };
 
 #endif
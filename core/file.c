@@ -6,6 +6,9 @@
 #include <stdlib.h>
 #include <string.h>
 #include <errno.h>
+#ifndef WIN32
+#include <sys/mman.h>
+#endif
 #include "gettext.h"
 #include <zip.h>
 #include <time.h>
@@ -18,6 +21,7 @@
 #include "qthelper.h"
 #include "import-csv.h"
 #include "parse.h"
+#include "trace.h"
 
 /* For SAMPLE_* */
 #include <libdivecomputer/parser.h>
@@ -38,6 +42,7 @@ int readfile(const char *filename, struct memblock *mem)
 
 	mem->buffer = NULL;
 	mem->size = 0;
+	mem->mapped = false;
 
 	fd = subsurface_open(filename, O_RDONLY | O_BINARY, 0);
 	if (fd < 0)
@@ -75,6 +80,61 @@ out:
 	return ret;
 }
 
+/* Smaller files are read, mapping them is not worth the system calls */
+#define MAPFILE_MIN_SIZE (1024 * 1024)
+
+/*
+ * Like readfile(), but large files are mapped into memory instead of being
+ * copied. The mapping is private: an importer that changes the buffer only
+ * gets copies of the pages it touches, the file is never written. Like the
+ * buffer of readfile(), the mapping is followed by a zero byte, because the
+ * rest of the last page is filled with zeros. Files with a size that is a
+ * multiple of the page size are read therefore.
+ * The memblock must be released with free_memblock().
+ */
+int mapfile(const char *filename, struct memblock *mem)
+{
+#ifndef WIN32
+	int fd;
+	struct stat st;
+	long pagesize = sysconf(_SC_PAGESIZE);
+
+	fd = subsurface_open(filename, O_RDONLY | O_BINARY, 0);
+	if (fd < 0) {
+		mem->buffer = NULL;
+		mem->size = 0;
+		mem->mapped = false;
+		return fd;
+	}
+	if (!fstat(fd, &st) && S_ISREG(st.st_mode) && st.st_size >= MAPFILE_MIN_SIZE &&
+	    pagesize > 0 && st.st_size % pagesize) {
+		void *buf = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+		if (buf != MAP_FAILED) {
+			close(fd);
+			mem->buffer = buf;
+			mem->size = st.st_size;
+			mem->mapped = true;
+			return (int)mem->size; // like readfile(), the size will never be that big
+		}
+	}
+	close(fd);
+#endif
+	return readfile(filename, mem);
+}
+
+void free_memblock(struct memblock *mem)
+{
+#ifndef WIN32
+	if (mem->mapped)
+		munmap(mem->buffer, mem->size);
+	else
+#endif
+		free(mem->buffer);
+	mem->buffer = NULL;
+	mem->size = 0;
+	mem->mapped = false;
+}
+
 
 static void zip_read(struct zip_file *file, const char *filename, struct dive_table *table, struct trip_table *trips,
 		     struct dive_site_table *sites, struct device_table *devices, struct filter_preset_table *filter_presets)
@@ -307,8 +367,8 @@ int check_git_sha(const char *filename, struct git_repository **git_p, const cha
 	return 1;
 }
 
-int parse_file(const char *filename, struct dive_table *table, struct trip_table *trips, struct dive_site_table *sites,
-	       struct device_table *devices, struct filter_preset_table *filter_presets)
+static int do_parse_file(const char *filename, struct dive_table *table, struct trip_table *trips, struct dive_site_table *sites,
+			 struct device_table *devices, struct filter_preset_table *filter_presets)
 {
 	struct git_repository *git;
 	const char *branch = NULL;
@@ -327,7 +387,7 @@ int parse_file(const char *filename, struct dive_table *table, struct trip_table
 	if (git)
 		return git_load_dives(git, branch, table, trips, sites, devices, filter_presets);
 
-	if ((ret = readfile(filename, &mem)) < 0) {
+	if ((ret = mapfile(filename, &mem)) < 0) {
 		/* we don't want to display an error if this was the default file  */
 		if (same_string(filename, prefs.default_filename))
 			return 0;
@@ -340,7 +400,7 @@ int parse_file(const char *filename, struct dive_table *table, struct trip_table
 	fmt = strrchr(filename, '.');
 	if (fmt && (!strcasecmp(fmt + 1, "DB") || !strcasecmp(fmt + 1, "BAK") || !strcasecmp(fmt + 1, "SQL"))) {
 		if (!try_to_open_db(filename, &mem, table, trips, sites, devices)) {
-			free(mem.buffer);
+			free_memblock(&mem);
 			return 0;
 		}
 	}
@@ -348,7 +408,7 @@ int parse_file(const char *filename, struct dive_table *table, struct trip_table
 	/* Divesoft Freedom */
 	if (fmt && (!strcasecmp(fmt + 1, "DLF"))) {
 		ret = parse_dlf_buffer(mem.buffer, mem.size, table, trips, sites, devices);
-		free(mem.buffer);
+		free_memblock(&mem);
 		return ret;
 	}
 
@@ -359,26 +419,35 @@ int parse_file(const char *filename, struct dive_table *table, struct trip_table
 		char *wl_name = memcpy(calloc(t - filename + 1, 1), filename, t - filename);
 		wl_name = realloc(wl_name, strlen(wl_name) + 5);
 		wl_name = strcat(wl_name, ".add");
-		if((ret = readfile(wl_name, &wl_mem)) < 0) {
+		if((ret = mapfile(wl_name, &wl_mem)) < 0) {
 			fprintf(stderr, "No file %s found. No WLog extensions.\n", wl_name);
 			ret = datatrak_import(&mem, NULL, table, trips, sites, devices);
 		} else {
 			ret = datatrak_import(&mem, &wl_mem, table, trips, sites, devices);
-			free(wl_mem.buffer);
+			free_memblock(&wl_mem);
 		}
-		free(mem.buffer);
+		free_memblock(&mem);
 		free(wl_name);
 		return ret;
 	}
 
 	/* OSTCtools */
 	if (fmt && (!strcasecmp(fmt + 1, "DIVE"))) {
-		free(mem.buffer);
+		free_memblock(&mem);
 		ostctools_import(filename, table, trips, sites);
 		return 0;
 	}
 
 	ret = parse_file_buffer(filename, &mem, table, trips, sites, devices, filter_presets);
-	free(mem.buffer);
+	free_memblock(&mem);
+	return ret;
+}
+
+int parse_file(const char *filename, struct dive_table *table, struct trip_table *trips, struct dive_site_table *sites,
+	       struct device_table *devices, struct filter_preset_table *filter_presets)
+{
+	struct trace_span span = trace_begin("parse_file");
+	int ret = do_parse_file(filename, table, trips, sites, devices, filter_presets);
+	trace_end(span);
 	return ret;
 }
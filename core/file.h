@@ -5,11 +5,13 @@
 #include "filterpreset.h"
 
 #include <sys/stat.h>
+#include <stdbool.h>
 #include <stdio.h>
 
 struct memblock {
 	void *buffer;
 	size_t size;
+	bool mapped;	/* set by mapfile(), release with free_memblock() */
 };
 
 struct trip_table;
@@ -28,6 +30,8 @@ extern int datatrak_import(struct memblock *mem, struct memblock *wl_mem, struct
 extern void ostctools_import(const char *file, struct dive_table *table, struct trip_table *trips, struct dive_site_table *sites);
 
 extern int readfile(const char *filename, struct memblock *mem);
+extern int mapfile(const char *filename, struct memblock *mem);
+extern void free_memblock(struct memblock *mem);
 extern int parse_file(const char *filename, struct dive_table *table, struct trip_table *trips, struct dive_site_table *sites,
 		      struct device_table *devices, struct filter_preset_table *filter_presets);
 extern int try_to_open_zip(const char *filename, struct dive_table *table, struct trip_table *trips, struct dive_site_table *sites,
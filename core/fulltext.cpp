@@ -7,6 +7,8 @@
 #include "trip.h"
 #include "qthelper.h"
 #include <QLocale>
+#include <algorithm>
+#include <iterator>
 #include <map>
 
 // This class caches each dives words, so that we can unregister a dive from the full text search
@@ -16,13 +18,14 @@ struct full_text_cache {
 
 // The FullText-search class
 class FullText {
-	std::map<QString, std::vector<dive *>> words; // Dives that belong to each word
+	std::map<QString, std::vector<dive *>> words; // Dives that belong to each word, sorted by address
 public:
 	void populate(); // Rebuild from current dive_table
 	void registerDive(struct dive *d); // Note: can be called repeatedly
 	void unregisterDive(struct dive *d); // Note: can be called repeatedly
 	void unregisterAll(); // Unregister all dives in the dive table
 	FullTextResult find(const FullTextQuery &q, StringFilterMode mode) const; // Find dives matchin all words.
+	size_t memory() const;
 private:
 	void registerWords(struct dive *d, const std::vector<QString> &w);
 	void unregisterWords(struct dive *d, const std::vector<QString> &w);
@@ -64,6 +67,11 @@ FullTextResult fulltext_find_dives(const FullTextQuery &q, StringFilterMode mode
 	return self.find(q, mode);
 }
 
+size_t fulltext_memory()
+{
+	return self.memory();
+}
+
 // Check whether a single dive matches the fulltext criterion
 bool fulltext_dive_matches(const struct dive *d, const FullTextQuery &q, StringFilterMode mode)
 {
@@ -186,13 +194,36 @@ void FullText::unregisterAll()
 	words.clear();
 }
 
+static size_t stringMemory(const QString &s)
+{
+	return sizeof(QString) + s.capacity() * sizeof(QChar);
+}
+
+// This is an estimate: the size of the map nodes (about four pointers each) is not
+// exactly known. The words of the per-dive caches share their data with the keys
+// of the index, therefore only their QString handles are counted.
+size_t FullText::memory() const
+{
+	int i;
+	dive *d;
+	size_t res = 0;
+	for (const auto &[word, dives]: words)
+		res += 4 * sizeof(void *) + stringMemory(word) + sizeof(dives) + dives.capacity() * sizeof(dive *);
+	for_each_dive(i, d) {
+		if (d->full_text)
+			res += sizeof(full_text_cache) + d->full_text->words.capacity() * sizeof(QString);
+	}
+	return res;
+}
+
 // Register words of a dive.
 void FullText::registerWords(struct dive *d, const std::vector<QString> &w)
 {
 	for (const QString &word: w) {
 		std::vector<dive *> &entry = words[word];
-		if (std::find(entry.begin(), entry.end(), d) == entry.end())
-			entry.push_back(d);
+		auto it = std::lower_bound(entry.begin(), entry.end(), d);
+		if (it == entry.end() || *it != d)
+			entry.insert(it, d);
 	}
 }
 
@@ -206,19 +237,31 @@ void FullText::unregisterWords(struct dive *d, const std::vector<QString> &w)
 			continue;
 		}
 		std::vector<dive *> &entry = it->second;
-		entry.erase(std::remove(entry.begin(), entry.end(), d));
+		auto it2 = std::lower_bound(entry.begin(), entry.end(), d);
+		if (it2 != entry.end() && *it2 == d)
+			entry.erase(it2);
 		if (entry.empty())
 			words.erase(it);
 	}
 }
 
-// Add dives from second array to first, if not yet there
-void combineDives(std::vector<dive *> &to, const std::vector<dive *> &from)
+// Union of the dive lists of a number of words. The lists are sorted by address and so is the result.
+static std::vector<dive *> combineDives(const std::vector<const std::vector<dive *> *> &lists)
 {
-	for (dive *d: from) {
-		if (std::find(to.begin(), to.end(), d) == to.end())
-			to.push_back(d);
-	}
+	if (lists.empty())
+		return {};
+	if (lists.size() == 1)
+		return *lists[0];
+	size_t size = 0;
+	for (const std::vector<dive *> *list: lists)
+		size += list->size();
+	std::vector<dive *> res;
+	res.reserve(size);
+	for (const std::vector<dive *> *list: lists)
+		res.insert(res.end(), list->begin(), list->end());
+	std::sort(res.begin(), res.end());
+	res.erase(std::unique(res.begin(), res.end()), res.end());
+	return res;
 }
 
 std::vector<dive *> FullText::findDives(const QString &s, StringFilterMode mode) const
@@ -236,25 +279,19 @@ std::vector<dive *> FullText::findDives(const QString &s, StringFilterMode mode)
 		// Find all words that start with a substring. We use the fact
 		// that these words must form a contiguous block, since the words are
 		// ordered lexicographically.
-		auto it = words.lower_bound(s);
-		if (it == words.end() || !it->first.startsWith(s))
-			return {};
-		std::vector<dive *> res = it->second;
-		++it;
-		while (it != words.end() && it->first.startsWith(s)) {
-			combineDives(res, it->second);
-			++it;
-		}
-		return res;
+		std::vector<const std::vector<dive *> *> lists;
+		for (auto it = words.lower_bound(s); it != words.end() && it->first.startsWith(s); ++it)
+			lists.push_back(&it->second);
+		return combineDives(lists);
 	}
 	case StringFilterMode::SUBSTRING: {
 		// Find all words that contain a substring. Here, we have to check all words!
-		std::vector<dive *> res;
+		std::vector<const std::vector<dive *> *> lists;
 		for (auto it = words.begin(); it != words.end(); ++it) {
 			if (it->first.contains(s))
-				combineDives(res, it->second);
+				lists.push_back(&it->second);
 		}
-		return res;
+		return combineDives(lists);
 	}
 	}
 }
@@ -266,10 +303,13 @@ FullTextResult FullText::find(const FullTextQuery &q, StringFilterMode mode) con
 
 	std::vector<dive *> res = findDives(q.words[0], mode);
 	for (size_t i = 1; i < q.words.size(); ++i) {
+		if (res.empty())
+			break;
 		std::vector<dive *> res2 = findDives(q.words[i], mode);
-		// Remove dives from res that are not in res2
-		res.erase(std::remove_if(res.begin(), res.end(),
-				[&res2] (dive *d) { return std::find(res2.begin(), res2.end(), d) == res2.end(); }), res.end());
+		// Remove dives from res that are not in res2. Both are sorted by address.
+		std::vector<dive *> both;
+		std::set_intersection(res.begin(), res.end(), res2.begin(), res2.end(), std::back_inserter(both));
+		res = std::move(both);
 	}
 
 	return { res };
@@ -290,5 +330,5 @@ bool FullTextQuery::doit() const
 
 bool FullTextResult::dive_matches(const struct dive *d) const
 {
-	return std::find(dives.begin(), dives.end(), d) != dives.end();
+	return std::binary_search(dives.begin(), dives.end(), d);
 }
@@ -52,7 +52,7 @@ struct FullTextQuery {
 
 // Describes the result of a fulltext search
 struct FullTextResult {
-	std::vector<dive *> dives;
+	std::vector<dive *> dives; // sorted by address
 	bool dive_matches(const struct dive *d) const;
 };
 
@@ -61,6 +61,7 @@ struct FullTextResult {
 //	2) Test if a given dive matches the query.
 FullTextResult fulltext_find_dives(const FullTextQuery &q, StringFilterMode);
 bool fulltext_dive_matches(const struct dive *d, const FullTextQuery &q, StringFilterMode);
+size_t fulltext_memory(); // Estimate of the bytes held by the index and the per-dive word caches
 
 #endif
 #endif
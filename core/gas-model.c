@@ -5,12 +5,6 @@
 #include <stdlib.h>
 #include "dive.h"
 
-/* "Virial minus one" - the virial cubic form without the initial 1.0 */
-static double virial_m1(const double coeff[], double x)
-{
-	return x*coeff[0] + x*x*coeff[1] + x*x*x*coeff[2];
-}
-
 /*
  * Z = pV/nRT
  *
@@ -46,8 +40,8 @@ double gas_compressibility_factor(struct gasmix gas, double bar)
 		-8.83632921053e-08,
 		+5.33304543646e-11
 	};
-	int o2, he;
-	double Z;
+	int o2, he, n2;
+	double coeff[3];
 
 	/*
 	 * The curve fitting range is only [0,500] bar.
@@ -59,19 +53,24 @@ double gas_compressibility_factor(struct gasmix gas, double bar)
 
 	o2 = get_o2(gas);
 	he = get_he(gas);
-
-	Z = virial_m1(o2_coefficients, bar) * o2 +
-	    virial_m1(he_coefficients, bar) * he +
-	    virial_m1(n2_coefficients, bar) * (1000 - o2 - he);
+	n2 = 1000 - o2 - he;
 
 	/*
-	 * We add the 1.0 at the very end - the linear mixing of the
-	 * three 1.0 terms is still 1.0 regardless of the gas mix.
+	 * The polynomials are linear in the coefficients, so instead
+	 * of evaluating the polynomials of the three gases and mixing
+	 * the results, mix the coefficients and evaluate one polynomial.
 	 *
 	 * The * 0.001 is because we did the linear mixing using the
 	 * raw permille gas values.
 	 */
-	return Z * 0.001 + 1.0;
+	for (int i = 0; i < 3; i++)
+		coeff[i] = (o2_coefficients[i] * o2 + he_coefficients[i] * he + n2_coefficients[i] * n2) * 0.001;
+
+	/*
+	 * We add the 1.0 at the very end - the linear mixing of the
+	 * three 1.0 terms is still 1.0 regardless of the gas mix.
+	 */
+	return 1.0 + bar * (coeff[0] + bar * (coeff[1] + bar * coeff[2]));
 }
 
 /* Compute the new pressure when compressing (expanding) volome v1 at pressure p1 bar to volume v2
@@ -63,21 +63,9 @@ static pr_track_t *pr_track_alloc(int start, int t_start)
 	return pt;
 }
 
-/* poor man's linked list */
-static pr_track_t *list_last(pr_track_t *list)
+/* poor man's linked list - the caller keeps track of the tail */
+static pr_track_t *list_add(pr_track_t *list, pr_track_t *tail, pr_track_t *element)
 {
-	pr_track_t *tail = list;
-	if (!tail)
-		return NULL;
-	while (tail->next) {
-		tail = tail->next;
-	}
-	return tail;
-}
-
-static pr_track_t *list_add(pr_track_t *list, pr_track_t *element)
-{
-	pr_track_t *tail = list_last(list);
 	if (!tail)
 		return element;
 	tail->next = element;
@@ -86,10 +74,11 @@ static pr_track_t *list_add(pr_track_t *list, pr_track_t *element)
 
 static void list_free(pr_track_t *list)
 {
-	if (!list)
-		return;
-	list_free(list->next);
-	free(list);
+	while (list) {
+		pr_track_t *next = list->next;
+		free(list);
+		list = next;
+	}
 }
 
 #ifdef DEBUG_PR_TRACK
@@ -214,7 +203,13 @@ static struct pr_interpolate_struct get_pr_interpolate_data(pr_track_t *segment,
 	interpolate.acc_pressure_time = 0;
 	interpolate.pressure_time = 0;
 
-	for (i = 0; i < pi->nr; i++) {
+	// The entries are sorted by time and cur is inside the segment, so
+	// search backwards from there for the beginning of the segment
+	// instead of walking all the entries from the start of the dive.
+	i = cur;
+	while (i > 0 && pi->entry[i - 1].sec >= segment->t_start)
+		i--;
+	for (; i < pi->nr; i++) {
 		entry = pi->entry + i;
 
 		if (entry->sec < segment->t_start)
@@ -234,6 +229,7 @@ static void fill_missing_tank_pressures(struct dive *dive, struct plot_info *pi,
 	struct plot_data *entry;
 	pr_interpolate_t interpolate = { 0, 0, 0, 0 };
 	pr_track_t *last_segment = NULL;
+	pr_track_t *segment = track_pr;
 	int cur_pr;
 	enum interpolation_strategy strategy;
 
@@ -264,7 +260,6 @@ static void fill_missing_tank_pressures(struct dive *dive, struct plot_info *pi,
 	 * at time 0 we need to process the second of them here, therefore i=1 */
 	for (i = 1; i < pi->nr; i++) { // For each point on the profile:
 		double magic;
-		pr_track_t *segment;
 		int pressure;
 
 		entry = pi->entry + i;
@@ -278,7 +273,8 @@ static void fill_missing_tank_pressures(struct dive *dive, struct plot_info *pi,
 		}
 		// If there is NO valid pressure value..
 		// Find the pressure segment corresponding to this entry..
-		segment = track_pr;
+		// The entries and the segments are sorted by time, so continue
+		// the search where it ended for the previous entry.
 		while (segment && segment->t_end < entry->sec) // Find the track_pr with end time..
 			segment = segment->next;	       // ..that matches the plot_info time (entry->sec)
 
@@ -371,6 +367,7 @@ void populate_pressure_information(struct dive *dive, struct divecomputer *dc, s
 	int first, last, cyl;
 	cylinder_t *cylinder = get_cylinder(dive, sensor);
 	pr_track_t *track = NULL;
+	pr_track_t *tail = NULL;
 	pr_track_t *current = NULL;
 	const struct event *ev, *b_ev;
 	int missing_pr = 0, dense = 1;
@@ -412,8 +409,8 @@ void populate_pressure_information(struct dive *dive, struct divecomputer *dc, s
 	cyl = sensor;
 	ev = NULL;
 	if (has_gaschange_event(dive, dc, sensor))
-		ev = get_next_event(dc->events, "gaschange");
-	b_ev = get_next_event(dc->events, "modechange");
+		ev = get_next_event(dc->events, EVENT_NAME_GASCHANGE);
+	b_ev = get_next_event(dc->events, EVENT_NAME_MODECHANGE);
 
 	for (int i = first; i <= last; i++) {
 		struct plot_data *entry = pi->entry + i;
@@ -424,12 +421,12 @@ void populate_pressure_information(struct dive *dive, struct divecomputer *dc, s
 			cyl = get_cylinder_index(dive, ev); // the current gas change.
 			if (cyl < 0)
 				cyl = sensor;
-			ev = get_next_event(ev->next, "gaschange");
+			ev = get_next_event(ev->next, EVENT_NAME_GASCHANGE);
 		}
 
 		while (b_ev && b_ev->time.seconds <= time) { // Keep existing divemode, then
 			dmode = b_ev->value; // find 1st divemode change event after the current 
-			b_ev = get_next_event(b_ev->next, "modechange"); // divemode change.
+			b_ev = get_next_event(b_ev->next, EVENT_NAME_MODECHANGE); // divemode change.
 		}
 
 		if (current) { // calculate pressure-time, taking into account the dive mode for this specific segment.
@@ -473,7 +470,8 @@ void populate_pressure_information(struct dive *dive, struct divecomputer *dc, s
 		// Or maybe we didn't have a previous one at all,
 		// and this is the first pressure entry.
 		current = pr_track_alloc(pressure, entry->sec);
-		track = list_add(track, current);
+		track = list_add(track, tail, current);
+		tail = current;
 		dense = 1;
 	}
 
@@ -1,12 +1,34 @@
 // SPDX-License-Identifier: GPL-2.0
 #include "gettextfromc.h"
 #include <QHash>
+#include <QList>
 #include <QMutex>
+#include <atomic>
+#include <string.h>
 
+// The translations, owned by this cache. The returned strings are never
+// freed, callers may keep them. When the cache is reset, the old
+// translations are retired, but kept.
 static QHash<QByteArray, QByteArray> translationCache;
+static QList<QHash<QByteArray, QByteArray>> retiredCaches;
 static QMutex lock;
+static std::atomic<int> generation(0);
 
-extern "C" const char *trGettext(const char *text)
+// The C code mostly passes string literals. Therefore, each thread remembers
+// the translations by the address of the source string, so that looking up
+// a translation again needs neither an allocation nor the lock. Since the
+// addresses of other strings may be reused, the source is compared as well.
+struct LocalEntry {
+	QByteArray source;
+	const char *translation;
+};
+
+struct LocalCache {
+	int generation = -1;
+	QHash<const char *, LocalEntry> entries;
+};
+
+static const char *lookupShared(const char *text)
 {
 	QByteArray key(text);
 	QMutexLocker l(&lock);
@@ -15,3 +37,29 @@ extern "C" const char *trGettext(const char *text)
 		it = translationCache.insert(key, gettextFromC::tr(text).toUtf8());
 	return it->constData();
 }
+
+extern "C" const char *trGettext(const char *text)
+{
+	thread_local LocalCache local;
+	int gen = generation.load(std::memory_order_acquire);
+	if (local.generation != gen) {
+		local.entries.clear();
+		local.generation = gen;
+	}
+	auto it = local.entries.find(text);
+	if (it != local.entries.end() && strcmp(it->source.constData(), text) == 0)
+		return it->translation;
+	const char *res = lookupShared(text);
+	local.entries.insert(text, { QByteArray(text), res });
+	return res;
+}
+
+void trGettextReset()
+{
+	QMutexLocker l(&lock);
+	if (!translationCache.isEmpty()) {
+		retiredCaches.append(translationCache);
+		translationCache.clear();
+	}
+	generation.fetch_add(1, std::memory_order_release);
+}
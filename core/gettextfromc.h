@@ -5,6 +5,7 @@
 #include <QCoreApplication>
 
 extern "C" const char *trGettext(const char *text);
+void trGettextReset();		// Translate the strings again, e.g. after loading the translations
 
 class gettextFromC {
 	Q_DECLARE_TR_FUNCTIONS(gettextFromC)
@@ -27,6 +27,12 @@
 #include "git-access.h"
 #include "gettext.h"
 #include "sha1.h"
+#include "trace.h"
+
+/* libgit2 supports depth-limited fetches since version 1.7 */
+#if LIBGIT2_VER_MAJOR > 1 || (LIBGIT2_VER_MAJOR == 1 && LIBGIT2_VER_MINOR >= 7)
+#define HAVE_SHALLOW_CLONE 1
+#endif
 
 bool is_subsurface_cloud = false;
 
@@ -38,6 +44,78 @@ bool git_local_only = true;
 bool git_local_only = false;
 #endif
 bool git_remote_sync_successful = false;
+struct git_sync_stats git_sync_stats, git_sync_stats_total;
+
+/* On a metered connection, push at most once per hour */
+#define METERED_PUSH_INTERVAL (60 * 60 * 1000)
+static int64_t last_push_msecs = -METERED_PUSH_INTERVAL;
+
+/*
+ * The id of the remote branch we last saw on the server. Within a short time
+ * we trust it, so that a series of saves doesn't ask the server every time.
+ */
+#define REMOTE_STATUS_CACHE_MSECS (60 * 1000)
+static struct {
+	char *remote, *branch;
+	git_oid id;
+	int64_t when;
+} remote_status_cache;
+
+/* Our own pushes change the id, but only asking the server restarts the time */
+static void set_remote_status_cache(const char *remote, const char *branch, const git_oid *id, bool checked_server)
+{
+	if (!checked_server && !remote_status_cache.remote)
+		return;
+	if (checked_server) {
+		free(remote_status_cache.remote);
+		free(remote_status_cache.branch);
+		remote_status_cache.remote = strdup(remote);
+		remote_status_cache.branch = strdup(branch);
+		remote_status_cache.when = monotonic_msecs();
+	}
+	git_oid_cpy(&remote_status_cache.id, id);
+}
+
+static void invalidate_remote_status_cache(void)
+{
+	free(remote_status_cache.remote);
+	free(remote_status_cache.branch);
+	remote_status_cache.remote = remote_status_cache.branch = NULL;
+}
+
+static bool remote_status_cache_matches(const char *remote, const char *branch, const git_oid *id)
+{
+	return remote_status_cache.remote &&
+	       monotonic_msecs() - remote_status_cache.when < REMOTE_STATUS_CACHE_MSECS &&
+	       !strcmp(remote_status_cache.remote, remote) && !strcmp(remote_status_cache.branch, branch) &&
+	       git_oid_equal(&remote_status_cache.id, id);
+}
+
+static void start_sync_stats(void)
+{
+	memset(&git_sync_stats, 0, sizeof(git_sync_stats));
+}
+
+static void finish_sync_stats(void)
+{
+	struct git_sync_stats *s = &git_sync_stats, *t = &git_sync_stats_total;
+
+	t->bytes_received += s->bytes_received;
+	t->bytes_sent += s->bytes_sent;
+	t->objects_received += s->objects_received;
+	t->objects_sent += s->objects_sent;
+	t->fetch_msecs += s->fetch_msecs;
+	t->merge_msecs += s->merge_msecs;
+	t->checkout_msecs += s->checkout_msecs;
+	t->push_msecs += s->push_msecs;
+	t->postponed_pushes += s->postponed_pushes;
+	SSRF_INFO("git storage: sync received %lu bytes (%u objects), sent %lu bytes (%u objects)%s",
+		  (unsigned long)s->bytes_received, s->objects_received,
+		  (unsigned long)s->bytes_sent, s->objects_sent,
+		  s->postponed_pushes ? ", push postponed" : "");
+	SSRF_INFO("git storage: sync took %d ms fetch, %d ms merge, %d ms checkout, %d ms push",
+		  s->fetch_msecs, s->merge_msecs, s->checkout_msecs, s->push_msecs);
+}
 
 
 int (*update_progress_cb)(const char *) = NULL;
@@ -112,6 +190,8 @@ static int transfer_progress_cb(const git_transfer_progress *stats, void *payloa
 	snprintf(buf, 100, "transfer cb rec_obj %d tot_obj %d idx_delta %d total_delta %d local obj %d", stats->received_objects, stats->total_objects, stats->indexed_deltas, stats->total_deltas, stats->local_objects);
 	return git_storage_update_progress(buf);
 	 */
+	git_sync_stats.bytes_received = stats->received_bytes;
+	git_sync_stats.objects_received = stats->received_objects;
 	if (done > last_done) {
 		last_done = done;
 		snprintf(buf, sizeof(buf), translate("gettextFromC", "Transfer from storage (%d/%d)"), done, total);
@@ -123,9 +203,10 @@ static int transfer_progress_cb(const git_transfer_progress *stats, void *payloa
 // the initial push to sync the repos is mapped to 10% of overall progress
 static int push_transfer_progress_cb(unsigned int current, unsigned int total, size_t bytes, void *payload)
 {
-	UNUSED(bytes);
 	UNUSED(payload);
 	char buf[80];
+	git_sync_stats.bytes_sent = bytes;
+	git_sync_stats.objects_sent = current;
 	snprintf(buf, sizeof(buf), translate("gettextFromC", "Transfer to storage (%d/%d)"), current, total);
 	return git_storage_update_progress(buf);
 }
@@ -331,7 +412,17 @@ static int update_remote(git_repository *repo, git_remote *origin, git_reference
 		opts.callbacks.credentials = credential_https_cb;
 	opts.callbacks.certificate_check = certificate_check_cb;
 
-	if (git_remote_push(origin, &refspec, &opts)) {
+	/* Collect the changes of several saves into one push */
+	if (prefs.cloud_metered_connection && monotonic_msecs() - last_push_msecs < METERED_PUSH_INTERVAL) {
+		SSRF_INFO("git storage: metered connection, postponing push");
+		git_sync_stats.postponed_pushes++;
+		return 0;
+	}
+
+	int64_t start = monotonic_msecs();
+	int error = git_remote_push(origin, &refspec, &opts);
+	git_sync_stats.push_msecs += (int)(monotonic_msecs() - start);
+	if (error) {
 		const char *msg = giterr_last()->message;
 		SSRF_INFO("git storage: unable to update remote with current local cache state, error: %s", msg);
 		if (is_subsurface_cloud)
@@ -339,18 +430,175 @@ static int update_remote(git_repository *repo, git_remote *origin, git_reference
 		else
 			return report_error("Unable to update remote with current local cache state (%s)", msg);
 	}
+	last_push_msecs = monotonic_msecs();
 	return 0;
 }
 
 extern int update_git_checkout(git_repository *repo, git_object *parent, git_tree *tree);
 
+static bool same_tree_entry(const git_tree_entry *a, const git_tree_entry *b)
+{
+	if (!a || !b)
+		return a == b;
+	return git_tree_entry_filemode(a) == git_tree_entry_filemode(b) &&
+	       git_oid_equal(git_tree_entry_id(a), git_tree_entry_id(b));
+}
+
+static const git_tree_entry *tree_entry_byname(const git_tree *tree, const char *name)
+{
+	return tree ? git_tree_entry_byname(tree, name) : NULL;
+}
+
+static int lookup_subtree(git_repository *repo, git_tree **subtree, const git_tree_entry *entry)
+{
+	*subtree = NULL;
+	if (!entry || git_tree_entry_type(entry) != GIT_OBJ_TREE)
+		return 0;
+	return git_tree_lookup(subtree, repo, git_tree_entry_id(entry));
+}
+
+static int blob_merge_input(git_repository *repo, git_merge_file_input *input, git_blob **blob, const git_tree_entry *entry)
+{
+	git_merge_file_init_input(input, GIT_MERGE_FILE_INPUT_VERSION);
+	*blob = NULL;
+	if (!entry)
+		return 0;
+	if (git_blob_lookup(blob, repo, git_tree_entry_id(entry)))
+		return -1;
+	input->ptr = git_blob_rawcontent(*blob);
+	input->size = (size_t)git_blob_rawsize(*blob);
+	input->path = git_tree_entry_name(entry);
+	input->mode = git_tree_entry_filemode(entry);
+	return 0;
+}
+
+/* A file that was changed on both sides: keep the lines of both versions */
+static int merge_git_blobs(git_repository *repo, git_oid *result, const git_tree_entry *base,
+			   const git_tree_entry *local, const git_tree_entry *remote)
+{
+	git_merge_file_input base_input, local_input, remote_input;
+	git_blob *base_blob, *local_blob = NULL, *remote_blob = NULL;
+	git_merge_file_options options;
+	git_merge_file_result merged = { 0 };
+	int ret = -1;
+
+	if (blob_merge_input(repo, &base_input, &base_blob, base) ||
+	    blob_merge_input(repo, &local_input, &local_blob, local) ||
+	    blob_merge_input(repo, &remote_input, &remote_blob, remote))
+		goto out;
+	git_merge_file_init_options(&options, GIT_MERGE_FILE_OPTIONS_VERSION);
+	options.favor = GIT_MERGE_FILE_FAVOR_UNION;
+	if (git_merge_file(&merged, &base_input, &local_input, &remote_input, &options))
+		goto out;
+	ret = git_blob_create_frombuffer(result, repo, merged.ptr, merged.len);
+	git_merge_file_result_free(&merged);
+out:
+	git_blob_free(base_blob);
+	git_blob_free(local_blob);
+	git_blob_free(remote_blob);
+	return ret;
+}
+
+static int merge_git_tree_level(git_repository *repo, git_oid *result, const git_tree *base,
+				const git_tree *local, const git_tree *remote, int *conflicts);
+
+/* Add the merge of one name in the three trees to the tree builder */
+static int merge_git_tree_entry(git_repository *repo, git_treebuilder *builder, const char *name,
+				const git_tree_entry *base, const git_tree_entry *local, const git_tree_entry *remote,
+				int *conflicts)
+{
+	const git_tree_entry *pick;
+	git_oid merged_id;
+
+	if (same_tree_entry(local, remote) || same_tree_entry(base, remote))
+		pick = local;
+	else if (same_tree_entry(base, local))
+		pick = remote;
+	else if (local && remote && git_tree_entry_type(local) == GIT_OBJ_TREE && git_tree_entry_type(remote) == GIT_OBJ_TREE) {
+		/* Changed on both sides: descend */
+		git_tree *base_tree, *local_tree = NULL, *remote_tree = NULL;
+		int ret = lookup_subtree(repo, &base_tree, base) ||
+			  lookup_subtree(repo, &local_tree, local) ||
+			  lookup_subtree(repo, &remote_tree, remote) ||
+			  merge_git_tree_level(repo, &merged_id, base_tree, local_tree, remote_tree, conflicts);
+		git_tree_free(base_tree);
+		git_tree_free(local_tree);
+		git_tree_free(remote_tree);
+		if (ret)
+			return -1;
+		/* Like git, don't keep directories that became empty */
+		if (git_tree_lookup(&local_tree, repo, &merged_id))
+			return -1;
+		size_t count = git_tree_entrycount(local_tree);
+		git_tree_free(local_tree);
+		return count ? git_treebuilder_insert(NULL, builder, name, &merged_id, GIT_FILEMODE_TREE) : 0;
+	} else if (local && remote && git_tree_entry_type(local) == GIT_OBJ_BLOB && git_tree_entry_type(remote) == GIT_OBJ_BLOB) {
+		if (verbose)
+			SSRF_INFO("git storage: %s changed on both sides, merging lines of both versions", name);
+		if (merge_git_blobs(repo, &merged_id, base && git_tree_entry_type(base) == GIT_OBJ_BLOB ? base : NULL, local, remote))
+			return -1;
+		return git_treebuilder_insert(NULL, builder, name, &merged_id, git_tree_entry_filemode(local));
+	} else if (!local || !remote) {
+		/* Modified on one side and deleted on the other: it stays deleted */
+		SSRF_INFO("git storage: conflict in %s, looks like a delete on one side; removing it", name);
+		(*conflicts)++;
+		return 0;
+	} else {
+		SSRF_INFO("git storage: conflict in %s, file and directory - using local version", name);
+		(*conflicts)++;
+		pick = local;
+	}
+	if (!pick)
+		return 0;
+	return git_treebuilder_insert(NULL, builder, name, git_tree_entry_id(pick), git_tree_entry_filemode(pick));
+}
+
+/*
+ * Three-way merge of one level of the local and remote trees. The entries are
+ * compared by their object ids, so that unchanged subdirectories, i.e. almost
+ * all dives, trips and sites, are never looked into. There is no rename
+ * detection: a dive that was renamed on one side and changed on the other
+ * loses the change, but that is rare and rename detection on large dive logs
+ * takes seconds.
+ */
+static int merge_git_tree_level(git_repository *repo, git_oid *result, const git_tree *base,
+				const git_tree *local, const git_tree *remote, int *conflicts)
+{
+	git_treebuilder *builder;
+	size_t i, n;
+	int ret = 0;
+
+	if (git_treebuilder_new(&builder, repo, NULL))
+		return -1;
+	n = local ? git_tree_entrycount(local) : 0;
+	for (i = 0; i < n && !ret; i++) {
+		const git_tree_entry *entry = git_tree_entry_byindex(local, i);
+		const char *name = git_tree_entry_name(entry);
+		ret = merge_git_tree_entry(repo, builder, name, tree_entry_byname(base, name),
+					   entry, tree_entry_byname(remote, name), conflicts);
+	}
+	/* Names that only exist in the remote tree */
+	n = remote ? git_tree_entrycount(remote) : 0;
+	for (i = 0; i < n && !ret; i++) {
+		const git_tree_entry *entry = git_tree_entry_byindex(remote, i);
+		const char *name = git_tree_entry_name(entry);
+		if (tree_entry_byname(local, name))
+			continue;
+		ret = merge_git_tree_entry(repo, builder, name, tree_entry_byname(base, name),
+					   NULL, entry, conflicts);
+	}
+	if (!ret)
+		ret = git_treebuilder_write(result, builder);
+	git_treebuilder_free(builder);
+	return ret;
+}
+
 static int try_to_git_merge(git_repository *repo, git_reference **local_p, git_reference *remote, git_oid *base, const git_oid *local_id, const git_oid *remote_id)
 {
 	UNUSED(remote);
 	git_tree *local_tree, *remote_tree, *base_tree;
 	git_commit *local_commit, *remote_commit, *base_commit;
-	git_index *merged_index;
-	git_merge_options merge_options;
+	int conflicts = 0;
 	struct membuffer msg = { 0, 0, NULL};
 
 	if (verbose) {
@@ -361,10 +609,6 @@ static int try_to_git_merge(git_repository *repo, git_reference **local_p, git_r
 		SSRF_INFO("git storage: trying to merge local SHA %s remote SHA %s\n", outlocal, outremote);
 	}
 
-	git_merge_init_options(&merge_options, GIT_MERGE_OPTIONS_VERSION);
-	merge_options.flags = GIT_MERGE_FIND_RENAMES;
-	merge_options.file_favor = GIT_MERGE_FILE_FAVOR_UNION;
-	merge_options.rename_threshold = 100;
 	if (git_commit_lookup(&local_commit, repo, local_id)) {
 		SSRF_INFO("git storage: remote storage and local data diverged. Error: can't get commit (%s)", giterr_last()->message);
 		goto diverged_error;
@@ -389,48 +633,18 @@ static int try_to_git_merge(git_repository *repo, git_reference **local_p, git_r
 		SSRF_INFO("git storage: remote storage and local data diverged. Error: failed base tree lookup (%s)", giterr_last()->message);
 		goto diverged_error;
 	}
-	if (git_merge_trees(&merged_index, repo, base_tree, local_tree, remote_tree, &merge_options)) {
-		SSRF_INFO("git storage: remote storage and local data diverged. Error: merge failed (%s)", giterr_last()->message);
+	git_oid merge_oid, commit_oid;
+	if (merge_git_tree_level(repo, &merge_oid, base_tree, local_tree, remote_tree, &conflicts)) {
+		SSRF_INFO("git storage: remote storage and local data diverged. Error: merge failed (%s)", giterr_last() ? giterr_last()->message : "");
 		// this is the one where I want to report more detail to the user - can't quite explain why
-		return report_error(translate("gettextFromC", "Remote storage and local data diverged. Error: merge failed (%s)"), giterr_last()->message);
-	}
-	if (git_index_has_conflicts(merged_index)) {
-		int error;
-		const git_index_entry *ancestor = NULL,
-				*ours = NULL,
-				*theirs = NULL;
-		git_index_conflict_iterator *iter = NULL;
-		error = git_index_conflict_iterator_new(&iter, merged_index);
-		while (git_index_conflict_next(&ancestor, &ours, &theirs, iter)
-		       != GIT_ITEROVER) {
-			/* Mark this conflict as resolved */
-			SSRF_INFO("git storage: conflict in %s / %s / %s -- ",
-				ours ? ours->path : "-",
-				theirs ? theirs->path : "-",
-				ancestor ? ancestor->path : "-");
-			if ((!ours && theirs && ancestor) ||
-			    (ours && !theirs && ancestor)) {
-				// the file was removed on one side or the other - just remove it
-				SSRF_INFO("git storage: looks like a delete on one side; removing the file from the index\n");
-				error = git_index_remove(merged_index, ours ? ours->path : theirs->path, GIT_INDEX_STAGE_ANY);
-			} else if (ancestor) {
-				error = git_index_conflict_remove(merged_index, ours ? ours->path : theirs ? theirs->path : ancestor->path);
-			}
-			if (error) {
-				SSRF_INFO("git storage: error at conflict resolution (%s)", giterr_last()->message);
-			}
-		}
-		git_index_conflict_cleanup(merged_index);
-		git_index_conflict_iterator_free(iter);
-		report_error(translate("gettextFromC", "Remote storage and local data diverged. Cannot combine local and remote changes"));
+		return report_error(translate("gettextFromC", "Remote storage and local data diverged. Error: merge failed (%s)"), giterr_last() ? giterr_last()->message : "");
 	}
-	git_oid merge_oid, commit_oid;
+	if (conflicts)
+		report_error(translate("gettextFromC", "Remote storage and local data diverged. Cannot combine local and remote changes"));
 	git_tree *merged_tree;
 	git_signature *author;
 	git_commit *commit;
 
-	if (git_index_write_tree_to(&merge_oid, merged_index, repo))
-		goto write_error;
 	if (git_tree_lookup(&merged_tree, repo, &merge_oid))
 		goto write_error;
 	if (get_authorship(repo, &author) < 0)
@@ -531,7 +745,10 @@ static int try_to_update(git_repository *repo, git_remote *origin, git_reference
 		if (verbose)
 			SSRF_INFO("git storage: remote is newer than local, update local");
 		git_storage_update_progress(translate("gettextFromC", "Update local storage to match cloud storage"));
-		return reset_to_remote(repo, local, remote_id);
+		int64_t start = monotonic_msecs();
+		ret = reset_to_remote(repo, local, remote_id);
+		git_sync_stats.checkout_msecs += (int)(monotonic_msecs() - start);
+		return ret;
 	}
 
 	/* Is the local repo the more recent one? See if we can update upstream */
@@ -559,7 +776,9 @@ static int try_to_update(git_repository *repo, git_remote *origin, git_reference
 	}
 	/* Ok, let's try to merge these */
 	git_storage_update_progress(translate("gettextFromC", "Try to merge local changes into cloud storage"));
+	int64_t start = monotonic_msecs();
 	ret = try_to_git_merge(repo, &local, remote, &base, local_id, remote_id);
+	git_sync_stats.merge_msecs += (int)(monotonic_msecs() - start);
 	if (ret == 0)
 		return update_remote(repo, origin, local, remote, rt);
 	else
@@ -609,7 +828,7 @@ static int check_remote_status(git_repository *repo, git_remote *origin, const c
 		git_reference_free(remote_ref);
 	}
 	git_reference_free(local_ref);
-	git_remote_sync_successful = (error == 0);
+	git_remote_sync_successful = (error == 0) && !git_sync_stats.postponed_pushes;
 	return error;
 }
 
@@ -664,7 +883,62 @@ void delete_remote_branch(git_repository *repo, const char *remote, const char *
 	return;
 }
 
-int sync_with_remote(git_repository *repo, const char *remote, const char *branch, enum remote_transport rt)
+/* The id of our remote tracking branch, i.e. what we know of the remote */
+static bool get_upstream_id(git_repository *repo, const char *branch, git_oid *id)
+{
+	git_reference *local_ref, *remote_ref;
+	const git_oid *target;
+	bool found = false;
+
+	if (git_branch_lookup(&local_ref, repo, branch, GIT_BRANCH_LOCAL))
+		return false;
+	if (!git_branch_upstream(&remote_ref, local_ref)) {
+		target = git_reference_target(remote_ref);
+		if (target) {
+			git_oid_cpy(id, target);
+			found = true;
+		}
+		git_reference_free(remote_ref);
+	}
+	git_reference_free(local_ref);
+	return found;
+}
+
+/*
+ * Like "git ls-remote": ask the server for the id of the branch. That's a
+ * single round trip, while a fetch also negotiates which objects to send.
+ */
+static bool ls_remote_branch(git_remote *origin, const char *branch, enum remote_transport rt, git_oid *id)
+{
+	git_remote_callbacks callbacks = GIT_REMOTE_CALLBACKS_INIT;
+	const git_remote_head **heads;
+	size_t count, i;
+	bool found = false;
+	char *ref = format_string("refs/heads/%s", branch);
+
+	auth_attempt = 0;
+	if (rt == RT_SSH)
+		callbacks.credentials = credential_ssh_cb;
+	else if (rt == RT_HTTPS)
+		callbacks.credentials = credential_https_cb;
+	callbacks.certificate_check = certificate_check_cb;
+	if (git_remote_connect(origin, GIT_DIRECTION_FETCH, &callbacks, NULL, NULL) == 0) {
+		if (git_remote_ls(&heads, &count, origin) == 0) {
+			for (i = 0; i < count; i++) {
+				if (!strcmp(heads[i]->name, ref)) {
+					git_oid_cpy(id, &heads[i]->oid);
+					found = true;
+					break;
+				}
+			}
+		}
+		git_remote_disconnect(origin);
+	}
+	free(ref);
+	return found;
+}
+
+static int do_sync_with_remote(git_repository *repo, const char *remote, const char *branch, enum remote_transport rt)
 {
 	int error;
 	git_remote *origin;
@@ -678,6 +952,7 @@ int sync_with_remote(git_repository *repo, const char *remote, const char *branc
 	}
 	if (verbose)
 		SSRF_INFO("git storage: sync with remote %s[%s]\n", remote, branch);
+	start_sync_stats();
 	git_storage_update_progress(translate("gettextFromC", "Sync with cloud storage"));
 	git_repository_config(&conf, repo);
 	if (rt == RT_HTTPS && getProxyString(&proxy_string)) {
@@ -704,6 +979,20 @@ int sync_with_remote(git_repository *repo, const char *remote, const char *branc
 		return 0;
 	}
 
+	/*
+	 * If the remote branch was checked recently and our copy of it
+	 * is still the same, neither probe the server nor fetch.
+	 */
+	git_oid upstream_id, remote_id;
+	bool checked_server = false;
+	bool have_upstream = get_upstream_id(repo, branch, &upstream_id);
+	if (have_upstream && remote_status_cache_matches(remote, branch, &upstream_id)) {
+		if (verbose)
+			SSRF_INFO("git storage: remote checked recently, skip fetch\n");
+		error = check_remote_status(repo, origin, remote, branch, rt);
+		goto done;
+	}
+
 	if (is_subsurface_cloud && !canReachCloudServer()) {
 		// this is not an error, just a warning message, so return 0
 		SSRF_INFO("git storage: cannot connect to remote server");
@@ -711,6 +1000,15 @@ int sync_with_remote(git_repository *repo, const char *remote, const char *branc
 		git_storage_update_progress(translate("gettextFromC", "Can't reach cloud server, working with local data"));
 		return 0;
 	}
+
+	/* If the server has the branch we already know, there is nothing to fetch */
+	if (have_upstream && ls_remote_branch(origin, branch, rt, &remote_id) && git_oid_equal(&remote_id, &upstream_id)) {
+		if (verbose)
+			SSRF_INFO("git storage: remote unchanged, skip fetch\n");
+		checked_server = true;
+		error = check_remote_status(repo, origin, remote, branch, rt);
+		goto done;
+	}
 	if (verbose)
 		SSRF_INFO("git storage: fetch remote\n");
 	git_fetch_options opts = GIT_FETCH_OPTIONS_INIT;
@@ -722,7 +1020,9 @@ int sync_with_remote(git_repository *repo, const char *remote, const char *branc
 		opts.callbacks.credentials = credential_https_cb;
 	opts.callbacks.certificate_check = certificate_check_cb;
 	git_storage_update_progress(translate("gettextFromC", "Successful cloud connection, fetch remote"));
+	int64_t start = monotonic_msecs();
 	error = git_remote_fetch(origin, NULL, &opts, NULL);
+	git_sync_stats.fetch_msecs += (int)(monotonic_msecs() - start);
 	// NOTE! A fetch error is not fatal, we just report it
 	if (error) {
 		if (is_subsurface_cloud)
@@ -733,15 +1033,33 @@ int sync_with_remote(git_repository *repo, const char *remote, const char *branc
 		SSRF_INFO("git storage: remote fetch failed (%s)\n", giterr_last() ? giterr_last()->message : "authentication failed");
 		// Since we failed to sync with online repository, enter offline mode
 		git_local_only = true;
+		invalidate_remote_status_cache();
 		error = 0;
-	} else {
-		error = check_remote_status(repo, origin, remote, branch, rt);
+		goto out;
 	}
+	checked_server = true;
+	error = check_remote_status(repo, origin, remote, branch, rt);
+done:
+	/* After a push or update, our copy of the remote branch matches the server */
+	if (!error && git_remote_sync_successful && get_upstream_id(repo, branch, &upstream_id))
+		set_remote_status_cache(remote, branch, &upstream_id, checked_server);
+	else
+		invalidate_remote_status_cache();
+out:
 	git_remote_free(origin);
+	finish_sync_stats();
 	git_storage_update_progress(translate("gettextFromC", "Done syncing with cloud storage"));
 	return error;
 }
 
+int sync_with_remote(git_repository *repo, const char *remote, const char *branch, enum remote_transport rt)
+{
+	struct trace_span span = trace_begin("sync_with_remote");
+	int ret = do_sync_with_remote(repo, remote, branch, rt);
+	trace_end(span);
+	return ret;
+}
+
 static git_repository *update_local_repo(const char *localdir, const char *remote, const char *branch, enum remote_transport rt)
 {
 	int error;
@@ -869,13 +1187,26 @@ static git_repository *create_local_repo(const char *localdir, const char *remot
 	opts.fetch_opts.callbacks.certificate_check = certificate_check_cb;
 
 	opts.checkout_branch = branch;
+#ifdef HAVE_SHALLOW_CLONE
+	/*
+	 * We only ever work with the current tree of the cloud storage, so
+	 * don't download its whole history. Later fetches only bring in the
+	 * commits on top of that, which is all that merging needs.
+	 */
+	if (is_subsurface_cloud)
+		opts.fetch_opts.depth = 1;
+#endif
 	if (is_subsurface_cloud && !canReachCloudServer()) {
 		SSRF_INFO("git storage: cannot reach remote server");
 		return 0;
 	}
 	if (verbose > 1)
 		SSRF_INFO("git storage: calling git_clone()\n");
+	start_sync_stats();
+	int64_t start = monotonic_msecs();
 	error = git_clone(&cloned_repo, remote, localdir, &opts);
+	git_sync_stats.fetch_msecs = (int)(monotonic_msecs() - start);
+	finish_sync_stats();
 	if (verbose > 1)
 		SSRF_INFO("git storage: returned from git_clone() with return value %d\n", error);
 	if (error) {
@@ -1039,6 +1370,9 @@ struct git_repository *is_git_repository(const char *filename, const char **bran
 	git_repository *repo;
 	char *loc, *branch;
 
+	/* a sync that is still running in the background would race with us */
+	wait_for_background_sync();
+
 	/* we are looking at a new potential remote, but we haven't synced with it */
 	git_remote_sync_successful = false;
 
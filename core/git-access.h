@@ -17,6 +17,14 @@ extern "C" {
 
 enum remote_transport { RT_OTHER, RT_HTTPS, RT_SSH };
 
+/* What synchronizing with the remote cost, to see where the bytes go */
+struct git_sync_stats {
+	size_t bytes_received, bytes_sent;
+	unsigned int objects_received, objects_sent;
+	int fetch_msecs, merge_msecs, checkout_msecs, push_msecs;
+	int postponed_pushes;
+};
+
 struct git_oid;
 struct git_repository;
 struct device_table;
@@ -28,15 +36,28 @@ extern int git_save_dives(struct git_repository *, const char *, const char *rem
 extern int git_load_dives(struct git_repository *repo, const char *branch, struct dive_table *table, struct trip_table *trips,
 			  struct dive_site_table *sites, struct device_table *devices,
 			  struct filter_preset_table *filter_presets);
+extern int git_load_dives_reuse(struct git_repository *repo, const char *branch, struct dive_table *old_dives, struct dive_table *table,
+				struct trip_table *trips, struct dive_site_table *sites, struct device_table *devices,
+				struct filter_preset_table *filter_presets);
 extern const char *get_sha(git_repository *repo, const char *branch);
 extern int do_git_save(git_repository *repo, const char *branch, const char *remote, bool select_only, bool create_empty);
 extern const char *saved_git_id;
 extern bool git_local_only;
+extern bool git_load_parallel;
+extern bool git_use_snapshot;
 extern bool git_remote_sync_successful;
+extern bool git_sync_in_background;
+extern struct git_sync_stats git_sync_stats;		/* the last sync */
+extern struct git_sync_stats git_sync_stats_total;	/* all syncs since program start */
 extern void clear_git_id(void);
 extern void set_git_id(const struct git_oid *);
 extern enum remote_transport url_to_remote_transport(const char *remote);
 void set_git_update_cb(int(*)(const char *));
+extern int (*update_progress_cb)(const char *);
+extern void start_background_sync(git_repository *repo, const char *remote, const char *branch, enum remote_transport rt);
+extern void wait_for_background_sync(void);
+extern void start_background_maintenance(git_repository *repo);
+extern int git_repository_maintenance(git_repository *repo);
 int git_storage_update_progress(const char *text);
 char *get_local_dir(const char *remote, const char *branch);
 int git_create_local_repo(const char *filename);
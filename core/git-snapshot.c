@@ -0,0 +1,706 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Binary snapshots of a loaded git repository.
+ *
+ * Parsing the text format of a big git repository takes a while, even
+ * though most of the time the same commit is loaded again and again.
+ * Therefore, after a successful load we dump the dive, trip and dive
+ * site tables in a simple binary format into the git directory. When
+ * the same commit is loaded the next time, the tables are read from the
+ * snapshot instead.
+ *
+ * The snapshot is a pure cache: it is only ever read by the same binary
+ * on the same machine, so everything is written in native byte order and
+ * the samples are dumped as raw memory. Any change to the in-memory data
+ * structures *must* bump SNAPSHOT_VERSION. If anything about a snapshot
+ * looks fishy, it is simply ignored and the repository parsed normally.
+ */
+#include "ssrf.h"
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <git2.h>
+
+#include "dive.h"
+#include "divesite.h"
+#include "event.h"
+#include "extradata.h"
+#include "file.h"
+#include "membuffer.h"
+#include "git-snapshot.h"
+#include "sample.h"
+#include "strndup.h"
+#include "subsurface-string.h"
+#include "tag.h"
+#include "trip.h"
+
+#define SNAPSHOT_MAGIC "SSRFSNAP"
+#define SNAPSHOT_VERSION 1
+#define SNAPSHOT_NAME "subsurface.snapshot"
+
+/* A string length of this value marks a NULL string */
+#define NULL_STRING 0xffffffffu
+
+struct snapshot_header {
+	char magic[8];
+	uint32_t version;
+	uint32_t sample_size;
+	uint32_t event_size;
+	char sha[GIT_OID_HEXSZ];
+};
+
+static char *snapshot_filename(git_repository *repo)
+{
+	return format_string("%s%s", git_repository_path(repo), SNAPSHOT_NAME);
+}
+
+/* Writing */
+
+static void write_u32(FILE *f, uint32_t val)
+{
+	fwrite(&val, sizeof(val), 1, f);
+}
+
+static void write_i32(FILE *f, int32_t val)
+{
+	fwrite(&val, sizeof(val), 1, f);
+}
+
+static void write_i64(FILE *f, int64_t val)
+{
+	fwrite(&val, sizeof(val), 1, f);
+}
+
+static void write_str(FILE *f, const char *s)
+{
+	uint32_t len;
+
+	if (!s) {
+		write_u32(f, NULL_STRING);
+		return;
+	}
+	len = strlen(s);
+	write_u32(f, len);
+	fwrite(s, 1, len, f);
+}
+
+static void write_location(FILE *f, const location_t *loc)
+{
+	write_i32(f, loc->lat.udeg);
+	write_i32(f, loc->lon.udeg);
+}
+
+static void write_site(FILE *f, const struct dive_site *ds)
+{
+	write_u32(f, ds->uuid);
+	write_str(f, ds->name);
+	write_location(f, &ds->location);
+	write_str(f, ds->description);
+	write_str(f, ds->notes);
+	write_i32(f, ds->taxonomy.nr);
+	for (int i = 0; i < ds->taxonomy.nr; i++) {
+		const struct taxonomy *t = &ds->taxonomy.category[i];
+		write_i32(f, t->category);
+		write_str(f, t->value);
+		write_i32(f, t->origin);
+	}
+}
+
+static void write_cylinder(FILE *f, const cylinder_t *cyl)
+{
+	write_i32(f, cyl->type.size.mliter);
+	write_i32(f, cyl->type.workingpressure.mbar);
+	write_str(f, cyl->type.description);
+	write_i32(f, cyl->gasmix.o2.permille);
+	write_i32(f, cyl->gasmix.he.permille);
+	write_i32(f, cyl->start.mbar);
+	write_i32(f, cyl->end.mbar);
+	write_i32(f, cyl->sample_start.mbar);
+	write_i32(f, cyl->sample_end.mbar);
+	write_i32(f, cyl->depth.mm);
+	write_i32(f, cyl->manually_added);
+	write_i32(f, cyl->gas_used.mliter);
+	write_i32(f, cyl->deco_gas_used.mliter);
+	write_i32(f, cyl->cylinder_use);
+	write_i32(f, cyl->bestmix_o2);
+	write_i32(f, cyl->bestmix_he);
+}
+
+static void write_event(FILE *f, const struct event *ev)
+{
+	write_i32(f, ev->time.seconds);
+	write_i32(f, ev->type);
+	write_i32(f, ev->flags);
+	write_i32(f, ev->value);
+	/* gas.index shares its storage with divemode */
+	write_i32(f, ev->gas.index);
+	write_i32(f, ev->gas.mix.o2.permille);
+	write_i32(f, ev->gas.mix.he.permille);
+	write_i32(f, ev->deleted);
+	write_str(f, ev->name);
+}
+
+static void write_dc(FILE *f, const struct divecomputer *dc)
+{
+	const struct event *ev;
+	const struct extra_data *ed;
+	int nr;
+
+	write_i64(f, dc->when);
+	write_i32(f, dc->duration.seconds);
+	write_i32(f, dc->surfacetime.seconds);
+	write_i32(f, dc->last_manual_time.seconds);
+	write_i32(f, dc->maxdepth.mm);
+	write_i32(f, dc->meandepth.mm);
+	write_u32(f, dc->airtemp.mkelvin);
+	write_u32(f, dc->watertemp.mkelvin);
+	write_i32(f, dc->surface_pressure.mbar);
+	write_i32(f, dc->divemode);
+	write_i32(f, dc->no_o2sensors);
+	write_i32(f, dc->salinity);
+	write_str(f, dc->model);
+	write_str(f, dc->serial);
+	write_str(f, dc->fw_version);
+	write_u32(f, dc->deviceid);
+	write_u32(f, dc->diveid);
+
+	write_i32(f, dc->samples);
+	fwrite(dc->sample, sizeof(struct sample), dc->samples, f);
+
+	for (nr = 0, ev = dc->events; ev; ev = ev->next)
+		nr++;
+	write_i32(f, nr);
+	for (ev = dc->events; ev; ev = ev->next)
+		write_event(f, ev);
+
+	write_i32(f, dc->nr_extra_data);
+	for (int i = 0; i < dc->nr_extra_data; i++) {
+		ed = &dc->extra_data[i];
+		write_str(f, ed->key);
+		write_str(f, ed->value);
+	}
+}
+
+/* The dives refer to their trip by index, which we look up in a sorted array */
+struct trip_index {
+	const struct dive_trip *trip;
+	int idx;
+};
+
+static int comp_trip_index(const void *_a, const void *_b)
+{
+	const struct trip_index *a = _a, *b = _b;
+
+	if (a->trip == b->trip)
+		return 0;
+	return a->trip < b->trip ? -1 : 1;
+}
+
+static int get_trip_index(const struct dive_trip *trip, const struct trip_index *index, int nr)
+{
+	struct trip_index key = { trip, -1 };
+	const struct trip_index *res;
+
+	if (!trip)
+		return -1;
+	res = bsearch(&key, index, nr, sizeof(*index), comp_trip_index);
+	return res ? res->idx : -1;
+}
+
+static void write_dive(FILE *f, const struct dive *dive, const struct trip_index *trip_index, int nr_trips)
+{
+	const struct divecomputer *dc;
+	const struct tag_entry *tag;
+	int nr;
+
+	write_i32(f, get_trip_index(dive->divetrip, trip_index, nr_trips));
+	write_u32(f, dive->dive_site ? dive->dive_site->uuid : 0);
+	write_i64(f, dive->when);
+	write_str(f, dive->notes);
+	write_str(f, dive->divemaster);
+	write_str(f, dive->buddy);
+	write_str(f, dive->suit);
+	write_i32(f, dive->number);
+	write_i32(f, dive->rating);
+	write_i32(f, dive->wavesize);
+	write_i32(f, dive->current);
+	write_i32(f, dive->visibility);
+	write_i32(f, dive->surge);
+	write_i32(f, dive->chill);
+	write_i32(f, dive->sac);
+	write_i32(f, dive->otu);
+	write_i32(f, dive->cns);
+	write_i32(f, dive->maxcns);
+	write_u32(f, dive->mintemp.mkelvin);
+	write_u32(f, dive->maxtemp.mkelvin);
+	write_u32(f, dive->watertemp.mkelvin);
+	write_u32(f, dive->airtemp.mkelvin);
+	write_i32(f, dive->maxdepth.mm);
+	write_i32(f, dive->meandepth.mm);
+	write_i32(f, dive->surface_pressure.mbar);
+	write_i32(f, dive->duration.seconds);
+	write_i32(f, dive->salinity);
+	write_i32(f, dive->user_salinity);
+	write_i32(f, dive->notrip);
+	write_i32(f, dive->invalid);
+	fwrite(dive->git_id, 1, sizeof(dive->git_id), f);
+
+	write_i32(f, dive->cylinders.nr);
+	for (int i = 0; i < dive->cylinders.nr; i++)
+		write_cylinder(f, &dive->cylinders.cylinders[i]);
+
+	write_i32(f, dive->weightsystems.nr);
+	for (int i = 0; i < dive->weightsystems.nr; i++) {
+		const weightsystem_t *ws = &dive->weightsystems.weightsystems[i];
+		write_i32(f, ws->weight.grams);
+		write_str(f, ws->description);
+		write_i32(f, ws->auto_filled);
+	}
+
+	/* Like the savers, we write the untranslated tag */
+	for (nr = 0, tag = dive->tag_list; tag; tag = tag->next)
+		nr++;
+	write_i32(f, nr);
+	for (tag = dive->tag_list; tag; tag = tag->next)
+		write_str(f, tag->tag->source ? : tag->tag->name);
+
+	write_i32(f, dive->pictures.nr);
+	for (int i = 0; i < dive->pictures.nr; i++) {
+		const struct picture *pic = &dive->pictures.pictures[i];
+		write_str(f, pic->filename);
+		write_i32(f, pic->offset.seconds);
+		write_location(f, &pic->location);
+	}
+
+	for (nr = 0, dc = &dive->dc; dc; dc = dc->next)
+		nr++;
+	write_i32(f, nr);
+	for (dc = &dive->dc; dc; dc = dc->next)
+		write_dc(f, dc);
+}
+
+void save_git_snapshot(git_repository *repo, const char *sha, const struct dive_table *table,
+		       const struct trip_table *trips, const struct dive_site_table *sites)
+{
+	struct snapshot_header header = { SNAPSHOT_MAGIC, SNAPSHOT_VERSION, sizeof(struct sample), sizeof(struct event) };
+	char *filename = snapshot_filename(repo);
+	char *tmpname = format_string("%s.tmp", filename);
+	struct trip_index *trip_index;
+	FILE *f;
+	int error;
+
+	memcpy(header.sha, sha, GIT_OID_HEXSZ);
+	f = subsurface_fopen(tmpname, "wb");
+	if (!f)
+		goto out;
+	fwrite(&header, sizeof(header), 1, f);
+
+	write_i32(f, sites->nr);
+	for (int i = 0; i < sites->nr; i++)
+		write_site(f, sites->dive_sites[i]);
+
+	write_i32(f, trips->nr);
+	for (int i = 0; i < trips->nr; i++) {
+		write_str(f, trips->trips[i]->location);
+		write_str(f, trips->trips[i]->notes);
+	}
+
+	trip_index = malloc(trips->nr * sizeof(*trip_index) + 1);
+	if (!trip_index)
+		exit(1);
+	for (int i = 0; i < trips->nr; i++) {
+		trip_index[i].trip = trips->trips[i];
+		trip_index[i].idx = i;
+	}
+	qsort(trip_index, trips->nr, sizeof(*trip_index), comp_trip_index);
+
+	write_i32(f, table->nr);
+	for (int i = 0; i < table->nr; i++)
+		write_dive(f, table->dives[i], trip_index, trips->nr);
+	free(trip_index);
+
+	error = ferror(f);
+	if (fclose(f) || error || subsurface_rename(tmpname, filename))
+		remove(tmpname);
+out:
+	free(tmpname);
+	free(filename);
+}
+
+/* Reading */
+
+struct snapshot_reader {
+	const char *p, *end;
+	bool error;
+};
+
+static const void *read_bytes(struct snapshot_reader *r, size_t len)
+{
+	const char *res = r->p;
+
+	if (r->error || (size_t)(r->end - r->p) < len) {
+		r->error = true;
+		return NULL;
+	}
+	r->p += len;
+	return res;
+}
+
+static uint32_t read_u32(struct snapshot_reader *r)
+{
+	uint32_t val = 0;
+	const void *p = read_bytes(r, sizeof(val));
+
+	if (p)
+		memcpy(&val, p, sizeof(val));
+	return val;
+}
+
+static int32_t read_i32(struct snapshot_reader *r)
+{
+	return (int32_t)read_u32(r);
+}
+
+static int64_t read_i64(struct snapshot_reader *r)
+{
+	int64_t val = 0;
+	const void *p = read_bytes(r, sizeof(val));
+
+	if (p)
+		memcpy(&val, p, sizeof(val));
+	return val;
+}
+
+/* Returns a newly allocated string */
+static char *read_str(struct snapshot_reader *r)
+{
+	uint32_t len = read_u32(r);
+	const char *p;
+
+	if (r->error || len == NULL_STRING)
+		return NULL;
+	p = read_bytes(r, len);
+	return p ? strndup(p, len) : NULL;
+}
+
+/* Counts must be non-negative - everything else means a corrupt file */
+static int read_count(struct snapshot_reader *r)
+{
+	int32_t nr = read_i32(r);
+
+	if (nr < 0)
+		r->error = true;
+	return r->error ? 0 : nr;
+}
+
+static void read_location(struct snapshot_reader *r, location_t *loc)
+{
+	loc->lat.udeg = read_i32(r);
+	loc->lon.udeg = read_i32(r);
+}
+
+static void read_site(struct snapshot_reader *r, struct dive_site_table *sites)
+{
+	struct dive_site *ds = alloc_or_get_dive_site(read_u32(r), sites);
+	int nr;
+
+	ds->name = read_str(r);
+	invalidate_dive_site_name_index();
+	read_location(r, &ds->location);
+	invalidate_dive_site_gps_index();
+	ds->description = read_str(r);
+	ds->notes = read_str(r);
+	nr = read_count(r);
+	for (int i = 0; i < nr && !r->error; i++) {
+		int category = read_i32(r);
+		char *value = read_str(r);
+		int origin = read_i32(r);
+		taxonomy_set_category(&ds->taxonomy, category, value, origin);
+		free(value);
+	}
+}
+
+static void read_cylinder(struct snapshot_reader *r, struct dive *dive)
+{
+	cylinder_t cyl = empty_cylinder;
+
+	cyl.type.size.mliter = read_i32(r);
+	cyl.type.workingpressure.mbar = read_i32(r);
+	cyl.type.description = read_str(r);
+	cyl.gasmix.o2.permille = read_i32(r);
+	cyl.gasmix.he.permille = read_i32(r);
+	cyl.start.mbar = read_i32(r);
+	cyl.end.mbar = read_i32(r);
+	cyl.sample_start.mbar = read_i32(r);
+	cyl.sample_end.mbar = read_i32(r);
+	cyl.depth.mm = read_i32(r);
+	cyl.manually_added = read_i32(r);
+	cyl.gas_used.mliter = read_i32(r);
+	cyl.deco_gas_used.mliter = read_i32(r);
+	cyl.cylinder_use = read_i32(r);
+	cyl.bestmix_o2 = read_i32(r);
+	cyl.bestmix_he = read_i32(r);
+	add_cylinder(&dive->cylinders, dive->cylinders.nr, cyl);
+}
+
+static void read_event(struct snapshot_reader *r, struct divecomputer *dc)
+{
+	int time = read_i32(r);
+	int type = read_i32(r);
+	int flags = read_i32(r);
+	int value = read_i32(r);
+	int index = read_i32(r);
+	int o2 = read_i32(r);
+	int he = read_i32(r);
+	bool deleted = read_i32(r);
+	char *name = read_str(r);
+	struct event *ev;
+
+	if (r->error) {
+		free(name);
+		return;
+	}
+	ev = create_event(time, type, flags, value, name ? name : "");
+	free(name);
+	if (!ev)
+		return;
+	ev->gas.index = index;
+	ev->gas.mix.o2.permille = o2;
+	ev->gas.mix.he.permille = he;
+	ev->deleted = deleted;
+	add_event_to_dc(dc, ev);
+	remember_event(ev->name);
+}
+
+static void read_dc(struct snapshot_reader *r, struct divecomputer *dc)
+{
+	const void *samples;
+	int nr;
+
+	dc->when = read_i64(r);
+	dc->duration.seconds = read_i32(r);
+	dc->surfacetime.seconds = read_i32(r);
+	dc->last_manual_time.seconds = read_i32(r);
+	dc->maxdepth.mm = read_i32(r);
+	dc->meandepth.mm = read_i32(r);
+	dc->airtemp.mkelvin = read_u32(r);
+	dc->watertemp.mkelvin = read_u32(r);
+	dc->surface_pressure.mbar = read_i32(r);
+	dc->divemode = read_i32(r);
+	dc->no_o2sensors = read_i32(r);
+	dc->salinity = read_i32(r);
+	dc->model = read_str(r);
+	dc->serial = read_str(r);
+	dc->fw_version = read_str(r);
+	dc->deviceid = read_u32(r);
+	dc->diveid = read_u32(r);
+
+	nr = read_count(r);
+	samples = read_bytes(r, (size_t)nr * sizeof(struct sample));
+	if (samples && nr) {
+		alloc_samples(dc, nr);
+		memcpy(dc->sample, samples, nr * sizeof(struct sample));
+		dc->samples = nr;
+	}
+
+	nr = read_count(r);
+	for (int i = 0; i < nr && !r->error; i++)
+		read_event(r, dc);
+
+	nr = read_count(r);
+	for (int i = 0; i < nr && !r->error; i++) {
+		char *key = read_str(r);
+		char *value = read_str(r);
+		if (key && value)
+			add_extra_data(dc, key, value);
+		free(key);
+		free(value);
+	}
+}
+
+/* The trips are passed as a plain array, because they are only inserted into the trip table once their dives are known */
+struct snapshot_trips {
+	int nr;
+	dive_trip_t **trips;
+};
+
+static struct dive *read_dive(struct snapshot_reader *r, const struct snapshot_trips *trips, struct dive_site_table *sites)
+{
+	struct dive *dive = alloc_dive();
+	struct divecomputer *dc;
+	const void *git_id;
+	int trip_idx, nr;
+	uint32_t site_uuid;
+
+	trip_idx = read_i32(r);
+	site_uuid = read_u32(r);
+	dive->when = read_i64(r);
+	dive->notes = read_str(r);
+	dive->divemaster = read_str(r);
+	dive->buddy = read_str(r);
+	dive->suit = read_str(r);
+	dive->number = read_i32(r);
+	dive->rating = read_i32(r);
+	dive->wavesize = read_i32(r);
+	dive->current = read_i32(r);
+	dive->visibility = read_i32(r);
+	dive->surge = read_i32(r);
+	dive->chill = read_i32(r);
+	dive->sac = read_i32(r);
+	dive->otu = read_i32(r);
+	dive->cns = read_i32(r);
+	dive->maxcns = read_i32(r);
+	dive->mintemp.mkelvin = read_u32(r);
+	dive->maxtemp.mkelvin = read_u32(r);
+	dive->watertemp.mkelvin = read_u32(r);
+	dive->airtemp.mkelvin = read_u32(r);
+	dive->maxdepth.mm = read_i32(r);
+	dive->meandepth.mm = read_i32(r);
+	dive->surface_pressure.mbar = read_i32(r);
+	dive->duration.seconds = read_i32(r);
+	dive->salinity = read_i32(r);
+	dive->user_salinity = read_i32(r);
+	dive->notrip = read_i32(r);
+	dive->invalid = read_i32(r);
+	git_id = read_bytes(r, sizeof(dive->git_id));
+	if (git_id)
+		memcpy(dive->git_id, git_id, sizeof(dive->git_id));
+
+	nr = read_count(r);
+	for (int i = 0; i < nr && !r->error; i++)
+		read_cylinder(r, dive);
+
+	nr = read_count(r);
+	for (int i = 0; i < nr && !r->error; i++) {
+		weightsystem_t ws = empty_weightsystem;
+		ws.weight.grams = read_i32(r);
+		ws.description = read_str(r);
+		ws.auto_filled = read_i32(r);
+		add_to_weightsystem_table(&dive->weightsystems, dive->weightsystems.nr, ws);
+	}
+
+	nr = read_count(r);
+	for (int i = 0; i < nr && !r->error; i++) {
+		char *tag = read_str(r);
+		if (tag)
+			taglist_add_tag(&dive->tag_list, tag);
+		free(tag);
+	}
+
+	nr = read_count(r);
+	for (int i = 0; i < nr && !r->error; i++) {
+		struct picture pic = empty_picture;
+		pic.filename = read_str(r);
+		pic.offset.seconds = read_i32(r);
+		read_location(r, &pic.location);
+		add_to_picture_table(&dive->pictures, dive->pictures.nr, pic);
+	}
+
+	nr = read_count(r);
+	dc = &dive->dc;
+	for (int i = 0; i < nr && !r->error; i++) {
+		if (i > 0) {
+			dc->next = calloc(1, sizeof(*dc));
+			if (!dc->next)
+				exit(1);
+			dc = dc->next;
+		}
+		read_dc(r, dc);
+	}
+
+	if (trip_idx >= trips->nr)
+		r->error = true;
+	else if (trip_idx >= 0)
+		add_dive_to_trip(dive, trips->trips[trip_idx]);
+	if (site_uuid) {
+		struct dive_site *ds = get_dive_site_by_uuid(site_uuid, sites);
+		if (ds)
+			add_dive_to_dive_site(dive, ds);
+		else
+			r->error = true;
+	}
+	return dive;
+}
+
+static bool load_snapshot_buffer(struct snapshot_reader *r, const char *sha, struct dive_table *table,
+				 struct snapshot_trips *trips, struct dive_site_table *sites)
+{
+	const struct snapshot_header *header = read_bytes(r, sizeof(*header));
+	int nr;
+
+	if (!header ||
+	    memcmp(header->magic, SNAPSHOT_MAGIC, sizeof(header->magic)) ||
+	    header->version != SNAPSHOT_VERSION ||
+	    header->sample_size != sizeof(struct sample) ||
+	    header->event_size != sizeof(struct event) ||
+	    memcmp(header->sha, sha, GIT_OID_HEXSZ))
+		return false;
+
+	nr = read_count(r);
+	for (int i = 0; i < nr && !r->error; i++)
+		read_site(r, sites);
+
+	nr = read_count(r);
+	if (r->error || (size_t)nr > (size_t)(r->end - r->p))
+		return false;
+	trips->trips = calloc(nr + 1, sizeof(*trips->trips));
+	if (!trips->trips)
+		exit(1);
+	for (int i = 0; i < nr && !r->error; i++) {
+		dive_trip_t *trip = alloc_trip();
+		trip->location = read_str(r);
+		trip->notes = read_str(r);
+		trips->trips[trips->nr++] = trip;
+	}
+
+	nr = read_count(r);
+	for (int i = 0; i < nr && !r->error; i++)
+		add_to_dive_table(table, table->nr, read_dive(r, trips, sites));
+
+	return !r->error && r->p == r->end;
+}
+
+bool load_git_snapshot(git_repository *repo, const char *sha, struct dive_table *table,
+		       struct trip_table *trips, struct dive_site_table *sites)
+{
+	struct dive_table snapshot_dives = empty_dive_table;
+	struct snapshot_trips snapshot_trips = { 0, NULL };
+	struct dive_site_table snapshot_sites = empty_dive_site_table;
+	char *filename = snapshot_filename(repo);
+	struct memblock mem;
+	struct snapshot_reader r;
+	bool ok;
+
+	ok = mapfile(filename, &mem) >= 0;
+	free(filename);
+	if (!ok)
+		return false;
+
+	r.p = mem.buffer;
+	r.end = r.p + mem.size;
+	r.error = false;
+	ok = load_snapshot_buffer(&r, sha, &snapshot_dives, &snapshot_trips, &snapshot_sites);
+	free_memblock(&mem);
+
+	if (!ok) {
+		clear_dive_table(&snapshot_dives);
+		for (int i = 0; i < snapshot_trips.nr; i++)
+			free_trip(snapshot_trips.trips[i]);
+		clear_dive_site_table(&snapshot_sites);
+		free(snapshot_dives.dives);
+		free(snapshot_trips.trips);
+		free(snapshot_sites.dive_sites);
+		return false;
+	}
+
+	for (int i = 0; i < snapshot_sites.nr; i++)
+		add_dive_site_to_table(snapshot_sites.dive_sites[i], sites);
+	for (int i = 0; i < snapshot_trips.nr; i++)
+		insert_trip(snapshot_trips.trips[i], trips);
+	for (int i = 0; i < snapshot_dives.nr; i++)
+		record_dive_to_table(snapshot_dives.dives[i], table);
+	free(snapshot_dives.dives);
+	free(snapshot_trips.trips);
+	free(snapshot_sites.dive_sites);
+	return true;
+}
@@ -0,0 +1,28 @@
+// SPDX-License-Identifier: GPL-2.0
+#ifndef GIT_SNAPSHOT_H
+#define GIT_SNAPSHOT_H
+
+#include "git2.h"
+
+struct dive_table;
+struct dive_site_table;
+struct trip_table;
+
+#ifdef __cplusplus
+extern "C" {
+#else
+#include <stdbool.h>
+#endif
+
+// Binary cache of the dive, trip and dive site tables of a git repository,
+// keyed by the SHA of the commit they were loaded from.
+extern void save_git_snapshot(git_repository *repo, const char *sha, const struct dive_table *table,
+			      const struct trip_table *trips, const struct dive_site_table *sites);
+extern bool load_git_snapshot(git_repository *repo, const char *sha, struct dive_table *table,
+			      struct trip_table *trips, struct dive_site_table *sites);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
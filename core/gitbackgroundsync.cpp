@@ -0,0 +1,99 @@
+// SPDX-License-Identifier: GPL-2.0
+// Sync a local git repository with its remote on a worker thread,
+// so that the UI stays responsive while talking to the cloud server.
+// The maintenance of the local repository happens there as well.
+#include "git-access.h"
+#include "errorhelper.h"
+#include "taskqueue.h"
+#include <QCoreApplication>
+#include <QThread>
+#include <QTimer>
+#include <atomic>
+#include <memory>
+#include <string>
+
+bool git_sync_in_background = false;
+
+// Only one sync at a time. It mostly waits for the server, so it runs
+// in the I/O pool and keeps the global pool free for parallel_for()
+static TaskQueue syncQueue(TaskClass::BulkIO, 1);
+static int (*foregroundProgressCb)(const char *) = nullptr;
+// The latest progress message of the worker that the GUI thread hasn't shown yet
+static std::atomic<std::string *> pendingProgress(nullptr);
+
+static bool onGuiThread()
+{
+	return !qApp || QThread::currentThread() == qApp->thread();
+}
+
+static void showPendingProgress()
+{
+	std::unique_ptr<std::string> msg(pendingProgress.exchange(nullptr));
+	if (msg && foregroundProgressCb)
+		foregroundProgressCb(msg->c_str());
+}
+
+// The progress callbacks update widgets, therefore forward the messages
+// of the worker thread to the GUI thread. Messages that arrive while the
+// GUI thread is busy replace each other, so that a fast transfer only
+// queues one update at a time instead of flooding the event loop. A
+// background sync can't be canceled, so the return value of the callback
+// is ignored.
+static int backgroundProgressCb(const char *text)
+{
+	if (onGuiThread())
+		return foregroundProgressCb ? foregroundProgressCb(text) : 0;
+
+	std::string *old = pendingProgress.exchange(new std::string(text));
+	if (old)
+		delete old;
+	else
+		QTimer::singleShot(0, qApp, &showPendingProgress);
+	return 0;
+}
+
+extern "C" void wait_for_background_sync()
+{
+	syncQueue.waitForDone();
+}
+
+// The caller frees its repository handle, so the worker opens its own
+template <typename Job>
+static void runInBackground(git_repository *repo, Job job)
+{
+	wait_for_background_sync();
+
+	std::string path(git_repository_path(repo));
+	syncQueue.run([path, job]() {
+		git_repository *workerRepo;
+		if (git_repository_open(&workerRepo, path.c_str())) {
+			report_error("Unable to open git repository '%s' for syncing", path.c_str());
+			return;
+		}
+		job(workerRepo);
+		git_repository_free(workerRepo);
+	});
+}
+
+extern "C" void start_background_sync(git_repository *repo, const char *remote, const char *branch, enum remote_transport rt)
+{
+	if (update_progress_cb != &backgroundProgressCb) {
+		foregroundProgressCb = update_progress_cb;
+		set_git_update_cb(&backgroundProgressCb);
+	}
+
+	std::string remoteString(remote);
+	std::string branchString(branch);
+	runInBackground(repo, [remoteString, branchString, rt](git_repository *syncRepo) {
+		sync_with_remote(syncRepo, remoteString.c_str(), branchString.c_str(), rt);
+		// The fetch may have added another pack
+		git_repository_maintenance(syncRepo);
+	});
+}
+
+extern "C" void start_background_maintenance(git_repository *repo)
+{
+	runInBackground(repo, [](git_repository *workerRepo) {
+		git_repository_maintenance(workerRepo);
+	});
+}
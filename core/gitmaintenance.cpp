@@ -0,0 +1,200 @@
+// SPDX-License-Identifier: GPL-2.0
+// Maintenance of the local git repositories. Every save adds loose objects
+// and every fetch adds a small pack, which makes object lookups slower over
+// time. When there are too many of them, write all reachable objects into
+// a single pack and remove the objects that it replaces, like "git gc --auto".
+#include "git-access.h"
+#include "qthelper.h"
+#include "trace.h"
+#include <git2.h>
+#include <git2/sys/odb_backend.h>
+#include <QDateTime>
+#include <QDir>
+#include <QDirIterator>
+#include <QElapsedTimer>
+#include <QFileInfo>
+
+// The defaults of git: the loose objects are estimated by counting the
+// objects in one of the 256 directories.
+static const int looseObjectLimit = 6700;
+static const int packLimit = 50;
+// Objects that are not reachable are only removed after two weeks,
+// a save of another instance of the program might be about to use them.
+static const qint64 pruneExpireSecs = 14 * 24 * 3600;
+
+static qint64 directorySize(const QString &path)
+{
+	qint64 size = 0;
+	QDirIterator it(path, QDir::Files, QDirIterator::Subdirectories);
+	while (it.hasNext()) {
+		it.next();
+		size += it.fileInfo().size();
+	}
+	return size;
+}
+
+static QStringList packFiles(const QDir &packDir)
+{
+	return packDir.entryList(QStringList("pack-*.pack"), QDir::Files);
+}
+
+static bool needsMaintenance(const QDir &objectsDir)
+{
+	int looseIn17 = QDir(objectsDir.filePath("17")).entryList(QDir::Files).size();
+	return looseIn17 > (looseObjectLimit + 255) / 256 ||
+	       packFiles(QDir(objectsDir.filePath("pack"))).size() > packLimit;
+}
+
+static bool expired(const QFileInfo &info)
+{
+	return info.lastModified().secsTo(QDateTime::currentDateTime()) > pruneExpireSecs;
+}
+
+// An object database with only the given pack
+static git_odb *openPack(const QString &indexFile)
+{
+	git_odb *odb;
+	git_odb_backend *backend;
+	if (git_odb_new(&odb))
+		return nullptr;
+	if (git_odb_backend_one_pack(&backend, QFile::encodeName(indexFile).constData())) {
+		git_odb_free(odb);
+		return nullptr;
+	}
+	if (git_odb_add_backend(odb, backend, 1)) {
+		backend->free(backend);
+		git_odb_free(odb);
+		return nullptr;
+	}
+	return odb;
+}
+
+// Pack the objects that are reachable from any reference and return the name of the new pack
+static QString writePack(git_repository *repo, const QString &packDir)
+{
+	git_packbuilder *pb;
+	git_revwalk *walk;
+	git_reference_iterator *refs;
+	git_reference *ref;
+	QString name;
+
+	if (git_packbuilder_new(&pb, repo))
+		return name;
+	if (git_revwalk_new(&walk, repo)) {
+		git_packbuilder_free(pb);
+		return name;
+	}
+	git_revwalk_push_head(walk);
+	if (!git_reference_iterator_new(&refs, repo)) {
+		while (!git_reference_next(&ref, refs)) {
+			git_reference *resolved;
+			if (!git_reference_resolve(&resolved, ref)) {
+				// Commits are walked. A tag object is inserted by itself,
+				// references to anything else with all they point to.
+				const git_oid *target = git_reference_target(resolved);
+				if (git_revwalk_push(walk, target))
+					git_packbuilder_insert_recur(pb, target, nullptr);
+				else
+					git_packbuilder_insert(pb, target, nullptr);
+				git_reference_free(resolved);
+			}
+			git_reference_free(ref);
+		}
+		git_reference_iterator_free(refs);
+	}
+	if (!git_packbuilder_insert_walk(pb, walk) &&
+	    !git_packbuilder_write(pb, QFile::encodeName(packDir).constData(), 0, nullptr, nullptr)) {
+#if LIBGIT2_VER_MAJOR > 1 || (LIBGIT2_VER_MAJOR == 1 && LIBGIT2_VER_MINOR >= 5)
+		name = git_packbuilder_name(pb);
+#else
+		char hex[GIT_OID_HEXSZ + 1];
+		git_oid_tostr(hex, sizeof(hex), git_packbuilder_hash(pb));
+		name = hex;
+#endif
+	}
+	git_revwalk_free(walk);
+	git_packbuilder_free(pb);
+	return name;
+}
+
+static void removeLooseObjects(const QDir &objectsDir, git_odb *newPack)
+{
+	QRegExp fanout("[0-9a-f]{2}");
+	for (const QString &dirName: objectsDir.entryList(QDir::Dirs | QDir::NoDotAndDotDot)) {
+		if (!fanout.exactMatch(dirName))
+			continue;
+		QDir dir(objectsDir.filePath(dirName));
+		for (const QFileInfo &info: dir.entryInfoList(QDir::Files)) {
+			git_oid id;
+			QByteArray hex = (dirName + info.fileName()).toLatin1();
+			if (hex.size() != GIT_OID_HEXSZ || git_oid_fromstr(&id, hex.constData()))
+				continue;
+			if (git_odb_exists(newPack, &id) || expired(info))
+				QFile::remove(info.filePath());
+		}
+		// Fails if the directory isn't empty
+		objectsDir.rmdir(dirName);
+	}
+}
+
+static int inPack(const git_oid *id, void *payload)
+{
+	// A non-zero return value stops the iteration
+	return git_odb_exists((git_odb *)payload, id) ? 0 : 1;
+}
+
+// Packs whose unreachable objects are old enough and packs whose objects are all in the new pack
+static void removeOldPacks(const QDir &packDir, const QString &newPack, git_odb *newPackOdb)
+{
+	for (const QString &pack: packFiles(packDir)) {
+		QString base = pack.left(pack.size() - 5);
+		if (base == "pack-" + newPack || packDir.exists(base + ".keep"))
+			continue;
+		if (!expired(QFileInfo(packDir.filePath(pack)))) {
+			git_odb *odb = openPack(packDir.filePath(base + ".idx"));
+			if (!odb)
+				continue;
+			bool contained = git_odb_foreach(odb, &inPack, newPackOdb) == 0;
+			git_odb_free(odb);
+			if (!contained)
+				continue;
+		}
+		// Without the index, the pack isn't found anymore
+		packDir.remove(base + ".idx");
+		packDir.remove(pack);
+		packDir.remove(base + ".rev");
+		packDir.remove(base + ".bitmap");
+	}
+}
+
+// Squashing old commits is not done: the history is shared with the cloud
+// server and other devices, rewriting it would make every sync a merge.
+extern "C" int git_repository_maintenance(git_repository *repo)
+{
+	QDir objectsDir(QString::fromUtf8(git_repository_path(repo)) + "objects");
+	if (!needsMaintenance(objectsDir))
+		return 0;
+
+	TraceSpan span("git_repository_maintenance");
+	QElapsedTimer timer;
+	timer.start();
+	qint64 sizeBefore = directorySize(objectsDir.path());
+	QDir packDir(objectsDir.filePath("pack"));
+	QString newPack = writePack(repo, packDir.path());
+	if (newPack.isEmpty()) {
+		SSRF_INFO("git storage: repacking failed (%s)", giterr_last() ? giterr_last()->message : "unknown error");
+		return -1;
+	}
+	git_odb *newPackOdb = openPack(packDir.filePath("pack-" + newPack + ".idx"));
+	if (!newPackOdb)
+		return -1;
+	removeLooseObjects(objectsDir, newPackOdb);
+	removeOldPacks(packDir, newPack, newPackOdb);
+	git_odb_free(newPackOdb);
+
+	qint64 sizeAfter = directorySize(objectsDir.path());
+	trace_count("git maintenance bytes saved", sizeBefore - sizeAfter);
+	SSRF_INFO("git storage: repacked %s from %lld to %lld bytes in %lld ms", git_repository_path(repo),
+		  (long long)sizeBefore, (long long)sizeAfter, (long long)timer.elapsed());
+	return 0;
+}
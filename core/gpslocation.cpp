@@ -13,10 +13,45 @@
 #include <QVariant>
 #include <QUrlQuery>
 #include <QApplication>
+#include <QDataStream>
+#include <QFile>
+#include <QSaveFile>
 #include <QTimer>
+#include <algorithm>
 
 GpsLocation *GpsLocation::m_Instance = NULL;
 
+// The fixes are stored in a binary file: a header followed by one record per fix.
+// New fixes are appended; a later record replaces an earlier one with the same time.
+// The file is rewritten only when fixes are deleted.
+static const quint32 gpsFixesMagic = 0x53534746;	// "SSGF"
+static const quint32 gpsFixesVersion = 1;
+
+static QString gpsFixesFilename()
+{
+	return QString(system_default_directory()).append("/gpsfixes");
+}
+
+static void writeFixHeader(QDataStream &stream)
+{
+	stream << gpsFixesMagic << gpsFixesVersion;
+}
+
+static void writeFix(QDataStream &stream, const gpsTracker &gt)
+{
+	stream << (qint64)gt.when << (qint32)gt.location.lat.udeg << (qint32)gt.location.lon.udeg << gt.name.toUtf8();
+}
+
+static bool sameTime(const gpsTracker &gt, qint64 when)
+{
+	return gt.when == when;
+}
+
+static bool earlierThan(const gpsTracker &gt, qint64 when)
+{
+	return gt.when < when;
+}
+
 GpsLocation::GpsLocation(void (*showMsgCB)(const char *), QObject *parent) :
 	QObject(parent),
 	m_GpsSource(0),
@@ -132,14 +167,14 @@ QString GpsLocation::currentPosition()
 	qDebug() << "current position requested";
 	if (!hasLocationsSource())
 		return tr("Unknown GPS location (no GPS source)");
-	if (m_trackers.count()) {
-		QDateTime lastFixTime =	timestampToDateTime(m_trackers.lastKey() + gettimezoneoffset());
+	if (!m_trackers.empty()) {
+		QDateTime lastFixTime =	timestampToDateTime(m_trackers.back().when + gettimezoneoffset());
 		QDateTime now = QDateTime::currentDateTime();
 		int delta = lastFixTime.secsTo(now);
 		qDebug() << "lastFixTime" << lastFixTime.toString() << "now" << now.toString() << "delta" << delta;
 		if (delta < 300) {
 			// we can simply use the last position that we tracked
-			gpsTracker gt = m_trackers.last();
+			gpsTracker gt = m_trackers.back();
 			QString gpsString = printGPSCoords(&gt.location);
 			qDebug() << "returning last position" << gpsString;
 			return gpsString;
@@ -160,9 +195,9 @@ void GpsLocation::newPosition(QGeoPositionInfo pos)
 	int64_t lastTime = 0;
 	int64_t thisTime = dateTimeToTimestamp(pos.timestamp()) + gettimezoneoffset();
 	QGeoCoordinate lastCoord;
-	int nr = m_trackers.count();
+	int nr = (int)m_trackers.size();
 	if (nr) {
-		gpsTracker gt = m_trackers.last();
+		const gpsTracker &gt = m_trackers.back();
 		lastCoord.setLatitude(gt.location.lat.udeg / 1000000.0);
 		lastCoord.setLongitude(gt.location.lon.udeg / 1000000.0);
 		lastTime = gt.when;
@@ -181,8 +216,7 @@ void GpsLocation::newPosition(QGeoPositionInfo pos)
 		gt.when = thisTime;
 		gt.location = create_location(pos.coordinate().latitude(), pos.coordinate().longitude());
 		addFixToStorage(gt);
-		gpsTracker gtNew = m_trackers.last();
-		qDebug() << "newest fix is now at" << timestampToDateTime(gtNew.when - gettimezoneoffset()).toString();
+		qDebug() << "newest fix is now at" << timestampToDateTime(m_trackers.back().when - gettimezoneoffset()).toString();
 	}
 }
 
@@ -208,7 +242,7 @@ void GpsLocation::status(QString msg)
 
 int GpsLocation::getGpsNum() const
 {
-	return m_trackers.count();
+	return (int)m_trackers.size();
 }
 
 #define SAME_GROUP 6 * 3600 /* six hours */
@@ -222,19 +256,22 @@ std::vector<DiveAndLocation> GpsLocation::getLocations()
 {
 	int i;
 	int last = 0;
-	int cnt = m_trackers.count();
+	int cnt = (int)m_trackers.size();
 	std::vector<DiveAndLocation> fixes;
 	if (cnt == 0)
 		return fixes;
 
-	// create a table with the GPS information
-	QList<struct gpsTracker> gpsTable = m_trackers.values();
+	// the GPS fixes are sorted by time
+	const std::vector<gpsTracker> &gpsTable = m_trackers;
 
-	// now walk the dive table and see if we can fill in missing gps data
+	// now walk the dive table and see if we can fill in missing gps data.
+	// The dives are sorted by time, too. Fixes that are too early for one dive
+	// are also too early for all later dives and are skipped by a binary search.
 	struct dive *d;
 	for_each_dive(i, d) {
 		if (dive_has_gps_location(d))
 			continue;
+		last = std::lower_bound(gpsTable.begin() + last, gpsTable.end(), d->when - SAME_GROUP, earlierThan) - gpsTable.begin();
 		for (int j = last; j < cnt; j++) {
 			if (time_during_dive_with_offset(d, gpsTable[j].when, SAME_GROUP)) {
 				if (verbose)
@@ -310,91 +347,119 @@ std::vector<DiveAndLocation> GpsLocation::getLocations()
 	return fixes;
 }
 
-QMap<qint64, gpsTracker> GpsLocation::currentGPSInfo() const
+const std::vector<gpsTracker> &GpsLocation::currentGPSInfo() const
 {
 	return m_trackers;
 }
 
+// Insert a fix at its place in the time-sorted table, or replace the fix with the same time
+void GpsLocation::insertFix(const gpsTracker &gt)
+{
+	// Usually, the new fix is the latest one
+	if (m_trackers.empty() || m_trackers.back().when < gt.when) {
+		m_trackers.push_back(gt);
+		return;
+	}
+	auto it = std::lower_bound(m_trackers.begin(), m_trackers.end(), gt.when, earlierThan);
+	if (it != m_trackers.end() && sameTime(*it, gt.when))
+		*it = gt;
+	else
+		m_trackers.insert(it, gt);
+}
+
 void GpsLocation::loadFromStorage()
+{
+	QFile file(gpsFixesFilename());
+	if (!file.open(QIODevice::ReadOnly)) {
+		loadFromSettings();
+		return;
+	}
+	QDataStream stream(&file);
+	quint32 magic, version;
+	stream >> magic >> version;
+	if (magic != gpsFixesMagic || version != gpsFixesVersion) {
+		qWarning() << "Unknown format of GPS fixes in" << file.fileName();
+		return;
+	}
+	while (!stream.atEnd()) {
+		qint64 when;
+		qint32 lat, lon;
+		QByteArray name;
+		stream >> when >> lat >> lon >> name;
+		// a record that was cut off when writing is ignored
+		if (stream.status() != QDataStream::Ok)
+			break;
+		gpsTracker gt;
+		gt.when = when;
+		gt.location.lat.udeg = lat;
+		gt.location.lon.udeg = lon;
+		gt.name = QString::fromUtf8(name);
+		insertFix(gt);
+	}
+}
+
+// Older versions stored the fixes in the settings. These are converted on first start.
+// They are left in place for older versions.
+void GpsLocation::loadFromSettings()
 {
 	int nr = geoSettings->value(QStringLiteral("count")).toInt();
+	if (nr == 0)
+		return;
 	for (int i = 0; i < nr; i++) {
 		struct gpsTracker gt;
 		gt.when = geoSettings->value(QStringLiteral("gpsFix%1_time").arg(i)).toLongLong();
 		gt.location.lat.udeg = geoSettings->value(QStringLiteral("gpsFix%1_lat").arg(i)).toInt();
 		gt.location.lon.udeg = geoSettings->value(QStringLiteral("gpsFix%1_lon").arg(i)).toInt();
 		gt.name = geoSettings->value(QStringLiteral("gpsFix%1_name").arg(i)).toString();
-		gt.idx = i;
-		m_trackers.insert(gt.when, gt);
+		insertFix(gt);
 	}
+	writeAllFixes();
 }
 
-void GpsLocation::replaceFixToStorage(gpsTracker &gt)
+bool GpsLocation::writeAllFixes()
 {
-	if (!m_trackers.keys().contains(gt.when)) {
-		addFixToStorage(gt);
-		return;
+	QSaveFile file(gpsFixesFilename());
+	if (!file.open(QIODevice::WriteOnly)) {
+		qWarning() << "Cannot write GPS fixes to" << file.fileName();
+		return false;
 	}
-	gpsTracker replacedTracker = m_trackers.value(gt.when);
-	geoSettings->setValue(QStringLiteral("gpsFix%1_time").arg(replacedTracker.idx), gt.when);
-	geoSettings->setValue(QStringLiteral("gpsFix%1_lat").arg(replacedTracker.idx), gt.location.lat.udeg);
-	geoSettings->setValue(QStringLiteral("gpsFix%1_lon").arg(replacedTracker.idx), gt.location.lon.udeg);
-	geoSettings->setValue(QStringLiteral("gpsFix%1_name").arg(replacedTracker.idx), gt.name);
-	replacedTracker.location = gt.location;
-	replacedTracker.name = gt.name;
+	QDataStream stream(&file);
+	writeFixHeader(stream);
+	for (const gpsTracker &gt: m_trackers)
+		writeFix(stream, gt);
+	return file.commit();
 }
 
 void GpsLocation::addFixToStorage(gpsTracker &gt)
 {
-	int nr = m_trackers.count();
-	geoSettings->setValue("count", nr + 1);
-	geoSettings->setValue(QStringLiteral("gpsFix%1_time").arg(nr), gt.when);
-	geoSettings->setValue(QStringLiteral("gpsFix%1_lat").arg(nr), gt.location.lat.udeg);
-	geoSettings->setValue(QStringLiteral("gpsFix%1_lon").arg(nr), gt.location.lon.udeg);
-	geoSettings->setValue(QStringLiteral("gpsFix%1_name").arg(nr), gt.name);
-	gt.idx = nr;
-	geoSettings->sync();
-	m_trackers.insert(gt.when, gt);
+	insertFix(gt);
+	QFile file(gpsFixesFilename());
+	bool newFile = !file.exists();
+	if (!file.open(QIODevice::WriteOnly | QIODevice::Append)) {
+		qWarning() << "Cannot write GPS fixes to" << file.fileName();
+		return;
+	}
+	QDataStream stream(&file);
+	if (newFile)
+		writeFixHeader(stream);
+	writeFix(stream, gt);
 }
 
 void GpsLocation::deleteFixFromStorage(gpsTracker &gt)
 {
-	qint64 when = gt.when;
-	int cnt = m_trackers.count();
-	if (cnt == 0 || !m_trackers.keys().contains(when)) {
-		qDebug() << "no gps fix with timestamp" << when;
-		return;
-	}
-	if (geoSettings->value(QStringLiteral("gpsFix%1_time").arg(gt.idx)).toLongLong() != when) {
-		qDebug() << "uh oh - index for tracker has gotten out of sync...";
+	auto it = std::lower_bound(m_trackers.begin(), m_trackers.end(), gt.when, earlierThan);
+	if (it == m_trackers.end() || !sameTime(*it, gt.when)) {
+		qDebug() << "no gps fix with timestamp" << gt.when;
 		return;
 	}
-	if (cnt > 1) {
-		// now we move the last tracker into that spot (so our settings stay consecutive)
-		// and delete the last settings entry
-		when = geoSettings->value(QStringLiteral("gpsFix%1_time").arg(cnt - 1)).toLongLong();
-		struct gpsTracker movedTracker = m_trackers.value(when);
-		movedTracker.idx = gt.idx;
-		m_trackers.remove(movedTracker.when);
-		m_trackers.insert(movedTracker.when, movedTracker);
-		geoSettings->setValue(QStringLiteral("gpsFix%1_time").arg(movedTracker.idx), when);
-		geoSettings->setValue(QStringLiteral("gpsFix%1_lat").arg(movedTracker.idx), movedTracker.location.lat.udeg);
-		geoSettings->setValue(QStringLiteral("gpsFix%1_lon").arg(movedTracker.idx), movedTracker.location.lon.udeg);
-		geoSettings->setValue(QStringLiteral("gpsFix%1_name").arg(movedTracker.idx), movedTracker.name);
-		geoSettings->remove(QStringLiteral("gpsFix%1_lat").arg(cnt - 1));
-		geoSettings->remove(QStringLiteral("gpsFix%1_lon").arg(cnt - 1));
-		geoSettings->remove(QStringLiteral("gpsFix%1_time").arg(cnt - 1));
-		geoSettings->remove(QStringLiteral("gpsFix%1_name").arg(cnt - 1));
-	}
-	geoSettings->setValue("count", cnt - 1);
-	geoSettings->sync();
-	m_trackers.remove(gt.when);
+	m_trackers.erase(it);
+	writeAllFixes();
 }
 
 void GpsLocation::deleteGpsFix(qint64 when)
 {
-	auto it = m_trackers.find(when);
-	if (it == m_trackers.end()) {
+	auto it = std::lower_bound(m_trackers.begin(), m_trackers.end(), when, earlierThan);
+	if (it == m_trackers.end() || !sameTime(*it, when)) {
 		qWarning() << "GpsLocation::deleteGpsFix(): can't find tracker for timestamp " << when;
 		return;
 	}
@@ -407,6 +472,7 @@ void GpsLocation::deleteGpsFix(qint64 when)
 void GpsLocation::clearGpsData()
 {
 	m_trackers.clear();
+	QFile::remove(gpsFixesFilename());
 	geoSettings->clear();
 	geoSettings->sync();
 }
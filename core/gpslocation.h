@@ -9,7 +9,7 @@
 #include <QGeoPositionInfo>
 #include <QSettings>
 #include <QNetworkReply>
-#include <QMap>
+#include <vector>
 
 #define GPS_CURRENT_POS gettextFromC::tr("Waiting to aquire GPS location")
 
@@ -17,7 +17,6 @@ struct gpsTracker {
 	location_t location;
 	qint64 when;
 	QString name;
-	int idx;
 };
 
 struct DiveAndLocation {
@@ -38,7 +37,7 @@ public:
 	bool hasLocationsSource();
 	QString currentPosition();
 
-	QMap<qint64, gpsTracker> currentGPSInfo() const;
+	const std::vector<gpsTracker> &currentGPSInfo() const;	// sorted by time
 
 private:
 	QGeoPositionInfo lastPos;
@@ -51,11 +50,13 @@ private:
 	void (*showMessageCB)(const char *msg);
 	static GpsLocation *m_Instance;
 	bool waitingForPosition;
-	QMap<qint64, gpsTracker> m_trackers;
+	std::vector<gpsTracker> m_trackers;	// sorted by time
 	QList<gpsTracker> m_deletedTrackers;
+	void insertFix(const gpsTracker &gt);
 	void loadFromStorage();
+	void loadFromSettings();
+	bool writeAllFixes();
 	void addFixToStorage(gpsTracker &gt);
-	void replaceFixToStorage(gpsTracker &gt);
 	void deleteFixFromStorage(gpsTracker &gt);
 	void deleteFixesFromServer();
 	enum { UNKNOWN, NOGPS, HAVEGPS } haveSource;
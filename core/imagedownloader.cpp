@@ -7,14 +7,14 @@
 #include "videoframeextractor.h"
 #include "qt-models/divepicturemodel.h"
 #include "metadata.h"
+#include "trace.h"
 #include <unistd.h>
 #include <QString>
 #include <QImageReader>
 #include <QDataStream>
 #include <QSvgRenderer>
 #include <QPainter>
-
-#include <QtConcurrent>
+#include <algorithm>
 
 // Note: this is a global instead of a function-local variable on purpose.
 // We don't want this to be generated in a different thread context if
@@ -52,9 +52,7 @@ void ImageDownloader::saveImage(QNetworkReply *reply)
 			QDir dir(path);
 			if (!dir.exists())
 				dir.mkpath(path);
-			QCryptographicHash hash(QCryptographicHash::Sha1);
-			hash.addData(filename.toUtf8());
-			QFile imageFile(path.append("/").append(hash.result().toHex()));
+			QFile imageFile(path.append("/").append(sha1Hash(filename.toUtf8()).toHex()));
 			if (imageFile.open(QIODevice::WriteOnly)) {
 				qDebug() << "Write image to" << imageFile.fileName();
 				QDataStream stream(&imageFile);
@@ -78,6 +76,23 @@ static bool hasVideoFileExtension(const QString &filename)
 	return false;
 }
 
+// Load an image scaled to fit into a size x size square. Let the image reader
+// do the scaling, so that decoders which support it (notably JPEG) don't have
+// to expand the full resolution image into memory. This matters for photos
+// of tens of megapixels, of which we only want a small thumbnail.
+static QImage loadScaledImage(const QString &filename, int size)
+{
+	QImageReader reader(filename);
+	QSize imageSize = reader.size();
+	if (imageSize.isValid())
+		reader.setScaledSize(imageSize.scaled(size, size, Qt::KeepAspectRatio));
+	QImage res = reader.read();
+	// If the reader couldn't determine the size beforehand, scale afterwards
+	if (!res.isNull() && !imageSize.isValid())
+		res = res.scaled(size, size, Qt::KeepAspectRatio);
+	return res;
+}
+
 // Fetch a picture from the given filename and determine its type (picture of video).
 // If this is a non-remote file, fetch it from disk. Remote files are fetched from the
 // net in a background thread. In such a case, the output-type is set to MEDIATYPE_STILL_LOADING.
@@ -100,12 +115,9 @@ Thumbnailer::Thumbnail Thumbnailer::fetchImage(const QString &urlfilename, const
 			return fetchVideoThumbnail(filename, originalFilename, md.duration);
 
 		// Try if Qt can parse this image. If it does, use this as a thumbnail.
-		QImage thumb(filename);
-		if (!thumb.isNull()) {
-			int size = maxThumbnailSize();
-			thumb = thumb.scaled(size, size, Qt::KeepAspectRatio);
+		QImage thumb = loadScaledImage(filename, maxThumbnailSize());
+		if (!thumb.isNull())
 			return addPictureThumbnailToCache(originalFilename, thumb);
-		}
 
 		// Neither our code, nor Qt could determine the type of this object from looking at the data.
 		// Try to check for a video-file extension. Since we couldn't parse the video file,
@@ -182,9 +194,10 @@ Thumbnailer::Thumbnailer() : failImage(renderIcon(":filter-close", maxThumbnailS
 			     videoOverlayImage(renderIconWidth(":video-overlay", maxThumbnailSize())),
 			     unknownImage(renderIcon(":unknown-icon", maxThumbnailSize()))
 {
-	// Currently, we only process one image at a time. Stefan Fuchs reported problems when
+	// By default, we only process one image at a time. Stefan Fuchs reported problems when
 	// calculating multiple thumbnails at once and this hopefully helps.
-	pool.setMaxThreadCount(1);
+	setMaxThreadCount(1);
+	memoryCache.setMaxCost(memoryCacheSize);
 	connect(ImageDownloader::instance(), &ImageDownloader::loaded, this, &Thumbnailer::imageDownloaded);
 	connect(ImageDownloader::instance(), &ImageDownloader::failed, this, &Thumbnailer::imageDownloadFailed);
 	connect(VideoFrameExtractor::instance(), &VideoFrameExtractor::extracted, this, &Thumbnailer::frameExtracted);
@@ -198,6 +211,12 @@ Thumbnailer *Thumbnailer::instance()
 	return &self;
 }
 
+void Thumbnailer::setMaxThreadCount(int count)
+{
+	queue.setMaxConcurrent(std::max(count, 1));
+	prefetchQueue.setMaxConcurrent(std::max(count, 1));
+}
+
 Thumbnailer::Thumbnail Thumbnailer::getPictureThumbnailFromStream(QDataStream &stream)
 {
 	QImage res;
@@ -249,10 +268,65 @@ Thumbnailer::Thumbnail Thumbnailer::getVideoThumbnailFromStream(QDataStream &str
 	return { res, MEDIATYPE_VIDEO, { (int32_t)duration } };
 }
 
+// Picture thumbnails are kept in memory, so that they don't have to be read from
+// disk again when returning to a set of pictures. The cost of an entry is its size in kB.
+static const int memoryCacheSize = 64 * 1024;
+
+void Thumbnailer::addToMemoryCache(const QString &picture_filename, const QImage &thumbnail)
+{
+	QMutexLocker l(&memoryCacheLock);
+	memoryCache.insert(picture_filename, new QImage(thumbnail), thumbnail.bytesPerLine() * thumbnail.height() / 1024 + 1);
+}
+
+size_t Thumbnailer::memoryCacheBytes()
+{
+	QMutexLocker l(&memoryCacheLock);
+	return (size_t)memoryCache.totalCost() * 1024; // the cost is in kB
+}
+
+void Thumbnailer::removeFromMemoryCache(const QString &picture_filename)
+{
+	QMutexLocker l(&memoryCacheLock);
+	memoryCache.remove(picture_filename);
+}
+
+// Returns a null image if the thumbnail is not in the memory cache.
+QImage Thumbnailer::getThumbnailFromMemoryCache(const QString &picture_filename)
+{
+	// If thumbnails are recalculated when the picture changed, we have to look at the files anyway.
+	if (prefs.auto_recalculate_thumbnails)
+		return QImage();
+	QMutexLocker l(&memoryCacheLock);
+	const QImage *img = memoryCache.object(picture_filename);
+	return img ? *img : QImage();
+}
+
+// Pictures with the same content, e.g. copies in different folders, share the thumbnail
+static bool openDuplicateThumbnail(const QString &picture_filename, QFile &file)
+{
+	QByteArray fingerprint = pictureFingerprint(picture_filename);
+	if (fingerprint.isEmpty())
+		return false;
+	for (const QString &other: picturesWithFingerprint(fingerprint)) {
+		if (other == picture_filename)
+			continue;
+		file.setFileName(thumbnailFileName(other));
+		if (file.open(QIODevice::ReadOnly))
+			return true;
+	}
+	return false;
+}
+
 // Fetch a thumbnail from cache.
 // If Thumbnail::QImage is null, the thumbnail is scheduled for recreation.
 Thumbnailer::Thumbnail Thumbnailer::getThumbnailFromCache(const QString &picture_filename)
 {
+	QImage img = getThumbnailFromMemoryCache(picture_filename);
+	if (!img.isNull()) {
+		trace_count("thumbnail memory cache hits", 1);
+		return { img, MEDIATYPE_PICTURE, zero_duration };
+	}
+
 	QString filename = thumbnailFileName(picture_filename);
 	if (filename.isEmpty())
 		return { QImage(), MEDIATYPE_UNKNOWN, zero_duration };
@@ -274,8 +348,11 @@ Thumbnailer::Thumbnail Thumbnailer::getThumbnailFromCache(const QString &picture
 		}
 	}
 
-	if (!file.open(QIODevice::ReadOnly))
+	if (!file.open(QIODevice::ReadOnly) && !openDuplicateThumbnail(picture_filename, file)) {
+		trace_count("thumbnail cache misses", 1);
 		return { QImage(), MEDIATYPE_UNKNOWN, zero_duration };
+	}
+	trace_count("thumbnail disk cache hits", 1);
 	QDataStream stream(&file);
 
 	// Each thumbnail file is composed of a media-type and an image file.
@@ -284,7 +361,12 @@ Thumbnailer::Thumbnail Thumbnailer::getThumbnailFromCache(const QString &picture
 	stream >> type;
 
 	switch (type) {
-	case MEDIATYPE_PICTURE:	return getPictureThumbnailFromStream(stream);
+	case MEDIATYPE_PICTURE: {
+		Thumbnail thumbnail = getPictureThumbnailFromStream(stream);
+		if (!thumbnail.img.isNull())
+			addToMemoryCache(picture_filename, thumbnail.img);
+		return thumbnail;
+	}
 	case MEDIATYPE_VIDEO:	return getVideoThumbnailFromStream(stream, picture_filename);
 	case MEDIATYPE_UNKNOWN:	return { unknownImage, MEDIATYPE_UNKNOWN, zero_duration };
 	default:		return { QImage(), MEDIATYPE_UNKNOWN, zero_duration };
@@ -301,6 +383,7 @@ Thumbnailer::Thumbnail Thumbnailer::addVideoThumbnailToCache(const QString &pict
 	//	for each picture:
 	//		uint32	offset in msec from begining of video
 	//		QImage	frame
+	removeFromMemoryCache(picture_filename);
 	QString filename = thumbnailFileName(picture_filename);
 	QSaveFile file(filename);
 	if (file.open(QIODevice::WriteOnly)) {
@@ -343,6 +426,7 @@ Thumbnailer::Thumbnail Thumbnailer::addPictureThumbnailToCache(const QString &pi
 	// The format of a picture-thumbnail is very simple:
 	// 	uint32	MEDIATYPE_PICTURE
 	// 	QImage	thumbnail
+	addToMemoryCache(picture_filename, thumbnail);
 	QString filename = thumbnailFileName(picture_filename);
 	QSaveFile file(filename);
 	if (file.open(QIODevice::WriteOnly)) {
@@ -357,6 +441,7 @@ Thumbnailer::Thumbnail Thumbnailer::addPictureThumbnailToCache(const QString &pi
 
 Thumbnailer::Thumbnail Thumbnailer::addUnknownThumbnailToCache(const QString &picture_filename)
 {
+	removeFromMemoryCache(picture_filename);
 	QString filename = thumbnailFileName(picture_filename);
 	QSaveFile file(filename);
 	if (file.open(QIODevice::WriteOnly)) {
@@ -445,7 +530,8 @@ void Thumbnailer::imageDownloaded(QString filename)
 {
 	// Image was downloaded -> try thumbnailing again.
 	QMutexLocker l(&lock);
-	workingOn[filename] = QtConcurrent::run(&pool, [this, filename]() { processItem(filename, false); });
+	workingOn.insert(filename);
+	queue.run([this, filename]() { processItem(filename, false); });
 }
 
 void Thumbnailer::imageDownloadFailed(QString filename)
@@ -472,12 +558,17 @@ QImage Thumbnailer::fetchThumbnail(const QString &filename, bool synchronous)
 		return thumbnail.img.scaled(size, size, Qt::KeepAspectRatio);
 	}
 
+	// Recently used thumbnails can be returned right away
+	QImage img = getThumbnailFromMemoryCache(filename);
+	if (!img.isNull())
+		return img;
+
 	QMutexLocker l(&lock);
 
 	// We are not currently fetching this thumbnail - add it to the list.
 	if (!workingOn.contains(filename)) {
-		workingOn.insert(filename,
-				 QtConcurrent::run(&pool, [this, filename]() { processItem(filename, true); }));
+		workingOn.insert(filename);
+		queue.run([this, filename]() { processItem(filename, true); });
 	}
 	return dummyImage;
 }
@@ -487,12 +578,24 @@ void Thumbnailer::calculateThumbnails(const QVector<QString> &filenames)
 	QMutexLocker l(&lock);
 	for (const QString &filename: filenames) {
 		if (!workingOn.contains(filename)) {
-			workingOn.insert(filename,
-					 QtConcurrent::run(&pool, [this, filename]() { recalculate(filename); }));
+			workingOn.insert(filename);
+			queue.run([this, filename]() { recalculate(filename); });
 		}
 	}
 }
 
+void Thumbnailer::prefetchThumbnails(const QVector<QString> &filenames)
+{
+	QMutexLocker l(&lock);
+	for (const QString &filename: filenames) {
+		if (workingOn.contains(filename) || !getThumbnailFromMemoryCache(filename).isNull())
+			continue;
+		// Don't download remote pictures if the user might never look at them
+		workingOn.insert(filename);
+		prefetchQueue.run([this, filename]() { processItem(filename, false); });
+	}
+}
+
 void Thumbnailer::clearWorkQueue()
 {
 	// We also want to clear the working-queue of the video-frame-extractor so that
@@ -500,11 +603,18 @@ void Thumbnailer::clearWorkQueue()
 	VideoFrameExtractor::instance()->clearWorkQueue();
 
 	QMutexLocker l(&lock);
-	for (auto it = workingOn.begin(); it != workingOn.end(); ++it)
-		it->cancel();
+	queue.clear();
+	prefetchQueue.clear();
 	workingOn.clear();
 }
 
+void Thumbnailer::finishWork()
+{
+	clearWorkQueue();
+	queue.waitForDone();
+	prefetchQueue.waitForDone();
+}
+
 static const int maxZoom = 3;	// Maximum zoom: thrice of standard size
 
 int Thumbnailer::defaultThumbnailSize()
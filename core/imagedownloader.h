@@ -3,10 +3,11 @@
 #define IMAGEDOWNLOADER_H
 
 #include "metadata.h"
+#include "taskqueue.h"
+#include <QCache>
 #include <QImage>
-#include <QFuture>
 #include <QNetworkReply>
-#include <QThreadPool>
+#include <QSet>
 
 class ImageDownloader : public QObject {
 	Q_OBJECT
@@ -42,8 +43,22 @@ public:
 	// Schedule multiple thumbnails for forced recalculation
 	void calculateThumbnails(const QVector<QString> &filenames);
 
+	// Calculate thumbnails in the background, so that they can later be
+	// returned from the memory cache. For example for the pictures of the
+	// neighbouring dives. Remote pictures are not downloaded.
+	void prefetchThumbnails(const QVector<QString> &filenames);
+
 	// If we change dive, clear all unfinished thumbnail creations
 	void clearWorkQueue();
+
+	// Drop the queued thumbnails and wait until the running ones are in the cache
+	void finishWork();
+
+	// Number of thumbnails that are calculated concurrently (at least one),
+	// each for the shown and the prefetched thumbnails
+	void setMaxThreadCount(int count);
+	// Bytes held by the thumbnails in the memory cache
+	size_t memoryCacheBytes();
 	static int maxThumbnailSize();
 	static int defaultThumbnailSize();
 	static int thumbnailSize(double zoomLevel);
@@ -76,16 +91,23 @@ private:
 	Thumbnail fetchImage(const QString &filename, const QString &originalFilename, bool tryDownload);
 	Thumbnail getHashedImage(const QString &filename, bool tryDownload);
 	void markVideoThumbnail(QImage &img);
+	QImage getThumbnailFromMemoryCache(const QString &picture_filename);
+	void addToMemoryCache(const QString &picture_filename, const QImage &thumbnail);
+	void removeFromMemoryCache(const QString &picture_filename);
 
 	mutable QMutex lock;
-	QThreadPool pool;
+	TaskQueue queue { TaskClass::Interactive };		// Thumbnails that are shown
+	TaskQueue prefetchQueue { TaskClass::Background };	// Thumbnails that might be shown later
 	QImage failImage;		// Shown when image-fetching fails
 	QImage dummyImage;		// Shown before thumbnail is fetched
 	QImage videoImage;		// Place holder for videos
 	QImage videoOverlayImage;	// Overlay for video thumbnails
 	QImage unknownImage;		// Place holder for files where we couldn't determine the type
 
-	QMap<QString,QFuture<void>> workingOn;
+	QSet<QString> workingOn;
+
+	QMutex memoryCacheLock;
+	QCache<QString, QImage> memoryCache;	// Recently used picture thumbnails, by picture filename
 };
 
 #endif // IMAGEDOWNLOADER_H
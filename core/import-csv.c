@@ -342,7 +342,7 @@ int parse_csv_file(const char *filename, struct xml_params *params, const char *
 static int try_to_xslt_open_csv(const char *filename, struct memblock *mem, const char *tag)
 {
 	char *buf;
-	size_t i, amp = 0, rest = 0;
+	size_t i, amp = 0, src, dst;
 
 	if (mem->size == 0 && readfile(filename, mem) < 0)
 		return report_error(translate("gettextFromC", "Failed to read '%s'"), filename);
@@ -391,14 +391,19 @@ static int try_to_xslt_open_csv(const char *filename, struct memblock *mem, cons
 		free(starttag);
 		free(endtag);
 
-		/* Expand ampersands to encoded version */
-		for (i = mem->size, rest = 0; i > 0; --i, ++rest) {
-			if (((char *)mem->buffer)[i] == '&') {
-				memmove(((char *)mem->buffer) + i + 4 + 1, ((char *)mem->buffer) + i + 1, rest);
-				memcpy(((char *)mem->buffer) + i + 1, "amp;", 4);
-				rest += 4;
-				mem->size += 4;
+		/* Expand ampersands to encoded version. Move the data from
+		 * the end in one pass, including the terminating zero, so that
+		 * files with many ampersands don't take quadratic time. As soon
+		 * as source and destination meet, the rest stays in place. */
+		src = mem->size;
+		dst = mem->size + amp * 4;
+		mem->size = dst;
+		while (src != dst) {
+			if (buf[src] == '&') {
+				memcpy(buf + dst - 3, "amp;", 4);
+				dst -= 4;
 			}
+			buf[dst--] = buf[src--];
 		}
 	} else {
 		free(mem->buffer);
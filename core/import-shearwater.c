@@ -487,6 +487,25 @@ static int shearwater_cloud_dive(void *param, int columns, char **data, char **c
 	return SQLITE_OK;
 }
 
+/*
+ * The samples of every dive are fetched by separate queries on dive_log_records,
+ * which doesn't have an index on the dive. Thus, every query scanned all samples
+ * of all dives. Make an indexed copy in the temporary database of the connection.
+ * It shadows the original table, so that the queries can stay as they are. The
+ * copy keeps the order of the rows. If this fails, the original table is used.
+ */
+static void index_shearwater_records(sqlite3 *handle)
+{
+	char create_copy[] = "create temp table dive_log_records as select * from main.dive_log_records";
+	char create_dive_index[] = "create index temp.dive_log_records_dive on dive_log_records(diveLogId)";
+	char create_id_index[] = "create index temp.dive_log_records_id on dive_log_records(id)";
+
+	if (sqlite3_exec(handle, create_copy, NULL, NULL, NULL) != SQLITE_OK)
+		return;
+	sqlite3_exec(handle, create_dive_index, NULL, NULL, NULL);
+	sqlite3_exec(handle, create_id_index, NULL, NULL, NULL);
+}
+
 int parse_shearwater_buffer(sqlite3 *handle, const char *url, const char *buffer, int size,
 			    struct dive_table *table, struct trip_table *trips, struct dive_site_table *sites,
 			    struct device_table *devices)
@@ -503,6 +522,7 @@ int parse_shearwater_buffer(sqlite3 *handle, const char *url, const char *buffer
 	state.sites = sites;
 	state.devices = devices;
 	state.sql_handle = handle;
+	index_shearwater_records(handle);
 
 	// So far have not seen any sample rate in Shearwater Desktop
 	state.sample_rate = 0;
@@ -536,6 +556,7 @@ int parse_shearwater_cloud_buffer(sqlite3 *handle, const char *url, const char *
 	state.sites = sites;
 	state.devices = devices;
 	state.sql_handle = handle;
+	index_shearwater_records(handle);
 
 	char get_dives[] = "select l.number,strftime('%s', DiveDate),location||' / '||site,buddy,notes,imperialUnits,maxDepth,DiveLengthTime,startSurfacePressure,computerSerial,computerModel,d.diveId,l.sampleRateMs / 1000 FROM dive_details AS d JOIN dive_logs AS l ON d.diveId=l.diveId";
 
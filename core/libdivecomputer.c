@@ -37,6 +37,7 @@
 #include "core/qthelper.h"
 #include "core/membuffer.h"
 #include "core/file.h"
+#include "core/rawdivecache.h"
 #include <QtGlobal>
 
 char *dumpfile_name;
@@ -45,9 +46,19 @@ const char *progress_bar_text = "";
 void (*progress_callback)(const char *text) = NULL;
 double progress_bar_fraction = 0.0;
 
-static int stoptime, stopdepth, ndl, po2, cns, heartbeat, bearing;
-static bool in_deco, first_temp_is_air;
-static int current_gas_index;
+/*
+ * The state of a download is kept per thread, so that several dive
+ * computers can be downloaded at the same time, each on its own thread.
+ */
+#ifdef _MSC_VER
+#define THREAD_LOCAL __declspec(thread)
+#else
+#define THREAD_LOCAL __thread
+#endif
+
+static THREAD_LOCAL int stoptime, stopdepth, ndl, po2, cns, heartbeat, bearing;
+static THREAD_LOCAL bool in_deco, first_temp_is_air;
+static THREAD_LOCAL int current_gas_index;
 
 /* logging bits from libdivecomputer */
 #ifndef __ANDROID__
@@ -308,7 +319,7 @@ static void handle_gasmix(struct divecomputer *dc, struct sample *sample, int id
 void
 sample_cb(dc_sample_type_t type, dc_sample_value_t value, void *userdata)
 {
-	static unsigned int nsensor = 0;
+	static THREAD_LOCAL unsigned int nsensor = 0;
 	struct divecomputer *dc = userdata;
 	struct sample *sample;
 
@@ -425,26 +436,30 @@ sample_cb(dc_sample_type_t type, dc_sample_value_t value, void *userdata)
 
 static void dev_info(device_data_t *devdata, const char *fmt, ...)
 {
-	UNUSED(devdata);
-	static char buffer[1024];
+	static THREAD_LOCAL char buffer[1024];
 	va_list ap;
 
 	va_start(ap, fmt);
 	vsnprintf(buffer, sizeof(buffer), fmt, ap);
 	va_end(ap);
-	progress_bar_text = buffer;
 	if (verbose)
 		INFO(0, "dev_info: %s\n", buffer);
+	/* A download of several devices reports the progress of each of them */
+	if (devdata->progress_cb) {
+		devdata->progress_cb(devdata, -1.0, buffer);
+		return;
+	}
 
+	progress_bar_text = buffer;
 	if (progress_callback)
 		(*progress_callback)(buffer);
 }
 
-static int import_dive_number = 0;
+static THREAD_LOCAL int import_dive_number = 0;
 
 static void download_error(const char *fmt, ...)
 {
-	static char buffer[1024];
+	static THREAD_LOCAL char buffer[1024];
 	va_list ap;
 
 	va_start(ap, fmt);
@@ -502,14 +517,88 @@ static int match_one_dive(struct divecomputer *a, struct dive *dive)
 /*
  * Check if this dive already existed before the import
  */
+/*
+ * A dive can only match if one of its dive computers has the same start
+ * time (see match_one_dc() and match_one_dive()). Therefore, find_dive()
+ * keeps the start times of all dive computers in the dive table sorted, so
+ * that it only has to look at the dives with the same start time. The dive
+ * table doesn't change during a download, it is freed after each import.
+ */
+struct dc_start {
+	timestamp_t when;
+	struct dive *dive;
+};
+
+static struct {
+	int nr;
+	struct dc_start *starts;
+} THREAD_LOCAL dc_start_index;
+
+static int comp_dc_start(const void *_a, const void *_b)
+{
+	const struct dc_start *a = _a, *b = _b;
+	return a->when < b->when ? -1 : a->when > b->when ? 1 : 0;
+}
+
+static bool build_dc_start_index(void)
+{
+	int i, nr = 0;
+	struct dive *dive;
+	struct divecomputer *dc;
+
+	for_each_dive (i, dive) {
+		for_each_dc (dive, dc)
+			nr++;
+	}
+	dc_start_index.starts = malloc((nr + 1) * sizeof(struct dc_start));
+	if (!dc_start_index.starts)
+		return false;
+	dc_start_index.nr = 0;
+	for_each_dive (i, dive) {
+		for_each_dc (dive, dc) {
+			struct dc_start *start = &dc_start_index.starts[dc_start_index.nr++];
+			start->when = dc->when;
+			start->dive = dive;
+		}
+	}
+	qsort(dc_start_index.starts, dc_start_index.nr, sizeof(struct dc_start), comp_dc_start);
+	return true;
+}
+
+static void free_dc_start_index(void)
+{
+	free(dc_start_index.starts);
+	dc_start_index.starts = NULL;
+	dc_start_index.nr = 0;
+}
+
 static int find_dive(struct divecomputer *match)
 {
-	int i;
+	int i, lo, hi;
+
+	if (!dc_start_index.starts && !build_dc_start_index()) {
+		/* Out of memory - search the whole table */
+		for (i = dive_table.nr - 1; i >= 0; i--) {
+			struct dive *old = dive_table.dives[i];
 
-	for (i = dive_table.nr - 1; i >= 0; i--) {
-		struct dive *old = dive_table.dives[i];
+			if (match_one_dive(match, old))
+				return 1;
+		}
+		return 0;
+	}
 
-		if (match_one_dive(match, old))
+	/* Find the first dive computer starting at the same time */
+	lo = 0;
+	hi = dc_start_index.nr;
+	while (lo < hi) {
+		int mid = lo + (hi - lo) / 2;
+		if (dc_start_index.starts[mid].when < match->when)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	for (i = lo; i < dc_start_index.nr && dc_start_index.starts[i].when == match->when; i++) {
+		if (match_one_dive(match, dc_start_index.starts[i].dive))
 			return 1;
 	}
 	return 0;
@@ -763,6 +852,93 @@ static dc_status_t libdc_header_parser(dc_parser_t *parser, device_data_t *devda
 	return DC_STATUS_SUCCESS;
 }
 
+#ifndef O_BINARY
+  #define O_BINARY 0
+#endif
+
+/*
+ * While downloading, the dive IDs of the downloaded dives are appended to a
+ * checkpoint file next to the fingerprint file. The fingerprint is only
+ * updated when a download finishes, so that the dives that an interrupted
+ * download didn't get to are downloaded the next time. As the dive computers
+ * send the newest dives first, that download sees the dives of the
+ * interrupted one again. They are skipped instead of ending the download
+ * because they are already known.
+ */
+static char *checkpoint_name(const device_data_t *devdata)
+{
+	return format_string("%s/fingerprints/%04x.partial", system_default_directory(), devdata->deviceid);
+}
+
+static void add_to_checkpoint(const device_data_t *devdata, uint32_t diveid)
+{
+	char *dir, *name;
+	int fd;
+
+	dir = format_string("%s/fingerprints", system_default_directory());
+	subsurface_mkdir(dir);
+	free(dir);
+	name = checkpoint_name(devdata);
+	fd = subsurface_open(name, O_WRONLY | O_BINARY | O_CREAT | O_APPEND, 0666);
+	free(name);
+	if (fd < 0)
+		return;
+	if (write(fd, &diveid, 4) != 4)
+		INFO(0, "Unable to write the download checkpoint");
+	close(fd);
+}
+
+static void load_checkpoint(device_data_t *devdata)
+{
+	char *name = checkpoint_name(devdata);
+	struct memblock mem;
+
+	if (readfile(name, &mem) > 0) {
+		devdata->checkpoint_nr = mem.size / 4;
+		devdata->checkpoint_ids = malloc(devdata->checkpoint_nr * 4);
+		if (devdata->checkpoint_ids)
+			memcpy(devdata->checkpoint_ids, mem.buffer, devdata->checkpoint_nr * 4);
+		else
+			devdata->checkpoint_nr = 0;
+		free(mem.buffer);
+	}
+	free(name);
+}
+
+static bool in_checkpoint(const device_data_t *devdata, uint32_t diveid)
+{
+	for (int i = 0; i < devdata->checkpoint_nr; i++) {
+		if (devdata->checkpoint_ids[i] == diveid)
+			return true;
+	}
+	return false;
+}
+
+static void remove_checkpoint(const device_data_t *devdata)
+{
+	char *name = checkpoint_name(devdata);
+	unlink(name);
+	free(name);
+}
+
+/* reset static data, that is only valid per dive */
+static void reset_dive_state(void)
+{
+	stoptime = stopdepth = po2 = cns = heartbeat = 0;
+	ndl = bearing = -1;
+	in_deco = false;
+	current_gas_index = -1;
+}
+
+/* Various libdivecomputer interface fixups */
+static void fixup_dive(struct dive *dive)
+{
+	if (dive->dc.airtemp.mkelvin == 0 && first_temp_is_air && dive->dc.samples) {
+		dive->dc.airtemp = dive->dc.sample[0].temperature;
+		dive->dc.sample[0].temperature.mkelvin = 0;
+	}
+}
+
 /* returns true if we want libdivecomputer's dc_device_foreach() to continue,
  *  false otherwise */
 static int dive_cb(const unsigned char *data, unsigned int size,
@@ -774,12 +950,7 @@ static int dive_cb(const unsigned char *data, unsigned int size,
 	device_data_t *devdata = userdata;
 	struct dive *dive = NULL;
 
-	/* reset static data, that is only valid per dive */
-	stoptime = stopdepth = po2 = cns = heartbeat = 0;
-	ndl = bearing = -1;
-	in_deco = false;
-	current_gas_index = -1;
-
+	reset_dive_state();
 	import_dive_number++;
 
 	rc = create_parser(devdata, &parser);
@@ -810,6 +981,10 @@ static int dive_cb(const unsigned char *data, unsigned int size,
 		}
 	}
 
+	/* Keep the raw data, so that the dive can be parsed again by a fixed parser */
+	if (fingerprint && fsize)
+		raw_dive_cache_store(devdata, fingerprint, fsize, dive->dc.diveid, data, size);
+
 	// Parse the dive's header data
 	rc = libdc_header_parser (parser, devdata, dive);
 	if (rc != DC_STATUS_SUCCESS) {
@@ -817,30 +992,33 @@ static int dive_cb(const unsigned char *data, unsigned int size,
 		goto error_exit;
 	}
 
-	// Initialize the sample data.
-	rc = parse_samples(devdata, &dive->dc, parser);
-	if (rc != DC_STATUS_SUCCESS) {
-		download_error(translate("gettextFromC", "Error parsing the samples"));
-		goto error_exit;
-	}
-
-	dc_parser_destroy(parser);
-
-	/* If we already saw this dive, abort. */
+	/*
+	 * If we already saw this dive, abort. This only needs the header
+	 * data, so do it before spending time on parsing the samples while
+	 * the dive computer is waiting.
+	 */
 	if (!devdata->force_download && find_dive(&dive->dc)) {
 		char *date_string = get_dive_date_c_string(dive->when);
+		bool interrupted = in_checkpoint(devdata, dive->dc.diveid);
 		dev_info(devdata, translate("gettextFromC", "Already downloaded dive at %s"), date_string);
 		free(date_string);
+		dc_parser_destroy(parser);
 		free(dive);
-		return false;
+		/* Older dives might be missing if the download of this one was interrupted */
+		return interrupted;
 	}
 
-	/* Various libdivecomputer interface fixups */
-	if (dive->dc.airtemp.mkelvin == 0 && first_temp_is_air && dive->dc.samples) {
-		dive->dc.airtemp = dive->dc.sample[0].temperature;
-		dive->dc.sample[0].temperature.mkelvin = 0;
+	// Initialize the sample data.
+	rc = parse_samples(devdata, &dive->dc, parser);
+	if (rc != DC_STATUS_SUCCESS) {
+		download_error(translate("gettextFromC", "Error parsing the samples"));
+		goto error_exit;
 	}
 
+	dc_parser_destroy(parser);
+	fixup_dive(dive);
+
+	add_to_checkpoint(devdata, dive->dc.diveid);
 	record_dive_to_table(dive, devdata->download_table);
 	return true;
 
@@ -941,9 +1119,6 @@ static unsigned int fixup_suunto_versions(device_data_t *devdata, const dc_event
 
 	return serial;
 }
-#ifndef O_BINARY
-  #define O_BINARY 0
-#endif
 static void do_save_fingerprint(device_data_t *devdata, const char *tmp, const char *final)
 {
 	int fd, written = -1;
@@ -1074,6 +1249,10 @@ static void event_cb(dc_device_t *device, dc_event_type_t event, const void *dat
 	case DC_EVENT_PROGRESS:
 		if (!progress->maximum)
 			break;
+		if (devdata->progress_cb) {
+			devdata->progress_cb(devdata, (double)progress->current / (double)progress->maximum, NULL);
+			break;
+		}
 		progress_bar_fraction = (double)progress->current / (double)progress->maximum;
 		break;
 	case DC_EVENT_DEVINFO:
@@ -1114,9 +1293,12 @@ static void event_cb(dc_device_t *device, dc_event_type_t event, const void *dat
 		devdata->libdc_firmware = devinfo->firmware;
 
 		lookup_fingerprint(device, devdata);
+		load_checkpoint(devdata);
 
 		break;
 	case DC_EVENT_CLOCK:
+		devdata->devtime = clock->devtime;
+		devdata->systime = clock->systime;
 		dev_info(devdata, translate("gettextFromC", "Event: systime=%" PRId64 ", devtime=%u\n"),
 			 (uint64_t)clock->systime, clock->devtime);
 		if (devdata->libdc_logfile) {
@@ -1181,7 +1363,8 @@ static const char *do_device_import(device_data_t *data)
 	}
 
 	if (rc != DC_STATUS_SUCCESS) {
-		progress_bar_fraction = 0.0;
+		if (!data->progress_cb)
+			progress_bar_fraction = 0.0;
 		return translate("gettextFromC", "Dive data import error");
 	}
 
@@ -1189,7 +1372,7 @@ static const char *do_device_import(device_data_t *data)
 	return NULL;
 }
 
-static dc_timer_t *logfunc_timer = NULL;
+static THREAD_LOCAL dc_timer_t *logfunc_timer = NULL;
 void logfunc(dc_context_t *context, dc_loglevel_t loglevel, const char *file, unsigned int line, const char *function, const char *msg, void *userdata)
 {
 	UNUSED(context);
@@ -1456,6 +1639,7 @@ const char *do_libdivecomputer_import(device_data_t *data)
 	dc_status_t rc;
 	const char *err;
 	FILE *fp = NULL;
+	bool complete = false;
 
 	import_dive_number = 0;
 	first_temp_is_air = 0;
@@ -1464,6 +1648,10 @@ const char *do_libdivecomputer_import(device_data_t *data)
 	data->iostream = NULL;
 	data->fingerprint = NULL;
 	data->fsize = 0;
+	data->checkpoint_ids = NULL;
+	data->checkpoint_nr = 0;
+	data->devtime = 0;
+	data->systime = 0;
 
 	if (data->libdc_log && logfile_name)
 		fp = subsurface_fopen(logfile_name, "w");
@@ -1500,6 +1688,7 @@ const char *do_libdivecomputer_import(device_data_t *data)
 		if (rc == DC_STATUS_SUCCESS) {
 			dev_info(data, "Starting import ...");
 			err = do_device_import(data);
+			complete = err == NULL;
 			/* TODO: Show the logfile to the user on error. */
 			dc_device_close(data->device);
 			data->device = NULL;
@@ -1512,19 +1701,31 @@ const char *do_libdivecomputer_import(device_data_t *data)
 
 	dc_context_free(data->context);
 	data->context = NULL;
+	free_dc_start_index();
 
 	if (fp) {
 		fclose(fp);
 	}
 
 	/*
-	 * Note that we save the fingerprint unconditionally.
+	 * Note that we save the fingerprint of every finished download.
 	 * This is ok because we only have fingerprint data if
 	 * we got a dive header, and because we will use the
 	 * dive id to verify that we actually have the dive
 	 * it refers to before we use the fingerprint data.
+	 * After an interrupted download, the old fingerprint and
+	 * the checkpoint are kept, see add_to_checkpoint().
 	 */
-	save_fingerprint(data);
+	if (complete) {
+		save_fingerprint(data);
+		remove_checkpoint(data);
+	} else {
+		free(data->fingerprint);
+		data->fingerprint = NULL;
+	}
+	free(data->checkpoint_ids);
+	data->checkpoint_ids = NULL;
+	data->checkpoint_nr = 0;
 
 	return err;
 }
@@ -1543,7 +1744,12 @@ dc_status_t libdc_buffer_parser(struct dive *dive, device_data_t *data, unsigned
 	dc_status_t rc;
 	dc_parser_t *parser = NULL;
 
-	switch (dc_descriptor_get_type(data->descriptor)) {
+	reset_dive_state();
+	/* Dives downloaded by libdivecomputer itself can be parsed for any family */
+	if (data->raw_buffer) {
+		first_temp_is_air = data->vendor && !strcmp(data->vendor, "Suunto");
+		rc = dc_parser_new2(&parser, data->context, data->descriptor, data->devtime, data->systime);
+	} else switch (dc_descriptor_get_type(data->descriptor)) {
 	case DC_FAMILY_UWATEC_ALADIN:
 	case DC_FAMILY_UWATEC_MEMOMOUSE:
 	case DC_FAMILY_UWATEC_SMART:
@@ -1570,7 +1776,8 @@ dc_status_t libdc_buffer_parser(struct dive *dive, device_data_t *data, unsigned
 	}
 	// Do not parse Aladin/Memomouse headers as they are fakes
 	// Do not return on error, we can still parse the samples
-	if (dc_descriptor_get_type(data->descriptor) != DC_FAMILY_UWATEC_ALADIN && dc_descriptor_get_type(data->descriptor) != DC_FAMILY_UWATEC_MEMOMOUSE) {
+	if (data->raw_buffer ||
+	    (dc_descriptor_get_type(data->descriptor) != DC_FAMILY_UWATEC_ALADIN && dc_descriptor_get_type(data->descriptor) != DC_FAMILY_UWATEC_MEMOMOUSE)) {
 		rc = libdc_header_parser (parser, data, dive);
 		if (rc != DC_STATUS_SUCCESS) {
 			report_error("Error parsing the dive header data. Dive # %d\nStatus = %s", dive->number, errmsg(rc));
@@ -1583,6 +1790,8 @@ dc_status_t libdc_buffer_parser(struct dive *dive, device_data_t *data, unsigned
 		return rc;
 	}
 	dc_parser_destroy(parser);
+	if (data->raw_buffer)
+		fixup_dive(dive);
 	return DC_STATUS_SUCCESS;
 }
 
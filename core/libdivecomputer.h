@@ -30,14 +30,20 @@ struct dive;
 struct dive_computer;
 struct devices;
 
-typedef struct {
+typedef struct device_data device_data_t;
+struct device_data {
 	dc_descriptor_t *descriptor;
 	const char *vendor, *product, *devname;
 	const char *model, *btname;
 	unsigned char *fingerprint;
 	unsigned int fsize, fdiveid;
+	uint32_t *checkpoint_ids;		/* dives downloaded by an interrupted earlier download */
+	int checkpoint_nr;
 	uint32_t libdc_firmware;
 	uint32_t deviceid, diveid;
+	unsigned int devtime;			/* clock of the dive computer at systime, if it reported it */
+	dc_ticks_t systime;
+	bool raw_buffer;			/* libdc_buffer_parser() gets dives as downloaded by libdivecomputer */
 	dc_device_t *device;
 	dc_context_t *context;
 	dc_iostream_t *iostream;
@@ -50,7 +56,13 @@ typedef struct {
 	struct dive_site_table *sites;
 	struct device_table *devices;
 	void *androidUsbDeviceDescriptor;
-} device_data_t;
+	/*
+	 * If set, the progress is reported here instead of in the global progress_bar_* variables.
+	 * Called on the download thread, with fraction < 0 or text == NULL for values that didn't change.
+	 */
+	void (*progress_cb)(device_data_t *data, double fraction, const char *text);
+	void *progress_userdata;
+};
 
 const char *errmsg (dc_status_t rc);
 const char *do_libdivecomputer_import(device_data_t *data);
@@ -28,14 +28,31 @@
 #include "qthelper.h"
 #include "tag.h"
 #include "subsurface-time.h"
+#include "parallel.h"
+#include "git-snapshot.h"
+#include "trace.h"
 
 const char *saved_git_id = NULL;
+bool git_load_parallel = true;
+bool git_use_snapshot = true;
+
+/*
+ * A divecomputer blob whose parsing has been postponed, so that
+ * it can be done on a worker thread once the tree has been walked.
+ */
+struct git_dc_job {
+	git_blob *blob;
+	struct divecomputer *dc;
+	int o2pressure_sensor;
+};
 
 struct git_parser_state {
 	git_repository *repo;
 	struct divecomputer *active_dc;
 	struct dive *active_dive;
 	dive_trip_t *active_trip;
+	git_oid active_trip_id;
+	git_oid sites_id;
 	char *fulltext_mode;
 	char *fulltext_query;
 	char *filter_constraint_type;
@@ -52,6 +69,27 @@ struct git_parser_state {
 	struct device_table *devices;
 	struct filter_preset_table *filter_presets;
 	int o2pressure_sensor;
+
+	/*
+	 * "worker" is set for the parser states used on the worker
+	 * threads: these must not touch any of the shared tables.
+	 */
+	bool worker;
+	/* The dives came from a snapshot - only settings and presets are parsed */
+	bool snapshot_loaded;
+	struct git_dc_job *dc_jobs;
+	int nr_dc_jobs, alloc_dc_jobs;
+	size_t dc_job_bytes;
+
+	/*
+	 * Previously loaded dives, sorted by git id. A dive directory
+	 * whose id matches one of these is not parsed again, but the
+	 * old dive is moved over to "reused_dives" instead.
+	 */
+	struct dive **reuse;
+	bool *reused;
+	int nr_reuse;
+	struct dive_table reused_dives;
 };
 
 struct keyword_action {
@@ -188,6 +226,7 @@ static void parse_dive_gps(char *line, struct membuffer *str, struct git_parser_
 			free(coords);
 		}
 		ds->location = location;
+		invalidate_dive_site_gps_index();
 	}
 
 }
@@ -206,6 +245,7 @@ static void parse_dive_location(char *line, struct membuffer *str, struct git_pa
 		// we already had a dive site linked to the dive
 		if (empty_string(ds->name)) {
 			ds->name = strdup(name);
+			invalidate_dive_site_name_index();
 		} else {
 			// and that dive site had a name. that's weird - if our name is different, add it to the notes
 			if (!same_string(ds->name, name))
@@ -308,7 +348,7 @@ static void parse_site_description(char *line, struct membuffer *str, struct git
 { UNUSED(line); state->active_site->description = detach_cstring(str); }
 
 static void parse_site_name(char *line, struct membuffer *str, struct git_parser_state *state)
-{ UNUSED(line); state->active_site->name = detach_cstring(str); }
+{ UNUSED(line); state->active_site->name = detach_cstring(str); invalidate_dive_site_name_index(); }
 
 static void parse_site_notes(char *line, struct membuffer *str, struct git_parser_state *state)
 { UNUSED(line); state->active_site->notes = detach_cstring(str); }
@@ -608,7 +648,7 @@ static void parse_sample_keyvalue(void *_sample, const char *key, const char *va
 	report_error("Unexpected sample key/value pair (%s/%s)", key, value);
 }
 
-static char *parse_sample_unit(struct sample *sample, double val, char *unit)
+static char *parse_sample_unit(struct sample *sample, int milli, char *unit)
 {
 	unsigned int sensor;
 	char *end = unit, c;
@@ -626,16 +666,16 @@ static char *parse_sample_unit(struct sample *sample, double val, char *unit)
 	/* The cylinder pressure may also be of the form '123.0bar:4' to indicate sensor */
 	switch (*unit) {
 	case 'm':
-		sample->depth.mm = lrint(1000 * val);
+		sample->depth.mm = milli;
 		break;
 	case 'b':
 		sensor = sample->sensor[0];
 		if (end > unit + 4 && unit[3] == ':')
 			sensor = atoi(unit + 4);
-		add_sample_pressure(sample, sensor, lrint(1000 * val));
+		add_sample_pressure(sample, sensor, milli);
 		break;
 	default:
-		sample->temperature.mkelvin = C_to_mkelvin(val);
+		sample->temperature.mkelvin = milli + ZERO_C_IN_MKELVIN;
 		break;
 	}
 
@@ -674,14 +714,159 @@ static struct sample *new_sample(struct git_parser_state *state)
 	return sample;
 }
 
+/*
+ * Hand-rolled number parsing for the sample lines. These are by far the
+ * most common lines and their numbers are of the simple form written by
+ * save_sample(), so there's no need to go through the generic strtod().
+ */
+static const char *parse_sample_int(const char *p, int *res)
+{
+	bool negative = false;
+	const char *start;
+	int val = 0;
+
+	while (isspace(*p))
+		p++;
+	if (*p == '-' || *p == '+')
+		negative = *p++ == '-';
+	start = p;
+	while (*p >= '0' && *p <= '9')
+		val = val * 10 + *p++ - '0';
+	if (p == start)
+		return NULL;
+	*res = negative ? -val : val;
+	return p;
+}
+
+/*
+ * Numbers as written by put_milli(): an optional sign, digits and at
+ * most three decimals. Returns the value in thousandths, or NULL if
+ * the number is of any other form.
+ */
+static const char *parse_sample_milli(const char *p, int *res)
+{
+	bool negative = false;
+	int val = 0, digits = 0, decimals = 0;
+
+	if (*p == '-')
+		negative = *p++ == '-';
+	while (*p >= '0' && *p <= '9') {
+		if (++digits > 6)
+			return NULL;
+		val = val * 10 + *p++ - '0';
+	}
+	if (*p == '.') {
+		p++;
+		while (*p >= '0' && *p <= '9') {
+			if (++decimals > 3)
+				return NULL;
+			val = val * 10 + *p++ - '0';
+		}
+	}
+	if ((!digits && !decimals) || *p == 'e' || *p == 'E')
+		return NULL;
+	for (; decimals < 3; decimals++)
+		val *= 10;
+	*res = negative ? -val : val;
+	return p;
+}
+
+static int get_sample_milli(const char *value)
+{
+	int milli;
+	if (!parse_sample_milli(value, &milli))
+		milli = lrint(1000 * ascii_strtod(value, NULL));
+	return milli;
+}
+
+static int get_sample_int(const char *value)
+{
+	int res = 0;
+	parse_sample_int(value, &res);
+	return res;
+}
+
+static int get_sample_duration(const char *value)
+{
+	int m = 0, s = 0;
+	value = parse_sample_int(value, &m);
+	if (value && *value == ':')
+		parse_sample_int(value + 1, &s);
+	return m * 60 + s;
+}
+
+/*
+ * Parse the key=value pairs that save_sample() writes directly into the
+ * sample. Anything unexpected goes through the generic key/value parser.
+ */
+static char *parse_sample_keyvalue_fast(struct sample *sample, char *line)
+{
+	char *key = line, *value = line, c;
+	size_t len;
+
+	while (((c = *value) >= 'a' && c <= 'z') || c == '_')
+		value++;
+	while ((c = *value) >= '0' && c <= '9')
+		value++;
+	if (c != '=')
+		return parse_keyvalue_entry(parse_sample_keyvalue, sample, line, NULL);
+	len = value++ - key;
+
+#define KEY(s) (len == sizeof(s) - 1 && !memcmp(key, s, len))
+	if (KEY("ndl"))
+		sample->ndl.seconds = get_sample_duration(value);
+	else if (KEY("tts"))
+		sample->tts.seconds = get_sample_duration(value);
+	else if (KEY("in_deco"))
+		sample->in_deco = get_sample_int(value);
+	else if (KEY("stoptime"))
+		sample->stoptime.seconds = get_sample_duration(value);
+	else if (KEY("stopdepth"))
+		sample->stopdepth.mm = get_sample_milli(value);
+	else if (KEY("cns"))
+		sample->cns = get_sample_int(value);
+	else if (KEY("rbt"))
+		sample->rbt.seconds = get_sample_duration(value);
+	else if (KEY("po2"))
+		sample->setpoint.mbar = get_sample_milli(value);
+	else if (KEY("sensor1"))
+		sample->o2sensor[0].mbar = get_sample_milli(value);
+	else if (KEY("sensor2"))
+		sample->o2sensor[1].mbar = get_sample_milli(value);
+	else if (KEY("sensor3"))
+		sample->o2sensor[2].mbar = get_sample_milli(value);
+	else if (KEY("o2pressure"))
+		sample->pressure[1].mbar = get_sample_milli(value);
+	else if (KEY("sensor"))
+		sample->sensor[0] = get_sample_int(value);
+	else if (KEY("heartbeat"))
+		sample->heartbeat = get_sample_int(value);
+	else if (KEY("bearing"))
+		sample->bearing.degrees = get_sample_int(value);
+	else
+		return parse_keyvalue_entry(parse_sample_keyvalue, sample, line, NULL);
+#undef KEY
+
+	/* Like the generic parser, ignore anything up to the next space */
+	while ((c = *value) != 0) {
+		value++;
+		if (isspace(c))
+			break;
+	}
+	return value;
+}
+
 static void sample_parser(char *line, struct git_parser_state *state)
 {
-	int m, s = 0;
+	int m = 0, s = 0;
 	struct sample *sample = new_sample(state);
+	const char *p;
 
-	m = strtol(line, &line, 10);
-	if (*line == ':')
-		s = strtol(line + 1, &line, 10);
+	if ((p = parse_sample_int(line, &m)) != NULL) {
+		line = (char *)p;
+		if (*line == ':' && (p = parse_sample_int(line + 1, &s)) != NULL)
+			line = (char *)p;
+	}
 	sample->time.seconds = m * 60 + s;
 
 	for (;;) {
@@ -693,16 +878,19 @@ static void sample_parser(char *line, struct git_parser_state *state)
 			break;
 		/* Less common sample entries have a name */
 		if (c >= 'a' && c <= 'z') {
-			line = parse_keyvalue_entry(parse_sample_keyvalue, sample, line, NULL);
+			line = parse_sample_keyvalue_fast(sample, line);
 		} else {
-			const char *end;
-			double val = ascii_strtod(line, &end);
-			if (end == line) {
-				report_error("Odd sample data: %s", line);
-				break;
+			int milli;
+			const char *end = parse_sample_milli(line, &milli);
+			if (!end) {
+				double val = ascii_strtod(line, &end);
+				if (end == line) {
+					report_error("Odd sample data: %s", line);
+					break;
+				}
+				milli = lrint(1000 * val);
 			}
-			line = (char *)end;
-			line = parse_sample_unit(sample, val, line);
+			line = parse_sample_unit(sample, milli, (char *)end);
 		}
 	}
 	finish_sample(state->active_dc);
@@ -718,6 +906,12 @@ static void parse_dc_deviceid(char *line, struct membuffer *str, struct git_pars
 {
 	UNUSED(str);
 	int id = get_hex(line);
+
+	/* The device tables are shared - they are consulted in finish_dc_jobs() */
+	if (state->worker) {
+		state->active_dc->deviceid = id;
+		return;
+	}
 	set_dc_deviceid(state->active_dc, id, &device_table); // prefer already known serial/firmware over those from the loaded log
 	set_dc_deviceid(state->active_dc, id, state->devices);
 }
@@ -860,7 +1054,14 @@ static void parse_dc_event(char *line, struct membuffer *str, struct git_parser_
 	if (p.has_divemode && strcmp(p.name, "modechange"))
 		p.name = "modechange";
 
-	ev = add_event(state->active_dc, p.ev.time.seconds, p.ev.type, p.ev.flags, p.ev.value, p.name);
+	/* Worker threads can't touch the global event name list - see finish_dc_jobs() */
+	if (state->worker) {
+		ev = create_event(p.ev.time.seconds, p.ev.type, p.ev.flags, p.ev.value, p.name);
+		if (ev)
+			add_event_to_dc(state->active_dc, ev);
+	} else {
+		ev = add_event(state->active_dc, p.ev.time.seconds, p.ev.type, p.ev.flags, p.ev.value, p.name);
+	}
 
 	/*
 	 * Older logs might mark the dive to be CCR by having an "SP change" event at time 0:00.
@@ -1256,7 +1457,7 @@ static void filter_preset_parser(char *line, struct membuffer *str, struct git_p
  */
 static const char *parse_one_string(const char *buf, const char *end, struct membuffer *b)
 {
-	const char *p = buf;
+	const char *p = buf, *quote = NULL;
 
 	/*
 	 * We turn multiple strings one one line (think dive tags) into one
@@ -1266,8 +1467,28 @@ static const char *parse_one_string(const char *buf, const char *end, struct mem
 		put_bytes(b, "", 1);
 
 	while (p < end) {
+		const char *special, *nl;
 		char replace;
 
+		/*
+		 * Most strings have no escapes at all, so look for the
+		 * special characters with memchr() instead of testing
+		 * character by character. The closing quote is only
+		 * searched again once we went past an escaped one.
+		 */
+		if (!quote || quote < p) {
+			quote = memchr(p, '"', end - p);
+			if (!quote)
+				quote = end;
+		}
+		special = memchr(p, '\\', quote - p);
+		if (!special)
+			special = quote;
+		nl = memchr(p, '\n', special - p);
+		p = nl ? nl : special;
+		if (p == end)
+			break;
+
 		switch (*p++) {
 		default:
 			continue;
@@ -1306,15 +1527,27 @@ static unsigned parse_one_line(const char *buf, unsigned size, line_fn_t *fn, st
 	int off = 0;
 
 	while (p < end) {
-		char c = *p++;
-		if (c == '\n')
-			break;
-		line[off] = c;
-		off++;
-		if (off > MAXLINE)
-			off = MAXLINE;
-		if (c == '"')
+		/* Copy everything up to the end of the line or the next string in one go */
+		const char *nl = memchr(p, '\n', end - p);
+		const char *stop = nl ? nl : end;
+		const char *quote = memchr(p, '"', stop - p);
+		int len;
+
+		if (quote)
+			stop = quote + 1;
+		len = stop - p;
+		if (len > MAXLINE - off)
+			len = MAXLINE - off;
+		memcpy(line + off, p, len);
+		off += len;
+		p = stop;
+		if (quote) {
 			p = parse_one_string(p, end, b);
+			continue;
+		}
+		if (nl)
+			p++;
+		break;
 	}
 	line[off] = 0;
 	fn(line, b, state);
@@ -1352,6 +1585,8 @@ static void finish_active_trip(struct git_parser_state *state)
 
 	if (trip) {
 		state->active_trip = NULL;
+		/* Only now, since adding the dives invalidated the cache */
+		memcpy(trip->git_id, state->active_trip_id.id, 20);
 		insert_trip(trip, state->trips);
 	}
 }
@@ -1362,7 +1597,11 @@ static void finish_active_dive(struct git_parser_state *state)
 
 	if (dive) {
 		state->active_dive = NULL;
-		record_dive_to_table(dive, state->table);
+		/* With postponed divecomputer parsing, the fixup is done in load_dives_from_tree() */
+		if (git_load_parallel)
+			add_to_dive_table(state->table, state->table->nr, dive);
+		else
+			record_dive_to_table(dive, state->table);
 	}
 }
 
@@ -1377,6 +1616,118 @@ static void create_new_dive(timestamp_t when, struct git_parser_state *state)
 		add_dive_to_trip(state->active_dive, state->active_trip);
 }
 
+/*
+ * Register the data of a divecomputer with the shared tables. This
+ * is postponed for divecomputers parsed on worker threads.
+ */
+static void register_dc(struct divecomputer *dc, struct git_parser_state *state)
+{
+	struct event *ev;
+
+	if (dc->deviceid) {
+		set_dc_deviceid(dc, dc->deviceid, &device_table); // prefer already known serial/firmware over those from the loaded log
+		set_dc_deviceid(dc, dc->deviceid, state->devices);
+	}
+	for (ev = dc->events; ev; ev = ev->next)
+		remember_event(ev->name);
+}
+
+static int comp_git_id(const void *_a, const void *_b)
+{
+	const struct dive *a = *(const struct dive **)_a;
+	const struct dive *b = *(const struct dive **)_b;
+	return memcmp(a->git_id, b->git_id, 20);
+}
+
+/* Index of the first dive in the reuse list with the given id */
+static int reuse_lower_bound(const unsigned char *id, const struct git_parser_state *state)
+{
+	int lo = 0, hi = state->nr_reuse;
+
+	while (lo < hi) {
+		int mid = (lo + hi) / 2;
+		if (memcmp(state->reuse[mid]->git_id, id, 20) < 0)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return lo;
+}
+
+static void setup_reuse(struct dive_table *old_dives, struct git_parser_state *state)
+{
+	if (!old_dives || !old_dives->nr)
+		return;
+	state->reuse = malloc(old_dives->nr * sizeof(struct dive *));
+	for (int i = 0; i < old_dives->nr; i++) {
+		/* Dives that were changed since they were loaded have no id */
+		if (dive_cache_is_valid(old_dives->dives[i]))
+			state->reuse[state->nr_reuse++] = old_dives->dives[i];
+	}
+	qsort(state->reuse, state->nr_reuse, sizeof(struct dive *), comp_git_id);
+	state->reused = calloc(state->nr_reuse, sizeof(bool));
+}
+
+/* The git id of a directory covers its whole content, so same id means same dive */
+static bool reuse_dive(const git_oid *id, timestamp_t when, struct git_parser_state *state)
+{
+	struct dive *dive;
+	struct dive_site *ds;
+	struct divecomputer *dc;
+	int idx;
+
+	for (idx = reuse_lower_bound(id->id, state); idx < state->nr_reuse; idx++) {
+		if (memcmp(state->reuse[idx]->git_id, id->id, 20))
+			return false;
+		if (!state->reused[idx] && state->reuse[idx]->when == when)
+			break;
+	}
+	if (idx >= state->nr_reuse)
+		return false;
+	state->reused[idx] = true;
+	dive = state->reuse[idx];
+
+	/* The old trips and dive sites are replaced by the freshly parsed ones */
+	unregister_dive_from_trip(dive);
+	if (state->active_trip)
+		add_dive_to_trip(dive, state->active_trip);
+	ds = unregister_dive_from_dive_site(dive);
+	if (ds)
+		add_dive_to_dive_site(dive, get_dive_site_by_uuid(ds->uuid, state->sites));
+
+	for (dc = &dive->dc; dc; dc = dc->next)
+		register_dc(dc, state);
+	add_to_dive_table(&state->reused_dives, state->reused_dives.nr, dive);
+	return true;
+}
+
+/* Remove the reused dives from the old dive table */
+static void finish_reuse(struct dive_table *old_dives, struct git_parser_state *state)
+{
+	int i, j;
+
+	if (!old_dives)
+		return;
+	for (i = j = 0; i < old_dives->nr; i++) {
+		struct dive *dive = old_dives->dives[i];
+		bool reused = false;
+		if (dive_cache_is_valid(dive)) {
+			for (int idx = reuse_lower_bound(dive->git_id, state); idx < state->nr_reuse; idx++) {
+				if (state->reuse[idx] == dive) {
+					reused = state->reused[idx];
+					break;
+				}
+			}
+		}
+		if (!reused)
+			old_dives->dives[j++] = dive;
+	}
+	old_dives->nr = j;
+	free(state->reuse);
+	free(state->reused);
+	free(state->reused_dives.dives);
+}
+
 static bool validate_date(int yyyy, int mm, int dd)
 {
 	return yyyy > 1930 && yyyy < 3000 &&
@@ -1394,7 +1745,7 @@ static bool validate_time(int h, int m, int s)
 /*
  * Dive trip directory, name is 'nn-alphabetic[~hex]'
  */
-static int dive_trip_directory(const char *root, const char *name, struct git_parser_state *state)
+static int dive_trip_directory(const char *root, const git_tree_entry *entry, const char *name, struct git_parser_state *state)
 {
 	int yyyy = -1, mm = -1, dd = -1;
 
@@ -1405,6 +1756,7 @@ static int dive_trip_directory(const char *root, const char *name, struct git_pa
 		return GIT_WALK_SKIP;
 	finish_active_trip(state);
 	state->active_trip = alloc_trip();
+	git_oid_cpy(&state->active_trip_id, git_tree_entry_id(entry));
 	return GIT_WALK_OK;
 }
 
@@ -1493,6 +1845,8 @@ static int dive_directory(const char *root, const git_tree_entry *entry, const c
 	tm.tm_mday = dd;
 
 	finish_active_dive(state);
+	if (reuse_dive(git_tree_entry_id(entry), utc_mktime(&tm), state))
+		return GIT_WALK_SKIP;
 	create_new_dive(utc_mktime(&tm), state);
 	memcpy(state->active_dive->git_id, git_tree_entry_id(entry)->id, 20);
 	return GIT_WALK_OK;
@@ -1567,8 +1921,10 @@ static int walk_tree_directory(const char *root, const git_tree_entry *entry, st
 	if (!strcmp(name, "Pictures"))
 		return picture_directory(root, name, state);
 
-	if (!strcmp(name, "01-Divesites"))
+	if (!strcmp(name, "01-Divesites")) {
+		git_oid_cpy(&state->sites_id, git_tree_entry_id(entry));
 		return GIT_WALK_OK;
+	}
 
 	if (!strcmp(name, "02-Filterpresets"))
 		return GIT_WALK_OK;
@@ -1601,7 +1957,7 @@ static int walk_tree_directory(const char *root, const git_tree_entry *entry, st
 	if (digits != 2)
 		return GIT_WALK_SKIP;
 
-	return dive_trip_directory(root, name, state);
+	return dive_trip_directory(root, entry, name, state);
 }
 
 static git_blob *git_tree_entry_blob(git_repository *repo, const git_tree_entry *entry)
@@ -1633,6 +1989,98 @@ static struct divecomputer *create_new_dc(struct dive *dive)
 	return dc;
 }
 
+/*
+ * Every line of a divecomputer file that doesn't start with a keyword
+ * is a sample. Allocate the sample array in one go, instead of growing
+ * it sample by sample.
+ */
+static void presize_samples(struct divecomputer *dc, git_blob *blob)
+{
+	const char *p = git_blob_rawcontent(blob);
+	const char *end = p + git_blob_rawsize(blob);
+	int nr = 0;
+
+	while (p < end) {
+		const char *nl = memchr(p, '\n', end - p);
+		if (*p < 'a' || *p > 'z')
+			nr++;
+		if (!nl)
+			break;
+		p = nl + 1;
+	}
+	alloc_samples(dc, dc->samples + nr);
+}
+
+static void parse_dc_blob(git_blob *blob, struct git_parser_state *state)
+{
+	presize_samples(state->active_dc, blob);
+	for_each_line(blob, divecomputer_parser, state);
+}
+
+/*
+ * Parsing the divecomputer blobs, with all their samples, is where most
+ * of the load time goes. Since a divecomputer only ever refers to its
+ * own data, we collect the blobs during the tree walk and parse them in
+ * parallel once the walk is done. The divecomputer itself is created in
+ * walk order, so the end result is the same as for a serial load.
+ *
+ * Unparsed blobs take memory, so we flush the queue once this much data
+ * has been collected.
+ */
+#define MAX_DC_JOB_BYTES (64 * 1024 * 1024)
+
+static void parse_dc_job(int idx, void *data)
+{
+	struct git_dc_job *job = (struct git_dc_job *)data + idx;
+	struct git_parser_state state = { 0 };
+
+	state.worker = true;
+	state.active_dc = job->dc;
+	state.o2pressure_sensor = job->o2pressure_sensor;
+	parse_dc_blob(job->blob, &state);
+}
+
+/*
+ * What the worker threads could not do, because it touches shared data:
+ * look up the device tables and register the event names.
+ */
+static void finish_dc_job(struct git_dc_job *job, struct git_parser_state *state)
+{
+	register_dc(job->dc, state);
+	git_blob_free(job->blob);
+}
+
+static void flush_dc_jobs(struct git_parser_state *state)
+{
+	int i;
+
+	parallel_for(state->nr_dc_jobs, parse_dc_job, state->dc_jobs);
+	for (i = 0; i < state->nr_dc_jobs; i++)
+		finish_dc_job(&state->dc_jobs[i], state);
+	state->nr_dc_jobs = 0;
+	state->dc_job_bytes = 0;
+}
+
+static void queue_dc_job(struct git_parser_state *state, git_blob *blob)
+{
+	struct git_dc_job *job;
+
+	if (state->nr_dc_jobs >= state->alloc_dc_jobs) {
+		state->alloc_dc_jobs = (state->nr_dc_jobs + 32) * 3 / 2;
+		state->dc_jobs = realloc(state->dc_jobs, state->alloc_dc_jobs * sizeof(*state->dc_jobs));
+		if (!state->dc_jobs)
+			exit(1);
+	}
+	job = &state->dc_jobs[state->nr_dc_jobs++];
+	job->blob = blob;
+	job->dc = state->active_dc;
+	job->o2pressure_sensor = state->o2pressure_sensor;
+
+	state->dc_job_bytes += git_blob_rawsize(blob);
+	if (state->dc_job_bytes >= MAX_DC_JOB_BYTES)
+		flush_dc_jobs(state);
+}
+
 /*
  * We should *really* try to delay the dive computer data parsing
  * until necessary, in order to reduce load-time. The parsing is
@@ -1648,8 +2096,12 @@ static int parse_divecomputer_entry(struct git_parser_state *state, const git_tr
 		return report_error("Unable to read divecomputer file");
 
 	state->active_dc = create_new_dc(state->active_dive);
-	for_each_line(blob, divecomputer_parser, state);
-	git_blob_free(blob);
+	if (git_load_parallel && state->active_dc) {
+		queue_dc_job(state, blob);
+	} else {
+		parse_dc_blob(blob, state);
+		git_blob_free(blob);
+	}
 	state->active_dc = NULL;
 	return 0;
 }
@@ -1800,11 +2252,25 @@ static int walk_tree_file(const char *root, const git_tree_entry *entry, struct
 	return GIT_WALK_SKIP;
 }
 
+static int walk_settings_only(const char *root, const git_tree_entry *entry, struct git_parser_state *state)
+{
+	const char *name = git_tree_entry_name(entry);
+
+	if (git_tree_entry_filemode(entry) == GIT_FILEMODE_TREE)
+		return strcmp(name, "02-Filterpresets") ? GIT_WALK_SKIP : GIT_WALK_OK;
+	if (!strcmp(name, "00-Subsurface") || !strncmp(name, "Preset-", 7))
+		walk_tree_file(root, entry, state);
+	return GIT_WALK_OK;
+}
+
 static int walk_tree_cb(const char *root, const git_tree_entry *entry, void *payload)
 {
 	struct git_parser_state *state = payload;
 	git_filemode_t mode = git_tree_entry_filemode(entry);
 
+	if (state->snapshot_loaded)
+		return walk_settings_only(root, entry, state);
+
 	if (mode == GIT_FILEMODE_TREE)
 		return walk_tree_directory(root, entry, state);
 
@@ -1815,7 +2281,27 @@ static int walk_tree_cb(const char *root, const git_tree_entry *entry, void *pay
 
 static int load_dives_from_tree(git_repository *repo, git_tree *tree, struct git_parser_state *state)
 {
+	int first_dive = state->table->nr;
+	bool fresh_sites = state->sites->nr == 0;
+
 	git_tree_walk(tree, GIT_TREEWALK_PRE, walk_tree_cb, state);
+	finish_active_dive(state);
+	finish_active_trip(state);
+	if (git_load_parallel) {
+		/* The dives can only be fixed up once their divecomputers are parsed */
+		flush_dc_jobs(state);
+		fixup_dives(state->table, first_dive);
+	}
+	/* Reused dives have been fixed up when they were first loaded */
+	for (int i = 0; i < state->reused_dives.nr; i++)
+		add_to_dive_table(state->table, state->table->nr, state->reused_dives.dives[i]);
+	state->reused_dives.nr = 0;
+	/* The site directory describes the table only if we didn't add to existing sites */
+	if (fresh_sites)
+		memcpy(state->sites->git_id, state->sites_id.id, 20);
+	free(state->dc_jobs);
+	state->dc_jobs = NULL;
+	state->alloc_dc_jobs = 0;
 	return 0;
 }
 
@@ -1845,11 +2331,23 @@ static int find_commit(git_repository *repo, const char *branch, git_commit **co
 	return 0;
 }
 
+/*
+ * Snapshots are only used when loading into empty tables, so that
+ * the content of the tables is exactly what was loaded from git.
+ */
+static bool can_use_snapshot(const struct git_parser_state *state)
+{
+	return git_use_snapshot && state->table->nr == 0 && state->trips->nr == 0 &&
+	       state->sites == &dive_site_table && state->sites->nr == 0;
+}
+
 static int do_git_load(git_repository *repo, const char *branch, struct git_parser_state *state)
 {
 	int ret;
 	git_commit *commit;
 	git_tree *tree;
+	char sha[GIT_OID_HEXSZ + 1];
+	bool use_snapshot;
 
 	ret = find_commit(repo, branch, &commit);
 	if (ret)
@@ -1857,7 +2355,14 @@ static int do_git_load(git_repository *repo, const char *branch, struct git_pars
 	if (git_commit_tree(&tree, commit))
 		return report_error("Could not look up tree of commit in branch '%s'", branch);
 	git_storage_update_progress(translate("gettextFromC", "Load dives from local cache"));
+	git_oid_tostr(sha, sizeof(sha), git_commit_id(commit));
+	use_snapshot = can_use_snapshot(state);
+	/* When dives can be reused, that is faster than decoding the snapshot */
+	if (use_snapshot && !state->nr_reuse)
+		state->snapshot_loaded = load_git_snapshot(repo, sha, state->table, state->trips, state->sites);
 	ret = load_dives_from_tree(repo, tree, state);
+	if (!ret && use_snapshot && !state->snapshot_loaded)
+		save_git_snapshot(repo, sha, state->table, state->trips, state->sites);
 	if (!ret) {
 		set_git_id(git_commit_id(commit));
 		git_storage_update_progress(translate("gettextFromC", "Successfully opened dive data"));
@@ -1887,8 +2392,24 @@ const char *get_sha(git_repository *repo, const char *branch)
  */
 int git_load_dives(struct git_repository *repo, const char *branch, struct dive_table *table, struct trip_table *trips,
 		   struct dive_site_table *sites, struct device_table *devices, struct filter_preset_table *filter_presets)
+{
+	return git_load_dives_reuse(repo, branch, NULL, table, trips, sites, devices, filter_presets);
+}
+
+/*
+ * Like git_load_dives(), but dives that are unchanged with respect to
+ * a dive in "old_dives" are not parsed. Instead, the old dive is moved
+ * to the new table, so that a reload after syncing with the remote only
+ * has to parse what the sync brought in. Typically, "old_dives" is the
+ * dive table taken away by detach_dive_file_data(): the trips and dive
+ * sites of these dives must still be valid during the call.
+ */
+int git_load_dives_reuse(struct git_repository *repo, const char *branch, struct dive_table *old_dives, struct dive_table *table,
+			 struct trip_table *trips, struct dive_site_table *sites, struct device_table *devices,
+			 struct filter_preset_table *filter_presets)
 {
 	int ret;
+	struct trace_span span;
 	struct git_parser_state state = { 0 };
 	state.repo = repo;
 	state.table = table;
@@ -1899,10 +2420,14 @@ int git_load_dives(struct git_repository *repo, const char *branch, struct dive_
 
 	if (repo == dummy_git_repository)
 		return report_error("Unable to open git repository at '%s'", branch);
+	span = trace_begin("git_load_dives");
+	setup_reuse(old_dives, &state);
 	ret = do_git_load(repo, branch, &state);
 	git_repository_free(repo);
 	free((void *)branch);
 	finish_active_dive(&state);
 	finish_active_trip(&state);
+	finish_reuse(old_dives, &state);
+	trace_end(span);
 	return ret;
 }
@@ -0,0 +1,246 @@
+// SPDX-License-Identifier: GPL-2.0
+#include "localfilenamestore.h"
+#include "trace.h"
+#include <QDebug>
+#include <QSaveFile>
+#include <QSet>
+#include <QtEndian>
+#include <string.h>
+
+// The file starts with a magic and a format version. Then follow the records:
+// the lengths of the UTF-8 encoded original and local filenames as 32-bit
+// little endian numbers, followed by the two filenames.
+static const char fileHeader[8] = { 'S', 'S', 'L', 'F', 1, 0, 0, 0 };
+static const qint64 recordHeaderSize = 8;
+
+static void appendRecord(QByteArray &buf, const QByteArray &key, const QByteArray &value)
+{
+	uchar header[recordHeaderSize];
+	qToLittleEndian<quint32>(key.size(), header);
+	qToLittleEndian<quint32>(value.size(), header + 4);
+	buf.append((const char *)header, recordHeaderSize);
+	buf.append(key);
+	buf.append(value);
+}
+
+LocalFilenameStore::LocalFilenameStore(const QString &filename) :
+	file(filename),
+	opened(false),
+	data(nullptr),
+	dataSize(0),
+	validSize(0),
+	superseded(0)
+{
+}
+
+LocalFilenameStore::~LocalFilenameStore()
+{
+	unmap();
+}
+
+bool LocalFilenameStore::exists() const
+{
+	return QFile::exists(file.fileName());
+}
+
+void LocalFilenameStore::open()
+{
+	{
+		QReadLocker locker(&lock);
+		if (opened)
+			return;
+	}
+	QWriteLocker locker(&lock);
+	openLocked();
+}
+
+// Must be called with the lock held for writing
+void LocalFilenameStore::openLocked()
+{
+	if (opened)
+		return;
+	opened = true;
+	TraceSpan span("LocalFilenameStore::open");
+	map();
+	if (dataSize >= (qint64)sizeof(fileHeader) && memcmp(data, fileHeader, sizeof(fileHeader)) == 0)
+		scan(sizeof(fileHeader));
+	else if (dataSize > 0)
+		qWarning() << "Ignoring unknown format of" << file.fileName();
+}
+
+void LocalFilenameStore::map()
+{
+	data = nullptr;
+	dataSize = 0;
+	if (!file.open(QIODevice::ReadOnly))
+		return;
+	qint64 size = file.size();
+	if (size > 0)
+		data = file.map(0, size);
+	if (data)
+		dataSize = size;
+	else
+		file.close();
+}
+
+void LocalFilenameStore::unmap()
+{
+	if (data)
+		file.unmap(const_cast<uchar *>(data));
+	data = nullptr;
+	dataSize = 0;
+	file.close();
+}
+
+QByteArray LocalFilenameStore::key(quint32 offset) const
+{
+	quint32 keyLen = qFromLittleEndian<quint32>(data + offset);
+	return QByteArray::fromRawData((const char *)data + offset + recordHeaderSize, keyLen);
+}
+
+QString LocalFilenameStore::value(quint32 offset) const
+{
+	quint32 keyLen = qFromLittleEndian<quint32>(data + offset);
+	quint32 valueLen = qFromLittleEndian<quint32>(data + offset + 4);
+	return QString::fromUtf8((const char *)data + offset + recordHeaderSize + keyLen, valueLen);
+}
+
+// Add the records starting at "from" to the index. Only the headers and
+// the original filenames of records with colliding hashes are read.
+void LocalFilenameStore::scan(qint64 from)
+{
+	qint64 pos = from;
+	while (pos + recordHeaderSize <= dataSize) {
+		qint64 keyLen = qFromLittleEndian<quint32>(data + pos);
+		qint64 valueLen = qFromLittleEndian<quint32>(data + pos + 4);
+		// An incomplete record at the end is overwritten by the next flush
+		if (pos + recordHeaderSize + keyLen + valueLen > dataSize)
+			break;
+		QByteArray k = QByteArray::fromRawData((const char *)data + pos + recordHeaderSize, keyLen);
+		uint h = qHash(k);
+		bool found = false;
+		for (auto it = index.find(h); it != index.end() && it.key() == h; ++it) {
+			if (key(*it) == k) {
+				*it = (quint32)pos;
+				++superseded;
+				found = true;
+				break;
+			}
+		}
+		if (!found)
+			index.insert(h, (quint32)pos);
+		pos += recordHeaderSize + keyLen + valueLen;
+	}
+	validSize = pos;
+}
+
+QString LocalFilenameStore::lookup(const QString &originalName)
+{
+	open();
+	QReadLocker locker(&lock);
+	auto it = pending.constFind(originalName);
+	if (it != pending.cend())
+		return it->isEmpty() ? QString() : *it;
+	QByteArray k = originalName.toUtf8();
+	uint h = qHash(k);
+	for (auto it2 = index.constFind(h); it2 != index.cend() && it2.key() == h; ++it2) {
+		if (key(*it2) == k) {
+			QString res = value(*it2);
+			return res.isEmpty() ? QString() : res;
+		}
+	}
+	return QString();
+}
+
+void LocalFilenameStore::forEach(const std::function<void(const QString &, const QString &)> &f)
+{
+	open();
+	QReadLocker locker(&lock);
+	for (auto it = pending.cbegin(); it != pending.cend(); ++it) {
+		if (!it.value().isEmpty())
+			f(it.key(), it.value());
+	}
+	for (quint32 offset: index) {
+		QString k = QString::fromUtf8(key(offset));
+		if (pending.contains(k))
+			continue;
+		QString v = value(offset);
+		if (!v.isEmpty())
+			f(k, v);
+	}
+}
+
+void LocalFilenameStore::learn(const QString &originalName, const QString &localName)
+{
+	// Don't grow the file if nothing changed, which is the common case
+	if (lookup(originalName) == localName)
+		return;
+	QWriteLocker locker(&lock);
+	pending[originalName] = localName;
+}
+
+// Write the live entries into a new file
+bool LocalFilenameStore::rewrite()
+{
+	QByteArray buf(fileHeader, sizeof(fileHeader));
+	QSet<QByteArray> pendingKeys;
+	for (auto it = pending.cbegin(); it != pending.cend(); ++it) {
+		QByteArray k = it.key().toUtf8();
+		pendingKeys.insert(k);
+		if (!it.value().isEmpty())
+			appendRecord(buf, k, it.value().toUtf8());
+	}
+	for (quint32 offset: index) {
+		QByteArray k = key(offset);
+		if (pendingKeys.contains(k))
+			continue;
+		quint32 valueLen = qFromLittleEndian<quint32>(data + offset + 4);
+		if (valueLen > 0)
+			appendRecord(buf, k, QByteArray((const char *)data + offset + recordHeaderSize + k.size(), valueLen));
+	}
+
+	QSaveFile newFile(file.fileName());
+	if (!newFile.open(QIODevice::WriteOnly) || newFile.write(buf) != buf.size())
+		return false;
+	// The old file can't be replaced while it is mapped on some systems
+	unmap();
+	bool ok = newFile.commit();
+	index.clear();
+	superseded = 0;
+	validSize = 0;
+	map();
+	if (dataSize >= (qint64)sizeof(fileHeader) && memcmp(data, fileHeader, sizeof(fileHeader)) == 0)
+		scan(sizeof(fileHeader));
+	return ok;
+}
+
+// Append the pending entries to the file
+bool LocalFilenameStore::append()
+{
+	QByteArray buf;
+	for (auto it = pending.cbegin(); it != pending.cend(); ++it)
+		appendRecord(buf, it.key().toUtf8(), it.value().toUtf8());
+
+	unmap();
+	bool ok = file.open(QIODevice::ReadWrite) &&
+		  file.resize(validSize) && file.seek(validSize) &&
+		  file.write(buf) == buf.size() && file.flush();
+	file.close();
+	map();
+	scan(validSize);
+	return ok;
+}
+
+void LocalFilenameStore::flush()
+{
+	QWriteLocker locker(&lock);
+	// Nothing can have been learned if the store was never opened
+	if (!opened || pending.isEmpty())
+		return;
+	TraceSpan span("LocalFilenameStore::flush");
+	bool rewriteFile = validSize == 0 || superseded > index.size();
+	if (rewriteFile ? rewrite() : append())
+		pending.clear();
+	else
+		qWarning() << "Cannot write local filenames to" << file.fileName();
+}
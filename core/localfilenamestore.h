@@ -0,0 +1,53 @@
+// SPDX-License-Identifier: GPL-2.0
+// Persistent table of the local filenames of pictures, indexed by the original filename.
+//
+// The file is an append-only log of (original filename, local filename) records and
+// is memory mapped. When the store is opened, only the record headers are scanned to
+// build an index of the hashes of the original filenames, the strings are decoded on
+// lookup. Newly learned filenames are kept in memory until flush() appends them. A
+// record with an empty local filename removes the entry. If most records in the file
+// are superseded, flush() rewrites the file.
+//
+// Any number of threads may look up filenames concurrently.
+#ifndef LOCALFILENAMESTORE_H
+#define LOCALFILENAMESTORE_H
+
+#include <QFile>
+#include <QHash>
+#include <QMultiHash>
+#include <QReadWriteLock>
+#include <QString>
+#include <functional>
+
+class LocalFilenameStore {
+public:
+	LocalFilenameStore(const QString &filename);
+	~LocalFilenameStore();
+	void open();					// Map and index the file, otherwise done on first use
+	bool exists() const;				// The file exists
+	QString lookup(const QString &originalName);	// Returns a null string if unknown
+	void learn(const QString &originalName, const QString &localName); // Empty localName removes the entry
+	void flush();					// Write the learned filenames to disk
+	void forEach(const std::function<void(const QString &, const QString &)> &f); // All entries, in no particular order
+private:
+	void openLocked();
+	void map();
+	void unmap();
+	void scan(qint64 from);
+	QByteArray key(quint32 offset) const;
+	QString value(quint32 offset) const;
+	bool rewrite();
+	bool append();
+
+	QReadWriteLock lock;
+	QFile file;
+	bool opened;
+	const uchar *data;
+	qint64 dataSize;
+	qint64 validSize;			// Size of the correctly written part of the file
+	QMultiHash<uint, quint32> index;	// Hash of the original filename -> offset of the latest record
+	QHash<QString, QString> pending;	// Learned, but not yet written entries
+	int superseded;				// Records in the file that were overwritten by later ones
+};
+
+#endif
@@ -168,30 +168,74 @@ void put_format_loc(struct membuffer *b, const char *fmt, ...)
 	va_end(args);
 }
 
+/*
+ * The numbers of the samples are the bulk of the save files,
+ * so they are formatted by hand instead of going through
+ * vsnprintf(). Writes at least "mindigits" digits, padded
+ * with leading zeroes.
+ */
+static void put_digits(struct membuffer *b, unsigned int value, int mindigits)
+{
+	char buf[10];
+	int i = sizeof(buf);
+
+	do {
+		buf[--i] = (value % 10) + '0';
+		value /= 10;
+	} while (value || (int)sizeof(buf) - i < mindigits);
+	put_bytes(b, buf + i, sizeof(buf) - i);
+}
+
+void put_uint(struct membuffer *b, const char *pre, unsigned int value, const char *post)
+{
+	put_string(b, pre);
+	put_digits(b, value, 1);
+	put_string(b, post);
+}
+
+void put_int(struct membuffer *b, const char *pre, int value, const char *post)
+{
+	unsigned int v = value;
+
+	put_string(b, pre);
+	if (value < 0) {
+		put_bytes(b, "-", 1);
+		v = -v;
+	}
+	put_digits(b, v, 1);
+	put_string(b, post);
+}
+
+void put_min_sec(struct membuffer *b, const char *pre, int seconds, const char *post)
+{
+	put_string(b, pre);
+	put_digits(b, seconds / 60, 1);
+	put_bytes(b, ":", 1);
+	put_digits(b, seconds % 60, 2);
+	put_string(b, post);
+}
+
 void put_milli(struct membuffer *b, const char *pre, int value, const char *post)
 {
-	int i;
-	char buf[4];
-	const char *sign = "";
-	unsigned v;
+	int len = 3;
+	unsigned int v, frac;
 
+	put_string(b, pre);
 	v = value;
 	if (value < 0) {
-		sign = "-";
-		v = -value;
+		put_bytes(b, "-", 1);
+		v = -v;
 	}
-	for (i = 2; i >= 0; i--) {
-		buf[i] = (v % 10) + '0';
-		v /= 10;
+	frac = v % 1000;
+	put_digits(b, v / 1000, 1);
+	put_bytes(b, ".", 1);
+	/* drop trailing zeroes, but keep at least one decimal */
+	while (len > 1 && frac % 10 == 0) {
+		frac /= 10;
+		len--;
 	}
-	buf[3] = 0;
-	if (buf[2] == '0') {
-		buf[2] = 0;
-		if (buf[1] == '0')
-			buf[1] = 0;
-	}
-
-	put_format(b, "%s%s%u.%s%s", pre, sign, v, buf, post);
+	put_digits(b, frac, len);
+	put_string(b, post);
 }
 
 void put_temperature(struct membuffer *b, temperature_t temp, const char *pre, const char *post)
@@ -209,7 +253,7 @@ void put_depth(struct membuffer *b, depth_t depth, const char *pre, const char *
 void put_duration(struct membuffer *b, duration_t duration, const char *pre, const char *post)
 {
 	if (duration.seconds)
-		put_format(b, "%s%u:%02u%s", pre, FRACTION(duration.seconds, 60), post);
+		put_min_sec(b, pre, duration.seconds, post);
 }
 
 void put_pressure(struct membuffer *b, pressure_t pressure, const char *pre, const char *post)
@@ -221,19 +265,22 @@ void put_pressure(struct membuffer *b, pressure_t pressure, const char *pre, con
 void put_salinity(struct membuffer *b, int salinity, const char *pre, const char *post)
 {
 	if (salinity)
-		put_format(b, "%s%d%s", pre, salinity / 10, post);
+		put_int(b, pre, salinity / 10, post);
 }
 
 void put_degrees(struct membuffer *b, degrees_t value, const char *pre, const char *post)
 {
-	int udeg = value.udeg;
-	const char *sign = "";
+	unsigned int udeg = value.udeg;
 
-	if (udeg < 0) {
+	put_string(b, pre);
+	if (value.udeg < 0) {
+		put_bytes(b, "-", 1);
 		udeg = -udeg;
-		sign = "-";
 	}
-	put_format(b, "%s%s%u.%06u%s", pre, sign, FRACTION(udeg, 1000000), post);
+	put_digits(b, udeg / 1000000, 1);
+	put_bytes(b, ".", 1);
+	put_digits(b, udeg % 1000000, 6);
+	put_string(b, post);
 }
 
 void put_location(struct membuffer *b, const location_t *loc, const char *pre, const char *post)
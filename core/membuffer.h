@@ -80,6 +80,14 @@ extern __printf(1, 2) char *format_string(const char *, ...);
 /* Output one of our "milli" values with type and pre/post data */
 extern void put_milli(struct membuffer *, const char *, int, const char *);
 
+/*
+ * Output integers and "minutes:seconds" times with pre/post data,
+ * without the overhead of put_format().
+ */
+extern void put_int(struct membuffer *, const char *, int, const char *);
+extern void put_uint(struct membuffer *, const char *, unsigned int, const char *);
+extern void put_min_sec(struct membuffer *, const char *, int, const char *);
+
 /*
  * Helper functions for showing particular types. If the type
  * is empty, nothing is done, and the function returns false.
@@ -0,0 +1,58 @@
+// SPDX-License-Identifier: GPL-2.0
+#include "memorystatistics.h"
+#include "dive.h"
+#include "divecomputer.h"
+#include "event.h"
+#include "extradata.h"
+#include "fulltext.h"
+#include "imagedownloader.h"
+#include "sample.h"
+#include "trace.h"
+#include <stdio.h>
+#include <string.h>
+#include <string>
+
+static size_t stringMemory(const char *s)
+{
+	return s ? strlen(s) + 1 : 0;
+}
+
+static void appendLine(std::string &res, const char *name, size_t bytes)
+{
+	char buf[128];
+	snprintf(buf, sizeof(buf), "%s: %lu kB\n", name, (unsigned long)((bytes + 1023) / 1024));
+	res += buf;
+}
+
+extern "C" char *memory_statistics()
+{
+	int i;
+	struct dive *d;
+	size_t dives = 0, samples = 0, events = 0, extra_data = 0;
+
+	for_each_dive (i, d) {
+		dives += sizeof(*d) + stringMemory(d->notes) + stringMemory(d->buddy) + stringMemory(d->divemaster) +
+			 d->cylinders.allocated * sizeof(cylinder_t) +
+			 d->weightsystems.allocated * sizeof(weightsystem_t);
+		for (struct divecomputer *dc = &d->dc; dc; dc = dc->next) {
+			if (dc != &d->dc)
+				dives += sizeof(*dc);
+			samples += dc->alloc_samples * sizeof(struct sample);
+			for (const struct event *ev = dc->events; ev; ev = ev->next)
+				events += sizeof(*ev);	// the names are shared
+			extra_data += dc->alloc_extra_data * sizeof(struct extra_data);
+			for (int i = 0; i < dc->nr_extra_data; i++)
+				extra_data += stringMemory(dc->extra_data[i].key) + stringMemory(dc->extra_data[i].value);
+		}
+	}
+
+	std::string res;
+	appendLine(res, "dives", dives);
+	appendLine(res, "samples", samples);
+	appendLine(res, "events", events);
+	appendLine(res, "extra data", extra_data);
+	appendLine(res, "full text index", fulltext_memory());
+	appendLine(res, "thumbnail cache", Thumbnailer::instance()->memoryCacheBytes());
+	appendLine(res, "plot info", (size_t)trace_counter("plot_info bytes"));
+	return strdup(res.c_str());
+}
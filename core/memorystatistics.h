@@ -0,0 +1,17 @@
+// SPDX-License-Identifier: GPL-2.0
+#ifndef MEMORYSTATISTICS_H
+#define MEMORYSTATISTICS_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// An estimate of the memory held by the large data structures of the core,
+// to see where RAM goes. Returns a text report, the caller frees it.
+extern char *memory_statistics(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
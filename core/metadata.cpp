@@ -3,9 +3,13 @@
 #include "xmp_parser.h"
 #include "exif.h"
 #include "qthelper.h"
+#include "parallel.h"
 #include <QString>
 #include <QFile>
 #include <QDateTime>
+#include <QFileInfo>
+#include <QHash>
+#include <QMutex>
 
 // Weirdly, android builds fail owing to undefined UINT64_MAX
 #ifndef UINT64_MAX
@@ -533,14 +537,13 @@ static bool parseASF(QFile &f, metadata *metadata)
 	return false;
 }
 
-extern "C" mediatype_t get_metadata(const char *filename_in, metadata *data)
+static mediatype_t readMetadata(const QString &filename, metadata *data)
 {
 	data->timestamp = 0;
 	data->duration.seconds = 0;
 	data->location.lat.udeg = 0;
 	data->location.lon.udeg = 0;
 
-	QString filename = localFilePath(QString(filename_in));
 	QFile f(filename);
 	if (!f.open(QIODevice::ReadOnly))
 		return MEDIATYPE_IO_ERROR;
@@ -566,6 +569,56 @@ extern "C" mediatype_t get_metadata(const char *filename_in, metadata *data)
 	return res;
 }
 
+// Importing pictures reads the metadata of every file at least twice: once to
+// show the timestamps in the time-shift dialog and once to create the pictures.
+// Therefore, cache the results. An entry is only used if the file's
+// modification time and size didn't change.
+struct CachedMetadata {
+	QDateTime lastModified;
+	qint64 size;
+	mediatype_t type;
+	metadata data;
+};
+
+static QMutex metadataCacheMutex;
+static QHash<QString, CachedMetadata> metadataCache;
+
+extern "C" mediatype_t get_metadata(const char *filename_in, metadata *data)
+{
+	QString filename = localFilePath(QString(filename_in));
+	QFileInfo info(filename);
+	if (!info.exists())
+		return readMetadata(filename, data);	// Sets data to defaults and returns an io error
+	QDateTime lastModified = info.lastModified();
+	qint64 size = info.size();
+
+	{
+		QMutexLocker locker(&metadataCacheMutex);
+		auto it = metadataCache.find(filename);
+		if (it != metadataCache.end() && it->lastModified == lastModified && it->size == size) {
+			*data = it->data;
+			return it->type;
+		}
+	}
+
+	mediatype_t res = readMetadata(filename, data);
+	if (res != MEDIATYPE_IO_ERROR) {
+		// The file was just read, so the fingerprint is computed from the disk cache
+		learnPictureFingerprint(QString(filename_in), fileFingerprint(filename));
+		QMutexLocker locker(&metadataCacheMutex);
+		metadataCache.insert(filename, { lastModified, size, res, *data });
+	}
+	return res;
+}
+
+extern "C" void get_timestamps(int nr, const char *const *filenames, timestamp_t *timestamps)
+{
+	// The files are independent: read them in parallel, the time is mostly spent waiting for IO
+	parallel_for(nr, [filenames, timestamps](int idx) {
+		timestamps[idx] = picture_get_timestamp(filenames[idx]);
+	});
+}
+
 extern "C" timestamp_t picture_get_timestamp(const char *filename)
 {
 	struct metadata data;
@@ -23,6 +23,8 @@ extern "C" {
 
 enum mediatype_t get_metadata(const char *filename, struct metadata *data);
 timestamp_t picture_get_timestamp(const char *filename);
+// Get the timestamps of nr files at once, which is faster than calling picture_get_timestamp()
+void get_timestamps(int nr, const char *const *filenames, timestamp_t *timestamps);
 
 #ifdef __cplusplus
 }
@@ -173,15 +173,18 @@ void ostctools_import(const char *file, struct dive_table *divetable, struct tri
 	ostcdive->dc.serial = copy_string(tmp);
 	free(tmp);
 
-	if (ostcdive->dc.extra_data) {
-		ptr = ostcdive->dc.extra_data;
-		while (strcmp(ptr->key, "Serial"))
-			ptr = ptr->next;
-		if (!strcmp(ptr->value, "0")) {
-			add_extra_data(&ostcdive->dc, "Serial", ostcdive->dc.serial);
-			*ptr = *(ptr)->next;
-		}
-	} else {
+	for (i = 0; i < ostcdive->dc.nr_extra_data; i++) {
+		if (!strcmp(ostcdive->dc.extra_data[i].key, "Serial"))
+			break;
+	}
+	if (i == ostcdive->dc.nr_extra_data) {
+		add_extra_data(&ostcdive->dc, "Serial", ostcdive->dc.serial);
+	} else if (!strcmp(ostcdive->dc.extra_data[i].value, "0")) {
+		ptr = &ostcdive->dc.extra_data[i];
+		free((void *)ptr->key);
+		free((void *)ptr->value);
+		memmove(ptr, ptr + 1, (ostcdive->dc.nr_extra_data - i - 1) * sizeof(*ptr));
+		ostcdive->dc.nr_extra_data--;
 		add_extra_data(&ostcdive->dc, "Serial", ostcdive->dc.serial);
 	}
 	record_dive_to_table(ostcdive, divetable);
@@ -0,0 +1,28 @@
+// SPDX-License-Identifier: GPL-2.0
+#include "parallel.h"
+#include <QThreadPool>
+#include <QtConcurrent>
+#include <numeric>
+#include <vector>
+
+extern "C" int parallel_thread_count()
+{
+	return QThreadPool::globalInstance()->maxThreadCount();
+}
+
+extern "C" void parallel_for(int n, parallel_fn_t *fn, void *data)
+{
+	if (n <= 0)
+		return;
+
+	// Not worth the overhead of dispatching to the thread pool
+	if (n == 1 || parallel_thread_count() <= 1) {
+		for (int i = 0; i < n; ++i)
+			fn(i, data);
+		return;
+	}
+
+	std::vector<int> indices(n);
+	std::iota(indices.begin(), indices.end(), 0);
+	QtConcurrent::blockingMap(indices, [fn, data](int idx) { fn(idx, data); });
+}
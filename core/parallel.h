@@ -0,0 +1,34 @@
+// SPDX-License-Identifier: GPL-2.0
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+// C interface to Qt's global thread pool, so that the C parts of
+// the core can distribute independent work items over all cores.
+
+#ifdef __cplusplus
+#include <type_traits>
+extern "C" {
+#endif
+
+typedef void (parallel_fn_t)(int idx, void *data);
+
+// Calls fn(idx, data) for every 0 <= idx < n and returns once all calls
+// have finished. The calls are made in unspecified order from unspecified
+// threads, so fn must only touch data belonging to its own index.
+extern void parallel_for(int n, parallel_fn_t *fn, void *data);
+
+// Number of threads that parallel_for() will use at most.
+extern int parallel_thread_count(void);
+
+#ifdef __cplusplus
+}
+
+// Convenience version for C++ callers: calls f(idx) for every 0 <= idx < n.
+template <typename F>
+void parallel_for(int n, F &&f)
+{
+	parallel_for(n, [](int idx, void *data) { (*static_cast<std::remove_reference_t<F> *>(data))(idx); }, &f);
+}
+#endif
+
+#endif
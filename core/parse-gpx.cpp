@@ -1,88 +1,135 @@
 // SPDX-License-Identifier: GPL-2.0
 #include "core/parse-gpx.h"
 #include "core/subsurface-time.h"
+#include <QDateTime>
 #include <QFile>
+#include <QFileInfo>
 #include <QXmlStreamReader>
+#include <algorithm>
+#include <vector>
 
-// Find the coordinates at the time specified in coords.start_dive
-// by searching the gpx file "fileName". Here is a typical trkpt element in GPX:
-// <trkpt lat="-26.84" lon="32.88"><ele>-53.7</ele><time>2017-08-06T04:56:42Z</time></trkpt>
-int getCoordsFromGPXFile(struct dive_coords *coords, QString fileName)
+// The time controls of the import dialog change the offset by less than two days.
+// Only the trackpoints in that range around the start of the dive are kept, so that
+// changing the offsets doesn't read the file again, even for tracks of many days.
+static const int64_t trackWindow = 2 * 24 * 3600;
+
+struct gpx_fix {
+	time_t time;	// UTC
+	double lat, lon;
+};
+
+static struct {
+	QString fileName;
+	QDateTime modified;
+	time_t windowStart, windowEnd;
+	time_t start_track, end_track;	// UTC, of the whole track
+	std::vector<gpx_fix> fixes;	// sorted by time: the fixes in the window and the first one after it
+	bool valid = false;
+} track;
+
+// Parses e.g. 2017-08-06T04:56:42Z
+static time_t parseTime(const QString &dateTimeString)
 {
 	struct tm tm1;
-	time_t trkpt_time = 0;
-	time_t divetime;
-	int64_t time_offset = coords->settingsDiff_offset + coords->timeZone_offset;
-	double lon = 0, lat = 0;
-	int line = 0;
-	bool first_line = true;
-	bool found = false;
-	bool trkpt_found = false;
-	divetime = coords->start_dive;
-	QFile gpxFile;
-	gpxFile.setFileName(fileName);
+	bool ok;
+	tm1.tm_year = dateTimeString.midRef(0, 4).toInt(&ok, 10);  // Extract the date/time components:
+	tm1.tm_mon  = dateTimeString.midRef(5, 2).toInt(&ok, 10) - 1;
+	tm1.tm_mday = dateTimeString.midRef(8, 2).toInt(&ok, 10);
+	tm1.tm_hour = dateTimeString.midRef(11, 2).toInt(&ok, 10);
+	tm1.tm_min  = dateTimeString.midRef(14, 2).toInt(&ok, 10);
+	tm1.tm_sec  = dateTimeString.midRef(17, 2).toInt(&ok, 10);
+	return utc_mktime(&tm1);
+}
+
+// Read the trackpoints of the file in the window around "center" (UTC).
+// Here is a typical trkpt element in GPX:
+// <trkpt lat="-26.84" lon="32.88"><ele>-53.7</ele><time>2017-08-06T04:56:42Z</time></trkpt>
+static bool readTrack(const QString &fileName, time_t center)
+{
+	QFile gpxFile(fileName);
 	if (!gpxFile.open(QIODevice::ReadOnly | QIODevice::Text)) {
-		QByteArray local8bitBAString1 = fileName.toLocal8Bit();
-		char *fname = local8bitBAString1.data();   // convert QString to a C string fileName
-		fprintf(stderr, "GPS file open error: file name = %s\n", fname);
-		return 1;
+		fprintf(stderr, "GPS file open error: file name = %s\n", qPrintable(fileName));
+		return false;
 	}
+	track.valid = false;
+	track.fileName = fileName;
+	track.modified = QFileInfo(gpxFile).lastModified();
+	track.windowStart = center - trackWindow;
+	track.windowEnd = center + trackWindow;
+	track.start_track = track.end_track = 0;
+	track.fixes.clear();
 
-#ifdef GPSDEBUG
-	struct tm time; // decode the time of start of dive:
-	utc_mkdate(divetime, &time);
-	int dyr,dmon,dday,dhr,dmin;
-	dyr = time.tm_year;
-	dmon = time.tm_mon;
-	dday = time.tm_mday;
-	dhr = time.tm_hour;
-	dmin = time.tm_min;
-#endif
-
+	bool first_line = true;
+	bool trkpt_found = false;
+	bool sorted = true;
+	gpx_fix fix = { 0, 0.0, 0.0 };
+	gpx_fix next = { 0, 0.0, 0.0 };	// first fix after the window
+	bool next_found = false;
 	QXmlStreamReader gpxReader(&gpxFile);
 	while (!gpxReader.atEnd()) {
 		gpxReader.readNext();
-		if (gpxReader.isStartElement()) {
-			if (gpxReader.name() == "trkpt") {
-				trkpt_found = true;
-				line++;
-				foreach (const QXmlStreamAttribute &attr, gpxReader.attributes()) {
-					if (attr.name().toString() == QLatin1String("lat"))
-						lat = attr.value().toString().toDouble();
-					else if (attr.name().toString() == QLatin1String("lon"))
-						lon = attr.value().toString().toDouble();
-				}
+		if (!gpxReader.isStartElement())
+			continue;
+		if (gpxReader.name() == QLatin1String("trkpt")) {
+			trkpt_found = true;
+			QXmlStreamAttributes attributes = gpxReader.attributes();
+			fix.lat = attributes.value(QLatin1String("lat")).toDouble();
+			fix.lon = attributes.value(QLatin1String("lon")).toDouble();
+		} else if (gpxReader.name() == QLatin1String("time") && trkpt_found) {  // Ignore the <time> element in the GPX file header
+			fix.time = parseTime(gpxReader.readElementText());
+			if (first_line) {
+				first_line = false;
+				track.start_track = fix.time;
 			}
-			if (gpxReader.name() == "time" && trkpt_found) {  // Ignore the <time> element in the GPX file header
-				QString dateTimeString = gpxReader.readElementText();
-				bool ok;
-				tm1.tm_year = dateTimeString.left(4).toInt(&ok, 10);  // Extract the date/time components:
-				tm1.tm_mon  = dateTimeString.mid(5,2).toInt(&ok,10) - 1;
-				tm1.tm_mday = dateTimeString.mid(8,2).toInt(&ok,10);
-				tm1.tm_hour = dateTimeString.mid(11,2).toInt(&ok,10);
-				tm1.tm_min  = dateTimeString.mid(14,2).toInt(&ok,10);
-				tm1.tm_sec  = dateTimeString.mid(17,2).toInt(&ok,10);
-				trkpt_time = utc_mktime(&tm1) + time_offset;
-				if (first_line) {
-					first_line = false;
-					coords->start_track = trkpt_time;   // Local time of start of GPS track
-				}
-				if (trkpt_time >= divetime && found == false) {   // This GPS local time corresponds to the start time of the dive
-					coords->lon = lon; // save the coordinates
-					coords->lat = lat;
-					found = true;
-				}
-
+			track.end_track = fix.time;
+			if (fix.time > track.windowEnd) {
+				if (!next_found || fix.time < next.time)
+					next = fix;
+				next_found = true;
+			} else if (fix.time >= track.windowStart) {
+				if (!track.fixes.empty() && fix.time < track.fixes.back().time)
+					sorted = false;
+				track.fixes.push_back(fix);
 #ifdef GPSDEBUG
-				utc_mkdate(trkpt_time, &time); // print coordinates and time of each trkpt element of the GPX file as well as dive start time
-				fprintf(stderr, " %02d: lat=%f lon=%f timestamp=%ld (%ld) %02d/%02d/%02d %02d:%02d  dt=%ld  %02d/%02d/%02d %02d:%02d\n", line, lat,
-				lon, trkpt_time, time_offset, time.tm_year, time.tm_mon+1, time.tm_mday, time.tm_hour, time.tm_min, divetime, dyr, dmon+1, dday,dhr, dmin);
+				fprintf(stderr, " %zu: lat=%f lon=%f timestamp=%ld\n", track.fixes.size(), fix.lat, fix.lon, (long)fix.time);
 #endif
-
 			}
 		}
 	} // while !at.End() // This loop executes until EOF causes a break out of the loop
-	coords->end_track = trkpt_time;  // This is the local time of the end of the GPS track
 	gpxFile.close();
+
+	if (!sorted)
+		std::stable_sort(track.fixes.begin(), track.fixes.end(),
+				 [](const gpx_fix &a, const gpx_fix &b) { return a.time < b.time; });
+	if (next_found)
+		track.fixes.push_back(next);
+	track.valid = true;
+	return true;
+}
+
+// Find the coordinates at the time specified in coords.start_dive
+// by searching the gpx file "fileName".
+int getCoordsFromGPXFile(struct dive_coords *coords, QString fileName)
+{
+	int64_t time_offset = coords->settingsDiff_offset + coords->timeZone_offset;
+	// The start of the dive in the time of the GPS
+	time_t divetime = coords->start_dive - time_offset;
+
+	if (!track.valid || track.fileName != fileName || divetime < track.windowStart || divetime > track.windowEnd ||
+	    track.modified != QFileInfo(fileName).lastModified()) {
+		if (!readTrack(fileName, divetime))
+			return 1;
+	}
+
+	coords->start_track = track.start_track + time_offset;   // Local time of start of GPS track
+	coords->end_track = track.end_track + time_offset;  // This is the local time of the end of the GPS track
+
+	// The first fix at or after the start of the dive
+	auto it = std::lower_bound(track.fixes.begin(), track.fixes.end(), divetime,
+				   [](const gpx_fix &fix, time_t t) { return fix.time < t; });
+	if (it != track.fixes.end()) {
+		coords->lon = it->lon; // save the coordinates
+		coords->lat = it->lat;
+	}
 	return 0;
 }
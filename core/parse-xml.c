@@ -16,6 +16,7 @@
 #include <libxml/parser.h>
 #include <libxml/parserInternals.h>
 #include <libxml/tree.h>
+#include <libxml/xmlreader.h>
 #include <libxslt/transform.h>
 #include <libdivecomputer/parser.h>
 
@@ -848,95 +849,194 @@ static void try_to_fill_dc(struct divecomputer *dc, const char *name, char *buf,
 }
 
 /* We're in samples - try to convert the random xml value to something useful */
+/*
+ * Samples make up most of the nodes of a dive log, so instead of trying
+ * the possible names one after the other, the names are looked up by
+ * binary search in a sorted table.
+ */
+enum sample_field {
+	SAMPLE_PRESSURE, SAMPLE_CYLPRESS, SAMPLE_PDILUENT, SAMPLE_O2PRESSURE, SAMPLE_PRESSURE0, SAMPLE_PRESSURE1,
+	SAMPLE_PRESSURE2, SAMPLE_PRESSURE3, SAMPLE_PRESSURE4, SAMPLE_CYLINDERINDEX, SAMPLE_SENSOR, SAMPLE_DEPTH,
+	SAMPLE_TEMP, SAMPLE_TEMPERATURE, SAMPLE_SAMPLETIME, SAMPLE_TIME, SAMPLE_NDL, SAMPLE_TTS, SAMPLE_IN_DECO,
+	SAMPLE_STOPTIME, SAMPLE_STOPDEPTH, SAMPLE_CNS, SAMPLE_RBT, SAMPLE_SENSOR1, SAMPLE_SENSOR2, SAMPLE_SENSOR3,
+	SAMPLE_PO2, SAMPLE_HEARTBEAT, SAMPLE_BEARING, SAMPLE_SETPOINT, SAMPLE_PPO2, SAMPLE_DECO, SAMPLE_DECO_TIME,
+	SAMPLE_DECO_DEPTH
+};
+
+struct xml_field {
+	const char *name;
+	int id;
+};
+
+/* These need to be sorted! */
+static const struct xml_field sample_fields[] = {
+	{ "bearing", SAMPLE_BEARING },
+	{ "cns.sample", SAMPLE_CNS },
+	{ "cylinderindex.sample", SAMPLE_CYLINDERINDEX },
+	{ "cylpress.sample", SAMPLE_CYLPRESS },
+	{ "deco.sample", SAMPLE_DECO },
+	{ "depth.deco", SAMPLE_DECO_DEPTH },
+	{ "depth.sample", SAMPLE_DEPTH },
+	{ "heartbeat", SAMPLE_HEARTBEAT },
+	{ "in_deco.sample", SAMPLE_IN_DECO },
+	{ "ndl.sample", SAMPLE_NDL },
+	{ "o2pressure.sample", SAMPLE_O2PRESSURE },
+	{ "pdiluent.sample", SAMPLE_PDILUENT },
+	{ "po2.sample", SAMPLE_PO2 },
+	{ "ppo2.sample", SAMPLE_PPO2 },
+	{ "pressure.sample", SAMPLE_PRESSURE },
+	{ "pressure0.sample", SAMPLE_PRESSURE0 },
+	{ "pressure1.sample", SAMPLE_PRESSURE1 },
+	{ "pressure2.sample", SAMPLE_PRESSURE2 },
+	{ "pressure3.sample", SAMPLE_PRESSURE3 },
+	{ "pressure4.sample", SAMPLE_PRESSURE4 },
+	{ "rbt.sample", SAMPLE_RBT },
+	{ "sampletime.sample", SAMPLE_SAMPLETIME },
+	{ "sensor.sample", SAMPLE_SENSOR },
+	{ "sensor1.sample", SAMPLE_SENSOR1 },
+	{ "sensor2.sample", SAMPLE_SENSOR2 },
+	{ "sensor3.sample", SAMPLE_SENSOR3 },
+	{ "setpoint.sample", SAMPLE_SETPOINT },
+	{ "stopdepth.sample", SAMPLE_STOPDEPTH },
+	{ "stoptime.sample", SAMPLE_STOPTIME },
+	{ "temp.sample", SAMPLE_TEMP },
+	{ "temperature.sample", SAMPLE_TEMPERATURE },
+	{ "time.deco", SAMPLE_DECO_TIME },
+	{ "time.sample", SAMPLE_TIME },
+	{ "tts.sample", SAMPLE_TTS },
+};
+
+/* Look up the first "len" characters of name - returns -1 if not found */
+static int find_xml_field(const struct xml_field *fields, int nr, const char *name, int len)
+{
+	int low = 0, high = nr;
+
+	while (low < high) {
+		int mid = (low + high) / 2;
+		const char *pattern = fields[mid].name;
+		int cmp = strncmp(name, pattern, len);
+		if (!cmp && pattern[len])
+			cmp = -1;
+		if (!cmp)
+			return fields[mid].id;
+		if (cmp < 0)
+			high = mid;
+		else
+			low = mid + 1;
+	}
+	return -1;
+}
+
+/*
+ * Like match_name(), a pattern matches a name that continues with a '.'.
+ * The patterns have one or two components, so try both prefixes.
+ */
+static int match_xml_field(const struct xml_field *fields, int nr, const char *name)
+{
+	const char *dot = strchr(name, '.');
+	int id;
+
+	if (!dot)
+		return find_xml_field(fields, nr, name, strlen(name));
+	dot = strchr(dot + 1, '.');
+	id = find_xml_field(fields, nr, name, dot ? dot - name : (int)strlen(name));
+	if (id >= 0)
+		return id;
+	return find_xml_field(fields, nr, name, strchr(name, '.') - name);
+}
+
 static void try_to_fill_sample(struct sample *sample, const char *name, char *buf, struct parser_state *state)
 {
 	int in_deco;
 	pressure_t p;
 
 	start_match("sample", name, buf);
-	if (MATCH_STATE("pressure.sample", pressure, &sample->pressure[0]))
-		return;
-	if (MATCH_STATE("cylpress.sample", pressure, &sample->pressure[0]))
-		return;
-	if (MATCH_STATE("pdiluent.sample", pressure, &sample->pressure[0]))
+	switch (match_xml_field(sample_fields, sizeof(sample_fields) / sizeof(sample_fields[0]), name)) {
+	case SAMPLE_PRESSURE:
+	case SAMPLE_CYLPRESS:
+	case SAMPLE_PDILUENT:
+		pressure(buf, &sample->pressure[0], state);
 		return;
-	if (MATCH_STATE("o2pressure.sample", pressure, &sample->pressure[1]))
+	case SAMPLE_O2PRESSURE:
+		pressure(buf, &sample->pressure[1], state);
 		return;
 	/* Christ, this is ugly */
-	if (MATCH_STATE("pressure0.sample", pressure, &p)) {
-		add_sample_pressure(sample, 0, p.mbar);
+	case SAMPLE_PRESSURE0:
+	case SAMPLE_PRESSURE1:
+	case SAMPLE_PRESSURE2:
+	case SAMPLE_PRESSURE3:
+	case SAMPLE_PRESSURE4:
+		pressure(buf, &p, state);
+		add_sample_pressure(sample, name[8] - '0', p.mbar);
 		return;
-	}
-	if (MATCH_STATE("pressure1.sample", pressure, &p)) {
-		add_sample_pressure(sample, 1, p.mbar);
-		return;
-	}
-	if (MATCH_STATE("pressure2.sample", pressure, &p)) {
-		add_sample_pressure(sample, 2, p.mbar);
-		return;
-	}
-	if (MATCH_STATE("pressure3.sample", pressure, &p)) {
-		add_sample_pressure(sample, 3, p.mbar);
-		return;
-	}
-	if (MATCH_STATE("pressure4.sample", pressure, &p)) {
-		add_sample_pressure(sample, 4, p.mbar);
-		return;
-	}
-	if (MATCH_STATE("cylinderindex.sample", get_cylinderindex, &sample->sensor[0]))
-		return;
-	if (MATCH("sensor.sample", get_sensor, &sample->sensor[0]))
-		return;
-	if (MATCH_STATE("depth.sample", depth, &sample->depth))
+	case SAMPLE_CYLINDERINDEX:
+		get_cylinderindex(buf, &sample->sensor[0], state);
 		return;
-	if (MATCH_STATE("temp.sample", temperature, &sample->temperature))
+	case SAMPLE_SENSOR:
+		get_sensor(buf, &sample->sensor[0]);
 		return;
-	if (MATCH_STATE("temperature.sample", temperature, &sample->temperature))
+	case SAMPLE_DEPTH:
+		depth(buf, &sample->depth, state);
 		return;
-	if (MATCH("sampletime.sample", sampletime, &sample->time))
+	case SAMPLE_TEMP:
+	case SAMPLE_TEMPERATURE:
+		temperature(buf, &sample->temperature, state);
 		return;
-	if (MATCH("time.sample", sampletime, &sample->time))
+	case SAMPLE_SAMPLETIME:
+	case SAMPLE_TIME:
+		sampletime(buf, &sample->time);
 		return;
-	if (MATCH("ndl.sample", sampletime, &sample->ndl))
+	case SAMPLE_NDL:
+		sampletime(buf, &sample->ndl);
 		return;
-	if (MATCH("tts.sample", sampletime, &sample->tts))
+	case SAMPLE_TTS:
+		sampletime(buf, &sample->tts);
 		return;
-	if (MATCH("in_deco.sample", get_index, &in_deco)) {
+	case SAMPLE_IN_DECO:
+		get_index(buf, &in_deco);
 		sample->in_deco = (in_deco == 1);
 		return;
-	}
-	if (MATCH("stoptime.sample", sampletime, &sample->stoptime))
-		return;
-	if (MATCH_STATE("stopdepth.sample", depth, &sample->stopdepth))
+	case SAMPLE_STOPTIME:
+	case SAMPLE_DECO_TIME:
+		sampletime(buf, &sample->stoptime);
 		return;
-	if (MATCH("cns.sample", get_uint16, &sample->cns))
+	case SAMPLE_STOPDEPTH:
+	case SAMPLE_DECO_DEPTH:
+		depth(buf, &sample->stopdepth, state);
 		return;
-	if (MATCH("rbt.sample", sampletime, &sample->rbt))
+	case SAMPLE_CNS:
+		get_uint16(buf, &sample->cns);
 		return;
-	if (MATCH("sensor1.sample", double_to_o2pressure, &sample->o2sensor[0])) // CCR O2 sensor data
+	case SAMPLE_RBT:
+		sampletime(buf, &sample->rbt);
 		return;
-	if (MATCH("sensor2.sample", double_to_o2pressure, &sample->o2sensor[1]))
+	case SAMPLE_SENSOR1: // CCR O2 sensor data
+		double_to_o2pressure(buf, &sample->o2sensor[0]);
 		return;
-	if (MATCH("sensor3.sample", double_to_o2pressure, &sample->o2sensor[2])) // up to 3 CCR sensors
+	case SAMPLE_SENSOR2:
+		double_to_o2pressure(buf, &sample->o2sensor[1]);
 		return;
-	if (MATCH("po2.sample", double_to_o2pressure, &sample->setpoint))
+	case SAMPLE_SENSOR3: // up to 3 CCR sensors
+		double_to_o2pressure(buf, &sample->o2sensor[2]);
 		return;
-	if (MATCH("heartbeat", get_uint8, &sample->heartbeat))
+	case SAMPLE_PO2:
+	case SAMPLE_SETPOINT:
+		double_to_o2pressure(buf, &sample->setpoint);
 		return;
-	if (MATCH("bearing", get_bearing, &sample->bearing))
+	case SAMPLE_HEARTBEAT:
+		get_uint8(buf, &sample->heartbeat);
 		return;
-	if (MATCH("setpoint.sample", double_to_o2pressure, &sample->setpoint))
+	case SAMPLE_BEARING:
+		get_bearing(buf, &sample->bearing);
 		return;
-	if (MATCH("ppo2.sample", double_to_o2pressure, &sample->o2sensor[state->next_o2_sensor])) {
+	case SAMPLE_PPO2:
+		double_to_o2pressure(buf, &sample->o2sensor[state->next_o2_sensor]);
 		state->next_o2_sensor++;
 		return;
-	}
-	if (MATCH("deco.sample", parse_libdc_deco, sample))
-		return;
-	if (MATCH("time.deco", sampletime, &sample->stoptime))
-		return;
-	if (MATCH_STATE("depth.deco", depth, &sample->stopdepth))
+	case SAMPLE_DECO:
+		parse_libdc_deco(buf, sample);
 		return;
+	}
 
 	switch (state->import_source) {
 	case DIVINGLOG:
@@ -1146,6 +1246,7 @@ static void gps_lat(char *buffer, struct dive *dive, struct parser_state *state)
 		if (ds->location.lat.udeg && ds->location.lat.udeg != location.lat.udeg)
 			fprintf(stderr, "Oops, changing the latitude of existing dive site id %8x name %s; not good\n", ds->uuid, ds->name ?: "(unknown)");
 		ds->location.lat = location.lat;
+		invalidate_dive_site_gps_index();
 	}
 }
 
@@ -1162,6 +1263,7 @@ static void gps_long(char *buffer, struct dive *dive, struct parser_state *state
 		if (ds->location.lon.udeg && ds->location.lon.udeg != location.lon.udeg)
 			fprintf(stderr, "Oops, changing the longitude of existing dive site id %8x name %s; not good\n", ds->uuid, ds->name ?: "(unknown)");
 		ds->location.lon = location.lon;
+		invalidate_dive_site_gps_index();
 	}
 }
 
@@ -1177,6 +1279,7 @@ void parse_location(const char *buffer, location_t *loc)
 static void gps_location(char *buffer, struct dive_site *ds)
 {
 	parse_location(buffer, &ds->location);
+	invalidate_dive_site_gps_index();
 }
 
 static void gps_in_dive(char *buffer, struct dive *dive, struct parser_state *state)
@@ -1209,6 +1312,7 @@ static void gps_in_dive(char *buffer, struct dive *dive, struct parser_state *st
 			free(coords);
 		} else {
 			ds->location = location;
+			invalidate_dive_site_gps_index();
 		}
 	}
 }
@@ -1587,6 +1691,9 @@ static bool traverse_properties(xmlNode *node, struct parser_state *state)
 	xmlAttr *p;
 	bool ret = true;
 
+	/* Only elements have properties - text nodes may store their content there */
+	if (node->type != XML_ELEMENT_NODE)
+		return true;
 	for (p = node->properties; p; p = p->next)
 		if ((ret = traverse(p->children, state)) == false)
 			break;
@@ -1662,13 +1769,43 @@ static struct nesting {
 	  { NULL, }
 };
 
+/*
+ * Samples are stored as children of the divecomputer node. Allocate
+ * the sample array in one go instead of growing it sample by sample.
+ */
+static void presize_samples(xmlNode *node, struct parser_state *state)
+{
+	struct divecomputer *dc = state->cur_dc;
+	int nr = 0;
+
+	if (!dc)
+		return;
+	for (node = node->children; node; node = node->next) {
+		if (node->type == XML_ELEMENT_NODE && !strcmp((const char *)node->name, "sample"))
+			nr++;
+	}
+	alloc_samples(dc, dc->samples + nr);
+}
+
+static struct nesting *find_nesting(const char *name)
+{
+	struct nesting *rule = nesting;
+
+	do {
+		if (rule->name[0] == name[0] && !strcmp(rule->name, name))
+			break;
+		rule++;
+	} while (rule->name);
+	return rule;
+}
+
 static bool traverse(xmlNode *root, struct parser_state *state)
 {
 	xmlNode *n;
 	bool ret = true;
 
 	for (n = root; n; n = n->next) {
-		struct nesting *rule = nesting;
+		struct nesting *rule;
 
 		if (!n->name) {
 			if ((ret = visit(n, state)) == false)
@@ -1676,14 +1813,11 @@ static bool traverse(xmlNode *root, struct parser_state *state)
 			continue;
 		}
 
-		do {
-			if (!strcmp(rule->name, (const char *)n->name))
-				break;
-			rule++;
-		} while (rule->name);
-
+		rule = find_nesting((const char *)n->name);
 		if (rule->start)
 			rule->start(state);
+		if (rule->start == divecomputer_start)
+			presize_samples(n, state);
 		if ((ret = visit(n, state)) == false)
 			break;
 		if (rule->end)
@@ -1692,6 +1826,90 @@ static bool traverse(xmlNode *root, struct parser_state *state)
 	return ret;
 }
 
+/*
+ * Native Subsurface XML files don't need any XSLT transform, so they
+ * can be parsed as a stream instead of loading the whole document.
+ */
+static bool is_native_xml(const char *buffer)
+{
+	const char *p = buffer;
+
+	/* Skip the XML declaration, comments and the like */
+	while ((p = strchr(p, '<')) != NULL && (p[1] == '?' || p[1] == '!'))
+		p++;
+	return p && !strncmp(p + 1, "divelog", 7) && (isspace(p[8]) || p[8] == '>' || p[8] == '/');
+}
+
+/*
+ * Streaming version of traverse(): the elements are processed as they
+ * are read, so that memory use is bounded by the largest <dive> instead
+ * of the whole file. Dives are read as a whole and handed to traverse(),
+ * so that the dive parsing code can still look at the whole dive.
+ */
+#define MAX_XML_DEPTH 64
+static int parse_xml_stream(const char *url, const char *buffer, struct parser_state *state)
+{
+	struct nesting *rules[MAX_XML_DEPTH];
+	xmlTextReaderPtr reader;
+	xmlNode *node;
+	int res, depth;
+	bool ret = true;
+
+	reader = xmlReaderForMemory(buffer, strlen(buffer), url, NULL, 0);
+	if (!reader)
+		return report_error(translate("gettextFromC", "Failed to parse '%s'"), url);
+
+	res = xmlTextReaderRead(reader);
+	while (res == 1 && ret) {
+		depth = xmlTextReaderDepth(reader);
+		if (depth < 0 || depth >= MAX_XML_DEPTH) {
+			res = -1;
+			break;
+		}
+		switch (xmlTextReaderNodeType(reader)) {
+		case XML_READER_TYPE_ELEMENT:
+			node = xmlTextReaderCurrentNode(reader);
+			if (!strcmp((const char *)node->name, "dive")) {
+				node = xmlTextReaderExpand(reader);
+				if (!node) {
+					res = -1;
+					break;
+				}
+				rules[depth] = find_nesting((const char *)node->name);
+				rules[depth]->start(state);
+				ret = visit(node, state);
+				rules[depth]->end(state);
+				/* Skip the subtree we just handled */
+				res = xmlTextReaderNext(reader);
+				continue;
+			}
+			rules[depth] = find_nesting((const char *)node->name);
+			if (rules[depth]->start)
+				rules[depth]->start(state);
+			ret = visit_one_node(node, state) && traverse_properties(node, state);
+			if (!xmlTextReaderIsEmptyElement(reader))
+				break;
+			/* fallthrough - an empty element has no end tag */
+		case XML_READER_TYPE_END_ELEMENT:
+			if (rules[depth]->end)
+				rules[depth]->end(state);
+			break;
+		case XML_READER_TYPE_TEXT:
+		case XML_READER_TYPE_CDATA:
+		case XML_READER_TYPE_COMMENT:
+			ret = visit_one_node(xmlTextReaderCurrentNode(reader), state);
+			break;
+		}
+		if (res == 1 && ret)
+			res = xmlTextReaderRead(reader);
+	}
+	xmlFreeTextReader(reader);
+	if (res < 0)
+		return report_error(translate("gettextFromC", "Failed to parse '%s'"), url);
+	// we decided to give up on parsing... why?
+	return ret ? 0 : -1;
+}
+
 /* Per-file reset */
 static void reset_all(struct parser_state *state)
 {
@@ -1748,6 +1966,14 @@ int parse_xml_buffer(const char *url, const char *buffer, int size,
 	state.sites = sites;
 	state.devices = devices;
 	state.filter_presets = filter_presets;
+	if (res == buffer && is_native_xml(buffer)) {
+		reset_all(&state);
+		dive_start(&state);
+		ret = parse_xml_stream(url, buffer, &state);
+		dive_end(&state);
+		free_parser_state(&state);
+		return ret;
+	}
 	doc = xmlReadMemory(res, strlen(res), url, NULL, 0);
 	if (!doc)
 		doc = xmlReadMemory(res, strlen(res), url, "latin1", 0);
@@ -2359,7 +2585,6 @@ static xmlDoc *test_xslt_transforms(xmlDoc *doc, const struct xml_params *params
 		}
 		transformed = xsltApplyStylesheet(xslt, doc, xml_params_get(params));
 		xmlFreeDoc(doc);
-		xsltFreeStylesheet(xslt);
 
 		return transformed;
 	}
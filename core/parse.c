@@ -478,6 +478,7 @@ void add_dive_site(char *ds_name, struct dive *dive, struct parser_state *state)
 			// we have a dive site, let's hope there isn't a different name
 			if (empty_string(ds->name)) {
 				ds->name = copy_string(buffer);
+				invalidate_dive_site_name_index();
 			} else if (!same_string(ds->name, buffer)) {
 				// if it's not the same name, it's not the same dive site
 				// but wait, we could have gotten this one based on GPS coords and could
@@ -497,6 +498,7 @@ void add_dive_site(char *ds_name, struct dive *dive, struct parser_state *state)
 					} else {
 						newds->location = ds->location;
 					}
+					invalidate_dive_site_gps_index();
 					newds->notes = add_to_string(newds->notes, translate("gettextFromC", "additional name for site: %s\n"), ds->name);
 				}
 			} else if (dive->dive_site != ds) {
@@ -42,10 +42,10 @@ MAKE_CLEAR_TABLE(picture_table, pictures, picture)
 static void add_cloned_picture(struct picture_table *t, struct picture pic)
 {
 	pic.filename = copy_string(pic.filename);
-	int idx = picture_table_get_insertion_index(t, pic);
-	add_to_picture_table(t, idx, pic);
+	add_to_picture_table(t, t->nr, pic);
 }
 
+/* The source is sorted, so the pictures can be appended */
 void copy_pictures(const struct picture_table *s, struct picture_table *d)
 {
 	int i;
@@ -60,6 +60,18 @@ void add_picture(struct picture_table *t, struct picture newpic)
 	add_to_picture_table(t, idx, newpic);
 }
 
+/* Inserting the pictures one by one moves the pictures after each of them.
+ * Instead, append them all and sort the table once. */
+void add_pictures(struct picture_table *t, const struct picture *pics, int nr)
+{
+	int i;
+	if (nr <= 0)
+		return;
+	for (i = 0; i < nr; i++)
+		add_to_picture_table(t, t->nr, pics[i]);
+	sort_picture_table(t);
+}
+
 int get_picture_idx(const struct picture_table *t, const char *filename)
 {
 	for (int i = 0; i < t->nr; ++i) {
@@ -81,31 +93,81 @@ static timestamp_t time_from_dive(const struct dive *d, timestamp_t timestamp)
 		return 0;
 }
 
-/* Return dive closest selected dive to given timestamp or NULL if no dives are selected. */
-static struct dive *nearest_selected_dive(timestamp_t timestamp)
+void init_selected_dive_time_index(struct dive_time_index *index)
 {
-	struct dive *d, *res = NULL;
-	int i;
-	timestamp_t offset, min = 0;
-
+	int i, nr = 0;
+	struct dive *d;
+	timestamp_t max_end = 0;
+
+	for_each_dive(i, d)
+		nr += d->selected;
+	index->nr = 0;
+	index->dives = malloc((nr + 1) * sizeof(*index->dives));
+	index->max_end = malloc((nr + 1) * sizeof(*index->max_end));
+	if (!index->dives || !index->max_end)
+		exit(1);
+	/* The dive table is sorted by start time */
 	for_each_dive(i, d) {
 		if (!d->selected)
 			continue;
-		offset = time_from_dive(d, timestamp);
-		if (!res || offset < min) {
-			res = d;
-			min = offset;
-		}
-
-		/* We suppose that dives are sorted chronologically. Thus
-		 * if the offset starts to increase, we can end. This ignores
-		 * pathological cases such as overlapping dives. In such a
-		 * case the user will have to add pictures manually.
-		 */
-		if (offset == 0 || offset > min)
-			break;
+		timestamp_t end_time = dive_endtime(d);
+		if (!index->nr || end_time > max_end)
+			max_end = end_time;
+		index->dives[index->nr] = d;
+		index->max_end[index->nr] = max_end;
+		index->nr++;
 	}
-	return res;
+}
+
+void free_dive_time_index(struct dive_time_index *index)
+{
+	free(index->dives);
+	free(index->max_end);
+	index->dives = NULL;
+	index->max_end = NULL;
+	index->nr = 0;
+}
+
+/* Index of the first entry with a value not smaller than the given one */
+static int lower_bound_timestamp(const timestamp_t *values, int nr, timestamp_t value)
+{
+	int lo = 0, hi = nr;
+	while (lo < hi) {
+		int mid = lo + (hi - lo) / 2;
+		if (values[mid] < value)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return lo;
+}
+
+/* Return dive closest to given timestamp or NULL if there are no dives in the index.
+ * Of the dives starting before the timestamp, the closest is the first one that
+ * lasts until the timestamp or the one that ends last. Of the dives starting later,
+ * the closest is the first one. If both are equally close, the earlier wins. */
+static struct dive *nearest_dive(const struct dive_time_index *index, timestamp_t timestamp)
+{
+	int lo = 0, hi = index->nr;
+	struct dive *before = NULL, *after = NULL;
+
+	/* The first dive starting after the timestamp */
+	while (lo < hi) {
+		int mid = lo + (hi - lo) / 2;
+		if (index->dives[mid]->when <= timestamp)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	if (lo < index->nr)
+		after = index->dives[lo];
+	if (lo > 0) {
+		timestamp_t end_time = MIN(timestamp, index->max_end[lo - 1]);
+		before = index->dives[lower_bound_timestamp(index->max_end, lo, end_time)];
+	}
+	if (!before || (after && time_from_dive(after, timestamp) < time_from_dive(before, timestamp)))
+		return after;
+	return before;
 }
 
 // only add pictures that have timestamps between 30 minutes before the dive and
@@ -120,14 +182,15 @@ static bool dive_check_picture_time(const struct dive *d, timestamp_t timestamp)
  * The caller is responsible for actually adding the picture to the dive.
  * If no appropriate dive was found, no picture is created and NULL is returned.
  */
-struct picture *create_picture(const char *filename, int shift_time, bool match_all, struct dive **dive)
+struct picture *create_picture_for_dives(const struct dive_time_index *dives, const char *filename,
+					 int shift_time, bool match_all, struct dive **dive)
 {
 	struct metadata metadata;
 	timestamp_t timestamp;
 
 	get_metadata(filename, &metadata);
 	timestamp = metadata.timestamp + shift_time;
-	*dive = nearest_selected_dive(timestamp);
+	*dive = nearest_dive(dives, timestamp);
 
 	if (!*dive)
 		return NULL;
@@ -143,13 +206,27 @@ struct picture *create_picture(const char *filename, int shift_time, bool match_
 	return picture;
 }
 
-bool picture_check_valid_time(timestamp_t timestamp, int shift_time)
+struct picture *create_picture(const char *filename, int shift_time, bool match_all, struct dive **dive)
 {
-	int i;
-	struct dive *dive;
+	struct dive_time_index dives;
+	init_selected_dive_time_index(&dives);
+	struct picture *res = create_picture_for_dives(&dives, filename, shift_time, match_all, dive);
+	free_dive_time_index(&dives);
+	return res;
+}
+
+/* The picture is close enough to a dive if it is close enough to the nearest one */
+bool picture_check_valid_time_for_dives(const struct dive_time_index *dives, timestamp_t timestamp, int shift_time)
+{
+	struct dive *dive = nearest_dive(dives, timestamp + shift_time);
+	return dive && dive_check_picture_time(dive, timestamp + shift_time);
+}
 
-	for_each_dive (i, dive)
-		if (dive->selected && dive_check_picture_time(dive, timestamp + shift_time))
-			return true;
-	return false;
+bool picture_check_valid_time(timestamp_t timestamp, int shift_time)
+{
+	struct dive_time_index dives;
+	init_selected_dive_time_index(&dives);
+	bool res = picture_check_valid_time_for_dives(&dives, timestamp, shift_time);
+	free_dive_time_index(&dives);
+	return res;
 }
@@ -42,12 +42,26 @@ extern void clear_picture_table(struct picture_table *);
 extern void add_to_picture_table(struct picture_table *, int idx, struct picture pic);
 extern void copy_pictures(const struct picture_table *s, struct picture_table *d);
 extern void add_picture(struct picture_table *, struct picture newpic);
+extern void add_pictures(struct picture_table *, const struct picture *pics, int nr); /* Takes ownership */
 extern void remove_from_picture_table(struct picture_table *, int idx);
 extern int get_picture_idx(const struct picture_table *, const char *filename); /* Return -1 if not found */
 extern void sort_picture_table(struct picture_table *);
 
+/* The selected dives, for matching many pictures to them. The dives are
+ * sorted by start time, with the latest end time of the dives up to each one. */
+struct dive_time_index {
+	int nr;
+	struct dive **dives;
+	timestamp_t *max_end;
+};
+extern void init_selected_dive_time_index(struct dive_time_index *index);
+extern void free_dive_time_index(struct dive_time_index *index);
+
 extern struct picture *create_picture(const char *filename, int shift_time, bool match_all, struct dive **dive);
+extern struct picture *create_picture_for_dives(const struct dive_time_index *dives, const char *filename,
+						int shift_time, bool match_all, struct dive **dive);
 extern bool picture_check_valid_time(timestamp_t timestamp, int shift_time);
+extern bool picture_check_valid_time_for_dives(const struct dive_time_index *dives, timestamp_t timestamp, int shift_time);
 
 #ifdef __cplusplus
 }
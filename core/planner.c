@@ -23,6 +23,7 @@
 #include "gettext.h"
 #include "libdivecomputer/parser.h"
 #include "qthelper.h"
+#include "trace.h"
 #include "version.h"
 
 #define TIMESTEP 2 /* second */
@@ -85,7 +86,7 @@ int get_cylinderid_at_time(struct dive *dive, struct divecomputer *dc, duration_
 	int cylinder_idx = 0;
 	struct event *event = dc->events;
 	while (event && event->time.seconds <= time.seconds) {
-		if (!strcmp(event->name, "gaschange"))
+		if (event->name_id == EVENT_NAME_GASCHANGE)
 			cylinder_idx = get_cylinder_index(dive, event);
 		event = event->next;
 	}
@@ -135,7 +136,9 @@ static int tissue_at_end(struct deco_state *ds, struct dive *dive, struct deco_s
 
 	const struct event *evdm = NULL;
 	enum divemode_t divemode = UNDEF_COMP_TYPE;
+	struct gas_timeline gases;
 
+	init_gas_timeline(&gases, dive, dc);
 	for (i = 0; i < dc->samples; i++, sample++) {
 		o2pressure_t setpoint;
 
@@ -145,7 +148,7 @@ static int tissue_at_end(struct deco_state *ds, struct dive *dive, struct deco_s
 			setpoint = sample[0].setpoint;
 
 		t1 = sample->time;
-		gas = get_gasmix_at_time(dive, dc, t0);
+		gas = gasmix_in_timeline(&gases, t0.seconds);
 		if (i > 0)
 			lastdepth = psample->depth;
 
@@ -177,6 +180,7 @@ static int tissue_at_end(struct deco_state *ds, struct dive *dive, struct deco_s
 		psample = sample;
 		t0 = t1;
 	}
+	free_gas_timeline(&gases);
 	return surface_interval;
 }
 
@@ -524,12 +528,11 @@ static bool trial_ascent(struct deco_state *ds, int wait_time, int trial_depth,
 {
 
 	bool clear_to_ascend = true;
-	struct deco_state *trial_cache = NULL;
+	struct deco_state trial_cache = *ds;
 
 	// For consistency with other VPM-B implementations, we should not start the ascent while the ceiling is
 	// deeper than the next stop (thus the offgasing during the ascent is ignored).
 	// However, we still need to make sure we don't break the ceiling due to on-gassing during ascent.
-	cache_deco_state(ds, &trial_cache);
 	if (wait_time)
 		add_segment(ds, depth_to_bar(trial_depth, dive),
 			    gasmix,
@@ -538,8 +541,7 @@ static bool trial_ascent(struct deco_state *ds, int wait_time, int trial_depth,
 		double tolerance_limit = tissue_tolerance_calc(ds, dive, depth_to_bar(stoplevel, dive));
 		update_regression(ds, dive);
 		if (deco_allowed_depth(tolerance_limit, surface_pressure, dive, 1) > stoplevel) {
-			restore_deco_state(trial_cache, ds, false);
-			free(trial_cache);
+			restore_deco_state(&trial_cache, ds, false);
 			return false;
 		}
 	}
@@ -562,8 +564,7 @@ static bool trial_ascent(struct deco_state *ds, int wait_time, int trial_depth,
 		}
 		trial_depth -= deltad;
 	}
-	restore_deco_state(trial_cache, ds, false);
-	free(trial_cache);
+	restore_deco_state(&trial_cache, ds, false);
 	return clear_to_ascend;
 }
 
@@ -590,22 +591,41 @@ static bool enough_gas(const struct dive *dive, int current_cylinder)
  * Minimal solution is min + 1, and the solution should be an integer multiple of stepsize.
  * leap is a guess for the maximum but there is no guarantee that leap is an upper limit.
  * So we always test at the upper bundary, not in the middle!
+ * After a failed test, the search continues above the tested time, but a successful test
+ * may be repeated when the search comes back from below. The successful tests are
+ * therefore remembered, which saves the most expensive trial ascents.
  */
+#define MAX_CLEAR_TIMES 32
 static int wait_until(struct deco_state *ds, struct dive *dive, int clock, int min, int leap, int stepsize, int depth, int target_depth, int avg_depth, int bottom_time, struct gasmix gasmix, int po2, double surface_pressure, enum divemode_t divemode)
 {
-	// When a deco stop exceeds two days, there is something wrong...
-	if (min >= 48 * 3600)
-		return 50 * 3600;
-	// Round min + leap up to the next multiple of stepsize
-	int upper = min + leap + stepsize - 1 - (min + leap - 1) % stepsize;
-	// Is the upper boundary too small?
-	if (!trial_ascent(ds, upper - clock, depth, target_depth, avg_depth, bottom_time, gasmix, po2, surface_pressure, dive, divemode))
-		return wait_until(ds, dive, clock, upper, leap, stepsize, depth, target_depth, avg_depth, bottom_time, gasmix, po2, surface_pressure, divemode);
-
-	if (upper - min <= stepsize)
-		return upper;
-
-	return wait_until(ds, dive, clock, min, leap / 2, stepsize, depth, target_depth, avg_depth, bottom_time, gasmix, po2, surface_pressure, divemode);
+	int clear_times[MAX_CLEAR_TIMES];
+	int nr_clear_times = 0;
+
+	for (;;) {
+		// When a deco stop exceeds two days, there is something wrong...
+		if (min >= 48 * 3600)
+			return 50 * 3600;
+		// Round min + leap up to the next multiple of stepsize
+		int upper = min + leap + stepsize - 1 - (min + leap - 1) % stepsize;
+		bool clear = false;
+		for (int i = 0; i < nr_clear_times && !clear; i++)
+			clear = clear_times[i] == upper;
+		if (!clear) {
+			clear = trial_ascent(ds, upper - clock, depth, target_depth, avg_depth, bottom_time, gasmix, po2, surface_pressure, dive, divemode);
+			if (clear && nr_clear_times < MAX_CLEAR_TIMES)
+				clear_times[nr_clear_times++] = upper;
+		}
+		// Is the upper boundary too small?
+		if (!clear) {
+			min = upper;
+			continue;
+		}
+
+		if (upper - min <= stepsize)
+			return upper;
+
+		leap /= 2;
+	}
 }
 
 static void average_max_depth(struct diveplan *dive, int *avg_depth, int *max_depth)
@@ -634,6 +654,29 @@ static void average_max_depth(struct diveplan *dive, int *avg_depth, int *max_de
 		*avg_depth = *max_depth = 0;
 }
 
+/* The gases of the cylinders, looked up once per plan instead of at every step of the ascent */
+struct plan_gases {
+	struct gasmix *mix;
+	int *o2;	/* permille, for the checks of gas switches and oxygen breaks */
+};
+
+static void init_plan_gases(struct plan_gases *gases, const struct dive *dive)
+{
+	int nr = dive->cylinders.nr;
+	gases->mix = malloc(nr * sizeof(*gases->mix));
+	gases->o2 = malloc(nr * sizeof(*gases->o2));
+	for (int i = 0; i < nr; i++) {
+		gases->mix[i] = get_cylinder(dive, i)->gasmix;
+		gases->o2[i] = get_o2(gases->mix[i]);
+	}
+}
+
+static void free_plan_gases(struct plan_gases *gases)
+{
+	free(gases->mix);
+	free(gases->o2);
+}
+
 bool plan(struct deco_state *ds, struct diveplan *diveplan, struct dive *dive, int timestep, struct decostop *decostoptable, struct deco_state **cached_datap, bool is_planner, bool show_disclaimer)
 {
 
@@ -652,6 +695,7 @@ bool plan(struct deco_state *ds, struct diveplan *diveplan, struct dive *dive, i
 	int depth;
 	struct gaschanges *gaschanges = NULL;
 	int gaschangenr;
+	struct plan_gases gases;
 	int *decostoplevels;
 	int decostoplevelcount;
 	int *stoplevels = NULL;
@@ -672,6 +716,7 @@ bool plan(struct deco_state *ds, struct diveplan *diveplan, struct dive *dive, i
 	bool o2breaking = false;
 	int decostopcounter = 0;
 	enum divemode_t divemode = dive->dc.divemode;
+	struct trace_span span = trace_begin("plan");
 
 	set_gf(diveplan->gflow, diveplan->gfhigh);
 	set_vpmb_conservatism(diveplan->vpmb_conservatism);
@@ -725,6 +770,7 @@ bool plan(struct deco_state *ds, struct diveplan *diveplan, struct dive *dive, i
 		transitiontime = lrint(depth / (double)prefs.ascratelast6m);
 		plan_add_segment(diveplan, transitiontime, 0, current_cylinder, po2, false, divemode);
 		create_dive_from_plan(diveplan, dive, is_planner);
+		trace_end(span);
 		return false;
 	}
 
@@ -754,6 +800,7 @@ bool plan(struct deco_state *ds, struct diveplan *diveplan, struct dive *dive, i
 	stopidx += gaschangenr;
 
 	gi = gaschangenr - 1;
+	init_plan_gases(&gases, dive);
 
 	/* Set tissue tolerance and initial vpmb gradient at start of ascent phase */
 	diveplan->surface_interval = tissue_at_end(ds, dive, cached_datap);
@@ -765,11 +812,11 @@ bool plan(struct deco_state *ds, struct diveplan *diveplan, struct dive *dive, i
 		// How long can we stay at the current depth and still directly ascent to the surface?
 		do {
 			add_segment(ds, depth_to_bar(depth, dive),
-				    get_cylinder(dive, current_cylinder)->gasmix,
+				    gases.mix[current_cylinder],
 				    timestep, po2, divemode, prefs.bottomsac);
 			update_cylinder_pressure(dive, depth, depth, timestep, prefs.bottomsac, get_cylinder(dive, current_cylinder), false, divemode);
 			clock += timestep;
-		} while (trial_ascent(ds, 0, depth, 0, avg_depth, bottom_time, get_cylinder(dive, current_cylinder)->gasmix,
+		} while (trial_ascent(ds, 0, depth, 0, avg_depth, bottom_time, gases.mix[current_cylinder],
 				      po2, diveplan->surface_pressure / 1000.0, dive, divemode) &&
 			 enough_gas(dive, current_cylinder) && clock < 6 * 3600);
 
@@ -810,12 +857,14 @@ bool plan(struct deco_state *ds, struct diveplan *diveplan, struct dive *dive, i
 
 		free(stoplevels);
 		free(gaschanges);
+		free_plan_gases(&gases);
+		trace_end(span);
 		return false;
 	}
 
 	if (best_first_ascend_cylinder != current_cylinder) {
 		current_cylinder = best_first_ascend_cylinder;
-		gas = get_cylinder(dive, current_cylinder)->gasmix;
+		gas = gases.mix[current_cylinder];
 
 #if DEBUG_PLAN & 16
 		printf("switch to gas %d (%d/%d) @ %5.2lfm\n", best_first_ascend_cylinder,
@@ -830,7 +879,7 @@ bool plan(struct deco_state *ds, struct diveplan *diveplan, struct dive *dive, i
 		po2 = 0;
 		int bailoutsegment = MAX(prefs.min_switch_duration, 60 * prefs.problemsolvingtime);
 		add_segment(ds, depth_to_bar(depth, dive),
-			get_cylinder(dive, current_cylinder)->gasmix,
+			gases.mix[current_cylinder],
 			bailoutsegment, po2, divemode, prefs.bottomsac);
 		plan_add_segment(diveplan, bailoutsegment, depth, current_cylinder, po2, false, divemode);
 		bottom_time += bailoutsegment;
@@ -872,7 +921,7 @@ bool plan(struct deco_state *ds, struct diveplan *diveplan, struct dive *dive, i
 		last_ascend_rate = ascent_velocity(depth, avg_depth, bottom_time);
 		/* Always prefer the best_first_ascend_cylinder if it has the right gasmix.
 		 * Otherwise take first cylinder from list with rightgasmix  */
-		if (same_gasmix(gas, get_cylinder(dive, best_first_ascend_cylinder)->gasmix))
+		if (same_gasmix(gas, gases.mix[best_first_ascend_cylinder]))
 			current_cylinder = best_first_ascend_cylinder;
 		else
 			current_cylinder = get_gasidx(dive, gas);
@@ -897,7 +946,7 @@ bool plan(struct deco_state *ds, struct diveplan *diveplan, struct dive *dive, i
 					deltad = depth - stoplevels[stopidx];
 
 				add_segment(ds, depth_to_bar(depth, dive),
-								get_cylinder(dive, current_cylinder)->gasmix,
+								gases.mix[current_cylinder],
 								TIMESTEP, po2, divemode, prefs.decosac);
 				last_segment_min_switch = false;
 				clock += TIMESTEP;
@@ -922,21 +971,21 @@ bool plan(struct deco_state *ds, struct diveplan *diveplan, struct dive *dive, i
 				if (current_cylinder != gaschanges[gi].gasidx) {
 					if (!prefs.switch_at_req_stop ||
 							!trial_ascent(ds, 0, depth, stoplevels[stopidx - 1], avg_depth, bottom_time,
-							get_cylinder(dive, current_cylinder)->gasmix, po2, diveplan->surface_pressure / 1000.0, dive, divemode) || get_o2(get_cylinder(dive, current_cylinder)->gasmix) < 160) {
+							gases.mix[current_cylinder], po2, diveplan->surface_pressure / 1000.0, dive, divemode) || gases.o2[current_cylinder] < 160) {
 						if (is_final_plan)
 							plan_add_segment(diveplan, clock - previous_point_time, depth, current_cylinder, po2, false, divemode);
 						stopping = true;
 						previous_point_time = clock;
 						current_cylinder = gaschanges[gi].gasidx;
-						gas = get_cylinder(dive, current_cylinder)->gasmix;
+						gas = gases.mix[current_cylinder];
 #if DEBUG_PLAN & 16
 						printf("switch to gas %d (%d/%d) @ %5.2lfm\n", gaschanges[gi].gasidx,
 							(get_o2(&gas) + 5) / 10, (get_he(&gas) + 5) / 10, gaschanges[gi].depth / 1000.0);
 #endif
 						/* Stop for the minimum duration to switch gas unless we switch to o2 */
-						if (!last_segment_min_switch && get_o2(get_cylinder(dive, current_cylinder)->gasmix) != 1000) {
+						if (!last_segment_min_switch && gases.o2[current_cylinder] != 1000) {
 							add_segment(ds, depth_to_bar(depth, dive),
-								get_cylinder(dive, current_cylinder)->gasmix,
+								gases.mix[current_cylinder],
 								prefs.min_switch_duration, po2, divemode, prefs.decosac);
 							clock += prefs.min_switch_duration;
 							last_segment_min_switch = true;
@@ -956,7 +1005,7 @@ bool plan(struct deco_state *ds, struct diveplan *diveplan, struct dive *dive, i
 			while (1) {
 				/* Check if ascending to next stop is clear, go back and wait if we hit the ceiling on the way */
 				if (trial_ascent(ds, 0, depth, stoplevels[stopidx], avg_depth, bottom_time,
-						get_cylinder(dive, current_cylinder)->gasmix, po2, diveplan->surface_pressure / 1000.0, dive, divemode)) {
+						gases.mix[current_cylinder], po2, diveplan->surface_pressure / 1000.0, dive, divemode)) {
 					decostoptable[decostopcounter].depth = depth;
 					decostoptable[decostopcounter].time = 0;
 					decostopcounter++;
@@ -982,15 +1031,15 @@ bool plan(struct deco_state *ds, struct diveplan *diveplan, struct dive *dive, i
 				 */
 				if (pendinggaschange) {
 					current_cylinder = gaschanges[gi + 1].gasidx;
-					gas = get_cylinder(dive, current_cylinder)->gasmix;
+					gas = gases.mix[current_cylinder];
 #if DEBUG_PLAN & 16
 					printf("switch to gas %d (%d/%d) @ %5.2lfm\n", gaschanges[gi + 1].gasidx,
 						(get_o2(&gas) + 5) / 10, (get_he(&gas) + 5) / 10, gaschanges[gi + 1].depth / 1000.0);
 #endif
 					/* Stop for the minimum duration to switch gas unless we switch to o2 */
-					if (!last_segment_min_switch && get_o2(get_cylinder(dive, current_cylinder)->gasmix) != 1000) {
+					if (!last_segment_min_switch && gases.o2[current_cylinder] != 1000) {
 						add_segment(ds, depth_to_bar(depth, dive),
-							get_cylinder(dive, current_cylinder)->gasmix,
+							gases.mix[current_cylinder],
 							prefs.min_switch_duration, po2, divemode, prefs.decosac);
 						clock += prefs.min_switch_duration;
 						last_segment_min_switch = true;
@@ -999,7 +1048,7 @@ bool plan(struct deco_state *ds, struct diveplan *diveplan, struct dive *dive, i
 				}
 
 				int new_clock = wait_until(ds, dive, clock, clock, laststoptime * 2 + 1, timestep, depth, stoplevels[stopidx], avg_depth,
-					bottom_time, get_cylinder(dive, current_cylinder)->gasmix, po2, diveplan->surface_pressure / 1000.0, divemode);
+					bottom_time, gases.mix[current_cylinder], po2, diveplan->surface_pressure / 1000.0, divemode);
 				laststoptime = new_clock - clock;
 				/* Finish infinite deco */
 				if (laststoptime >= 48 * 3600 && depth >= 6000) {
@@ -1014,12 +1063,12 @@ bool plan(struct deco_state *ds, struct diveplan *diveplan, struct dive *dive, i
 					 * backgas.  This could be customized if there were demand.
 					 */
 					if (break_cylinder == -1) {
-						if (get_o2(get_cylinder(dive, best_first_ascend_cylinder)->gasmix) <= 320)
+						if (gases.o2[best_first_ascend_cylinder] <= 320)
 							break_cylinder = best_first_ascend_cylinder;
 						else
 							break_cylinder = 0;
 					}
-					if (get_o2(get_cylinder(dive, current_cylinder)->gasmix) == 1000) {
+					if (gases.o2[current_cylinder] == 1000) {
 						if (laststoptime >= 12 * 60) {
 							laststoptime = 12 * 60;
 							new_clock = clock + laststoptime;
@@ -1030,7 +1079,7 @@ bool plan(struct deco_state *ds, struct diveplan *diveplan, struct dive *dive, i
 								plan_add_segment(diveplan, laststoptime, depth, current_cylinder, po2, false, divemode);
 							previous_point_time = clock + laststoptime;
 							current_cylinder = break_cylinder;
-							gas = get_cylinder(dive, current_cylinder)->gasmix;
+							gas = gases.mix[current_cylinder];
 						}
 					} else if (o2break_next) {
 						if (laststoptime >= 6 * 60) {
@@ -1042,11 +1091,11 @@ bool plan(struct deco_state *ds, struct diveplan *diveplan, struct dive *dive, i
 								plan_add_segment(diveplan, laststoptime, depth, current_cylinder, po2, false, divemode);
 							previous_point_time = clock + laststoptime;
 							current_cylinder = breakfrom_cylinder;
-							gas = get_cylinder(dive, current_cylinder)->gasmix;
+							gas = gases.mix[current_cylinder];
 						}
 					}
 				}
-				add_segment(ds, depth_to_bar(depth, dive), get_cylinder(dive, stop_cylinder)->gasmix,
+				add_segment(ds, depth_to_bar(depth, dive), gases.mix[stop_cylinder],
 					    laststoptime, po2, divemode, prefs.decosac);
 				last_segment_min_switch = false;
 				decostoptable[decostopcounter].depth = depth;
@@ -1094,7 +1143,9 @@ bool plan(struct deco_state *ds, struct diveplan *diveplan, struct dive *dive, i
 
 	free(stoplevels);
 	free(gaschanges);
+	free_plan_gases(&gases);
 	free(bottom_cache);
+	trace_end(span);
 	return decodive;
 }
 
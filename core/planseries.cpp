@@ -0,0 +1,101 @@
+// SPDX-License-Identifier: GPL-2.0
+#include "planseries.h"
+#include "dive.h"
+#include "divelist.h"
+#include "parallel.h"
+#include "pref.h"
+#include "trace.h"
+#include <algorithm>
+#include <iterator>
+#include <math.h>
+#include <stdlib.h>
+
+static double leadingTissue(const struct deco_state *ds)
+{
+	double res = 0.0;
+	for (int ci = 0; ci < 16; ci++)
+		res = std::max(res, ds->tissue_n2_sat[ci] + ds->tissue_he_sat[ci]);
+	return res;
+}
+
+static void fillGasResults(const struct SeriesDive &sd, SeriesDiveResult &res)
+{
+	const struct dive *dive = sd.dive;
+	res.minimumGas = 0;
+	for (const struct divedatapoint *dp = sd.plan.dp; dp; dp = dp->next)
+		res.minimumGas = std::max(res.minimumGas, dp->minimum_gas.mbar);
+	res.enoughGas = true;
+	for (int i = 0; i < dive->cylinders.nr; i++) {
+		const cylinder_t *cyl = get_cylinder(dive, i);
+		res.gasUsed.push_back(cyl->gas_used);
+		res.endPressure.push_back(cyl->end);
+		if (cyl->type.size.mliter && cyl->start.mbar && cyl->gas_used.mliter && cyl->end.mbar < prefs.reserve_gas)
+			res.enoughGas = false;
+	}
+}
+
+// The tissues at the start of a dive are passed to plan() as its cache of the
+// previous dives. Afterwards, the planned profile and the following surface
+// interval are added to them, exactly like init_decompression() does for the
+// dives in the logbook.
+static void planSeries(int seriesIdx, std::vector<SeriesDive> &dives, std::vector<SeriesDiveResult> &results)
+{
+	struct deco_state ds;
+	struct deco_state *cache = NULL;
+	struct decostop stoptable[60];
+	double cns = 0.0;
+	int otu = 0;
+	timestamp_t lastEnd = 0;
+
+	for (size_t i = 0; i < dives.size(); i++) {
+		SeriesDive &sd = dives[i];
+		struct dive *dive = sd.dive;
+		SeriesDiveResult res;
+
+		// The deco settings are global, so all dives have to use the same
+		sd.plan.gflow = prefs.gflow;
+		sd.plan.gfhigh = prefs.gfhigh;
+		sd.plan.vpmb_conservatism = prefs.vpmb_conservatism;
+		if (i > 0) {
+			sd.plan.when = lastEnd + sd.surfaceInterval;
+			cns /= pow(2, sd.surfaceInterval / (90.0 * 60.0));
+		}
+		// Without cache, the first dive calculates the tissues after the logbook and caches them
+		res.decoDive = plan(&ds, &sd.plan, dive, DECOTIMESTEP, stoptable, &cache, true, false);
+		res.series = seriesIdx;
+		res.index = (int)i;
+		res.runtime = dive->dc.duration.seconds;
+		res.leadingTissue = cache ? leadingTissue(cache) : 0.0;
+		cns += calculate_cns_dive(dive);
+		otu += dive->otu;
+		res.cns = lrint(cns);
+		res.otu = otu;
+		fillGasResults(sd, res);
+		results.push_back(std::move(res));
+
+		lastEnd = dive_endtime(dive);
+		if (i + 1 >= dives.size() || !cache)
+			continue;
+		restore_deco_state(cache, &ds, false);
+		add_dive_to_deco(&ds, dive);
+		clear_vpmb_state(&ds);
+		add_segment(&ds, get_surface_pressure_in_mbar(dive, true) / 1000.0, gasmix_air,
+			    dives[i + 1].surfaceInterval, 0, dive->dc.divemode, prefs.decosac);
+		cache_deco_state(&ds, &cache);
+	}
+	free(cache);
+}
+
+std::vector<SeriesDiveResult> plan_series(std::vector<std::vector<SeriesDive>> &series)
+{
+	TraceSpan span("plan_series");
+	std::vector<std::vector<SeriesDiveResult>> seriesResults(series.size());
+	parallel_for((int)series.size(), [&series, &seriesResults](int i) {
+		planSeries(i, series[i], seriesResults[i]);
+	});
+
+	std::vector<SeriesDiveResult> res;
+	for (std::vector<SeriesDiveResult> &results: seriesResults)
+		res.insert(res.end(), std::make_move_iterator(results.begin()), std::make_move_iterator(results.end()));
+	return res;
+}
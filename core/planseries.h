@@ -0,0 +1,41 @@
+// SPDX-License-Identifier: GPL-2.0
+// Planning of series of repetitive dives, e.g. the dives of a trip. The dives of
+// a series are planned one after the other, each starting with the tissues
+// at the end of the previous dive and its surface interval. Independent series
+// are planned in parallel.
+#ifndef PLANSERIES_H
+#define PLANSERIES_H
+
+#include "deco.h"
+#include "planner.h"
+#include <vector>
+
+struct dive;
+
+struct SeriesDive {
+	struct diveplan plan;		// the waypoints entered by the user, the ascent is added
+	struct dive *dive;		// with the cylinders, the calculated dive is stored here
+	int surfaceInterval;		// seconds after the previous dive of the series
+};
+
+struct SeriesDiveResult {
+	int series;			// index of the series and of the dive in the series
+	int index;
+	int runtime;			// seconds
+	bool decoDive;
+	int cns;			// %, including the previous dives of the series
+	int otu;			// sum of this and the previous dives of the series
+	double leadingTissue;		// bar, inert gas pressure of the most loaded tissue at the start
+	int minimumGas;			// mbar of the bottom gas, 0 if not calculated
+	bool enoughGas;			// no cylinder ends below the reserve
+	std::vector<volume_t> gasUsed;	// for each cylinder of the dive
+	std::vector<pressure_t> endPressure;
+};
+
+// The first dive of a series starts with the tissues after the dives in the
+// logbook before it, the time of the following dives is set from the surface
+// intervals. Uses the current planner preferences for all dives. Returns the
+// results of all dives, ordered by series.
+std::vector<SeriesDiveResult> plan_series(std::vector<std::vector<SeriesDive>> &series);
+
+#endif
@@ -84,6 +84,7 @@ struct preferences {
 	bool       cloud_auto_sync;
 	const char *cloud_base_url;
 	const char *cloud_git_url;
+	bool        cloud_metered_connection;
 	const char *cloud_storage_email;
 	const char *cloud_storage_email_encoded;
 	const char *cloud_storage_password;
@@ -24,6 +24,8 @@
 #include "membuffer.h"
 #include "qthelper.h"
 #include "format.h"
+#include "parallel.h"
+#include "trace.h"
 
 //#define DEBUG_GAS 1
 
@@ -291,21 +293,21 @@ int get_cylinder_index(const struct dive *dive, const struct event *ev)
 	return best < 0 ? 0 : best;
 }
 
-struct event *get_next_event_mutable(struct event *event, const char *name)
+struct event *get_next_event_mutable(struct event *event, int name_id)
 {
-	if (!name || !*name)
+	if (name_id == EVENT_NAME_NONE)
 		return NULL;
 	while (event) {
-		if (same_string(event->name, name))
+		if (event->name_id == name_id)
 			return event;
 		event = event->next;
 	}
 	return event;
 }
 
-const struct event *get_next_event(const struct event *event, const char *name)
+const struct event *get_next_event(const struct event *event, int name_id)
 {
-	return get_next_event_mutable((struct event *)event, name);
+	return get_next_event_mutable((struct event *)event, name_id);
 }
 
 static int count_events(struct divecomputer *dc)
@@ -337,7 +339,7 @@ static void check_setpoint_events(const struct dive *dive, struct divecomputer *
 	int i = 0;
 	pressure_t setpoint;
 	setpoint.mbar = 0;
-	const struct event *ev = get_next_event(dc->events, "SP change");
+	const struct event *ev = get_next_event(dc->events, EVENT_NAME_SP_CHANGE);
 
 	if (!ev)
 		return;
@@ -347,7 +349,7 @@ static void check_setpoint_events(const struct dive *dive, struct divecomputer *
 		setpoint.mbar = ev->value;
 		if (setpoint.mbar)
 			dc->divemode = CCR;
-		ev = get_next_event(ev->next, "SP change");
+		ev = get_next_event(ev->next, EVENT_NAME_SP_CHANGE);
 	} while (ev);
 	set_setpoint(pi, i, setpoint.mbar, INT_MAX);
 }
@@ -466,12 +468,25 @@ static void insert_entry(struct plot_info *pi, int idx, int time, int depth, int
 	entry->bearing = -1;
 }
 
+/* Bytes held by the arrays of a plot info - accounted in the "plot_info bytes" counter */
+static int64_t plot_info_bytes(const struct plot_info *pi)
+{
+	if (!pi->entry)
+		return 0;
+	return (int64_t)pi->nr * (sizeof(struct plot_data) + pi->nr_cylinders * sizeof(struct plot_pressure_data) +
+				  (pi->tissues ? sizeof(*pi->tissues) : 0));
+}
+
 void free_plot_info_data(struct plot_info *pi)
 {
+	if (pi->entry)
+		trace_count("plot_info bytes", -plot_info_bytes(pi));
 	free(pi->entry);
 	free(pi->pressures);
+	free(pi->tissues);
 	pi->entry = NULL;
 	pi->pressures = NULL;
+	pi->tissues = NULL;
 }
 
 static void populate_plot_entries(struct dive *dive, struct divecomputer *dc, struct plot_info *pi)
@@ -767,7 +782,7 @@ static void matching_gases(struct dive *dive, struct gasmix gasmix, bool gases[]
 static void calculate_sac(struct dive *dive, struct divecomputer *dc, struct plot_info *pi)
 {
 	struct gasmix gasmix = gasmix_invalid;
-	const struct event *ev = NULL;
+	struct gas_timeline timeline;
 	bool *gases, *gases_scratch;
 
 	gases = calloc(pi->nr_cylinders, sizeof(*gases));
@@ -776,9 +791,10 @@ static void calculate_sac(struct dive *dive, struct divecomputer *dc, struct plo
 	 * the fill_sac function only once an not once per sample */
 	gases_scratch = malloc(pi->nr_cylinders * sizeof(*gases));
 
+	init_gas_timeline(&timeline, dive, dc);
 	for (int i = 0; i < pi->nr; i++) {
 		struct plot_data *entry = pi->entry + i;
-		struct gasmix newmix = get_gasmix(dive, dc, entry->sec, &ev, gasmix);
+		struct gasmix newmix = gasmix_in_timeline(&timeline, entry->sec);
 		if (!same_gasmix(newmix, gasmix)) {
 			gasmix = newmix;
 			matching_gases(dive, newmix, gases);
@@ -787,6 +803,7 @@ static void calculate_sac(struct dive *dive, struct divecomputer *dc, struct plo
 		fill_sac(dive, pi, i, gases, gases_scratch);
 	}
 
+	free_gas_timeline(&timeline);
 	free(gases);
 	free(gases_scratch);
 }
@@ -833,7 +850,7 @@ static void setup_gas_sensor_pressure(const struct dive *dive, const struct dive
 	prev = explicit_first_cylinder(dive, dc);
 	seen[prev] = 1;
 
-	for (ev = get_next_event(dc->events, "gaschange"); ev != NULL; ev = get_next_event(ev->next, "gaschange")) {
+	for (ev = get_next_event(dc->events, EVENT_NAME_GASCHANGE); ev != NULL; ev = get_next_event(ev->next, EVENT_NAME_GASCHANGE)) {
 		int cyl = ev->gas.index;
 		int sec = ev->time.seconds;
 
@@ -1006,7 +1023,11 @@ void calculate_deco_information(struct deco_state *ds, const struct deco_state *
 		ds->first_ceiling_pressure = planner_ds->first_ceiling_pressure;
 	}
 	struct deco_state *cache_data_initial = NULL;
-	lock_planner();
+	struct gas_timeline timeline;
+	init_gas_timeline(&timeline, dive, dc);
+	if (!pi->tissues)
+		pi->tissues = calloc(pi->nr, sizeof(*pi->tissues));
+	lock_planner_shared();
 	/* For VPM-B outside the planner, cache the initial deco state for CVA iterations */
 	if (decoMode() == VPMB) {
 		cache_deco_state(ds, &cache_data_initial);
@@ -1019,16 +1040,17 @@ void calculate_deco_information(struct deco_state *ds, const struct deco_state *
 		if (decoMode() == VPMB)
 			ds->first_ceiling_pressure.mbar = depth_to_mbar(first_ceiling, dive);
 		struct gasmix gasmix = gasmix_invalid;
-		const struct event *ev = NULL, *evd = NULL;
+		const struct event *evd = NULL;
 		enum divemode_t current_divemode = UNDEF_COMP_TYPE;
 
 		for (i = 1; i < pi->nr; i++) {
 			struct plot_data *entry = pi->entry + i;
+			struct plot_tissue_data *tissues = pi->tissues + i;
 			int j, t0 = (entry - 1)->sec, t1 = entry->sec;
 			int time_stepsize = 20;
 
 			current_divemode = get_current_divemode(dc, entry->sec, &evd, &current_divemode);
-			gasmix = get_gasmix(dive, dc, t1, &ev, gasmix);
+			gasmix = gasmix_in_timeline(&timeline, t1);
 			entry->ambpressure = depth_to_bar(entry->depth, dive);
 			entry->gfline = get_gf(ds, entry->ambpressure, dive) * (100.0 - AMB_PERCENTAGE) + AMB_PERCENTAGE;
 			if (t0 > t1) {
@@ -1094,9 +1116,9 @@ void calculate_deco_information(struct deco_state *ds, const struct deco_state *
 			for (j = 0; j < 16; j++) {
 				double m_value = ds->buehlmann_inertgas_a[j] + entry->ambpressure / ds->buehlmann_inertgas_b[j];
 				double surface_m_value = ds->buehlmann_inertgas_a[j] + surface_pressure / ds->buehlmann_inertgas_b[j];
-				entry->ceilings[j] = deco_allowed_depth(ds->tolerated_by_tissue[j], surface_pressure, dive, 1);
+				tissues->ceilings[j] = deco_allowed_depth(ds->tolerated_by_tissue[j], surface_pressure, dive, 1);
 				double current_gf = (ds->tissue_inertgas_saturation[j] - entry->ambpressure) / (m_value - entry->ambpressure);
-				entry->percentages[j] = ds->tissue_inertgas_saturation[j] < entry->ambpressure ?
+				tissues->percentages[j] = ds->tissue_inertgas_saturation[j] < entry->ambpressure ?
 					lrint(ds->tissue_inertgas_saturation[j] / entry->ambpressure * AMB_PERCENTAGE) :
 					lrint(AMB_PERCENTAGE + current_gf * (100.0 - AMB_PERCENTAGE));
 				if (current_gf > entry->current_gf)
@@ -1162,6 +1184,7 @@ void calculate_deco_information(struct deco_state *ds, const struct deco_state *
 	}
 
 	free(cache_data_initial);
+	free_gas_timeline(&timeline);
 #if DECO_CALC_DEBUG & 1
 	dump_tissues(ds);
 #endif
@@ -1216,24 +1239,24 @@ static void calculate_gas_information_new(struct dive *dive, struct divecomputer
 {
 	int i;
 	double amb_pressure;
-	struct gasmix gasmix = gasmix_invalid;
-	const struct event *evg = NULL, *evd = NULL;
+	struct gasmix gasmix;
+	const struct event *evd = NULL;
 	enum divemode_t current_divemode = UNDEF_COMP_TYPE;
+	struct gas_timeline timeline;
 
+	init_gas_timeline(&timeline, dive, dc);
 	for (i = 1; i < pi->nr; i++) {
 		int fn2, fhe;
 		struct plot_data *entry = pi->entry + i;
 
-		gasmix = get_gasmix(dive, dc, entry->sec, &evg, gasmix);
+		gasmix = gasmix_in_timeline(&timeline, entry->sec);
 		amb_pressure = depth_to_bar(entry->depth, dive);
 		current_divemode = get_current_divemode(dc, entry->sec, &evd, &current_divemode);
 		fill_pressures(&entry->pressures, amb_pressure, gasmix, (current_divemode == OC) ? 0.0 : entry->o2pressure.mbar / 1000.0, current_divemode);
 		fn2 = (int)(1000.0 * entry->pressures.n2 / amb_pressure);
 		fhe = (int)(1000.0 * entry->pressures.he / amb_pressure);
-		if (dc->divemode == PSCR) { // OC pO2 is calulated for PSCR with or without external PO2 monitoring.
-			struct gasmix gasmix2 = get_gasmix(dive, dc, entry->sec, &evg, gasmix);
-			entry->scr_OC_pO2.mbar = (int) depth_to_mbar(entry->depth, dive) * get_o2(gasmix2) / 1000;
-		}
+		if (dc->divemode == PSCR) // OC pO2 is calulated for PSCR with or without external PO2 monitoring.
+			entry->scr_OC_pO2.mbar = (int) depth_to_mbar(entry->depth, dive) * get_o2(gasmix) / 1000;
 
 		/* Calculate MOD, EAD, END and EADD based on partial pressures calculated before
 		 * so there is no difference in calculating between OC and CC
@@ -1258,6 +1281,7 @@ static void calculate_gas_information_new(struct dive *dive, struct divecomputer
 		if (entry->eadd < 0)
 			entry->eadd = 0;
 	}
+	free_gas_timeline(&timeline);
 }
 
 void fill_o2_values(struct dive *dive, struct divecomputer *dc, struct plot_info *pi)
@@ -1342,6 +1366,7 @@ void init_plot_info(struct plot_info *pi)
 void create_plot_info_new(struct dive *dive, struct divecomputer *dc, struct plot_info *pi, bool fast, const struct deco_state *planner_ds)
 {
 	int o2, he, o2max;
+	struct trace_span span = trace_begin("create_plot_info_new");
 #ifndef SUBSURFACE_MOBILE
 	struct deco_state plot_deco_state;
 	init_decompression(&plot_deco_state, dive);
@@ -1383,6 +1408,35 @@ void create_plot_info_new(struct dive *dive, struct divecomputer *dc, struct plo
 
 	pi->meandepth = dive->dc.meandepth.mm;
 	analyze_plot_info(pi);
+	trace_count("plot_info bytes", plot_info_bytes(pi));
+	trace_end(span);
+}
+
+struct all_dcs_job {
+	struct dive *dive;
+	struct plot_info *pi;
+	bool fast;
+};
+
+static void create_plot_info_one_dc(int idx, void *data)
+{
+	struct all_dcs_job *job = data;
+
+	create_plot_info_new(job->dive, get_dive_dc(job->dive, idx), &job->pi[idx], job->fast, NULL);
+}
+
+/*
+ * The plot info of all divecomputers of the dive, calculated in parallel.
+ * "pi" has an entry for each divecomputer, initialized with init_plot_info().
+ * The threads only write to their own divecomputer (its dive mode).
+ */
+void create_plot_info_all_dcs(struct dive *dive, struct plot_info pi[], bool fast)
+{
+	struct all_dcs_job job = { dive, pi, fast };
+	struct trace_span span = trace_begin("create_plot_info_all_dcs");
+
+	parallel_for(number_of_computers(dive), create_plot_info_one_dc, &job);
+	trace_end(span);
 }
 
 struct divecomputer *select_dc(struct dive *dive)
@@ -1530,8 +1584,9 @@ static void plot_string(const struct plot_info *pi, int idx, struct membuffer *b
 			if (prefs.calcalltissues) {
 				int k;
 				for (k = 0; k < 16; k++) {
-					if (entry->ceilings[k]) {
-						depthvalue = get_depth_units(entry->ceilings[k], NULL, &depth_unit);
+					int tissue_ceiling = get_plot_tissue_ceiling(pi, idx, k);
+					if (tissue_ceiling) {
+						depthvalue = get_depth_units(tissue_ceiling, NULL, &depth_unit);
 						put_format_loc(b, translate("gettextFromC", "Tissue %.0fmin: %.1f%s\n"), buehlmann_N2_t_halflife[k], depthvalue, depth_unit);
 					}
 				}
@@ -1554,17 +1609,24 @@ static void plot_string(const struct plot_info *pi, int idx, struct membuffer *b
 
 int get_plot_details_new(const struct plot_info *pi, int time, struct membuffer *mb)
 {
-	int i;
+	int low, high;
 
 	/* The two first and the two last plot entries do not have useful data */
 	if (pi->nr <= 4)
 		return 0;
-	for (i = 2; i < pi->nr - 2; i++) {
-		if (pi->entry[i].sec >= time)
-			break;
+
+	/* The entries are sorted by time: binary search for the first entry at or after "time" */
+	low = 2;
+	high = pi->nr - 2;
+	while (low < high) {
+		int mid = low + (high - low) / 2;
+		if (pi->entry[mid].sec >= time)
+			high = mid;
+		else
+			low = mid + 1;
 	}
-	plot_string(pi, i, mb);
-	return i;
+	plot_string(pi, low, mb);
+	return low;
 }
 
 /* Compare two plot_data entries and writes the results into a string */
@@ -35,6 +35,14 @@ struct plot_pressure_data {
 	int data[NUM_PLOT_PRESSURES];
 };
 
+/*
+ * per-tissue deco data, only allocated if the deco information was calculated
+ */
+struct plot_tissue_data {
+	int ceilings[16];
+	int percentages[16];
+};
+
 struct plot_data {
 	unsigned int in_deco : 1;
 	int sec;
@@ -42,8 +50,6 @@ struct plot_data {
 	/* Depth info */
 	int depth;
 	int ceiling;
-	int ceilings[16];
-	int percentages[16];
 	int ndl;
 	int tts;
 	int rbt;
@@ -83,6 +89,7 @@ struct plot_data {
 extern void compare_samples(struct plot_info *p1, int idx1, int idx2, char *buf, int bufsize, bool sum);
 extern void init_plot_info(struct plot_info *pi);
 extern void create_plot_info_new(struct dive *dive, struct divecomputer *dc, struct plot_info *pi, bool fast, const struct deco_state *planner_ds);
+extern void create_plot_info_all_dcs(struct dive *dive, struct plot_info pi[], bool fast);
 extern void calculate_deco_information(struct deco_state *ds, const struct deco_state *planner_de, const struct dive *dive, const struct divecomputer *dc, struct plot_info *pi, bool print_mode);
 extern int get_plot_details_new(const struct plot_info *pi, int time, struct membuffer *);
 extern void free_plot_info_data(struct plot_info *pi);
@@ -128,6 +135,16 @@ static inline int get_plot_pressure(const struct plot_info *pi, int idx, int cyl
 	return res ? res : get_plot_interpolated_pressure(pi, idx, cylinder);
 }
 
+static inline int get_plot_tissue_ceiling(const struct plot_info *pi, int idx, int tissue)
+{
+	return pi->tissues ? pi->tissues[idx].ceilings[tissue] : 0;
+}
+
+static inline int get_plot_tissue_percentage(const struct plot_info *pi, int idx, int tissue)
+{
+	return pi->tissues ? pi->tissues[idx].percentages[tissue] : 0;
+}
+
 #ifdef __cplusplus
 }
 #endif
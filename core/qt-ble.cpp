@@ -33,21 +33,25 @@ static int debugCounter;
 #define MAXIMAL_HW_CREDIT	255
 #define MINIMAL_HW_CREDIT	32
 
+// Sleep in the event loop until the expression becomes true or the
+// timeout expires. The timer makes sure that we wake up at the timeout.
+// Polling would add a delay to every received packet.
 #define WAITFOR(expression, ms) do {					\
 	Q_ASSERT(QCoreApplication::instance());				\
 	Q_ASSERT(QThread::currentThread());				\
 									\
 	if (expression)							\
 		break;							\
-	QElapsedTimer timer;						\
-	timer.start();							\
+	QTimer wakeup;							\
+	wakeup.setSingleShot(true);					\
+	wakeup.setTimerType(Qt::PreciseTimer);				\
+	wakeup.start(ms);						\
 									\
 	do {								\
-		QCoreApplication::processEvents(QEventLoop::AllEvents, ms); \
+		QCoreApplication::processEvents(QEventLoop::AllEvents | QEventLoop::WaitForMoreEvents); \
 		if (expression)						\
 			break;						\
-		QThread::msleep(10);					\
-	} while (timer.elapsed() < (ms));				\
+	} while (wakeup.isActive());					\
 } while (0)
 
 extern "C" {
@@ -70,6 +74,8 @@ void BLEObject::characteristcStateChanged(const QLowEnergyCharacteristic &c, con
 		if (c.uuid() == hwAllCharacteristics[HW_OSTC_BLE_DATA_TX]) {
 			hw_credit--;
 			receivedPackets.append(value);
+			bytesReceived += value.size();
+			packetsReceived++;
 			if (hw_credit == MINIMAL_HW_CREDIT)
 				setHwCredit(MAXIMAL_HW_CREDIT - MINIMAL_HW_CREDIT);
 		} else {
@@ -77,6 +83,8 @@ void BLEObject::characteristcStateChanged(const QLowEnergyCharacteristic &c, con
 		}
 	} else {
 		receivedPackets.append(value);
+		bytesReceived += value.size();
+		packetsReceived++;
 	}
 }
 
@@ -236,12 +244,21 @@ BLEObject::BLEObject(QLowEnergyController *c, device_data_t *d)
 	debugCounter = 0;
 	isCharacteristicWritten = false;
 	timeout = BLE_TIMEOUT;
+	sessionTimer.start();
 }
 
 BLEObject::~BLEObject()
 {
 	qDebug() << "Deleting BLE object";
 
+	double seconds = sessionTimer.elapsed() / 1000.0;
+	qDebug() << "BLE session:" << bytesReceived << "bytes in" << packetsReceived << "packets received,"
+		 << bytesSent << "bytes sent in" << seconds << "s"
+		 << "(" << (seconds > 0.0 ? bytesReceived / seconds : 0.0) << "bytes/s )";
+#if QT_VERSION >= QT_VERSION_CHECK(5, 14, 0)
+	qDebug() << "BLE MTU:" << controller->mtu();
+#endif
+
 	qDeleteAll(services);
 
 	delete controller;
@@ -315,6 +332,7 @@ dc_status_t BLEObject::write(const void *data, size_t size, size_t *actual)
 				QLowEnergyService::WriteWithResponse;
 
 		preferredService()->writeCharacteristic(c, bytes, mode);
+		bytesSent += size;
 		if (actual) *actual = size;
 		return DC_STATUS_SUCCESS;
 	}
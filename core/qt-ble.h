@@ -6,6 +6,7 @@
 #include "core/libdivecomputer.h"
 #include <QVector>
 #include <QLowEnergyController>
+#include <QElapsedTimer>
 #include <QEventLoop>
 
 #define HW_OSTC_BLE_DATA_RX	0
@@ -55,6 +56,10 @@ private:
 	unsigned int desc_written = 0;
 	int timeout;
 
+	// Throughput statistics, logged when the connection is closed
+	QElapsedTimer sessionTimer;
+	size_t bytesReceived = 0, packetsReceived = 0, bytesSent = 0;
+
 	QList<QUuid> hwAllCharacteristics = {
 		"{00000001-0000-1000-8000-008025000000}", // HW_OSTC_BLE_DATA_RX
 		"{00000002-0000-1000-8000-008025000000}", // HW_OSTC_BLE_DATA_TX
@@ -7,12 +7,15 @@
 #include "qthelper.h"
 #include "errorhelper.h"
 #include "core/settings/qPref.h"
+#include "core/settings/qPrefLanguage.h"
+#include "trace.h"
 
 char *settings_suffix = NULL;
 static QTranslator qtTranslator, ssrfTranslator;
 
 void init_qt_late()
 {
+	TraceSpan span("init_qt_late");
 	QApplication *application = qApp;
 	// tell Qt to use system proxies
 	// note: on Linux, "system" == "environment variables"
@@ -111,4 +114,8 @@ void init_qt_late()
 	} else {
 		qDebug() << "can't find Subsurface localization for locale" << uiLang;
 	}
+	// Strings translated before the translators were installed are not translated
+	trGettextReset();
+	QObject::connect(qPrefLanguage::instance(), &qPrefLanguage::languageChanged, &trGettextReset);
+	QObject::connect(qPrefLanguage::instance(), &qPrefLanguage::lang_localeChanged, &trGettextReset);
 }
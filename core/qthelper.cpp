@@ -22,8 +22,14 @@
 #include "tag.h"
 #include "trip.h"
 #include "imagedownloader.h"
+#include "localfilenamestore.h"
 #include "xmlparams.h"
+#include "sha1.h"
+#include "trace.h"
 #include <QFile>
+#include <QMutex>
+#include <QReadWriteLock>
+#include <QtEndian>
 #include <QRegExp>
 #include <QDir>
 #include <QDebug>
@@ -31,12 +37,12 @@
 #include <QJsonDocument>
 #include <QNetworkProxy>
 #include <QDateTime>
+#include <QElapsedTimer>
 #include <QImageReader>
 #include <QtConcurrent>
 #include <QFont>
 #include <QApplication>
 #include <QTextDocument>
-#include <QProgressDialog>	// TODO: remove with convertThumbnails()
 #include <cstdarg>
 #include <cstdint>
 #ifdef Q_OS_UNIX
@@ -319,9 +325,19 @@ static xmlDocPtr get_stylesheet_doc(const xmlChar *uri, xmlDictPtr, int, void *,
 	return doc;
 }
 
+// The compiled stylesheets are only read when applying them, so that they can be
+// shared by all imports and exports, also by the ones running in parallel.
+static QMutex stylesheetMutex;
+static QHash<QString, xsltStylesheetPtr> stylesheets;
+
 extern "C" xsltStylesheetPtr get_stylesheet(const char *name)
 {
-	// this needs to be done only once, but doesn't hurt to run every time
+	QMutexLocker locker(&stylesheetMutex);
+	auto it = stylesheets.constFind(QString(name));
+	if (it != stylesheets.cend())
+		return *it;
+
+	TraceSpan span("get_stylesheet");
 	xsltSetLoaderFunc(get_stylesheet_doc);
 
 	// get main document:
@@ -336,6 +352,7 @@ extern "C" xsltStylesheetPtr get_stylesheet(const char *name)
 		return NULL;
 	}
 
+	stylesheets.insert(QString(name), xslt);
 	return xslt;
 }
 
@@ -384,34 +401,6 @@ extern "C" void copy_image_and_overwrite(const char *cfileName, const char *path
 		qDebug() << "copy of" << fileName << "to" << newName << "failed";
 }
 
-static bool lessThan(const QPair<QString, int> &a, const QPair<QString, int> &b)
-{
-	return a.second < b.second;
-}
-
-QVector<QPair<QString, int>> selectedDivesGasUsed()
-{
-	int j;
-	QMap<QString, int> gasUsed;
-	for (dive *d: getDiveSelection()) {
-		volume_t *diveGases = get_gas_used(d);
-		for (j = 0; j < d->cylinders.nr; j++) {
-			if (diveGases[j].mliter) {
-				QString gasName = gasname(get_cylinder(d, j)->gasmix);
-				gasUsed[gasName] += diveGases[j].mliter;
-			}
-		}
-		free(diveGases);
-	}
-	QVector<QPair<QString, int>> gasUsedOrdered;
-	gasUsedOrdered.reserve(gasUsed.size());
-	for (auto it = gasUsed.cbegin(); it != gasUsed.cend(); ++it)
-		gasUsedOrdered.append(qMakePair(it.key(), it.value()));
-	std::sort(gasUsedOrdered.begin(), gasUsedOrdered.end(), lessThan);
-
-	return gasUsedOrdered;
-}
-
 QString getUserAgent()
 {
 	QString arch;
@@ -535,14 +524,38 @@ void set_filename(const char *filename)
 	existing_filename = copy_string(filename);
 }
 
+// Like trGettext(), this assumes that the translations don't change after the first use
+const UnitNames &get_unit_names()
+{
+	static const UnitNames names = {
+		gettextFromC::tr("m"), gettextFromC::tr("ft"),
+		gettextFromC::tr("kg"), gettextFromC::tr("lbs"),
+		QStringLiteral("°") + gettextFromC::tr("C"), QStringLiteral("°") + gettextFromC::tr("F"),
+		gettextFromC::tr("bar"), gettextFromC::tr("psi"),
+		gettextFromC::tr("ℓ"), gettextFromC::tr("cuft"),
+		gettextFromC::tr("h"), gettextFromC::tr("min"), gettextFromC::tr("sec"), gettextFromC::tr("/min")
+	};
+	return names;
+}
+
+// Same as QString("%L1%2").arg(value, 0, 'f', decimals).arg(unit), without parsing the format strings
+static QString format_value(double value, int decimals, const QString &unit)
+{
+	QString res = QLocale().toString(value, 'f', decimals);
+	if (!unit.isEmpty())
+		res += unit;
+	return res;
+}
+
 QString get_depth_string(int mm, bool showunit, bool showdecimal)
 {
+	const UnitNames &names = get_unit_names();
 	if (prefs.units.length == units::METERS) {
 		double meters = mm / 1000.0;
-		return QString("%L1%2").arg(meters, 0, 'f', (showdecimal && meters < 20.0) ? 1 : 0).arg(showunit ? gettextFromC::tr("m") : QString());
+		return format_value(meters, (showdecimal && meters < 20.0) ? 1 : 0, showunit ? names.m : QString());
 	} else {
 		double feet = mm_to_feet(mm);
-		return QString("%L1%2").arg(feet, 0, 'f', 0).arg(showunit ? gettextFromC::tr("ft") : QString());
+		return format_value(feet, 0, showunit ? names.ft : QString());
 	}
 }
 
@@ -554,40 +567,38 @@ QString get_depth_string(depth_t depth, bool showunit, bool showdecimal)
 QString get_depth_unit()
 {
 	if (prefs.units.length == units::METERS)
-		return gettextFromC::tr("m");
+		return get_unit_names().m;
 	else
-		return gettextFromC::tr("ft");
+		return get_unit_names().ft;
 }
 
 QString get_weight_string(weight_t weight, bool showunit)
 {
 	QString str = weight_string(weight.grams);
-	if (get_units()->weight == units::KG) {
-		str = QString("%1%2").arg(str, showunit ? gettextFromC::tr("kg") : QString());
-	} else {
-		str = QString("%1%2").arg(str, showunit ? gettextFromC::tr("lbs") : QString());
-	}
+	if (showunit)
+		str += get_weight_unit();
 	return str;
 }
 
 QString get_weight_unit()
 {
 	if (prefs.units.weight == units::KG)
-		return gettextFromC::tr("kg");
+		return get_unit_names().kg;
 	else
-		return gettextFromC::tr("lbs");
+		return get_unit_names().lbs;
 }
 
 QString get_temperature_string(temperature_t temp, bool showunit)
 {
+	const UnitNames &names = get_unit_names();
 	if (temp.mkelvin == 0) {
 		return ""; //temperature not defined
 	} else if (prefs.units.temperature == units::CELSIUS) {
 		double celsius = mkelvin_to_C(temp.mkelvin);
-		return QString("%L1%2%3").arg(celsius, 0, 'f', 1).arg(showunit ? "°" : "").arg(showunit ? gettextFromC::tr("C") : QString());
+		return format_value(celsius, 1, showunit ? names.celsius : QString());
 	} else {
 		double fahrenheit = mkelvin_to_F(temp.mkelvin);
-		return QString("%L1%2%3").arg(fahrenheit, 0, 'f', 1).arg(showunit ? "°" : "").arg(showunit ? gettextFromC::tr("F") : QString());
+		return format_value(fahrenheit, 1, showunit ? names.fahrenheit : QString());
 	}
 }
 
@@ -601,10 +612,9 @@ QString get_temp_unit()
 
 QString get_volume_string(int mliter, bool showunit)
 {
-	const char *unit;
 	int decimals;
-	double value = get_volume_units(mliter, &decimals, &unit);
-	return QString("%L1%2").arg(value, 0, 'f', decimals).arg(showunit ? unit : "");
+	double value = get_volume_units(mliter, &decimals, NULL);
+	return format_value(value, decimals, showunit ? get_volume_unit() : QString());
 }
 
 QString get_volume_string(volume_t volume, bool showunit)
@@ -614,19 +624,21 @@ QString get_volume_string(volume_t volume, bool showunit)
 
 QString get_volume_unit()
 {
-	const char *unit;
-	(void) get_volume_units(0, NULL, &unit);
-	return QString(unit);
+	if (get_units()->volume == units::CUFT)
+		return get_unit_names().cuft;
+	else
+		return get_unit_names().liter;
 }
 
 QString get_pressure_string(pressure_t pressure, bool showunit)
 {
+	const UnitNames &names = get_unit_names();
 	if (prefs.units.pressure == units::BAR) {
 		double bar = pressure.mbar / 1000.0;
-		return QString("%L1%2").arg(bar, 0, 'f', 0).arg(showunit ? gettextFromC::tr("bar") : QString());
+		return format_value(bar, 0, showunit ? names.bar : QString());
 	} else {
 		double psi = mbar_to_PSI(pressure.mbar);
-		return QString("%L1%2").arg(psi, 0, 'f', 0).arg(showunit ? gettextFromC::tr("psi") : QString());
+		return format_value(psi, 0, showunit ? names.psi : QString());
 	}
 }
 
@@ -1027,6 +1039,13 @@ extern "C" char *get_current_date()
 	return copy_qstring(current_date);
 }
 
+// Milliseconds since an arbitrary starting point, for measuring durations
+extern "C" int64_t monotonic_msecs()
+{
+	static const QElapsedTimer timer = [] { QElapsedTimer t; t.start(); return t; }();
+	return timer.elapsed();
+}
+
 QString get_trip_string(const dive_trip *trip)
 {
 	if (!trip)
@@ -1046,14 +1065,23 @@ QString get_trip_string(const dive_trip *trip)
 		return prefix + loc.toString(localTime, "MMM yyyy") + suffix;
 }
 
-static QMutex hashOfMutex;
-static QHash<QString, QString> localFilenameOf;
-
+// Old QDataStream format of the local filename table. Only read for conversion.
+// TODO: remove in due course
 static const QString hashfile_name()
 {
 	return QString(system_default_directory()).append("/hashes");
 }
 
+static const QString localfilenames_name()
+{
+	return QString(system_default_directory()).append("/localfilenames");
+}
+
+static const QString fingerprints_name()
+{
+	return QString(system_default_directory()).append("/fingerprints");
+}
+
 static QString thumbnailDir()
 {
 	return QString(system_default_directory()) + "/thumbnails/";
@@ -1064,14 +1092,23 @@ QString thumbnailFileName(const QString &filename)
 {
 	if (filename.isEmpty())
 		return QString();
-	QCryptographicHash hash(QCryptographicHash::Sha1);
-	hash.addData(filename.toUtf8());
-	return thumbnailDir() + hash.result().toHex();
+	// Make sure that the thumbnail directory exists
+	static bool dirCreated = QDir().mkpath(thumbnailDir());
+	Q_UNUSED(dirCreated);
+	return thumbnailDir() + sha1Hash(filename.toUtf8()).toHex();
+}
+
+// The same implementation as the C code, so that all callers use the accelerated version
+QByteArray sha1Hash(const QByteArray &data)
+{
+	QByteArray res(20, Qt::Uninitialized);
+	SHA1(data.constData(), data.size(), (unsigned char *)res.data());
+	return res;
 }
 
 extern "C" char *hashfile_name_string()
 {
-	return copy_qstring(hashfile_name());
+	return copy_qstring(localfilenames_name());
 }
 
 // During a transition period, convert old thumbnail-hashes to individual files
@@ -1080,11 +1117,8 @@ static void convertThumbnails(const QHash <QString, QImage> &thumbnails)
 {
 	if (thumbnails.empty())
 		return;
-	// This is a singular occurrence, therefore translating the strings seems not worth it
-	QProgressDialog progress("Convert thumbnails...", "Abort", 0, thumbnails.size());
-	progress.setWindowModality(Qt::WindowModal);
-
-	int count = 0;
+	// The old hash file is converted on first use, possibly by a worker thread.
+	// Therefore, no progress dialog is shown.
 	for (const QString &name: thumbnails.keys()) {
 		const QImage thumbnail = thumbnails[name];
 
@@ -1106,10 +1140,6 @@ static void convertThumbnails(const QHash <QString, QImage> &thumbnails)
 		stream << type;
 		stream << thumbnail;
 		file.commit();
-
-		progress.setValue(++count);
-		if (progress.wasCanceled())
-			break;
 	}
 }
 
@@ -1122,9 +1152,21 @@ struct HashToFile {
 	}
 };
 
+static void addLocalFilename(QHash<QString, QString> &localFilenameOf, const QString &originalName, const QString &localName)
+{
+	if (originalName.isEmpty() || localName.isEmpty())
+		return;
+	// Only keep track of images where original and local names differ
+	if (originalName == localName)
+		localFilenameOf.remove(originalName);
+	else
+		localFilenameOf[originalName] = localName;
+}
+
 // During a transition period, convert the hash->localFilename into a canonicalFilename->localFilename.
 // TODO: remove this code in due course
-static void convertLocalFilename(const QHash<QString, QByteArray> &hashOf, const QHash<QByteArray, QString> &hashToLocal)
+static void convertLocalFilename(const QHash<QString, QByteArray> &hashOf, const QHash<QByteArray, QString> &hashToLocal,
+				 QHash<QString, QString> &localFilenameOf)
 {
 	// Bail out early if there is nothing to do
 	if (hashToLocal.isEmpty())
@@ -1145,16 +1187,18 @@ static void convertLocalFilename(const QHash<QString, QByteArray> &hashOf, const
 		HashToFile dummy { hash, QString() };
 		for(auto it2 = std::lower_bound(h2f.begin(), h2f.end(), dummy);
 		    it2 != h2f.end() && it2->hash == hash; ++it2) {
-			// Note that learnPictureFilename cares about all the special cases,
+			// Note that addLocalFilename cares about all the special cases,
 			// i.e. either filename being empty or both filenames being equal.
-			learnPictureFilename(it2->filename, it.value());
+			addLocalFilename(localFilenameOf, it2->filename, it.value());
 		}
 		QString canonicalFilename = canonicalFilenameByHash.value(it.key());
 	}
 }
 
-void read_hashes()
+// TODO: remove in due course
+static QHash<QString, QString> readHashfile()
 {
+	QHash<QString, QString> localFilenameOf;
 	QFile hashfile(hashfile_name());
 	if (hashfile.open(QIODevice::ReadOnly)) {
 		QDataStream stream(&hashfile);
@@ -1164,53 +1208,142 @@ void read_hashes()
 		stream >> hashOf;			// For backwards compatibility
 		QHash <QString, QImage> thumbnailCache;
 		stream >> thumbnailCache;		// For backwards compatibility
-		QMutexLocker locker(&hashOfMutex);
 		stream >> localFilenameOf;
-		locker.unlock();
 		hashfile.close();
 		convertThumbnails(thumbnailCache);
-		convertLocalFilename(hashOf, localFilenameByHash);
+		convertLocalFilename(hashOf, localFilenameByHash, localFilenameOf);
 	}
-	QMutexLocker locker(&hashOfMutex);
 	localFilenameOf.remove("");
+	return localFilenameOf;
+}
 
-	// Make sure that the thumbnail directory exists
-	QDir().mkpath(thumbnailDir());
+// Convert the old hash file if there is no local filename store yet.
+// The old file is kept for older versions of Subsurface.
+static bool importHashfile(LocalFilenameStore &store)
+{
+	if (store.exists() || !QFile::exists(hashfile_name()))
+		return false;
+	TraceSpan span("importHashfile");
+	QHash<QString, QString> localFilenameOf = readHashfile();
+	for (auto it = localFilenameOf.cbegin(); it != localFilenameOf.cend(); ++it)
+		store.learn(it.key(), it.value());
+	store.flush();
+	return true;
 }
 
-void write_hashes()
+// Function-local statics are initialized exactly once, even if the first
+// calls come from multiple threads at the same time.
+static LocalFilenameStore &localFilenames()
 {
-	QSaveFile hashfile(hashfile_name());
-	QMutexLocker locker(&hashOfMutex);
+	static LocalFilenameStore store(localfilenames_name());
+	static bool imported = importHashfile(store);
+	Q_UNUSED(imported);
+	return store;
+}
 
-	if (hashfile.open(QIODevice::WriteOnly)) {
-		QDataStream stream(&hashfile);
-		stream << QHash<QByteArray, QString>();	// Empty hash to filename - for backwards compatibility
-		stream << QHash<QString, QByteArray>(); // Empty hashes - for backwards compatibility
-		stream << QHash<QString,QImage>();	// Empty thumbnailCache - for backwards compatibility
-		stream << localFilenameOf;
-		hashfile.commit();
-	} else {
-		qWarning() << "Cannot open hashfile for writing: " << hashfile.fileName();
-	}
+// Fingerprints of the pictures, indexed by the original filename
+static LocalFilenameStore &fingerprints()
+{
+	static LocalFilenameStore store(fingerprints_name());
+	return store;
+}
+
+// Map and index the local filenames now, e.g. when the application is idle.
+// Otherwise this is done on first use.
+void read_hashes()
+{
+	localFilenames().open();
+	fingerprints().open();
+}
+
+void write_hashes()
+{
+	localFilenames().flush();
+	fingerprints().flush();
 }
 
 void learnPictureFilename(const QString &originalName, const QString &localName)
 {
 	if (originalName.isEmpty() || localName.isEmpty())
 		return;
-	QMutexLocker locker(&hashOfMutex);
 	// Only keep track of images where original and local names differ
-	if (originalName == localName)
-		localFilenameOf.remove(originalName);
-	else
-		localFilenameOf[originalName] = localName;
+	localFilenames().learn(originalName, originalName == localName ? QString() : localName);
 }
 
 QString localFilePath(const QString &originalFilename)
 {
-	QMutexLocker locker(&hashOfMutex);
-	return localFilenameOf.value(originalFilename, originalFilename);
+	QString localName = localFilenames().lookup(originalFilename);
+	return localName.isNull() ? originalFilename : localName;
+}
+
+// The file size followed by the SHA-1 of the beginning of the file. The beginning
+// of a picture or video contains its metadata and the start of the compressed data,
+// which is enough to tell any two media files apart.
+static const int fingerprintHeaderSize = 64 * 1024;
+static const int fingerprintSize = 8 + 20;
+
+QByteArray fileFingerprint(const QString &filename)
+{
+	QFile file(filename);
+	if (!file.open(QIODevice::ReadOnly))
+		return QByteArray();
+	QByteArray res(8, Qt::Uninitialized);
+	qToLittleEndian<quint64>(file.size(), (uchar *)res.data());
+	res += sha1Hash(file.read(fingerprintHeaderSize));
+	return res;
+}
+
+qint64 fingerprintFileSize(const QByteArray &fingerprint)
+{
+	if (fingerprint.size() != fingerprintSize)
+		return -1;
+	return (qint64)qFromLittleEndian<quint64>((const uchar *)fingerprint.constData());
+}
+
+// The original filenames of the pictures by fingerprint. Built from the store
+// on first use, afterwards updated when fingerprints are learned.
+static QMutex fingerprintIndexLock;
+static bool fingerprintIndexBuilt = false;
+static QMultiHash<QByteArray, QString> picturesByFingerprint;
+
+QByteArray pictureFingerprint(const QString &originalFilename)
+{
+	QByteArray res = QByteArray::fromHex(fingerprints().lookup(originalFilename).toLatin1());
+	return res.size() == fingerprintSize ? res : QByteArray();
+}
+
+void learnPictureFingerprint(const QString &originalFilename, const QByteArray &fingerprint)
+{
+	if (originalFilename.isEmpty() || fingerprint.size() != fingerprintSize)
+		return;
+	QByteArray old = pictureFingerprint(originalFilename);
+	if (old == fingerprint)
+		return;
+	fingerprints().learn(originalFilename, QString::fromLatin1(fingerprint.toHex()));
+
+	QMutexLocker locker(&fingerprintIndexLock);
+	if (!fingerprintIndexBuilt)
+		return;
+	if (!old.isEmpty())
+		picturesByFingerprint.remove(old, originalFilename);
+	// The index might have been built after the store learned the fingerprint
+	picturesByFingerprint.remove(fingerprint, originalFilename);
+	picturesByFingerprint.insert(fingerprint, originalFilename);
+}
+
+QStringList picturesWithFingerprint(const QByteArray &fingerprint)
+{
+	QMutexLocker locker(&fingerprintIndexLock);
+	if (!fingerprintIndexBuilt) {
+		TraceSpan span("picturesWithFingerprint: build index");
+		fingerprints().forEach([](const QString &originalFilename, const QString &hex) {
+			QByteArray fingerprint = QByteArray::fromHex(hex.toLatin1());
+			if (fingerprint.size() == fingerprintSize)
+				picturesByFingerprint.insert(fingerprint, originalFilename);
+		});
+		fingerprintIndexBuilt = true;
+	}
+	return picturesByFingerprint.values(fingerprint);
 }
 
 // TODO: Apparently Qt has no simple way of listing the supported video
@@ -1638,11 +1771,18 @@ extern "C" void print_qt_versions()
 	printf("%s\n", qPrintable(QStringLiteral("built with Qt Version %1, runtime from Qt Version %2").arg(QT_VERSION_STR).arg(qVersion())));
 }
 
-QMutex planLock;
+// Copying the plan excludes the deco calculations of the profile. Those only
+// read it, so that many of them can run in parallel, e.g. in the exports.
+QReadWriteLock planLock;
 
 extern "C" void lock_planner()
 {
-	planLock.lock();
+	planLock.lockForWrite();
+}
+
+extern "C" void lock_planner_shared()
+{
+	planLock.lockForRead();
 }
 
 extern "C" void unlock_planner()
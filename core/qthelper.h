@@ -34,8 +34,15 @@ QStringList stringToList(const QString &s);
 void read_hashes();
 void write_hashes();
 QString thumbnailFileName(const QString &filename);
+QByteArray sha1Hash(const QByteArray &data);
 void learnPictureFilename(const QString &originalName, const QString &localName);
 QString localFilePath(const QString &originalFilename);
+// Content fingerprints of media files, to recognize them after they were moved or renamed
+QByteArray fileFingerprint(const QString &filename);	// Empty if the file can't be read
+qint64 fingerprintFileSize(const QByteArray &fingerprint);
+QByteArray pictureFingerprint(const QString &originalFilename);	// Empty if unknown
+void learnPictureFingerprint(const QString &originalFilename, const QByteArray &fingerprint);
+QStringList picturesWithFingerprint(const QByteArray &fingerprint);	// Original filenames
 int getCloudURL(QString &filename);
 bool parseGpsText(const QString &gps_text, double *latitude, double *longitude);
 void init_proxy();
@@ -46,6 +53,12 @@ QStringList mediaExtensionFilters();
 QStringList imageExtensionFilters();
 QStringList videoExtensionFilters();
 char *copy_qstring(const QString &);
+// The translated names of the units. They are looked up once, since translations
+// are loaded at startup, before anything is formatted.
+struct UnitNames {
+	QString m, ft, kg, lbs, celsius, fahrenheit, bar, psi, liter, cuft, h, min, sec, perMin;
+};
+const UnitNames &get_unit_names();
 QString get_depth_string(depth_t depth, bool showunit = false, bool showdecimal = true);
 QString get_depth_string(int mm, bool showunit = false, bool showdecimal = true);
 QString get_depth_unit();
@@ -74,7 +87,7 @@ int parsePressureToMbar(const QString &text);
 int parseGasMixO2(const QString &text);
 int parseGasMixHE(const QString &text);
 QString render_seconds_to_string(int seconds);
-QString get_dive_duration_string(timestamp_t when, QString hoursText, QString minutesText, QString secondsText = gettextFromC::tr("sec"), QString separator = ":", bool isFreeDive = false);
+QString get_dive_duration_string(timestamp_t when, QString hoursText, QString minutesText, QString secondsText = get_unit_names().sec, QString separator = ":", bool isFreeDive = false);
 QString get_dive_surfint_string(timestamp_t when, QString daysText, QString hoursText, QString minutesText, QString separator = " ", int maxdays = 4);
 QString get_dive_date_string(timestamp_t when);
 QString get_first_dive_date_string();
@@ -84,7 +97,6 @@ QString get_trip_string(const dive_trip *trip);
 QString getUiLanguage();
 void initUiLanguage();
 QLocale getLocale();
-QVector<QPair<QString, int>> selectedDivesGasUsed();
 QString getUserAgent();
 QString printGPSCoords(const location_t *loc);
 std::vector<int> get_cylinder_map_for_remove(int count, int n);
@@ -150,11 +162,13 @@ const char *subsurface_user_agent();
 enum deco_mode decoMode();
 void parse_seabear_header(const char *filename, struct xml_params *params);
 char *get_current_date();
+int64_t monotonic_msecs();
 time_t get_dive_datetime_from_isostring(char *when);
 void print_qt_versions();
 void lock_planner();
+void lock_planner_shared();
 void unlock_planner();
-xsltStylesheetPtr get_stylesheet(const char *name);
+xsltStylesheetPtr get_stylesheet(const char *name);	// Compiled once and kept, don't free the result
 weight_t string_to_weight(const char *str);
 depth_t string_to_depth(const char *str);
 pressure_t string_to_pressure(const char *str);
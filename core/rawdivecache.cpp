@@ -0,0 +1,135 @@
+// SPDX-License-Identifier: GPL-2.0
+#include "rawdivecache.h"
+#include "dive.h"
+#include "divelist.h"
+#include "divesite.h"
+#include "device.h"
+#include "parallel.h"
+#include "pref.h"
+#include "qthelper.h"
+#include "trace.h"
+#include <QDataStream>
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QSaveFile>
+#include <string.h>
+#include <vector>
+
+static const quint32 rawDiveMagic = 0x53535244; // "SSRD"
+static const quint32 rawDiveVersion = 1;
+
+static QString cacheDirectory()
+{
+	return QString::fromUtf8(system_default_directory()) + "/rawdives";
+}
+
+static QString cacheFile(uint32_t deviceid, const unsigned char *fingerprint, unsigned int fsize)
+{
+	QByteArray hex = QByteArray((const char *)fingerprint, fsize).toHex();
+	return QString("%1/%2/%3").arg(cacheDirectory()).arg(deviceid, 8, 16, QChar('0')).arg(QString::fromLatin1(hex));
+}
+
+extern "C" void raw_dive_cache_store(const device_data_t *devdata, const unsigned char *fingerprint, unsigned int fsize,
+				     uint32_t diveid, const unsigned char *data, unsigned int size)
+{
+	QString filename = cacheFile(devdata->deviceid, fingerprint, fsize);
+	// The same dive always has the same data
+	if (QFile::exists(filename))
+		return;
+	QDir().mkpath(QFileInfo(filename).path());
+	QSaveFile file(filename);
+	if (!file.open(QIODevice::WriteOnly))
+		return;
+	QDataStream out(&file);
+	out << rawDiveMagic << rawDiveVersion
+	    << (quint32)dc_descriptor_get_type(devdata->descriptor) << (quint32)dc_descriptor_get_model(devdata->descriptor)
+	    << (quint32)devdata->deviceid << (quint32)diveid << (quint32)devdata->libdc_firmware
+	    << (quint32)devdata->devtime << (qint64)devdata->systime
+	    << qCompress(data, size);
+	if (out.status() != QDataStream::Ok || !file.commit())
+		SSRF_INFO("Unable to write raw dive data to %s", qPrintable(filename));
+}
+
+// The result of parsing one cached dive. Every dive gets its own
+// dive site table, because the parser may add a site for the GPS position.
+struct CachedDive {
+	QString filename;
+	struct dive *dive = nullptr;
+	struct dive_site_table sites = empty_dive_site_table;
+};
+
+static void parseCachedDive(CachedDive &cached)
+{
+	QFile file(cached.filename);
+	if (!file.open(QIODevice::ReadOnly))
+		return;
+	QDataStream in(&file);
+	quint32 magic, version, family, model, deviceid, diveid, firmware, devtime;
+	qint64 systime;
+	QByteArray compressed;
+	in >> magic >> version;
+	if (magic != rawDiveMagic || version != rawDiveVersion)
+		return;
+	in >> family >> model >> deviceid >> diveid >> firmware >> devtime >> systime >> compressed;
+	QByteArray buffer = qUncompress(compressed);
+	if (in.status() != QDataStream::Ok || buffer.isEmpty())
+		return;
+
+	device_data_t devdata;
+	memset(&devdata, 0, sizeof(devdata));
+	devdata.descriptor = get_descriptor((dc_family_t)family, model);
+	if (!devdata.descriptor)
+		return;
+	struct device_table devices;
+	if (dc_context_new(&devdata.context) == DC_STATUS_SUCCESS) {
+		devdata.vendor = dc_descriptor_get_vendor(devdata.descriptor);
+		devdata.product = dc_descriptor_get_product(devdata.descriptor);
+		QByteArray modelName = QString("%1 %2").arg(devdata.vendor, devdata.product).toUtf8();
+		devdata.deviceid = deviceid;
+		devdata.libdc_firmware = firmware;
+		devdata.devtime = devtime;
+		devdata.systime = systime;
+		devdata.raw_buffer = true;
+		devdata.sites = &cached.sites;
+		devdata.devices = &devices;
+
+		struct dive *dive = alloc_dive();
+		dive->dc.model = strdup(modelName.constData());
+		dive->dc.diveid = diveid;
+		if (libdc_buffer_parser(dive, &devdata, (unsigned char *)buffer.data(), buffer.size()) == DC_STATUS_SUCCESS)
+			cached.dive = dive;
+		else
+			free_dive(dive);
+		dc_context_free(devdata.context);
+	}
+	dc_descriptor_free(devdata.descriptor);
+}
+
+extern "C" int raw_dive_cache_reparse(struct dive_table *dives, struct dive_site_table *sites)
+{
+	TraceSpan span("raw_dive_cache_reparse");
+	std::vector<CachedDive> cached;
+	QDirIterator it(cacheDirectory(), QDir::Files, QDirIterator::Subdirectories);
+	while (it.hasNext()) {
+		cached.emplace_back();
+		cached.back().filename = it.next();
+	}
+
+	// The parsers only share the read-only global device table
+	parallel_for((int)cached.size(), [&cached](int i) { parseCachedDive(cached[i]); });
+
+	int failed = 0;
+	for (CachedDive &c: cached) {
+		if (c.dive)
+			record_dive_to_table(c.dive, dives);
+		else
+			failed++;
+		// The dive sites are moved, therefore the dives still point to them
+		for (int i = 0; i < c.sites.nr; ++i)
+			add_dive_site_to_table(c.sites.dive_sites[i], sites);
+		free(c.sites.dive_sites);
+	}
+	SSRF_INFO("Parsed %d cached dives, %d failed", (int)cached.size() - failed, failed);
+	return failed;
+}
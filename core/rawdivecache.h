@@ -0,0 +1,27 @@
+// SPDX-License-Identifier: GPL-2.0
+// Cache of the raw dive data as downloaded from the dive computers, so that
+// the dives can be parsed again after a parser fix without downloading them.
+// The dives are stored compressed, one file per dive, in a directory per
+// device next to the fingerprint cache and named by the fingerprint.
+#ifndef RAWDIVECACHE_H
+#define RAWDIVECACHE_H
+
+#include "libdivecomputer.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct dive_table;
+struct dive_site_table;
+
+extern void raw_dive_cache_store(const device_data_t *devdata, const unsigned char *fingerprint, unsigned int fsize,
+				 uint32_t diveid, const unsigned char *data, unsigned int size);
+// Parse all cached dives in parallel into the given tables, returns the number of dives that couldn't be parsed
+extern int raw_dive_cache_reparse(struct dive_table *dives, struct dive_site_table *sites);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
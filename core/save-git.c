@@ -30,11 +30,13 @@
 #include "membuffer.h"
 #include "git-access.h"
 #include "version.h"
+#include "parallel.h"
 #include "picture.h"
 #include "qthelper.h"
 #include "gettext.h"
 #include "tag.h"
 #include "subsurface-time.h"
+#include "trace.h"
 
 #define VA_BUF(b, fmt) do { va_list args; va_start(args, fmt); put_vformat(b, fmt, args); va_end(args); } while (0)
 
@@ -118,12 +120,12 @@ static void save_tags(struct membuffer *b, struct tag_entry *tags)
 	put_string(b, "\n");
 }
 
-static void save_extra_data(struct membuffer *b, struct extra_data *ed)
+static void save_extra_data(struct membuffer *b, const struct divecomputer *dc)
 {
-	while (ed) {
+	for (int i = 0; i < dc->nr_extra_data; i++) {
+		const struct extra_data *ed = &dc->extra_data[i];
 		if (ed->key && ed->value)
 			put_format(b, "keyvalue \"%s\" \"%s\"\n", ed->key ? : "", ed->value ? : "");
-		ed = ed->next;
 	}
 }
 
@@ -231,7 +233,8 @@ static void show_date(struct membuffer *b, timestamp_t when)
 
 static void show_integer(struct membuffer *b, int value, const char *pre, const char *post)
 {
-	put_format(b, " %s%d%s", pre, value, post);
+	put_string(b, " ");
+	put_int(b, pre, value, post);
 }
 
 static void show_index(struct membuffer *b, int value, const char *pre, const char *post)
@@ -249,8 +252,14 @@ static void show_index(struct membuffer *b, int value, const char *pre, const ch
 static void save_sample(struct membuffer *b, struct sample *sample, struct sample *old, int o2sensor)
 {
 	int idx;
-
-	put_format(b, "%3u:%02u", FRACTION(sample->time.seconds, 60));
+	unsigned int minutes = sample->time.seconds / 60;
+
+	/* right-align the minutes to three digits */
+	if (minutes < 10)
+		put_string(b, "  ");
+	else if (minutes < 100)
+		put_string(b, " ");
+	put_min_sec(b, "", sample->time.seconds, "");
 	put_milli(b, " ", sample->depth.mm, "m");
 	put_temperature(b, sample->temperature, " ", "°C");
 
@@ -276,7 +285,7 @@ static void save_sample(struct membuffer *b, struct sample *sample, struct sampl
 			 * mode, and "old->sensor[0]" contains that index.
 			 */
 			if (sensor != old->sensor[0]) {
-				put_format(b, " sensor=%d", sensor);
+				put_int(b, " sensor=", sensor, "");
 				old->sensor[0] = sensor;
 			}
 			continue;
@@ -284,24 +293,24 @@ static void save_sample(struct membuffer *b, struct sample *sample, struct sampl
 
 		/* The new-style format is much simpler: the sensor is always encoded */
 		put_pressure(b, p, " ", "bar");
-		put_format(b, ":%d", sensor);
+		put_int(b, ":", sensor, "");
 	}
 
 	/* the deco/ndl values are stored whenever they change */
 	if (sample->ndl.seconds != old->ndl.seconds) {
-		put_format(b, " ndl=%u:%02u", FRACTION(sample->ndl.seconds, 60));
+		put_min_sec(b, " ndl=", sample->ndl.seconds, "");
 		old->ndl = sample->ndl;
 	}
 	if (sample->tts.seconds != old->tts.seconds) {
-		put_format(b, " tts=%u:%02u", FRACTION(sample->tts.seconds, 60));
+		put_min_sec(b, " tts=", sample->tts.seconds, "");
 		old->tts = sample->tts;
 	}
 	if (sample->in_deco != old->in_deco) {
-		put_format(b, " in_deco=%d", sample->in_deco ? 1 : 0);
+		put_string(b, sample->in_deco ? " in_deco=1" : " in_deco=0");
 		old->in_deco = sample->in_deco;
 	}
 	if (sample->stoptime.seconds != old->stoptime.seconds) {
-		put_format(b, " stoptime=%u:%02u", FRACTION(sample->stoptime.seconds, 60));
+		put_min_sec(b, " stoptime=", sample->stoptime.seconds, "");
 		old->stoptime = sample->stoptime;
 	}
 
@@ -311,12 +320,12 @@ static void save_sample(struct membuffer *b, struct sample *sample, struct sampl
 	}
 
 	if (sample->cns != old->cns) {
-		put_format(b, " cns=%u%%", sample->cns);
+		put_uint(b, " cns=", sample->cns, "%");
 		old->cns = sample->cns;
 	}
 
 	if (sample->rbt.seconds != old->rbt.seconds) {
-		put_format(b, " rbt=%u:%02u", FRACTION(sample->rbt.seconds, 60));
+		put_min_sec(b, " rbt=", sample->rbt.seconds, "");
 		old->rbt.seconds = sample->rbt.seconds;
 	}
 
@@ -347,12 +356,19 @@ static void save_sample(struct membuffer *b, struct sample *sample, struct sampl
 		show_index(b, sample->bearing.degrees, "bearing=", "°");
 		old->bearing.degrees = sample->bearing.degrees;
 	}
-	put_format(b, "\n");
+	put_string(b, "\n");
 }
 
-static void save_samples(struct membuffer *b, struct dive *dive, struct divecomputer *dc)
+/*
+ * If "flush" is given, it is called whenever the buffer holds more than
+ * STREAM_CHUNK bytes and at the end, and is supposed to empty the buffer.
+ */
+#define STREAM_CHUNK (64 * 1024)
+
+static int stream_samples(struct membuffer *b, struct dive *dive, struct divecomputer *dc,
+			  int (*flush)(struct membuffer *, void *), void *data)
 {
-	int nr;
+	int nr, ret;
 	int o2sensor;
 	struct sample *s;
 	struct sample dummy = { .bearing.degrees = -1, .ndl.seconds = -1 };
@@ -369,7 +385,15 @@ static void save_samples(struct membuffer *b, struct dive *dive, struct divecomp
 	while (--nr >= 0) {
 		save_sample(b, s, &dummy, o2sensor);
 		s++;
+		if (flush && b->len >= STREAM_CHUNK && (ret = flush(b, data)) != 0)
+			return ret;
 	}
+	return flush ? flush(b, data) : 0;
+}
+
+static void save_samples(struct membuffer *b, struct dive *dive, struct divecomputer *dc)
+{
+	stream_samples(b, dive, dc, NULL, NULL);
 }
 
 static void save_one_event(struct membuffer *b, struct dive *dive, struct event *ev)
@@ -378,7 +402,7 @@ static void save_one_event(struct membuffer *b, struct dive *dive, struct event
 	show_index(b, ev->type, "type=", "");
 	show_index(b, ev->flags, "flags=", "");
 
-	if (!strcmp(ev->name,"modechange"))
+	if (ev->name_id == EVENT_NAME_MODECHANGE)
 		show_utf8(b, " divemode=", divemode_text[ev->value], "");
 	else
 		show_index(b, ev->value, "value=", "");
@@ -400,7 +424,8 @@ static void save_events(struct membuffer *b, struct dive *dive, struct event *ev
 	}
 }
 
-static void save_dc(struct membuffer *b, struct dive *dive, struct divecomputer *dc)
+/* Everything but the samples */
+static void save_dc_header(struct membuffer *b, struct dive *dive, struct divecomputer *dc)
 {
 	show_utf8(b, "model ", dc->model, "\n");
 	if (dc->last_manual_time.seconds)
@@ -424,9 +449,8 @@ static void save_dc(struct membuffer *b, struct dive *dive, struct divecomputer
 	save_salinity(b, dc);
 	put_duration(b, dc->surfacetime, "surfacetime ", "min\n");
 
-	save_extra_data(b, dc->extra_data);
+	save_extra_data(b, dc);
 	save_events(b, dive, dc->events);
-	save_samples(b, dive, dc);
 }
 
 /*
@@ -477,6 +501,8 @@ static void create_dive_buffer(struct dive *dive, struct membuffer *b)
 struct dir {
 	git_treebuilder *files;
 	struct dir *subdirs, *sibling;
+	/* If set, receives the tree id once the directory is written */
+	unsigned char *cache_id;
 	char unique, name[1];
 };
 
@@ -525,6 +551,7 @@ static struct dir *new_directory(git_repository *repo, struct dir *parent, struc
 	subdir->subdirs = NULL;
 	git_treebuilder_new(&subdir->files, repo, NULL);
 	memcpy(subdir->name, name, len);
+	subdir->cache_id = NULL;
 	subdir->unique = 0;
 	subdir->name[len] = 0;
 
@@ -604,13 +631,84 @@ static int blob_insert(git_repository *repo, struct dir *tree, struct membuffer
 	return ret;
 }
 
+/* The buffer is emptied, but keeps its memory for the next blob */
+static int write_blob(git_oid *oid, git_odb *odb, struct membuffer *b)
+{
+	int ret = git_odb_write(oid, odb, mb_cstring(b), b->len, GIT_OBJ_BLOB);
+	b->len = 0;
+	return ret;
+}
+
+/*
+ * The samples of long dives with a high sample rate make up nearly all of a
+ * divecomputer file, which can then be tens of megabytes. Such files are not
+ * formatted into one buffer, but written to the object database in pieces.
+ * The size of an object has to be known in advance, therefore the samples are
+ * formatted twice: first only to count the bytes, then to write them.
+ */
+#define STREAM_SAMPLES 20000
+
+static int count_bytes(struct membuffer *b, void *data)
+{
+	*(size_t *)data += b->len;
+	b->len = 0;
+	return 0;
+}
+
+static int write_to_stream(struct membuffer *b, void *data)
+{
+	int ret = git_odb_stream_write((git_odb_stream *)data, b->buffer, b->len);
+	b->len = 0;
+	return ret;
+}
+
+static int write_dc_blob(git_oid *oid, git_odb *odb, struct membuffer *b, struct dive *dive, struct divecomputer *dc)
+{
+	struct membuffer chunk = { 0 };
+	git_odb_stream *stream;
+	size_t size;
+	int ret;
+
+	save_dc_header(b, dive, dc);
+	if (dc->samples < STREAM_SAMPLES) {
+		save_samples(b, dive, dc);
+		return write_blob(oid, odb, b);
+	}
+
+	size = b->len;
+	stream_samples(&chunk, dive, dc, count_bytes, &size);
+	ret = git_odb_open_wstream(&stream, odb, size, GIT_OBJ_BLOB);
+	if (!ret) {
+		ret = write_to_stream(b, stream);
+		if (!ret)
+			ret = stream_samples(&chunk, dive, dc, write_to_stream, stream);
+		if (!ret)
+			ret = git_odb_stream_finalize_write(oid, stream);
+		git_odb_stream_free(stream);
+	}
+	b->len = 0;
+	free_buffer(&chunk);
+	return ret;
+}
+
 static int save_one_divecomputer(git_repository *repo, struct dir *tree, struct dive *dive, struct divecomputer *dc, int idx)
 {
 	int ret;
-	struct membuffer buf = { 0 };
+	git_odb *odb;
+	git_oid blob_id;
+	struct membuffer buf = { 0 }, name = { 0 };
 
-	save_dc(&buf, dive, dc);
-	ret = blob_insert(repo, tree, &buf, "Divecomputer%c%03u", idx ? '-' : 0, idx);
+	ret = git_repository_odb(&odb, repo);
+	if (!ret) {
+		ret = write_dc_blob(&blob_id, odb, &buf, dive, dc);
+		git_odb_free(odb);
+	}
+	free_buffer(&buf);
+	if (!ret) {
+		put_format(&name, "Divecomputer%c%03u", idx ? '-' : 0, idx);
+		ret = tree_insert(tree->files, mb_cstring(&name), 1, &blob_id, GIT_FILEMODE_BLOB);
+		free_buffer(&name);
+	}
 	if (ret)
 		report_error("divecomputer tree insert failed");
 	return ret;
@@ -650,12 +748,93 @@ static int save_pictures(git_repository *repo, struct dir *dir, struct dive *div
 	return 0;
 }
 
-static int save_one_dive(git_repository *repo, struct dir *tree, struct dive *dive, struct tm *tm, bool cached_ok)
+/*
+ * Creating the dive and divecomputer files of the dives that have to
+ * be written is where most of the time goes when saving after an edit
+ * that touched many dives. These files are independent of each other,
+ * so they are formatted and written to the object database (which is
+ * thread safe in libgit2) in parallel before the tree is built.
+ */
+struct prepared_dive {
+	bool done;
+	int ret;
+	git_oid dive_blob;
+	git_oid *dc_blobs;
+};
+
+struct prepare_dives_data {
+	git_odb *odb;
+	struct prepared_dive *dives;
+	bool select_only, cached_ok;
+};
+
+static void prepare_one_dive(int idx, void *_data)
+{
+	struct prepare_dives_data *data = _data;
+	struct prepared_dive *prepared = &data->dives[idx];
+	struct dive *dive = get_dive(idx);
+	struct membuffer buf = { 0 };
+	struct divecomputer *dc;
+	int nr = 0;
+
+	if (data->select_only && !dive->selected)
+		return;
+	if (data->cached_ok && dive_cache_is_valid(dive))
+		return;
+
+	create_dive_buffer(dive, &buf);
+	prepared->ret = write_blob(&prepared->dive_blob, data->odb, &buf);
+	for (dc = &dive->dc; dc; dc = dc->next)
+		nr++;
+	prepared->dc_blobs = malloc(nr * sizeof(git_oid));
+	nr = 0;
+	for (dc = &dive->dc; dc && !prepared->ret; dc = dc->next)
+		prepared->ret = write_dc_blob(&prepared->dc_blobs[nr++], data->odb, &buf, dive, dc);
+	free_buffer(&buf);
+	prepared->done = true;
+}
+
+static struct prepared_dive *prepare_dives(git_repository *repo, bool select_only, bool cached_ok)
+{
+	struct prepare_dives_data data;
+
+	if (!dive_table.nr || git_repository_odb(&data.odb, repo))
+		return NULL;
+	data.dives = calloc(dive_table.nr, sizeof(struct prepared_dive));
+	data.select_only = select_only;
+	data.cached_ok = cached_ok;
+	parallel_for(dive_table.nr, prepare_one_dive, &data);
+	git_odb_free(data.odb);
+	return data.dives;
+}
+
+static void free_prepared_dives(struct prepared_dive *prepared)
+{
+	if (!prepared)
+		return;
+	for (int i = 0; i < dive_table.nr; i++)
+		free(prepared[i].dc_blobs);
+	free(prepared);
+}
+
+static int oid_insert(struct dir *tree, git_oid *oid, const char *fmt, ...)
+{
+	int ret;
+	struct membuffer name = { 0 };
+
+	VA_BUF(&name, fmt);
+	ret = tree_insert(tree->files, mb_cstring(&name), 1, oid, GIT_FILEMODE_BLOB);
+	free_buffer(&name);
+	return ret;
+}
+
+static int save_one_dive(git_repository *repo, struct dir *tree, struct dive *dive, struct prepared_dive *prepared,
+			 struct tm *tm, bool cached_ok)
 {
 	struct divecomputer *dc;
 	struct membuffer buf = { 0 }, name = { 0 };
 	struct dir *subdir;
-	int ret, nr;
+	int ret, nr, i;
 
 	/* Create dive directory */
 	create_dive_name(dive, &name, tm);
@@ -676,13 +855,20 @@ static int save_one_dive(git_repository *repo, struct dir *tree, struct dive *di
 	}
 
 	subdir = new_directory(repo, tree, &name);
+	subdir->cache_id = dive->git_id;
 	subdir->unique = 1;
 	free_buffer(&name);
 
-	create_dive_buffer(dive, &buf);
 	nr = dive->number;
-	ret = blob_insert(repo, subdir, &buf,
-		"Dive%c%d", nr ? '-' : 0, nr);
+	if (prepared && prepared->done) {
+		if (prepared->ret)
+			return report_error("dive save-file tree insert failed");
+		ret = oid_insert(subdir, &prepared->dive_blob, "Dive%c%d", nr ? '-' : 0, nr);
+	} else {
+		create_dive_buffer(dive, &buf);
+		ret = blob_insert(repo, subdir, &buf,
+			"Dive%c%d", nr ? '-' : 0, nr);
+	}
 	if (ret)
 		return report_error("dive save-file tree insert failed");
 
@@ -693,8 +879,15 @@ static int save_one_dive(git_repository *repo, struct dir *tree, struct dive *di
 	 */
 	dc = &dive->dc;
 	nr = dc->next ? 1 : 0;
+	i = 0;
 	do {
-		save_one_divecomputer(repo, subdir, dive, dc, nr++);
+		if (prepared && prepared->done) {
+			if (oid_insert(subdir, &prepared->dc_blobs[i++], "Divecomputer%c%03u", nr ? '-' : 0, nr))
+				report_error("divecomputer tree insert failed");
+			nr++;
+		} else {
+			save_one_divecomputer(repo, subdir, dive, dc, nr++);
+		}
 		dc = dc->next;
 	} while (dc);
 
@@ -791,7 +984,8 @@ static void verify_shared_date(timestamp_t when, struct tm *tm)
 #define MIN_TIMESTAMP (0)
 #define MAX_TIMESTAMP (0x7fffffffffffffff)
 
-static int save_one_trip(git_repository *repo, struct dir *tree, dive_trip_t *trip, struct tm *tm, bool cached_ok)
+static int save_one_trip(git_repository *repo, struct dir *tree, dive_trip_t *trip, struct tm *tm,
+			 struct prepared_dive *prepared, bool cached_ok)
 {
 	int i;
 	struct dive *dive;
@@ -801,7 +995,25 @@ static int save_one_trip(git_repository *repo, struct dir *tree, dive_trip_t *tr
 
 	/* Create trip directory */
 	create_trip_name(trip, &name, tm);
+
+	/*
+	 * Like for dives: if neither the trip nor any of its dives
+	 * changed, reuse the whole directory
+	 */
+	if (cached_ok && trip_cache_is_valid(trip)) {
+		git_oid oid;
+		int ret;
+		git_oid_fromraw(&oid, trip->git_id);
+		ret = tree_insert(tree->files, mb_cstring(&name), 1,
+			&oid, GIT_FILEMODE_TREE);
+		free_buffer(&name);
+		if (ret)
+			return report_error("cached trip tree insert failed");
+		return 0;
+	}
+
 	subdir = new_directory(repo, tree, &name);
+	subdir->cache_id = trip->git_id;
 	subdir->unique = 1;
 	free_buffer(&name);
 
@@ -825,7 +1037,7 @@ static int save_one_trip(git_repository *repo, struct dir *tree, dive_trip_t *tr
 	/* Save each dive in the directory */
 	for_each_dive(i, dive) {
 		if (dive->divetrip == trip)
-			save_one_dive(repo, subdir, dive, tm, cached_ok);
+			save_one_dive(repo, subdir, dive, prepared ? &prepared[i] : NULL, tm, cached_ok);
 	}
 
 	return 0;
@@ -893,15 +1105,25 @@ static void save_settings(git_repository *repo, struct dir *tree)
 	blob_insert(repo, tree, &b, "00-Subsurface");
 }
 
-static void save_divesites(git_repository *repo, struct dir *tree)
+static void save_divesites(git_repository *repo, struct dir *tree, bool cached_ok)
 {
 	struct dir *subdir;
 	struct membuffer dirname = { 0 };
+
+	purge_empty_dive_sites(&dive_site_table);
+	if (cached_ok && dive_site_table_cache_is_valid(&dive_site_table)) {
+		git_oid oid;
+		git_oid_fromraw(&oid, dive_site_table.git_id);
+		if (tree_insert(tree->files, "01-Divesites", 0, &oid, GIT_FILEMODE_TREE))
+			report_error("cached dive site tree insert failed");
+		return;
+	}
+
 	put_format(&dirname, "01-Divesites");
 	subdir = new_directory(repo, tree, &dirname);
+	subdir->cache_id = dive_site_table.git_id;
 	free_buffer(&dirname);
 
-	purge_empty_dive_sites(&dive_site_table);
 	for (int i = 0; i < dive_site_table.nr; i++) {
 		struct membuffer b = { 0 };
 		struct dive_site *ds = get_dive_site(i, &dive_site_table);
@@ -1010,11 +1232,12 @@ static int create_git_tree(git_repository *repo, struct dir *root, bool select_o
 	int i;
 	struct dive *dive;
 	dive_trip_t *trip;
+	struct prepared_dive *prepared;
 
 	git_storage_update_progress(translate("gettextFromC", "Start saving data"));
 	save_settings(repo, root);
 
-	save_divesites(repo, root);
+	save_divesites(repo, root, cached_ok);
 	save_filter_presets(repo, root);
 
 	for (i = 0; i < trip_table.nr; ++i)
@@ -1022,6 +1245,7 @@ static int create_git_tree(git_repository *repo, struct dir *root, bool select_o
 
 	/* save the dives */
 	git_storage_update_progress(translate("gettextFromC", "Start saving dives"));
+	prepared = prepare_dives(repo, select_only, cached_ok);
 	for_each_dive(i, dive) {
 		struct tm tm;
 		struct dir *tree;
@@ -1048,12 +1272,13 @@ static int create_git_tree(git_repository *repo, struct dir *root, bool select_o
 			trip->saved = 1;
 
 			/* Pass that new subdirectory in for save-trip */
-			save_one_trip(repo, tree, trip, &tm, cached_ok);
+			save_one_trip(repo, tree, trip, &tm, prepared, cached_ok);
 			continue;
 		}
 
-		save_one_dive(repo, tree, dive, &tm, cached_ok);
+		save_one_dive(repo, tree, dive, prepared ? &prepared[i] : NULL, &tm, cached_ok);
 	}
+	free_prepared_dives(prepared);
 	git_storage_update_progress(translate("gettextFromC", "Done creating local cache"));
 	return 0;
 }
@@ -1270,7 +1495,19 @@ static int create_new_commit(git_repository *repo, const char *remote, const cha
 	return 0;
 }
 
-static int write_git_tree(git_repository *repo, struct dir *tree, git_oid *result)
+static void invalidate_tree_caches(void)
+{
+	int i;
+	struct dive *dive;
+
+	for_each_dive(i, dive)
+		invalidate_dive_cache(dive);
+	for (i = 0; i < trip_table.nr; ++i)
+		invalidate_trip_cache(trip_table.trips[i]);
+	invalidate_dive_site_table_cache(&dive_site_table);
+}
+
+static int write_git_tree(git_repository *repo, struct dir *tree, git_oid *result, bool update_cache)
 {
 	int ret;
 	struct dir *subdir;
@@ -1279,8 +1516,12 @@ static int write_git_tree(git_repository *repo, struct dir *tree, git_oid *resul
 	while ((subdir = tree->subdirs) != NULL) {
 		git_oid id;
 
-		if (!write_git_tree(repo, subdir, &id))
+		if (!write_git_tree(repo, subdir, &id, update_cache)) {
 			tree_insert(tree->files, subdir->name, subdir->unique, &id, GIT_FILEMODE_TREE);
+			/* The next save can reuse the directory if nothing changes */
+			if (update_cache && subdir->cache_id)
+				memcpy(subdir->cache_id, id.id, 20);
+		}
 		tree->subdirs = subdir->sibling;
 		free(subdir);
 	};
@@ -1308,6 +1549,9 @@ int do_git_save(git_repository *repo, const char *branch, const char *remote, bo
 	if (verbose)
 		SSRF_INFO("git storage: do git save\n");
 
+	/* Don't write to the repository while a previous save is still syncing it */
+	wait_for_background_sync();
+
 	if (!create_empty) // so we are actually saving the dives
 		git_storage_update_progress(translate("gettextFromC", "Preparing to save data"));
 
@@ -1320,6 +1564,7 @@ int do_git_save(git_repository *repo, const char *branch, const char *remote, bo
 	/* Start with an empty tree: no subdirectories, no files */
 	tree.name[0] = 0;
 	tree.subdirs = NULL;
+	tree.cache_id = NULL;
 	if (git_treebuilder_new(&tree.files, repo, NULL))
 		return report_error("git treebuilder failed");
 
@@ -1331,26 +1576,48 @@ int do_git_save(git_repository *repo, const char *branch, const char *remote, bo
 	if (verbose)
 		SSRF_INFO("git storage, write git tree\n");
 
-	if (write_git_tree(repo, &tree, &id))
+	/*
+	 * Partial saves write only a subset of the data, so don't
+	 * remember those tree ids for saves of the full log.
+	 */
+	if (write_git_tree(repo, &tree, &id, !select_only))
 		return report_error("git tree write failed");
 
 	/* And save the tree! */
-	if (create_new_commit(repo, remote, branch, &id, create_empty))
+	if (create_new_commit(repo, remote, branch, &id, create_empty)) {
+		/* The remembered tree ids might not be reachable from the commit we came from */
+		if (!select_only)
+			invalidate_tree_caches();
 		return report_error("creating commit failed");
+	}
 
-	/* now sync the tree with the remote server */
-	if (remote && !git_local_only)
+	/*
+	 * Now sync the tree with the remote server. The commit is an
+	 * immutable snapshot of the data, so the network part can happen
+	 * in the background while the user keeps editing.
+	 */
+	if (remote && !git_local_only) {
+		if (git_sync_in_background) {
+			start_background_sync(repo, remote, branch, url_to_remote_transport(remote));
+			return 0;
+		}
 		return sync_with_remote(repo, remote, branch, url_to_remote_transport(remote));
+	}
+	if (git_sync_in_background)
+		start_background_maintenance(repo);
 	return 0;
 }
 
 int git_save_dives(struct git_repository *repo, const char *branch, const char *remote, bool select_only)
 {
 	int ret;
+	struct trace_span span;
 
 	if (repo == dummy_git_repository)
 		return report_error("Unable to open git repository '%s'", branch);
+	span = trace_begin("git_save_dives");
 	ret = do_git_save(repo, branch, remote, select_only, false);
+	trace_end(span);
 	git_repository_free(repo);
 	free((void *)branch);
 	return ret;
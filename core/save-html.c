@@ -20,6 +20,7 @@
 
 #include <stdio.h>
 #include <string.h>
+#include <math.h>
 
 static void write_attribute(struct membuffer *b, const char *att_name, const char *value, const char *separator)
 {
@@ -176,7 +177,67 @@ static void put_cylinder_HTML(struct membuffer *b, struct dive *dive)
 }
 
 
-static void put_HTML_samples(struct membuffer *b, struct dive *dive)
+static void put_HTML_sample(struct membuffer *b, const struct sample *s, const char *separator)
+{
+	put_format(b, "%s[%d,%d,%d,%d]", separator, s->time.seconds, s->depth.mm, s->pressure[0].mbar, s->temperature.mkelvin);
+}
+
+/* Twice the area of the triangle spanned by three points of the depth profile */
+static double profile_area(double t1, double d1, double t2, double d2, double t3, double d3)
+{
+	return fabs((t1 - t3) * (d2 - d1) - (t1 - t2) * (d3 - d1));
+}
+
+/*
+ * Reduce the profile to max_samples points with the "largest triangle three buckets"
+ * algorithm: the first and the last sample are kept and of every bucket of samples
+ * in between the one spanning the largest triangle with the previously chosen sample
+ * and the average of the next bucket is kept. This preserves the shape of the profile,
+ * in particular the maximum depth and the stops.
+ */
+static void put_HTML_reduced_samples(struct membuffer *b, const struct divecomputer *dc, int max_samples)
+{
+	const struct sample *s = dc->sample;
+	int n = dc->samples, i, j, chosen = 0;
+	double every = (double)(n - 2) / (max_samples - 2);
+
+	put_HTML_sample(b, &s[0], "\"samples\":[");
+	for (i = 0; i < max_samples - 2; i++) {
+		int start = (int)(i * every) + 1, end = (int)((i + 1) * every) + 1;
+		int next_start = end, next_end = (int)((i + 2) * every) + 1;
+		double avg_t = 0, avg_d = 0, max_area = -1;
+		int best = start;
+
+		if (next_end > n)
+			next_end = n;
+		for (j = next_start; j < next_end; j++) {
+			avg_t += s[j].time.seconds;
+			avg_d += s[j].depth.mm;
+		}
+		if (next_end > next_start) {
+			avg_t /= next_end - next_start;
+			avg_d /= next_end - next_start;
+		} else {
+			avg_t = s[n - 1].time.seconds;
+			avg_d = s[n - 1].depth.mm;
+		}
+		for (j = start; j < end; j++) {
+			double area = profile_area(s[chosen].time.seconds, s[chosen].depth.mm,
+						   s[j].time.seconds, s[j].depth.mm, avg_t, avg_d);
+			if (area > max_area) {
+				max_area = area;
+				best = j;
+			}
+		}
+		put_HTML_sample(b, &s[best], ", ");
+		chosen = best;
+	}
+	put_HTML_sample(b, &s[n - 1], ", ");
+	put_string(b, "],");
+}
+
+/* A max_samples of zero exports all samples */
+static void put_HTML_samples(struct membuffer *b, struct dive *dive, int max_samples)
 {
 	int i;
 	put_format(b, "\"maxdepth\":%d,", dive->dc.maxdepth.mm);
@@ -186,9 +247,14 @@ static void put_HTML_samples(struct membuffer *b, struct dive *dive)
 	if (!dive->dc.samples)
 		return;
 
+	if (max_samples >= 3 && dive->dc.samples > max_samples) {
+		put_HTML_reduced_samples(b, &dive->dc, max_samples);
+		return;
+	}
+
 	char *separator = "\"samples\":[";
 	for (i = 0; i < dive->dc.samples; i++) {
-		put_format(b, "%s[%d,%d,%d,%d]", separator, s->time.seconds, s->depth.mm, s->pressure[0].mbar, s->temperature.mkelvin);
+		put_HTML_sample(b, s, separator);
 		separator = ", ";
 		s++;
 	}
@@ -348,7 +414,7 @@ static void put_HTML_tags(struct membuffer *b, struct dive *dive, const char *pr
 }
 
 /* if exporting list_only mode, we neglect exporting the samples, bookmarks and cylinders */
-static void write_one_dive(struct membuffer *b, struct dive *dive, const char *photos_dir, int *dive_no, bool list_only)
+static void write_one_dive(struct membuffer *b, struct dive *dive, const char *photos_dir, int *dive_no, bool list_only, int max_samples)
 {
 	put_string(b, "{");
 	put_format(b, "\"number\":%d,", *dive_no);
@@ -376,7 +442,7 @@ static void write_one_dive(struct membuffer *b, struct dive *dive, const char *p
 	if (!list_only) {
 		put_cylinder_HTML(b, dive);
 		put_weightsystem_HTML(b, dive);
-		put_HTML_samples(b, dive);
+		put_HTML_samples(b, dive, max_samples);
 		put_HTML_bookmarks(b, dive);
 		write_dive_status(b, dive);
 		if (photos_dir && strcmp(photos_dir, ""))
@@ -388,7 +454,19 @@ static void write_one_dive(struct membuffer *b, struct dive *dive, const char *p
 	(*dive_no)++;
 }
 
-static void write_no_trip(struct membuffer *b, int *dive_no, bool selected_only, const char *photos_dir, const bool list_only, char *sep)
+/*
+ * When streaming to a file, the buffer is written out after every dive, so that
+ * the output of a large log never has to be kept in memory as a whole.
+ */
+static void flush_dive(struct membuffer *b, FILE *f)
+{
+	if (f && b->len) {
+		fwrite(b->buffer, 1, b->len, f);
+		b->len = 0;
+	}
+}
+
+static void write_no_trip(struct membuffer *b, FILE *f, int *dive_no, bool selected_only, const char *photos_dir, const bool list_only, int max_samples, char *sep)
 {
 	int i;
 	struct dive *dive;
@@ -408,14 +486,15 @@ static void write_no_trip(struct membuffer *b, int *dive_no, bool selected_only,
 			}
 			put_string(b, separator);
 			separator = ", ";
-			write_one_dive(b, dive, photos_dir, dive_no, list_only);
+			write_one_dive(b, dive, photos_dir, dive_no, list_only, max_samples);
+			flush_dive(b, f);
 		}
 	}
 	if (found_sel_dive)
 		put_format(b, "]}\n\n");
 }
 
-static void write_trip(struct membuffer *b, dive_trip_t *trip, int *dive_no, bool selected_only, const char *photos_dir, const bool list_only, char *sep)
+static void write_trip(struct membuffer *b, FILE *f, dive_trip_t *trip, int *dive_no, bool selected_only, const char *photos_dir, const bool list_only, int max_samples, char *sep)
 {
 	struct dive *dive;
 	char *separator = "";
@@ -436,7 +515,8 @@ static void write_trip(struct membuffer *b, dive_trip_t *trip, int *dive_no, boo
 		}
 		put_string(b, separator);
 		separator = ", ";
-		write_one_dive(b, dive, photos_dir, dive_no, list_only);
+		write_one_dive(b, dive, photos_dir, dive_no, list_only, max_samples);
+		flush_dive(b, f);
 	}
 
 	// close the trip object if contain dives.
@@ -444,7 +524,7 @@ static void write_trip(struct membuffer *b, dive_trip_t *trip, int *dive_no, boo
 		put_format(b, "]}\n\n");
 }
 
-static void write_trips(struct membuffer *b, const char *photos_dir, bool selected_only, const bool list_only)
+static void write_trips(struct membuffer *b, FILE *f, const char *photos_dir, bool selected_only, const bool list_only, int max_samples)
 {
 	int i, dive_no = 0;
 	struct dive *dive;
@@ -464,34 +544,39 @@ static void write_trips(struct membuffer *b, const char *photos_dir, bool select
 
 		/* We haven't seen this trip before - save it and all dives */
 		trip->saved = 1;
-		write_trip(b, trip, &dive_no, selected_only, photos_dir, list_only, sep);
+		write_trip(b, f, trip, &dive_no, selected_only, photos_dir, list_only, max_samples, sep);
 	}
 
 	/*Save all remaining trips into Others*/
-	write_no_trip(b, &dive_no, selected_only, photos_dir, list_only, sep);
+	write_no_trip(b, f, &dive_no, selected_only, photos_dir, list_only, max_samples, sep);
 }
 
-void export_list(struct membuffer *b, const char *photos_dir, bool selected_only, const bool list_only)
+static void write_list(struct membuffer *b, FILE *f, const char *photos_dir, bool selected_only, const bool list_only, int max_samples)
 {
 	put_string(b, "trips=[");
-	write_trips(b, photos_dir, selected_only, list_only);
+	write_trips(b, f, photos_dir, selected_only, list_only, max_samples);
 	put_string(b, "]");
 }
 
-void export_HTML(const char *file_name, const char *photos_dir, const bool selected_only, const bool list_only)
+void export_list(struct membuffer *b, const char *photos_dir, bool selected_only, const bool list_only)
+{
+	write_list(b, NULL, photos_dir, selected_only, list_only, 0);
+}
+
+void export_HTML(const char *file_name, const char *photos_dir, const bool selected_only, const bool list_only, int max_samples)
 {
 	FILE *f;
 
 	struct membuffer buf = { 0 };
-	export_list(&buf, photos_dir, selected_only, list_only);
 
 	f = subsurface_fopen(file_name, "w+");
 	if (!f) {
 		report_error(translate("gettextFromC", "Can't open file %s"), file_name);
-	} else {
-		flush_buffer(&buf, f); /*check for writing errors? */
-		fclose(f);
+		return;
 	}
+	write_list(&buf, f, photos_dir, selected_only, list_only, max_samples);
+	flush_buffer(&buf, f); /*check for writing errors? */
+	fclose(f);
 	free_buffer(&buf);
 }
 
@@ -1,12 +1,17 @@
 #include "core/profile.h"
 #include "core/display.h"
+#include "core/divelist.h"
 #include "core/errorhelper.h"
 #include "core/file.h"
 #include "core/membuffer.h"
 #include "core/subsurface-string.h"
 #include "core/save-profiledata.h"
 #include "core/version.h"
+#include "core/parallel.h"
 #include <errno.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
 
 static void put_int(struct membuffer *b, int val)
 {
@@ -56,9 +61,9 @@ static void put_pd(struct membuffer *b, const struct plot_info *pi, int idx)
 	put_int(b, entry->depth);
 	put_int(b, entry->ceiling);
 	for (int i = 0; i < 16; i++)
-		put_int(b, entry->ceilings[i]);
+		put_int(b, get_plot_tissue_ceiling(pi, idx, i));
 	for (int i = 0; i < 16; i++)
-		put_int(b, entry->percentages[i]);
+		put_int(b, get_plot_tissue_percentage(pi, idx, i));
 	put_int(b, entry->ndl);
 	put_int(b, entry->tts);
 	put_int(b, entry->rbt);
@@ -202,25 +207,256 @@ static void put_st_event(struct membuffer *b, struct plot_data *entry, int offse
 	put_format(b, "\n");
 }
 
-static void save_profiles_buffer(struct membuffer *b, bool select_only)
-{
-	int i;
+/*
+ * The plot info of the dives is calculated in parallel, each dive
+ * into its own plot_info. For the CSV export, the dives are also
+ * formatted into their own membuffer by the worker.
+ */
+struct profile_job {
 	struct dive *dive;
 	struct plot_info pi;
+	struct membuffer buf;
+};
+
+struct profile_jobs {
+	int nr;
+	struct profile_job *jobs;
+	bool csv;
+};
+
+static void calculate_one_profile(int idx, void *data)
+{
+	struct profile_jobs *pj = data;
+	struct profile_job *job = &pj->jobs[idx];
 	struct deco_state *planner_deco_state = NULL;
 
-	init_plot_info(&pi);
+	init_plot_info(&job->pi);
+	create_plot_info_new(job->dive, &job->dive->dc, &job->pi, false, planner_deco_state);
+	if (!pj->csv)
+		return;
+	put_headers(&job->buf, job->pi.nr_cylinders);
+	for (int i = 0; i < job->pi.nr; i++)
+		put_pd(&job->buf, &job->pi, i);
+	put_format(&job->buf, "\n");
+	free_plot_info_data(&job->pi);
+}
+
+static void calculate_profiles(struct profile_jobs *pj, bool select_only, bool csv)
+{
+	int i;
+	struct dive *dive;
+
+	pj->nr = 0;
+	pj->csv = csv;
+	pj->jobs = calloc(dive_table.nr, sizeof(*pj->jobs));
+	if (!pj->jobs)
+		return;
 	for_each_dive(i, dive) {
 		if (select_only && !dive->selected)
 			continue;
-		create_plot_info_new(dive, &dive->dc, &pi, false, planner_deco_state);
-		put_headers(b, pi.nr_cylinders);
+		pj->jobs[pj->nr++].dive = dive;
+	}
+	parallel_for(pj->nr, calculate_one_profile, pj);
+}
+
+static void free_profiles(struct profile_jobs *pj)
+{
+	for (int i = 0; i < pj->nr; i++) {
+		free_plot_info_data(&pj->jobs[i].pi);
+		free_buffer(&pj->jobs[i].buf);
+	}
+	free(pj->jobs);
+}
+
+static void save_profiles_buffer(struct membuffer *b, bool select_only)
+{
+	struct profile_jobs pj;
+
+	calculate_profiles(&pj, select_only, true);
+	for (int i = 0; i < pj.nr; i++)
+		put_bytes(b, pj.jobs[i].buf.buffer, pj.jobs[i].buf.len);
+	free_profiles(&pj);
+}
+
+/*
+ * The columns of the binary export, in the same order as the CSV export.
+ * The cylinder pressures come right after "sec", two per cylinder.
+ */
+static const char *column_names[] = {
+	"temperature", "depth", "ceiling",
+	"ceiling_0", "ceiling_1", "ceiling_2", "ceiling_3", "ceiling_4", "ceiling_5", "ceiling_6", "ceiling_7",
+	"ceiling_8", "ceiling_9", "ceiling_10", "ceiling_11", "ceiling_12", "ceiling_13", "ceiling_14", "ceiling_15",
+	"percentage_0", "percentage_1", "percentage_2", "percentage_3", "percentage_4", "percentage_5", "percentage_6", "percentage_7",
+	"percentage_8", "percentage_9", "percentage_10", "percentage_11", "percentage_12", "percentage_13", "percentage_14", "percentage_15",
+	"ndl", "tts", "rbt", "stoptime", "stopdepth", "cns", "smoothed", "sac", "running_sum",
+	"pressureo2", "pressuren2", "pressurehe", "o2pressure", "o2sensor0", "o2sensor1", "o2sensor2",
+	"o2setpoint", "scr_oc_po2", "mod", "ead", "end", "eadd", "velocity", "speed", "in_deco_calc",
+	"ndl_calc", "tts_calc", "stoptime_calc", "stopdepth_calc", "pressure_time", "heartbeat", "bearing",
+	"ambpressure", "gfline", "surface_gf", "density", "icd_warning"
+};
+
+#define NR_FIXED_COLUMNS (int)(sizeof(column_names) / sizeof(column_names[0]))
+
+/* The value of a column that is not a cylinder pressure, col indexes column_names */
+static double get_column_value(const struct plot_info *pi, int idx, int col)
+{
+	const struct plot_data *entry = pi->entry + idx;
+
+	if (col >= 3 && col < 19)
+		return get_plot_tissue_ceiling(pi, idx, col - 3);
+	if (col >= 19 && col < 35)
+		return get_plot_tissue_percentage(pi, idx, col - 19);
+	switch (col) {
+	case 0: return entry->temperature;
+	case 1: return entry->depth;
+	case 2: return entry->ceiling;
+	case 35: return entry->ndl;
+	case 36: return entry->tts;
+	case 37: return entry->rbt;
+	case 38: return entry->stoptime;
+	case 39: return entry->stopdepth;
+	case 40: return entry->cns;
+	case 41: return entry->smoothed;
+	case 42: return entry->sac;
+	case 43: return entry->running_sum;
+	case 44: return entry->pressures.o2;
+	case 45: return entry->pressures.n2;
+	case 46: return entry->pressures.he;
+	case 47: return entry->o2pressure.mbar;
+	case 48: return entry->o2sensor[0].mbar;
+	case 49: return entry->o2sensor[1].mbar;
+	case 50: return entry->o2sensor[2].mbar;
+	case 51: return entry->o2setpoint.mbar;
+	case 52: return entry->scr_OC_pO2.mbar;
+	case 53: return entry->mod;
+	case 54: return entry->ead;
+	case 55: return entry->end;
+	case 56: return entry->eadd;
+	case 57: return entry->velocity;
+	case 58: return entry->speed;
+	case 59: return entry->in_deco_calc;
+	case 60: return entry->ndl_calc;
+	case 61: return entry->tts_calc;
+	case 62: return entry->stoptime_calc;
+	case 63: return entry->stopdepth_calc;
+	case 64: return entry->pressure_time;
+	case 65: return entry->heartbeat;
+	case 66: return entry->bearing;
+	case 67: return entry->ambpressure;
+	case 68: return entry->gfline;
+	case 69: return entry->surface_gf;
+	case 70: return entry->density;
+	case 71: return entry->icd_warning ? 1 : 0;
+	}
+	return 0;
+}
 
-		for (int i = 0; i < pi.nr; i++)
-			put_pd(b, &pi, i);
-		put_format(b, "\n");
-		free_plot_info_data(&pi);
+static void put_le32(struct membuffer *b, uint32_t val)
+{
+	unsigned char bytes[4];
+	for (int i = 0; i < 4; i++)
+		bytes[i] = (val >> (8 * i)) & 0xff;
+	put_bytes(b, (const char *)bytes, 4);
+}
+
+static void put_le_double(struct membuffer *b, double val)
+{
+	unsigned char bytes[8];
+	uint64_t bits;
+	memcpy(&bits, &val, sizeof(bits));
+	for (int i = 0; i < 8; i++)
+		bytes[i] = (bits >> (8 * i)) & 0xff;
+	put_bytes(b, (const char *)bytes, 8);
+}
+
+static void put_column_name(struct membuffer *b, const char *name)
+{
+	put_le32(b, strlen(name));
+	put_string(b, name);
+}
+
+/* Write one column of all dives and flush it, so that only one column is kept in the buffer */
+static void put_column(struct membuffer *b, FILE *f, const struct profile_jobs *pj, int col, int cylinder, bool interpolated)
+{
+	for (int i = 0; i < pj->nr; i++) {
+		const struct plot_info *pi = &pj->jobs[i].pi;
+		for (int idx = 0; idx < pi->nr; idx++) {
+			double val;
+			if (col == -2)
+				val = pi->entry[idx].in_deco;
+			else if (col == -1)
+				val = pi->entry[idx].sec;
+			else if (cylinder >= 0)
+				val = cylinder >= pi->nr_cylinders ? 0 :
+				      interpolated ? get_plot_interpolated_pressure(pi, idx, cylinder) :
+						     get_plot_sensor_pressure(pi, idx, cylinder);
+			else
+				val = get_column_value(pi, idx, col);
+			put_le_double(b, val);
+		}
 	}
+	flush_buffer(b, f);
+}
+
+int save_profiledata_columns(const char *filename, bool select_only)
+{
+	struct membuffer buf = { 0 };
+	struct profile_jobs pj;
+	char name[64];
+	FILE *f;
+	int error, nr_cylinders = 0, nr_rows = 0;
+
+	f = subsurface_fopen(filename, "wb");
+	if (!f) {
+		report_error("Save failed (%s)", strerror(errno));
+		return -1;
+	}
+	calculate_profiles(&pj, select_only, false);
+	for (int i = 0; i < pj.nr; i++) {
+		nr_cylinders = MAX(nr_cylinders, pj.jobs[i].pi.nr_cylinders);
+		nr_rows += pj.jobs[i].pi.nr;
+	}
+
+	put_string(&buf, "SSPD");
+	put_le32(&buf, 1);
+	put_le32(&buf, pj.nr);
+	put_le32(&buf, nr_rows);
+	put_le32(&buf, 2 + 2 * nr_cylinders + NR_FIXED_COLUMNS);
+	for (int i = 0, row = 0; i < pj.nr; i++) {
+		put_le32(&buf, pj.jobs[i].dive->number);
+		put_le32(&buf, row);
+		row += pj.jobs[i].pi.nr;
+	}
+	put_le32(&buf, nr_rows);
+
+	put_column_name(&buf, "in_deco");
+	put_column_name(&buf, "sec");
+	for (int c = 0; c < nr_cylinders; c++) {
+		snprintf(name, sizeof(name), "pressure_%d_cylinder", c);
+		put_column_name(&buf, name);
+		snprintf(name, sizeof(name), "pressure_%d_interpolated", c);
+		put_column_name(&buf, name);
+	}
+	for (int col = 0; col < NR_FIXED_COLUMNS; col++)
+		put_column_name(&buf, column_names[col]);
+	flush_buffer(&buf, f);
+
+	put_column(&buf, f, &pj, -2, -1, false);
+	put_column(&buf, f, &pj, -1, -1, false);
+	for (int c = 0; c < nr_cylinders; c++) {
+		put_column(&buf, f, &pj, 0, c, false);
+		put_column(&buf, f, &pj, 0, c, true);
+	}
+	for (int col = 0; col < NR_FIXED_COLUMNS; col++)
+		put_column(&buf, f, &pj, col, -1, false);
+
+	free_profiles(&pj);
+	free_buffer(&buf);
+	error = ferror(f);
+	error |= fclose(f);
+	if (error)
+		report_error("Save failed (%s)", strerror(errno));
+	return error;
 }
 
 void save_subtitles_buffer(struct membuffer *b, struct dive *dive, int offset, int length)
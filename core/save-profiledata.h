@@ -7,6 +7,19 @@ extern "C" {
 #endif
 
 int save_profiledata(const char *filename, bool selected_only);
+
+/*
+ * Save the same data as save_profiledata() in a binary column format. All
+ * integers are little-endian uint32, all values are little-endian IEEE 754
+ * doubles (integer fields are exact, the velocity is its enum value):
+ *	"SSPD", version (1), number of dives, number of rows, number of columns
+ *	for every dive: its number and the index of its first row
+ *	the number of rows again, so that dive i ends before the start of dive i + 1
+ *	for every column: the length of its name and the name, not terminated
+ *	for every column: its values of all rows
+ * Dives with fewer cylinders than the most of all dives get 0 pressures.
+ */
+int save_profiledata_columns(const char *filename, bool selected_only);
 void save_subtitles_buffer(struct membuffer *b, struct dive *dive, int offset, int length);
 
 #ifdef __cplusplus
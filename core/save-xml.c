@@ -26,12 +26,14 @@
 #include "event.h"
 #include "file.h"
 #include "membuffer.h"
+#include "parallel.h"
 #include "picture.h"
 #include "strndup.h"
 #include "git-access.h"
 #include "qthelper.h"
 #include "gettext.h"
 #include "tag.h"
+#include "trace.h"
 #include "xmlparams.h"
 
 /*
@@ -228,7 +230,8 @@ static void save_weightsystem_info(struct membuffer *b, struct dive *dive)
 
 static void show_integer(struct membuffer *b, int value, const char *pre, const char *post)
 {
-	put_format(b, " %s%d%s", pre, value, post);
+	put_string(b, " ");
+	put_int(b, pre, value, post);
 }
 
 static void show_index(struct membuffer *b, int value, const char *pre, const char *post)
@@ -241,7 +244,7 @@ static void save_sample(struct membuffer *b, struct sample *sample, struct sampl
 {
 	int idx;
 
-	put_format(b, "  <sample time='%u:%02u min'", FRACTION(sample->time.seconds, 60));
+	put_min_sec(b, "  <sample time='", sample->time.seconds, " min'");
 	put_milli(b, " depth='", sample->depth.mm, " m'");
 	if (sample->temperature.mkelvin && sample->temperature.mkelvin != old->temperature.mkelvin) {
 		put_temperature(b, sample->temperature, " temp='", " C'");
@@ -267,36 +270,36 @@ static void save_sample(struct membuffer *b, struct sample *sample, struct sampl
 			}
 			put_pressure(b, p, " pressure='", " bar'");
 			if (sensor != old->sensor[0]) {
-				put_format(b, " sensor='%d'", sensor);
+				put_int(b, " sensor='", sensor, "'");
 				old->sensor[0] = sensor;
 			}
 			continue;
 		}
 
 		/* The new-style format is much simpler: the sensor is always encoded */
-		put_format(b, " pressure%d=", sensor);
+		put_int(b, " pressure", sensor, "=");
 		put_pressure(b, p, "'", " bar'");
 	}
 
 	/* the deco/ndl values are stored whenever they change */
 	if (sample->ndl.seconds != old->ndl.seconds) {
-		put_format(b, " ndl='%u:%02u min'", FRACTION(sample->ndl.seconds, 60));
+		put_min_sec(b, " ndl='", sample->ndl.seconds, " min'");
 		old->ndl = sample->ndl;
 	}
 	if (sample->tts.seconds != old->tts.seconds) {
-		put_format(b, " tts='%u:%02u min'", FRACTION(sample->tts.seconds, 60));
+		put_min_sec(b, " tts='", sample->tts.seconds, " min'");
 		old->tts = sample->tts;
 	}
 	if (sample->rbt.seconds != old->rbt.seconds) {
-		put_format(b, " rbt='%u:%02u min'", FRACTION(sample->rbt.seconds, 60));
+		put_min_sec(b, " rbt='", sample->rbt.seconds, " min'");
 		old->rbt = sample->rbt;
 	}
 	if (sample->in_deco != old->in_deco) {
-		put_format(b, " in_deco='%d'", sample->in_deco ? 1 : 0);
+		put_string(b, sample->in_deco ? " in_deco='1'" : " in_deco='0'");
 		old->in_deco = sample->in_deco;
 	}
 	if (sample->stoptime.seconds != old->stoptime.seconds) {
-		put_format(b, " stoptime='%u:%02u min'", FRACTION(sample->stoptime.seconds, 60));
+		put_min_sec(b, " stoptime='", sample->stoptime.seconds, " min'");
 		old->stoptime = sample->stoptime;
 	}
 
@@ -306,7 +309,7 @@ static void save_sample(struct membuffer *b, struct sample *sample, struct sampl
 	}
 
 	if (sample->cns != old->cns) {
-		put_format(b, " cns='%u%%'", sample->cns);
+		put_uint(b, " cns='", sample->cns, "%'");
 		old->cns = sample->cns;
 	}
 
@@ -337,7 +340,7 @@ static void save_sample(struct membuffer *b, struct sample *sample, struct sampl
 		show_index(b, sample->bearing.degrees, "bearing='", "'");
 		old->bearing.degrees = sample->bearing.degrees;
 	}
-	put_format(b, " />\n");
+	put_string(b, " />\n");
 }
 
 static void save_one_event(struct membuffer *b, struct dive *dive, struct event *ev)
@@ -345,7 +348,7 @@ static void save_one_event(struct membuffer *b, struct dive *dive, struct event
 	put_format(b, "  <event time='%d:%02d min'", FRACTION(ev->time.seconds, 60));
 	show_index(b, ev->type, "type='", "'");
 	show_index(b, ev->flags, "flags='", "'");
-	if (!strcmp(ev->name,"modechange"))
+	if (ev->name_id == EVENT_NAME_MODECHANGE)
 		show_utf8(b, divemode_text[ev->value], " divemode='", "'",1);
 	else
 		show_index(b, ev->value, "value='", "'");
@@ -383,16 +386,16 @@ static void save_tags(struct membuffer *b, struct tag_entry *entry)
 	}
 }
 
-static void save_extra_data(struct membuffer *b, struct extra_data *ed)
+static void save_extra_data(struct membuffer *b, const struct divecomputer *dc)
 {
-	while (ed) {
+	for (int i = 0; i < dc->nr_extra_data; i++) {
+		const struct extra_data *ed = &dc->extra_data[i];
 		if (ed->key && ed->value) {
 			put_string(b, "  <extradata");
 			show_utf8(b, ed->key, " key='", "'", 1);
 			show_utf8(b, ed->value, " value='", "'", 1);
 			put_string(b, " />\n");
 		}
-		ed = ed->next;
 	}
 }
 
@@ -458,7 +461,7 @@ static void save_dc(struct membuffer *b, struct dive *dive, struct divecomputer
 	save_airpressure(b, dc);
 	save_salinity(b, dc);
 	put_duration(b, dc->surfacetime, "  <surfacetime>", " min</surfacetime>\n");
-	save_extra_data(b, dc->extra_data);
+	save_extra_data(b, dc);
 	save_events(b, dive, dc->events);
 	save_samples(b, dive, dc);
 
@@ -553,7 +556,36 @@ int save_dive(FILE *f, struct dive *dive, bool anonymize)
 	return 0;
 }
 
-static void save_trip(struct membuffer *b, dive_trip_t *trip, bool anonymize)
+/*
+ * Formatting the dives is where most of the time goes, and the dives
+ * are independent of each other. So they are formatted in parallel,
+ * each into its own membuffer, which are then copied into the output
+ * in order.
+ */
+struct dive_buffers {
+	struct membuffer *buffers;
+	bool select_only;
+	bool anonymize;
+};
+
+static void format_one_dive(int idx, void *data)
+{
+	struct dive_buffers *db = data;
+	struct dive *dive = get_dive(idx);
+
+	if (db->select_only && !dive->selected)
+		return;
+	save_one_dive_to_mb(&db->buffers[idx], dive, db->anonymize);
+}
+
+static void put_dive_buffer(struct membuffer *b, struct membuffer *dive_buffer)
+{
+	if (dive_buffer->len)
+		put_bytes(b, dive_buffer->buffer, dive_buffer->len);
+	free_buffer(dive_buffer);
+}
+
+static void save_trip(struct membuffer *b, dive_trip_t *trip, struct membuffer *dive_buffers)
 {
 	int i;
 	struct dive *dive;
@@ -572,7 +604,7 @@ static void save_trip(struct membuffer *b, dive_trip_t *trip, bool anonymize)
 	 */
 	for_each_dive(i, dive) {
 		if (dive->divetrip == trip)
-			save_one_dive_to_mb(b, dive, anonymize);
+			put_dive_buffer(b, &dive_buffers[i]);
 	}
 
 	put_format(b, "</trip>\n");
@@ -670,6 +702,8 @@ static void save_dives_buffer(struct membuffer *b, bool select_only, bool anonym
 	int i;
 	struct dive *dive;
 	dive_trip_t *trip;
+	struct dive_buffers db;
+	size_t size;
 
 	put_format(b, "<divelog program='subsurface' version='%d'>\n<settings>\n", DATAFORMAT_VERSION);
 
@@ -721,19 +755,29 @@ static void save_dives_buffer(struct membuffer *b, bool select_only, bool anonym
 	save_filter_presets(b);
 
 	/* save the dives */
+	db.buffers = calloc(dive_table.nr, sizeof(struct membuffer));
+	db.select_only = select_only;
+	db.anonymize = anonymize;
+	parallel_for(dive_table.nr, format_one_dive, &db);
+
+	size = b->len;
+	for (i = 0; i < dive_table.nr; i++)
+		size += db.buffers[i].len;
+	make_room(b, size - b->len);
+
 	for_each_dive(i, dive) {
 		if (select_only) {
 
 			if (!dive->selected)
 				continue;
-			save_one_dive_to_mb(b, dive, anonymize);
+			put_dive_buffer(b, &db.buffers[i]);
 
 		} else {
 			trip = dive->divetrip;
 
 			/* Bare dive without a trip? */
 			if (!trip) {
-				save_one_dive_to_mb(b, dive, anonymize);
+				put_dive_buffer(b, &db.buffers[i]);
 				continue;
 			}
 
@@ -743,9 +787,10 @@ static void save_dives_buffer(struct membuffer *b, bool select_only, bool anonym
 
 			/* We haven't seen this trip before - save it and all dives */
 			trip->saved = 1;
-			save_trip(b, trip, anonymize);
+			save_trip(b, trip, db.buffers);
 		}
 	}
+	free(db.buffers);
 	put_format(b, "</dives>\n</divelog>\n");
 }
 
@@ -813,11 +858,13 @@ int save_dives_logic(const char *filename, const bool select_only, bool anonymiz
 	void *git;
 	const char *branch, *remote;
 	int error = 0;
+	struct trace_span span;
 
 	git = is_git_repository(filename, &branch, &remote, false);
 	if (git)
 		return git_save_dives(git, branch, remote, select_only);
 
+	span = trace_begin("save_dives");
 	save_dives_buffer(&buf, select_only, anonymize);
 
 	if (same_string(filename, "-")) {
@@ -835,6 +882,7 @@ int save_dives_logic(const char *filename, const bool select_only, bool anonymiz
 		report_error(translate("gettextFromC", "Failed to save dives to %s (%s)"), filename, strerror(errno));
 
 	free_buffer(&buf);
+	trace_end(span);
 	return error;
 }
 
@@ -886,16 +934,16 @@ static int export_dives_xslt_doit(const char *filename, struct xml_params *param
 	transformed = xsltApplyStylesheet(xslt, doc, xml_params_get(params));
 	xmlFreeDoc(doc);
 
-	/* Write the transformed export to file */
-	f = subsurface_fopen(filename, "w");
+	/* Write the transformed export to file, "-" is standard output */
+	f = same_string(filename, "-") ? stdout : subsurface_fopen(filename, "w");
 	if (f) {
 		xsltSaveResultToFile(f, transformed, xslt);
-		fclose(f);
+		if (f != stdout)
+			fclose(f);
 		/* Check write errors? */
 	} else {
 		res = report_error("Failed to open %s for writing (%s)", filename, strerror(errno));
 	}
-	xsltFreeStylesheet(xslt);
 	xmlFreeDoc(transformed);
 
 	return res;
@@ -7,6 +7,7 @@
 #include "subsurface-qt/divelistnotifier.h"
 
 #include <QVector>
+#include <algorithm>
 
 int amount_selected;
 static int amount_trips_selected;
@@ -166,6 +167,11 @@ void setSelection(const std::vector<dive *> &selection, dive *currentDive)
 	for (int i = 0; i < trip_table.nr; ++i)
 		trip_table.trips[i]->selected = false;
 
+	// Sort the selected dives by address, so that they can be searched
+	// in logarithmic time. Otherwise, selecting all dives is quadratic.
+	std::vector<dive *> sortedSelection = selection;
+	std::sort(sortedSelection.begin(), sortedSelection.end());
+
 	// TODO: We might want to keep track of selected dives in a more efficient way!
 	int i;
 	dive *d;
@@ -179,8 +185,7 @@ void setSelection(const std::vector<dive *> &selection, dive *currentDive)
 		}
 
 		// Search the dive in the list of selected dives.
-		// TODO: By sorting the list in the same way as the backend, this could be made more efficient.
-		bool newState = std::find(selection.begin(), selection.end(), d) != selection.end();
+		bool newState = std::binary_search(sortedSelection.begin(), sortedSelection.end(), d);
 
 		if (newState) {
 			++amount_selected;
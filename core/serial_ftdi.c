@@ -25,7 +25,6 @@
 #include <stdlib.h> // malloc, free
 #include <string.h>     // strerror
 #include <errno.h>      // errno
-#include <sys/time.h>   // gettimeofday
 #include <stdio.h>
 
 #include <libusb.h>
@@ -54,6 +53,14 @@
 
 #define VID 0x0403 // Vendor ID of FTDI
 
+/*
+ * The chip sends the received bytes when its buffer is full, or when the
+ * latency timer expires. The default of 16ms delays every short answer of
+ * a request/response protocol, which is what most dive computers use, so
+ * use the shortest latency. Big transfers fill the buffer anyway.
+ */
+#define LATENCY_TIMER 1 // ms
+
 typedef struct ftdi_serial_t {
 	/* Library context. */
 	dc_context_t *context;
@@ -104,16 +111,16 @@ static dc_status_t serial_ftdi_get_transmitted (ftdi_serial_t *device)
 }
 
 /*
- * Get an msec value on some random base
+ * Get an msec value on some random base, which doesn't jump with the wall clock
  */
 static unsigned int serial_ftdi_get_msec(void)
 {
 #ifdef _WIN32
 	return GetTickCount();
 #else
-	struct timeval tv;
-	gettimeofday(&tv, NULL);
-	return tv.tv_sec * 1000 + tv.tv_usec / 1000;
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
 #endif
 }
 
@@ -235,6 +242,10 @@ static dc_status_t serial_ftdi_open (void **io, dc_context_t *context)
 		return DC_STATUS_IO;
 	}
 
+	// Not fatal, the transfers are only slower
+	if (ftdi_set_latency_timer(ftdi_ctx, LATENCY_TIMER))
+		INFO (context, "Unable to set the latency timer: %s", ftdi_get_error_string(ftdi_ctx));
+
 	device->ftdi_ctx = ftdi_ctx;
 
 	*io = device;
@@ -414,11 +425,12 @@ static dc_status_t serial_ftdi_read (void *io, void *data, size_t size, size_t *
 			ERROR (device->context, "%s", ftdi_get_error_string(device->ftdi_ctx));
 			return DC_STATUS_IO; //Error during read call.
 		} else if (n == 0) {
+			// No need to sleep: without data, the USB transfer only
+			// returns when the latency timer of the chip expires.
 			if (serial_ftdi_get_msec() - start_time > timeout) {
 				ERROR(device->context, "%s", "FTDI read timed out.");
 				return DC_STATUS_TIMEOUT;
 			}
-			serial_ftdi_sleep (device, 1);
 		}
 
 		nbytes += n;
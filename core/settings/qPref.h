@@ -12,6 +12,9 @@ public:
 	static void load() { loadSync(false); }
 	static void sync() { loadSync(true); }
 
+	// Changes are written to disk in the background, this writes them now
+	static void flush();
+
 	// Register QML
 	static void registerQML(QQmlEngine *engine);
 
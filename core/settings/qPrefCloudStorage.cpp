@@ -14,6 +14,7 @@ void qPrefCloudStorage::loadSync(bool doSync)
 {
 	disk_cloud_auto_sync(doSync);
 	disk_cloud_base_url(doSync);
+	disk_cloud_metered_connection(doSync);
 	disk_cloud_storage_email(doSync);
 	disk_cloud_storage_email_encoded(doSync);
 	disk_cloud_storage_password(doSync);
@@ -48,6 +49,8 @@ void qPrefCloudStorage::disk_cloud_base_url(bool doSync)
 	}
 }
 
+HANDLE_PREFERENCE_BOOL(CloudStorage, "cloud_metered_connection", cloud_metered_connection);
+
 HANDLE_PREFERENCE_TXT(CloudStorage, "email", cloud_storage_email);
 
 HANDLE_PREFERENCE_TXT(CloudStorage, "email_encoded", cloud_storage_email_encoded);
@@ -10,6 +10,7 @@ class qPrefCloudStorage : public QObject {
 	Q_PROPERTY(bool cloud_auto_sync READ cloud_auto_sync WRITE set_cloud_auto_sync NOTIFY cloud_auto_syncChanged)
 	Q_PROPERTY(QString cloud_base_url READ cloud_base_url WRITE set_cloud_base_url NOTIFY cloud_base_urlChanged)
 	Q_PROPERTY(QString cloud_git_url READ cloud_git_url)
+	Q_PROPERTY(bool cloud_metered_connection READ cloud_metered_connection WRITE set_cloud_metered_connection NOTIFY cloud_metered_connectionChanged)
 	Q_PROPERTY(QString cloud_storage_email READ cloud_storage_email WRITE set_cloud_storage_email NOTIFY cloud_storage_emailChanged)
 	Q_PROPERTY(QString cloud_storage_email_encoded READ cloud_storage_email_encoded WRITE set_cloud_storage_email_encoded NOTIFY cloud_storage_email_encodedChanged)
 	Q_PROPERTY(QString cloud_storage_password READ cloud_storage_password WRITE set_cloud_storage_password NOTIFY cloud_storage_passwordChanged)
@@ -44,6 +45,7 @@ public:
 	static bool cloud_auto_sync() { return prefs.cloud_auto_sync; }
 	static QString cloud_base_url() { return prefs.cloud_base_url; }
 	static QString cloud_git_url() { return prefs.cloud_git_url; }
+	static bool cloud_metered_connection() { return prefs.cloud_metered_connection; }
 	static QString cloud_storage_email() { return prefs.cloud_storage_email; }
 	static QString cloud_storage_email_encoded() { return prefs.cloud_storage_email_encoded; }
 	static QString cloud_storage_password() { return prefs.cloud_storage_password; }
@@ -59,6 +61,7 @@ public:
 public slots:
 	static void set_cloud_auto_sync(bool value);
 	static void set_cloud_base_url(const QString &value);
+	static void set_cloud_metered_connection(bool value);
 	static void set_cloud_storage_email(const QString &value);
 	static void set_cloud_storage_email_encoded(const QString &value);
 	static void set_cloud_storage_password(const QString &value);
@@ -74,6 +77,7 @@ public slots:
 signals:
 	void cloud_auto_syncChanged(bool value);
 	void cloud_base_urlChanged(const QString &value);
+	void cloud_metered_connectionChanged(bool value);
 	void cloud_storage_emailChanged(const QString &value);
 	void cloud_storage_email_encodedChanged(const QString &value);
 	void cloud_storage_passwordChanged(const QString &value);
@@ -92,6 +96,7 @@ private:
 	// functions to load/sync variable with disk
 	static void disk_cloud_auto_sync(bool doSync);
 	static void disk_cloud_base_url(bool doSync);
+	static void disk_cloud_metered_connection(bool doSync);
 	static void disk_cloud_storage_email(bool doSync);
 	static void disk_cloud_storage_email_encoded(bool doSync);
 	static void disk_cloud_storage_password(bool doSync);
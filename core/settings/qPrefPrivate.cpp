@@ -1,8 +1,73 @@
 // SPDX-License-Identifier: GPL-2.0
 #include "qPrefPrivate.h"
 #include "core/subsurface-string.h"
+#include "core/trace.h"
 
+#include <QCoreApplication>
+#include <QHash>
+#include <QMutex>
 #include <QSettings>
+#include <QThread>
+#include <QTimer>
+
+// Every QSettings object writes its changes to disk, or to the registry on Windows,
+// when it is destroyed. Therefore, all settings are read in one pass on first access
+// and changes, e.g. while dragging a slider, are collected and written together
+// once no setting changed for a second, or at exit.
+static QMutex settingsMutex;
+static bool settingsLoaded = false;
+static QHash<QString, QVariant> settingsCache;
+static QHash<QString, QVariant> pendingSettings;	// an invalid value removes the key
+static QTimer *flushTimer = nullptr;
+
+static void loadSettings()
+{
+	if (settingsLoaded)
+		return;
+	settingsLoaded = true;
+	TraceSpan span("qPref load settings");
+	QSettings s;
+	for (const QString &key: s.allKeys())
+		settingsCache.insert(key, s.value(key));
+}
+
+static void writePendingSettings()
+{
+	if (pendingSettings.isEmpty())
+		return;
+	QSettings s;
+	for (auto it = pendingSettings.cbegin(); it != pendingSettings.cend(); ++it) {
+		if (it.value().isValid())
+			s.setValue(it.key(), it.value());
+		else
+			s.remove(it.key());
+	}
+	pendingSettings.clear();
+}
+
+static void scheduleFlush()
+{
+	// Without an event loop in this thread, write right away
+	QCoreApplication *app = QCoreApplication::instance();
+	if (!app || QThread::currentThread() != app->thread()) {
+		writePendingSettings();
+		return;
+	}
+	if (!flushTimer) {
+		flushTimer = new QTimer(app);
+		flushTimer->setSingleShot(true);
+		flushTimer->setInterval(1000);
+		QObject::connect(flushTimer, &QTimer::timeout, &qPref::flush);
+		qAddPostRoutine(&qPref::flush);
+	}
+	flushTimer->start();
+}
+
+void qPref::flush()
+{
+	QMutexLocker locker(&settingsMutex);
+	writePendingSettings();
+}
 
 void qPrefPrivate::copy_txt(const char **name, const QString &string)
 {
@@ -18,21 +83,27 @@ QString keyFromGroupAndName(QString group, QString name)
 
 void qPrefPrivate::propSetValue(const QString &key, const QVariant &value, const QVariant &defaultValue)
 {
-	QSettings s;
 	bool isDefault = false;
 	if (value.isValid() && value.type() == QVariant::Double)
 		isDefault = IS_FP_SAME(value.toDouble(), defaultValue.toDouble());
 	else
 		isDefault = (value == defaultValue);
 
-	if (!isDefault)
-		s.setValue(key, value);
-	else
-		s.remove(key);
+	QMutexLocker locker(&settingsMutex);
+	loadSettings();
+	if (!isDefault) {
+		settingsCache.insert(key, value);
+		pendingSettings.insert(key, value);
+	} else {
+		settingsCache.remove(key);
+		pendingSettings.insert(key, QVariant());
+	}
+	scheduleFlush();
 }
 
 QVariant qPrefPrivate::propValue(const QString &key, const QVariant &defaultValue)
 {
-	QSettings s;
-	return  s.value(key, defaultValue);
+	QMutexLocker locker(&settingsMutex);
+	loadSettings();
+	return settingsCache.value(key, defaultValue);
 }
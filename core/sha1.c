@@ -240,6 +240,184 @@ static void blk_SHA1_Block(blk_SHA_CTX *ctx, const void *block)
 	ctx->H[4] += E;
 }
 
+/*
+ * The SHA extensions of x86 and the crypto extensions of ARMv8 compress a block
+ * several times faster than the code above. On x86, they are detected at run time,
+ * the functions are compiled for them with a target attribute, so that the rest
+ * of the program doesn't depend on them. On ARM, they are used when the compiler
+ * targets them anyway, which is the case for all 64-bit Apple devices.
+ */
+#if defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__))
+
+#include <cpuid.h>
+#include <immintrin.h>
+#define SHA1_ACCEL
+
+/* Rounds 4*g to 4*g+3, W[g & 3] holds the words of these rounds */
+#define SHA_NI_MSG(g) \
+	(W[(g) & 3] = _mm_sha1msg2_epu32(_mm_xor_si128(_mm_sha1msg1_epu32(W[(g) & 3], W[((g) + 1) & 3]), W[((g) + 2) & 3]), W[((g) + 3) & 3]))
+#define SHA_NI_ROUNDS(g)                                             \
+	do {                                                         \
+		E = _mm_sha1nexte_epu32(PREV, W[(g) & 3]);           \
+		PREV = ABCD;                                         \
+		ABCD = _mm_sha1rnds4_epu32(ABCD, E, (g) / 5);        \
+	} while (0)
+#define SHA_NI_ROUNDS_MIX(g)      \
+	do {                      \
+		SHA_NI_MSG(g);    \
+		SHA_NI_ROUNDS(g); \
+	} while (0)
+
+__attribute__((target("sha,sse4.1")))
+static void sha1_blocks_accel(blk_SHA_CTX *ctx, const unsigned char *data, unsigned long blocks)
+{
+	const __m128i swap = _mm_set_epi64x(0x0001020304050607ULL, 0x08090a0b0c0d0e0fULL);
+	__m128i ABCD, ABCD_SAVE, E, E_SAVE, PREV, W[4];
+	int t;
+
+	/* The registers hold A in the highest lane */
+	ABCD = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i *)ctx->H), 0x1b);
+	E_SAVE = _mm_set_epi32(ctx->H[4], 0, 0, 0);
+
+	for (; blocks; blocks--, data += 64) {
+		ABCD_SAVE = ABCD;
+		for (t = 0; t < 4; t++)
+			W[t] = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(data + t * 16)), swap);
+
+		E = _mm_add_epi32(E_SAVE, W[0]);
+		PREV = ABCD;
+		ABCD = _mm_sha1rnds4_epu32(ABCD, E, 0);
+		SHA_NI_ROUNDS(1);
+		SHA_NI_ROUNDS(2);
+		SHA_NI_ROUNDS(3);
+		SHA_NI_ROUNDS_MIX(4);
+		SHA_NI_ROUNDS_MIX(5);
+		SHA_NI_ROUNDS_MIX(6);
+		SHA_NI_ROUNDS_MIX(7);
+		SHA_NI_ROUNDS_MIX(8);
+		SHA_NI_ROUNDS_MIX(9);
+		SHA_NI_ROUNDS_MIX(10);
+		SHA_NI_ROUNDS_MIX(11);
+		SHA_NI_ROUNDS_MIX(12);
+		SHA_NI_ROUNDS_MIX(13);
+		SHA_NI_ROUNDS_MIX(14);
+		SHA_NI_ROUNDS_MIX(15);
+		SHA_NI_ROUNDS_MIX(16);
+		SHA_NI_ROUNDS_MIX(17);
+		SHA_NI_ROUNDS_MIX(18);
+		SHA_NI_ROUNDS_MIX(19);
+
+		/* E of the result is A of the state before the last four rounds, rotated */
+		E_SAVE = _mm_sha1nexte_epu32(PREV, E_SAVE);
+		ABCD = _mm_add_epi32(ABCD, ABCD_SAVE);
+	}
+
+	_mm_storeu_si128((__m128i *)ctx->H, _mm_shuffle_epi32(ABCD, 0x1b));
+	ctx->H[4] = _mm_extract_epi32(E_SAVE, 3);
+}
+
+static int sha1_have_accel(void)
+{
+	/*
+	 * Detected on first use. Threads hashing at the same time store the
+	 * same value, so this doesn't need any locking.
+	 */
+	static int have_accel = -1;
+	unsigned int eax, ebx, ecx, edx;
+
+	if (have_accel < 0) {
+		int sse41 = __get_cpuid(1, &eax, &ebx, &ecx, &edx) && (ecx & bit_SSE4_1) && (ecx & bit_SSSE3);
+		int sha = __get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx) && (ebx & (1 << 29));
+		have_accel = sse41 && sha;
+	}
+	return have_accel;
+}
+
+#elif defined(__aarch64__) && (defined(__ARM_FEATURE_CRYPTO) || defined(__ARM_FEATURE_SHA2))
+
+#include <arm_neon.h>
+#define SHA1_ACCEL
+
+#define SHA_ARM_MSG(g) \
+	(W[(g) & 3] = vsha1su1q_u32(vsha1su0q_u32(W[(g) & 3], W[((g) + 1) & 3], W[((g) + 2) & 3]), W[((g) + 3) & 3]))
+#define SHA_ARM_ROUNDS(g, fn, k)                                   \
+	do {                                                       \
+		uint32x4_t TMP = vaddq_u32(W[(g) & 3], vdupq_n_u32(k)); \
+		uint32_t E_NEXT = vsha1h_u32(vgetq_lane_u32(ABCD, 0)); \
+		ABCD = fn(ABCD, E, TMP);                           \
+		E = E_NEXT;                                        \
+	} while (0)
+#define SHA_ARM_ROUNDS_MIX(g, fn, k)   \
+	do {                           \
+		SHA_ARM_MSG(g);        \
+		SHA_ARM_ROUNDS(g, fn, k); \
+	} while (0)
+
+static void sha1_blocks_accel(blk_SHA_CTX *ctx, const unsigned char *data, unsigned long blocks)
+{
+	uint32x4_t ABCD, ABCD_SAVE, W[4];
+	uint32_t E, E_SAVE;
+	int t;
+
+	ABCD = vld1q_u32(ctx->H);
+	E = ctx->H[4];
+
+	for (; blocks; blocks--, data += 64) {
+		ABCD_SAVE = ABCD;
+		E_SAVE = E;
+		for (t = 0; t < 4; t++)
+			W[t] = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(data + t * 16)));
+
+		SHA_ARM_ROUNDS(0, vsha1cq_u32, 0x5a827999);
+		SHA_ARM_ROUNDS(1, vsha1cq_u32, 0x5a827999);
+		SHA_ARM_ROUNDS(2, vsha1cq_u32, 0x5a827999);
+		SHA_ARM_ROUNDS(3, vsha1cq_u32, 0x5a827999);
+		SHA_ARM_ROUNDS_MIX(4, vsha1cq_u32, 0x5a827999);
+		SHA_ARM_ROUNDS_MIX(5, vsha1pq_u32, 0x6ed9eba1);
+		SHA_ARM_ROUNDS_MIX(6, vsha1pq_u32, 0x6ed9eba1);
+		SHA_ARM_ROUNDS_MIX(7, vsha1pq_u32, 0x6ed9eba1);
+		SHA_ARM_ROUNDS_MIX(8, vsha1pq_u32, 0x6ed9eba1);
+		SHA_ARM_ROUNDS_MIX(9, vsha1pq_u32, 0x6ed9eba1);
+		SHA_ARM_ROUNDS_MIX(10, vsha1mq_u32, 0x8f1bbcdc);
+		SHA_ARM_ROUNDS_MIX(11, vsha1mq_u32, 0x8f1bbcdc);
+		SHA_ARM_ROUNDS_MIX(12, vsha1mq_u32, 0x8f1bbcdc);
+		SHA_ARM_ROUNDS_MIX(13, vsha1mq_u32, 0x8f1bbcdc);
+		SHA_ARM_ROUNDS_MIX(14, vsha1mq_u32, 0x8f1bbcdc);
+		SHA_ARM_ROUNDS_MIX(15, vsha1pq_u32, 0xca62c1d6);
+		SHA_ARM_ROUNDS_MIX(16, vsha1pq_u32, 0xca62c1d6);
+		SHA_ARM_ROUNDS_MIX(17, vsha1pq_u32, 0xca62c1d6);
+		SHA_ARM_ROUNDS_MIX(18, vsha1pq_u32, 0xca62c1d6);
+		SHA_ARM_ROUNDS_MIX(19, vsha1pq_u32, 0xca62c1d6);
+
+		ABCD = vaddq_u32(ABCD, ABCD_SAVE);
+		E += E_SAVE;
+	}
+
+	vst1q_u32(ctx->H, ABCD);
+	ctx->H[4] = E;
+}
+
+static int sha1_have_accel(void)
+{
+	return 1;
+}
+
+#endif
+
+static void blk_SHA1_Blocks(blk_SHA_CTX *ctx, const void *data, unsigned long blocks)
+{
+#ifdef SHA1_ACCEL
+	if (sha1_have_accel()) {
+		sha1_blocks_accel(ctx, data, blocks);
+		return;
+	}
+#endif
+	for (; blocks; blocks--) {
+		blk_SHA1_Block(ctx, data);
+		data = ((const char *)data + 64);
+	}
+}
+
 void blk_SHA1_Init(blk_SHA_CTX *ctx)
 {
 	ctx->size = 0;
@@ -269,12 +447,12 @@ void blk_SHA1_Update(blk_SHA_CTX *ctx, const void *data, unsigned long len)
 		data = ((const char *)data + left);
 		if (lenW)
 			return;
-		blk_SHA1_Block(ctx, ctx->W);
+		blk_SHA1_Blocks(ctx, ctx->W, 1);
 	}
-	while (len >= 64) {
-		blk_SHA1_Block(ctx, data);
-		data = ((const char *)data + 64);
-		len -= 64;
+	if (len >= 64) {
+		blk_SHA1_Blocks(ctx, data, len / 64);
+		data = ((const char *)data + (len & ~63UL));
+		len &= 63;
 	}
 	if (len)
 		memcpy(ctx->W, data, len);
@@ -21,68 +21,132 @@
 #include <string.h>
 #include <ctype.h>
 
-static void process_temperatures(struct dive *dp, stats_t *stats)
+/* The values of a dive that enter into its statistics */
+struct stats_contribution {
+	int id;
+	int32_t duration;
+	int32_t maxdepth;
+	int32_t meandepth;
+	int sac;
+	uint32_t mintemp;
+	uint32_t maxtemp;
+};
+
+static struct stats_contribution get_contribution(const struct dive *dive)
 {
-	temperature_t min_temp, mean_temp, max_temp = {.mkelvin = 0};
+	struct stats_contribution c;
+
+	memset(&c, 0, sizeof(c)); /* these are compared with memcmp() */
+	c.id = dive->id;
+	c.duration = dive->duration.seconds;
+	c.maxdepth = dive->maxdepth.mm;
+	c.meandepth = dive->meandepth.mm;
+	c.sac = dive->sac;
+	c.mintemp = dive->mintemp.mkelvin;
+	c.maxtemp = dive->maxtemp.mkelvin;
+	return c;
+}
 
-	max_temp.mkelvin = dp->maxtemp.mkelvin;
-	if (max_temp.mkelvin && (!stats->max_temp.mkelvin || max_temp.mkelvin > stats->max_temp.mkelvin))
-		stats->max_temp.mkelvin = max_temp.mkelvin;
+static bool sac_is_valid(const struct stats_contribution *c)
+{
+	/* Maybe we should drop zero-duration dives.
+	 * Less than .1 l/min is bogus, even with a pSCR */
+	return c->duration && c->sac > 100;
+}
 
-	min_temp.mkelvin = dp->mintemp.mkelvin;
-	if (min_temp.mkelvin && (!stats->min_temp.mkelvin || min_temp.mkelvin < stats->min_temp.mkelvin))
-		stats->min_temp.mkelvin = min_temp.mkelvin;
+static uint32_t mean_temp(const struct stats_contribution *c)
+{
+	if (!c->mintemp)
+		return c->maxtemp;
+	return (c->mintemp + c->maxtemp) / 2;
+}
 
-	if (min_temp.mkelvin || max_temp.mkelvin) {
-		mean_temp.mkelvin = min_temp.mkelvin;
-		if (mean_temp.mkelvin)
-			mean_temp.mkelvin = (mean_temp.mkelvin + max_temp.mkelvin) / 2;
-		else
-			mean_temp.mkelvin = max_temp.mkelvin;
-		stats->combined_temp.mkelvin += mean_temp.mkelvin;
+static void update_averages(stats_t *stats)
+{
+	stats->avg_depth.mm = stats->total_average_depth_time.seconds ?
+		lrint((double)stats->depth_time_sum / stats->total_average_depth_time.seconds) : 0;
+	stats->avg_sac.mliter = stats->total_sac_time.seconds ?
+		lrint((double)stats->sac_time_sum / stats->total_sac_time.seconds) : 0;
+}
+
+static void add_extrema(const struct stats_contribution *c, stats_t *stats)
+{
+	if (c->duration > stats->longest_time.seconds)
+		stats->longest_time.seconds = c->duration;
+	if (stats->shortest_time.seconds == 0 || c->duration < stats->shortest_time.seconds)
+		stats->shortest_time.seconds = c->duration;
+	if (c->maxdepth > stats->max_depth.mm)
+		stats->max_depth.mm = c->maxdepth;
+	if (stats->min_depth.mm == 0 || c->maxdepth < stats->min_depth.mm)
+		stats->min_depth.mm = c->maxdepth;
+	if (c->maxtemp && (!stats->max_temp.mkelvin || c->maxtemp > stats->max_temp.mkelvin))
+		stats->max_temp.mkelvin = c->maxtemp;
+	if (c->mintemp && (!stats->min_temp.mkelvin || c->mintemp < stats->min_temp.mkelvin))
+		stats->min_temp.mkelvin = c->mintemp;
+	if (sac_is_valid(c)) {
+		if (c->sac > stats->max_sac.mliter)
+			stats->max_sac.mliter = c->sac;
+		if (stats->min_sac.mliter == 0 || c->sac < stats->min_sac.mliter)
+			stats->min_sac.mliter = c->sac;
+	}
+}
+
+static void add_contribution(const struct stats_contribution *c, stats_t *stats)
+{
+	stats->total_time.seconds += c->duration;
+	stats->combined_max_depth.mm += c->maxdepth;
+	if (c->mintemp || c->maxtemp) {
+		stats->combined_temp.mkelvin += mean_temp(c);
 		stats->combined_count++;
 	}
+	if (c->duration && c->meandepth) {
+		stats->total_average_depth_time.seconds += c->duration;
+		stats->depth_time_sum += (int64_t)c->duration * c->meandepth;
+	}
+	if (sac_is_valid(c)) {
+		stats->total_sac_time.seconds += c->duration;
+		stats->sac_time_sum += (int64_t)c->duration * c->sac;
+	}
+	add_extrema(c, stats);
+	update_averages(stats);
 }
 
-static void process_dive(struct dive *dive, stats_t *stats)
+/*
+ * The inverse of add_contribution(). Minima and maxima can't be
+ * removed incrementally: returns true if the dive defined one of
+ * them, in which case the caller has to recalculate them.
+ */
+static bool remove_contribution(const struct stats_contribution *c, stats_t *stats)
 {
-	int old_tadt, sac_time = 0;
-	int32_t duration = dive->duration.seconds;
-
-	old_tadt = stats->total_average_depth_time.seconds;
-	stats->total_time.seconds += duration;
-	if (duration > stats->longest_time.seconds)
-		stats->longest_time.seconds = duration;
-	if (stats->shortest_time.seconds == 0 || duration < stats->shortest_time.seconds)
-		stats->shortest_time.seconds = duration;
-	if (dive->maxdepth.mm > stats->max_depth.mm)
-		stats->max_depth.mm = dive->maxdepth.mm;
-	if (stats->min_depth.mm == 0 || dive->maxdepth.mm < stats->min_depth.mm)
-		stats->min_depth.mm = dive->maxdepth.mm;
-	stats->combined_max_depth.mm += dive->maxdepth.mm;
-
-	process_temperatures(dive, stats);
-
-	/* Maybe we should drop zero-duration dives */
-	if (!duration)
-		return;
-	if (dive->meandepth.mm) {
-		stats->total_average_depth_time.seconds += duration;
-		stats->avg_depth.mm = lrint((1.0 * old_tadt * stats->avg_depth.mm +
-					duration * dive->meandepth.mm) /
-					stats->total_average_depth_time.seconds);
+	stats->total_time.seconds -= c->duration;
+	stats->combined_max_depth.mm -= c->maxdepth;
+	if (c->mintemp || c->maxtemp) {
+		stats->combined_temp.mkelvin -= mean_temp(c);
+		stats->combined_count--;
 	}
-	if (dive->sac > 100) { /* less than .1 l/min is bogus, even with a pSCR */
-		sac_time = stats->total_sac_time.seconds + duration;
-		stats->avg_sac.mliter = lrint((1.0 * stats->total_sac_time.seconds * stats->avg_sac.mliter +
-					 duration * dive->sac) /
-					 sac_time);
-		if (dive->sac > stats->max_sac.mliter)
-			stats->max_sac.mliter = dive->sac;
-		if (stats->min_sac.mliter == 0 || dive->sac < stats->min_sac.mliter)
-			stats->min_sac.mliter = dive->sac;
-		stats->total_sac_time.seconds = sac_time;
+	if (c->duration && c->meandepth) {
+		stats->total_average_depth_time.seconds -= c->duration;
+		stats->depth_time_sum -= (int64_t)c->duration * c->meandepth;
 	}
+	if (sac_is_valid(c)) {
+		stats->total_sac_time.seconds -= c->duration;
+		stats->sac_time_sum -= (int64_t)c->duration * c->sac;
+	}
+	update_averages(stats);
+
+	/* zero values are special, see recalculate_selection_extrema() */
+	return !c->duration || !c->maxdepth ||
+	       c->duration == stats->longest_time.seconds || c->duration == stats->shortest_time.seconds ||
+	       c->maxdepth == stats->max_depth.mm || c->maxdepth == stats->min_depth.mm ||
+	       (c->maxtemp && c->maxtemp == stats->max_temp.mkelvin) ||
+	       (c->mintemp && c->mintemp == stats->min_temp.mkelvin) ||
+	       (sac_is_valid(c) && (c->sac == stats->max_sac.mliter || c->sac == stats->min_sac.mliter));
+}
+
+static void process_dive(const struct dive *dive, stats_t *stats)
+{
+	struct stats_contribution c = get_contribution(dive);
+	add_contribution(&c, stats);
 }
 
 char *get_minutes(int seconds)
@@ -293,22 +357,113 @@ void init_stats_summary(struct stats_summary *stats)
 	stats->stats_by_temp = NULL;
 }
 
+/*
+ * The statistics of the selected dives are updated incrementally:
+ * dives that entered the selection or changed since the last call
+ * are added, dives that left the selection are removed. The entries
+ * are sorted by dive id, so that deleted dives are never accessed.
+ */
+static struct {
+	int nr, allocated;
+	struct stats_contribution *entries;
+	struct stats_contribution *new_entries;
+	stats_t stats;
+} selection_stats;
+
+static int comp_contribution_id(const void *_a, const void *_b)
+{
+	const struct stats_contribution *a = _a, *b = _b;
+	return a->id < b->id ? -1 : a->id > b->id ? 1 : 0;
+}
+
+static bool selected_for_stats(const struct dive *dive)
+{
+	return dive->selected && !dive->invalid;
+}
+
+/*
+ * A zero duration or depth resets the respective minimum, which makes
+ * the minima depend on the order of the dives. Therefore, the extrema
+ * are always recalculated in dive list order.
+ */
+static void recalculate_selection_extrema(stats_t *stats)
+{
+	int i;
+	struct dive *dive;
+
+	stats->longest_time.seconds = stats->shortest_time.seconds = 0;
+	stats->max_depth.mm = stats->min_depth.mm = 0;
+	stats->max_temp.mkelvin = stats->min_temp.mkelvin = 0;
+	stats->max_sac.mliter = stats->min_sac.mliter = 0;
+	for_each_dive(i, dive) {
+		if (selected_for_stats(dive)) {
+			struct stats_contribution c = get_contribution(dive);
+			add_extrema(&c, stats);
+		}
+	}
+}
+
 /* make sure we skip the selected summary entries */
 void calculate_stats_selected(stats_t *stats_selection)
 {
+	struct stats_contribution *old_entries, *new_entries;
 	struct dive *dive;
-	unsigned int i, nr;
-
-	memset(stats_selection, 0, sizeof(*stats_selection));
+	int i, j, k, nr, old_nr;
+	bool recalc_extrema = false;
+
+	if (selection_stats.allocated < dive_table.nr) {
+		struct stats_contribution *grown, *grown_new;
+		grown = realloc(selection_stats.entries, dive_table.nr * sizeof(*grown));
+		if (grown)
+			selection_stats.entries = grown;
+		grown_new = realloc(selection_stats.new_entries, dive_table.nr * sizeof(*grown_new));
+		if (grown_new)
+			selection_stats.new_entries = grown_new;
+		if (!grown || !grown_new) {
+			memset(stats_selection, 0, sizeof(*stats_selection));
+			return;
+		}
+		selection_stats.allocated = dive_table.nr;
+	}
+	old_entries = selection_stats.entries;
+	new_entries = selection_stats.new_entries;
+	old_nr = selection_stats.nr;
 
 	nr = 0;
 	for_each_dive(i, dive) {
-		if (dive->selected && !dive->invalid) {
-			process_dive(dive, stats_selection);
+		if (selected_for_stats(dive)) {
+			new_entries[nr] = get_contribution(dive);
+			if (!new_entries[nr].duration || !new_entries[nr].maxdepth)
+				recalc_extrema = true;
 			nr++;
 		}
 	}
-	stats_selection->selection_size = nr;
+	qsort(new_entries, nr, sizeof(*new_entries), comp_contribution_id);
+
+	/* merge the old and the new selection */
+	j = k = 0;
+	while (j < old_nr || k < nr) {
+		if (k >= nr || (j < old_nr && old_entries[j].id < new_entries[k].id)) {
+			recalc_extrema |= remove_contribution(&old_entries[j++], &selection_stats.stats);
+		} else if (j >= old_nr || new_entries[k].id < old_entries[j].id) {
+			add_contribution(&new_entries[k++], &selection_stats.stats);
+		} else {
+			if (memcmp(&old_entries[j], &new_entries[k], sizeof(*new_entries))) {
+				recalc_extrema |= remove_contribution(&old_entries[j], &selection_stats.stats);
+				add_contribution(&new_entries[k], &selection_stats.stats);
+			}
+			j++;
+			k++;
+		}
+	}
+	if (recalc_extrema)
+		recalculate_selection_extrema(&selection_stats.stats);
+
+	selection_stats.entries = new_entries;
+	selection_stats.new_entries = old_entries;
+	selection_stats.nr = nr;
+	selection_stats.stats.selection_size = nr;
+	*stats_selection = selection_stats.stats;
 }
 
 #define SOME_GAS 5000 // 5bar drop in cylinder pressure makes cylinder used
@@ -316,14 +471,14 @@ void calculate_stats_selected(stats_t *stats_selection)
 bool has_gaschange_event(const struct dive *dive, const struct divecomputer *dc, int idx)
 {
 	bool first_gas_explicit = false;
-	const struct event *event = get_next_event(dc->events, "gaschange");
+	const struct event *event = get_next_event(dc->events, EVENT_NAME_GASCHANGE);
 	while (event) {
 		if (dc->sample && (event->time.seconds == 0 ||
 				   (dc->samples && dc->sample[0].time.seconds == event->time.seconds)))
 			first_gas_explicit = true;
 		if (get_cylinder_index(dive, event) == idx)
 			return true;
-		event = get_next_event(event->next, "gaschange");
+		event = get_next_event(event->next, EVENT_NAME_GASCHANGE);
 	}
 	if (dc->divemode == CCR) {
 		if (idx == get_cylinder_idx_by_use(dive, DILUENT))
@@ -406,22 +561,17 @@ static void get_gas_parts(struct gasmix mix, volume_t vol, int o2_in_topup, volu
 	o2->mliter += vol.mliter - he->mliter - air.mliter;
 }
 
-void selected_dives_gas_parts(volume_t *o2_tot, volume_t *he_tot)
+/* Add the O2 and He needed to mix the gases used in the dive from air to the totals.
+ * "gases" is the result of get_gas_used() for the dive. */
+void add_dive_gas_parts(const struct dive *d, const volume_t *gases, volume_t *o2_tot, volume_t *he_tot)
 {
-	int i, j;
-	struct dive *d;
-	for_each_dive (i, d) {
-		if (!d->selected || d->invalid)
-			continue;
-		volume_t *diveGases = get_gas_used(d);
-		for (j = 0; j < d->cylinders.nr; j++) {
-			if (diveGases[j].mliter) {
-				volume_t o2 = {}, he = {};
-				get_gas_parts(get_cylinder(d, j)->gasmix, diveGases[j], O2_IN_AIR, &o2, &he);
-				o2_tot->mliter += o2.mliter;
-				he_tot->mliter += he.mliter;
-			}
+	int j;
+	for (j = 0; j < d->cylinders.nr; j++) {
+		if (gases[j].mliter) {
+			volume_t o2 = {}, he = {};
+			get_gas_parts(get_cylinder(d, j)->gasmix, gases[j], O2_IN_AIR, &o2, &he);
+			o2_tot->mliter += o2.mliter;
+			he_tot->mliter += he.mliter;
 		}
-		free(diveGases);
 	}
 }
@@ -40,6 +40,10 @@ typedef struct
 	unsigned int combined_count;
 	unsigned int selection_size;
 	duration_t total_sac_time;
+	/* exact sums of duration * mean depth and duration * sac,
+	 * from which avg_depth and avg_sac are calculated */
+	int64_t depth_time_sum;
+	int64_t sac_time_sum;
 	bool is_year;
 	bool is_trip;
 	char *location;
@@ -64,7 +68,7 @@ extern void free_stats_summary(struct stats_summary *stats);
 extern void calculate_stats_summary(struct stats_summary *stats, bool selected_only);
 extern void calculate_stats_selected(stats_t *stats_selection);
 extern volume_t *get_gas_used(struct dive *dive);
-extern void selected_dives_gas_parts(volume_t *o2_tot, volume_t *he_tot);
+extern void add_dive_gas_parts(const struct dive *d, const volume_t *gases, volume_t *o2_tot, volume_t *he_tot);
 
 #ifdef __cplusplus
 }
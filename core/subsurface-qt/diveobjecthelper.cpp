@@ -275,7 +275,7 @@ DiveObjectHelper::DiveObjectHelper(const struct dive *d) :
 	gps(d->dive_site ? printGPSCoords(&d->dive_site->location) : QString()),
 	gps_decimal(format_gps_decimal(d)),
 	dive_site(QVariant::fromValue(d->dive_site)),
-	duration(get_dive_duration_string(d->duration.seconds, gettextFromC::tr("h"), gettextFromC::tr("min"))),
+	duration(get_dive_duration_string(d->duration.seconds, get_unit_names().h, get_unit_names().min)),
 	noDive(d->duration.seconds == 0 && d->dc.duration.seconds == 0),
 	depth(get_depth_string(d->dc.maxdepth.mm, true, true)),
 	divemaster(d->divemaster ? d->divemaster : QString()),
@@ -8,6 +8,7 @@
 #include "gettext.h"
 #include "qthelper.h"
 #include "git-access.h"
+#include "trace.h"
 #include "libdivecomputer/version.h"
 
 struct preferences prefs, git_prefs;
@@ -126,6 +127,9 @@ const char *monthname(int mon)
  * track whether we switched to importing dives
  */
 bool imported = false;
+bool memory_report = false;
+/* free all data on exit instead of leaving it to the operating system, for leak checkers */
+bool full_teardown = false;
 
 void print_version()
 {
@@ -183,6 +187,9 @@ static void print_help()
 	printf("\n --verbose|-v          Verbose debug (repeat to increase verbosity)");
 	printf("\n --version             Prints current version");
 	printf("\n --user=<test>         Choose configuration space for user <test>");
+	printf("\n --trace=<file>        Write timing information in Chrome trace format to <file>");
+	printf("\n --memory-report       Print the memory used by the loaded dives");
+	printf("\n --full-teardown       Free all data on exit, for leak checkers");
 #ifdef SUBSURFACE_MOBILE_DESKTOP
 	printf("\n --testqml=<dir>       Use QML files from <dir> instead of QML resources");
 #endif
@@ -219,6 +226,18 @@ void parse_argument(const char *arg)
 					default_prefs.cloud_timeout = to;
 				return;
 			}
+			if (strncmp(arg, "--trace=", sizeof("--trace=") - 1) == 0) {
+				trace_open(arg + sizeof("--trace=") - 1);
+				return;
+			}
+			if (strcmp(arg, "--memory-report") == 0) {
+				memory_report = true;
+				return;
+			}
+			if (strcmp(arg, "--full-teardown") == 0) {
+				full_teardown = true;
+				return;
+			}
 			if (strcmp(arg, "--help") == 0) {
 				print_help();
 				exit(0);
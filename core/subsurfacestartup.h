@@ -10,6 +10,8 @@ extern "C" {
 
 extern bool imported;
 extern int quit, force_root, ignore_bt;
+extern bool memory_report;
+extern bool full_teardown;
 #ifdef SUBSURFACE_MOBILE_DESKTOP
 extern char *testqml;
 #endif
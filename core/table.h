@@ -23,39 +23,38 @@
 	}
 
 /* get the index where we want to insert an object so that everything stays
- * ordered according to a comparison function() */
+ * ordered according to a comparison function(). The table must be sorted
+ * already. The object goes after all objects that compare equal. */
 #define MAKE_GET_INSERTION_INDEX(table_type, item_type, array_name, fun)		\
 	int table_type##_get_insertion_index(struct table_type *table, item_type item)	\
 	{										\
-		/* we might want to use binary search here */				\
-		for (int i = 0; i < table->nr; i++) {					\
-			if (fun(item, table->array_name[i]))				\
-				return i;						\
+		int lo = 0, hi = table->nr;						\
+		while (lo < hi) {							\
+			int mid = lo + (hi - lo) / 2;					\
+			if (fun(item, table->array_name[mid]))				\
+				hi = mid;						\
+			else								\
+				lo = mid + 1;						\
 		}									\
-		return table->nr;							\
+		return lo;								\
 	}
 
 /* add object at the given index to a table. */
 #define MAKE_ADD_TO(table_type, item_type, array_name)					\
 	void add_to_##table_type(struct table_type *table, int idx, item_type item)	\
 	{										\
-		int i;									\
 		grow_##table_type(table);						\
+		memmove(&table->array_name[idx + 1], &table->array_name[idx],		\
+			(table->nr - idx) * sizeof(item_type));				\
+		table->array_name[idx] = item;						\
 		table->nr++;								\
-											\
-		for (i = idx; i < table->nr; i++) {					\
-			item_type tmp = table->array_name[i];				\
-			table->array_name[i] = item;					\
-			item = tmp;							\
-		}									\
 	}
 
 #define MAKE_REMOVE_FROM(table_type, array_name)						\
 	void remove_from_##table_type(struct table_type *table, int idx)			\
 	{											\
-		int i;										\
-		for (i = idx; i < table->nr - 1; i++)						\
-			table->array_name[i] = table->array_name[i + 1];			\
+		memmove(&table->array_name[idx], &table->array_name[idx + 1],			\
+			(table->nr - idx - 1) * sizeof(table->array_name[0]));			\
 		memset(&table->array_name[--table->nr], 0, sizeof(table->array_name[0]));	\
 	}
 
@@ -82,6 +81,33 @@
 		qsort(table->array_name, table->nr, sizeof(item_type), sortfn_##table_type);	\
 	}
 
+/* Merge the objects of a sorted table into another sorted table in linear
+ * time - much faster than inserting them one by one. Objects of the source
+ * go after objects of the destination that compare equal, as if inserted.
+ * The source table is empty after the call. */
+#define MAKE_MERGE_TABLE(table_type, item_type, array_name, fun)			\
+	void merge_##table_type(struct table_type *src, struct table_type *dst)		\
+	{										\
+		int i = dst->nr - 1, j = src->nr - 1, k = dst->nr + src->nr - 1;	\
+		if (dst->nr + src->nr > dst->allocated) {				\
+			int allocated = (dst->nr + src->nr + 32) * 3 / 2;		\
+			item_type *items = realloc(dst->array_name, allocated * sizeof(item_type)); \
+			if (!items)							\
+				exit(1);						\
+			dst->array_name = items;					\
+			dst->allocated = allocated;					\
+		}									\
+		/* Fill from the back, so that nothing is overwritten */		\
+		for (; j >= 0; k--) {							\
+			if (i >= 0 && fun(src->array_name[j], dst->array_name[i]))	\
+				dst->array_name[k] = dst->array_name[i--];		\
+			else								\
+				dst->array_name[k] = src->array_name[j--];		\
+		}									\
+		dst->nr += src->nr;							\
+		src->nr = 0;								\
+	}
+
 #define MAKE_REMOVE(table_type, item_type, item_name)				\
 	int remove_##item_name(const item_type item, struct table_type *table)	\
 	{									\
@@ -0,0 +1,114 @@
+// SPDX-License-Identifier: GPL-2.0
+#include "tablesnapshot.h"
+#include "divelist.h"
+#include "divesite.h"
+#include "trip.h"
+#include <QMutex>
+#include <atomic>
+#include <vector>
+#include <stdlib.h>
+#include <string.h>
+
+namespace {
+	struct Snapshot {
+		table_snapshot tables;
+		unsigned long long generation;
+		bool released;
+	};
+
+	struct DeferredFree {
+		void (*fn)(void *);
+		void *ptr;
+		unsigned long long generation;	// of the newest snapshot when it was freed
+	};
+}
+
+// The snapshots are only taken and released a few times per background job,
+// therefore a mutex is good enough for the bookkeeping. Reading the snapshots
+// and freeing objects while there are none doesn't need it.
+static QMutex lock;
+static std::vector<Snapshot *> snapshots;	// by generation, oldest first
+static std::vector<DeferredFree> deferred;
+static unsigned long long generation;
+static std::atomic<int> nrSnapshots(0);
+
+template <typename T>
+static T **copyArray(T * const *array, int nr)
+{
+	if (nr <= 0)
+		return nullptr;
+	T **res = (T **)malloc(nr * sizeof(T *));
+	memcpy(res, array, nr * sizeof(T *));
+	return res;
+}
+
+extern "C" struct table_snapshot *take_table_snapshot(void)
+{
+	Snapshot *s = new Snapshot;
+	s->tables.dives = copyArray(dive_table.dives, dive_table.nr);
+	s->tables.nr_dives = dive_table.nr;
+	s->tables.trips = copyArray(trip_table.trips, trip_table.nr);
+	s->tables.nr_trips = trip_table.nr;
+	s->tables.dive_sites = copyArray(dive_site_table.dive_sites, dive_site_table.nr);
+	s->tables.nr_dive_sites = dive_site_table.nr;
+	s->released = false;
+
+	QMutexLocker l(&lock);
+	s->generation = ++generation;
+	snapshots.push_back(s);
+	nrSnapshots = (int)snapshots.size();
+	return &s->tables;
+}
+
+extern "C" void release_table_snapshot(struct table_snapshot *snapshot)
+{
+	if (!snapshot)
+		return;
+	std::vector<Snapshot *> released;
+	std::vector<DeferredFree> ready;
+	{
+		QMutexLocker l(&lock);
+		for (Snapshot *s: snapshots) {
+			if (&s->tables == snapshot)
+				s->released = true;
+		}
+		// The objects that were freed before the oldest remaining snapshot was taken
+		// can't be part of it, nor of any later snapshot.
+		while (!snapshots.empty() && snapshots.front()->released) {
+			released.push_back(snapshots.front());
+			snapshots.erase(snapshots.begin());
+		}
+		unsigned long long oldest = snapshots.empty() ? generation + 1 : snapshots.front()->generation;
+		size_t kept = 0;
+		for (const DeferredFree &d: deferred) {
+			if (d.generation < oldest)
+				ready.push_back(d);
+			else
+				deferred[kept++] = d;
+		}
+		deferred.resize(kept);
+		nrSnapshots = (int)snapshots.size();
+	}
+
+	for (Snapshot *s: released) {
+		free(s->tables.dives);
+		free(s->tables.trips);
+		free(s->tables.dive_sites);
+		delete s;
+	}
+	for (const DeferredFree &d: ready)
+		d.fn(d.ptr);
+}
+
+extern "C" bool defer_free_for_snapshots(void (*fn)(void *), void *ptr)
+{
+	// The objects in the tables are freed on the UI thread, where the snapshots are taken.
+	// A worker that frees a copy of its own might miss a new snapshot, which can't contain the copy.
+	if (!ptr || nrSnapshots == 0)
+		return false;
+	QMutexLocker l(&lock);
+	if (snapshots.empty())
+		return false;
+	deferred.push_back({ fn, ptr, generation });
+	return true;
+}
@@ -0,0 +1,51 @@
+// SPDX-License-Identifier: GPL-2.0
+// Snapshots of the dive, trip and dive site tables for worker threads.
+// The tables are arrays that the undo commands change in place on the UI thread,
+// therefore a worker can't iterate them. A snapshot is a copy of the arrays that is
+// taken on the UI thread and handed to the worker, which iterates it without any
+// locks while the tables are edited. The dives, trips and dive sites of a snapshot
+// stay allocated until it is released: while there are snapshots, free_dive(),
+// free_trip() and free_dive_site() postpone the freeing until no snapshot that
+// was taken before is left.
+//
+// This makes the membership of the tables and the lifetime of the objects safe
+// for the workers. The contents of the objects are still edited in place, e.g.
+// an edited profile replaces the samples of the dive computer, so a worker that
+// reads them still has to copy what it needs on the UI thread or cope with edits.
+#ifndef TABLESNAPSHOT_H
+#define TABLESNAPSHOT_H
+
+#ifdef __cplusplus
+extern "C" {
+#else
+#include <stdbool.h>
+#endif
+
+struct dive;
+struct dive_trip;
+struct dive_site;
+
+struct table_snapshot {
+	struct dive **dives;		// sorted like dive_table
+	int nr_dives;
+	struct dive_trip **trips;
+	int nr_trips;
+	struct dive_site **dive_sites;
+	int nr_dive_sites;
+};
+
+// Only on the UI thread, which makes the changes to the tables
+extern struct table_snapshot *take_table_snapshot(void);
+
+// From any thread. The postponed frees that aren't needed anymore are done right away.
+extern void release_table_snapshot(struct table_snapshot *snapshot);
+
+// For the free functions of the objects in the tables: if there are snapshots,
+// remember to call fn(ptr) once they are released and return true.
+extern bool defer_free_for_snapshots(void (*fn)(void *), void *ptr);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
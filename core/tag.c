@@ -20,12 +20,10 @@ static const char *default_tags[] = {
 	QT_TRANSLATE_NOOP("gettextFromC", "deco")
 };
 
-/* copy an element in a list of tags */
+/* copy an element in a list of tags - the divetags are shared, they are owned by g_tag_list */
 static void copy_tl(struct tag_entry *st, struct tag_entry *dt)
 {
-	dt->tag = malloc(sizeof(struct divetag));
-	dt->tag->name = copy_string(st->tag->name);
-	dt->tag->source = copy_string(st->tag->source);
+	dt->tag = st->tag;
 }
 
 static bool tag_seen_before(struct tag_entry *start, struct tag_entry *before)
@@ -75,15 +73,6 @@ char *taglist_get_tagstring(struct tag_entry *tag_list)
 	return detach_cstring(&b);
 }
 
-static inline void taglist_free_divetag(struct divetag *tag)
-{
-	if (tag->name != NULL)
-		free(tag->name);
-	if (tag->source != NULL)
-		free(tag->source);
-	free(tag);
-}
-
 /* Add a tag to the tag_list, keep the list sorted */
 static struct divetag *taglist_add_divetag(struct tag_entry **tag_list, struct divetag *tag)
 {
@@ -110,13 +99,25 @@ static struct divetag *taglist_add_divetag(struct tag_entry **tag_list, struct d
 	return tag;
 }
 
+/* Find a tag by name in a sorted tag_list */
+static struct divetag *taglist_find_divetag(struct tag_entry *tag_list, const char *name)
+{
+	for (; tag_list; tag_list = tag_list->next) {
+		int cmp = strcmp(tag_list->tag->name, name);
+		if (!cmp)
+			return tag_list->tag;
+		if (cmp > 0)
+			break;
+	}
+	return NULL;
+}
+
 struct divetag *taglist_add_tag(struct tag_entry **tag_list, const char *tag)
 {
 	size_t i = 0;
 	int is_default_tag = 0;
-	struct divetag *ret_tag, *new_tag;
-	const char *translation;
-	new_tag = malloc(sizeof(struct divetag));
+	struct divetag *ret_tag;
+	const char *name = tag;
 
 	for (i = 0; i < sizeof(default_tags) / sizeof(char *); i++) {
 		if (strcmp(default_tags[i], tag) == 0) {
@@ -125,29 +126,19 @@ struct divetag *taglist_add_tag(struct tag_entry **tag_list, const char *tag)
 		}
 	}
 	/* Only translate default tags */
-	if (is_default_tag) {
-		translation = translate("gettextFromC", tag);
-		new_tag->name = malloc(strlen(translation) + 1);
-		memcpy(new_tag->name, translation, strlen(translation) + 1);
-		new_tag->source = malloc(strlen(tag) + 1);
-		memcpy(new_tag->source, tag, strlen(tag) + 1);
-	} else {
-		new_tag->source = NULL;
-		new_tag->name = malloc(strlen(tag) + 1);
-		memcpy(new_tag->name, tag, strlen(tag) + 1);
+	if (is_default_tag)
+		name = translate("gettextFromC", tag);
+
+	/* Only create a new divetag if g_tag_list doesn't contain it yet */
+	ret_tag = taglist_find_divetag(g_tag_list, name);
+	if (!ret_tag) {
+		ret_tag = malloc(sizeof(struct divetag));
+		ret_tag->name = strdup(name);
+		ret_tag->source = is_default_tag ? strdup(tag) : NULL;
+		taglist_add_divetag(&g_tag_list, ret_tag);
 	}
-	/* Try to insert new_tag into g_tag_list if we are not operating on it */
-	if (tag_list != &g_tag_list) {
-		ret_tag = taglist_add_divetag(&g_tag_list, new_tag);
-		/* g_tag_list already contains new_tag, free the duplicate */
-		if (ret_tag != new_tag)
-			taglist_free_divetag(new_tag);
+	if (tag_list != &g_tag_list)
 		ret_tag = taglist_add_divetag(tag_list, ret_tag);
-	} else {
-		ret_tag = taglist_add_divetag(tag_list, new_tag);
-		if (ret_tag != new_tag)
-			taglist_free_divetag(new_tag);
-	}
 	return ret_tag;
 }
 
@@ -0,0 +1,147 @@
+// SPDX-License-Identifier: GPL-2.0
+#include "taskqueue.h"
+#include <QRunnable>
+#include <QThread>
+#include <QThreadPool>
+#include <algorithm>
+
+CancelToken::CancelToken() : flag(std::make_shared<std::atomic<bool>>(false))
+{
+}
+
+bool CancelToken::isCancelled() const
+{
+	return *flag;
+}
+
+void CancelToken::cancel()
+{
+	*flag = true;
+}
+
+// The tasks of the I/O pool hardly use the CPU, so there are more threads
+// than cores. The number of tasks of a kind is limited by their queues.
+struct IoPool : public QThreadPool {
+	IoPool()
+	{
+		setMaxThreadCount(std::max(4 * QThread::idealThreadCount(), 16));
+	}
+};
+
+// Never destroyed: the queues of global objects still hand their tasks to it
+// when they are destroyed at exit.
+static QThreadPool *ioPool()
+{
+	static IoPool *pool = new IoPool;
+	return pool;
+}
+
+static QThreadPool *poolFor(TaskClass taskClass)
+{
+	return taskClass == TaskClass::BulkIO ? ioPool() : QThreadPool::globalInstance();
+}
+
+// Higher priorities are started first by QThreadPool
+static int priorityOf(TaskClass taskClass)
+{
+	return taskClass == TaskClass::Interactive ? 1 : 0;
+}
+
+class TaskQueueRunnable : public QRunnable {
+public:
+	TaskQueueRunnable(TaskQueue *queue, std::function<void()> task) : queue(queue), task(std::move(task))
+	{
+	}
+	void run() override
+	{
+		task();
+		task = nullptr;	// Free the captured data before the queue is told
+		queue->finished();
+	}
+private:
+	TaskQueue *queue;
+	std::function<void()> task;
+};
+
+TaskQueue::TaskQueue(TaskClass taskClass, int maxConcurrent) : taskClass(taskClass), maxConcurrent(maxConcurrent), running(0)
+{
+}
+
+TaskQueue::~TaskQueue()
+{
+	clear();
+	waitForDone();
+}
+
+void TaskQueue::setMaxConcurrent(int maxConcurrentIn)
+{
+	QMutexLocker l(&lock);
+	maxConcurrent = maxConcurrentIn;
+	dispatch();
+}
+
+int TaskQueue::limit() const
+{
+	return maxConcurrent > 0 ? maxConcurrent : std::max(poolFor(taskClass)->maxThreadCount(), 1);
+}
+
+void TaskQueue::dispatch()
+{
+	while (!tasks.empty() && running < limit()) {
+		++running;
+		poolFor(taskClass)->start(new TaskQueueRunnable(this, std::move(tasks.front())), priorityOf(taskClass));
+		tasks.pop_front();
+	}
+}
+
+void TaskQueue::finished()
+{
+	QMutexLocker l(&lock);
+	--running;
+	dispatch();
+	if (running == 0)
+		done.wakeAll();
+}
+
+void TaskQueue::run(std::function<void()> task)
+{
+	QMutexLocker l(&lock);
+	tasks.push_back(std::move(task));
+	dispatch();
+}
+
+CancelToken TaskQueue::token() const
+{
+	QMutexLocker l(&lock);
+	return currentToken;
+}
+
+void TaskQueue::clear()
+{
+	QMutexLocker l(&lock);
+	tasks.clear();
+	currentToken.cancel();
+	currentToken = CancelToken();
+}
+
+void TaskQueue::waitForDone()
+{
+	QMutexLocker l(&lock);
+	while (!tasks.empty() || running > 0) {
+		if (tasks.empty()) {
+			done.wait(&lock);
+			continue;
+		}
+		std::function<void()> task = std::move(tasks.front());
+		tasks.pop_front();
+		++running;
+		l.unlock();
+		task();
+		task = nullptr;
+		l.relock();
+		--running;
+		dispatch();
+	}
+	// Other threads might be waiting for the tasks that this thread ran
+	done.wakeAll();
+}
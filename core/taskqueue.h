@@ -0,0 +1,72 @@
+// SPDX-License-Identifier: GPL-2.0
+// Scheduling of the background work of the core. Instead of a thread pool of
+// their own, which oversubscribes the cores when several of them are busy at
+// the same time, the subsystems queue their work in a TaskQueue. A queue
+// limits how many of its tasks run at the same time and hands them to one of
+// two shared pools: computations go to the global thread pool, which is also
+// used by parallel_for(), and tasks that mostly wait for files, the network,
+// devices or other processes go to the I/O pool. In the global pool, the
+// tasks of interactive queues are started before background tasks.
+#ifndef TASKQUEUE_H
+#define TASKQUEUE_H
+
+#include <QMutex>
+#include <QWaitCondition>
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <memory>
+
+enum class TaskClass {
+	Interactive,	// the user waits for the result, e.g. the thumbnails of the shown dive
+	Background,	// computations that can wait, e.g. prefetching
+	BulkIO		// mostly waiting, e.g. for ffmpeg, the cloud server or a dive computer
+};
+
+// A flag that a queue raises when its tasks are not needed anymore.
+// Long running tasks take a copy when they are queued and check it.
+class CancelToken {
+public:
+	CancelToken();
+	bool isCancelled() const;
+	void cancel();
+private:
+	std::shared_ptr<std::atomic<bool>> flag;
+};
+
+class TaskQueue {
+public:
+	// maxConcurrent <= 0 means as many as the pool has threads
+	TaskQueue(TaskClass taskClass, int maxConcurrent = 0);
+	~TaskQueue();	// Drops the queued tasks and waits for the running ones
+	void setMaxConcurrent(int maxConcurrent);
+
+	// Queue a task. The tasks are started in the order they were queued.
+	void run(std::function<void()> task);
+
+	// The token of the tasks queued from now on until the next clear()
+	CancelToken token() const;
+
+	// Drop the tasks that haven't started yet and cancel the token of the running ones
+	void clear();
+
+	// Wait until all tasks are finished. Instead of blocking, the calling
+	// thread runs the tasks that haven't started yet itself.
+	void waitForDone();
+
+private:
+	void dispatch();	// lock must be held
+	void finished();
+	int limit() const;
+	friend class TaskQueueRunnable;
+
+	TaskClass taskClass;
+	int maxConcurrent;
+	int running;
+	std::deque<std::function<void()>> tasks;
+	CancelToken currentToken;
+	mutable QMutex lock;
+	QWaitCondition done;
+};
+
+#endif
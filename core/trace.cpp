@@ -0,0 +1,149 @@
+// SPDX-License-Identifier: GPL-2.0
+#include "trace.h"
+#include "dive.h"
+#include "file.h"
+#include "git-access.h"
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <string_view>
+#include <vector>
+
+bool trace_enabled = false;
+
+struct TraceEvent {
+	const char *name;
+	int64_t start;
+	int64_t duration;
+	int thread;
+};
+
+struct SpanStatistics {
+	int64_t count = 0;
+	int64_t total = 0;
+	int64_t max = 0;
+	int64_t last = 0;
+};
+
+static std::mutex traceMutex;
+static std::vector<TraceEvent> traceEvents;
+static std::string traceFile;
+// std::less<> allows lookup by string_view, so that recording a span doesn't allocate
+static std::map<std::string, SpanStatistics, std::less<>> spanStatistics;
+static std::map<std::string, int64_t, std::less<>> counters;
+
+// Small consecutive numbers are easier to read in the viewers than native thread ids
+static int traceThreadId()
+{
+	static std::atomic<int> nextId(1);
+	thread_local int id = nextId++;
+	return id;
+}
+
+static void writeTrace()
+{
+	FILE *f = subsurface_fopen(traceFile.c_str(), "w");
+	if (!f) {
+		fprintf(stderr, "Unable to write trace to %s\n", traceFile.c_str());
+		return;
+	}
+	std::lock_guard<std::mutex> lock(traceMutex);
+	fprintf(f, "{\"traceEvents\":[");
+	for (size_t i = 0; i < traceEvents.size(); ++i) {
+		const TraceEvent &ev = traceEvents[i];
+		fprintf(f, "%s\n{\"name\":\"%s\",\"ph\":\"X\",\"ts\":%lld,\"dur\":%lld,\"pid\":1,\"tid\":%d}",
+			i ? "," : "", ev.name, (long long)ev.start, (long long)ev.duration, ev.thread);
+	}
+	fprintf(f, "\n],\"displayTimeUnit\":\"ms\"}\n");
+	fclose(f);
+}
+
+extern "C" void trace_open(const char *filename)
+{
+	traceFile = filename;
+	if (!trace_enabled)
+		atexit(&writeTrace);
+	trace_enabled = true;
+}
+
+extern "C" void trace_close()
+{
+	if (trace_enabled)
+		writeTrace();
+}
+
+extern "C" int64_t trace_now()
+{
+	using namespace std::chrono;
+	return duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+extern "C" void trace_record(const char *name, int64_t start)
+{
+	int64_t duration = trace_now() - start;
+	std::lock_guard<std::mutex> lock(traceMutex);
+	auto it = spanStatistics.find(std::string_view(name));
+	if (it == spanStatistics.end())
+		it = spanStatistics.emplace(name, SpanStatistics()).first;
+	SpanStatistics &stats = it->second;
+	stats.count++;
+	stats.total += duration;
+	stats.last = duration;
+	if (duration > stats.max)
+		stats.max = duration;
+	if (trace_enabled)
+		traceEvents.push_back({ name, start, duration, traceThreadId() });
+}
+
+extern "C" void trace_count(const char *name, int64_t value)
+{
+	std::lock_guard<std::mutex> lock(traceMutex);
+	auto it = counters.find(std::string_view(name));
+	if (it == counters.end())
+		counters.emplace(name, value);
+	else
+		it->second += value;
+}
+
+extern "C" int64_t trace_counter(const char *name)
+{
+	std::lock_guard<std::mutex> lock(traceMutex);
+	auto it = counters.find(std::string_view(name));
+	return it != counters.end() ? it->second : 0;
+}
+
+static void appendFormat(std::string &s, const char *fmt, ...)
+{
+	char buf[256];
+	va_list args;
+	va_start(args, fmt);
+	vsnprintf(buf, sizeof(buf), fmt, args);
+	va_end(args);
+	s += buf;
+}
+
+extern "C" char *trace_statistics()
+{
+	const struct git_sync_stats &sync = git_sync_stats_total;
+	std::string res;
+
+	appendFormat(res, "dives loaded: %d\n", dive_table.nr);
+	appendFormat(res, "cloud sync: received %lu bytes, sent %lu bytes, fetch %d ms, merge %d ms, checkout %d ms, push %d ms\n",
+		     (unsigned long)sync.bytes_received, (unsigned long)sync.bytes_sent,
+		     sync.fetch_msecs, sync.merge_msecs, sync.checkout_msecs, sync.push_msecs);
+
+	std::lock_guard<std::mutex> lock(traceMutex);
+	for (const auto &[name, stats]: spanStatistics) {
+		appendFormat(res, "%s: %lld calls, total %.1f ms, max %.1f ms, last %.1f ms\n", name.c_str(),
+			     (long long)stats.count, stats.total / 1000.0, stats.max / 1000.0, stats.last / 1000.0);
+	}
+	for (const auto &[name, value]: counters)
+		appendFormat(res, "%s: %lld\n", name.c_str(), (long long)value);
+	return strdup(res.c_str());
+}
@@ -0,0 +1,63 @@
+// SPDX-License-Identifier: GPL-2.0
+#ifndef TRACE_H
+#define TRACE_H
+
+// Timing spans around the expensive operations of the core. The number
+// and duration of the spans of every name are summed up, so that bug
+// reports can include them, which costs two clock reads per span. When
+// tracing is switched on with --trace=<file>, the individual spans are
+// also written to <file> at exit in the Chrome trace event format, which
+// can be viewed in chrome://tracing or ui.perfetto.dev.
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#else
+#include <stdbool.h>
+#endif
+
+struct trace_span {
+	const char *name;
+	int64_t start;	/* in microseconds */
+};
+
+extern bool trace_enabled;
+extern void trace_open(const char *filename);
+extern void trace_close(void);	/* write the trace file, otherwise done at exit */
+extern int64_t trace_now(void);
+extern void trace_record(const char *name, int64_t start);
+extern void trace_count(const char *name, int64_t value);	/* add to a counter */
+extern int64_t trace_counter(const char *name);
+extern char *trace_statistics(void);	/* summary of the spans and counters, the caller frees it */
+
+// The name is not copied, use string literals
+static inline struct trace_span trace_begin(const char *name)
+{
+	struct trace_span span = { name, trace_now() };
+	return span;
+}
+
+static inline void trace_end(struct trace_span span)
+{
+	trace_record(span.name, span.start);
+}
+
+#ifdef __cplusplus
+}
+
+// Convenience version for C++: a span that ends with the scope.
+class TraceSpan {
+	trace_span span;
+public:
+	TraceSpan(const char *name) : span(trace_begin(name))
+	{
+	}
+	~TraceSpan()
+	{
+		trace_end(span);
+	}
+};
+#endif
+
+#endif
@@ -6,6 +6,7 @@
 #include "subsurface-string.h"
 #include "selection.h"
 #include "table.h"
+#include "tablesnapshot.h"
 #include "core/qthelper.h"
 
 struct trip_table trip_table;
@@ -35,14 +36,20 @@ void dump_trip_list(void)
 #endif
 
 /* free resources associated with a trip structure */
+static void free_trip_now(void *p)
+{
+	dive_trip_t *trip = p;
+	free(trip->location);
+	free(trip->notes);
+	free(trip->dives.dives);
+	free(trip);
+}
+
+/* The trip might still be used by a worker through a table snapshot */
 void free_trip(dive_trip_t *trip)
 {
-	if (trip) {
-		free(trip->location);
-		free(trip->notes);
-		free(trip->dives.dives);
-		free(trip);
-	}
+	if (trip && !defer_free_for_snapshots(&free_trip_now, trip))
+		free_trip_now(trip);
 }
 
 /* Trip table functions */
@@ -54,6 +61,7 @@ static MAKE_REMOVE_FROM(trip_table, trips)
 MAKE_SORT(trip_table, struct dive_trip *, trips, comp_trips)
 MAKE_REMOVE(trip_table, struct dive_trip *, trip)
 MAKE_CLEAR_TABLE(trip_table, trips, trip)
+MAKE_MOVE_TABLE(trip_table, trips)
 
 timestamp_t trip_date(const struct dive_trip *trip)
 {
@@ -95,6 +103,7 @@ void add_dive_to_trip(struct dive *dive, dive_trip_t *trip)
 		SSRF_INFO("Warning: adding dive to trip that has trip set\n");
 	insert_dive(&trip->dives, dive);
 	dive->divetrip = trip;
+	invalidate_trip_cache(trip);
 }
 
 /* remove a dive from the trip it's associated to, but don't delete the
@@ -110,6 +119,7 @@ struct dive_trip *unregister_dive_from_trip(struct dive *dive)
 
 	remove_dive(dive, &trip->dives);
 	dive->divetrip = NULL;
+	invalidate_trip_cache(trip);
 	return trip;
 }
 
@@ -178,15 +188,13 @@ dive_trip_t *get_trip_for_new_dive(struct dive *new_dive, bool *allocated)
 {
 	struct dive *d;
 	dive_trip_t *trip;
+	struct dive_range range;
 	int i;
 
 	/* Find dive that is within TRIP_THRESHOLD of current dive */
-	for_each_dive(i, d) {
-		/* Check if we're past the range of possible dives */
-		if (d->when >= new_dive->when + TRIP_THRESHOLD)
-			break;
-
-		if (d->when + TRIP_THRESHOLD >= new_dive->when && d->divetrip) {
+	range = dives_in_time_range(new_dive->when - TRIP_THRESHOLD, new_dive->when + TRIP_THRESHOLD);
+	for_each_dive_in_range(i, d, range) {
+		if (d->divetrip) {
 			/* Found a dive with trip in the range */
 			*allocated = false;
 			return d->divetrip;
@@ -223,6 +231,26 @@ bool trips_overlap(const struct dive_trip *t1, const struct dive_trip *t2)
 		return trip_enddate(t2) + TRIP_THRESHOLD >= trip_date(t1);
 }
 
+/*
+ * Find the first trip in a sorted trip table that overlaps with the given trip.
+ * Since the trips are sorted by start date, we can stop at the first trip that
+ * starts too late to overlap.
+ */
+struct dive_trip *get_overlapping_trip(const struct dive_trip *trip, const struct trip_table *table)
+{
+	int i;
+
+	for (i = 0; i < table->nr; i++) {
+		struct dive_trip *t = table->trips[i];
+		if (trips_overlap(trip, t))
+			return t;
+		if (trip->dives.nr > 0 && t->dives.nr > 0 &&
+		    trip_date(t) > trip_enddate(trip) + TRIP_THRESHOLD)
+			break;
+	}
+	return NULL;
+}
+
 /*
  * Collect dives for auto-grouping. Pass in first dive which should be checked.
  * Returns range of dives that should be autogrouped and trip it should be
@@ -376,3 +404,21 @@ int trip_shown_dives(const struct dive_trip *trip)
 	}
 	return res;
 }
+
+void invalidate_trip_cache(struct dive_trip *trip)
+{
+	memset(trip->git_id, 0, 20);
+}
+
+/* The trip directory contains the dives, so all of them have to be unchanged, too */
+bool trip_cache_is_valid(const struct dive_trip *trip)
+{
+	static const unsigned char null_id[20] = { 0, };
+	if (!memcmp(trip->git_id, null_id, 20))
+		return false;
+	for (int i = 0; i < trip->dives.nr; ++i) {
+		if (!dive_cache_is_valid(trip->dives.dives[i]))
+			return false;
+	}
+	return true;
+}
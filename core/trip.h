@@ -18,6 +18,8 @@ typedef struct dive_trip
 	bool saved;
 	bool autogen;
 	bool selected;
+	/* Tree id of the trip directory in git storage: zero if the trip changed since */
+	unsigned char git_id[20];
 } dive_trip_t;
 
 typedef struct trip_table {
@@ -37,6 +39,9 @@ extern void free_trip(dive_trip_t *trip);
 extern timestamp_t trip_date(const struct dive_trip *trip);
 extern timestamp_t trip_enddate(const struct dive_trip *trip);
 
+extern void invalidate_trip_cache(struct dive_trip *trip);
+extern bool trip_cache_is_valid(const struct dive_trip *trip);
+
 extern bool trip_less_than(const struct dive_trip *a, const struct dive_trip *b);
 extern int comp_trips(const struct dive_trip *a, const struct dive_trip *b);
 extern void sort_trip_table(struct trip_table *table);
@@ -48,6 +53,7 @@ extern dive_trip_t *get_dives_to_autogroup(struct dive_table *table, int start,
 extern dive_trip_t *get_trip_for_new_dive(struct dive *new_dive, bool *allocated);
 extern dive_trip_t *get_trip_by_uniq_id(int tripId);
 extern bool trips_overlap(const struct dive_trip *t1, const struct dive_trip *t2);
+extern struct dive_trip *get_overlapping_trip(const struct dive_trip *trip, const struct trip_table *table);
 
 extern void select_dives_in_trip(struct dive_trip *trip);
 extern void deselect_dives_in_trip(struct dive_trip *trip);
@@ -58,6 +64,7 @@ extern bool trip_is_single_day(const struct dive_trip *trip);
 extern int trip_shown_dives(const struct dive_trip *trip);
 
 void clear_trip_table(struct trip_table *table);
+void move_trip_table(struct trip_table *src, struct trip_table *dst);
 
 #ifdef DEBUG_TRIP
 extern void dump_trip_list(void);
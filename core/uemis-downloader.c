@@ -76,6 +76,7 @@ static int filenr;
 static int number_of_files;
 static char *mbuf = NULL;
 static int mbuf_size = 0;
+static int mbuf_allocated = 0;
 
 static int max_mem_used = -1;
 static int next_table_index = 0;
@@ -416,18 +417,30 @@ static char *next_segment(char *buf, int *offset, int size)
 
 /* a dynamically growing buffer to store the potentially massive responses.
  * The binary data block can be more than 100k in size (base64 encoded) */
-static void buffer_add(char **buffer, int *buffer_size, char *buf)
+/*
+ * Append to a buffer that is built from many answer files. Grow the
+ * allocation geometrically and copy to the known end of the string,
+ * so that building the buffer takes linear instead of quadratic time.
+ */
+static void buffer_add(char **buffer, int *buffer_size, int *buffer_allocated, char *buf)
 {
+	int len;
+
 	if (!buf)
 		return;
-	if (!*buffer) {
-		*buffer = strdup(buf);
-		*buffer_size = strlen(*buffer) + 1;
-	} else {
-		*buffer_size += strlen(buf);
-		*buffer = realloc(*buffer, *buffer_size);
-		strcat(*buffer, buf);
+	len = strlen(buf);
+	if (!*buffer)
+		*buffer_size = 1;
+	if (*buffer_size + len > *buffer_allocated) {
+		int allocated = (*buffer_size + len) * 3 / 2 + 1024;
+		char *grown = realloc(*buffer, allocated);
+		if (!grown)
+			return;
+		*buffer = grown;
+		*buffer_allocated = allocated;
 	}
+	memcpy(*buffer + *buffer_size - 1, buf, len + 1);
+	*buffer_size += len;
 #if UEMIS_DEBUG & 8
 	fprintf(debugfile, "added \"%s\" to buffer - new length %d\n", buf, *buffer_size);
 #endif
@@ -590,6 +603,7 @@ static bool uemis_get_answer(const char *path, char *request, int n_param_in,
 	free(mbuf);
 	mbuf = NULL;
 	mbuf_size = 0;
+	mbuf_allocated = 0;
 	while (searching || assembling_mbuf) {
 		if (import_thread_cancelled)
 			return false;
@@ -685,7 +699,7 @@ static bool uemis_get_answer(const char *path, char *request, int n_param_in,
 					goto fs_error;
 				}
 				buf[r] = '\0';
-				buffer_add(&mbuf, &mbuf_size, buf);
+				buffer_add(&mbuf, &mbuf_size, &mbuf_allocated, buf);
 				show_progress(buf, what);
 				free(buf);
 				param_buff[3]++;
@@ -722,7 +736,7 @@ static bool uemis_get_answer(const char *path, char *request, int n_param_in,
 					goto fs_error;
 				}
 				buf[r] = '\0';
-				buffer_add(&mbuf, &mbuf_size, buf);
+				buffer_add(&mbuf, &mbuf_size, &mbuf_allocated, buf);
 				show_progress(buf, what);
 #if UEMIS_DEBUG & 8
 				fprintf(debugfile, "::r %s \"%s\"\n", ans_path, buf);
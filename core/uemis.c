@@ -175,7 +175,9 @@ void uemis_set_divelocation(int divespot, char *text, double longitude, double l
 			struct dive_site *ds = hp->dive_site;
 			if (ds) {
 				ds->name = strdup(text);
+				invalidate_dive_site_name_index();
 				ds->location = create_location(latitude, longitude);
+				invalidate_dive_site_gps_index();
 			}
 		}
 		hp = hp->next;
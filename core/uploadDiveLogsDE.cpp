@@ -4,6 +4,7 @@
 #include <QDebug>
 #include <zip.h>
 #include <errno.h>
+#include <vector>
 #include "core/display.h"
 #include "core/errorhelper.h"
 #include "core/qthelper.h"
@@ -11,6 +12,7 @@
 #include "core/membuffer.h"
 #include "core/divesite.h"
 #include "core/cloudstorage.h"
+#include "core/parallel.h"
 #ifndef SUBSURFACE_MOBILE
 #include "core/selection.h"
 #endif // SUBSURFACE_MOBILE
@@ -35,33 +37,95 @@ uploadDiveLogsDE::uploadDiveLogsDE():
 
 void uploadDiveLogsDE::doUpload(bool selected, const QString &userid, const QString &password)
 {
-	QString err;
-
-
-	/* generate a temporary filename and create/open that file with zip_open */
-	QString filename(QDir::tempPath() + "/divelogsde-upload.dld");
-
-	// delete file if it exist
-
-	QFile f(filename);
-	if (f.open(QIODevice::ReadOnly)) {
-		f.close();
-		f.remove();
-	}
+	QByteArray zipData;
 
 	// Make zip file, with all dives, in divelogs.de format
-	if (!prepareDives(filename, selected)) {
+	if (!prepareDives(zipData, selected)) {
 		emit uploadFinish(false, tr("Cannot prepare dives, none selected?"));
 		timeout.stop();
 		return;
 	}
 
 	// And upload it
-	uploadDives(filename, userid, password);
+	uploadDives(zipData, userid, password);
 }
 
+// One dive in divelogs.de format, converted on a worker thread
+struct PreparedDive {
+	int idx;		// index in the dive list, used for the file name
+	struct dive *dive;
+	QByteArray xml;		// empty if the conversion failed
+	bool parsed = false;
+};
+
+static void prepareDive(PreparedDive &prepared, xsltStylesheetPtr xslt)
+{
+	struct membuffer mb = {};
+	struct dive_site *ds = prepared.dive->dive_site;
+
+	if (ds) {
+		put_format(&mb, "<divelog><divesites><site uuid='%8x' name='", ds->uuid);
+		put_quoted(&mb, ds->name, 1, 0);
+		put_format(&mb, "'");
+		put_location(&mb, &ds->location, " gps='", "'");
+		put_format(&mb, ">\n");
+		if (ds->taxonomy.nr) {
+			for (int j = 0; j < ds->taxonomy.nr; j++) {
+				struct taxonomy *t = &ds->taxonomy.category[j];
+				if (t->category != TC_NONE && t->category == prefs.geocoding.category[j] && t->value) {
+					put_format(&mb, "  <geo cat='%d'", t->category);
+					put_format(&mb, " origin='%d' value='", t->origin);
+					put_quoted(&mb, t->value, 1, 0);
+					put_format(&mb, "'/>\n");
+				}
+			}
+		}
+		put_format(&mb, "</site>\n</divesites>\n");
+	}
+
+	save_one_dive_to_mb(&mb, prepared.dive, false);
+
+	if (ds) {
+		put_format(&mb, "</divelog>\n");
+	}
+	/*
+	 * Parse the memory buffer into XML document and
+	 * transform it to divelogs.de format, finally dumping
+	 * the XML into a character buffer.
+	 */
+	xmlDoc *doc = xmlReadMemory(mb.buffer, mb.len, "divelog", NULL, 0);
+	free_buffer(&mb);
+	if (!doc)
+		return;
+	prepared.parsed = true;
+
+	xmlDoc *transformed = xsltApplyStylesheet(xslt, doc, NULL);
+	xmlFreeDoc(doc);
+	if (!transformed)
+		return;
+	xmlChar *membuf;
+	int streamsize;
+	xmlDocDumpMemory(transformed, &membuf, &streamsize);
+	xmlFreeDoc(transformed);
+	prepared.xml = QByteArray((const char *)membuf, streamsize);
+	xmlFree(membuf);
+}
 
-bool uploadDiveLogsDE::prepareDives(const QString &tempfile, bool selected)
+static void reportZipError(struct zip *zip)
+{
+	int ze, se;
+#if LIBZIP_VERSION_MAJOR >= 1
+	zip_error_t *error = zip_get_error(zip);
+	ze = zip_error_code_zip(error);
+	se = zip_error_code_system(error);
+#else
+	zip_error_get(zip, &ze, &se);
+#endif
+	report_error(qPrintable(uploadDiveLogsDE::tr("error writing zip file: zip error %d system error %d - %s")),
+		     ze, se, zip_strerror(zip));
+}
+
+bool uploadDiveLogsDE::prepareDives(QByteArray &zipData, bool selected)
 {
 	static const char errPrefix[] = "divelog.de-upload:";
 
@@ -77,7 +141,43 @@ bool uploadDiveLogsDE::prepareDives(const QString &tempfile, bool selected)
 		return false;
 	}
 
-	// Prepare zip file
+	/* walk the dive list in chronological order */
+	std::vector<PreparedDive> dives;
+	int i;
+	struct dive *dive;
+	for_each_dive (i, dive) {
+		if (selected && !dive->selected)
+			continue;
+		dives.push_back({ i, dive });
+	}
+
+	// The dives are only read, they can be converted in parallel
+	parallel_for((int)dives.size(), [&dives, xslt](int idx) { prepareDive(dives[idx], xslt); });
+
+	// Build the zip file in memory
+#if LIBZIP_VERSION_MAJOR >= 1
+	zip_error_t error;
+	zip_error_init(&error);
+	zip_source_t *zipSource = zip_source_buffer_create(NULL, 0, 0, &error);
+	if (zipSource) {
+		// The data must survive zip_close()
+		zip_source_keep(zipSource);
+		zip = zip_open_from_source(zipSource, ZIP_TRUNCATE, &error);
+		if (!zip)
+			zip_source_free(zipSource);
+	} else {
+		zip = NULL;
+	}
+	if (!zip) {
+		report_error(tr("Failed to create zip file for upload: %s").toUtf8(), zip_error_strerror(&error));
+		zip_error_fini(&error);
+		return false;
+	}
+	zip_error_fini(&error);
+#else
+	// Old versions of libzip can only write to files
+	QString tempfile(QDir::tempPath() + "/divelogsde-upload.dld");
+	QFile::remove(tempfile);
 	int error_code;
 	zip = zip_open(QFile::encodeName(QDir::toNativeSeparators(tempfile)), ZIP_CREATE, &error_code);
 	if (!zip) {
@@ -86,113 +186,88 @@ bool uploadDiveLogsDE::prepareDives(const QString &tempfile, bool selected)
 		report_error(tr("Failed to create zip file for upload: %s").toUtf8(), buffer);
 		return false;
 	}
+#endif
 
-	/* walk the dive list in chronological order */
-	int i;
-	struct dive *dive;
-	for_each_dive (i, dive) {
+	for (PreparedDive &prepared: dives) {
 		char filename[PATH_MAX];
-		int streamsize;
-		const char *membuf;
-		xmlDoc *transformed;
-		struct zip_source *s;
-		struct membuffer mb = {};
 
-		/*
-		 * Get the i'th dive in XML format so we can process it.
-		 * We need to save to a file before we can reload it back into memory...
-		 */
-		if (selected && !dive->selected)
-			continue;
-
-		/* make sure the buffer is empty and add the dive */
-		mb.len = 0;
-
-		struct dive_site *ds = dive->dive_site;
-
-		if (ds) {
-			put_format(&mb, "<divelog><divesites><site uuid='%8x' name='", ds->uuid);
-			put_quoted(&mb, ds->name, 1, 0);
-			put_format(&mb, "'");
-			put_location(&mb, &ds->location, " gps='", "'");
-			put_format(&mb, ">\n");
-			if (ds->taxonomy.nr) {
-				for (int j = 0; j < ds->taxonomy.nr; j++) {
-					struct taxonomy *t = &ds->taxonomy.category[j];
-					if (t->category != TC_NONE && t->category == prefs.geocoding.category[j] && t->value) {
-						put_format(&mb, "  <geo cat='%d'", t->category);
-						put_format(&mb, " origin='%d' value='", t->origin);
-						put_quoted(&mb, t->value, 1, 0);
-						put_format(&mb, "'/>\n");
-					}
-				}
-			}
-			put_format(&mb, "</site>\n</divesites>\n");
-		}
-
-		save_one_dive_to_mb(&mb, dive, false);
-
-		if (ds) {
-			put_format(&mb, "</divelog>\n");
-		}
-		membuf = mb_cstring(&mb);
-		streamsize = strlen(membuf);
-		/*
-		 * Parse the memory buffer into XML document and
-		 * transform it to divelogs.de format, finally dumping
-		 * the XML into a character buffer.
-		 */
-		xmlDoc *doc = xmlReadMemory(membuf, streamsize, "divelog", NULL, 0);
-		if (!doc) {
+		if (!prepared.parsed) {
 			qWarning() << errPrefix << "could not parse back into memory the XML file we've just created!";
 			report_error(tr("internal error").toUtf8());
-			zip_close(zip);
-			QFile::remove(tempfile);
-			xsltFreeStylesheet(xslt);
+			zip_discard(zip);
+#if LIBZIP_VERSION_MAJOR >= 1
+			zip_source_free(zipSource);
+#endif
 			return false;
 		}
-		free_buffer(&mb);
-
-		transformed = xsltApplyStylesheet(xslt, doc, NULL);
-		if (!transformed) {
-			qWarning() << errPrefix << "XSLT transform failed for dive: " << i;
-			report_error(tr("Conversion of dive %1 to divelogs.de format failed").arg(i).toUtf8());
+		if (prepared.xml.isEmpty()) {
+			qWarning() << errPrefix << "XSLT transform failed for dive: " << prepared.idx;
+			report_error(tr("Conversion of dive %1 to divelogs.de format failed").arg(prepared.idx).toUtf8());
 			continue;
 		}
-		xmlDocDumpMemory(transformed, (xmlChar **)&membuf, &streamsize);
-		xmlFreeDoc(doc);
-		xmlFreeDoc(transformed);
 
 		/*
 		 * Save the XML document into a zip file.
 		 */
-		snprintf(filename, PATH_MAX, "%d.xml", i + 1);
-		s = zip_source_buffer(zip, membuf, streamsize, 1);
+		snprintf(filename, PATH_MAX, "%d.xml", prepared.idx + 1);
+		int streamsize = prepared.xml.size();
+		char *membuf = (char *)malloc(streamsize);
+		if (!membuf)
+			continue;
+		memcpy(membuf, prepared.xml.constData(), streamsize);
+		// Free the converted dive as soon as it is handed to libzip
+		prepared.xml.clear();
+		struct zip_source *s = zip_source_buffer(zip, membuf, streamsize, 1);
 		if (s) {
 			int64_t ret = zip_add(zip, filename, s);
 			if (ret == -1)
-				qDebug() << errPrefix << "failed to include dive:" << i;
+				qDebug() << errPrefix << "failed to include dive:" << prepared.idx;
+		} else {
+			free(membuf);
 		}
 	}
-	xsltFreeStylesheet(xslt);
-	if (zip_close(zip)) {
-		int ze, se;
+
 #if LIBZIP_VERSION_MAJOR >= 1
-		zip_error_t *error = zip_get_error(zip);
-		ze = zip_error_code_zip(error);
-		se = zip_error_code_system(error);
+	if (zip_close(zip)) {
+		reportZipError(zip);
+		zip_discard(zip);
+		zip_source_free(zipSource);
+		return false;
+	}
+	bool ok = false;
+	if (zip_source_open(zipSource) == 0) {
+		zip_source_seek(zipSource, 0, SEEK_END);
+		zip_int64_t size = zip_source_tell(zipSource);
+		zip_source_seek(zipSource, 0, SEEK_SET);
+		if (size > 0) {
+			zipData.resize(size);
+			ok = zip_source_read(zipSource, zipData.data(), size) == size;
+		}
+		zip_source_close(zipSource);
+	}
+	zip_source_free(zipSource);
+	if (!ok)
+		report_error(tr("Failed to create zip file for upload: %s").toUtf8(), "read error");
+	return ok;
 #else
-		zip_error_get(zip, &ze, &se);
-#endif
-		report_error(qPrintable(tr("error writing zip file: %s zip error %d system error %d - %s")),
-			     qPrintable(QDir::toNativeSeparators(tempfile)), ze, se, zip_strerror(zip));
+	if (zip_close(zip)) {
+		reportZipError(zip);
 		return false;
 	}
+	QFile f(tempfile);
+	if (!f.open(QIODevice::ReadOnly)) {
+		qDebug() << "ERROR opening zip file: " << tempfile;
+		return false;
+	}
+	zipData = f.readAll();
+	f.close();
+	f.remove();
 	return true;
+#endif
 }
 
 
-void uploadDiveLogsDE::uploadDives(const QString &filename, const QString &userid, const QString &password)
+void uploadDiveLogsDE::uploadDives(const QByteArray &zipData, const QString &userid, const QString &password)
 {
 	QHttpPart part1, part2, part3;
 	static QNetworkRequest request;
@@ -212,15 +287,10 @@ void uploadDiveLogsDE::uploadDives(const QString &filename, const QString &useri
 
 	emit uploadStatus(tr("Uploading dives"));
 
-	// prepare header with filename (of all dives) and pointer to file
-	args = "form-data; name=\"userfile\"; filename=\"" + filename + "\"";
+	// prepare header with filename (of all dives) and the zip data
+	args = "form-data; name=\"userfile\"; filename=\"divelogsde-upload.dld\"";
 	part1.setRawHeader("Content-Disposition", args.toLatin1());
-	QFile *f = new QFile(filename);
-	if (!f->open(QIODevice::ReadOnly)) {
-		qDebug() << "ERROR opening zip file: " << filename;
-		return;
-	}
-	part1.setBodyDevice(f);
+	part1.setBody(zipData);
 	multipart->append(part1);
 
 	// Add userid
@@ -27,10 +27,10 @@ signals:
 private:
 	uploadDiveLogsDE();
 
-	void uploadDives(const QString &filename, const QString &userid, const QString &password);
+	void uploadDives(const QByteArray &zipData, const QString &userid, const QString &password);
 
 	// only to be used in desktop-widgets::subsurfacewebservices
-	bool prepareDives(const QString &tempfile, bool selected);
+	bool prepareDives(QByteArray &zipData, bool selected);
 
 	QNetworkReply *reply;
 	QHttpMultiPart *multipart;
@@ -4,8 +4,9 @@
 #include "core/pref.h"
 #include "core/errorhelper.h"
 
-#include <QtConcurrent>
 #include <QProcess>
+#include <QThread>
+#include <algorithm>
 
 // Note: this is a global instead of a function-local variable on purpose.
 // We don't want this to be generated in a different thread context if
@@ -16,11 +17,10 @@ VideoFrameExtractor *VideoFrameExtractor::instance()
 	return &frameExtractor;
 }
 
-VideoFrameExtractor::VideoFrameExtractor()
+// The worker threads mostly wait for ffmpeg, which grabs a single frame
+// and therefore hardly uses more than one core. Run one ffmpeg per core.
+VideoFrameExtractor::VideoFrameExtractor() : queue(TaskClass::BulkIO, std::max(QThread::idealThreadCount(), 1))
 {
-	// Currently, we only process one video at a time.
-	// Eventually, we might want to increase this value.
-	pool.setMaxThreadCount(1);
 }
 
 void VideoFrameExtractor::extract(QString originalFilename, QString filename, duration_t duration)
@@ -28,8 +28,8 @@ void VideoFrameExtractor::extract(QString originalFilename, QString filename, du
 	QMutexLocker l(&lock);
 	if (!workingOn.contains(originalFilename)) {
 		// We are not currently extracting this video - add it to the list.
-		workingOn.insert(originalFilename, QtConcurrent::run(&pool, [this, originalFilename, filename, duration]()
-				 { processItem(originalFilename, filename, duration); }));
+		workingOn.insert(originalFilename);
+		queue.run([this, originalFilename, filename, duration]() { processItem(originalFilename, filename, duration); });
 	}
 }
 
@@ -46,8 +46,7 @@ void VideoFrameExtractor::fail(const QString &originalFilename, duration_t durat
 void VideoFrameExtractor::clearWorkQueue()
 {
 	QMutexLocker l(&lock);
-	for (auto it = workingOn.begin(); it != workingOn.end(); ++it)
-		it->cancel();
+	queue.clear();
 	workingOn.clear();
 }
 
@@ -89,8 +88,15 @@ void VideoFrameExtractor::processItem(QString originalFilename, QString filename
 	if (!ffmpeg.waitForStarted()) {
 		// Since we couldn't sart ffmpeg, turn off thumbnailing
 		// TODO: call the proper preferences-functions
-		prefs.extract_video_thumbnails = false;
-		report_error(qPrintable(tr("ffmpeg failed to start - video thumbnail creation suspended. To enable video thumbnailing, set working executable in preferences.")));
+		// Other videos might fail concurrently - only report the error once.
+		bool report;
+		{
+			QMutexLocker l(&lock);
+			report = prefs.extract_video_thumbnails;
+			prefs.extract_video_thumbnails = false;
+		}
+		if (report)
+			report_error(qPrintable(tr("ffmpeg failed to start - video thumbnail creation suspended. To enable video thumbnailing, set working executable in preferences.")));
 		return fail(originalFilename, duration, false);
 	}
 	if (!ffmpeg.waitForFinished()) {
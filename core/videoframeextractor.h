@@ -3,11 +3,11 @@
 #define VIDEOFRAMEEXTRACTOR_H
 
 #include "core/units.h"
+#include "core/taskqueue.h"
 
 #include <QMutex>
-#include <QFuture>
-#include <QThreadPool>
 #include <QQueue>
+#include <QSet>
 #include <QString>
 #include <QPair>
 
@@ -30,8 +30,8 @@ private:
 	void processItem(QString originalFilename, QString filename, duration_t duration);
 	void fail(const QString &originalFilename, duration_t duration, bool isInvalid);
 	mutable QMutex lock;
-	QThreadPool pool;
-	QMap<QString, QFuture<void>> workingOn;
+	TaskQueue queue;
+	QSet<QString> workingOn;
 };
 
 #endif
@@ -1,7 +1,11 @@
 // SPDX-License-Identifier: GPL-2.0
 #include "desktop-widgets/about.h"
 #include "core/version.h"
+#include "core/memorystatistics.h"
+#include "core/trace.h"
+#include "commands/command_base.h"
 #include <QDesktopServices>
+#include <QMessageBox>
 #include <QUrl>
 #include <QShortcut>
 
@@ -44,3 +48,17 @@ void SubsurfaceAbout::on_creditButton_clicked()
 {
 	QDesktopServices::openUrl(QUrl("http://subsurface-divelog.org/misc/credits"));
 }
+
+void SubsurfaceAbout::on_diagnosticsButton_clicked()
+{
+	char *statistics = trace_statistics();
+	char *memory = memory_statistics();
+	QString text = QString(statistics) + "\nMemory used:\n" + memory +
+		       QString("undo commands: %1\n").arg(Command::getUndoStack()->count());
+	free(statistics);
+	free(memory);
+	QMessageBox box(QMessageBox::Information, tr("Diagnostics"), tr("Performance counters and memory use"),
+			QMessageBox::Close, this);
+	box.setDetailedText(text);
+	box.exec();
+}
@@ -16,6 +16,7 @@
 #include <QStandardPaths>
 #include <QMessageBox>
 #include <QHeaderView>
+#include <QSet>
 #include "commands/command.h"
 #include "commands/command_base.h"
 #include "core/errorhelper.h"
@@ -215,10 +216,10 @@ void DiveListView::diveSelectionChanged(const QVector<QModelIndex> &indices)
 	for (const QModelIndex &index: indices) {
 		if (!index.parent().isValid())
 			continue;
-		int row = index.parent().row();
-		if (std::find(affectedTrips.begin(), affectedTrips.end(), row) == affectedTrips.end())
-			affectedTrips.push_back(row);
+		affectedTrips.push_back(index.parent().row());
 	}
+	std::sort(affectedTrips.begin(), affectedTrips.end());
+	affectedTrips.erase(std::unique(affectedTrips.begin(), affectedTrips.end()), affectedTrips.end());
 	MultiFilterSortModel *m = MultiFilterSortModel::instance();
 	for (int row: affectedTrips) {
 		QModelIndex idx = m->index(row, 0);
@@ -509,13 +510,18 @@ void DiveListView::selectionChangeDone()
 		// This is truly sad, but taking the list of selected indices and turning them
 		// into dive sites turned out to be unreasonably slow. Therefore, let's access
 		// the core list directly. In my tests, this went down from 700 to 0 ms!
+		// Use a set to check for duplicates, since searching the vector would
+		// be quadratic in the number of dive sites.
 		QVector<dive_site *> selectedSites;
+		QSet<dive_site *> seenSites;
 		selectedSites.reserve(amount_selected);
 		int i;
 		dive *d;
 		for_each_dive(i, d) {
-			if (d->selected && !d->hidden_by_filter && d->dive_site && !selectedSites.contains(d->dive_site))
+			if (d->selected && !d->hidden_by_filter && d->dive_site && !seenSites.contains(d->dive_site)) {
+				seenSites.insert(d->dive_site);
 				selectedSites.push_back(d->dive_site);
+			}
 		}
 		MapWidget::instance()->setSelected(selectedSites);
 	}
@@ -884,9 +890,11 @@ void DiveListView::matchImagesToDives(QStringList fileNames)
 
 	// Create the data structure of pictures to be added: a list of pictures per dive.
 	std::vector<Command::PictureListForAddition> pics;
+	struct dive_time_index dives;
+	init_selected_dive_time_index(&dives);
 	for (const QString &fileName: fileNames) {
 		struct dive *d;
-		picture *pic = create_picture(qPrintable(fileName), shiftDialog.amount(), shiftDialog.matchAll(), &d);
+		picture *pic = create_picture_for_dives(&dives, qPrintable(fileName), shiftDialog.amount(), shiftDialog.matchAll(), &d);
 		if (!pic)
 			continue;
 		PictureObj pObj(*pic);
@@ -898,6 +906,7 @@ void DiveListView::matchImagesToDives(QStringList fileNames)
 		else
 			it->pics.push_back(pObj);
 	}
+	free_dive_time_index(&dives);
 
 	if (pics.empty())
 		return;
@@ -934,13 +943,11 @@ void DiveListView::loadImageFromURL(QUrl url)
 			return;
 		}
 
-		QCryptographicHash hash(QCryptographicHash::Sha1);
-		hash.addData(url.toString().toUtf8());
 		QString path = QStandardPaths::standardLocations(QStandardPaths::CacheLocation).first();
 		QDir dir(path);
 		if (!dir.exists())
 			dir.mkpath(path);
-		QFile imageFile(path.append("/").append(hash.result().toHex()));
+		QFile imageFile(path.append("/").append(sha1Hash(url.toString().toUtf8()).toHex()));
 		if (imageFile.open(QIODevice::WriteOnly)) {
 			QDataStream stream(&imageFile);
 			stream.writeRawData(imageData.data(), imageData.length());
@@ -2,6 +2,10 @@
 #include <QFileDialog>
 #include <QShortcut>
 #include <QSettings>
+#include <QThread>
+#include <QtConcurrent>
+#include <algorithm>
+#include <deque>
 #include <string.h> // Allows string comparisons and substitutions in TeX export
 
 #include "ui_divelogexportdialog.h"
@@ -11,9 +15,11 @@
 #include "core/settings/qPrefDisplay.h"
 #include "core/save-profiledata.h"
 #include "core/divefilter.h"
+#include "core/divelist.h"
 #include "core/divesite.h"
 #include "core/errorhelper.h"
 #include "core/file.h"
+#include "core/sha1.h"
 #include "core/tag.h"
 #include "backend-shared/exportfuncs.h"
 #include "desktop-widgets/mainwindow.h"
@@ -117,6 +123,7 @@ void DiveLogExportDialog::exportHtmlInit(const QString &filename)
 	hes.exportPhotos = ui->exportPhotos->isChecked();
 	hes.selectedOnly = ui->exportSelectedDives->isChecked();
 	hes.listOnly = ui->exportListOnly->isChecked();
+	hes.maxSamples = ui->exportReducedProfiles->isChecked() ? 500 : 0;
 	hes.fontFamily = ui->fontSelection->itemData(ui->fontSelection->currentIndex()).toString();
 	hes.fontSize = ui->fontSizeSelection->currentText();
 	hes.themeSelection = ui->themeSelection->currentIndex();
@@ -195,9 +202,14 @@ void DiveLogExportDialog::on_buttonBox_accepted()
 			if (!filename.isNull() && !filename.isEmpty())
 				exportProfile(qPrintable(filename), ui->exportSelected->isChecked());
 		} else if (ui->exportProfileData->isChecked()) {
-			filename = QFileDialog::getSaveFileName(this, tr("Save profile data"), lastDir);
-			if (!filename.isNull() && !filename.isEmpty())
-				save_profiledata(qPrintable(filename), ui->exportSelected->isChecked());
+			filename = QFileDialog::getSaveFileName(this, tr("Save profile data"), lastDir,
+								tr("CSV files") + " (*.csv);;" + tr("Binary column files") + " (*.sspd)");
+			if (!filename.isNull() && !filename.isEmpty()) {
+				if (filename.endsWith(".sspd", Qt::CaseInsensitive))
+					save_profiledata_columns(qPrintable(filename), ui->exportSelected->isChecked());
+				else
+					save_profiledata(qPrintable(filename), ui->exportSelected->isChecked());
+			}
 		}
 		break;
 	case 1:
@@ -222,21 +234,75 @@ void DiveLogExportDialog::on_buttonBox_accepted()
 	}
 }
 
-void exportProfile(const struct dive *dive, const QString filename)
+// An exported profile depends on the dive, the dives of the 48 hours before it
+// through the tissue loading, the preferences and the size of the image. As long
+// as the dives are unchanged since they were saved to git, their git ids identify
+// them. An empty key means that the profile has to be drawn.
+static QByteArray profileKey(const struct dive *d, QSize size)
 {
+	int idx = get_divenr(d);
+	if (idx < 0)
+		return QByteArray();
+	SHA_CTX ctx;
+	SHA1_Init(&ctx);
+	for (int i = idx; i >= 0; --i) {
+		const struct dive *prev = get_dive(i);
+		if (prev != d && dive_endtime(prev) + 48 * 60 * 60 < d->when)
+			break;
+		if (!dive_cache_is_valid(prev))
+			return QByteArray();
+		SHA1_Update(&ctx, prev->git_id, sizeof(prev->git_id));
+	}
+	SHA1_Update(&ctx, &prefs, sizeof(prefs));
+	SHA1_Update(&ctx, &size, sizeof(size));
+	QByteArray res(20, Qt::Uninitialized);
+	SHA1_Final((unsigned char *)res.data(), &ctx);
+	return res;
+}
+
+// The keys of the profiles exported in this session, by file name
+static QHash<QString, QByteArray> exportedProfiles;
+
+// The profile can only be drawn on the GUI thread, but the encoding of the
+// large images is done concurrently. Profiles that were exported to the same
+// file before and didn't change are not drawn again. To bound the memory use, only a few
+// images are kept waiting for their encoding.
+void exportProfiles(const std::vector<const struct dive *> &dives, const std::vector<QString> &filenames)
+{
+	if (dives.empty())
+		return;
+
 	ProfileWidget2 *profile = MainWindow::instance()->graphics;
 	profile->setToolTipVisibile(false);
 	profile->setPrintMode(true);
 	double scale = profile->getFontPrintScale();
 	profile->setFontPrintScale(4 * scale);
-	profile->plotDive(dive, true, false, true);
-	QImage image = QImage(profile->size() * 4, QImage::Format_RGB32);
-	QPainter paint;
-	paint.begin(&image);
-	profile->render(&paint);
-	image.save(filename);
+
+	int maxPending = std::max(QThread::idealThreadCount(), 1);
+	std::deque<QFuture<void>> pending;
+	for (size_t i = 0; i < dives.size(); ++i) {
+		QString filename = filenames[i];
+		QByteArray key = profileKey(dives[i], profile->size() * 4);
+		if (!key.isEmpty() && exportedProfiles.value(filename) == key && QFile::exists(filename))
+			continue;
+		exportedProfiles[filename] = key;
+		profile->plotDive(dives[i], true, false, true);
+		QImage image = QImage(profile->size() * 4, QImage::Format_RGB32);
+		QPainter paint;
+		paint.begin(&image);
+		profile->render(&paint);
+		paint.end();
+		if ((int)pending.size() >= maxPending) {
+			pending.front().waitForFinished();
+			pending.pop_front();
+		}
+		pending.push_back(QtConcurrent::run([image, filename]() { image.save(filename); }));
+	}
+	for (QFuture<void> &future: pending)
+		future.waitForFinished();
+
 	profile->setToolTipVisibile(true);
 	profile->setFontPrintScale(scale);
 	profile->setPrintMode(false);
-	profile->plotDive(dive, true);
+	profile->plotDive(dives.back(), true);
 }
@@ -6,6 +6,7 @@
 #include "qt-models/divepicturemodel.h"
 
 #include <QFileDialog>
+#include <QSet>
 #include <QtConcurrent>
 
 FindMovedImagesDialog::FindMovedImagesDialog(QWidget *parent) : QDialog(parent)
@@ -85,6 +86,26 @@ void FindMovedImagesDialog::learnImage(const QString &filename, QMap<QString, Im
 	}
 }
 
+// Matches by content are better than any match by name. Among files with the
+// same content, the one with the most matching path items is taken.
+static const int contentMatchScore = 1000;
+
+void FindMovedImagesDialog::learnImageContent(const QString &filename, QMap<QString, ImageMatch> &matches,
+					      const QHash<QByteArray, QVector<QString>> &originalsByFingerprint)
+{
+	auto fingerprintIt = originalsByFingerprint.find(fileFingerprint(filename));
+	if (fingerprintIt == originalsByFingerprint.end())
+		return;
+	for (const QString &originalFilename: *fingerprintIt) {
+		int score = contentMatchScore + matchPath(filename, originalFilename);
+		auto it = matches.find(originalFilename);
+		if (it == matches.end())
+			matches.insert(originalFilename, { filename, score });
+		else if (it->score < score)
+			*it = { filename, score };
+	}
+}
+
 // We use a stack to recurse into directories. Each level of the stack is made up of
 // a list of subdirectories to process. For each directory we keep track of the progress
 // that is done when processing this directory. In principle the from value is redundant
@@ -108,6 +129,25 @@ QVector<FindMovedImagesDialog::Match> FindMovedImagesDialog::learnImages(const Q
 		imagePaths.append(ImagePath(path));	// No emplace() in QVector? Sheesh.
 	std::sort(imagePaths.begin(), imagePaths.end());
 
+	// Most files in the scanned directories will not be pictures of the log.
+	// To reject them quickly, keep a set of the wanted filenames.
+	QSet<QString> filenames;
+	filenames.reserve(imagePaths.size());
+	for (const ImagePath &path: imagePaths)
+		filenames.insert(path.filenameUpperCase);
+
+	// Renamed pictures are found by the fingerprints of their content. To avoid reading
+	// every file, only files with the size of one of the pictures are fingerprinted.
+	QHash<QByteArray, QVector<QString>> originalsByFingerprint;
+	QSet<qint64> sizes;
+	for (const QString &path: imagePathsIn) {
+		QByteArray fingerprint = pictureFingerprint(path);
+		if (fingerprint.isEmpty())
+			continue;
+		originalsByFingerprint[fingerprint].append(path);
+		sizes.insert(fingerprintFileSize(fingerprint));
+	}
+
 	// Free memory of original path vector - we don't need it any more
 	imagePathsIn.clear();
 
@@ -125,10 +165,13 @@ QVector<FindMovedImagesDialog::Match> FindMovedImagesDialog::learnImages(const Q
 		// Since we're running in a different thread, use invokeMethod to set progress.
 		QMetaObject::invokeMethod(this, "setProgress", Q_ARG(double, entry.progressFrom), Q_ARG(QString, dir.absolutePath()));
 
-		for (const QString &file: dir.entryList(QDir::Files)) {
+		for (const QFileInfo &file: dir.entryInfoList(QDir::Files)) {
 			if (stopScanning != 0)
 				goto out;
-			learnImage(dir.absoluteFilePath(file), matches, imagePaths);
+			if (filenames.contains(file.fileName().toUpper()))
+				learnImage(file.absoluteFilePath(), matches, imagePaths);
+			if (!sizes.isEmpty() && sizes.contains(file.size()))
+				learnImageContent(file.absoluteFilePath(), matches, originalsByFingerprint);
 		}
 		if (stack.size() <= maxRecursions) {
 			stack.append(QVector<Dir>());
@@ -147,8 +190,10 @@ QVector<FindMovedImagesDialog::Match> FindMovedImagesDialog::learnImages(const Q
 out:
 	QMetaObject::invokeMethod(this, "setProgress", Q_ARG(double, 1.0), Q_ARG(QString, QString()));
 	QVector<FindMovedImagesDialog::Match> ret;
-	for (auto it = matches.begin(); it != matches.end(); ++it)
-		ret.append({ it.key(), it->localFilename, it->score });
+	for (auto it = matches.begin(); it != matches.end(); ++it) {
+		int matchingPathItems = it->score >= contentMatchScore ? it->score - contentMatchScore : it->score;
+		ret.append({ it.key(), it->localFilename, matchingPathItems });
+	}
 	return ret;
 }
 
@@ -6,6 +6,7 @@
 #include <QFutureWatcher>
 #include <QVector>
 #include <QMap>
+#include <QHash>
 #include <QAtomicInteger>
 
 class FindMovedImagesDialog : public QDialog {
@@ -43,6 +44,8 @@ private:
 	QScopedPointer<QFontMetrics> fontMetrics;		// Needed to format elided paths
 
 	void learnImage(const QString &filename, QMap<QString, ImageMatch> &matches, const QVector<ImagePath> &imagePaths);
+	void learnImageContent(const QString &filename, QMap<QString, ImageMatch> &matches,
+			       const QHash<QByteArray, QVector<QString>> &originalsByFingerprint);
 	QVector<Match> learnImages(const QString &dir, int maxRecursions, QVector<QString> imagePaths);
 };
 
@@ -27,6 +27,7 @@
 #include "core/planner.h"
 #include "core/qthelper.h"
 #include "core/subsurface-string.h"
+#include "core/trace.h"
 #include "core/trip.h"
 #include "core/version.h"
 #include "core/windowtitleupdate.h"
@@ -122,13 +123,23 @@ MainWindow::MainWindow() : QMainWindow(),
 	helpView(0),
 #endif
 	state(VIEWALL),
-	findMovedImagesDialog(nullptr)
+	updateManager(nullptr),
+	findMovedImagesDialog(nullptr),
+	printingTemplatesSetUp(false)
 {
+	TraceSpan span("MainWindow::MainWindow");
 	Q_ASSERT_X(m_Instance == NULL, "MainWindow", "MainWindow recreated!");
 	m_Instance = this;
 	ui.setupUi(this);
-	read_hashes();
 	Command::init();
+
+	// Calculating the profile of a long dive takes a noticeable time. When the
+	// user scrolls through the dive list, only plot the dive that is current
+	// once all pending events, such as repeated key presses, were processed.
+	plotTimer.setSingleShot(true);
+	plotTimer.setInterval(0);
+	connect(&plotTimer, &QTimer::timeout, this, [this] { graphics->plotDive(current_dive, false); });
+
 	// Define the States of the Application Here, Currently the states are situations where the different
 	// widgets will change on the mainwindow.
 
@@ -239,38 +250,21 @@ MainWindow::MainWindow() : QMainWindow(),
 	memset(&copyPasteDive, 0, sizeof(copyPasteDive));
 	memset(&what, 0, sizeof(what));
 
-	updateManager = new UpdateManager(this);
 	undoAction = Command::undoAction(this);
 	redoAction = Command::redoAction(this);
 	undoAction->setShortcut(QKeySequence(Qt::CTRL + Qt::Key_Z));
 	redoAction->setShortcut(QKeySequence(Qt::CTRL + Qt::SHIFT + Qt::Key_Z));
 	ui.menu_Edit->addActions({ undoAction, redoAction });
 
-#ifndef NO_PRINTING
-	// copy the bundled print templates to the user path
-	QStringList templateBackupList;
-	QString templatePathUser(getPrintingTemplatePathUser());
-	copy_bundled_templates(getPrintingTemplatePathBundle(), templatePathUser, &templateBackupList);
-	if (templateBackupList.length()) {
-		QMessageBox msgBox(this);
-		templatePathUser.replace("\\", "/");
-		templateBackupList.replaceInStrings(templatePathUser + "/", "");
-		msgBox.setWindowTitle(tr("Template backup created"));
-		msgBox.setText(tr("The following backup printing templates were created:\n\n%1\n\n"
-			"Location:\n%2\n\n"
-			"Please note that as of this version of Subsurface the default templates\n"
-			"are read-only and should not be edited directly, since the application\n"
-			"can overwrite them on startup.").arg(templateBackupList.join("\n")).arg(templatePathUser));
-		msgBox.setStandardButtons(QMessageBox::Ok);
-		msgBox.exec();
-	}
-	set_bundled_templates_as_read_only();
-	find_all_templates();
-#endif
+	// Things that are not needed to show the dive list are done once the
+	// event loop runs, i.e. after the main window was drawn for the first time.
+	QTimer::singleShot(0, this, &MainWindow::deferredInit);
 
 	setupSocialNetworkMenu();
 	set_git_update_cb(&updateProgress);
 	set_error_cb(&showErrorFromC);
+	// Don't block the UI while pushing saved changes to the cloud
+	git_sync_in_background = true;
 
 	// Toolbar Connections related to the Profile Update
 	auto tec = qPrefTechnicalDetails::instance();
@@ -364,6 +358,45 @@ void MainWindow::setupSocialNetworkMenu()
 {
 }
 
+void MainWindow::deferredInit()
+{
+	TraceSpan span("MainWindow::deferredInit");
+	read_hashes();
+	setupPrintingTemplates();
+	if (!updateManager)
+		updateManager = new UpdateManager(this);
+}
+
+// Called at idle time after startup, but also before printing in case that comes first
+void MainWindow::setupPrintingTemplates()
+{
+#ifndef NO_PRINTING
+	if (printingTemplatesSetUp)
+		return;
+	printingTemplatesSetUp = true;
+
+	// copy the bundled print templates to the user path
+	QStringList templateBackupList;
+	QString templatePathUser(getPrintingTemplatePathUser());
+	copy_bundled_templates(getPrintingTemplatePathBundle(), templatePathUser, &templateBackupList);
+	if (templateBackupList.length()) {
+		QMessageBox msgBox(this);
+		templatePathUser.replace("\\", "/");
+		templateBackupList.replaceInStrings(templatePathUser + "/", "");
+		msgBox.setWindowTitle(tr("Template backup created"));
+		msgBox.setText(tr("The following backup printing templates were created:\n\n%1\n\n"
+			"Location:\n%2\n\n"
+			"Please note that as of this version of Subsurface the default templates\n"
+			"are read-only and should not be edited directly, since the application\n"
+			"can overwrite them on startup.").arg(templateBackupList.join("\n")).arg(templatePathUser));
+		msgBox.setStandardButtons(QMessageBox::Ok);
+		msgBox.exec();
+	}
+	set_bundled_templates_as_read_only();
+	find_all_templates();
+#endif
+}
+
 void MainWindow::editDiveSite(dive_site *ds)
 {
 	if (!ds)
@@ -448,7 +481,7 @@ void MainWindow::selectionChanged()
 		configureToolbar();
 		enableDisableOtherDCsActions();
 	}
-	graphics->plotDive(current_dive, false);
+	plotTimer.start();
 	MapWidget::instance()->selectionChanged();
 }
 
@@ -668,6 +701,7 @@ void MainWindow::updateLastUsedDir(const QString &dir)
 void MainWindow::on_actionPrint_triggered()
 {
 #ifndef NO_PRINTING
+	setupPrintingTemplates();
 	PrintDialog dlg(this);
 
 	dlg.exec();
@@ -919,7 +953,7 @@ void MainWindow::on_actionYearlyStatistics_triggered()
 {
 	QDialog d;
 	QVBoxLayout *l = new QVBoxLayout(&d);
-	YearlyStatisticsModel *m = new YearlyStatisticsModel();
+	YearlyStatisticsModel *m = new YearlyStatisticsModel(&d);
 	QTreeView *view = new QTreeView();
 	view->setModel(m);
 	l->addWidget(view);
@@ -1295,6 +1329,7 @@ void MainWindow::closeEvent(QCloseEvent *event)
 	}
 	event->accept();
 	writeSettings();
+	wait_for_background_sync();
 	QApplication::closeAllWindows();
 }
 
@@ -13,6 +13,7 @@
 #include <QUrl>
 #include <QUuid>
 #include <QProgressDialog>
+#include <QTimer>
 #include <memory>
 
 #include "ui_mainwindow.h"
@@ -211,7 +212,11 @@ private:
 	bool plannerStateClean();
 	void configureToolbar();
 	void setupSocialNetworkMenu();
+	void deferredInit();
+	void setupPrintingTemplates();
 	QDialog *findMovedImagesDialog;
+	bool printingTemplatesSetUp;
+	QTimer plotTimer; // Coalesces profile updates of quick successive selection changes
 	struct dive copyPasteDive;
 	struct dive_components what;
 	QList<QAction *> profileToolbarActions;
@@ -3,10 +3,12 @@
 #include <QDebug>
 #include <QQuickItem>
 #include <QModelIndex>
+#include <QTimer>
 
 #include "mapwidget.h"
 #include "core/divesite.h"
 #include "core/selection.h"
+#include "core/trace.h"
 #include "map-widget/qmlmapwidgethelper.h"
 #include "qt-models/maplocationmodel.h"
 #include "qt-models/divelocationmodel.h"
@@ -29,7 +31,12 @@ MapWidget::MapWidget(QWidget *parent) : QQuickWidget(parent)
 	connect(this, &QQuickWidget::statusChanged, this, &MapWidget::doneLoading);
 	connect(&diveListNotifier, &DiveListNotifier::divesChanged, this, &MapWidget::divesChanged);
 	connect(&diveListNotifier, &DiveListNotifier::dataReset, this, &MapWidget::reload);
-	setSource(urlMapWidget);
+	// Starting the QML engine and the map plugin takes a long time. Do this once
+	// the event loop runs, so that it doesn't delay the first display of the dive list.
+	QTimer::singleShot(0, this, [this] {
+		TraceSpan span("MapWidget::setSource");
+		setSource(urlMapWidget);
+	});
 }
 
 void MapWidget::doneLoading(QQuickWidget::Status status)
@@ -48,6 +55,8 @@ void MapWidget::doneLoading(QQuickWidget::Status status)
 	m_mapHelper = rootObject()->findChild<MapWidgetHelper *>();
 	connect(m_mapHelper, &MapWidgetHelper::selectedDivesChanged, this, &MapWidget::selectedDivesChanged);
 	connect(m_mapHelper, &MapWidgetHelper::coordinatesChanged, this, &MapWidget::coordinatesChanged);
+	// The dives may have been loaded before the map was ready
+	reload();
 }
 
 void MapWidget::centerOnDiveSite(struct dive_site *ds)
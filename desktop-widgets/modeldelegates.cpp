@@ -217,16 +217,20 @@ void TankInfoDelegate::setModelData(QWidget *, QAbstractItemModel *, const QMode
 {
 	QAbstractItemModel *mymodel = currCombo.model;
 	TankInfoModel *tanks = TankInfoModel::instance();
-	QModelIndexList matches = tanks->match(tanks->index(0, 0), Qt::DisplayRole, currCombo.activeText, 1, Qt::MatchFixedString | Qt::MatchWrap);
-	int row;
 	QString cylinderName = currCombo.activeText;
-	if (matches.isEmpty()) {
-		tanks->insertRows(tanks->rowCount(), 1);
-		tanks->setData(tanks->index(tanks->rowCount() - 1, 0), currCombo.activeText);
-		row = tanks->rowCount() - 1;
-	} else {
-		row = matches.first().row();
-		cylinderName = matches.first().data().toString();
+	// The rows of the model are the entries of tank_info. Only if the
+	// type isn't found by name, search the model ignoring the case.
+	int row = find_tank_info(cylinderName.toUtf8().constData());
+	if (row < 0) {
+		QModelIndexList matches = tanks->match(tanks->index(0, 0), Qt::DisplayRole, currCombo.activeText, 1, Qt::MatchFixedString | Qt::MatchWrap);
+		if (matches.isEmpty()) {
+			tanks->insertRows(tanks->rowCount(), 1);
+			tanks->setData(tanks->index(tanks->rowCount() - 1, 0), currCombo.activeText);
+			row = tanks->rowCount() - 1;
+		} else {
+			row = matches.first().row();
+			cylinderName = matches.first().data().toString();
+		}
 	}
 	int tankSize = tanks->data(tanks->index(row, TankInfoModel::ML)).toInt();
 	int tankPressure = tanks->data(tanks->index(row, TankInfoModel::BAR)).toInt();
@@ -291,12 +295,17 @@ void WSInfoDelegate::setModelData(QWidget *, QAbstractItemModel *, const QModelI
 	WeightModel *mymodel = qobject_cast<WeightModel *>(currCombo.model);
 	WSInfoModel *wsim = WSInfoModel::instance();
 	QString weightName = currCombo.activeText;
-	QModelIndexList matches = wsim->match(wsim->index(0, 0), Qt::DisplayRole, weightName, 1, Qt::MatchFixedString | Qt::MatchWrap);
 	int grams = 0;
-	if (!matches.isEmpty()) {
-		int row = matches.first().row();
-		weightName = matches.first().data().toString();
+	int row = find_ws_info(weightName.toUtf8().constData());
+	if (row >= 0) {
 		grams = wsim->data(wsim->index(row, WSInfoModel::GR)).toInt();
+	} else {
+		QModelIndexList matches = wsim->match(wsim->index(0, 0), Qt::DisplayRole, weightName, 1, Qt::MatchFixedString | Qt::MatchWrap);
+		if (!matches.isEmpty()) {
+			row = matches.first().row();
+			weightName = matches.first().data().toString();
+			grams = wsim->data(wsim->index(row, WSInfoModel::GR)).toInt();
+		}
 	}
 
 	mymodel->setTempWS(currCombo.currRow, weightsystem_t{ { grams }, copy_qstring(weightName) });
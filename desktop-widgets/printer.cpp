@@ -50,7 +50,7 @@ void Printer::putProfileImage(QRect profilePlaceholder, QRect viewPort, QPainter
 			QRgb *end = pixel + image.width();
 			for (; pixel != end; pixel++) {
 				int gray_val = qGray(*pixel);
-				*pixel = QColor(gray_val, gray_val, gray_val).rgb();
+				*pixel = qRgb(gray_val, gray_val, gray_val);
 			}
 		}
 
@@ -190,9 +190,16 @@ ShiftImageTimesDialog::ShiftImageTimesDialog(QWidget *parent, QStringList fileNa
 
 	// Get times of all files. 0 means that the time couldn't be determined.
 	int numFiles = fileNames.size();
+	std::vector<QByteArray> localNames;
+	std::vector<const char *> names;
+	localNames.reserve(numFiles);
+	names.reserve(numFiles);
+	for (const QString &fileName: fileNames) {
+		localNames.push_back(fileName.toLocal8Bit());
+		names.push_back(localNames.back().constData());
+	}
 	timestamps.resize(numFiles);
-	for (int i = 0; i < numFiles; ++i)
-		timestamps[i] = picture_get_timestamp(qPrintable(fileNames[i]));
+	get_timestamps(numFiles, names.data(), timestamps.data());
 	updateInvalid();
 }
 
@@ -228,8 +235,10 @@ void ShiftImageTimesDialog::updateInvalid()
 	ui.invalidFilesText->append(tr("\nFiles with inappropriate date/time") + ":");
 
 	int numFiles = fileNames.size();
+	struct dive_time_index dives;
+	init_selected_dive_time_index(&dives);
 	for (int i = 0; i < numFiles; ++i) {
-		if (picture_check_valid_time(timestamps[i], m_amount))
+		if (picture_check_valid_time_for_dives(&dives, timestamps[i], m_amount))
 			continue;
 
 		// We've found an invalid image
@@ -240,6 +249,7 @@ void ShiftImageTimesDialog::updateInvalid()
 			ui.invalidFilesText->append(fileNames[i] + " - " + time_first.toString());
 		allValid = false;
 	}
+	free_dive_time_index(&dives);
 
 	if (!allValid) {
 		ui.warningLabel->show();
@@ -1,6 +1,28 @@
 // SPDX-License-Identifier: GPL-2.0
 #include "TabBase.h"
 
-TabBase::TabBase(QWidget *parent) : QWidget(parent)
+TabBase::TabBase(QWidget *parent) : QWidget(parent),
+	needsUpdate(false)
 {
 }
+
+void TabBase::updateLazily()
+{
+	needsUpdate = !isVisible();
+	if (!needsUpdate)
+		updateData();
+}
+
+void TabBase::cancelUpdate()
+{
+	needsUpdate = false;
+}
+
+void TabBase::showEvent(QShowEvent *event)
+{
+	QWidget::showEvent(event);
+	if (needsUpdate) {
+		needsUpdate = false;
+		updateData();
+	}
+}
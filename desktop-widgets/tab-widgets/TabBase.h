@@ -13,6 +13,14 @@ public:
 	TabBase(QWidget *parent = 0);
 	virtual void updateData() = 0;
 	virtual void clear() = 0;
+	// Calls updateData() if the tab is shown, otherwise when it is shown the next time.
+	// Updating the hidden tabs on every change of the current dive is too slow.
+	void updateLazily();
+	void cancelUpdate();
+protected:
+	void showEvent(QShowEvent *) override;
+private:
+	bool needsUpdate;
 };
 
 #endif
@@ -122,8 +122,9 @@ void TabDiveSite::selectionChanged(const QItemSelection &, const QItemSelection
 	DiveFilter::instance()->setFilterDiveSite(selectedDiveSites());
 }
 
-void TabDiveSite::showEvent(QShowEvent *)
+void TabDiveSite::showEvent(QShowEvent *event)
 {
+	TabBase::showEvent(event);
 	// If the user switches to the dive site tab and there was already a selection,
 	// filter on that selection.
 	DiveFilter::instance()->startFilterDiveSites(selectedDiveSites());
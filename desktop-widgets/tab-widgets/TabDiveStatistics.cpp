@@ -2,11 +2,14 @@
 #include "TabDiveStatistics.h"
 #include "ui_TabDiveStatistics.h"
 
+#include "core/equipment.h"
 #include "core/qthelper.h"
 #include "core/selection.h"
 #include "core/statistics.h"
+#include <QElapsedTimer>
 #include <QLabel>
 #include <QIcon>
+#include <algorithm>
 
 TabDiveStatistics::TabDiveStatistics(QWidget *parent) : TabBase(parent), ui(new Ui::TabDiveStatistics())
 {
@@ -23,10 +26,21 @@ TabDiveStatistics::TabDiveStatistics(QWidget *parent) : TabBase(parent), ui(new
 	ui->timeLimits->overrideMinToolTipText(tr("Shortest dive"));
 	ui->timeLimits->overrideAvgToolTipText(tr("Average length of all selected dives"));
 
+	// Commands that edit many dives send one notification per dive.
+	// Recalculate the statistics only once, when control returns to the event loop.
+	updateTimer.setSingleShot(true);
+	updateTimer.setInterval(0);
+	connect(&updateTimer, &QTimer::timeout, this, &TabDiveStatistics::updateData);
+	gasTimer.setInterval(0);
+	gasDone = 0;
+	o2Total.mliter = heTotal.mliter = 0;
+	connect(&gasTimer, &QTimer::timeout, this, &TabDiveStatistics::gasStep);
+
 	connect(&diveListNotifier, &DiveListNotifier::divesChanged, this, &TabDiveStatistics::divesChanged);
 	connect(&diveListNotifier, &DiveListNotifier::cylinderAdded, this, &TabDiveStatistics::cylinderChanged);
 	connect(&diveListNotifier, &DiveListNotifier::cylinderRemoved, this, &TabDiveStatistics::cylinderChanged);
 	connect(&diveListNotifier, &DiveListNotifier::cylinderEdited, this, &TabDiveStatistics::cylinderChanged);
+	connect(&diveListNotifier, &DiveListNotifier::divesDeleted, this, &TabDiveStatistics::divesDeleted);
 
 	const auto l = findChildren<QLabel *>(QString(), Qt::FindDirectChildrenOnly);
 	for (QLabel *label: l) {
@@ -47,6 +61,7 @@ void TabDiveStatistics::clear()
 	ui->tempLimits->clear();
 	ui->totalTimeAllText->clear();
 	ui->timeLimits->clear();
+	cancelGas();
 }
 
 // This function gets called if a field gets updated by an undo command.
@@ -59,7 +74,7 @@ void TabDiveStatistics::divesChanged(const QVector<dive *> &dives, DiveField fie
 
 	// TODO: make this more fine grained. Currently, the core can only calculate *all* statistics.
 	if (field.duration || field.depth || field.mode || field.air_temp || field.water_temp)
-		updateData();
+		updateTimer.start();
 }
 
 void TabDiveStatistics::cylinderChanged(dive *d)
@@ -67,11 +82,12 @@ void TabDiveStatistics::cylinderChanged(dive *d)
 	// If the changed dive is not selected, do nothing
 	if (!d->selected)
 		return;
-	updateData();
+	updateTimer.start();
 }
 
 void TabDiveStatistics::updateData()
 {
+	updateTimer.stop();
 	stats_t stats_selection;
 	calculate_stats_selected(&stats_selection);
 	clear();
@@ -126,35 +142,97 @@ void TabDiveStatistics::updateData()
 		ui->timeLimits->setMinimum("");
 	}
 
-	QVector<QPair<QString, int> > gasUsed = selectedDivesGasUsed();
+	// Collect the dives for the gas consumption, which is summed up in slices.
+	// clear() above has cancelled a running calculation.
+	gasDives = getDiveSelection();
+	if (!gasDives.empty())
+		gasTimer.start();
+}
+
+void TabDiveStatistics::cancelGas()
+{
+	gasTimer.stop();
+	gasDives.clear();
+	gasDone = 0;
+	gasUsed.clear();
+	o2Total.mliter = heTotal.mliter = 0;
+	ui->gasConsumption->clear();
+}
+
+// The deleted dives might be part of the running calculation. Stop it
+// before returning to the event loop and start over with the new selection.
+void TabDiveStatistics::divesDeleted()
+{
+	if (gasDives.empty())
+		return;
+	cancelGas();
+	updateTimer.start();
+}
+
+// Sum up the gas consumption of the dives for about 10 ms and show the result
+// so far. Calculating the gas of a dive needs its samples and is slow for big
+// selections. Since the dives may be edited at any time, this is done in the
+// UI thread and not in a worker thread.
+void TabDiveStatistics::gasStep()
+{
+	QElapsedTimer timer;
+	timer.start();
+	while (gasDone < gasDives.size() && timer.elapsed() < 10) {
+		dive *d = gasDives[gasDone++];
+		volume_t *diveGases = get_gas_used(d);
+		for (int j = 0; j < d->cylinders.nr; j++) {
+			if (diveGases[j].mliter)
+				gasUsed[gasname(get_cylinder(d, j)->gasmix)] += diveGases[j].mliter;
+		}
+		if (!d->invalid)
+			add_dive_gas_parts(d, diveGases, &o2Total, &heTotal);
+		free(diveGases);
+	}
+	bool finished = gasDone >= gasDives.size();
+	showGas(finished);
+	if (finished) {
+		gasTimer.stop();
+		gasDives.clear();
+	}
+}
+
+void TabDiveStatistics::showGas(bool finished)
+{
+	QVector<QPair<QString, int>> gases;
+	gases.reserve(gasUsed.size());
+	for (auto it = gasUsed.cbegin(); it != gasUsed.cend(); ++it)
+		gases.append(qMakePair(it.key(), it.value()));
+	std::sort(gases.begin(), gases.end(),
+		  [](const QPair<QString, int> &a, const QPair<QString, int> &b) { return a.second < b.second; });
+
 	QString gasUsedString;
 	volume_t vol;
-	while (!gasUsed.isEmpty()) {
-		QPair<QString, int> gasPair = gasUsed.last();
-		gasUsed.pop_back();
+	while (!gases.isEmpty()) {
+		QPair<QString, int> gasPair = gases.last();
+		gases.pop_back();
 		vol.mliter = gasPair.second;
 		gasUsedString.append(gasPair.first).append(": ").append(get_volume_string(vol, true)).append("\n");
 	}
-	volume_t o2_tot = {}, he_tot = {};
-	selected_dives_gas_parts(&o2_tot, &he_tot);
 
 	/* No need to show the gas mixing information if diving
 		* with pure air, and only display the he / O2 part when
 		* it is used.
 		*/
-	if (he_tot.mliter || o2_tot.mliter) {
+	if (heTotal.mliter || o2Total.mliter) {
 		gasUsedString.append(tr("These gases could be\nmixed from Air and using:\n"));
-		if (he_tot.mliter) {
+		if (heTotal.mliter) {
 			gasUsedString.append(tr("He"));
-			gasUsedString.append(QString(": %1").arg(get_volume_string(he_tot, true)));
+			gasUsedString.append(QString(": %1").arg(get_volume_string(heTotal, true)));
 		}
-		if (he_tot.mliter && o2_tot.mliter)
+		if (heTotal.mliter && o2Total.mliter)
 			gasUsedString.append(" ").append(tr("and")).append(" ");
-		if (o2_tot.mliter) {
+		if (o2Total.mliter) {
 			gasUsedString.append(tr("O₂"));
-			gasUsedString.append(QString(": %2\n").arg(get_volume_string(o2_tot, true)));
+			gasUsedString.append(QString(": %2\n").arg(get_volume_string(o2Total, true)));
 		}
 	}
+	if (!finished)
+		gasUsedString.append(tr("Calculating %1 of %2 dives...").arg(gasDone).arg(gasDives.size()));
 	ui->gasConsumption->setText(gasUsedString);
 }
 
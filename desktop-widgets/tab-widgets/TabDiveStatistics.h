@@ -4,6 +4,10 @@
 
 #include "TabBase.h"
 #include "core/subsurface-qt/divelistnotifier.h"
+#include "core/units.h"
+#include <QMap>
+#include <QTimer>
+#include <vector>
 
 namespace Ui {
 	class TabDiveStatistics;
@@ -20,9 +24,23 @@ public:
 private slots:
 	void divesChanged(const QVector<dive *> &dives, DiveField field);
 	void cylinderChanged(dive *d);
+	void divesDeleted();
+	void gasStep();
 
 private:
+	void cancelGas();
+	void showGas(bool finished);
 	Ui::TabDiveStatistics *ui;
+	QTimer updateTimer; // Coalesces the per-dive notifications of an undo command
+
+	// The gas consumption of the selected dives is summed up in slices from the
+	// event loop, so that a big selection doesn't block the user interface.
+	// Each change of the selection starts over.
+	QTimer gasTimer;
+	std::vector<dive *> gasDives;
+	size_t gasDone;
+	QMap<QString, int> gasUsed;	// mliter by name of the gas
+	volume_t o2Total, heTotal;
 };
 
 // Widget describing, minimum, maximum and average value.
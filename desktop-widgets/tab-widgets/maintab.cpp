@@ -359,7 +359,7 @@ void MainTab::updateDiveInfo()
 
 	if (current_dive) {
 		for (TabBase *widget: extraWidgets)
-			widget->updateData();
+			widget->updateLazily();
 
 		// If we're on the dive-site tab, we don't want to switch tab when entering / exiting
 		// trip mode. The reason is that
@@ -696,6 +696,8 @@ void MainTab::escDetected()
 
 void MainTab::clearTabs()
 {
-	for (auto widget: extraWidgets)
+	for (auto widget: extraWidgets) {
+		widget->cancelUpdate();
 		widget->clear();
+	}
 }
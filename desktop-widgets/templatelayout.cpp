@@ -215,11 +215,19 @@ void TemplateLayout::writeTemplate(QString template_name, QString grantlee_templ
 	}
 }
 
+static QRegularExpression var(R"(\{\{\s*(\w+)\.(\w+)\s*(\|\s*(\w+))?\s*\}\})");	// Look for {{ stuff.stuff|stuff }}
+
 struct token stringToken(QString s)
 {
 	struct token newtoken;
 	newtoken.type = LITERAL;
 	newtoken.contents = s;
+
+	QRegularExpressionMatch match = var.match(s);
+	while (match.hasMatch()) {
+		newtoken.variables.push_back({ match.capturedStart(), match.capturedEnd(), match.captured(1), match.captured(2) });
+		match = var.match(s, match.capturedEnd());
+	}
 	return newtoken;
 }
 
@@ -294,23 +302,18 @@ QList<token> TemplateLayout::lexer(QString input)
 	return tokenList;
 }
 
-static QRegularExpression var(R"(\{\{\s*(\w+)\.(\w+)\s*(\|\s*(\w+))?\s*\}\})");	// Look for {{ stuff.stuff|stuff }}
-
-QString TemplateLayout::translate(QString s, QHash<QString, QVariant> options)
+QString TemplateLayout::translate(const token &t, const QHash<QString, QVariant> &options)
 {
+	const QString &s = t.contents;
 	QString out;
 	int last = 0;
-	QRegularExpressionMatch match = var.match(s);
-	while (match.hasMatch()) {
-		QString obname = match.captured(1);
-		QString memname = match.captured(2);
-		out +=  s.mid(last, match.capturedStart() - last);
-		QVariant value = getValue(obname, memname, options.value(obname));
+	for (const template_variable &v: t.variables) {
+		out += s.midRef(last, v.start - last);
+		QVariant value = getValue(v.object, v.member, options.value(v.object));
 		out += value.toString();
-		last = match.capturedEnd();
-		match = var.match(s, last);
+		last = v.end;
 	}
-	out += s.mid(last);
+	out += s.midRef(last);
 	return out;
 }
 
@@ -322,7 +325,7 @@ void TemplateLayout::parser(QList<token> tokenList, int &pos, QTextStream &out,
 	while (pos < tokenList.length()) {
 		switch (tokenList[pos].type) {
 		case LITERAL:
-			out << translate(tokenList[pos].contents, options);
+			out << translate(tokenList[pos], options);
 			++pos;
 			break;
 		case BLOCKSTART:
@@ -485,7 +488,10 @@ QVariant TemplateLayout::getValue(QString list, QString property, QVariant optio
 			return object.gasMix;
 		}
 	} else if (list == "dive") {
-		DiveObjectHelperGrantlee object = option.value<DiveObjectHelperGrantlee>();
+		// Don't copy the whole helper with all its strings for every single expression
+		DiveObjectHelperGrantlee empty;
+		const DiveObjectHelperGrantlee &object = option.userType() == qMetaTypeId<DiveObjectHelperGrantlee>() ?
+			*static_cast<const DiveObjectHelperGrantlee *>(option.constData()) : empty;
 		if (property == "number") {
 			return object.number;
 		} else if (property == "id") {
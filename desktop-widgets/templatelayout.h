@@ -17,9 +17,17 @@ void copy_bundled_templates(QString src, QString dst, QStringList *templateBacku
 
 enum token_t {LITERAL, FORSTART, FORSTOP, BLOCKSTART, BLOCKSTOP, IFSTART, IFSTOP, PARSERERROR};
 
+// A {{ object.member }} expression inside a literal token
+struct template_variable {
+	int start, end;
+	QString object;
+	QString member;
+};
+
 struct token {
 	enum token_t type;
 	QString contents;
+	QVector<template_variable> variables; // found when lexing, so that loops don't search them again
 };
 
 extern QList<QString> grantlee_templates, grantlee_statistics_templates;
@@ -39,7 +47,7 @@ private:
 	QList<token> lexer(QString input);
 	void parser(QList<token> tokenList, int &pos, QTextStream &out, QHash<QString, QVariant> options);
 	QVariant getValue(QString list, QString property, QVariant option);
-	QString translate(QString s, QHash<QString, QVariant> options);
+	QString translate(const token &t, const QHash<QString, QVariant> &options);
 
 
 
@@ -62,6 +62,7 @@ int main(int argc, char **argv)
 	hes.exportPhotos = true;
 	hes.selectedOnly = false;
 	hes.listOnly = false;
+	hes.maxSamples = 0;
 	hes.yearlyStatistics = true;
 	hes.subsurfaceNumbers = true;
 	exportHtmlInitLogic(output, hes);
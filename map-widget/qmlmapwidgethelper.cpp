@@ -2,6 +2,7 @@
 #include <QApplication>
 #include <QClipboard>
 #include <QDebug>
+#include <QHash>
 #include <QVector>
 
 #include "qmlmapwidgethelper.h"
@@ -167,17 +168,24 @@ void MapWidgetHelper::selectVisibleLocations()
 	int idx;
 	struct dive *dive;
 	QList<int> selectedDiveIds;
+	// Many dives share a dive site. Calling into QML is expensive,
+	// so only check the visibility once per dive site.
+	QHash<const dive_site *, bool> visibleSites;
 	for_each_dive (idx, dive) {
 		struct dive_site *ds = get_dive_site_for_dive(dive);
 		if (!dive_site_has_gps_location(ds))
 			continue;
-		const qreal latitude = ds->location.lat.udeg * 0.000001;
-		const qreal longitude = ds->location.lon.udeg * 0.000001;
-		QGeoCoordinate dsCoord(latitude, longitude);
-		QPointF point;
-		QMetaObject::invokeMethod(m_map, "fromCoordinate", Q_RETURN_ARG(QPointF, point),
-		                          Q_ARG(QGeoCoordinate, dsCoord));
-		if (!qIsNaN(point.x()))
+		auto it = visibleSites.find(ds);
+		if (it == visibleSites.end()) {
+			const qreal latitude = ds->location.lat.udeg * 0.000001;
+			const qreal longitude = ds->location.lon.udeg * 0.000001;
+			QGeoCoordinate dsCoord(latitude, longitude);
+			QPointF point;
+			QMetaObject::invokeMethod(m_map, "fromCoordinate", Q_RETURN_ARG(QPointF, point),
+			                          Q_ARG(QGeoCoordinate, dsCoord));
+			it = visibleSites.insert(ds, !qIsNaN(point.x()));
+		}
+		if (*it)
 #ifndef SUBSURFACE_MOBILE // indices on desktop
 			selectedDiveIds.append(idx);
 	}
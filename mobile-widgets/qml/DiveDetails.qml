@@ -393,6 +393,10 @@ Kirigami.Page {
 			clip: true
 			snapMode: ListView.SnapOneItem
 			highlightRangeMode: ListView.StrictlyEnforceRange
+			// keep the two dives on either side instantiated, so that their profiles
+			// are already plotted and painted when swiping to them. Release them
+			// while the app is in the background.
+			cacheBuffer: Qt.application.state === Qt.ApplicationActive ? width * 2 : 0
 			onMovementEnded: {
 				currentIndex = indexAt(contentX+1, 1);
 				manager.selectSwipeRow(currentIndex)
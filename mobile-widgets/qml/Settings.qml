@@ -61,6 +61,18 @@ TemplatePage {
 					text: describe[Backend.cloud_verification_status]
 					Layout.preferredHeight: Kirigami.Units.gridUnit * 1.5
 				}
+				TemplateLabel {
+					text: qsTr("Metered connection (push changes at most once per hour)")
+					Layout.fillWidth: true
+					Layout.columnSpan: 2
+				}
+				SsrfSwitch {
+					id: meteredConnectionButton
+					checked: PrefCloudStorage.cloud_metered_connection
+					onClicked: {
+						PrefCloudStorage.cloud_metered_connection = checked
+					}
+				}
 			}
 			TemplateLine {
 				visible: sectionGeneral.isExpanded
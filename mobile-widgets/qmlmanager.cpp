@@ -33,8 +33,10 @@
 #include "core/qthelper.h"
 #include "core/qt-gui.h"
 #include "core/git-access.h"
+#include "core/checkcloudconnection.h"
 #include "core/cloudstorage.h"
 #include "core/membuffer.h"
+#include "core/memorystatistics.h"
 #include "core/downloadfromdcthread.h"
 #include "core/subsurfacestartup.h" // for ignore_bt flag
 #include "core/subsurface-string.h"
@@ -42,12 +44,14 @@
 #include "core/selection.h"
 #include "core/ssrf.h"
 #include "core/save-profiledata.h"
+#include "core/settings/qPref.h"
 #include "core/settings/qPrefLog.h"
 #include "core/settings/qPrefLocationService.h"
 #include "core/settings/qPrefTechnicalDetails.h"
 #include "core/settings/qPrefPartialPressureGas.h"
 #include "core/settings/qPrefUnit.h"
 #include "core/subsurface-qt/diveobjecthelper.h"
+#include "core/trace.h"
 #include "core/trip.h"
 #include "backend-shared/exportfuncs.h"
 #include "core/worldmap-save.h"
@@ -320,6 +324,11 @@ QMLManager::QMLManager() : m_locationServiceEnabled(false),
 	if (verbose)
 		connect(&diveListNotifier, &DiveListNotifier::divesChanged, this, &QMLManager::divesChanged);
 
+	// the completion lists are updated by the models when dives are edited
+	connect(&buddyModel, &QAbstractItemModel::modelReset, this, &QMLManager::buddyListChanged);
+	connect(&suitModel, &QAbstractItemModel::modelReset, this, &QMLManager::suitListChanged);
+	connect(&divemasterModel, &QAbstractItemModel::modelReset, this, &QMLManager::divemasterListChanged);
+
 	// get updates to the undo/redo texts
 	connect(Command::getUndoStack(), &QUndoStack::undoTextChanged, this, &QMLManager::undoTextChanged);
 	connect(Command::getUndoStack(), &QUndoStack::redoTextChanged, this, &QMLManager::redoTextChanged);
@@ -350,6 +359,10 @@ void QMLManager::applicationStateChanged(Qt::ApplicationState state)
 		finishSetup();
 		appInitialized();
 	}
+	// the app may be killed without being asked in the background
+	if (state != Qt::ApplicationActive)
+		qPref::flush();
+
 	if (state == Qt::ApplicationInactive && unsavedChanges()) {
 		// saveChangesCloud ensures that we don't have two conflicting saves going on
 		appendTextToLog("trying to save data as user switched away from app");
@@ -452,9 +465,9 @@ void QMLManager::selectSwipeRow(int row)
 
 void QMLManager::updateAllGlobalLists()
 {
-	buddyModel.updateModel(); emit buddyListChanged();
-	suitModel.updateModel(); emit suitListChanged();
-	divemasterModel.updateModel(); emit divemasterListChanged();
+	buddyModel.updateModel();
+	suitModel.updateModel();
+	divemasterModel.updateModel();
 	// TODO: It would be nice if we could export the list of locations via model/view instead of a Q_PROPERTY
 	emit locationListChanged();
 }
@@ -511,6 +524,16 @@ QString QMLManager::getCombinedLogs()
 		copyString += in.readAll();
 	}
 
+	// Add heading and append the performance counters
+	char *statistics = trace_statistics();
+	copyString += "\n\n\n---------- performance counters ----------\n";
+	copyString += statistics;
+	free(statistics);
+	char *memory = memory_statistics();
+	copyString += "\n---------- memory ----------\n";
+	copyString += memory;
+	free(memory);
+
 	copyString += "---------- finish ----------\n";
 
 #if defined(Q_OS_ANDROID)
@@ -538,7 +561,21 @@ void QMLManager::finishSetup()
 	if (!qPrefCloudStorage::cloud_storage_email().isEmpty() &&
 	    !qPrefCloudStorage::cloud_storage_password().isEmpty() &&
 	    getCloudURL(url) == 0) {
-		openLocalThenRemote(url);
+		if (git_local_only || m_oldStatus == qPrefCloudStorage::CS_NOCLOUD) {
+			openLocalThenRemote(url);
+		} else {
+			// Show the dives of the local cache right away and sync with the
+			// cloud afterwards. If the cloud has newer data, only the dives
+			// that changed are parsed again when reloading.
+			// Check the connection while the local cache is read
+			if (qPrefCloudStorage::cloud_verification_status() == qPrefCloudStorage::CS_VERIFIED)
+				checkCloudConnectionInBackground();
+			git_local_only = true;
+			openLocalThenRemote(url);
+			git_local_only = false;
+			if (qPrefCloudStorage::cloud_verification_status() == qPrefCloudStorage::CS_VERIFIED)
+				QTimer::singleShot(0, this, &QMLManager::loadDivesWithValidCredentials);
+		}
 	} else if (!empty_string(existing_filename) &&
 		   qPrefCloudStorage::cloud_verification_status() != qPrefCloudStorage::CS_UNKNOWN) {
 		rememberOldStatus();
@@ -665,6 +702,11 @@ bool QMLManager::verifyCredentials(QString email, QString password, QString pin)
 		appendTextToLog(QStringLiteral("verify credentials for email %1 (no PIN)").arg(email));
 	else
 		appendTextToLog(QStringLiteral("verify credentials for email %1 PIN %2").arg(email, pin));
+	// Don't wait for a server that just failed to answer
+	if (cloudRecentlyUnreachable()) {
+		setStartPageText(RED_FONT + tr("No response from cloud server to validate the credentials") + END_FONT);
+		return false;
+	}
 	CloudStorageAuthenticate *csa = new CloudStorageAuthenticate(this);
 	csa->backend(email, password, pin);
 	// let's wait here for the signal to avoid too many more nested functions
@@ -677,6 +719,7 @@ bool QMLManager::verifyCredentials(QString email, QString password, QString pin)
 	loop.exec();
 	if (!myTimer.isActive()) {
 		// got no response from the server
+		rememberCloudConnection(false);
 		setStartPageText(RED_FONT + tr("No response from cloud server to validate the credentials") + END_FONT);
 		return false;
 	}
@@ -719,19 +762,26 @@ void QMLManager::loadDivesWithValidCredentials()
 		appendTextToLog("Cloud sync brought newer data, reloading the dive list");
 		setDiveListProcessing(true);
 		// if we aren't switching from no-cloud mode, let's clear the dive data
+		// but keep the old dives around, so that unchanged dives don't have to be parsed again
+		struct dive_table old_dives = empty_dive_table;
+		struct trip_table old_trips = empty_trip_table;
+		struct dive_site_table old_sites = empty_dive_site_table;
 		if (!noCloudToCloud) {
 			appendTextToLog("Clear out in memory dive data");
-			clear_dive_file_data();
+			detach_dive_file_data(&old_dives, &old_trips, &old_sites);
 		} else {
 			appendTextToLog("Switching from no cloud mode; keep in memory dive data");
 		}
 		if (git != dummy_git_repository) {
 			appendTextToLog(QString("have repository and branch %1").arg(branch));
-			error = git_load_dives(git, branch, &dive_table, &trip_table, &dive_site_table, &device_table, &filter_preset_table);
+			int nr_old = old_dives.nr;
+			error = git_load_dives_reuse(git, branch, &old_dives, &dive_table, &trip_table, &dive_site_table, &device_table, &filter_preset_table);
+			appendTextToLog(QString("reused %1 unchanged dives").arg(nr_old - old_dives.nr));
 		} else {
 			appendTextToLog(QString("didn't receive valid git repo, try again"));
 			error = parse_file(fileNamePrt.data(), &dive_table, &trip_table, &dive_site_table, &device_table, &filter_preset_table);
 		}
+		clear_detached_dive_file_data(&old_dives, &old_trips, &old_sites);
 		setDiveListProcessing(false);
 		if (!error) {
 			report_error("filename is now %s", fileNamePrt.data());
@@ -1156,22 +1206,19 @@ void QMLManager::commitChanges(QString diveId, QString number, QString date, QSt
 	// info for first cylinder
 	if (myDive.getCylinder != usedCylinder) {
 		diveChanged = true;
-		unsigned long i;
 		int size = 0, wp = 0, j = 0, k = 0;
 		for (j = 0; k < usedCylinder.length(); j++) {
 			if (state != "add" && !is_cylinder_used(d, j))
 				continue;
 
-			for (i = 0; i < MAX_TANK_INFO && tank_info[i].name != NULL; i++) {
-				if (tank_info[i].name == usedCylinder[k] ) {
-					if (tank_info[i].ml > 0){
-						size = tank_info[i].ml;
-						wp = tank_info[i].bar * 1000;
-					} else {
-						size = (int) (cuft_to_l(tank_info[i].cuft) * 1000 / bar_to_atm(psi_to_bar(tank_info[i].psi)));
-						wp = psi_to_mbar(tank_info[i].psi);
-					}
-					break;
+			int i = find_tank_info(usedCylinder[k].toUtf8().constData());
+			if (i >= 0) {
+				if (tank_info[i].ml > 0){
+					size = tank_info[i].ml;
+					wp = tank_info[i].bar * 1000;
+				} else {
+					size = (int) (cuft_to_l(tank_info[i].cuft) * 1000 / bar_to_atm(psi_to_bar(tank_info[i].psi)));
+					wp = psi_to_mbar(tank_info[i].psi);
 				}
 			}
 			get_or_create_cylinder(d, j)->type.description = copy_qstring(usedCylinder[k]);
@@ -1322,7 +1369,7 @@ void QMLManager::changesNeedSaving()
 #else
 	saveChangesCloud(false);
 #endif
-	updateAllGlobalLists();
+	emit locationListChanged();
 }
 
 void QMLManager::openNoCloudRepo()
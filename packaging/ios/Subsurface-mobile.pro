@@ -58,12 +58,16 @@ SOURCES += ../../subsurface-mobile-main.cpp \
 	../../core/divecomputer.c \
 	../../core/divefilter.cpp \
 	../../core/event.c \
+	../../core/eventname.cpp \
 	../../core/filterconstraint.cpp \
 	../../core/filterpreset.cpp \
 	../../core/divelist.c \
 	../../core/gas-model.c \
 	../../core/gaspressures.c \
 	../../core/git-access.c \
+	../../core/git-snapshot.c \
+	../../core/gitbackgroundsync.cpp \
+	../../core/gitmaintenance.cpp \
 	../../core/liquivision.c \
 	../../core/load-git.c \
 	../../core/parse-xml.c \
@@ -86,19 +90,28 @@ SOURCES += ../../subsurface-mobile-main.cpp \
 	../../core/datatrak.c \
 	../../core/ostctools.c \
 	../../core/planner.c \
+	../../core/planseries.cpp \
 	../../core/save-xml.c \
 	../../core/cochran.c \
 	../../core/deco.c \
+	../../core/decochain.cpp \
 	../../core/divesite.c \
 	../../core/equipment.c \
 	../../core/gas.c \
 	../../core/membuffer.c \
+	../../core/localfilenamestore.cpp \
+	../../core/memorystatistics.cpp \
+	../../core/parallel.cpp \
+	../../core/rawdivecache.cpp \
 	../../core/selection.cpp \
 	../../core/sha1.c \
 	../../core/strtod.c \
+	../../core/tablesnapshot.cpp \
 	../../core/tag.c \
+	../../core/taskqueue.cpp \
 	../../core/taxonomy.c \
 	../../core/time.c \
+	../../core/trace.cpp \
 	../../core/trip.c \
 	../../core/units.c \
 	../../core/uemis.c \
@@ -210,8 +223,10 @@ HEADERS += \
 	../../core/dive.h \
 	../../core/divecomputer.h \
 	../../core/event.h \
+	../../core/eventname.h \
 	../../core/extradata.h \
 	../../core/git-access.h \
+	../../core/git-snapshot.h \
 	../../core/gpslocation.h \
 	../../core/imagedownloader.h \
 	../../core/pref.h \
@@ -224,6 +239,7 @@ HEADERS += \
 	../../core/picture.h \
 	../../core/pictureobj.h \
 	../../core/planner.h \
+	../../core/planseries.h \
 	../../core/divesite.h \
 	../../core/checkcloudconnection.h \
 	../../core/cochran.h \
@@ -231,6 +247,7 @@ HEADERS += \
 	../../core/configuredivecomputer.h \
 	../../core/datatrak.h \
 	../../core/deco.h \
+	../../core/decochain.h \
 	../../core/display.h \
 	../../core/divefilter.h \
 	../../core/filterconstraint.h \
@@ -245,7 +262,11 @@ HEADERS += \
 	../../core/gettext.h \
 	../../core/gettextfromc.h \
 	../../core/membuffer.h \
+	../../core/localfilenamestore.h \
+	../../core/memorystatistics.h \
 	../../core/metrics.h \
+	../../core/parallel.h \
+	../../core/rawdivecache.h \
 	../../core/qt-gui.h \
 	../../core/sample.h \
 	../../core/selection.h \
@@ -253,7 +274,10 @@ HEADERS += \
 	../../core/strndup.h \
 	../../core/subsurfacestartup.h \
 	../../core/subsurfacesysinfo.h \
+	../../core/tablesnapshot.h \
+	../../core/taskqueue.h \
 	../../core/taxonomy.h \
+	../../core/trace.h \
 	../../core/uemis.h \
 	../../core/webservice.h \
 	../../core/windowtitleupdate.h \
@@ -10,6 +10,7 @@
 #include "profile-widget/animationfunctions.h"
 #include "profile-widget/divelineitem.h"
 #include "profile-widget/profilewidget2.h"
+#include <algorithm>
 
 QPen DiveCartesianAxis::gridPen()
 {
@@ -77,7 +78,8 @@ DiveCartesianAxis::DiveCartesianAxis(ProfileWidget2 *widget) : QObject(),
 	lineVisibility(true),
 	labelScale(1.0),
 	line_size(1),
-	changed(true)
+	changed(true),
+	ticks(0)
 {
 	setPen(gridPen());
 }
@@ -109,9 +111,8 @@ void DiveCartesianAxis::setTextVisible(bool arg1)
 		return;
 	}
 	textVisibility = arg1;
-	Q_FOREACH (DiveTextItem *item, labels) {
-		item->setVisible(textVisibility);
-	}
+	for (int i = 0; i < ticks && i < labels.size(); i++)
+		labels[i]->setVisible(textVisibility);
 }
 
 void DiveCartesianAxis::setLinesVisible(bool arg1)
@@ -120,18 +121,8 @@ void DiveCartesianAxis::setLinesVisible(bool arg1)
 		return;
 	}
 	lineVisibility = arg1;
-	Q_FOREACH (DiveLineItem *item, lines) {
-		item->setVisible(lineVisibility);
-	}
-}
-
-template <typename T>
-void emptyList(QList<T *> &list, int steps, int speed)
-{
-	while (list.size() > steps) {
-		T *removedItem = list.takeLast();
-		Animations::animDelete(removedItem, speed);
-	}
+	for (int i = 0; i < ticks && i < lines.size(); i++)
+		lines[i]->setVisible(lineVisibility);
 }
 
 void DiveCartesianAxis::updateTicks(color_index_t color)
@@ -149,8 +140,14 @@ void DiveCartesianAxis::updateTicks(color_index_t color)
 	if (steps < 1)
 		return;
 
-	emptyList(labels, steps, profileWidget->animSpeed);
-	emptyList(lines, steps, profileWidget->animSpeed);
+	// Labels and lines that are not needed anymore are only hidden,
+	// they will be reused when zooming out again.
+	for (int i = steps; i < labels.size(); i++)
+		labels[i]->setVisible(false);
+	for (int i = steps; i < lines.size(); i++)
+		lines[i]->setVisible(false);
+	int oldTicks = ticks;
+	ticks = steps;
 
 	// Move the remaining ticks / text to their correct positions
 	// regarding the possible new values for the axis
@@ -170,25 +167,36 @@ void DiveCartesianAxis::updateTicks(color_index_t color)
 	}
 	stepSize /= stepsInRange;
 
-	for (int i = 0, count = labels.size(); i < count; i++, currValueText += interval) {
+	for (int i = 0, count = std::min(labels.size(), steps); i < count; i++, currValueText += interval) {
 		qreal childPos = (orientation == TopToBottom || orientation == LeftToRight) ?
 					 begin + i * stepSize :
 					 begin - i * stepSize;
 
 		labels[i]->setText(textForValue(currValueText));
-		if (orientation == LeftToRight || orientation == RightToLeft) {
+		// Pooled labels reappear at their last position instead of flying in
+		if (i >= oldTicks) {
+			if (orientation == LeftToRight || orientation == RightToLeft)
+				labels[i]->setPos(childPos, m.y1() + tick_size);
+			else
+				labels[i]->setPos(m.x1() - tick_size, childPos);
+		} else if (orientation == LeftToRight || orientation == RightToLeft) {
 			Animations::moveTo(labels[i], profileWidget->animSpeed, childPos, m.y1() + tick_size);
 		} else {
 			Animations::moveTo(labels[i], profileWidget->animSpeed ,m.x1() - tick_size, childPos);
 		}
 	}
 
-	for (int i = 0, count = lines.size(); i < count; i++, currValueLine += interval) {
+	for (int i = 0, count = std::min(lines.size(), steps); i < count; i++, currValueLine += interval) {
 		qreal childPos = (orientation == TopToBottom || orientation == LeftToRight) ?
 					 begin + i * stepSize :
 					 begin - i * stepSize;
 
-		if (orientation == LeftToRight || orientation == RightToLeft) {
+		if (i >= oldTicks) {
+			if (orientation == LeftToRight || orientation == RightToLeft)
+				lines[i]->setPos(childPos, m.y1());
+			else
+				lines[i]->setPos(m.x1(), childPos);
+		} else if (orientation == LeftToRight || orientation == RightToLeft) {
 			Animations::moveTo(lines[i], profileWidget->animSpeed, childPos, m.y1());
 		} else {
 			Animations::moveTo(lines[i], profileWidget->animSpeed, m.x1(), childPos);
@@ -247,10 +255,10 @@ void DiveCartesianAxis::updateTicks(color_index_t color)
 		}
 	}
 
-	Q_FOREACH (DiveTextItem *item, labels)
-		item->setVisible(textVisibility);
-	Q_FOREACH (DiveLineItem *item, lines)
-		item->setVisible(lineVisibility);
+	for (int i = 0; i < ticks; i++) {
+		labels[i]->setVisible(textVisibility);
+		lines[i]->setVisible(lineVisibility);
+	}
 	changed = false;
 }
 
@@ -403,7 +411,7 @@ void TimeAxis::updateTicks(color_index_t color)
 {
 	DiveCartesianAxis::updateTicks(color);
 	if (maximum() > 600) {
-		for (int i = 0; i < labels.count(); i++) {
+		for (int i = 0; i < ticks; i++) {
 			labels[i]->setVisible(i % 2);
 		}
 	}
@@ -75,6 +75,7 @@ protected:
 	double labelScale;
 	qreal line_size;
 	bool changed;
+	int ticks;			// labels and lines in use, the others are hidden
 };
 
 class DepthAxis : public DiveCartesianAxis {
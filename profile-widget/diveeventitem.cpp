@@ -12,13 +12,18 @@
 #include "core/sample.h"
 #include "core/subsurface-string.h"
 
+#include <QHash>
+#include <QPair>
+
 #define DEPTH_NOT_FOUND (-2342)
 
 DiveEventItem::DiveEventItem(QGraphicsItem *parent) : DivePixmapItem(parent),
 	vAxis(NULL),
 	hAxis(NULL),
 	dataModel(NULL),
-	internalEvent(NULL)
+	internalEvent(NULL),
+	lastGasmix(gasmix_air),
+	toolTipValid(false)
 {
 	setFlag(ItemIgnoresTransformations);
 }
@@ -60,12 +65,36 @@ void DiveEventItem::setEvent(struct event *ev, struct gasmix lastgasmix)
 
 	free(internalEvent);
 	internalEvent = clone_event(ev);
-	setupPixmap(lastgasmix);
-	setupToolTipString(lastgasmix);
+	lastGasmix = lastgasmix;
+	setupPixmap();
+	// The tooltip is only needed when the mouse hovers over the event
+	setToolTip(QString());
+	toolTipValid = false;
 	recalculatePos(0);
 }
 
-void DiveEventItem::setupPixmap(struct gasmix lastgasmix)
+void DiveEventItem::prepareToolTip()
+{
+	if (toolTipValid || !internalEvent)
+		return;
+	setupToolTipString();
+	toolTipValid = true;
+}
+
+// Dives with many events use the same few icons over and over
+static QPixmap eventPixmap(const char *name, int size)
+{
+	static QHash<QPair<QString, int>, QPixmap> cache;
+	QPair<QString, int> key(QString(name), size);
+	auto it = cache.constFind(key);
+	if (it != cache.cend())
+		return *it;
+	QPixmap pixmap = QPixmap(key.first).scaled(size, size, Qt::KeepAspectRatio, Qt::SmoothTransformation);
+	cache.insert(key, pixmap);
+	return pixmap;
+}
+
+void DiveEventItem::setupPixmap()
 {
 	const IconMetrics& metrics = defaultIconMetrics();
 #ifndef SUBSURFACE_MOBILE
@@ -82,8 +111,8 @@ void DiveEventItem::setupPixmap(struct gasmix lastgasmix)
 #endif
 	int sz_pix = sz_bigger/2; // ex 20px
 
-#define EVENT_PIXMAP(PIX) QPixmap(QString(PIX)).scaled(sz_pix, sz_pix, Qt::KeepAspectRatio, Qt::SmoothTransformation)
-#define EVENT_PIXMAP_BIGGER(PIX) QPixmap(QString(PIX)).scaled(sz_bigger, sz_bigger, Qt::KeepAspectRatio, Qt::SmoothTransformation)
+#define EVENT_PIXMAP(PIX) eventPixmap(PIX, sz_pix)
+#define EVENT_PIXMAP_BIGGER(PIX) eventPixmap(PIX, sz_bigger)
 	if (empty_string(internalEvent->name)) {
 		setPixmap(EVENT_PIXMAP(":status-warning-icon"));
 	} else if (same_string_caseinsensitive(internalEvent->name, "modechange")) {
@@ -96,7 +125,7 @@ void DiveEventItem::setupPixmap(struct gasmix lastgasmix)
 	} else if (event_is_gaschange(internalEvent)) {
 		struct gasmix mix = get_gasmix_from_event(&displayed_dive, internalEvent);
 		struct icd_data icd_data;
-		bool icd = isobaric_counterdiffusion(lastgasmix, mix, &icd_data);
+		bool icd = isobaric_counterdiffusion(lastGasmix, mix, &icd_data);
 		if (mix.he.permille) {
 			if (icd)
 				setPixmap(EVENT_PIXMAP_BIGGER(":gaschange-trimix-ICD-icon"));
@@ -167,7 +196,7 @@ void DiveEventItem::setupPixmap(struct gasmix lastgasmix)
 #undef EVENT_PIXMAP_BIGGER
 }
 
-void DiveEventItem::setupToolTipString(struct gasmix lastgasmix)
+void DiveEventItem::setupToolTipString()
 {
 	// we display the event on screen - so translate
 	QString name = gettextFromC::tr(internalEvent->name);
@@ -184,7 +213,7 @@ void DiveEventItem::setupToolTipString(struct gasmix lastgasmix)
 		/* Do we have an explicit cylinder index?  Show it. */
 		if (internalEvent->gas.index >= 0)
 			name += tr(" (cyl. %1)").arg(internalEvent->gas.index + 1);
-		bool icd = isobaric_counterdiffusion(lastgasmix, mix, &icd_data);
+		bool icd = isobaric_counterdiffusion(lastGasmix, mix, &icd_data);
 		if (icd_data.dHe < 0) {
 			put_format(&mb, "\n%s %s:%+.3g%% %s:%+.3g%%%s%+.3g%%",
 				qPrintable(tr("ICD")),
@@ -258,13 +287,13 @@ bool DiveEventItem::shouldBeHidden()
 
 int DiveEventItem::depthAtTime(int time)
 {
-	QModelIndexList result = dataModel->match(dataModel->index(0, DivePlotDataModel::TIME), Qt::DisplayRole, time);
-	if (result.isEmpty()) {
+	int row = dataModel->rowAtTime(time);
+	if (row < 0) {
 		qWarning("can't find a spot in the dataModel");
 		hide();
 		return DEPTH_NOT_FOUND;
 	}
-	return dataModel->data(dataModel->index(result.first().row(), DivePlotDataModel::DEPTH)).toInt();
+	return dataModel->data().entry[row].depth;
 }
 
 void DiveEventItem::recalculatePos(int speed)
@@ -272,12 +301,6 @@ void DiveEventItem::recalculatePos(int speed)
 	if (!vAxis || !hAxis || !internalEvent || !dataModel)
 		return;
 
-	QModelIndexList result = dataModel->match(dataModel->index(0, DivePlotDataModel::TIME), Qt::DisplayRole, internalEvent->time.seconds);
-	if (result.isEmpty()) {
-		qWarning("can't find a spot in the dataModel");
-		hide();
-		return;
-	}
 	int depth = depthAtTime(internalEvent->time.seconds);
 	if (depth == DEPTH_NOT_FOUND)
 		return;
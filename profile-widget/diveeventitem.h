@@ -3,6 +3,7 @@
 #define DIVEEVENTITEM_H
 
 #include "divepixmapitem.h"
+#include "core/gas.h"
 
 class DiveCartesianAxis;
 class DivePlotDataModel;
@@ -20,18 +21,21 @@ public:
 	void setHorizontalAxis(DiveCartesianAxis *axis);
 	void setModel(DivePlotDataModel *model);
 	bool shouldBeHidden();
+	void prepareToolTip();
 public
 slots:
 	void recalculatePos(int animationSpeed);
 
 private:
-	void setupToolTipString(struct gasmix lastgasmix);
-	void setupPixmap(struct gasmix lastgasmix);
+	void setupToolTipString();
+	void setupPixmap();
 	int depthAtTime(int time);
 	DiveCartesianAxis *vAxis;
 	DiveCartesianAxis *hAxis;
 	DivePlotDataModel *dataModel;
 	struct event *internalEvent;
+	struct gasmix lastGasmix;	// before the event
+	bool toolTipValid;
 };
 
 #endif // DIVEEVENTITEM_H
@@ -15,6 +15,9 @@
 #include "libdivecomputer/parser.h"
 #include "profile-widget/profilewidget2.h"
 
+#include <algorithm>
+#include <cmath>
+
 AbstractProfilePolygonItem::AbstractProfilePolygonItem() : QObject(), QGraphicsPolygonItem(), hAxis(NULL), vAxis(NULL), dataModel(NULL), hDataColumn(-1), vDataColumn(-1)
 {
 	setCacheMode(DeviceCoordinateCache);
@@ -27,6 +30,46 @@ void AbstractProfilePolygonItem::settingsChanged()
 {
 }
 
+// For every device pixel column, keep only the first, lowest, highest and last point.
+// Drawing these results in the same line as drawing all points.
+static QPolygonF decimatePolyline(const QPolygonF &poly, const QTransform &transform)
+{
+	QPolygonF res;
+	for (int i = 0, count = poly.count(); i < count; ) {
+		int column = (int)floor(transform.map(poly[i]).x());
+		int first = i, min = i, max = i;
+		for (++i; i < count && (int)floor(transform.map(poly[i]).x()) == column; ++i) {
+			if (poly[i].y() < poly[min].y())
+				min = i;
+			if (poly[i].y() > poly[max].y())
+				max = i;
+		}
+		// Add the points in their original order, without duplicates
+		int prev = -1;
+		for (int idx: { first, std::min(min, max), std::max(min, max), i - 1 }) {
+			if (idx != prev)
+				res.append(poly[idx]);
+			prev = idx;
+		}
+	}
+	return res;
+}
+
+// Long dives have many more samples than the profile has pixels. Since drawing
+// a polyline takes time proportional to the number of points, draw the decimated
+// polygon. It only has to be recalculated when the data or the zoom changes.
+void AbstractProfilePolygonItem::drawDecimatedPolyline(QPainter *painter)
+{
+	const QPolygonF poly = polygon();
+	const QTransform &transform = painter->worldTransform();
+	if (poly != decimationSource || transform != decimationTransform) {
+		decimationSource = poly;
+		decimationTransform = transform;
+		decimatedPolygon = decimatePolyline(poly, transform);
+	}
+	painter->drawPolyline(decimatedPolygon);
+}
+
 void AbstractProfilePolygonItem::setVisible(bool visible)
 {
 	QGraphicsPolygonItem::setVisible(visible);
@@ -100,8 +143,8 @@ void AbstractProfilePolygonItem::modelDataChanged(const QModelIndex&, const QMod
 	// to our coordinates, store. no painting is done here.
 	QPolygonF poly;
 	for (int i = 0, modelDataCount = dataModel->rowCount(); i < modelDataCount; i++) {
-		qreal horizontalValue = dataModel->index(i, hDataColumn).data().toReal();
-		qreal verticalValue = dataModel->index(i, vDataColumn).data().toReal();
+		qreal horizontalValue = dataModel->value(i, hDataColumn);
+		qreal verticalValue = dataModel->value(i, vDataColumn);
 		QPointF point(hAxis->posAtValue(horizontalValue), vAxis->posAtValue(verticalValue));
 		poly.append(point);
 	}
@@ -140,9 +183,9 @@ void DiveProfileItem::paint(QPainter *painter, const QStyleOptionGraphicsItem *o
 	pen.setWidth(2);
 	QPolygonF poly = polygon();
 	// This paints the colors of the velocities.
+	const plot_data *entry = dataModel->data().entry;
 	for (int i = 1, count = dataModel->rowCount(); i < count; i++) {
-		QModelIndex colorIndex = dataModel->index(i, DivePlotDataModel::COLOR);
-		pen.setBrush(QBrush(colorIndex.data(Qt::BackgroundRole).value<QColor>()));
+		pen.setBrush(QBrush(getColor((color_index_t)(VELOCITY_COLORS_START_IDX + entry[i].velocity))));
 		painter->setPen(pen);
 		if (i < poly.count())
 			painter->drawLine(poly[i - 1], poly[i]);
@@ -153,10 +196,11 @@ void DiveProfileItem::paint(QPainter *painter, const QStyleOptionGraphicsItem *o
 int DiveProfileItem::maxCeiling(int row)
 {
 	int max = -1;
-	plot_data *entry = dataModel->data().entry + row;
+	const plot_info &pInfo = dataModel->data();
 	for (int tissue = 0; tissue < 16; tissue++) {
-		if (max < entry->ceilings[tissue])
-			max = entry->ceilings[tissue];
+		int ceiling = get_plot_tissue_ceiling(&pInfo, row, tissue);
+		if (max < ceiling)
+			max = ceiling;
 	}
 	return max;
 }
@@ -288,10 +332,10 @@ void DiveHeartrateItem::modelDataChanged(const QModelIndex &topLeft, const QMode
 	// Ignore empty values. a heart rate of 0 would be a bad sign.
 	QPolygonF poly;
 	for (int i = 0, modelDataCount = dataModel->rowCount(); i < modelDataCount; i++) {
-		int hr = dataModel->index(i, vDataColumn).data().toInt();
+		int hr = (int)dataModel->value(i, vDataColumn);
 		if (!hr)
 			continue;
-		sec = dataModel->index(i, hDataColumn).data().toInt();
+		sec = (int)dataModel->value(i, hDataColumn);
 		QPointF point(hAxis->posAtValue(sec), vAxis->posAtValue(hr));
 		poly.append(point);
 		if (hr == hist[2].hr)
@@ -343,7 +387,7 @@ void DiveHeartrateItem::paint(QPainter *painter, const QStyleOptionGraphicsItem*
 		return;
 	painter->save();
 	painter->setPen(pen());
-	painter->drawPolyline(polygon());
+	drawDecimatedPolyline(painter);
 	painter->restore();
 }
 
@@ -365,12 +409,26 @@ void DivePercentageItem::modelDataChanged(const QModelIndex &topLeft, const QMod
 	// Ignore empty values. a heart rate of 0 would be a bad sign.
 	QPolygonF poly;
 	for (int i = 0, modelDataCount = dataModel->rowCount(); i < modelDataCount; i++) {
-		sec = dataModel->index(i, hDataColumn).data().toInt();
+		sec = (int)dataModel->value(i, hDataColumn);
 		QPointF point(hAxis->posAtValue(sec), vAxis->posAtValue(64 - 4 * tissueIndex));
 		poly.append(point);
 	}
 	setPolygon(poly);
 
+	// The colors only depend on the data, therefore calculate them here
+	// and not every time the item is painted.
+	struct gas_timeline gases;
+	init_gas_timeline(&gases, &displayed_dive, displayed_dc);
+	colors.resize(dataModel->rowCount());
+	for (int i = 1, modelDataCount = dataModel->rowCount(); i < modelDataCount; i++) {
+		double value = dataModel->value(i, vDataColumn);
+		sec = (int)dataModel->value(i, DivePlotDataModel::TIME);
+		struct gasmix gasmix = gasmix_in_timeline(&gases, sec);
+		int inert = get_n2(gasmix) + get_he(gasmix);
+		colors[i] = ColorScale(value, inert);
+	}
+	free_gas_timeline(&gases);
+
 	if (texts.count())
 		texts.last()->setAlignment(Qt::AlignLeft | Qt::AlignBottom);
 }
@@ -408,18 +466,10 @@ void DivePercentageItem::paint(QPainter *painter, const QStyleOptionGraphicsItem
 	mypen.setCapStyle(Qt::FlatCap);
 	mypen.setCosmetic(false);
 	QPolygonF poly = polygon();
-	for (int i = 1, modelDataCount = dataModel->rowCount(); i < modelDataCount; i++) {
-		if (i < poly.count()) {
-			double value = dataModel->index(i, vDataColumn).data().toDouble();
-			struct gasmix gasmix = gasmix_air;
-			const struct event *ev = NULL;
-			int sec = dataModel->index(i, DivePlotDataModel::TIME).data().toInt();
-			gasmix = get_gasmix(&displayed_dive, displayed_dc, sec, &ev, gasmix);
-			int inert = get_n2(gasmix) + get_he(gasmix);
-			mypen.setBrush(QBrush(ColorScale(value, inert)));
-			painter->setPen(mypen);
-			painter->drawLine(poly[i - 1], poly[i]);
-		}
+	for (int i = 1, count = std::min(poly.count(), colors.count()); i < count; i++) {
+		mypen.setBrush(QBrush(colors[i]));
+		painter->setPen(mypen);
+		painter->drawLine(poly[i - 1], poly[i]);
 	}
 	painter->restore();
 }
@@ -445,10 +495,10 @@ void DiveAmbPressureItem::modelDataChanged(const QModelIndex &topLeft, const QMo
 	// Ignore empty values. a heart rate of 0 would be a bad sign.
 	QPolygonF poly;
 	for (int i = 0, modelDataCount = dataModel->rowCount(); i < modelDataCount; i++) {
-		int hr = dataModel->index(i, vDataColumn).data().toInt();
+		int hr = (int)dataModel->value(i, vDataColumn);
 		if (!hr)
 			continue;
-		sec = dataModel->index(i, hDataColumn).data().toInt();
+		sec = (int)dataModel->value(i, hDataColumn);
 		QPointF point(hAxis->posAtValue(sec), vAxis->posAtValue(hr));
 		poly.append(point);
 	}
@@ -464,7 +514,7 @@ void DiveAmbPressureItem::paint(QPainter *painter, const QStyleOptionGraphicsIte
 		return;
 	painter->save();
 	painter->setPen(pen());
-	painter->drawPolyline(polygon());
+	drawDecimatedPolyline(painter);
 	painter->restore();
 	connect(qPrefTechnicalDetails::instance(), &qPrefTechnicalDetails::percentagegraphChanged, this, &DiveAmbPressureItem::setVisible);
 }
@@ -490,10 +540,10 @@ void DiveGFLineItem::modelDataChanged(const QModelIndex &topLeft, const QModelIn
 	// Ignore empty values. a heart rate of 0 would be a bad sign.
 	QPolygonF poly;
 	for (int i = 0, modelDataCount = dataModel->rowCount(); i < modelDataCount; i++) {
-		int hr = dataModel->index(i, vDataColumn).data().toInt();
+		int hr = (int)dataModel->value(i, vDataColumn);
 		if (!hr)
 			continue;
-		sec = dataModel->index(i, hDataColumn).data().toInt();
+		sec = (int)dataModel->value(i, hDataColumn);
 		QPointF point(hAxis->posAtValue(sec), vAxis->posAtValue(hr));
 		poly.append(point);
 	}
@@ -509,7 +559,7 @@ void DiveGFLineItem::paint(QPainter *painter, const QStyleOptionGraphicsItem*, Q
 		return;
 	painter->save();
 	painter->setPen(pen());
-	painter->drawPolyline(polygon());
+	drawDecimatedPolyline(painter);
 	painter->restore();
 	connect(qPrefTechnicalDetails::instance(), &qPrefTechnicalDetails::percentagegraphChanged, this, &DiveAmbPressureItem::setVisible);
 }
@@ -535,11 +585,11 @@ void DiveTemperatureItem::modelDataChanged(const QModelIndex &topLeft, const QMo
 	// Ignore empty values. things do not look good with '0' as temperature in kelvin...
 	QPolygonF poly;
 	for (int i = 0, modelDataCount = dataModel->rowCount(); i < modelDataCount; i++) {
-		int mkelvin = dataModel->index(i, vDataColumn).data().toInt();
+		int mkelvin = (int)dataModel->value(i, vDataColumn);
 		if (!mkelvin)
 			continue;
 		last_valid_temp = mkelvin;
-		sec = dataModel->index(i, hDataColumn).data().toInt();
+		sec = (int)dataModel->value(i, hDataColumn);
 		QPointF point(hAxis->posAtValue(sec), vAxis->posAtValue(mkelvin));
 		poly.append(point);
 
@@ -589,7 +639,7 @@ void DiveTemperatureItem::paint(QPainter *painter, const QStyleOptionGraphicsIte
 		return;
 	painter->save();
 	painter->setPen(pen());
-	painter->drawPolyline(polygon());
+	drawDecimatedPolyline(painter);
 	painter->restore();
 }
 
@@ -634,7 +684,7 @@ void DiveMeanDepthItem::paint(QPainter *painter, const QStyleOptionGraphicsItem*
 		return;
 	painter->save();
 	painter->setPen(pen());
-	painter->drawPolyline(polygon());
+	drawDecimatedPolyline(painter);
 	painter->restore();
 	connect(qPrefLog::instance(), &qPrefLog::show_average_depthChanged, this, &DiveAmbPressureItem::setVisible);
 }
@@ -959,8 +1009,8 @@ void PartialPressureGasItem::modelDataChanged(const QModelIndex &topLeft, const
 		threshold_min = *thresholdPtrMin;
 	bool inAlertFragment = false;
 	for (int i = 0; i < dataModel->rowCount(); i++, entry++) {
-		double value = dataModel->index(i, vDataColumn).data().toDouble();
-		int time = dataModel->index(i, hDataColumn).data().toInt();
+		double value = dataModel->value(i, vDataColumn);
+		int time = (int)dataModel->value(i, hDataColumn);
 		QPointF point(hAxis->posAtValue(time), vAxis->posAtValue(value));
 		poly.push_back(point);
 		if (thresholdPtrMax && value >= threshold_max) {
@@ -996,7 +1046,7 @@ void PartialPressureGasItem::paint(QPainter *painter, const QStyleOptionGraphics
 	const qreal pWidth = 0.0;
 	painter->save();
 	painter->setPen(QPen(normalColor, pWidth));
-	painter->drawPolyline(polygon());
+	drawDecimatedPolyline(painter);
 
 	QPolygonF poly;
 	painter->setPen(QPen(alertColor, pWidth));
@@ -5,6 +5,7 @@
 #include <QObject>
 #include <QGraphicsPolygonItem>
 #include <QModelIndex>
+#include <QTransform>
 
 #include "divelineitem.h"
 
@@ -58,6 +59,7 @@ protected:
 	 * 'do not recalculate, we already have the right data.
 	 */
 	bool shouldCalculateStuff(const QModelIndex &topLeft, const QModelIndex &bottomRight);
+	void drawDecimatedPolyline(QPainter *painter);
 
 	DiveCartesianAxis *hAxis;
 	DiveCartesianAxis *vAxis;
@@ -65,6 +67,10 @@ protected:
 	int hDataColumn;
 	int vDataColumn;
 	QList<DiveTextItem *> texts;
+private:
+	QPolygonF decimationSource;
+	QTransform decimationTransform;
+	QPolygonF decimatedPolygon;
 };
 
 class DiveProfileItem : public AbstractProfilePolygonItem {
@@ -131,6 +137,7 @@ public:
 private:
 	QString visibilityKey;
 	int tissueIndex;
+	QVector<QColor> colors; // Color of the line segment ending at each plot entry
 	QColor ColorScale(double value, int inert);
 
 };
@@ -7,6 +7,16 @@
 #include <QBrush>
 #include <QDebug>
 #include <QApplication>
+#include <QHash>
+
+// The axes show the same labels over and over again, therefore the paths of
+// the texts are shared by all items. Indexed by text, font and alignment.
+struct TextLayout {
+	QPainterPath text;
+	QPainterPath background;
+};
+static QHash<QString, TextLayout> textLayouts;
+static const int maxTextLayouts = 2000;
 
 DiveTextItem::DiveTextItem(QGraphicsItem *parent) : QGraphicsItemGroup(parent),
 	internalAlignFlags(Qt::AlignHCenter | Qt::AlignVCenter),
@@ -95,23 +105,34 @@ void DiveTextItem::updateText()
 		size *= scale * printScale;
 		fnt.setPointSizeF(size);
 	}
-	QFontMetrics fm(fnt);
+	// This is called on every paint, so only do the work if anything changed
+	QString key = internalText + QChar(0) + fnt.key() + QChar(0) + QString::number(internalAlignFlags);
+	if (key == layoutKey)
+		return;
+	layoutKey = key;
+	auto it = textLayouts.constFind(key);
+	if (it == textLayouts.cend()) {
+		QFontMetrics fm(fnt);
 
-	QPainterPath textPath;
-	qreal xPos = 0, yPos = 0;
+		QPainterPath textPath;
+		qreal xPos = 0, yPos = 0;
 
-	QRectF rect = fm.boundingRect(internalText);
-	yPos = (internalAlignFlags & Qt::AlignTop) ? 0 :
-		(internalAlignFlags & Qt::AlignBottom) ? +rect.height() :
-		/*(internalAlignFlags & Qt::AlignVCenter  ? */ +rect.height() / 4;
+		QRectF rect = fm.boundingRect(internalText);
+		yPos = (internalAlignFlags & Qt::AlignTop) ? 0 :
+			(internalAlignFlags & Qt::AlignBottom) ? +rect.height() :
+			/*(internalAlignFlags & Qt::AlignVCenter  ? */ +rect.height() / 4;
 
-	xPos = (internalAlignFlags & Qt::AlignLeft) ? -rect.width() :
-		(internalAlignFlags & Qt::AlignHCenter) ? -rect.width() / 2 :
-		/* (internalAlignFlags & Qt::AlignRight) */ 0;
+		xPos = (internalAlignFlags & Qt::AlignLeft) ? -rect.width() :
+			(internalAlignFlags & Qt::AlignHCenter) ? -rect.width() / 2 :
+			/* (internalAlignFlags & Qt::AlignRight) */ 0;
 
-	textPath.addText(xPos, yPos, fnt, internalText);
-	QPainterPathStroker stroker;
-	stroker.setWidth(3);
-	textBackgroundItem->setPath(stroker.createStroke(textPath));
-	textItem->setPath(textPath);
+		textPath.addText(xPos, yPos, fnt, internalText);
+		QPainterPathStroker stroker;
+		stroker.setWidth(3);
+		if (textLayouts.size() >= maxTextLayouts)
+			textLayouts.clear();
+		it = textLayouts.insert(key, { textPath, stroker.createStroke(textPath) });
+	}
+	textBackgroundItem->setPath(it->background);
+	textItem->setPath(it->text);
 }
@@ -31,6 +31,7 @@ private:
 	QGraphicsPathItem *textBackgroundItem;
 	QGraphicsPathItem *textItem;
 	QString internalText;
+	QString layoutKey;	// of the current paths
 	double printScale;
 	double scale;
 	bool connected;
@@ -1,6 +1,7 @@
 // SPDX-License-Identifier: GPL-2.0
 #include "profile-widget/divetooltipitem.h"
 #include "profile-widget/divecartesianaxis.h"
+#include "profile-widget/diveeventitem.h"
 #include "core/profile.h"
 #include "core/membuffer.h"
 #include "core/metrics.h"
@@ -271,7 +272,7 @@ void ToolTipItem::refresh(const QPointF &pos)
 				16, lrint(60 - AMB_PERCENTAGE * (entry->pressures.n2 + entry->pressures.he) / entry->ambpressure /2));
 		painter.setPen(QColor(0, 0, 0, 127));
 		for (int i=0; i<16; i++) {
-			painter.drawLine(i, 60, i, 60 - entry->percentages[i] / 2);
+			painter.drawLine(i, 60, i, 60 - get_plot_tissue_percentage(&pInfo, idx, i) / 2);
 		}
 		entryToolTip.second->setText(QString::fromUtf8(mb.buffer, mb.len));
 	}
@@ -280,6 +281,8 @@ void ToolTipItem::refresh(const QPointF &pos)
 	const auto l = scene()->items(pos, Qt::IntersectsItemBoundingRect, Qt::DescendingOrder,
 			scene()->views().first()->transform());
 	for (QGraphicsItem *item: l) {
+		if (DiveEventItem *eventItem = dynamic_cast<DiveEventItem *>(item))
+			eventItem->prepareToolTip();
 		if (!item->toolTip().isEmpty())
 			addToolTip(item->toolTip());
 	}
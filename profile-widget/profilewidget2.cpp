@@ -152,6 +152,12 @@ ProfileWidget2::ProfileWidget2(QWidget *parent) : QGraphicsView(parent),
 	isPlotZoomed = prefs.zoomed_plot; // now it seems that 'prefs' has loaded our preferences
 
 	init_plot_info(&plotInfo);
+	dcPlotInfoDive = dcPlotInfoShown = -1;
+
+	replotTimer.setSingleShot(true);
+	replotTimer.setInterval(0);
+	connect(&replotTimer, &QTimer::timeout, this, &ProfileWidget2::replot);
+	lastPlotDuration = 0;
 
 	setupSceneAndFlags();
 	setupItemSizes();
@@ -186,6 +192,7 @@ ProfileWidget2::ProfileWidget2(QWidget *parent) : QGraphicsView(parent),
 ProfileWidget2::~ProfileWidget2()
 {
 	free_plot_info_data(&plotInfo);
+	clearDcPlotInfo();
 }
 
 #ifndef SUBSURFACE_MOBILE
@@ -381,9 +388,18 @@ void ProfileWidget2::setupItemOnScene()
 
 void ProfileWidget2::replot()
 {
+	replotTimer.stop();
 	plotDive(current_dive, true, false);
 }
 
+// Moving a planner point changes the model several times in a row and every
+// replot recalculates the plan. Therefore, replot once control returns to the
+// event loop, after all pending changes (e.g. mouse moves) were processed.
+void ProfileWidget2::scheduleReplot()
+{
+	replotTimer.start();
+}
+
 void ProfileWidget2::createPPGas(PartialPressureGasItem *item, int verticalColumn, color_index_t color, color_index_t colorAlert,
 				 const double *thresholdSettingsMin, const double *thresholdSettingsMax)
 {
@@ -553,14 +569,71 @@ void ProfileWidget2::resetZoom()
 	zoomLevel = 0;
 }
 
+// Animations of a plot are skipped if it follows the previous one before its animations
+// finished, e.g. when scrolling through the dive list, if plotting takes longer than this
+// or if the dive has more than this many samples. Otherwise the animations compete with
+// the next plot.
+static const qint64 animationPlotBudget = 50; // ms
+static const int animationMaxSamples = 5000;
+
+void ProfileWidget2::clearDcPlotInfo()
+{
+	for (struct plot_info &pi: dcPlotInfo)
+		free_plot_info_data(&pi);
+	dcPlotInfo.clear();
+	dcPlotInfoDive = dcPlotInfoShown = -1;
+}
+
+// The plot info of all divecomputers of a dive is calculated in parallel when
+// the dive is plotted. Switching to another divecomputer of the same dive then
+// only has to swap in the plot info that was kept.
+void ProfileWidget2::calculatePlotInfo(struct divecomputer *currentdc, bool force)
+{
+	// create_plot_info_new() automatically frees old plot data
+#ifndef SUBSURFACE_MOBILE
+	if (currentState == ADD || currentState == PLAN) {
+		clearDcPlotInfo();
+		create_plot_info_new(&displayed_dive, currentdc, &plotInfo, !shouldCalculateMaxDepth, &DivePlannerPointsModel::instance()->final_deco_state);
+		return;
+	}
+#endif
+	int nr = (int)number_of_computers(&displayed_dive);
+	if (nr <= 1) {
+		clearDcPlotInfo();
+		create_plot_info_new(&displayed_dive, currentdc, &plotInfo, !shouldCalculateMaxDepth, nullptr);
+		return;
+	}
+	if (!force && dcPlotInfoDive == displayed_dive.id && (int)dcPlotInfo.size() == nr) {
+		if ((int)dc_number != dcPlotInfoShown) {
+			std::swap(plotInfo, dcPlotInfo[dcPlotInfoShown]);
+			std::swap(plotInfo, dcPlotInfo[dc_number]);
+			dcPlotInfoShown = (int)dc_number;
+		}
+		return;
+	}
+
+	clearDcPlotInfo();
+	for (struct divecomputer *dc = &displayed_dive.dc; dc; dc = dc->next) {
+		if (!dc->samples)
+			fake_dc(dc);
+	}
+	dcPlotInfo.resize(nr);
+	for (struct plot_info &pi: dcPlotInfo)
+		init_plot_info(&pi);
+	create_plot_info_all_dcs(&displayed_dive, dcPlotInfo.data(), !shouldCalculateMaxDepth);
+	free_plot_info_data(&plotInfo);
+	std::swap(plotInfo, dcPlotInfo[dc_number]);
+	dcPlotInfoDive = displayed_dive.id;
+	dcPlotInfoShown = (int)dc_number;
+}
+
 // Currently just one dive, but the plan is to enable All of the selected dives.
 void ProfileWidget2::plotDive(const struct dive *d, bool force, bool doClearPictures, bool instant)
 {
 	static bool firstCall = true;
-#ifndef SUBSURFACE_MOBILE
 	QElapsedTimer measureDuration; // let's measure how long this takes us (maybe we'll turn of TTL calculation later
 	measureDuration.start();
-#else
+#ifdef SUBSURFACE_MOBILE
 	Q_UNUSED(doClearPictures);
 #endif
 	if (currentState != ADD && currentState != PLAN) {
@@ -604,6 +677,9 @@ void ProfileWidget2::plotDive(const struct dive *d, bool force, bool doClearPict
 		animSpeed = 0;
 		firstCall = false;
 	}
+	if (lastPlotDuration > animationPlotBudget ||
+	    (sinceLastPlot.isValid() && sinceLastPlot.elapsed() < qPrefDisplay::animation_speed()))
+		animSpeed = 0;
 
 	// restore default zoom level
 	resetZoom();
@@ -640,12 +716,9 @@ void ProfileWidget2::plotDive(const struct dive *d, bool force, bool doClearPict
 	 * shown.
 	 */
 
-	// create_plot_info_new() automatically frees old plot data
-#ifndef SUBSURFACE_MOBILE
-	create_plot_info_new(&displayed_dive, currentdc, &plotInfo, !shouldCalculateMaxDepth, &DivePlannerPointsModel::instance()->final_deco_state);
-#else
-	create_plot_info_new(&displayed_dive, currentdc, &plotInfo, !shouldCalculateMaxDepth, nullptr);
-#endif
+	calculatePlotInfo(currentdc, force);
+	if (plotInfo.nr > animationMaxSamples)
+		animSpeed = 0;
 	int newMaxtime = get_maxtime(&plotInfo);
 	if (shouldCalculateMaxTime || newMaxtime > maxtime)
 		maxtime = newMaxtime;
@@ -768,8 +841,8 @@ void ProfileWidget2::plotDive(const struct dive *d, bool force, bool doClearPict
 	// The event items are a bit special since we don't know how many events are going to
 	// exist on a dive, so I cant create cache items for that. that's why they are here
 	// while all other items are up there on the constructor.
-	qDeleteAll(eventItems);
-	eventItems.clear();
+	// The items of the previous plot are reused for the first events.
+	int eventIdx = 0;
 	struct event *event = currentdc->events;
 	struct gasmix lastgasmix = get_gasmix_at_time(&displayed_dive, current_dc, duration_t{1});
 
@@ -790,21 +863,29 @@ void ProfileWidget2::plotDive(const struct dive *d, bool force, bool doClearPict
 		// printMode is always selected for SUBSURFACE_MOBILE due to font problems
 		// BUT events are wanted.
 #endif
-		DiveEventItem *item = new DiveEventItem();
-		item->setHorizontalAxis(timeAxis);
-		item->setVerticalAxis(profileYAxis, qPrefDisplay::animation_speed());
-		item->setModel(dataModel);
+		DiveEventItem *item;
+		if (eventIdx < eventItems.size()) {
+			item = eventItems[eventIdx];
+		} else {
+			item = new DiveEventItem();
+			item->setHorizontalAxis(timeAxis);
+			item->setVerticalAxis(profileYAxis, qPrefDisplay::animation_speed());
+			item->setModel(dataModel);
+			item->setZValue(2);
+			scene()->addItem(item);
+			eventItems.push_back(item);
+		}
+		++eventIdx;
 		item->setEvent(event, lastgasmix);
-		item->setZValue(2);
 #ifndef SUBSURFACE_MOBILE
 		item->setScale(printMode ? 4 :1);
 #endif
-		scene()->addItem(item);
-		eventItems.push_back(item);
 		if (event_is_gaschange(event))
 			lastgasmix = get_gasmix_from_event(&displayed_dive, event);
 		event = event->next;
 	}
+	while (eventItems.size() > eventIdx)
+		delete eventItems.takeLast();
 
 	// Only set visible the events that should be visible
 	Q_FOREACH (DiveEventItem *event, eventItems) {
@@ -838,6 +919,9 @@ void ProfileWidget2::plotDive(const struct dive *d, bool force, bool doClearPict
 	toolTipItem->refresh(mapToScene(mapFromGlobal(QCursor::pos())));
 #endif
 
+	lastPlotDuration = measureDuration.elapsed();
+	sinceLastPlot.start();
+
 	// OK, how long did this take us? Anything above the second is way too long,
 	// so if we are calculation TTS / NDL then let's force that off.
 #ifndef SUBSURFACE_MOBILE
@@ -1122,6 +1206,7 @@ void ProfileWidget2::setEmptyState()
 	disconnectTemporaryConnections();
 	setBackgroundBrush(getColor(::BACKGROUND, isGrayscale));
 	dataModel->clear();
+	clearDcPlotInfo();
 	currentState = EMPTY;
 	emit enableToolbar(false);
 
@@ -1337,8 +1422,8 @@ void ProfileWidget2::setAddState()
 	actionsForKeys[Qt::Key_Delete]->setShortcut(Qt::Key_Delete);
 
 	DivePlannerPointsModel *plannerModel = DivePlannerPointsModel::instance();
-	connect(plannerModel, &DivePlannerPointsModel::dataChanged, this, &ProfileWidget2::replot);
-	connect(plannerModel, &DivePlannerPointsModel::cylinderModelEdited, this, &ProfileWidget2::replot);
+	connect(plannerModel, &DivePlannerPointsModel::dataChanged, this, &ProfileWidget2::scheduleReplot);
+	connect(plannerModel, &DivePlannerPointsModel::cylinderModelEdited, this, &ProfileWidget2::scheduleReplot);
 #ifndef SUBSURFACE_MOBILE
 	connect(plannerModel, &DivePlannerPointsModel::rowsInserted, this, &ProfileWidget2::pointInserted);
 	connect(plannerModel, &DivePlannerPointsModel::rowsRemoved, this, &ProfileWidget2::pointsRemoved);
@@ -1370,8 +1455,8 @@ void ProfileWidget2::setPlanState()
 	actionsForKeys[Qt::Key_Delete]->setShortcut(Qt::Key_Delete);
 
 	DivePlannerPointsModel *plannerModel = DivePlannerPointsModel::instance();
-	connect(plannerModel, &DivePlannerPointsModel::dataChanged, this, &ProfileWidget2::replot);
-	connect(plannerModel, &DivePlannerPointsModel::cylinderModelEdited, this, &ProfileWidget2::replot);
+	connect(plannerModel, &DivePlannerPointsModel::dataChanged, this, &ProfileWidget2::scheduleReplot);
+	connect(plannerModel, &DivePlannerPointsModel::cylinderModelEdited, this, &ProfileWidget2::scheduleReplot);
 	connect(plannerModel, &DivePlannerPointsModel::rowsInserted, this, &ProfileWidget2::pointInserted);
 	connect(plannerModel, &DivePlannerPointsModel::rowsRemoved, this, &ProfileWidget2::pointsRemoved);
 	/* show the same stuff that the profile shows. */
@@ -1736,8 +1821,9 @@ void ProfileWidget2::disconnectTemporaryConnections()
 {
 #ifndef SUBSURFACE_MOBILE
 	DivePlannerPointsModel *plannerModel = DivePlannerPointsModel::instance();
-	disconnect(plannerModel, &DivePlannerPointsModel::dataChanged, this, &ProfileWidget2::replot);
-	disconnect(plannerModel, &DivePlannerPointsModel::cylinderModelEdited, this, &ProfileWidget2::replot);
+	disconnect(plannerModel, &DivePlannerPointsModel::dataChanged, this, &ProfileWidget2::scheduleReplot);
+	disconnect(plannerModel, &DivePlannerPointsModel::cylinderModelEdited, this, &ProfileWidget2::scheduleReplot);
+	replotTimer.stop();
 
 	disconnect(plannerModel, &DivePlannerPointsModel::rowsInserted, this, &ProfileWidget2::pointInserted);
 	disconnect(plannerModel, &DivePlannerPointsModel::rowsRemoved, this, &ProfileWidget2::pointsRemoved);
@@ -2,7 +2,9 @@
 #ifndef PROFILEWIDGET2_H
 #define PROFILEWIDGET2_H
 
+#include <QElapsedTimer>
 #include <QGraphicsView>
+#include <QTimer>
 #include <vector>
 #include <memory>
 
@@ -151,6 +153,7 @@ private:
 	void dragMoveEvent(QDragMoveEvent *event) override;
 
 	void replot();
+	void scheduleReplot();
 	void changeGas(int tank, int seconds);
 	void fixBackgroundPos();
 	void scrollViewTo(const QPoint &pos);
@@ -164,6 +167,8 @@ private:
 	void createPPGas(PartialPressureGasItem *item, int verticalColumn, color_index_t color, color_index_t colorAlert,
 			 const double *thresholdSettingsMin, const double *thresholdSettingsMax);
 	void clearPictures();
+	void calculatePlotInfo(struct divecomputer *currentdc, bool force);
+	void clearDcPlotInfo();
 	void plotPicturesInternal(const struct dive *d, bool synchronous);
 	void addDivemodeSwitch(int seconds, int divemode);
 	void addBookmark(int seconds);
@@ -190,6 +195,11 @@ private:
 	// So it's esyer to replicate for more dives later.
 	// In the meantime, keep it here.
 	struct plot_info plotInfo;
+	// The plot info of the other divecomputers of the shown dive. The entry
+	// of the shown divecomputer is empty, its plot info is in plotInfo.
+	std::vector<struct plot_info> dcPlotInfo;
+	int dcPlotInfoDive;
+	int dcPlotInfoShown;
 	DepthAxis *profileYAxis;
 	PartialGasPressureAxis *gasYAxis;
 	TemperatureAxis *temperatureAxis;
@@ -259,6 +269,9 @@ private:
 	QHash<Qt::Key, QAction *> actionsForKeys;
 	bool shouldCalculateMaxTime;
 	bool shouldCalculateMaxDepth;
+	QTimer replotTimer; // coalesces the replots requested by the planner model
+	QElapsedTimer sinceLastPlot; // to skip the animations while browsing through the dives
+	qint64 lastPlotDuration;
 	int maxtime;
 	int maxdepth;
 	double fontPrintScale;
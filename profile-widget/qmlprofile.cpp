@@ -35,7 +35,30 @@ QMLProfile::QMLProfile(QQuickItem *parent) :
 // eventually get called after we call update()
 void QMLProfile::triggerUpdate()
 {
-	update();
+	// The scene graph scales the texture of the item, so pinch zooming doesn't require
+	// rendering the profile again. Only do that if the offsets have to be adjusted to
+	// the new scale or if the scale has to be reset.
+	if (scale() < 1.0 || clampOffsets())
+		update();
+}
+
+// When zooming and panning we want to ensure that we always show a subset of the
+// profile and not the "empty space" around the profile.
+// a bit of math on a piece of paper shows that our offsets need to stay within +/- dx and dy
+// Returns true if the offsets changed.
+bool QMLProfile::clampOffsets()
+{
+	double dpr = devicePixelRatio();
+	qreal profileScale = std::max(scale(), (qreal)1.0);
+	qreal dx = width() * (profileScale - 1) / (2 * dpr * profileScale);
+	qreal dy = height() * (profileScale - 1) / (2 * dpr * profileScale);
+	qreal xOffset = std::max(-dx, std::min(m_xOffset, dx));
+	qreal yOffset = std::max(-dy, std::min(m_yOffset, dy));
+	if (xOffset == m_xOffset && yOffset == m_yOffset)
+		return false;
+	m_xOffset = xOffset;
+	m_yOffset = yOffset;
+	return true;
 }
 
 void QMLProfile::paint(QPainter *painter)
@@ -84,13 +107,7 @@ void QMLProfile::paint(QPainter *painter)
 		profileScale = 1.0;
 		setScale(profileScale);
 	}
-	// When zooming and panning we want to ensure that we always show a subset of the
-	// profile and not the "empty space" around the profile.
-	// a bit of math on a piece of paper shows that our offsets need to stay within +/- dx and dy
-	qreal dx = width() * (profileScale - 1) / (2 * dpr * profileScale);
-	qreal dy = height() * (profileScale - 1) / (2 * dpr * profileScale);
-	m_xOffset = std::max(-dx, std::min(m_xOffset, dx));
-	m_yOffset = std::max(-dy, std::min(m_yOffset, dy));
+	clampOffsets();
 
 	QTransform painterTransform = painter->transform();
 	painterTransform.translate(dpr * m_xOffset - painterRect.width() * magicShiftFactor, dpr * m_yOffset - painterRect.height() * magicShiftFactor);
@@ -37,6 +37,7 @@ private:
 	qreal m_xOffset, m_yOffset;
 	QScopedPointer<ProfileWidget2> m_profileWidget;
 	void updateProfile();
+	bool clampOffsets();
 
 signals:
 	void rightAlignedChanged();
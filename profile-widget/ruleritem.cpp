@@ -8,6 +8,7 @@
 #include "core/settings/qPrefTechnicalDetails.h"
 
 #include <qgraphicssceneevent.h>
+#include <algorithm>
 
 #include "core/profile.h"
 
@@ -48,9 +49,10 @@ void RulerNodeItem2::recalculate()
 	} else if (x() > timeAxis->posAtValue(last.sec)) {
 		setPos(timeAxis->posAtValue(last.sec), depthAxis->posAtValue(last.depth));
 	} else {
-		idx = 0;
-		while (idx < pInfo.nr && timeAxis->posAtValue(pInfo.entry[idx].sec) < x())
-			++idx;
+		// The entries are sorted by time: binary search for the first entry at or after x
+		const struct plot_data *entry = std::lower_bound(pInfo.entry, pInfo.entry + pInfo.nr, x(),
+			[this](const struct plot_data &data, qreal pos) { return timeAxis->posAtValue(data.sec) < pos; });
+		idx = entry - pInfo.entry;
 		const struct plot_data &data = pInfo.entry[idx];
 		setPos(timeAxis->posAtValue(data.sec), depthAxis->posAtValue(data.depth));
 	}
@@ -5,6 +5,7 @@
 #include "core/event.h"
 #include "core/profile.h"
 #include <QPen>
+#include <algorithm>
 
 static const qreal height = 3.0;
 
@@ -35,9 +36,12 @@ TankItem::TankItem(QObject *parent) :
 
 void TankItem::setData(DivePlotDataModel *model, struct plot_info *plotInfo, struct dive *d)
 {
+	segments.clear();
+
 	// If there is nothing to plot, quit early.
 	if (plotInfo->nr <= 0) {
 		plotEndTime = -1;
+		modelDataChanged();
 		return;
 	}
 
@@ -48,16 +52,52 @@ void TankItem::setData(DivePlotDataModel *model, struct plot_info *plotInfo, str
 	// Stay informed of changes to the tanks.
 	connect(model, SIGNAL(dataChanged(QModelIndex, QModelIndex)), this, SLOT(modelDataChanged(QModelIndex, QModelIndex)), Qt::UniqueConnection);
 
+	// The bars only change with the gas changes of the dive, therefore collect
+	// them once per plot and not every time the axis or the model changes.
+	// Gas changes at the same time or to the gas in use don't start a new bar.
+	// Bail if there are no cylinders.
+	if (d->cylinders.nr > 0) {
+		struct gas_timeline gases;
+		init_gas_timeline(&gases, d, get_dive_dc(d, dc_number));
+		for (int i = 0; i < gases.nr && gases.segments[i].time < plotEndTime; i++) {
+			struct gas_segment segment = gases.segments[i];
+			segment.time = std::max(segment.time, 0);
+			if (!segments.empty() && segments.back().time == segment.time)
+				segments.back().gasmix = segment.gasmix;
+			else if (segments.empty() || !same_gasmix(segments.back().gasmix, segment.gasmix))
+				segments.push_back(segment);
+		}
+		free_gas_timeline(&gases);
+	}
+
 	modelDataChanged();
 }
 
-void TankItem::createBar(int startTime, int stopTime, struct gasmix gas)
+void TankItem::setBar(int idx, int startTime, int stopTime, struct gasmix gas)
 {
 	qreal x = hAxis->posAtValue(startTime);
 	qreal w = hAxis->posAtValue(stopTime) - hAxis->posAtValue(startTime);
 
+	// The rectangles of the previous plots are reused
+	QGraphicsRectItem *rect;
+	DiveTextItem *label;
+	if (idx < rects.size()) {
+		rect = rects[idx];
+		label = labels[idx];
+		rect->setVisible(true);
+	} else {
+		rect = new QGraphicsRectItem(this);
+		rect->setPen(QPen(QBrush(), 0.0)); // get rid of the thick line around the rectangle
+		rects.push_back(rect);
+		label = new DiveTextItem(rect);
+		label->setBrush(Qt::black);
+		label->setAlignment(Qt::AlignBottom | Qt::AlignRight);
+		label->setZValue(101);
+		labels.push_back(label);
+	}
+
 	// pick the right gradient, size, position and text
-	QGraphicsRectItem *rect = new QGraphicsRectItem(x, 0, w, height, this);
+	rect->setRect(x, 0, w, height);
 	if (gasmix_is_air(gas))
 		rect->setBrush(air);
 	else if (gas.he.permille)
@@ -66,50 +106,28 @@ void TankItem::createBar(int startTime, int stopTime, struct gasmix gas)
 		rect->setBrush(oxygen);
 	else
 		rect->setBrush(nitrox);
-	rect->setPen(QPen(QBrush(), 0.0)); // get rid of the thick line around the rectangle
-	rects.push_back(rect);
-	DiveTextItem *label = new DiveTextItem(rect);
 	label->setText(gasname(gas));
-	label->setBrush(Qt::black);
-	label->setPos(x + 1, 0);
-	label->setAlignment(Qt::AlignBottom | Qt::AlignRight);
 #ifdef SUBSURFACE_MOBILE
 	label->setPos(x + 1, -2.5);
+#else
+	label->setPos(x + 1, 0);
 #endif
-	label->setZValue(101);
 }
 
 void TankItem::modelDataChanged(const QModelIndex&, const QModelIndex&)
 {
+	int bars = 0;
 	// We don't have enougth data to calculate things, quit.
-	if (plotEndTime < 0)
-		return;
-
-	// remove the old rectangles
-	qDeleteAll(rects);
-	rects.clear();
-
-	// Bail if there are no cylinders
-	if (displayed_dive.cylinders.nr <= 0)
-		return;
-
-	// get the information directly from the displayed_dive (the dc always exists)
-	struct divecomputer *dc = get_dive_dc(&displayed_dive, dc_number);
-
-	// start with the first gasmix and at the start of the dive
-	int cyl = explicit_first_cylinder(&displayed_dive, dc);
-	struct gasmix gasmix = get_cylinder(&displayed_dive, cyl)->gasmix;
-	int startTime = 0;
-
-	// work through all the gas changes and add the rectangle for each gas while it was used
-	const struct event *ev = get_next_event(dc->events, "gaschange");
-	while (ev && (int)ev->time.seconds < plotEndTime) {
-		createBar(startTime, ev->time.seconds, gasmix);
-		startTime = ev->time.seconds;
-		gasmix = get_gasmix_from_event(&displayed_dive, ev);
-		ev = get_next_event(ev->next, "gaschange");
+	if (plotEndTime >= 0 && hAxis) {
+		for (size_t i = 0; i < segments.size(); i++) {
+			int stopTime = i + 1 < segments.size() ? segments[i + 1].time : plotEndTime;
+			setBar(bars++, segments[i].time, stopTime, segments[i].gasmix);
+		}
 	}
-	createBar(startTime, plotEndTime, gasmix);
+
+	// hide the rectangles that are not used anymore
+	for (int i = bars; i < rects.size(); i++)
+		rects[i]->setVisible(false);
 }
 
 void TankItem::setHorizontalAxis(DiveCartesianAxis *horizontal)
@@ -8,6 +8,9 @@
 #include "profile-widget/divelineitem.h"
 #include "profile-widget/divecartesianaxis.h"
 #include "core/dive.h"
+#include <vector>
+
+class DiveTextItem;
 
 class TankItem : public QObject, public QGraphicsRectItem
 {
@@ -24,11 +27,13 @@ public slots:
 	void modelDataChanged(const QModelIndex &topLeft = QModelIndex(), const QModelIndex &bottomRight = QModelIndex());
 
 private:
-	void createBar(int startTime, int stopTime, struct gasmix gas);
+	void setBar(int idx, int startTime, int stopTime, struct gasmix gas);
 	DiveCartesianAxis *hAxis;
 	int plotEndTime;
 	QBrush air, nitrox, oxygen, trimix;
+	std::vector<gas_segment> segments; // the gases of the bars and their start times
 	QList<QGraphicsRectItem *> rects;
+	QList<DiveTextItem *> labels;
 };
 
 #endif // TANKITEM_H
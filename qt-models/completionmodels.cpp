@@ -1,56 +1,163 @@
 // SPDX-License-Identifier: GPL-2.0
 #include "qt-models/completionmodels.h"
 #include "core/dive.h"
+#include "core/subsurface-string.h"
 #include "core/tag.h"
-#include <QSet>
 #include <QString>
 
-#define CREATE_UPDATE_METHOD(Class, diveStructMember)          \
-	void Class::updateModel()                              \
-	{                                                      \
-		QStringList list;                              \
-		struct dive *dive;                             \
-		int i = 0;                                     \
-		for_each_dive (i, dive)                        \
-		{                                              \
-			QString buddy(dive->diveStructMember); \
-			if (!list.contains(buddy)) {           \
-				list.append(buddy);            \
-			}                                      \
-		}                                              \
-		std::sort(list.begin(), list.end());           \
-		setStringList(list);                           \
-	}
-
 #if QT_VERSION >= QT_VERSION_CHECK(5, 14, 0)
 #define SKIP_EMPTY Qt::SkipEmptyParts
 #else
 #define SKIP_EMPTY QString::SkipEmptyParts
 #endif
 
-#define CREATE_CSV_UPDATE_METHOD(Class, diveStructMember)                                        \
-	void Class::updateModel()                                                                \
-	{                                                                                        \
-		QSet<QString> set;                                                               \
-		struct dive *dive;                                                               \
-		int i = 0;                                                                       \
-		for_each_dive (i, dive)                                                          \
-		{                                                                                \
-			QString buddy(dive->diveStructMember);                                   \
-			foreach (const QString &value, buddy.split(",", SKIP_EMPTY))             \
-			{                                                                        \
-				set.insert(value.trimmed());                                     \
-			}                                                                        \
-		}                                                                                \
-		QStringList setList = set.values();                                              \
-		std::sort(setList.begin(), setList.end());                                       \
-		setStringList(setList);                                                     \
+DiveStringCompletionModel::DiveStringCompletionModel()
+{
+	connect(&diveListNotifier, &DiveListNotifier::dataReset, this, &DiveStringCompletionModel::updateModel);
+	connect(&diveListNotifier, &DiveListNotifier::divesAdded, this, &DiveStringCompletionModel::divesAdded);
+	connect(&diveListNotifier, &DiveListNotifier::divesDeleted, this, &DiveStringCompletionModel::divesDeleted);
+	connect(&diveListNotifier, &DiveListNotifier::divesChanged, this, &DiveStringCompletionModel::divesChanged);
+}
+
+bool DiveStringCompletionModel::addDive(const dive *d)
+{
+	QStringList list = diveStrings(d);
+	bool added = false;
+	for (const QString &s: list) {
+		if (counts[s]++ == 0)
+			added = true;
 	}
+	if (!list.isEmpty())
+		strings.insert(d, list);
+	return added;
+}
 
-CREATE_CSV_UPDATE_METHOD(BuddyCompletionModel, buddy);
-CREATE_CSV_UPDATE_METHOD(DiveMasterCompletionModel, divemaster);
-CREATE_UPDATE_METHOD(SuitCompletionModel, suit);
+bool DiveStringCompletionModel::removeDive(const dive *d)
+{
+	auto it = strings.find(d);
+	if (it == strings.end())
+		return false;
+	bool removed = false;
+	for (const QString &s: *it) {
+		auto count = counts.find(s);
+		if (count != counts.end() && --*count <= 0) {
+			counts.erase(count);
+			removed = true;
+		}
+	}
+	strings.erase(it);
+	return removed;
+}
 
+void DiveStringCompletionModel::publish()
+{
+	QStringList list = counts.keys();
+	std::sort(list.begin(), list.end());
+	setStringList(list);
+}
+
+void DiveStringCompletionModel::updateModel()
+{
+	counts.clear();
+	strings.clear();
+	struct dive *dive;
+	int i;
+	for_each_dive (i, dive)
+		addDive(dive);
+	publish();
+}
+
+void DiveStringCompletionModel::divesAdded(dive_trip *, bool, const QVector<dive *> &dives)
+{
+	bool added = false;
+	for (const dive *d: dives)
+		added |= addDive(d);
+	if (added)
+		publish();
+}
+
+void DiveStringCompletionModel::divesDeleted(dive_trip *, bool, const QVector<dive *> &dives)
+{
+	bool removed = false;
+	for (const dive *d: dives)
+		removed |= removeDive(d);
+	if (removed)
+		publish();
+}
+
+void DiveStringCompletionModel::divesChanged(const QVector<dive *> &dives, DiveField field)
+{
+	if (!changed(field))
+		return;
+	bool vocabularyChanged = false;
+	for (const dive *d: dives) {
+		// Add first, so that the count of a string that is kept never drops to zero
+		QStringList old = strings.value(d);
+		strings.remove(d);
+		vocabularyChanged |= addDive(d);
+		for (const QString &s: old) {
+			auto count = counts.find(s);
+			if (count != counts.end() && --*count <= 0) {
+				counts.erase(count);
+				vocabularyChanged = true;
+			}
+		}
+	}
+	if (vocabularyChanged)
+		publish();
+}
+
+// The names in a comma separated list, each counted once per dive
+static QStringList splitNames(const char *s)
+{
+	QStringList res;
+	for (const QString &value: QString(s).split(",", SKIP_EMPTY)) {
+		QString name = value.trimmed();
+		if (!name.isEmpty() && !res.contains(name))
+			res.append(name);
+	}
+	return res;
+}
+
+QStringList BuddyCompletionModel::diveStrings(const dive *d) const
+{
+	return splitNames(d->buddy);
+}
+
+bool BuddyCompletionModel::changed(const DiveField &field) const
+{
+	return field.buddy;
+}
+
+QStringList DiveMasterCompletionModel::diveStrings(const dive *d) const
+{
+	return splitNames(d->divemaster);
+}
+
+bool DiveMasterCompletionModel::changed(const DiveField &field) const
+{
+	return field.divemaster;
+}
+
+QStringList SuitCompletionModel::diveStrings(const dive *d) const
+{
+	if (empty_string(d->suit))
+		return QStringList();
+	return QStringList(QString(d->suit));
+}
+
+bool SuitCompletionModel::changed(const DiveField &field) const
+{
+	return field.suit;
+}
+
+TagCompletionModel::TagCompletionModel()
+{
+	connect(&diveListNotifier, &DiveListNotifier::dataReset, this, &TagCompletionModel::updateModel);
+	connect(&diveListNotifier, &DiveListNotifier::divesChanged, this, &TagCompletionModel::divesChanged);
+}
+
+// The tags of all dives are kept in the global list, also the ones that are not used anymore
 void TagCompletionModel::updateModel()
 {
 	if (g_tag_list == NULL)
@@ -61,5 +168,12 @@ void TagCompletionModel::updateModel()
 		list.append(QString(current_tag_entry->tag->name));
 		current_tag_entry = current_tag_entry->next;
 	}
-	setStringList(list);
+	if (list != stringList())
+		setStringList(list);
+}
+
+void TagCompletionModel::divesChanged(const QVector<dive *> &, DiveField field)
+{
+	if (field.tags)
+		updateModel();
 }
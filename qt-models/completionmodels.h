@@ -2,30 +2,62 @@
 #ifndef COMPLETIONMODELS_H
 #define COMPLETIONMODELS_H
 
+#include "core/subsurface-qt/divelistnotifier.h"
+#include <QHash>
 #include <QStringListModel>
 
-class BuddyCompletionModel : public QStringListModel {
+struct dive;
+
+// The strings used in one field of the dives. The dives using each string are
+// counted, so that an edit only updates the counts of the strings of the edited
+// dives. The list is only set again if a string was added or removed.
+class DiveStringCompletionModel : public QStringListModel {
 	Q_OBJECT
 public:
-	void updateModel();
+	DiveStringCompletionModel();
+	void updateModel();						// Count the strings of all dives
+protected:
+	virtual QStringList diveStrings(const dive *d) const = 0;
+	virtual bool changed(const DiveField &field) const = 0;
+private:
+	void divesAdded(dive_trip *trip, bool addTrip, const QVector<dive *> &dives);
+	void divesDeleted(dive_trip *trip, bool deleteTrip, const QVector<dive *> &dives);
+	void divesChanged(const QVector<dive *> &dives, DiveField field);
+	bool addDive(const dive *d);					// Returns true if a string was added
+	bool removeDive(const dive *d);					// Returns true if a string was removed
+	void publish();
+	QHash<QString, int> counts;					// Number of dives using each string
+	QHash<const dive *, QStringList> strings;			// The counted strings of each dive
 };
 
-class DiveMasterCompletionModel : public QStringListModel {
+class BuddyCompletionModel : public DiveStringCompletionModel {
 	Q_OBJECT
-public:
-	void updateModel();
+private:
+	QStringList diveStrings(const dive *d) const override;
+	bool changed(const DiveField &field) const override;
 };
 
-class SuitCompletionModel : public QStringListModel {
+class DiveMasterCompletionModel : public DiveStringCompletionModel {
 	Q_OBJECT
-public:
-	void updateModel();
+private:
+	QStringList diveStrings(const dive *d) const override;
+	bool changed(const DiveField &field) const override;
+};
+
+class SuitCompletionModel : public DiveStringCompletionModel {
+	Q_OBJECT
+private:
+	QStringList diveStrings(const dive *d) const override;
+	bool changed(const DiveField &field) const override;
 };
 
 class TagCompletionModel : public QStringListModel {
 	Q_OBJECT
 public:
+	TagCompletionModel();
 	void updateModel();
+private:
+	void divesChanged(const QVector<dive *> &dives, DiveField field);
 };
 
 #endif // COMPLETIONMODELS_H
@@ -9,13 +9,19 @@
 #include "core/gettextfromc.h"
 #include "core/subsurface-qt/divelistnotifier.h"
 #include "core/subsurface-string.h"
+#include <QTimer>
+#include <algorithm>
 #include <string>
 
 CylindersModel::CylindersModel(bool planner, QObject *parent) : CleanerTableModel(parent),
 	d(nullptr),
 	inPlanner(planner),
 	tempRow(-1),
-	tempCyl(empty_cylinder)
+	tempCyl(empty_cylinder),
+	changedFirstRow(-1),
+	changedLastRow(-1),
+	changedFirstColumn(-1),
+	changedLastColumn(-1)
 {
 	//	enum {REMOVE, TYPE, SIZE, WORKINGPRESS, START, END, O2, HE, DEPTH, MOD, MND, USE, IS_USED};
 	setHeaderDataStrings(QStringList() << "" << tr("Type") << tr("Size") << tr("Work press.") << tr("Start press.") << tr("End press.") << tr("O₂%") << tr("He%")
@@ -620,9 +626,9 @@ void CylindersModel::updateDecoDepths(pressure_t olddecopo2)
 		 * If they don't match, we should leave the user entered depth as it is */
 		if (cyl->depth.mm == gas_mod(cyl->gasmix, olddecopo2, d, M_OR_FT(3, 10)).mm) {
 			cyl->depth = gas_mod(cyl->gasmix, decopo2, d, M_OR_FT(3, 10));
+			scheduleDataChanged(i, i, DEPTH, DEPTH);
 		}
 	}
-	emit dataChanged(createIndex(0, 0), createIndex(d->cylinders.nr - 1, COLUMNS - 1));
 }
 
 void CylindersModel::updateTrashIcon()
@@ -659,16 +665,58 @@ bool CylindersModel::updateBestMixes()
 				cyl->gasmix.o2.permille = 1000 - get_he(cyl->gasmix);
 			gasUpdated = true;
 		}
+		if (cyl->bestmix_o2 || cyl->bestmix_he)
+			scheduleDataChanged(i, i, O2, MND);
 	}
-	/* This slot is called when the bottom pO2 and END preferences are updated, we want to
-	 * emit dataChanged so MOD and MND are refreshed, even if the gas mix hasn't been changed */
-	if (gasUpdated)
-		emitDataChanged();
 	return gasUpdated;
 }
 
-void CylindersModel::emitDataChanged() {
-	emit dataChanged(createIndex(0, 0), createIndex(d->cylinders.nr - 1, COLUMNS - 1));
+// The MOD and MND columns depend on the bottom pO2, the best mix END and the
+// o2narcotic preferences.
+void CylindersModel::updateMods()
+{
+	if (!d)
+		return;
+	scheduleDataChanged(0, d->cylinders.nr - 1, MOD, MND);
+}
+
+void CylindersModel::emitDataChanged()
+{
+	if (!d)
+		return;
+	scheduleDataChanged(0, d->cylinders.nr - 1, 0, COLUMNS - 1);
+}
+
+// Calculated values are often updated several times in a row, e.g. when a
+// preference and the maximum depth of a plan change. The changed cells are
+// collected and reported in one signal when control returns to the event
+// loop, so that the views and the planner are only updated once.
+void CylindersModel::scheduleDataChanged(int firstRow, int lastRow, int firstColumn, int lastColumn)
+{
+	if (firstRow > lastRow)
+		return;
+	if (changedFirstRow >= 0) {
+		changedFirstRow = std::min(changedFirstRow, firstRow);
+		changedLastRow = std::max(changedLastRow, lastRow);
+		changedFirstColumn = std::min(changedFirstColumn, firstColumn);
+		changedLastColumn = std::max(changedLastColumn, lastColumn);
+		return;
+	}
+	changedFirstRow = firstRow;
+	changedLastRow = lastRow;
+	changedFirstColumn = firstColumn;
+	changedLastColumn = lastColumn;
+	QTimer::singleShot(0, this, &CylindersModel::emitPendingDataChanged);
+}
+
+void CylindersModel::emitPendingDataChanged()
+{
+	// Rows may have been removed in the meantime
+	int firstRow = changedFirstRow;
+	int lastRow = std::min(changedLastRow, rowCount() - 1);
+	changedFirstRow = changedLastRow = -1;
+	if (firstRow >= 0 && firstRow <= lastRow)
+		emit dataChanged(index(firstRow, changedFirstColumn), index(lastRow, changedLastColumn));
 }
 
 void CylindersModel::cylindersReset(const QVector<dive *> &dives)
@@ -49,6 +49,7 @@ public:
 	void moveAtFirst(int cylid);
 	QVariant headerData(int section, Qt::Orientation orientation, int role) const override;
 	bool updateBestMixes();
+	void updateMods();
 	void emitDataChanged();
 	bool cylinderUsed(int i) const;
 
@@ -69,11 +70,16 @@ private:
 	// Used if we temporarily change a line because the user is selecting a weight type
 	int tempRow;
 	cylinder_t tempCyl;
+	// Cells of calculated values that changed since the last dataChanged() signal
+	int changedFirstRow, changedLastRow;
+	int changedFirstColumn, changedLastColumn;
 
 	cylinder_t *cylinderAt(const QModelIndex &index);
 	void initTempCyl(int row);
 	void clearTempCyl();
 	void commitTempCyl(int row);
+	void scheduleDataChanged(int firstRow, int lastRow, int firstColumn, int lastColumn);
+	void emitPendingDataChanged();
 };
 
 // Cylinder model that hides unused cylinders if the pref.show_unused_cylinders flag is not set
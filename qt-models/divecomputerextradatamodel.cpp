@@ -48,11 +48,8 @@ int ExtraDataModel::rowCount(const QModelIndex&) const
 void ExtraDataModel::updateDiveComputer(const struct divecomputer *dc)
 {
 	beginResetModel();
-	struct extra_data *ed = dc ? dc->extra_data : nullptr;
 	items.clear();
-	while (ed) {
-		items.push_back({ ed->key, ed->value });
-		ed = ed->next;
-	}
+	for (int i = 0; dc && i < dc->nr_extra_data; i++)
+		items.push_back({ dc->extra_data[i].key, dc->extra_data[i].value });
 	endResetModel();
 }
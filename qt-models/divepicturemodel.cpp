@@ -101,6 +101,28 @@ void DivePictureModel::updateDivePictures()
 
 	updateThumbnails();
 	endResetModel();
+
+	prefetchNeighbours();
+}
+
+// Calculate the thumbnails of the dives before and after the current dive,
+// so that they can be shown right away when the user moves there.
+void DivePictureModel::prefetchNeighbours()
+{
+	if (!current_dive)
+		return;
+	int idx = get_divenr(current_dive);
+	if (idx < 0)
+		return;
+	QVector<QString> filenames;
+	for (int i: { idx - 1, idx + 1 }) {
+		struct dive *dive = get_dive(i);
+		if (!dive)
+			continue;
+		FOR_EACH_PICTURE(dive)
+			filenames.push_back(QString(picture->filename));
+	}
+	Thumbnailer::instance()->prefetchThumbnails(filenames);
 }
 
 int DivePictureModel::columnCount(const QModelIndex&) const
@@ -138,6 +160,16 @@ QVariant DivePictureModel::data(const QModelIndex &index, int role) const
 	return QVariant();
 }
 
+// The profile shows the pictures of displayed_dive. If that is the current dive,
+// only copy the pictures instead of all the samples and events of the dive.
+void DivePictureModel::updateDisplayedPictures()
+{
+	if (displayed_dive.id == current_dive->id)
+		copy_pictures(&current_dive->pictures, &displayed_dive.pictures);
+	else
+		copy_dive(current_dive, &displayed_dive);
+}
+
 void DivePictureModel::removePictures(const QModelIndexList &indices)
 {
 	// Collect pictures to remove by dive
@@ -193,7 +225,7 @@ void DivePictureModel::picturesRemoved(dive *d, QVector<QString> filenamesIn)
 		endRemoveRows();
 		toIdx -= j - i;
 	}
-	copy_dive(current_dive, &displayed_dive); // TODO: Remove once displayed_dive is moved to the planner
+	updateDisplayedPictures(); // TODO: Remove once displayed_dive is moved to the planner
 }
 
 // Assumes that pics is sorted!
@@ -306,7 +338,7 @@ void DivePictureModel::pictureOffsetChanged(dive *d, const QString filenameIn, o
 
 	// Update the offset here and in the backend
 	oldPos->offsetSeconds = offset.seconds;
-	copy_dive(current_dive, &displayed_dive); // TODO: remove once profile can display arbitrary dives
+	updateDisplayedPictures(); // TODO: remove once profile can display arbitrary dives
 
 	// Henceforth we will work with indices instead of iterators
 	int oldIndex = oldPos - pictures.begin();
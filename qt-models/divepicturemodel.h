@@ -44,6 +44,8 @@ private:
 	double zoomLevel;	// -1.0: minimum, 0.0: standard, 1.0: maximum
 	int size;
 	void updateThumbnails();
+	void prefetchNeighbours();
+	void updateDisplayedPictures();
 	void updateZoom();
 };
 
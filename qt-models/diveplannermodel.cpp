@@ -18,6 +18,7 @@
 #include <QApplication>
 #include <QTextDocument>
 #include <QtConcurrent>
+#include <vector>
 
 #define VARIATIONS_IN_BACKGROUND 1
 
@@ -473,6 +474,13 @@ void DivePlannerPointsModel::emitDataChanged()
 	emit dataChanged(createIndex(0, 0), createIndex(rowCount() - 1, COLUMNS - 1));
 }
 
+// Of the data of the cylinders, only the gas names are shown in the table
+void DivePlannerPointsModel::cylindersChanged()
+{
+	if (rowCount() > 0)
+		emit dataChanged(index(0, GAS), index(rowCount() - 1, GAS));
+}
+
 void DivePlannerPointsModel::setBottomSac(double sac)
 {
 // mobile delivers the same value as desktop when using
@@ -1010,13 +1018,26 @@ void DivePlannerPointsModel::createTemporaryPlan()
 		lock_planner();
 		cloneDiveplan(&diveplan, plan_copy);
 		unlock_planner();
+		// A new plan makes the variations of the previous plans outdated. Those that
+		// are still being calculated stop and their results are dropped.
+		int instance = ++instanceCounter;
+		// The variations work on a copy of the dive, since the displayed dive
+		// will be changed by the next plan while they are calculated.
+		struct dive *dive_copy = alloc_dive();
+		copy_dive(&displayed_dive, dive_copy);
+		// The variations start from the same tissues after the previous dives
+		struct deco_state *cache_copy = NULL;
+		if (cache)
+			cache_deco_state(cache, &cache_copy);
 #ifdef VARIATIONS_IN_BACKGROUND
 		// Since we're calling computeVariations asynchronously and plan_deco_state is allocated
 		// on the stack, it must be copied and freed by the worker-thread.
 		struct deco_state *plan_deco_state_copy = new deco_state(plan_deco_state);
-		QtConcurrent::run(this, &DivePlannerPointsModel::computeVariationsFreeDeco, plan_copy, plan_deco_state_copy);
+		variationsQueue.run([this, plan_copy, plan_deco_state_copy, dive_copy, cache_copy, instance]() {
+			computeVariationsFreeDeco(plan_copy, plan_deco_state_copy, dive_copy, cache_copy, instance);
+		});
 #else
-		computeVariations(plan_copy, &plan_deco_state);
+		computeVariations(plan_copy, &plan_deco_state, dive_copy, cache_copy, instance);
 #endif
 		final_deco_state = plan_deco_state;
 		emit calculatedPlanNotes(QString(displayed_dive.notes));
@@ -1099,30 +1120,58 @@ int DivePlannerPointsModel::analyzeVariations(struct decostop *min, struct decos
 	return (leftsum + rightsum) / 2;
 }
 
-void DivePlannerPointsModel::computeVariationsFreeDeco(struct diveplan *original_plan, struct deco_state *previous_ds)
+void DivePlannerPointsModel::computeVariationsFreeDeco(struct diveplan *original_plan, struct deco_state *previous_ds,
+							struct dive *dive, struct deco_state *cache, int instance)
 {
-	computeVariations(original_plan, previous_ds);
+	computeVariations(original_plan, previous_ds, dive, cache, instance);
 	delete previous_ds;
 }
 
-void DivePlannerPointsModel::computeVariations(struct diveplan *original_plan, const struct deco_state *previous_ds)
+// Calculate the plan with the last segment moved by depth_delta and extended by time_delta.
+// Works on its own copies of the plan, the dive and the deco state, so that the
+// variations can be calculated concurrently.
+bool DivePlannerPointsModel::computeVariation(struct diveplan *original_plan, const struct dive *dive, const struct deco_state *ds,
+					      struct deco_state **cache, struct decostop *stoptable, int depth_delta, int time_delta, int instance)
+{
+	if (instance != instanceCounter)
+		return false;
+
+	struct diveplan plan_copy;
+	struct divedatapoint *last_segment = cloneDiveplan(original_plan, &plan_copy);
+	if (!last_segment) {
+		free_dps(&plan_copy);
+		return false;
+	}
+	if (depth_delta) {
+		last_segment->depth.mm += depth_delta;
+		last_segment->next->depth.mm += depth_delta;
+	}
+	if (time_delta)
+		last_segment->next->time += time_delta;
+
+	struct dive *variation_dive = alloc_dive();
+	copy_dive(dive, variation_dive);
+	struct deco_state variation_ds = *ds;
+	plan(&variation_ds, &plan_copy, variation_dive, 1, stoptable, cache, true, false);
+	free_dps(&plan_copy);
+	free_dive(variation_dive);
+	return true;
+}
+
+// Takes ownership of the plan, the dive and the cache of the tissues after the previous dives
+void DivePlannerPointsModel::computeVariations(struct diveplan *original_plan, const struct deco_state *previous_ds,
+					       struct dive *dive, struct deco_state *cache, int instance)
 {
 	// nothing to do unless there's an original plan
-	if (!original_plan)
+	if (!original_plan) {
+		free_dive(dive);
+		free(cache);
 		return;
+	}
 
-	struct dive *dive = alloc_dive();
-	copy_dive(&displayed_dive, dive);
 	struct decostop original[60], deeper[60], shallower[60], shorter[60], longer[60];
-	struct deco_state *cache = NULL, *save = NULL;
-	struct diveplan plan_copy;
-	struct divedatapoint *last_segment;
-	struct deco_state ds = *previous_ds;
 
 	if (in_planner() && prefs.display_variations && decoMode() != RECREATIONAL) {
-		int my_instance = ++instanceCounter;
-		cache_deco_state(&ds, &save);
-
 		duration_t delta_time = { .seconds = 60 };
 		QString time_units = tr("min");
 		depth_t delta_depth;
@@ -1136,48 +1185,39 @@ void DivePlannerPointsModel::computeVariations(struct diveplan *original_plan, c
 			depth_units = tr("ft");
 		}
 
-		last_segment = cloneDiveplan(original_plan, &plan_copy);
-		if (!last_segment)
-			goto finish;
-		if (my_instance != instanceCounter)
-			goto finish;
-		plan(&ds, &plan_copy, dive, 1, original, &cache, true, false);
-		free_dps(&plan_copy);
-		restore_deco_state(save, &ds, false);
-
-		last_segment = cloneDiveplan(original_plan, &plan_copy);
-		last_segment->depth.mm += delta_depth.mm;
-		last_segment->next->depth.mm += delta_depth.mm;
-		if (my_instance != instanceCounter)
-			goto finish;
-		plan(&ds, &plan_copy, dive, 1, deeper, &cache, true, false);
-		free_dps(&plan_copy);
-		restore_deco_state(save, &ds, false);
-
-		last_segment = cloneDiveplan(original_plan, &plan_copy);
-		last_segment->depth.mm -= delta_depth.mm;
-		last_segment->next->depth.mm -= delta_depth.mm;
-		if (my_instance != instanceCounter)
-			goto finish;
-		plan(&ds, &plan_copy, dive, 1, shallower, &cache, true, false);
-		free_dps(&plan_copy);
-		restore_deco_state(save, &ds, false);
-
-		last_segment = cloneDiveplan(original_plan, &plan_copy);
-		last_segment->next->time += delta_time.seconds;
-		if (my_instance != instanceCounter)
+		// The variations are independent of each other, so calculate them in parallel,
+		// each with its own copy of the tissues after the previous dives. Normally, the
+		// plan that the variations belong to has calculated these already. Otherwise,
+		// the original plan runs first to fill the cache.
+		bool haveCache = cache != NULL;
+		if (!haveCache && !computeVariation(original_plan, dive, previous_ds, &cache, original, 0, 0, instance))
 			goto finish;
-		plan(&ds, &plan_copy, dive, 1, longer, &cache, true, false);
-		free_dps(&plan_copy);
-		restore_deco_state(save, &ds, false);
 
-		last_segment = cloneDiveplan(original_plan, &plan_copy);
-		last_segment->next->time -= delta_time.seconds;
-		if (my_instance != instanceCounter)
-			goto finish;
-		plan(&ds, &plan_copy, dive, 1, shorter, &cache, true, false);
-		free_dps(&plan_copy);
-		restore_deco_state(save, &ds, false);
+		struct Variation {
+			struct decostop *stoptable;
+			int depth_delta, time_delta;
+			bool done;
+		};
+		std::vector<Variation> variations {
+			{ deeper, delta_depth.mm, 0, false },
+			{ shallower, -delta_depth.mm, 0, false },
+			{ longer, 0, delta_time.seconds, false },
+			{ shorter, 0, -delta_time.seconds, false }
+		};
+		if (haveCache)
+			variations.push_back({ original, 0, 0, false });
+		QtConcurrent::blockingMap(variations, [&](Variation &v) {
+			struct deco_state *variation_cache = NULL;
+			if (cache)
+				cache_deco_state(cache, &variation_cache);
+			v.done = computeVariation(original_plan, dive, previous_ds, &variation_cache, v.stoptable,
+						  v.depth_delta, v.time_delta, instance);
+			free(variation_cache);
+		});
+		for (const Variation &v: variations) {
+			if (!v.done)
+				goto finish;
+		}
 
 		char buf[200];
 		sprintf(buf, ", %s: + %d:%02d /%s + %d:%02d /min", qPrintable(tr("Stop times")),
@@ -1185,7 +1225,7 @@ void DivePlannerPointsModel::computeVariations(struct diveplan *original_plan, c
 			FRACTION(analyzeVariations(shorter, original, longer, qPrintable(time_units)), 60));
 
 		// By using a signal, we can transport the variations to the main thread.
-		emit variationsComputed(QString(buf));
+		emit variationsComputed(QString(buf), instance);
 #ifdef DEBUG_STOPVAR
 		printf("\n\n");
 #endif
@@ -1193,14 +1233,16 @@ void DivePlannerPointsModel::computeVariations(struct diveplan *original_plan, c
 finish:
 	free_dps(original_plan);
 	free(original_plan);
-	free(save);
 	free(cache);
-	free(dive);
+	free_dive(dive);
 //	setRecalc(oldRecalc);
 }
 
-void DivePlannerPointsModel::computeVariationsDone(QString variations)
+void DivePlannerPointsModel::computeVariationsDone(QString variations, int instance)
 {
+	// The notes are of a newer plan, which will get its own variations
+	if (instance != instanceCounter)
+		return;
 	QString notes = QString(displayed_dive.notes);
 	free(displayed_dive.notes);
 	displayed_dive.notes = copy_qstring(notes.replace("VARIATIONS", variations));
@@ -1224,9 +1266,9 @@ void DivePlannerPointsModel::createPlan(bool replanCopy)
 	lock_planner();
 	cloneDiveplan(&diveplan, plan_copy);
 	unlock_planner();
-	computeVariations(plan_copy, &ds_after_previous_dives);
-
-	free(cache);
+	struct dive *dive_copy = alloc_dive();
+	copy_dive(&displayed_dive, dive_copy);
+	computeVariations(plan_copy, &ds_after_previous_dives, dive_copy, cache, ++instanceCounter);
 
 	// Fixup planner notes.
 	if (current_dive && displayed_dive.id == current_dive->id) {
@@ -4,9 +4,11 @@
 
 #include <QAbstractTableModel>
 #include <QDateTime>
+#include <atomic>
 
 #include "core/deco.h"
 #include "core/planner.h"
+#include "core/taskqueue.h"
 #include "qt-models/cylindermodel.h"
 
 class DivePlannerPointsModel : public QAbstractTableModel {
@@ -99,6 +101,7 @@ slots:
 	void deleteTemporaryPlan();
 	void loadFromDive(dive *d);
 	void emitDataChanged();
+	void cylindersChanged();
 	void setRebreatherMode(int mode);
 	void setReserveGas(int reserve);
 	void setSwitchAtReqStop(bool value);
@@ -119,23 +122,26 @@ signals:
 	void startTimeChanged(QDateTime);
 	void recreationChanged(bool);
 	void calculatedPlanNotes(QString);
-	void variationsComputed(QString);
+	void variationsComputed(QString, int instance);
 
 private:
 	explicit DivePlannerPointsModel(QObject *parent = 0);
 	void createPlan(bool replanCopy);
 	struct diveplan diveplan;
 	struct divedatapoint *cloneDiveplan(struct diveplan *plan_src, struct diveplan *plan_copy);
-	void computeVariationsDone(QString text);
-	void computeVariations(struct diveplan *diveplan, const struct deco_state *ds);
-	void computeVariationsFreeDeco(struct diveplan *diveplan, struct deco_state *ds);
+	void computeVariationsDone(QString text, int instance);
+	void computeVariations(struct diveplan *diveplan, const struct deco_state *ds, struct dive *dive, struct deco_state *cache, int instance);
+	void computeVariationsFreeDeco(struct diveplan *diveplan, struct deco_state *ds, struct dive *dive, struct deco_state *cache, int instance);
+	bool computeVariation(struct diveplan *original_plan, const struct dive *dive, const struct deco_state *ds, struct deco_state **cache,
+			      struct decostop *stoptable, int depth_delta, int time_delta, int instance);
 	int analyzeVariations(struct decostop *min, struct decostop *mid, struct decostop *max, const char *unit);
 	CylindersModel cylinders;
 	Mode mode;
 	bool recalc;
 	QVector<divedatapoint> divepoints;
 	QDateTime startTime;
-	int instanceCounter = 0;
+	std::atomic<int> instanceCounter { 0 };	// Each plan gets a new instance, older variations are dropped
+	TaskQueue variationsQueue { TaskClass::Interactive, 1 };	// One plan at a time, the outdated ones return right away
 	struct deco_state ds_after_previous_dives;
 	duration_t preserved_until;
 };
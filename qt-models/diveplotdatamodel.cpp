@@ -5,6 +5,8 @@
 #include "core/divelist.h"
 #include "core/color.h"
 
+#include <algorithm>
+
 DivePlotDataModel::DivePlotDataModel(QObject *parent) :
 	QAbstractTableModel(parent),
 	dcNr(0)
@@ -28,73 +30,88 @@ QVariant DivePlotDataModel::data(const QModelIndex &index, int role) const
 	if ((!index.isValid()) || (index.row() >= pInfo.nr) || pInfo.entry == 0)
 		return QVariant();
 
-	plot_data item = pInfo.entry[index.row()];
 	if (role == Qt::DisplayRole) {
-		switch (index.column()) {
-		case DEPTH:
-			return item.depth;
-		case TIME:
-			return item.sec;
-		case PRESSURE:
-			return get_plot_sensor_pressure(&pInfo, index.row(), 0);
-		case TEMPERATURE:
-			return item.temperature;
-		case COLOR:
-			return item.velocity;
-		case USERENTERED:
+		if (index.column() == USERENTERED)
 			return false;
-		case SENSOR_PRESSURE:
-			return get_plot_sensor_pressure(&pInfo, index.row(), 0);
-		case INTERPOLATED_PRESSURE:
-			return get_plot_interpolated_pressure(&pInfo, index.row(), 0);
-		case CEILING:
-			return item.ceiling;
-		case SAC:
-			return item.sac;
-		case PN2:
-			return item.pressures.n2;
-		case PHE:
-			return item.pressures.he;
-		case PO2:
-			return item.pressures.o2;
-		case O2SETPOINT:
-			return item.o2setpoint.mbar / 1000.0;
-		case CCRSENSOR1:
-			return item.o2sensor[0].mbar / 1000.0;
-		case CCRSENSOR2:
-			return item.o2sensor[1].mbar / 1000.0;
-		case CCRSENSOR3:
-			return item.o2sensor[2].mbar / 1000.0;
-		case SCR_OC_PO2:
-			return item.scr_OC_pO2.mbar / 1000.0;
-		case HEARTBEAT:
-			return item.heartbeat;
-		case AMBPRESSURE:
-			return AMB_PERCENTAGE;
-		case GFLINE:
-			return item.gfline;
-		case INSTANT_MEANDEPTH:
-			return item.running_sum;
-		}
-	}
-
-	if (role == Qt::DisplayRole && index.column() >= TISSUE_1 && index.column() <= TISSUE_16) {
-		return item.ceilings[index.column() - TISSUE_1];
-	}
-
-	if (role == Qt::DisplayRole && index.column() >= PERCENTAGE_1 && index.column() <= PERCENTAGE_16) {
-		return item.percentages[index.column() - PERCENTAGE_1];
+		if (index.column() >= 0 && index.column() < COLUMNS)
+			return value(index.row(), index.column());
 	}
 
 	if (role == Qt::BackgroundRole) {
 		switch (index.column()) {
 		case COLOR:
-			return getColor((color_index_t)(VELOCITY_COLORS_START_IDX + item.velocity));
+			return getColor((color_index_t)(VELOCITY_COLORS_START_IDX + pInfo.entry[index.row()].velocity));
 		}
 	}
 	return QVariant();
 }
 
+double DivePlotDataModel::value(int row, int column) const
+{
+	const plot_data &item = pInfo.entry[row];
+	switch (column) {
+	case DEPTH:
+		return item.depth;
+	case TIME:
+		return item.sec;
+	case PRESSURE:
+		return get_plot_sensor_pressure(&pInfo, row, 0);
+	case TEMPERATURE:
+		return item.temperature;
+	case COLOR:
+		return item.velocity;
+	case SENSOR_PRESSURE:
+		return get_plot_sensor_pressure(&pInfo, row, 0);
+	case INTERPOLATED_PRESSURE:
+		return get_plot_interpolated_pressure(&pInfo, row, 0);
+	case CEILING:
+		return item.ceiling;
+	case SAC:
+		return item.sac;
+	case PN2:
+		return item.pressures.n2;
+	case PHE:
+		return item.pressures.he;
+	case PO2:
+		return item.pressures.o2;
+	case O2SETPOINT:
+		return item.o2setpoint.mbar / 1000.0;
+	case CCRSENSOR1:
+		return item.o2sensor[0].mbar / 1000.0;
+	case CCRSENSOR2:
+		return item.o2sensor[1].mbar / 1000.0;
+	case CCRSENSOR3:
+		return item.o2sensor[2].mbar / 1000.0;
+	case SCR_OC_PO2:
+		return item.scr_OC_pO2.mbar / 1000.0;
+	case HEARTBEAT:
+		return item.heartbeat;
+	case AMBPRESSURE:
+		return AMB_PERCENTAGE;
+	case GFLINE:
+		return item.gfline;
+	case INSTANT_MEANDEPTH:
+		return item.running_sum;
+	}
+
+	if (column >= TISSUE_1 && column <= TISSUE_16)
+		return get_plot_tissue_ceiling(&pInfo, row, column - TISSUE_1);
+
+	if (column >= PERCENTAGE_1 && column <= PERCENTAGE_16)
+		return get_plot_tissue_percentage(&pInfo, row, column - PERCENTAGE_1);
+
+	return 0.0;
+}
+
+int DivePlotDataModel::rowAtTime(int sec) const
+{
+	// The samples are sorted by time
+	const plot_data *end = pInfo.entry + pInfo.nr;
+	const plot_data *it = std::lower_bound(pInfo.entry, end, sec,
+					       [](const plot_data &entry, int sec) { return entry.sec < sec; });
+	return it != end && it->sec == sec ? it - pInfo.entry : -1;
+}
+
 const plot_info &DivePlotDataModel::data() const
 {
 	return pInfo;
@@ -173,8 +190,10 @@ void DivePlotDataModel::clear()
 		pInfo.nr = 0;
 		free(pInfo.entry);
 		free(pInfo.pressures);
+		free(pInfo.tissues);
 		pInfo.entry = nullptr;
 		pInfo.pressures = nullptr;
+		pInfo.tissues = nullptr;
 		dcNr = -1;
 		endRemoveRows();
 	}
@@ -186,11 +205,16 @@ void DivePlotDataModel::setDive(dive *d, const plot_info &info)
 	dcNr = dc_number;
 	free(pInfo.entry);
 	free(pInfo.pressures);
+	free(pInfo.tissues);
 	pInfo = info;
 	pInfo.entry = (plot_data *)malloc(sizeof(plot_data) * pInfo.nr);
 	memcpy(pInfo.entry, info.entry, sizeof(plot_data) * pInfo.nr);
 	pInfo.pressures = (plot_pressure_data *)malloc(sizeof(plot_pressure_data) * pInfo.nr_cylinders * pInfo.nr);
 	memcpy(pInfo.pressures, info.pressures, sizeof(plot_pressure_data) * pInfo.nr_cylinders * pInfo.nr);
+	if (info.tissues) {
+		pInfo.tissues = (plot_tissue_data *)malloc(sizeof(plot_tissue_data) * pInfo.nr);
+		memcpy(pInfo.tissues, info.tissues, sizeof(plot_tissue_data) * pInfo.nr);
+	}
 	endResetModel();
 }
 
@@ -81,6 +81,11 @@ public:
 	void clear();
 	void setDive(struct dive *d, const plot_info &pInfo);
 	const plot_info &data() const;
+	// The value shown for a column, read directly from the plot data without
+	// boxing it into a QVariant. The row must be valid.
+	double value(int row, int column) const;
+	// The row of the sample at the given time or -1 if there is none
+	int rowAtTime(int sec) const;
 	unsigned int dcShown() const;
 	double pheMax();
 	double pn2Max();
@@ -1,11 +1,53 @@
 // SPDX-License-Identifier: GPL-2.0
 #include "qt-models/divesummarymodel.h"
 #include "core/dive.h"
+#include "core/divelist.h"
 #include "core/qthelper.h"
+#include "core/subsurface-qt/divelistnotifier.h"
+
+#include <algorithm>
 
 #include <QLocale>
 #include <QDateTime>
 
+struct Stats {
+	Stats();
+	void add(const Stats &s);
+	int dives, divesEAN, divesDeep, diveplans;
+	int64_t divetime, depth;
+	int64_t divetimeMax, depthMax, sacMin, sacMax;
+	int64_t totalSACTime, totalSacVolume;
+};
+
+struct DayStats {
+	timestamp_t day;	// start of the day
+	int firstDive;		// index of the first dive of the day in the dive table
+	Stats fromDay;		// the dives of this and all later days
+};
+
+DiveSummaryModel::DiveSummaryModel(QObject *parent) : QAbstractTableModel(parent),
+	daysValid(false)
+{
+	connect(&diveListNotifier, &DiveListNotifier::dataReset, this, &DiveSummaryModel::invalidate);
+	connect(&diveListNotifier, &DiveListNotifier::divesAdded, this, &DiveSummaryModel::invalidate);
+	connect(&diveListNotifier, &DiveListNotifier::divesDeleted, this, &DiveSummaryModel::invalidate);
+	connect(&diveListNotifier, &DiveListNotifier::divesChanged, this, &DiveSummaryModel::invalidate);
+	connect(&diveListNotifier, &DiveListNotifier::divesTimeChanged, this, &DiveSummaryModel::invalidate);
+	connect(&diveListNotifier, &DiveListNotifier::cylindersReset, this, &DiveSummaryModel::invalidate);
+	connect(&diveListNotifier, &DiveListNotifier::cylinderAdded, this, &DiveSummaryModel::invalidate);
+	connect(&diveListNotifier, &DiveListNotifier::cylinderRemoved, this, &DiveSummaryModel::invalidate);
+	connect(&diveListNotifier, &DiveListNotifier::cylinderEdited, this, &DiveSummaryModel::invalidate);
+}
+
+DiveSummaryModel::~DiveSummaryModel()
+{
+}
+
+void DiveSummaryModel::invalidate()
+{
+	daysValid = false;
+}
+
 int DiveSummaryModel::rowCount(const QModelIndex &) const
 {
 	return NUM_ROW;
@@ -98,15 +140,6 @@ QVariant DiveSummaryModel::headerData(int section, Qt::Orientation orientation,
 	return QVariant();
 }
 
-struct Stats {
-	Stats();
-	int dives, divesEAN, divesDeep, diveplans;
-	int64_t divetime, depth;
-	int64_t divetimeMax, depthMax, sacMin, sacMax;
-	int64_t divetimeAvg, depthAvg, sacAvg;
-	int64_t totalSACTime, totalSacVolume;
-};
-
 Stats::Stats() :
 	dives(0), divesEAN(0), divesDeep(0), diveplans(0),
 	divetime(0), depth(0), divetimeMax(0), depthMax(0),
@@ -114,6 +147,22 @@ Stats::Stats() :
 {
 }
 
+void Stats::add(const Stats &s)
+{
+	dives += s.dives;
+	divesEAN += s.divesEAN;
+	divesDeep += s.divesDeep;
+	diveplans += s.diveplans;
+	divetime += s.divetime;
+	depth += s.depth;
+	divetimeMax = std::max(divetimeMax, s.divetimeMax);
+	depthMax = std::max(depthMax, s.depthMax);
+	sacMin = std::min(sacMin, s.sacMin);
+	sacMax = std::max(sacMax, s.sacMax);
+	totalSACTime += s.totalSACTime;
+	totalSacVolume += s.totalSacVolume;
+}
+
 static void calculateDive(struct dive *dive, Stats &stats)
 {
 	if (is_dc_planner(&dive->dc)) {
@@ -155,18 +204,44 @@ static void calculateDive(struct dive *dive, Stats &stats)
 	}
 }
 
-// Returns a (first_dive, last_dive) pair
-static Stats loopDives(timestamp_t start)
+static timestamp_t startOfDay(timestamp_t when)
 {
-	Stats stats;
-	struct dive *dive;
-	int i;
+	timestamp_t day = when / (24 * 3600) * (24 * 3600);
+	return day > when ? day - 24 * 3600 : day;
+}
+
+// The dive table is sorted by time. Summing up the days from the end gives the
+// statistics from each day on, so that a period only adds the dives of its first day.
+void DiveSummaryModel::updateDays()
+{
+	if (daysValid)
+		return;
+	days.clear();
+	for (int i = 0; i < dive_table.nr; ++i) {
+		timestamp_t day = startOfDay(dive_table.dives[i]->when);
+		if (days.empty() || days.back().day != day)
+			days.push_back({ day, i, Stats() });
+		calculateDive(dive_table.dives[i], days.back().fromDay);
+	}
+	for (int i = (int)days.size() - 2; i >= 0; --i)
+		days[i].fromDay.add(days[i + 1].fromDay);
+	daysValid = true;
+}
 
-	for_each_dive (i, dive) {
-		// check if dive is newer than primaryStart (add to first column)
-		if (dive->when > start)
-			calculateDive(dive, stats);
+// The statistics of the dives after start
+static Stats loopDives(const std::vector<DayStats> &days, timestamp_t start)
+{
+	Stats stats;
+	auto it = std::upper_bound(days.begin(), days.end(), start,
+				   [](timestamp_t t, const DayStats &d) { return t < d.day; });
+	int end = dive_table.nr;
+	if (it != days.end()) {
+		stats = it->fromDay;
+		end = it->firstDive;
 	}
+	// The dives of the day that contains the start of the period
+	for (int i = first_dive_after(start); i < end; ++i)
+		calculateDive(dive_table.dives[i], stats);
 	return stats;
 }
 
@@ -265,8 +340,8 @@ void DiveSummaryModel::calc(int column, int period)
 	else
 		start = dateTimeToTimestamp(startTime) + gettimezoneoffset();
 
-	// Loop over all dives and sum up data
-	Stats stats = loopDives(start);
+	updateDays();
+	Stats stats = loopDives(days, start);
 	results[column] = formatResults(stats);
 
 	// For QML always reload column 0, because that works via roles not columns
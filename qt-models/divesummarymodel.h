@@ -5,6 +5,8 @@
 #include <QAbstractTableModel>
 #include <vector>
 
+struct DayStats;
+
 class DiveSummaryModel : public QAbstractTableModel {
 	Q_OBJECT
 public:
@@ -42,6 +44,8 @@ public:
 		QString sac_min, sac_max, sac_avg;
 	};
 
+	DiveSummaryModel(QObject *parent = nullptr);
+	~DiveSummaryModel();
 	Q_INVOKABLE void setNumData(int num);
 	Q_INVOKABLE void calc(int column, int period);
 private:
@@ -52,8 +56,14 @@ private:
 	QVariant headerData(int section, Qt::Orientation orientation, int role) const override;
 
 	QVariant dataDisplay(int row, int col) const;
+	void invalidate();
+	void updateDays();
 
 	std::vector<Result> results;
+	// The periods end now, so they are made up of the last days of the log.
+	// The statistics of the dives from each day on are kept until the dives change.
+	std::vector<DayStats> days;
+	bool daysValid;
 };
 
 #endif
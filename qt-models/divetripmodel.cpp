@@ -13,11 +13,14 @@
 #include "core/picture.h"
 #include "core/subsurface-string.h"
 #include "core/tag.h"
+#include "core/settings/qPrefLanguage.h"
+#include "core/settings/qPrefUnit.h"
 #include "qt-models/divelocationmodel.h" // For the dive-site field ids
 #include "commands/command.h"
 #include <QIcon>
 #include <QDebug>
 #include <QDateTime>
+#include <QHash>
 #include <memory>
 #include <algorithm>
 
@@ -156,7 +159,7 @@ static int countPhotos(const struct dive *d)
 static QString displayDuration(const struct dive *d)
 {
 	if (prefs.units.show_units_table)
-		return get_dive_duration_string(d->duration.seconds, gettextFromC::tr("h"), gettextFromC::tr("min"), "", ":", d->dc.divemode == FREEDIVE);
+		return get_dive_duration_string(d->duration.seconds, get_unit_names().h, get_unit_names().min, "", ":", d->dc.divemode == FREEDIVE);
 	else
 		return get_dive_duration_string(d->duration.seconds, "", "", "", ":", d->dc.divemode == FREEDIVE);
 }
@@ -173,18 +176,13 @@ static QString displaySac(const struct dive *d, bool units)
 	if (!d->sac)
 		return QString();
 	QString s = get_volume_string(d->sac, units);
-	return units ? s + gettextFromC::tr("/min") : s;
+	return units ? s + get_unit_names().perMin : s;
 }
 
 static QString displayWeight(const struct dive *d, bool units)
 {
 	QString s = weight_string(total_weight(d));
-	if (!units)
-		return s;
-	else if (get_units()->weight == units::KG)
-		return s + gettextFromC::tr("kg");
-	else
-		return s + gettextFromC::tr("lbs");
+	return units ? s + get_weight_unit() : s;
 }
 
 QVariant DiveTripModelBase::diveData(const struct dive *d, int column, int role) const
@@ -196,18 +194,22 @@ QVariant DiveTripModelBase::diveData(const struct dive *d, int column, int role)
 	// We have to return a QString as trip-id, because that will be used as section
 	// variable in the QtQuick list view. That has to be a string because it will try
 	// to do locale-aware sorting. And amazingly this can't be changed.
-	case MobileListModel::DateTimeRole: {
-		QDateTime localTime = timestampToDateTime(d->when);
-		return QStringLiteral("%1 %2").arg(localTime.date().toString(prefs.date_format_short),
-						   localTime.time().toString(prefs.time_format));
-		}
+	case MobileListModel::DateTimeRole:
+		return rowString(d, role, [d]() {
+			QDateTime localTime = timestampToDateTime(d->when);
+			return QStringLiteral("%1 %2").arg(localTime.date().toString(prefs.date_format_short),
+							   localTime.time().toString(prefs.time_format));
+		});
 	case MobileListModel::IdRole: return d->id;
 	case MobileListModel::NumberRole: return d->number;
-	case MobileListModel::LocationRole: return get_dive_location(d);
+	case MobileListModel::LocationRole: return rowString(d, role, [d]() { return QString(get_dive_location(d)); });
 	case MobileListModel::DepthRole: return get_depth_string(d->dc.maxdepth.mm, true, true);
-	case MobileListModel::DurationRole: return get_dive_duration_string(d->duration.seconds, gettextFromC::tr("h"), gettextFromC::tr("min"));
-	case MobileListModel::DepthDurationRole: return QStringLiteral("%1 / %2").arg(get_depth_string(d->dc.maxdepth.mm, true, true),
-								     get_dive_duration_string(d->duration.seconds, gettextFromC::tr("h"), gettextFromC::tr("min")));
+	case MobileListModel::DurationRole: return get_dive_duration_string(d->duration.seconds, get_unit_names().h, get_unit_names().min);
+	case MobileListModel::DepthDurationRole:
+		return rowString(d, role, [d]() {
+			return QStringLiteral("%1 / %2").arg(get_depth_string(d->dc.maxdepth.mm, true, true),
+							     get_dive_duration_string(d->duration.seconds, get_unit_names().h, get_unit_names().min));
+		});
 	case MobileListModel::RatingRole: return d->rating;
 	case MobileListModel::VizRole: return d->visibility;
 	case MobileListModel::SuitRole: return d->suit;
@@ -225,7 +227,11 @@ QVariant DiveTripModelBase::diveData(const struct dive *d, int column, int role)
 	case MobileListModel::DiveSiteRole: return QVariant::fromValue(d->dive_site);
 	case MobileListModel::CylinderRole: return formatGetCylinder(d).join(", ");
 	case MobileListModel::GetCylinderRole: return formatGetCylinder(d);
-	case MobileListModel::CylinderListRole: return getFullCylinderList();
+	case MobileListModel::CylinderListRole:
+		// This is the same for all dives and loops over all cylinders of all dives
+		if (fullCylinderList.isEmpty())
+			fullCylinderList = getFullCylinderList();
+		return fullCylinderList;
 	case MobileListModel::SingleWeightRole: return d->weightsystems.nr <= 1;
 	case MobileListModel::StartPressureRole: return getStartPressure(d);
 	case MobileListModel::EndPressureRole: return getEndPressure(d);
@@ -491,8 +497,56 @@ DiveTripModelBase::DiveTripModelBase(QObject *parent) : QAbstractItemModel(paren
 	invalidForeground(Qt::gray)
 {
 	invalidFont.setStrikeOut(true);
+#ifdef SUBSURFACE_MOBILE
+	auto clearCylinderList = [this]() { fullCylinderList.clear(); };
+	connect(&diveListNotifier, &DiveListNotifier::dataReset, this, clearCylinderList);
+	connect(&diveListNotifier, &DiveListNotifier::divesAdded, this, clearCylinderList);
+	connect(&diveListNotifier, &DiveListNotifier::divesDeleted, this, clearCylinderList);
+	connect(&diveListNotifier, &DiveListNotifier::cylindersReset, this, clearCylinderList);
+	connect(&diveListNotifier, &DiveListNotifier::cylinderAdded, this, clearCylinderList);
+	connect(&diveListNotifier, &DiveListNotifier::cylinderEdited, this, clearCylinderList);
+	connect(&diveListNotifier, &DiveListNotifier::cylinderRemoved, this, clearCylinderList);
+
+	connect(&diveListNotifier, &DiveListNotifier::dataReset, this, &DiveTripModelBase::clearRowStrings);
+	connect(&diveListNotifier, &DiveListNotifier::divesAdded, this, &DiveTripModelBase::clearRowStrings);
+	connect(&diveListNotifier, &DiveListNotifier::divesDeleted, this, &DiveTripModelBase::clearRowStrings);
+	connect(&diveListNotifier, &DiveListNotifier::divesChanged, this, &DiveTripModelBase::clearRowStrings);
+	connect(&diveListNotifier, &DiveListNotifier::divesTimeChanged, this, &DiveTripModelBase::clearRowStrings);
+	connect(&diveListNotifier, &DiveListNotifier::divesMovedBetweenTrips, this, &DiveTripModelBase::clearRowStrings);
+	connect(&diveListNotifier, &DiveListNotifier::diveSiteChanged, this, &DiveTripModelBase::clearRowStrings);
+	connect(&diveListNotifier, &DiveListNotifier::tripChanged, this, &DiveTripModelBase::clearRowStrings);
+	connect(&diveListNotifier, &DiveListNotifier::filterReset, this, &DiveTripModelBase::clearRowStrings);
+	connect(&diveListNotifier, &DiveListNotifier::numShownChanged, this, &DiveTripModelBase::clearRowStrings);
+	connect(qPrefUnits::instance(), &qPrefUnits::unit_systemChanged, this, &DiveTripModelBase::clearRowStrings);
+	connect(qPrefUnits::instance(), &qPrefUnits::lengthChanged, this, &DiveTripModelBase::clearRowStrings);
+	connect(qPrefLanguage::instance(), &qPrefLanguage::date_format_shortChanged, this, &DiveTripModelBase::clearRowStrings);
+	connect(qPrefLanguage::instance(), &qPrefLanguage::time_formatChanged, this, &DiveTripModelBase::clearRowStrings);
+#endif
+}
+
+#ifdef SUBSURFACE_MOBILE
+// Formatting the dates, depths and titles of the rows of the mobile dive list is
+// slow enough to make the first scroll through the list jerky. Therefore, these
+// texts are kept until anything changes. MobileListModel prepares them for the
+// first rows when the list is reset.
+template <typename F>
+QString DiveTripModelBase::rowString(const void *item, int role, F format) const
+{
+	auto key = qMakePair(item, role);
+	auto it = rowStrings.constFind(key);
+	if (it != rowStrings.cend())
+		return *it;
+	QString res = format();
+	rowStrings.insert(key, res);
+	return res;
 }
 
+void DiveTripModelBase::clearRowStrings()
+{
+	rowStrings.clear();
+}
+#endif
+
 int DiveTripModelBase::columnCount(const QModelIndex&) const
 {
 	return COLUMNS;
@@ -709,16 +763,21 @@ DiveTripModelTree::DiveTripModelTree(QObject *parent) : DiveTripModelBase(parent
 
 void DiveTripModelTree::populate()
 {
+	DiveFilter::instance()->invalidateCache();
 	DiveFilter::instance()->updateAll(); // The data was reset - update filter status. TODO: should this really be done here?
 
 	// we want this to be two calls as the second text is overwritten below by the lines starting with "\r"
 	uiNotification(QObject::tr("populate data model"));
 	uiNotification(QObject::tr("start processing"));
+
+	// Remember the item of each trip, so that we don't have to search
+	// all items for every dive. That would be quadratic in the number of trips.
+	QHash<const dive_trip *, size_t> tripItems;
+	tripItems.reserve(trip_table.nr);
 	for (int i = 0; i < dive_table.nr; ++i) {
 		dive *d = get_dive(i);
 		if (!d) // should never happen
 			continue;
-		update_cylinder_related_info(d);
 		if (d->hidden_by_filter)
 			continue;
 		dive_trip_t *trip = d->divetrip;
@@ -729,16 +788,15 @@ void DiveTripModelTree::populate()
 			continue;
 		}
 
-		// Check if that trip is already known to us: search for the first item
-		// that corresponds to that trip
-		auto it = std::find_if(items.begin(), items.end(), [trip](const Item &item)
-				       { return item.d_or_t.trip == trip; });
-		if (it == items.end()) {
+		// Check if that trip is already known to us
+		auto it = tripItems.find(trip);
+		if (it == tripItems.end()) {
 			// We didn't find an entry for this trip -> add one
+			tripItems.insert(trip, items.size());
 			items.emplace_back(trip, d);
 		} else {
 			// We found the trip -> simply add the dive
-			it->dives.push_back(d);
+			items[*it].dives.push_back(d);
 		}
 	}
 
@@ -878,10 +936,8 @@ void processByTrip(QVector<dive *> dives, Function action)
 void DiveTripModelTree::filterReset()
 {
 	ShownChange change = updateShownAll();
-	processByTrip(change.newHidden, [this] (dive_trip *trip, const QVector<dive *> &divesInTrip)
-		      { divesHidden(trip, divesInTrip); });
-	processByTrip(change.newShown, [this] (dive_trip *trip, const QVector<dive *> &divesInTrip)
-		      { divesShown(trip, divesInTrip); });
+	hideDivesAll(change.newHidden);
+	showDivesAll(change.newShown);
 
 	// If the current dive changed, instruct the UI of the changed selection
 	// TODO: This is way to heavy, as it reloads the whole selection!
@@ -889,6 +945,95 @@ void DiveTripModelTree::filterReset()
 		initSelection();
 }
 
+// Row of every trip and top-level dive, to avoid a linear search for each of them
+QHash<const void *, int> DiveTripModelTree::topLevelRows() const
+{
+	QHash<const void *, int> res;
+	res.reserve(items.size());
+	for (int i = 0; i < (int)items.size(); ++i) {
+		const dive_or_trip &d_or_t = items[i].d_or_t;
+		res.insert(d_or_t.trip ? (const void *)d_or_t.trip : (const void *)d_or_t.dive, i);
+	}
+	return res;
+}
+
+// Remove the dives that were hidden by a filter change. Trips and top-level
+// dives that disappear completely are removed in runs of contiguous rows,
+// so that views and the sort model get one signal per run, not per row.
+void DiveTripModelTree::hideDivesAll(const QVector<dive *> &dives)
+{
+	if (dives.empty())
+		return;
+	QHash<const void *, int> rows = topLevelRows();
+	std::vector<char> removeRow(items.size(), false);
+	processByTrip(dives, [&](dive_trip *trip, const QVector<dive *> &divesInTrip) {
+		if (!trip) {
+			for (const dive *d: divesInTrip) {
+				int idx = rows.value(d, -1);
+				if (idx >= 0)
+					removeRow[idx] = true;
+			}
+			return;
+		}
+		int idx = rows.value(trip, -1);
+		if (idx < 0) {
+			qWarning("DiveTripModelTree::hideDivesAll(): unknown trip");
+		} else if (divesInTrip.size() == (int)items[idx].dives.size()) {
+			removeRow[idx] = true;
+		} else {
+			removeDivesFromTrip(idx, divesInTrip);
+			dataChanged(createIndex(idx, 0, noParent), createIndex(idx, 0, noParent));
+		}
+	});
+
+	// Remove from the back, so that the indices of the remaining runs stay valid
+	for (int last = (int)items.size() - 1; last >= 0; --last) {
+		if (!removeRow[last])
+			continue;
+		int first = last;
+		while (first > 0 && removeRow[first - 1])
+			--first;
+		beginRemoveRows(QModelIndex(), first, last);
+		items.erase(items.begin() + first, items.begin() + last + 1);
+		endRemoveRows();
+		last = first;
+	}
+}
+
+// Add the dives that are shown after a filter change. Newly shown trips and
+// top-level dives are inserted in runs of contiguous rows.
+void DiveTripModelTree::showDivesAll(const QVector<dive *> &dives)
+{
+	if (dives.empty())
+		return;
+	QHash<const void *, int> rows = topLevelRows();
+	std::vector<Item> newItems;
+	processByTrip(dives, [&](dive_trip *trip, const QVector<dive *> &divesInTrip) {
+		if (!trip) {
+			for (dive *d: divesInTrip)
+				newItems.emplace_back(d);
+			return;
+		}
+		int idx = rows.value(trip, -1);
+		if (idx < 0) {
+			newItems.emplace_back(trip, divesInTrip);	// Trip had no visible dives.
+		} else {
+			addDivesToTrip(idx, divesInTrip);
+			// Update the shown-count of the trip.
+			dataChanged(createIndex(idx, 0, noParent), createIndex(idx, 0, noParent));
+		}
+	});
+
+	auto itemLessThan = [](const Item &i1, const Item &i2) { return dive_or_trip_less_than(i1.d_or_t, i2.d_or_t); };
+	std::sort(newItems.begin(), newItems.end(), itemLessThan);
+	addInBatches(items, newItems, itemLessThan,
+		     [&](std::vector<Item> &items, const std::vector<Item> &newItems, int idx, int from, int to) { // inserter
+			beginInsertRows(QModelIndex(), idx, idx + to - from - 1);
+			items.insert(items.begin() + idx, newItems.begin() + from, newItems.begin() + to);
+			endInsertRows();
+		     });
+}
+
 void DiveTripModelTree::divesShown(dive_trip *trip, const QVector<dive *> &dives)
 {
 	if (dives.empty())
@@ -946,6 +1091,10 @@ QVariant DiveTripModelTree::data(const QModelIndex &index, int role) const
 		return std::find(item.dives.begin(), item.dives.end(), current_dive) != item.dives.end();
 	}
 	if (entry.trip) {
+#if defined(SUBSURFACE_MOBILE)
+		if (role == MobileListModel::TripShortDateRole || role == MobileListModel::TripTitleRole)
+			return rowString(entry.trip, role, [&entry, role]() { return tripData(entry.trip, 0, role).toString(); });
+#endif
 		return tripData(entry.trip, index.column(), role);
 	} else if (entry.dive) {
 #if defined(SUBSURFACE_MOBILE)
@@ -1473,11 +1622,160 @@ DiveTripModelList::DiveTripModelList(QObject *parent) : DiveTripModelBase(parent
 	connect(&diveListNotifier, &DiveListNotifier::picturesAdded, this, &DiveTripModelList::diveChanged);
 	connect(&diveListNotifier, &DiveListNotifier::dataReset, this, &DiveTripModelList::reset);
 
+	// Any change of the rows or their data changes the sort keys. These are
+	// connected before the sort model, so the keys are updated before it re-sorts.
+	connect(this, &QAbstractItemModel::modelReset, this, &DiveTripModelList::invalidateSortKeys);
+	connect(this, &QAbstractItemModel::layoutChanged, this, &DiveTripModelList::invalidateSortKeys);
+	connect(this, &QAbstractItemModel::rowsMoved, this, &DiveTripModelList::invalidateSortKeys);
+	// Edits and added or removed dives only update the keys of their rows
+	connect(this, &QAbstractItemModel::rowsInserted, this, &DiveTripModelList::sortKeysInserted);
+	connect(this, &QAbstractItemModel::rowsRemoved, this, &DiveTripModelList::sortKeysRemoved);
+	connect(this, &QAbstractItemModel::dataChanged, this, &DiveTripModelList::sortKeysChanged);
+
 	populate();
 }
 
+void DiveTripModelList::invalidateSortKeys()
+{
+	sortKeys.clear();
+	stringKeys.clear();
+	sortKeyColumn = -1;
+	uncachedComparisons = 0;
+}
+
+// The collator of all string comparisons, so that sort keys and direct comparisons agree
+static const QCollator &sortCollator()
+{
+	static QCollator collator;
+	return collator;
+}
+
+static bool isStringColumn(int column)
+{
+	return column != DiveTripModelBase::TOTALWEIGHT && column != DiveTripModelBase::GAS &&
+	       column != DiveTripModelBase::PHOTOS;
+}
+
+// Keys of string columns: the collator keys only exist for non-null strings
+static const int nullString = -1;	// sorts before the strings, like strCmp()
+static const int noCylinder = -2;	// sorts before dives with cylinders, see lessThan()
+
+void DiveTripModelList::computeSortKey(size_t row) const
+{
+	const dive *d = items[row];
+	QString s;
+	int key = 0;
+	switch (sortKeyColumn) {
+	case TOTALWEIGHT:
+		key = total_weight(d);
+		break;
+	case GAS:
+		key = nitrox_sort_value(d);
+		break;
+	case PHOTOS:
+		key = countPhotos(d);
+		break;
+	case SUIT:
+		s = QString(d->suit);
+		break;
+	case CYLINDER:
+		if (d->cylinders.nr > 0)
+			s = QString(get_cylinder(d, 0)->type.description);
+		else
+			key = noCylinder;
+		break;
+	case TAGS: {
+		char *tags = taglist_get_tagstring(d->tag_list);
+		s = QString(tags);
+		free(tags);
+		break;
+	}
+	case COUNTRY:
+		s = QString(get_dive_country(d));
+		break;
+	case BUDDIES:
+		s = QString(d->buddy);
+		break;
+	case LOCATION:
+		s = QString(get_dive_location(d));
+		break;
+	}
+	if (isStringColumn(sortKeyColumn)) {
+		if (key == 0 && s.isNull())
+			key = nullString;
+		if (key == 0)
+			stringKeys[row] = sortCollator().sortKey(s);
+		else
+			stringKeys[row].reset();
+	}
+	sortKeys[row] = key;
+}
+
+void DiveTripModelList::computeSortKeys(int column) const
+{
+	sortKeyColumn = column;
+	sortKeys.assign(items.size(), 0);
+	stringKeys.clear();
+	if (isStringColumn(column))
+		stringKeys.resize(items.size());
+	for (size_t i = 0; i < items.size(); ++i)
+		computeSortKey(i);
+}
+
+// Negative if row1 sorts before row2, zero if they are equal
+int DiveTripModelList::compareSortKeys(int row1, int row2) const
+{
+	if (sortKeys[row1] != sortKeys[row2] || stringKeys.empty())
+		return sortKeys[row1] < sortKeys[row2] ? -1 : sortKeys[row1] > sortKeys[row2] ? 1 : 0;
+	if (!stringKeys[row1] || !stringKeys[row2])
+		return 0;
+	return stringKeys[row1]->compare(*stringKeys[row2]);
+}
+
+void DiveTripModelList::sortKeysInserted(const QModelIndex &, int first, int last)
+{
+	if (sortKeyColumn < 0)
+		return;
+	sortKeys.insert(sortKeys.begin() + first, last - first + 1, 0);
+	if (!stringKeys.empty() || isStringColumn(sortKeyColumn))
+		stringKeys.insert(stringKeys.begin() + first, last - first + 1, std::nullopt);
+	for (int row = first; row <= last; ++row)
+		computeSortKey(row);
+}
+
+void DiveTripModelList::sortKeysRemoved(const QModelIndex &, int first, int last)
+{
+	if (sortKeyColumn < 0)
+		return;
+	sortKeys.erase(sortKeys.begin() + first, sortKeys.begin() + last + 1);
+	if (!stringKeys.empty())
+		stringKeys.erase(stringKeys.begin() + first, stringKeys.begin() + last + 1);
+}
+
+void DiveTripModelList::sortKeysChanged(const QModelIndex &topLeft, const QModelIndex &bottomRight)
+{
+	if (sortKeyColumn < 0)
+		return;
+	for (int row = topLeft.row(); row <= bottomRight.row(); ++row)
+		computeSortKey(row);
+}
+
+// Building the keys costs about as much as comparing every row once. Therefore,
+// only do it when a sort has already done that many comparisons, i.e. a full sort
+// and not the insertion of a single changed row.
+bool DiveTripModelList::useSortKeys(int column) const
+{
+	if (column == sortKeyColumn)
+		return true;
+	if (++uncachedComparisons <= items.size())
+		return false;
+	computeSortKeys(column);
+	return true;
+}
+
 void DiveTripModelList::populate()
 {
+	DiveFilter::instance()->invalidateCache();
 	DiveFilter::instance()->updateAll(); // The data was reset - update filter status. TODO: should this really be done here?
 
 	// Fill model
@@ -1699,7 +1997,7 @@ static int strCmp(const char *s1, const char *s2)
 		return !s2 ? 0 : -1;
 	if (!s2)
 		return 1;
-	return QString::localeAwareCompare(QString(s1), QString(s2)); // TODO: avoid copy
+	return sortCollator().compare(QString(s1), QString(s2)); // TODO: avoid copy
 }
 
 bool DiveTripModelList::lessThan(const QModelIndex &i1, const QModelIndex &i2) const
@@ -1727,14 +2025,25 @@ bool DiveTripModelList::lessThan(const QModelIndex &i1, const QModelIndex &i2) c
 	case TEMPERATURE:
 		return lessThanHelper(d1->watertemp.mkelvin - d2->watertemp.mkelvin, row_diff);
 	case TOTALWEIGHT:
+		if (useSortKeys(TOTALWEIGHT))
+			return lessThanHelper(compareSortKeys(row1, row2), row_diff);
 		return lessThanHelper(total_weight(d1) - total_weight(d2), row_diff);
 	case SUIT:
+		if (useSortKeys(SUIT))
+			return lessThanHelper(compareSortKeys(row1, row2), row_diff);
 		return lessThanHelper(strCmp(d1->suit, d2->suit), row_diff);
 	case CYLINDER:
+		if (useSortKeys(CYLINDER)) {
+			if (sortKeys[row1] != noCylinder && sortKeys[row2] != noCylinder)
+				return lessThanHelper(compareSortKeys(row1, row2), row_diff);
+			return sortKeys[row1] == noCylinder && sortKeys[row2] != noCylinder;
+		}
 		if (d1->cylinders.nr > 0 && d2->cylinders.nr > 0)
 			return lessThanHelper(strCmp(get_cylinder(d1, 0)->type.description, get_cylinder(d2, 0)->type.description), row_diff);
 		return d1->cylinders.nr - d2->cylinders.nr < 0;
 	case GAS:
+		if (useSortKeys(GAS))
+			return lessThanHelper(compareSortKeys(row1, row2), row_diff);
 		return lessThanHelper(nitrox_sort_value(d1) - nitrox_sort_value(d2), row_diff);
 	case SAC:
 		return lessThanHelper(d1->sac - d2->sac, row_diff);
@@ -1743,6 +2052,8 @@ bool DiveTripModelList::lessThan(const QModelIndex &i1, const QModelIndex &i2) c
 	case MAXCNS:
 		return lessThanHelper(d1->maxcns - d2->maxcns, row_diff);
 	case TAGS: {
+		if (useSortKeys(TAGS))
+			return lessThanHelper(compareSortKeys(row1, row2), row_diff);
 		char *s1 = taglist_get_tagstring(d1->tag_list);
 		char *s2 = taglist_get_tagstring(d2->tag_list);
 		int diff = strCmp(s1, s2);
@@ -1751,12 +2062,20 @@ bool DiveTripModelList::lessThan(const QModelIndex &i1, const QModelIndex &i2) c
 		return lessThanHelper(diff, row_diff);
 	}
 	case PHOTOS:
+		if (useSortKeys(PHOTOS))
+			return lessThanHelper(compareSortKeys(row1, row2), row_diff);
 		return lessThanHelper(countPhotos(d1) - countPhotos(d2), row_diff);
 	case COUNTRY:
+		if (useSortKeys(COUNTRY))
+			return lessThanHelper(compareSortKeys(row1, row2), row_diff);
 		return lessThanHelper(strCmp(get_dive_country(d1), get_dive_country(d2)), row_diff);
 	case BUDDIES:
+		if (useSortKeys(BUDDIES))
+			return lessThanHelper(compareSortKeys(row1, row2), row_diff);
 		return lessThanHelper(strCmp(d1->buddy, d2->buddy), row_diff);
 	case LOCATION:
+		if (useSortKeys(LOCATION))
+			return lessThanHelper(compareSortKeys(row1, row2), row_diff);
 		return lessThanHelper(strCmp(get_dive_location(d1), get_dive_location(d2)), row_diff);
 	}
 }
@@ -6,7 +6,10 @@
 #include "core/subsurface-qt/divelistnotifier.h"
 #include <QAbstractItemModel>
 #include <QBrush>
+#include <QCollator>
 #include <QFont>
+#include <QHash>
+#include <optional>
 
 class DiveFilter;
 
@@ -72,6 +75,9 @@ public:
 	// Used for sorting. This is a bit of a layering violation, as sorting should be performed
 	// by the higher-up QSortFilterProxyModel, but it makes things so much easier!
 	virtual bool lessThan(const QModelIndex &i1, const QModelIndex &i2) const = 0;
+#ifdef SUBSURFACE_MOBILE
+	void clearRowStrings();
+#endif
 protected slots:
 	void reset();
 signals:
@@ -88,6 +94,12 @@ protected:
 	dive *oldCurrent;
 	QBrush invalidForeground;
 	QFont invalidFont;
+#ifdef SUBSURFACE_MOBILE
+	mutable QStringList fullCylinderList; // Cache for the cylinder list of the mobile edit page
+	mutable QHash<QPair<const void *, int>, QString> rowStrings; // Cache for the texts of the mobile dive list
+	template <typename F>
+	QString rowString(const void *item, int role, F format) const;
+#endif
 
 	// Access trip and dive data
 	QVariant diveData(const struct dive *d, int column, int role) const;	// Not static because we have to access invalidFont
@@ -133,6 +145,9 @@ private:
 	void divesChangedTrip(dive_trip *trip, const QVector<dive *> &dives);
 	void divesShown(dive_trip *trip, const QVector<dive *> &dives);
 	void divesHidden(dive_trip *trip, const QVector<dive *> &dives);
+	void showDivesAll(const QVector<dive *> &dives);
+	void hideDivesAll(const QVector<dive *> &dives);
+	QHash<const void *, int> topLevelRows() const;
 	void divesTimeChangedTrip(dive_trip *trip, timestamp_t delta, const QVector<dive *> &dives);
 	void divesDeletedInternal(dive_trip *trip, bool deleteTrip, const QVector<dive *> &dives);
 
@@ -209,8 +224,25 @@ private:
 	void removeDives(QVector<dive *> dives);
 	QModelIndex diveToIdx(const dive *d) const;
 	void divesDeletedInternal(const QVector<dive *> &dives);
+	bool useSortKeys(int column) const;
+	void computeSortKeys(int column) const;
+	void computeSortKey(size_t row) const;
+	int compareSortKeys(int row1, int row2) const;
+	void invalidateSortKeys();
+	void sortKeysInserted(const QModelIndex &parent, int first, int last);
+	void sortKeysRemoved(const QModelIndex &parent, int first, int last);
+	void sortKeysChanged(const QModelIndex &topLeft, const QModelIndex &bottomRight);
 
 	std::vector<dive *> items;				// TODO: access core data directly
+
+	// Columns such as strings or totals are expensive to compare. When sorting by one of them,
+	// the values are converted into keys once for all rows. See useSortKeys(). Strings get
+	// collator sort keys, so that the keys of changed and added rows can be computed on their
+	// own and the keys of the other rows stay valid.
+	mutable std::vector<int> sortKeys;
+	mutable std::vector<std::optional<QCollatorSortKey>> stringKeys;
+	mutable int sortKeyColumn = -1;
+	mutable size_t uncachedComparisons = 0;
 };
 
 #endif
@@ -11,7 +11,7 @@ GpsListModel::GpsListModel()
 
 void GpsListModel::update()
 {
-	QVector<gpsTracker> trackers = QVector<gpsTracker>::fromList(GpsLocation::instance()->currentGPSInfo().values());
+	QVector<gpsTracker> trackers = QVector<gpsTracker>::fromStdVector(GpsLocation::instance()->currentGPSInfo());
 	beginResetModel();
 	m_gpsFixes = trackers;
 	endResetModel();
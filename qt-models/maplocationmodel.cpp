@@ -3,6 +3,8 @@
 #include "divelocationmodel.h"
 #include "core/divesite.h"
 #include "core/divefilter.h"
+#include <QSet>
+#include <algorithm>
 #ifndef SUBSURFACE_MOBILE
 #include "qt-models/filtermodels.h"
 #include "desktop-widgets/mapwidget.h"
@@ -49,7 +51,8 @@ QVariant MapLocation::getRole(int role) const
 	}
 }
 
-MapLocationModel::MapLocationModel(QObject *parent) : QAbstractListModel(parent)
+MapLocationModel::MapLocationModel(QObject *parent) : QAbstractListModel(parent),
+	m_editMode(false)
 {
 	connect(&diveListNotifier, &DiveListNotifier::diveSiteChanged, this, &MapLocationModel::diveSiteChanged);
 }
@@ -112,20 +115,92 @@ void MapLocationModel::selectionChanged()
 {
 	if (m_mapLocations.isEmpty())
 		return;
+	// Searching the vector for every location would be quadratic for large selections
+	QSet<const dive_site *> selected;
+	for (const dive_site *ds: m_selectedDs)
+		selected.insert(ds);
 	for(MapLocation *m: m_mapLocations)
-		m->selected = m_selectedDs.contains(m->divesite);
+		m->selected = selected.contains(m->divesite);
 	emit dataChanged(createIndex(0, 0), createIndex(m_mapLocations.size() - 1, 0));
 }
 
-void MapLocationModel::reload(QObject *map)
+// Apply the difference between the current and the new locations as row-level
+// changes. A model reset would make the map recreate all of its markers.
+// Takes ownership of the new locations.
+void MapLocationModel::updateLocations(const QVector<MapLocation *> &locations)
 {
-	beginResetModel();
+	QSet<const dive_site *> sites;
+	for (const MapLocation *location: locations)
+		sites.insert(location->divesite);
 
-	qDeleteAll(m_mapLocations);
-	m_mapLocations.clear();
+	// Remove the locations that are not shown anymore, in blocks of consecutive rows
+	for (int i = m_mapLocations.size() - 1; i >= 0; --i) {
+		if (sites.contains(m_mapLocations[i]->divesite))
+			continue;
+		int last = i;
+		while (i > 0 && !sites.contains(m_mapLocations[i - 1]->divesite))
+			--i;
+		beginRemoveRows(QModelIndex(), i, last);
+		qDeleteAll(m_mapLocations.begin() + i, m_mapLocations.begin() + last + 1);
+		m_mapLocations.remove(i, last - i + 1);
+		endRemoveRows();
+	}
+
+	// Row-level updates are only possible if the remaining locations kept their order.
+	// Otherwise, which happens only when the dive site table was reordered, reset the model.
+	int kept = 0;
+	for (const MapLocation *location: locations) {
+		if (kept < m_mapLocations.size() && m_mapLocations[kept]->divesite == location->divesite)
+			++kept;
+	}
+	if (kept < m_mapLocations.size()) {
+		beginResetModel();
+		qDeleteAll(m_mapLocations);
+		m_mapLocations = locations;
+		endResetModel();
+		m_editMode = inEditMode();
+		return;
+	}
+
+	for (int i = 0; i < locations.size(); ++i) {
+		MapLocation *location = locations[i];
+		if (i < m_mapLocations.size() && m_mapLocations[i]->divesite == location->divesite) {
+			MapLocation *existing = m_mapLocations[i];
+			if (existing->coordinate != location->coordinate || existing->name != location->name ||
+			    existing->selected != location->selected) {
+				*existing = *location;
+				emit dataChanged(createIndex(i, 0), createIndex(i, 0));
+			}
+			delete location;
+			continue;
+		}
+		// Insert all new locations before the next existing one in one block
+		const dive_site *next = i < m_mapLocations.size() ? m_mapLocations[i]->divesite : nullptr;
+		int last = i;
+		while (last + 1 < locations.size() && locations[last + 1]->divesite != next)
+			++last;
+		beginInsertRows(QModelIndex(), i, last);
+		m_mapLocations.insert(i, last - i + 1, nullptr);
+		std::copy(locations.begin() + i, locations.begin() + last + 1, m_mapLocations.begin() + i);
+		endInsertRows();
+		i = last;
+	}
+
+	// The pixmap depends on the edit mode
+	bool editMode = inEditMode();
+	if (editMode != m_editMode && !m_mapLocations.isEmpty())
+		emit dataChanged(createIndex(0, 0), createIndex(m_mapLocations.size() - 1, 0));
+	m_editMode = editMode;
+}
+
+void MapLocationModel::reload(QObject *map)
+{
+	QVector<MapLocation *> locations;
 	m_selectedDs.clear();
 
 	QMap<QString, MapLocation *> locationNameMap;
+	// Set of the sites in m_selectedDs, to avoid searching the vector for every site
+	QSet<const dive_site *> selected;
 
 #ifdef SUBSURFACE_MOBILE
 	bool diveSiteMode = false;
@@ -135,8 +210,11 @@ void MapLocationModel::reload(QObject *map)
 	// of the non-hidden dives. Moreover, the selected dive sites are those
 	// that we filter for.
 	bool diveSiteMode = DiveFilter::instance()->diveSiteMode();
-	if (diveSiteMode)
+	if (diveSiteMode) {
 		m_selectedDs = DiveFilter::instance()->filteredDiveSites();
+		for (const dive_site *ds: m_selectedDs)
+			selected.insert(ds);
+	}
 #endif
 	for (int i = 0; i < dive_site_table.nr; ++i) {
 		struct dive_site *ds = dive_site_table.dive_sites[i];
@@ -149,7 +227,7 @@ void MapLocationModel::reload(QObject *map)
 			// Dive sites that do not have a gps location are not shown in normal mode.
 			// In dive-edit mode, selected sites are placed at the center of the map,
 			// so that the user can drag them somewhere without having to enter coordinates.
-			if (!diveSiteMode || !m_selectedDs.contains(ds) || !map)
+			if (!diveSiteMode || !selected.contains(ds) || !map)
 				continue;
 			dsCoord = map->property("center").value<QGeoCoordinate>();
 		} else {
@@ -157,8 +235,10 @@ void MapLocationModel::reload(QObject *map)
 			qreal longitude = ds->location.lon.udeg * 0.000001;
 			dsCoord = QGeoCoordinate(latitude, longitude);
 		}
-		if (!diveSiteMode && hasSelectedDive(ds) && !m_selectedDs.contains(ds))
+		if (!diveSiteMode && hasSelectedDive(ds) && !selected.contains(ds)) {
 			m_selectedDs.append(ds);
+			selected.insert(ds);
+		}
 		QString name(ds->name);
 		if (!diveSiteMode) {
 			// don't add dive locations with the same name, unless they are
@@ -170,14 +250,13 @@ void MapLocationModel::reload(QObject *map)
 					continue;
 			}
 		}
-		bool selected = m_selectedDs.contains(ds);
-		MapLocation *location = new MapLocation(ds, dsCoord, name, selected);
-		m_mapLocations.append(location);
+		MapLocation *location = new MapLocation(ds, dsCoord, name, selected.contains(ds));
+		locations.append(location);
 		if (!diveSiteMode)
 			locationNameMap[name] = location;
 	}
 
-	endResetModel();
+	updateLocations(locations);
 }
 
 void MapLocationModel::setSelected(struct dive_site *ds)
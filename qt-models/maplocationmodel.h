@@ -58,8 +58,10 @@ private slots:
 	void diveSiteChanged(struct dive_site *ds, int field);
 
 private:
+	void updateLocations(const QVector<MapLocation *> &locations);
 	QVector<MapLocation *> m_mapLocations;
 	QVector<dive_site *> m_selectedDs;
+	bool m_editMode; // edit mode of the last update, which determines the pixmaps
 };
 
 #endif
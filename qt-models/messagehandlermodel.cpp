@@ -1,11 +1,18 @@
 // SPDX-License-Identifier: GPL-2.0
 #include "messagehandlermodel.h"
 #include "core/qthelper.h"
+#include <algorithm>
 
 #if defined(Q_OS_ANDROID) || defined(Q_OS_IOS)
 extern void writeToAppLogFile(QString logText);
 #endif
 
+// A download with verbose logging produces tens of thousands of lines.
+// The log file gets all of them, the model only the newest.
+static const int maxMessages = 5000;
+// Messages arriving within one frame are inserted with a single update of the view.
+static const int insertInterval = 16;
+
 void logMessageHandler(QtMsgType type, const QMessageLogContext&, const QString &msg)
 {
 	MessageHandlerModel::self()->addLog(type, msg);
@@ -17,8 +24,11 @@ MessageHandlerModel * MessageHandlerModel::self()
 	return self;
 }
 
-MessageHandlerModel::MessageHandlerModel(QObject*)
+MessageHandlerModel::MessageHandlerModel(QObject*) : pendingStart(0), pendingCount(0)
 {
+	insertTimer.setSingleShot(true);
+	insertTimer.setInterval(insertInterval);
+	connect(&insertTimer, &QTimer::timeout, this, &MessageHandlerModel::insertPending);
 	// no more than one message handler.
 	qInstallMessageHandler(logMessageHandler);
 }
@@ -28,28 +38,69 @@ int MessageHandlerModel::rowCount(const QModelIndex&) const
 	return m_data.size();
 }
 
-#include <iostream>
-
 void MessageHandlerModel::addLog(QtMsgType type, const QString& message)
 {
-	if (!m_data.isEmpty()) {
-		struct MessageData *lm = &m_data.last();
-		QString lastMessage = lm->message.mid(lm->message.indexOf(':'));
-		QString newMessage = message.mid(message.indexOf(':'));
-		if (lastMessage == newMessage)
+	QString newMessage = message.mid(message.indexOf(':'));
+	bool first;
+	{
+		QMutexLocker l(&pendingLock);
+		if (newMessage == lastMessage)
 			return;
+		lastMessage = newMessage;
+		first = pendingCount == 0;
+		if (pending.isEmpty())
+			pending.resize(maxMessages);
+		// When full, the oldest message is overwritten
+		pending[(pendingStart + pendingCount) % maxMessages] = { message, type };
+		if (pendingCount < maxMessages)
+			++pendingCount;
+		else
+			pendingStart = (pendingStart + 1) % maxMessages;
 	}
-	beginInsertRows(QModelIndex(), rowCount(), rowCount());
-	m_data.append({message, type});
-	endInsertRows();
+	// The timer lives in the UI thread
+	if (first)
+		QMetaObject::invokeMethod(this, "schedulePending", Qt::QueuedConnection);
 	SSRF_INFO("%s", qPrintable(message));
 #if defined(Q_OS_ANDROID) || defined(Q_OS_IOS)
 	writeToAppLogFile(message);
 #endif
 }
 
+void MessageHandlerModel::schedulePending()
+{
+	if (!insertTimer.isActive())
+		insertTimer.start();
+}
+
+void MessageHandlerModel::insertPending()
+{
+	QVector<MessageData> messages;
+	{
+		QMutexLocker l(&pendingLock);
+		messages.reserve(pendingCount);
+		for (int i = 0; i < pendingCount; ++i)
+			messages.append(std::move(pending[(pendingStart + i) % maxMessages]));
+		pendingStart = pendingCount = 0;
+	}
+	if (messages.isEmpty())
+		return;
+
+	int remove = m_data.size() + messages.size() - maxMessages;
+	if (remove > 0) {
+		remove = std::min(remove, m_data.size());
+		beginRemoveRows(QModelIndex(), 0, remove - 1);
+		m_data.remove(0, remove);
+		endRemoveRows();
+	}
+	beginInsertRows(QModelIndex(), m_data.size(), m_data.size() + messages.size() - 1);
+	m_data.append(messages);
+	endInsertRows();
+}
+
 const QString MessageHandlerModel::logAsString()
 {
+	insertPending();
+
 	QString copyString;
 
 	// Loop through m_data and build big string to be put on the clipboard
@@ -77,6 +128,15 @@ QHash<int, QByteArray> MessageHandlerModel::roleNames() const {
 
 void MessageHandlerModel::reset()
 {
+	{
+		QMutexLocker l(&pendingLock);
+		for (int i = 0; i < pendingCount; ++i)
+			pending[(pendingStart + i) % maxMessages] = MessageData();
+		pendingStart = pendingCount = 0;
+		lastMessage.clear();
+	}
+	if (m_data.isEmpty())
+		return;
 	beginRemoveRows(QModelIndex(), 0, m_data.size()-1);
 	m_data.clear();
 	endRemoveRows();
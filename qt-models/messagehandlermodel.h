@@ -3,8 +3,12 @@
 #define MESSAGEHANDLERMODEL_H
 
 #include <QAbstractListModel>
+#include <QMutex>
+#include <QTimer>
+#include <QVector>
 
-
+// Messages can be logged from any thread. They are collected and added to
+// the model in batches in the UI thread. Only the newest messages are kept.
 class MessageHandlerModel : public QAbstractListModel {
 	Q_OBJECT
 public:
@@ -19,13 +23,22 @@ public:
 	/* call this to clear the debug data */
 	Q_INVOKABLE void reset();
 
+private slots:
+	void schedulePending();
+	void insertPending();
 private:
 	MessageHandlerModel(QObject *parent = 0);
 	struct MessageData {
 		QString message;
 		QtMsgType type;
 	};
-	QVector<MessageData> m_data;
+	QVector<MessageData> m_data;		// only accessed in the UI thread
+
+	QMutex pendingLock;			// protects the members below
+	QVector<MessageData> pending;		// ring buffer of the messages not yet in the model
+	int pendingStart, pendingCount;
+	QString lastMessage;			// to skip repeated messages
+	QTimer insertTimer;
 };
 
 #endif
@@ -1,6 +1,7 @@
 // SPDX-License-Identifier: GPL-2.0
 #include "mobilelistmodel.h"
 #include "core/divelist.h" // for shown_dives
+#include <algorithm>
 
 MobileListModelBase::MobileListModelBase(DiveTripModelBase *sourceIn) : source(sourceIn)
 {
@@ -81,8 +82,14 @@ QModelIndex MobileListModelBase::parent(const QModelIndex &index) const
 }
 
 MobileListModel::MobileListModel(DiveTripModelBase *source) : MobileListModelBase(source),
+	preparedRows(0),
 	expandedRow(-1)
 {
+	prepareTimer.setSingleShot(true);
+	prepareTimer.setInterval(0);
+	connect(&prepareTimer, &QTimer::timeout, this, &MobileListModel::prepareNextRows);
+	connect(source, &DiveTripModelBase::modelReset, this, &MobileListModel::prepareRows);
+	connect(&diveListNotifier, &DiveListNotifier::filterReset, this, &MobileListModel::prepareRows);
 	connect(source, &DiveTripModelBase::modelAboutToBeReset, this, &MobileListModel::beginResetModel);
 	connect(source, &DiveTripModelBase::modelReset, this, &MobileListModel::endResetModel);
 	connect(source, &DiveTripModelBase::rowsAboutToBeRemoved, this, &MobileListModel::prepareRemove);
@@ -520,6 +527,31 @@ void MobileListModel::invalidate()
 	dataChanged(fromIdx, toIdx);
 }
 
+// The rows of the first few screens. The texts are prepared in small batches, so
+// that the user interface isn't blocked. The dive data can only be accessed from
+// the main thread, therefore this isn't done by a worker thread.
+static const int rowsToPrepare = 100;
+static const int rowsPerBatch = 10;
+
+void MobileListModel::prepareRows()
+{
+	preparedRows = 0;
+	prepareTimer.start();
+}
+
+void MobileListModel::prepareNextRows()
+{
+	static const int roles[] = { DateTimeRole, LocationRole, DepthDurationRole, TripShortDateRole, TripTitleRole };
+	int last = std::min(std::min(rowCount(QModelIndex()), rowsToPrepare), preparedRows + rowsPerBatch);
+	for (; preparedRows < last; ++preparedRows) {
+		QModelIndex idx = createIndex(preparedRows, 0);
+		for (int role: roles)
+			data(idx, role);
+	}
+	if (preparedRows < std::min(rowCount(QModelIndex()), rowsToPrepare))
+		prepareTimer.start();
+}
+
 void MobileListModel::unexpand()
 {
 	if (expandedRow < 0)
@@ -965,6 +997,8 @@ MobileSwipeModel *MobileModels::swipeModel()
 // This is called when the settings changed. Instead of rebuilding the model, send a changed signal on all entries.
 void MobileModels::invalidate()
 {
+	source.clearRowStrings();
+	lm.invalidate();
 	sm.invalidate();
-	sm.invalidate();
+	lm.prepareRows();
 }
@@ -12,6 +12,7 @@
 #define MOBILELISTMODEL_H
 
 #include "divetripmodel.h"
+#include <QTimer>
 
 // This is the base class of the mobile-list model. All it does
 // is exporting the various dive fields as roles.
@@ -79,11 +80,14 @@ public:
 	void expand(int row);
 	void unexpand();
 	void invalidate();
+	void prepareRows();	// Format the texts of the first rows while the application is idle
 	Q_INVOKABLE void toggle(int row);
 	Q_PROPERTY(int shown READ shown NOTIFY shownChanged);
 signals:
 	void shownChanged();
 private:
+	QTimer prepareTimer;
+	int preparedRows;
 	struct IndexRange {
 		bool visible;
 		int first, last;
@@ -115,6 +119,7 @@ private slots:
 	void prepareMove(const QModelIndex &parent, int first, int last, const QModelIndex &dest, int destRow);
 	void doneMove(const QModelIndex &parent, int first, int last, const QModelIndex &dest, int destRow);
 	void changed(const QModelIndex &topLeft, const QModelIndex &bottomRight, const QVector<int> &roles);
+	void prepareNextRows();
 };
 
 class MobileSwipeModel : public MobileListModelBase {
@@ -30,6 +30,7 @@ bool TankInfoModel::setData(const QModelIndex &index, const QVariant &value, int
 	switch (index.column()) {
 	case DESCRIPTION:
 		info->name = strdup(value.toByteArray().data());
+		invalidate_tank_info_index();
 		break;
 	case ML:
 		info->ml = value.toInt();
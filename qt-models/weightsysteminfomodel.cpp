@@ -26,6 +26,7 @@ bool WSInfoModel::setData(const QModelIndex &index, const QVariant &value, int)
 	switch (index.column()) {
 	case DESCRIPTION:
 		info->name = strdup(value.toByteArray().data());
+		invalidate_ws_info_index();
 		break;
 	case GR:
 		info->grams = value.toInt();
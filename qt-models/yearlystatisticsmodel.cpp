@@ -4,6 +4,7 @@
 #include "core/metrics.h"
 #include "core/statistics.h"
 #include "core/dive.h" // For NUM_DIVEMODE
+#include <vector>
 
 class YearStatisticsItem : public TreeItem {
 	Q_DECLARE_TR_FUNCTIONS(YearStatisticsItem)
@@ -28,15 +29,83 @@ public:
 		COLUMNS
 	};
 
+	// Depth and temperature buckets are labelled by their range
+	enum Label {
+		PERIOD,
+		DEPTH_RANGE,
+		TEMP_RANGE
+	};
+
 	QVariant data(int column, int role) const;
-	YearStatisticsItem(const stats_t &interval);
+	YearStatisticsItem(const stats_t &interval, Label label = PERIOD, int bucket = 0);
+	void addChild(const stats_t &interval, Label label = PERIOD, int bucket = 0);
+	bool hasPendingChildren() const;
+	int pendingChildren() const;
+	void createChildren();
 
 private:
+	QVariant label() const;
+	struct PendingChild {
+		stats_t interval;
+		Label label;
+		int bucket;
+	};
 	stats_t stats_interval;
+	Label labelType;
+	int bucket;
+	std::vector<PendingChild> pending;	// Not yet created child rows
 };
 
-YearStatisticsItem::YearStatisticsItem(const stats_t &interval) : stats_interval(interval)
+YearStatisticsItem::YearStatisticsItem(const stats_t &interval, Label label, int bucket) :
+	stats_interval(interval),
+	labelType(label),
+	bucket(bucket)
+{
+}
+
+void YearStatisticsItem::addChild(const stats_t &interval, Label label, int bucket)
+{
+	pending.push_back({ interval, label, bucket });
+}
+
+bool YearStatisticsItem::hasPendingChildren() const
 {
+	return !pending.empty();
+}
+
+int YearStatisticsItem::pendingChildren() const
+{
+	return (int)pending.size();
+}
+
+void YearStatisticsItem::createChildren()
+{
+	for (const PendingChild &child: pending) {
+		YearStatisticsItem *item = new YearStatisticsItem(child.interval, child.label, child.bucket);
+		children.append(item);
+		item->parent = this;
+	}
+	pending.clear();
+}
+
+QVariant YearStatisticsItem::label() const
+{
+	switch (labelType) {
+	case DEPTH_RANGE:
+		return tr("%1 - %2").arg(get_depth_string((bucket - 1) * (STATS_DEPTH_BUCKET * 1000), true, false),
+					 get_depth_string(bucket * (STATS_DEPTH_BUCKET * 1000), true, false));
+	case TEMP_RANGE: {
+		temperature_t t_range_min, t_range_max;
+		t_range_min.mkelvin = C_to_mkelvin((bucket - 1) * STATS_TEMP_BUCKET);
+		t_range_max.mkelvin = C_to_mkelvin(bucket * STATS_TEMP_BUCKET);
+		return tr("%1 - %2").arg(get_temperature_string(t_range_min, true),
+					 get_temperature_string(t_range_max, true));
+	}
+	default:
+		if (stats_interval.is_trip)
+			return stats_interval.location;
+		return stats_interval.period;
+	}
 }
 
 QVariant YearStatisticsItem::data(int column, int role) const
@@ -52,11 +121,7 @@ QVariant YearStatisticsItem::data(int column, int role) const
 	}
 	switch (column) {
 	case YEAR:
-		if (stats_interval.is_trip) {
-			ret = stats_interval.location;
-		} else {
-			ret = stats_interval.period;
-		}
+		ret = label();
 		break;
 	case DIVES:
 		ret = stats_interval.selection_size;
@@ -181,13 +246,39 @@ QVariant YearlyStatisticsModel::headerData(int section, Qt::Orientation orientat
 	return val;
 }
 
+static YearStatisticsItem *itemForIndex(const QModelIndex &index)
+{
+	return static_cast<YearStatisticsItem *>(index.internalPointer());
+}
+
+bool YearlyStatisticsModel::hasChildren(const QModelIndex &parent) const
+{
+	if (!parent.isValid())
+		return TreeModel::hasChildren(parent);
+	return itemForIndex(parent)->hasPendingChildren() || TreeModel::hasChildren(parent);
+}
+
+bool YearlyStatisticsModel::canFetchMore(const QModelIndex &parent) const
+{
+	return parent.isValid() && itemForIndex(parent)->hasPendingChildren();
+}
+
+void YearlyStatisticsModel::fetchMore(const QModelIndex &parent)
+{
+	if (!canFetchMore(parent))
+		return;
+	YearStatisticsItem *item = itemForIndex(parent);
+	int count = item->children.count();
+	beginInsertRows(parent, count, count + item->pendingChildren() - 1);
+	item->createChildren();
+	endInsertRows();
+}
+
 void YearlyStatisticsModel::update_yearly_stats()
 {
 	int i, month = 0;
 	unsigned int j, combined_months;
 	stats_summary_auto_free stats;
-	QString label;
-	temperature_t t_range_min,t_range_max;
 	calculate_stats_summary(&stats, false);
 
 	for (i = 0; stats.stats_yearly != NULL && stats.stats_yearly[i].period; ++i) {
@@ -195,9 +286,7 @@ void YearlyStatisticsModel::update_yearly_stats()
 		combined_months = 0;
 		for (j = 0; combined_months < stats.stats_yearly[i].selection_size; ++j) {
 			combined_months += stats.stats_monthly[month].selection_size;
-			YearStatisticsItem *iChild = new YearStatisticsItem(stats.stats_monthly[month]);
-			item->children.append(iChild);
-			iChild->parent = item;
+			item->addChild(stats.stats_monthly[month]);
 			month++;
 		}
 		rootItem->children.append(item);
@@ -206,11 +295,8 @@ void YearlyStatisticsModel::update_yearly_stats()
 
 	if (stats.stats_by_trip != NULL && stats.stats_by_trip[0].is_trip == true) {
 		YearStatisticsItem *item = new YearStatisticsItem(stats.stats_by_trip[0]);
-		for (i = 1; stats.stats_by_trip != NULL && stats.stats_by_trip[i].is_trip; ++i) {
-			YearStatisticsItem *iChild = new YearStatisticsItem(stats.stats_by_trip[i]);
-			item->children.append(iChild);
-			iChild->parent = item;
-		}
+		for (i = 1; stats.stats_by_trip != NULL && stats.stats_by_trip[i].is_trip; ++i)
+			item->addChild(stats.stats_by_trip[i]);
 		rootItem->children.append(item);
 		item->parent = rootItem.get();
 	}
@@ -221,9 +307,7 @@ void YearlyStatisticsModel::update_yearly_stats()
 		for (i = 1; i <= NUM_DIVEMODE; ++i) {
 			if (stats.stats_by_type[i].selection_size == 0)
 				continue;
-			YearStatisticsItem *iChild = new YearStatisticsItem(stats.stats_by_type[i]);
-			item->children.append(iChild);
-			iChild->parent = item;
+			item->addChild(stats.stats_by_type[i]);
 		}
 		rootItem->children.append(item);
 		item->parent = rootItem.get();
@@ -233,14 +317,8 @@ void YearlyStatisticsModel::update_yearly_stats()
 	if (stats.stats_by_depth != NULL && stats.stats_by_depth[0].selection_size) {
 		YearStatisticsItem *item = new YearStatisticsItem(stats.stats_by_depth[0]);
 		for (i = 1; stats.stats_by_depth[i].is_trip; ++i)
-			if (stats.stats_by_depth[i].selection_size) {
-				label = QString(tr("%1 - %2")).arg(get_depth_string((i - 1) * (STATS_DEPTH_BUCKET * 1000), true, false),
-					get_depth_string(i * (STATS_DEPTH_BUCKET * 1000), true, false));
-				stats.stats_by_depth[i].location = strdup(label.toUtf8().data());
-				YearStatisticsItem *iChild = new YearStatisticsItem(stats.stats_by_depth[i]);
-				item->children.append(iChild);
-				iChild->parent = item;
-			}
+			if (stats.stats_by_depth[i].selection_size)
+				item->addChild(stats.stats_by_depth[i], YearStatisticsItem::DEPTH_RANGE, i);
 		rootItem->children.append(item);
 		item->parent = rootItem.get();
 	}
@@ -249,16 +327,8 @@ void YearlyStatisticsModel::update_yearly_stats()
 	if (stats.stats_by_temp != NULL && stats.stats_by_temp[0].selection_size) {
 		YearStatisticsItem *item = new YearStatisticsItem(stats.stats_by_temp[0]);
 		for (i = 1; stats.stats_by_temp[i].is_trip; ++i)
-			if (stats.stats_by_temp[i].selection_size) {
-				t_range_min.mkelvin = C_to_mkelvin((i - 1) * STATS_TEMP_BUCKET);
-				t_range_max.mkelvin = C_to_mkelvin(i * STATS_TEMP_BUCKET);
-				label = QString(tr("%1 - %2")).arg(get_temperature_string(t_range_min, true),
-					get_temperature_string(t_range_max, true));
-				stats.stats_by_temp[i].location = strdup(label.toUtf8().data());
-				YearStatisticsItem *iChild = new YearStatisticsItem(stats.stats_by_temp[i]);
-				item->children.append(iChild);
-				iChild->parent = item;
-			}
+			if (stats.stats_by_temp[i].selection_size)
+				item->addChild(stats.stats_by_temp[i], YearStatisticsItem::TEMP_RANGE, i);
 		rootItem->children.append(item);
 		item->parent = rootItem.get();
 	}
@@ -0,0 +1,41 @@
+#!/usr/bin/perl
+# SPDX-License-Identifier: GPL-2.0
+#
+# Compare two runs of a QtTest benchmark, e.g. TestPerformance, written with "-o file.csv,csv":
+#	compare-benchmarks.pl old.csv new.csv
+# prints the result of every benchmark in both runs and the relative change.
+
+use strict;
+use warnings;
+
+die "usage: $0 old.csv new.csv\n" unless @ARGV == 2;
+
+sub read_results {
+	my ($file) = @_;
+	my (%results, @order);
+	open(my $fh, '<', $file) or die "can't open $file: $!\n";
+	while (my $line = <$fh>) {
+		# "function","tag","metric",value,total,iterations
+		next unless $line =~ /^"([^"]*)","([^"]*)","([^"]*)",([-0-9.e+]+)/;
+		my $key = $2 eq "" ? $1 : "$1:$2";
+		push @order, $key unless exists $results{$key};
+		$results{$key} = { metric => $3, value => $4 };
+	}
+	close($fh);
+	return (\%results, \@order);
+}
+
+my ($old, $old_order) = read_results($ARGV[0]);
+my ($new, $new_order) = read_results($ARGV[1]);
+
+printf("%-40s %15s %15s %9s\n", "benchmark", "old", "new", "change");
+foreach my $key (@$new_order, grep { !exists $new->{$_} } @$old_order) {
+	my $o = $old->{$key};
+	my $n = $new->{$key};
+	if (!$o || !$n) {
+		printf("%-40s %15s %15s\n", $key, $o ? $o->{value} : "-", $n ? $n->{value} : "-");
+		next;
+	}
+	my $change = $o->{value} ? sprintf("%+.1f%%", 100.0 * ($n->{value} - $o->{value}) / $o->{value}) : "-";
+	printf("%-40s %15.3f %15.3f %9s %s\n", $key, $o->{value}, $n->{value}, $change, $n->{metric});
+}
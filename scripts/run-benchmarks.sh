@@ -0,0 +1,74 @@
+#!/bin/bash
+# SPDX-License-Identifier: GPL-2.0
+#
+# Run the benchmarks on synthetic dive logs of several sizes and keep the results
+# of every commit, so that performance work has a baseline that doesn't depend on
+# downloaded sample data or a CI machine:
+#	run-benchmarks.sh [-b builddir] [-r resultsdir] [dives...]
+# builds TestPerformance and TestParsePerformance in builddir (default: build), runs
+# them with logs of the given numbers of dives (default: 1000 10000 100000) and writes
+# the results to resultsdir/<commit>/<test>-<dives>.csv (default: ~/.subsurface-benchmarks).
+# The results are compared with those of the closest earlier commit that has any.
+# Uncommitted changes are recorded as <commit>-dirty.
+#
+# The large log is generated with 20 s samples, which keeps it at about 1 GB of memory.
+# Other options of the logs can be set by the environment, see tests/syntheticlog.h.
+
+set -e
+
+SRC=$(cd "$(dirname "$0")/.." && pwd)
+BUILD="$SRC/build"
+RESULTS="$HOME/.subsurface-benchmarks"
+
+while getopts "b:r:" opt; do
+	case $opt in
+	b) BUILD=$(cd "$OPTARG" && pwd) ;;
+	r) RESULTS="$OPTARG" ;;
+	*) echo "usage: $0 [-b builddir] [-r resultsdir] [dives...]" >&2; exit 1 ;;
+	esac
+done
+shift $((OPTIND - 1))
+SIZES=${*:-"1000 10000 100000"}
+
+cd "$SRC"
+COMMIT=$(git rev-parse --short HEAD)
+if ! git diff --quiet HEAD -- ; then
+	COMMIT="$COMMIT-dirty"
+fi
+OUT="$RESULTS/$COMMIT"
+mkdir -p "$OUT"
+
+cmake --build "$BUILD" --target TestPerformance TestParsePerformance -- -j"$(nproc 2>/dev/null || echo 4)"
+
+for dives in $SIZES; do
+	interval=${SUBSURFACE_BENCHMARK_INTERVAL:-10}
+	if [ "$dives" -ge 100000 ] && [ -z "$SUBSURFACE_BENCHMARK_INTERVAL" ]; then
+		interval=20
+	fi
+	# parseGit clones the large sample data from the network, it isn't run
+	for run in "TestPerformance" "TestParsePerformance parseSsrf parseSyntheticGit"; do
+		set -- $run
+		test=$1
+		shift
+		echo "$test with $dives dives"
+		# TestPerformance writes the stops of its plans to the working directory
+		(cd "$BUILD/tests" && \
+		 SUBSURFACE_BENCHMARK_DIVES=$dives SUBSURFACE_BENCHMARK_INTERVAL=$interval \
+		 "./$test" -o "$OUT/$test-$dives.csv,csv" -o -,txt "$@") || echo "$test failed" >&2
+	done
+done
+
+# The closest ancestor with results
+for old in $(git rev-list --abbrev-commit --max-count=100 HEAD); do
+	old="$RESULTS/$old"
+	[ "$old" = "$OUT" ] && continue
+	[ -d "$old" ] || continue
+	for file in "$OUT"/*.csv; do
+		name=$(basename "$file")
+		if [ -f "$old/$name" ]; then
+			echo "== $name: $(basename "$old") -> $COMMIT"
+			perl "$SRC/scripts/compare-benchmarks.pl" "$old/$name" "$file"
+		fi
+	done
+	break
+done
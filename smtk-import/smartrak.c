@@ -622,33 +622,114 @@ static void smtk_build_list(MdbHandle *mdb,  char *table_name, char *array[])
 }
 
 /*
- * Parses a relation table and returns a list with the relations for a dive idx.
- * Use types_list items with text set to NULL.
- * Returns a pointer to the list head.
- * Table relation format:
- * | Diveidx | Idx |
+ * The relation tables and the Marker table hold rows for every dive of the log.
+ * Instead of scanning them once per dive, they are read once into a cache whose
+ * rows are sorted by their first column, the dive idx. Rows with the same dive
+ * idx keep the order they have in the table.
  */
-static struct types_list *smtk_index_list(MdbHandle *mdb, char *table_name, char *dive_idx)
+#define SMTK_CACHE_COLS 5
+
+struct smtk_cached_row {
+	int row;
+	char *values[SMTK_CACHE_COLS];
+};
+
+struct smtk_table_cache {
+	bool found;
+	int nr;
+	struct smtk_cached_row *rows;
+};
+
+static int smtk_comp_cached_row(const void *_a, const void *_b)
+{
+	const struct smtk_cached_row *a = _a, *b = _b;
+	int res = strcmp(a->values[0], b->values[0]);
+	if (res)
+		return res;
+	return a->row - b->row;
+}
+
+static void smtk_cache_table(MdbHandle *mdb, char *table_name, struct smtk_table_cache *cache)
 {
 	MdbTableDef *table;
 	char *bounders[MDB_MAX_COLS];
-	struct types_list *item, *head = NULL;
+	int i, cols, allocated = 0;
 
+	memset(cache, 0, sizeof(*cache));
 	table = smtk_open_table(mdb, table_name, bounders, NULL);
-
-	/* Sanity check */
 	if (!table)
-		return NULL;
+		return;
+	cache->found = true;
+	cols = MIN(table->num_cols, SMTK_CACHE_COLS);
 
-	/* Parse the table searching for dive_idx */
 	while (mdb_fetch_row(table)) {
-		if (!strcmp(dive_idx, bounders[0]))
-			smtk_head_insert(&head, atoi(bounders[1]), NULL);
+		struct smtk_cached_row *row;
+		if (cache->nr >= allocated) {
+			allocated = (allocated + 32) * 3 / 2;
+			cache->rows = realloc(cache->rows, allocated * sizeof(*cache->rows));
+		}
+		row = &cache->rows[cache->nr];
+		memset(row, 0, sizeof(*row));
+		row->row = cache->nr++;
+		for (i = 0; i < cols; i++)
+			row->values[i] = strdup(bounders[i]);
 	}
+	if (cols > 0)
+		qsort(cache->rows, cache->nr, sizeof(*cache->rows), smtk_comp_cached_row);
 
-	/* Clean up and exit */
 	smtk_free(bounders, table->num_cols);
 	mdb_free_tabledef(table);
+}
+
+static void smtk_free_table_cache(struct smtk_table_cache *cache)
+{
+	int i;
+	for (i = 0; i < cache->nr; i++)
+		smtk_free(cache->rows[i].values, SMTK_CACHE_COLS);
+	free(cache->rows);
+	memset(cache, 0, sizeof(*cache));
+}
+
+/*
+ * Returns the first cached row for a dive idx and stores the number of
+ * rows for this dive in count. Returns NULL if there are none.
+ */
+static const struct smtk_cached_row *smtk_cached_rows(const struct smtk_table_cache *cache, const char *dive_idx, int *count)
+{
+	int lo = 0, hi = cache->nr, end;
+
+	*count = 0;
+	if (!cache->nr || !cache->rows[0].values[0])
+		return NULL;
+	while (lo < hi) {
+		int mid = lo + (hi - lo) / 2;
+		if (strcmp(cache->rows[mid].values[0], dive_idx) < 0)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	for (end = lo; end < cache->nr && !strcmp(cache->rows[end].values[0], dive_idx); end++)
+		;
+	*count = end - lo;
+	return *count ? &cache->rows[lo] : NULL;
+}
+
+/*
+ * Returns a list with the relations for a dive idx from a cached relation table.
+ * Use types_list items with text set to NULL.
+ * Returns a pointer to the list head.
+ * Table relation format:
+ * | Diveidx | Idx |
+ */
+static struct types_list *smtk_index_list(const struct smtk_table_cache *rel_table, char *dive_idx)
+{
+	const struct smtk_cached_row *rows;
+	struct types_list *head = NULL;
+	int i, count;
+
+	rows = smtk_cached_rows(rel_table, dive_idx, &count);
+	for (i = 0; i < count; i++)
+		smtk_head_insert(&head, rows[i].values[1] ? atoi(rows[i].values[1]) : 0, NULL);
 	return head;
 }
 
@@ -692,12 +773,12 @@ static void smtk_build_buddies(MdbHandle *mdb, char *array[])
 /*
  * Returns string with buddies names as registered in smartrak (may be a nickname).
  */
-static char *smtk_locate_buddy(MdbHandle *mdb, char *dive_idx, char *buddies_list[])
+static char *smtk_locate_buddy(const struct smtk_table_cache *rel_table, char *dive_idx, char *buddies_list[])
 {
 	char *str = NULL;
 	struct types_list *rel, *rel_head;
 
-	rel_head = smtk_index_list(mdb, "BuddyRelation", dive_idx);
+	rel_head = smtk_index_list(rel_table, dive_idx);
 	if (!rel_head)
 		return str;
 
@@ -715,12 +796,12 @@ static char *smtk_locate_buddy(MdbHandle *mdb, char *dive_idx, char *buddies_lis
  * The "tag" parameter is used to mark if we want this table to be imported
  * into tags or into notes.
  */
-static void smtk_parse_relations(MdbHandle *mdb, struct dive *dive, char *dive_idx, char *table_name, char *rel_table_name, char *list[], bool tag)
+static void smtk_parse_relations(const struct smtk_table_cache *rel_table, struct dive *dive, char *dive_idx, char *table_name, char *list[], bool tag)
 {
 	char *tmp = NULL;
 	struct types_list *diverel_head, *d_runner;
 
-	diverel_head = smtk_index_list(mdb, rel_table_name, dive_idx);
+	diverel_head = smtk_index_list(rel_table, dive_idx);
 	if (!diverel_head)
 		return;
 
@@ -787,34 +868,30 @@ static struct event *find_bookmark(struct event *orig, unsigned int t)
  * XConnect irelevant
  * YConnect irelevant
  */
-static void smtk_parse_bookmarks(MdbHandle *mdb, struct dive *d, char *dive_idx)
+static void smtk_parse_bookmarks(const struct smtk_table_cache *markers, struct dive *d, char *dive_idx)
 {
-	MdbTableDef *table;
-	char *bound_values[MDB_MAX_COLS], *tmp = NULL;
+	const struct smtk_cached_row *rows;
+	const char *name;
 	unsigned int time;
 	struct event *ev;
+	int i, count;
 
-	table = smtk_open_table(mdb, "Marker", bound_values, NULL);
-	if (!table) {
+	if (!markers->found) {
 		report_error("[smtk-import] Error - Couldn't open table 'Marker', dive %d", d->number);
 		return;
 	}
-	while (mdb_fetch_row(table)) {
-		if (same_string(bound_values[0], dive_idx)) {
-			time = lrint(strtod(bound_values[4], NULL) * 60);
-			tmp = strdup(bound_values[2]);
-			ev = find_bookmark(d->dc.events, time);
-			if (ev)
-				update_event_name(d, ev, tmp);
-			else
-				if (!add_event(&d->dc, time, SAMPLE_EVENT_BOOKMARK, 0, 0, tmp))
-					report_error("[smtk-import] Error - Couldn't add bookmark, dive %d, Name = %s",
-						     d->number, tmp);
-		}
+	rows = smtk_cached_rows(markers, dive_idx, &count);
+	for (i = 0; i < count; i++) {
+		time = lrint(strtod(rows[i].values[4], NULL) * 60);
+		name = rows[i].values[2];
+		ev = find_bookmark(d->dc.events, time);
+		if (ev)
+			update_event_name(d, ev, name);
+		else
+			if (!add_event(&d->dc, time, SAMPLE_EVENT_BOOKMARK, 0, 0, name))
+				report_error("[smtk-import] Error - Couldn't add bookmark, dive %d, Name = %s",
+					     d->number, name);
 	}
-	free(tmp);
-	smtk_free(bound_values, table->num_cols);
-	mdb_free_tabledef(table);
 }
 
 
@@ -919,6 +996,7 @@ void smartrak_import(const char *file, struct dive_table *divetable)
 	MdbColumn *col[MDB_MAX_COLS];
 	char *bound_values[MDB_MAX_COLS];
 	int i, dc_model, *bound_lens[MDB_MAX_COLS];
+	struct smtk_table_cache buddy_rel, type_rel, activity_rel, gear_rel, fish_rel, markers;
 
 	// Set an european style locale to work date/time conversion
 	setlocale(LC_TIME, "POSIX");
@@ -962,6 +1040,14 @@ void smartrak_import(const char *file, struct dive_table *divetable)
 	smtk_build_list(mdb_clon, "Surface", surface_list);
 	smtk_build_buddies(mdb_clon, buddy_list);
 
+	/* Load the tables with rows for every dive */
+	smtk_cache_table(mdb_clon, "BuddyRelation", &buddy_rel);
+	smtk_cache_table(mdb_clon, "TypeRelation", &type_rel);
+	smtk_cache_table(mdb_clon, "ActivityRelation", &activity_rel);
+	smtk_cache_table(mdb_clon, "GearRelation", &gear_rel);
+	smtk_cache_table(mdb_clon, "FishRelation", &fish_rel);
+	smtk_cache_table(mdb_clon, "Marker", &markers);
+
 	/* Check Smarttrak version (different number of supported tanks, mixes and so) */
 	smtk_version = atoi(smtk_ver[0]);
 	tanks = (smtk_version < 10213) ? 3 : 10;
@@ -1084,21 +1170,27 @@ void smartrak_import(const char *file, struct dive_table *divetable)
 		add_cloned_weightsystem(&smtkdive->weightsystems, ws);
 		smtkdive->suit = copy_string(suit_list[atoi(col[coln(SUITIDX)]->bind_ptr) - 1]);
 		smtk_build_location(mdb_clon, col[coln(SITEIDX)]->bind_ptr, &smtkdive->dive_site);
-		smtkdive->buddy = smtk_locate_buddy(mdb_clon, col[0]->bind_ptr, buddy_list);
-		smtk_parse_relations(mdb_clon, smtkdive, col[0]->bind_ptr, "Type", "TypeRelation", type_list, true);
-		smtk_parse_relations(mdb_clon, smtkdive, col[0]->bind_ptr, "Activity", "ActivityRelation", activity_list, false);
-		smtk_parse_relations(mdb_clon, smtkdive, col[0]->bind_ptr, "Gear", "GearRelation", gear_list, false);
-		smtk_parse_relations(mdb_clon, smtkdive, col[0]->bind_ptr, "Fish", "FishRelation", fish_list, false);
+		smtkdive->buddy = smtk_locate_buddy(&buddy_rel, col[0]->bind_ptr, buddy_list);
+		smtk_parse_relations(&type_rel, smtkdive, col[0]->bind_ptr, "Type", type_list, true);
+		smtk_parse_relations(&activity_rel, smtkdive, col[0]->bind_ptr, "Activity", activity_list, false);
+		smtk_parse_relations(&gear_rel, smtkdive, col[0]->bind_ptr, "Gear", gear_list, false);
+		smtk_parse_relations(&fish_rel, smtkdive, col[0]->bind_ptr, "Fish", fish_list, false);
 		smtk_parse_other(smtkdive, weather_list, "Weather", col[coln(WEATHERIDX)]->bind_ptr, false);
 		smtk_parse_other(smtkdive, underwater_list, "Underwater", col[coln(UNDERWATERIDX)]->bind_ptr, false);
 		smtk_parse_other(smtkdive, surface_list, "Surface", col[coln(SURFACEIDX)]->bind_ptr, false);
-		smtk_parse_bookmarks(mdb_clon, smtkdive, col[0]->bind_ptr);
+		smtk_parse_bookmarks(&markers, smtkdive, col[0]->bind_ptr);
 		smtkdive->notes = smtk_concat_str(smtkdive->notes, "\n", "%s", col[coln(REMARKS)]->bind_ptr);
 
 		record_dive_to_table(smtkdive, divetable);
 		free(devdata);
 	}
 	mdb_free_tabledef(mdb_table);
+	smtk_free_table_cache(&buddy_rel);
+	smtk_free_table_cache(&type_rel);
+	smtk_free_table_cache(&activity_rel);
+	smtk_free_table_cache(&gear_rel);
+	smtk_free_table_cache(&fish_rel);
+	smtk_free_table_cache(&markers);
 	mdb_free_catalog(mdb_clon);
 	mdb->catalog = NULL;
 	mdb_close(mdb_clon);
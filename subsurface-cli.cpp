@@ -0,0 +1,295 @@
+// SPDX-License-Identifier: GPL-2.0
+// Headless batch tool: import dive logs of any supported format, merge them and
+// save or export the result, without creating any widgets or QML engine.
+// Translations are not loaded, messages are printed in English.
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QTextCodec>
+#include <QThreadPool>
+#include <vector>
+#include <stdio.h>
+
+#include "core/device.h"
+#include "core/dive.h"
+#include "core/divelist.h"
+#include "core/divelogexportlogic.h"
+#include "core/divesite.h"
+#include "core/downloadfromdcthread.h"
+#include "core/errorhelper.h"
+#include "core/file.h"
+#include "core/filterpreset.h"
+#include "core/git-access.h"
+#include "core/parallel.h"
+#include "core/qthelper.h"
+#include "core/rawdivecache.h"
+#include "core/save-profiledata.h"
+#include "core/selection.h"
+#include "core/subsurfacestartup.h"
+#include "core/trip.h"
+
+// The dives of one input file, parsed into tables of their own
+struct InputLog {
+	QByteArray filename;
+	struct dive_table dives = empty_dive_table;
+	struct trip_table trips = empty_trip_table;
+	struct dive_site_table sites = empty_dive_site_table;
+	struct device_table devices;
+	struct filter_preset_table filter_presets;
+	int ret = 0;
+};
+
+static void printError(char *msg)
+{
+	fprintf(stderr, "%s\n", msg);
+	free(msg);
+}
+
+static bool isGitUrl(const QByteArray &filename)
+{
+	return filename.endsWith(']');
+}
+
+static void parseInput(InputLog &log)
+{
+	log.ret = parse_file(log.filename.constData(), &log.dives, &log.trips, &log.sites,
+			     &log.devices, &log.filter_presets);
+	if (log.ret)
+		fprintf(stderr, "Failed to read %s\n", log.filename.constData());
+}
+
+// The parsers keep their state in a parser object of their own, so that files can
+// be read in parallel. A git repository is already read by multiple threads and
+// sets the global git id, therefore those are read one after the other.
+static bool readInputs(const QStringList &files)
+{
+	std::vector<InputLog> logs(files.size());
+	std::vector<InputLog *> fileLogs;
+	for (int i = 0; i < files.size(); ++i) {
+		logs[i].filename = QFile::encodeName(files[i]);
+		if (isGitUrl(logs[i].filename))
+			parseInput(logs[i]);
+		else
+			fileLogs.push_back(&logs[i]);
+	}
+	parallel_for((int)fileLogs.size(), [&fileLogs](int i) { parseInput(*fileLogs[i]); });
+
+	// Merging changes the global tables and is done in the order of the command line
+	bool ok = true;
+	for (InputLog &log: logs) {
+		if (log.ret)
+			ok = false;
+		add_imported_dives(&log.dives, &log.trips, &log.sites, &log.devices, IMPORT_MERGE_ALL_TRIPS);
+	}
+	return ok;
+}
+
+// Each argument is "vendor,product,device"
+static bool downloadDiveComputers(const QStringList &args, bool force)
+{
+	std::vector<DeviceDownload> downloads;
+	for (const QString &arg: args) {
+		QStringList parts = arg.split(',');
+		if (parts.size() != 3) {
+			fprintf(stderr, "Invalid dive computer %s, expected vendor,product,device\n", qPrintable(arg));
+			return false;
+		}
+		DeviceDownload download;
+		download.vendor = parts[0];
+		download.product = parts[1];
+		download.devName = parts[2];
+		download.forceDownload = force;
+		downloads.push_back(download);
+	}
+	fill_computer_list();
+	download_in_parallel(downloads, [&downloads](int idx, double fraction, const QString &text) {
+		const DeviceDownload &download = downloads[idx];
+		if (fraction >= 0.0)
+			fprintf(stderr, "%s %s: %d%%\n", qPrintable(download.vendor), qPrintable(download.product), (int)(fraction * 100.0));
+		else if (!text.isEmpty())
+			fprintf(stderr, "%s %s: %s\n", qPrintable(download.vendor), qPrintable(download.product), qPrintable(text));
+	});
+
+	bool ok = true;
+	for (const DeviceDownload &download: downloads) {
+		if (!download.error.isEmpty()) {
+			fprintf(stderr, "%s %s: %s\n", qPrintable(download.vendor), qPrintable(download.product), qPrintable(download.error));
+			ok = false;
+		}
+	}
+	struct dive_table dives = empty_dive_table;
+	struct trip_table trips = empty_trip_table;
+	struct dive_site_table sites = empty_dive_site_table;
+	struct device_table devices;
+	merge_downloads(downloads, &dives, &sites, &devices);
+	add_imported_dives(&dives, &trips, &sites, &devices, IMPORT_IS_DOWNLOADED);
+	return ok;
+}
+
+// Parse the cached raw dive data again and replace the dives parsed by older versions
+static bool reparseCachedDives()
+{
+	struct dive_table dives = empty_dive_table;
+	struct trip_table trips = empty_trip_table;
+	struct dive_site_table sites = empty_dive_site_table;
+	struct device_table devices;
+	int failed = raw_dive_cache_reparse(&dives, &sites);
+	if (failed)
+		fprintf(stderr, "%d cached dives could not be parsed\n", failed);
+	add_imported_dives(&dives, &trips, &sites, &devices, IMPORT_IS_DOWNLOADED | IMPORT_PREFER_IMPORTED);
+	return failed == 0;
+}
+
+static int saveLog(const QString &output)
+{
+	QByteArray filename = QFile::encodeName(output);
+	// Create a local repository on first use, e.g. "/path/to/repo[branch]"
+	if (isGitUrl(filename)) {
+		QString dir = output.left(output.lastIndexOf('['));
+		if (!QDir(dir).exists() && git_create_local_repo(filename.constData()))
+			return -1;
+	}
+	return save_dives(filename.constData());
+}
+
+// The dive times are local times, therefore the date is read as UTC
+static bool parseDate(const QString &s, timestamp_t &res)
+{
+	QDateTime dt = QDateTime::fromString(s, Qt::ISODate);
+	if (!dt.isValid()) {
+		fprintf(stderr, "Invalid date %s, expected e.g. 2020-05-01 or 2020-05-01T10:00\n", qPrintable(s));
+		return false;
+	}
+	res = dateTimeToTimestamp(QDateTime(dt.date(), dt.time(), Qt::UTC));
+	return true;
+}
+
+// Select the dives that start in [since, before), the exports only write those
+static void selectTimeRange(timestamp_t since, timestamp_t before)
+{
+	int i;
+	struct dive *d;
+	struct dive_range range = dives_in_time_range(since, before);
+
+	clear_selection();
+	for_each_dive_in_range(i, d, range)
+		select_dive(d);
+	if (verbose)
+		fprintf(stderr, "Exporting %d dives\n", range.last - range.first);
+}
+
+static int exportProfileData(const QString &output, bool selectedOnly)
+{
+	QByteArray filename = QFile::encodeName(output);
+	if (output.endsWith(".sspd", Qt::CaseInsensitive))
+		return save_profiledata_columns(filename.constData(), selectedOnly);
+	return save_profiledata(filename.constData(), selectedOnly);
+}
+
+static void exportHtml(const QString &output, bool selectedOnly)
+{
+	struct htmlExportSetting hes;
+	hes.themeFile = "sand.css";
+	hes.exportPhotos = true;
+	hes.selectedOnly = selectedOnly;
+	hes.listOnly = false;
+	hes.maxSamples = 0;
+	hes.yearlyStatistics = true;
+	hes.subsurfaceNumbers = true;
+	exportHtmlInitLogic(output, hes);
+}
+
+int main(int argc, char **argv)
+{
+	QCoreApplication application(argc, argv);
+	QCoreApplication::setApplicationName("subsurface-cli");
+	QTextCodec::setCodecForLocale(QTextCodec::codecForMib(106));
+	Q_INIT_RESOURCE(subsurface);
+	git_libgit2_init();
+	copy_prefs(&default_prefs, &prefs);
+	set_error_cb(&printError);
+
+	QCommandLineParser parser;
+	parser.setApplicationDescription("Import, merge and convert dive logs without starting the user interface.");
+	parser.addHelpOption();
+	parser.addPositionalArgument("input", "Dive logs or git repositories (<directory>[<branch>]) to import", "input...");
+	QCommandLineOption outputOption(QStringList() << "o" << "output",
+					"Save the merged dives to <file> (XML), <directory>[<branch>] (git) or - (standard output)",
+					"file");
+	parser.addOption(outputOption);
+	QCommandLineOption csvOption("csv", "Export the dive details as CSV to <file> or - (standard output)", "file");
+	parser.addOption(csvOption);
+	QCommandLineOption profileDataOption("profile-data",
+					     "Export the profile data to <file>: CSV, binary columns for *.sspd, - for standard output",
+					     "file");
+	parser.addOption(profileDataOption);
+	QCommandLineOption htmlOption("html", "Export HTML files into <directory>", "directory");
+	parser.addOption(htmlOption);
+	QCommandLineOption imperialOption("imperial", "Use imperial units for CSV and HTML exports");
+	parser.addOption(imperialOption);
+	QCommandLineOption sinceOption("since", "Only export the dives starting at or after <date>, e.g. 2020-05-01 or 2020-05-01T10:00", "date");
+	parser.addOption(sinceOption);
+	QCommandLineOption beforeOption("before", "Only export the dives starting before <date>", "date");
+	parser.addOption(beforeOption);
+	QCommandLineOption jobsOption(QStringList() << "j" << "jobs", "Read at most <n> files in parallel", "n");
+	parser.addOption(jobsOption);
+	QCommandLineOption downloadOption("download",
+					  "Download the dives of the dive computer <vendor,product,device>, can be given several times to download from all at the same time",
+					  "dc");
+	parser.addOption(downloadOption);
+	QCommandLineOption forceOption("force", "Download all dives, not only the new ones");
+	parser.addOption(forceOption);
+	QCommandLineOption reparseOption("reparse-cache",
+					 "Parse the dives kept from earlier downloads again, replacing the data of the same dives in the input");
+	parser.addOption(reparseOption);
+	QCommandLineOption verboseOption(QStringList() << "v" << "verbose", "Verbose debug output");
+	parser.addOption(verboseOption);
+	parser.process(application);
+
+	QStringList inputs = parser.positionalArguments();
+	if (inputs.isEmpty() && !parser.isSet(downloadOption) && !parser.isSet(reparseOption)) {
+		fprintf(stderr, "No input given\n");
+		parser.showHelp(1);
+	}
+	if (parser.isSet(verboseOption))
+		verbose = 1;
+	if (parser.isSet(jobsOption) && parser.value(jobsOption).toInt() > 0)
+		QThreadPool::globalInstance()->setMaxThreadCount(parser.value(jobsOption).toInt());
+	if (parser.isSet(imperialOption)) {
+		prefs.unit_system = IMPERIAL;
+		prefs.units = IMPERIAL_units;
+	}
+	timestamp_t since = INT64_MIN, before = INT64_MAX;
+	if ((parser.isSet(sinceOption) && !parseDate(parser.value(sinceOption), since)) ||
+	    (parser.isSet(beforeOption) && !parseDate(parser.value(beforeOption), before)))
+		return 1;
+	bool selectedOnly = parser.isSet(sinceOption) || parser.isSet(beforeOption);
+
+	int ret = readInputs(inputs) ? 0 : 1;
+	if (parser.isSet(downloadOption) && !downloadDiveComputers(parser.values(downloadOption), parser.isSet(forceOption)))
+		ret = 1;
+	if (parser.isSet(reparseOption) && !reparseCachedDives())
+		ret = 1;
+	if (verbose)
+		fprintf(stderr, "Merged %d dives\n", dive_table.nr);
+
+	// The merged log is always saved with all dives
+	if (parser.isSet(outputOption) && saveLog(parser.value(outputOption)))
+		ret = 1;
+	if (selectedOnly)
+		selectTimeRange(since, before);
+	if (parser.isSet(csvOption) &&
+	    export_dives_xslt(QFile::encodeName(parser.value(csvOption)).constData(), selectedOnly,
+			      parser.isSet(imperialOption) ? 1 : 0, "xml2manualcsv.xslt", false))
+		ret = 1;
+	if (parser.isSet(profileDataOption) && exportProfileData(parser.value(profileDataOption), selectedOnly))
+		ret = 1;
+	if (parser.isSet(htmlOption))
+		exportHtml(parser.value(htmlOption), selectedOnly);
+
+	clear_dive_file_data();
+	return ret;
+}
@@ -6,15 +6,21 @@
 #include <string.h>
 #include <time.h>
 
+#include "commands/command.h"
+#include "core/checkcloudconnection.h"
 #include "core/color.h"
+#include "core/divelist.h"
 #include "core/downloadfromdcthread.h" // for fill_computer_list
 #include "core/errorhelper.h"
+#include "core/imagedownloader.h"
+#include "core/memorystatistics.h"
 #include "core/parse.h"
 #include "core/qt-gui.h"
 #include "core/qthelper.h"
 #include "core/subsurfacestartup.h"
 #include "core/settings/qPref.h"
 #include "core/tag.h"
+#include "core/trace.h"
 #include "desktop-widgets/diveplanner.h"
 #include "desktop-widgets/mainwindow.h"
 #include "desktop-widgets/preferences/preferencesdialog.h"
@@ -92,8 +98,11 @@ int main(int argc, char **argv)
 				files.push_back(QString(prefs.default_filename));
 		} else if (prefs.default_file_behavior == CLOUD_DEFAULT_FILE) {
 			QString cloudURL;
-			if (getCloudURL(cloudURL) == 0)
+			if (getCloudURL(cloudURL) == 0) {
+				// Check the connection while the local copy is read
+				checkCloudConnectionInBackground();
 				files.push_back(cloudURL);
+			}
 		}
 	}
 	MainWindow *m = MainWindow::instance();
@@ -107,8 +116,18 @@ int main(int argc, char **argv)
 
 	if (verbose > 0)
 		print_files();
+	if (memory_report) {
+		char *report = memory_statistics();
+		printf("Memory used:\n%s", report);
+		free(report);
+	}
 	if (!quit)
 		run_ui();
+	if (full_teardown) {
+		Command::clear();
+		clear_dive_file_data();
+	}
+	Thumbnailer::instance()->finishWork();
 	exit_ui();
 	taglist_free(g_tag_list);
 	parse_xml_exit();
@@ -119,6 +138,14 @@ int main(int argc, char **argv)
 	// Sync struct preferences to disk
 	qPref::sync();
 
+	// Freeing the dives, the undo stack and the caches object by object makes
+	// quitting with a big log slow. Everything that persists has been written
+	// now, so leave the memory to the operating system.
+	if (!full_teardown) {
+		trace_close();
+		fflush(NULL);
+		_Exit(0);
+	}
 	free_prefs();
 	return 0;
 }
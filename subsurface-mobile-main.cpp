@@ -9,6 +9,7 @@
 #include "core/dive.h"
 #include "core/color.h"
 #include "core/downloadfromdcthread.h"
+#include "core/imagedownloader.h"
 #include "core/parse.h"
 #include "core/qt-gui.h"
 #include "core/qthelper.h"
@@ -16,6 +17,7 @@
 #include "core/settings/qPref.h"
 #include "core/settings/qPrefDisplay.h"
 #include "core/tag.h"
+#include "core/trace.h"
 #include "core/settings/qPrefCloudStorage.h"
 
 #include <QApplication>
@@ -76,6 +78,7 @@ int main(int argc, char **argv)
 
 	if (!quit)
 		run_ui();
+	Thumbnailer::instance()->finishWork();
 	exit_ui();
 	taglist_free(g_tag_list);
 	parse_xml_exit();
@@ -84,6 +87,12 @@ int main(int argc, char **argv)
 	// Sync struct preferences to disk
 	qPref::sync();
 
+	// Leave the dives and caches to the operating system, see the desktop version
+	if (!full_teardown) {
+		trace_close();
+		fflush(NULL);
+		_Exit(0);
+	}
 	free_prefs();
 	return 0;
 }
@@ -0,0 +1,245 @@
+// SPDX-License-Identifier: GPL-2.0
+#include "syntheticlog.h"
+#include "core/dive.h"
+#include "core/divelist.h"
+#include "core/divesite.h"
+#include "core/event.h"
+#include "core/picture.h"
+#include "core/sample.h"
+#include "core/tag.h"
+#include "core/trip.h"
+#include <QtGlobal>
+#include <algorithm>
+#include <string>
+#include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// A fixed pseudo-random sequence, so that every run sees the same log
+static unsigned int randomState;
+
+static unsigned int nextRandom(unsigned int range)
+{
+	randomState = randomState * 1103515245 + 12345;
+	return (randomState >> 8) % range;
+}
+
+static const char *words[] = {
+	"reef", "wreck", "drift", "cave", "night", "shark", "turtle", "current",
+	"visibility", "training", "deco", "photo", "wall", "kelp", "ray", "cold"
+};
+static const char *buddies[] = {
+	"Anna", "Bert", "Chris", "Dana", "Eli", "Fran", "Gus", "Hana"
+};
+#define NR_WORDS (sizeof(words) / sizeof(words[0]))
+#define NR_BUDDIES (sizeof(buddies) / sizeof(buddies[0]))
+
+// The same as for the automatic grouping of the dives into trips
+static const int tripGap = 3 * 24 * 3600;
+
+static int envValue(const char *name, int defaultValue)
+{
+	bool ok;
+	int res = qEnvironmentVariableIntValue(name, &ok);
+	return ok && res >= 0 ? res : defaultValue;
+}
+
+SyntheticLogOptions syntheticLogOptionsFromEnvironment()
+{
+	SyntheticLogOptions res;
+	res.dives = envValue("SUBSURFACE_BENCHMARK_DIVES", res.dives);
+	res.sampleInterval = std::max(envValue("SUBSURFACE_BENCHMARK_INTERVAL", res.sampleInterval), 1);
+	res.ccrPercent = envValue("SUBSURFACE_BENCHMARK_CCR", res.ccrPercent);
+	res.trimixPercent = envValue("SUBSURFACE_BENCHMARK_TRIMIX", res.trimixPercent);
+	res.seed = (unsigned int)envValue("SUBSURFACE_BENCHMARK_SEED", (int)res.seed);
+	return res;
+}
+
+static void setCylinder(struct dive *d, int idx, const char *description, int size, int workingPressure,
+			int o2, int he, int start, int end, enum cylinderuse use)
+{
+	cylinder_t *cyl = get_or_create_cylinder(d, idx);
+	free((void *)cyl->type.description);
+	cyl->type.description = strdup(description);
+	cyl->type.size.mliter = size;
+	cyl->type.workingpressure.mbar = workingPressure;
+	cyl->gasmix.o2.permille = o2;
+	cyl->gasmix.he.permille = he;
+	cyl->start.mbar = start;
+	cyl->end.mbar = end;
+	cyl->cylinder_use = use;
+}
+
+// A descent - bottom - ascent profile with a bit of noise and a safety stop.
+// "scale" is in permille, so that a second dive computer doesn't read exactly the same.
+static int profileDepth(int time, int duration, int maxDepth, int scale)
+{
+	int depth;
+	if (time < duration / 10)
+		depth = maxDepth * (long long)time / (duration / 10);
+	else if (time < duration * 7 / 10)
+		depth = maxDepth - (int)nextRandom(2000);
+	else if (time < duration - 240)
+		depth = 5000 + (maxDepth - 5000) * (long long)(duration - 240 - time) / (duration * 3 / 10 - 240);
+	else if (time < duration - 60)
+		depth = 5000 - (int)nextRandom(300);
+	else
+		depth = 5000 * (duration - time) / 60;
+	return std::max(depth, 0) * scale / 1000;
+}
+
+static void addSamples(struct divecomputer *dc, int duration, int interval, int maxDepth, int scale,
+		       int waterTemp, bool ccr, bool trimix, int switchTime)
+{
+	for (int time = interval; time <= duration; time += interval) {
+		struct sample *sample = prepare_sample(dc);
+		sample->time.seconds = time;
+		sample->depth.mm = profileDepth(time, duration, maxDepth, scale);
+		// like most dive computers, only write the temperature when it changes
+		if (time % 60 < interval)
+			sample->temperature.mkelvin = C_to_mkelvin(waterTemp - sample->depth.mm / 10000.0);
+		if (ccr) {
+			sample->setpoint.mbar = time < 120 || time > duration - 120 ? 700 : 1300;
+			for (int i = 0; i < 3; i++)
+				sample->o2sensor[i].mbar = sample->setpoint.mbar - 30 + nextRandom(60);
+		} else if (trimix) {
+			if (time < switchTime)
+				add_sample_pressure(sample, 0, 220000 - 140000LL * time / switchTime);
+			else
+				add_sample_pressure(sample, 1, 200000 - 80000LL * (time - switchTime) / std::max(duration - switchTime, 1));
+		} else {
+			add_sample_pressure(sample, 0, 200000 - 150000LL * time / duration);
+		}
+		finish_sample(dc);
+	}
+}
+
+static void addEvents(struct dive *d, struct divecomputer *dc, int duration, bool trimix, int switchTime)
+{
+	if (trimix)
+		add_gas_switch_event(d, dc, switchTime, 1);
+	if (nextRandom(4) == 0)
+		add_event(dc, nextRandom(duration), SAMPLE_EVENT_BOOKMARK, 0, 0, "bookmark");
+	if (nextRandom(10) == 0)
+		add_event(dc, duration * 7 / 10 + nextRandom(duration / 10), SAMPLE_EVENT_ASCENT, 0, 0, "ascent");
+}
+
+static struct dive *createDive(const SyntheticLogOptions &options, int number, timestamp_t when,
+			       const std::vector<struct dive_site *> &sites)
+{
+	unsigned int kind = nextRandom(100);
+	bool ccr = kind < (unsigned)options.ccrPercent;
+	bool trimix = !ccr && kind < (unsigned)(options.ccrPercent + options.trimixPercent);
+	int duration = 1800 + nextRandom(3600);
+	int maxDepth = 10000 + nextRandom(trimix || ccr ? 70000 : 30000);
+	int waterTemp = 5 + nextRandom(25);
+	int switchTime = duration * 8 / 10;
+	// draw the random words one by one, the evaluation order of a single expression is unspecified
+	const char *tag1 = words[nextRandom(NR_WORDS)];
+	const char *tag2 = words[nextRandom(NR_WORDS)];
+
+	struct dive *d = alloc_dive();
+	d->number = number;
+	d->when = d->dc.when = when;
+	d->buddy = strdup(buddies[nextRandom(NR_BUDDIES)]);
+	taglist_add_tag(&d->tag_list, tag1);
+	taglist_add_tag(&d->tag_list, tag2);
+	std::string notes;
+	for (int i = 0; i < 20; i++)
+		notes.append(i ? " " : "").append(words[nextRandom(NR_WORDS)]);
+	d->notes = strdup(notes.c_str());
+	d->rating = nextRandom(6);
+
+	if (ccr) {
+		setCylinder(d, 0, "Oxy", 3000, 232000, 1000, 0, 200000, 120000, OXYGEN);
+		setCylinder(d, 1, "Dil", 3000, 232000, 100, 700, 200000, 140000, DILUENT);
+	} else if (trimix) {
+		setCylinder(d, 0, "D12", 24000, 232000, 180, 450, 220000, 80000, OC_GAS);
+		setCylinder(d, 1, "AL80", 11100, 207000, 500, 0, 200000, 120000, OC_GAS);
+	} else {
+		setCylinder(d, 0, "12L", 12000, 232000, 210 + 10 * nextRandom(12), 0, 200000, 50000, OC_GAS);
+	}
+
+	struct divecomputer *dc = &d->dc;
+	dc->model = strdup(ccr ? "Synthetic CCR" : "Synthetic OC");
+	dc->deviceid = ccr ? 1 : 2;
+	dc->diveid = number;
+	dc->divemode = ccr ? CCR : OC;
+	dc->no_o2sensors = ccr ? 3 : 0;
+	addSamples(dc, duration, options.sampleInterval, maxDepth, 1000, waterTemp, ccr, trimix, switchTime);
+	addEvents(d, dc, duration, trimix, switchTime);
+
+	// A backup computer, e.g. a bottom timer without gas integration
+	if (nextRandom(100) < (unsigned)options.secondDcPercent) {
+		struct divecomputer *dc2 = (struct divecomputer *)calloc(1, sizeof(struct divecomputer));
+		dc2->when = when + nextRandom(20);
+		dc2->model = strdup("Synthetic Backup");
+		dc2->deviceid = 3;
+		dc2->diveid = number;
+		dc2->divemode = dc->divemode;
+		addSamples(dc2, duration, options.sampleInterval * 2, maxDepth, 990 + nextRandom(20), waterTemp, false, false, switchTime);
+		addEvents(d, dc2, duration, trimix, switchTime);
+		dc->next = dc2;
+	}
+
+	struct dive_site *ds = sites[nextRandom(sites.size())];
+	add_dive_to_dive_site(d, ds);
+
+	int nrPictures = nextRandom(options.pictures + 1);
+	for (int i = 0; i < nrPictures; i++) {
+		char filename[64];
+		snprintf(filename, sizeof(filename), "/synthetic/pictures/dive%06d-%d.jpg", number, i);
+		struct picture picture;
+		picture.filename = strdup(filename);
+		picture.offset.seconds = nextRandom(duration);
+		picture.location = ds->location;
+		add_picture(&d->pictures, picture);
+	}
+	return d;
+}
+
+// Consecutive dives are grouped into trips, except for one in four series of dives,
+// which are dived from home
+static void createTrips()
+{
+	dive_trip_t *trip = NULL;
+	int series = 0;
+	for (int i = 0; i < dive_table.nr; i++) {
+		struct dive *d = dive_table.dives[i];
+		if (i > 0 && d->when - dive_endtime(dive_table.dives[i - 1]) > tripGap) {
+			trip = NULL;
+			series++;
+		}
+		if (series % 4 == 3)
+			continue;
+		if (trip)
+			add_dive_to_trip(d, trip);
+		else
+			trip = create_and_hookup_trip_from_dive(d, &trip_table);
+	}
+}
+
+void generateSyntheticLog(const SyntheticLogOptions &options)
+{
+	randomState = options.seed;
+
+	std::vector<struct dive_site *> sites;
+	int nrSites = std::max(options.dives / 20, 1);
+	for (int i = 0; i < nrSites; i++) {
+		char name[32];
+		snprintf(name, sizeof(name), "Site %d", i + 1);
+		struct dive_site *ds = create_dive_site(name, &dive_site_table);
+		ds->location = create_location(-60.0 + nextRandom(120000) / 1000.0, -180.0 + nextRandom(360000) / 1000.0);
+		sites.push_back(ds);
+	}
+
+	// 2010-01-01 09:00 - two dives a day on some days, then surface for a while
+	timestamp_t when = 1262336400;
+	for (int i = 0; i < options.dives; i++) {
+		record_dive_to_table(createDive(options, i + 1, when, sites), &dive_table);
+		when += i % 2 ? 4 * 3600 + nextRandom(86400 * 5) : 3 * 3600;
+	}
+	sort_dive_table(&dive_table);
+	createTrips();
+}
@@ -0,0 +1,29 @@
+// SPDX-License-Identifier: GPL-2.0
+// Reproducible dive logs for the benchmarks, so that they don't depend on sample
+// data that has to be downloaded. The dives are created with the functions of the
+// core, like a dive computer download, and the same options give the same log.
+#ifndef SYNTHETICLOG_H
+#define SYNTHETICLOG_H
+
+struct SyntheticLogOptions {
+	int dives = 1000;
+	int sampleInterval = 10;	// seconds, the second dive computer records every other sample
+	int ccrPercent = 10;		// percentage of CCR dives
+	int trimixPercent = 20;		// percentage of open circuit trimix dives
+	int secondDcPercent = 30;	// percentage of dives with a second dive computer
+	int pictures = 3;		// at most this many pictures per dive
+	unsigned int seed = 1;
+};
+
+// The defaults, overridden by the environment:
+//	SUBSURFACE_BENCHMARK_DIVES	number of dives, the benchmarks are run with 1000, 10000 and 100000
+//	SUBSURFACE_BENCHMARK_INTERVAL	seconds between the samples
+//	SUBSURFACE_BENCHMARK_CCR	percentage of CCR dives
+//	SUBSURFACE_BENCHMARK_TRIMIX	percentage of open circuit trimix dives
+//	SUBSURFACE_BENCHMARK_SEED	seed of the pseudo-random numbers
+SyntheticLogOptions syntheticLogOptionsFromEnvironment();
+
+// Adds the dives with their trips and dive sites to the global tables
+void generateSyntheticLog(const SyntheticLogOptions &options);
+
+#endif
@@ -5,6 +5,7 @@
 #include "core/divesite.h"
 #include "core/trip.h"
 #include "core/file.h"
+#include "core/subsurface-string.h"
 
 void TestDiveSiteDuplication::testReadV2()
 {
@@ -13,4 +14,76 @@ void TestDiveSiteDuplication::testReadV2()
 	QCOMPARE(dive_site_table.nr, 2);
 }
 
+void TestDiveSiteDuplication::testGpsLookup()
+{
+	struct dive_site_table sites = empty_dive_site_table;
+	location_t a = create_location(47.0, 11.0);
+	location_t b = create_location(47.0001, 11.0);	// about 11 m north of a
+	location_t c = create_location(-33.0, 151.0);
+	struct dive_site *ds_a = create_dive_site_with_gps("a", &a, &sites);
+	struct dive_site *ds_b = create_dive_site_with_gps("b", &b, &sites);
+	struct dive_site *ds_c = create_dive_site_with_gps("c", &c, &sites);
+	create_dive_site("no gps", &sites);
+
+	// Repeat the queries, so that they are answered by the index
+	for (int i = 0; i < 10; i++) {
+		QCOMPARE(get_dive_site_by_gps(&a, &sites), ds_a);
+		QCOMPARE(get_dive_site_by_gps(&c, &sites), ds_c);
+		QCOMPARE(get_dive_site_by_gps_and_name((char *)"b", &b, &sites), ds_b);
+		QVERIFY(get_dive_site_by_gps_and_name((char *)"a", &b, &sites) == NULL);
+		QCOMPARE(get_dive_site_by_gps_proximity(&a, 20, &sites), ds_a);
+		QCOMPARE(get_dive_site_by_gps_proximity(&b, 5, &sites), ds_b);
+		QVERIFY(get_dive_site_by_gps_proximity(&a, 10, &sites) == ds_a);
+		QVERIFY(get_dive_site_by_gps_proximity(&c, 0, &sites) == NULL);
+	}
+
+	// Moving a site must be reflected by the lookups
+	ds_c->location = create_location(47.00005, 11.0);
+	invalidate_dive_site_gps_index();
+	for (int i = 0; i < 10; i++) {
+		QVERIFY(get_dive_site_by_gps(&c, &sites) == NULL);
+		QCOMPARE(get_dive_site_by_gps_proximity(&ds_c->location, 20, &sites), ds_c);
+	}
+
+	clear_dive_site_table(&sites);
+	free(sites.dive_sites);
+}
+
+void TestDiveSiteDuplication::testNameLookup()
+{
+	struct dive_site_table sites = empty_dive_site_table;
+	struct dive_site *ds_a = create_dive_site("a", &sites);
+	struct dive_site *ds_b = create_dive_site("b", &sites);
+	struct dive_site *ds_unnamed = create_dive_site(NULL, &sites);
+	struct dive_site *ds_a2 = create_dive_site("a", &sites);
+	struct dive_site *first_a = get_divesite_idx(ds_a, &sites) < get_divesite_idx(ds_a2, &sites) ? ds_a : ds_a2;
+
+	// Repeat the queries, so that they are answered by the index
+	for (int i = 0; i < 10; i++) {
+		QCOMPARE(get_dive_site_by_name("a", &sites), first_a);
+		QCOMPARE(get_dive_site_by_name("b", &sites), ds_b);
+		QCOMPARE(get_dive_site_by_name("", &sites), ds_unnamed);
+		QVERIFY(get_dive_site_by_name("A", &sites) == NULL);
+		QCOMPARE(find_or_create_dive_site_with_name("b", &sites), ds_b);
+	}
+
+	// Renaming a site must be reflected by the lookups
+	free(ds_b->name);
+	ds_b->name = copy_string("c");
+	invalidate_dive_site_name_index();
+	for (int i = 0; i < 10; i++) {
+		QVERIFY(get_dive_site_by_name("b", &sites) == NULL);
+		QCOMPARE(get_dive_site_by_name("c", &sites), ds_b);
+	}
+
+	// Adding a site must be reflected by the lookups
+	struct dive_site *ds_d = find_or_create_dive_site_with_name("d", &sites);
+	QCOMPARE(sites.nr, 5);
+	for (int i = 0; i < 10; i++)
+		QCOMPARE(get_dive_site_by_name("d", &sites), ds_d);
+
+	clear_dive_site_table(&sites);
+	free(sites.dive_sites);
+}
+
 QTEST_GUILESS_MAIN(TestDiveSiteDuplication)
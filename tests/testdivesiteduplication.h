@@ -8,6 +8,8 @@ class TestDiveSiteDuplication : public QObject {
 	Q_OBJECT
 private slots:
 	void testReadV2();
+	void testGpsLookup();
+	void testNameLookup();
 };
 
 #endif // TESTDIVESITEDUPLICATION_H
@@ -219,6 +219,133 @@ void TestGitStorage::testGitStorageLocal()
 	QCOMPARE(readin, written);
 }
 
+void TestGitStorage::testGitStorageSnapshot()
+{
+	// the first load of a commit writes a binary snapshot, the second load
+	// reads the snapshot - both have to give the same result
+	git_repository *repo;
+	QCOMPARE(parse_file(SUBSURFACE_TEST_DATA "/dives/SampleDivesV2.ssrf", &dive_table, &trip_table,
+			    &dive_site_table, &device_table, &filter_preset_table), 0);
+	QDir testDir("./gittestsnapshot");
+	QCOMPARE(testDir.removeRecursively(), true);
+	QCOMPARE(QDir().mkdir("./gittestsnapshot"), true);
+	QCOMPARE(git_repository_init(&repo, "./gittestsnapshot", false), 0);
+	QCOMPARE(save_dives("./gittestsnapshot[test]"), 0);
+	clear_dive_file_data();
+	QCOMPARE(parse_file("./gittestsnapshot[test]", &dive_table, &trip_table,
+			    &dive_site_table, &device_table, &filter_preset_table), 0);
+	QCOMPARE(save_dives("./SampleDivesV3viagit.ssrf"), 0);
+	QVERIFY(QFile::exists("./gittestsnapshot/.git/subsurface.snapshot"));
+	clear_dive_file_data();
+	QCOMPARE(parse_file("./gittestsnapshot[test]", &dive_table, &trip_table,
+			    &dive_site_table, &device_table, &filter_preset_table), 0);
+	QCOMPARE(save_dives("./SampleDivesV3viasnapshot.ssrf"), 0);
+	QFile org("./SampleDivesV3viagit.ssrf");
+	org.open(QFile::ReadOnly);
+	QFile out("./SampleDivesV3viasnapshot.ssrf");
+	out.open(QFile::ReadOnly);
+	QTextStream orgS(&org);
+	QTextStream outS(&out);
+	QString readin = orgS.readAll();
+	QString written = outS.readAll();
+	QCOMPARE(readin, written);
+	git_repository_free(repo);
+}
+
+void TestGitStorage::testGitStorageReuse()
+{
+	// reloading a repository while reusing the previously loaded dives
+	// must give the same result as a full load - and reuse all dives
+	git_repository *repo;
+	const char *branch;
+	QCOMPARE(parse_file(SUBSURFACE_TEST_DATA "/dives/SampleDivesV2.ssrf", &dive_table, &trip_table,
+			    &dive_site_table, &device_table, &filter_preset_table), 0);
+	QDir testDir("./gittestreuse");
+	QCOMPARE(testDir.removeRecursively(), true);
+	QCOMPARE(QDir().mkdir("./gittestreuse"), true);
+	QCOMPARE(git_repository_init(&repo, "./gittestreuse", false), 0);
+	QCOMPARE(save_dives("./gittestreuse[test]"), 0);
+	clear_dive_file_data();
+	QCOMPARE(parse_file("./gittestreuse[test]", &dive_table, &trip_table,
+			    &dive_site_table, &device_table, &filter_preset_table), 0);
+	QCOMPARE(save_dives("./SampleDivesV3viagit.ssrf"), 0);
+	int nr_dives = dive_table.nr;
+	QVERIFY(nr_dives > 0);
+
+	struct dive_table old_dives = empty_dive_table;
+	struct trip_table old_trips = empty_trip_table;
+	struct dive_site_table old_sites = empty_dive_site_table;
+	detach_dive_file_data(&old_dives, &old_trips, &old_sites);
+	QCOMPARE(old_dives.nr, nr_dives);
+	git_repository *git = is_git_repository("./gittestreuse[test]", &branch, NULL, false);
+	QVERIFY(git != NULL && git != dummy_git_repository);
+	QCOMPARE(git_load_dives_reuse(git, branch, &old_dives, &dive_table, &trip_table,
+				      &dive_site_table, &device_table, &filter_preset_table), 0);
+	QCOMPARE(old_dives.nr, 0);
+	QCOMPARE(dive_table.nr, nr_dives);
+	clear_detached_dive_file_data(&old_dives, &old_trips, &old_sites);
+	QCOMPARE(save_dives("./SampleDivesV3viareuse.ssrf"), 0);
+	QFile org("./SampleDivesV3viagit.ssrf");
+	org.open(QFile::ReadOnly);
+	QFile out("./SampleDivesV3viareuse.ssrf");
+	out.open(QFile::ReadOnly);
+	QTextStream orgS(&org);
+	QTextStream outS(&out);
+	QString readin = orgS.readAll();
+	QString written = outS.readAll();
+	QCOMPARE(readin, written);
+	git_repository_free(repo);
+}
+
+void TestGitStorage::testGitStorageCachedSave()
+{
+	// saving writes only the changed parts of the tree and remembers
+	// the tree ids of the rest - the result must still be complete
+	git_repository *repo;
+	QCOMPARE(parse_file(SUBSURFACE_TEST_DATA "/dives/SampleDivesV2.ssrf", &dive_table, &trip_table,
+			    &dive_site_table, &device_table, &filter_preset_table), 0);
+	QDir testDir("./gittestcached");
+	QCOMPARE(testDir.removeRecursively(), true);
+	QCOMPARE(QDir().mkdir("./gittestcached"), true);
+	QCOMPARE(git_repository_init(&repo, "./gittestcached", false), 0);
+	QCOMPARE(save_dives("./gittestcached[test]"), 0);
+	QVERIFY(trip_table.nr > 0);
+	QVERIFY(dive_site_table_cache_is_valid(&dive_site_table));
+	for (int i = 0; i < trip_table.nr; ++i)
+		QVERIFY(trip_cache_is_valid(trip_table.trips[i]));
+
+	// change one trip and one dive site, then save again
+	struct dive_trip *trip = trip_table.trips[0];
+	free(trip->location);
+	trip->location = strdup("Cached save test");
+	invalidate_trip_cache(trip);
+	struct dive_site *ds = get_dive_site(0, &dive_site_table);
+	free(ds->notes);
+	ds->notes = strdup("Cached save notes");
+	invalidate_dive_site_table_cache(&dive_site_table);
+	QCOMPARE(save_dives("./gittestcached[test]"), 0);
+	QVERIFY(trip_cache_is_valid(trip));
+	QVERIFY(dive_site_table_cache_is_valid(&dive_site_table));
+	QCOMPARE(save_dives("./SampleDivesV3cached.ssrf"), 0);
+
+	clear_dive_file_data();
+	QCOMPARE(parse_file("./gittestcached[test]", &dive_table, &trip_table,
+			    &dive_site_table, &device_table, &filter_preset_table), 0);
+	QCOMPARE(save_dives("./SampleDivesV3cachedviagit.ssrf"), 0);
+	QFile org("./SampleDivesV3cached.ssrf");
+	org.open(QFile::ReadOnly);
+	QFile out("./SampleDivesV3cachedviagit.ssrf");
+	out.open(QFile::ReadOnly);
+	QTextStream orgS(&org);
+	QTextStream outS(&out);
+	QString readin = orgS.readAll();
+	QString written = outS.readAll();
+	QCOMPARE(readin, written);
+	QVERIFY(readin.contains("Cached save test"));
+	QVERIFY(readin.contains("Cached save notes"));
+	git_repository_free(repo);
+}
+
 void TestGitStorage::testGitStorageCloud()
 {
 	// test writing and reading back from cloud storage
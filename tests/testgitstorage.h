@@ -13,6 +13,9 @@ private slots:
 
 	void testGitStorageLocal_data();
 	void testGitStorageLocal();
+	void testGitStorageSnapshot();
+	void testGitStorageReuse();
+	void testGitStorageCachedSave();
 	void testGitStorageCloud();
 	void testGitStorageCloudOfflineSync();
 	void testGitStorageCloudMerge();
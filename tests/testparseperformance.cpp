@@ -1,18 +1,34 @@
 // SPDX-License-Identifier: GPL-2.0
 #include "testparseperformance.h"
+#include "syntheticlog.h"
 #include "core/device.h"
+#include "core/dive.h"
 #include "core/divesite.h"
 #include "core/trip.h"
 #include "core/file.h"
 #include "core/git-access.h"
 #include "core/settings/qPrefProxy.h"
 #include "core/settings/qPrefCloudStorage.h"
+#include <QDir>
 #include <QFile>
 #include <QDebug>
 #include <QNetworkProxy>
 
 #define LARGE_TEST_REPO "https://github.com/Subsurface/large-anonymous-sample-data"
 
+// Without the large sample data, a synthetic log is parsed, see syntheticlog.h
+static QString syntheticDir;
+
+static QString syntheticSsrf()
+{
+	return syntheticDir + "/synthetic.ssrf";
+}
+
+static QString syntheticRepo()
+{
+	return syntheticDir + "/git[synthetic]";
+}
+
 void TestParsePerformance::initTestCase()
 {
 	/* we need to manually tell that the resource exists, because we are using it as library. */
@@ -43,6 +59,22 @@ void TestParsePerformance::initTestCase()
 	QString localCacheDir(get_local_dir(LARGE_TEST_REPO, "git"));
 	QDir localCacheDirectory(localCacheDir);
 	QCOMPARE(localCacheDirectory.removeRecursively(), true);
+
+	// the synthetic log is saved as XML and to a local git repository
+	git_libgit2_init();
+	syntheticDir = QDir::tempPath() + "/subsurface-parse-benchmark";
+	QCOMPARE(QDir(syntheticDir).removeRecursively(), true);
+	QVERIFY(QDir().mkpath(syntheticDir));
+	generateSyntheticLog(syntheticLogOptionsFromEnvironment());
+	QCOMPARE(save_dives(qPrintable(syntheticSsrf())), 0);
+	QCOMPARE(git_create_local_repo(qPrintable(syntheticRepo())), 0);
+	QCOMPARE(save_dives(qPrintable(syntheticRepo())), 0);
+	clear_dive_file_data();
+}
+
+void TestParsePerformance::cleanupTestCase()
+{
+	QDir(syntheticDir).removeRecursively();
 }
 
 void TestParsePerformance::init()
@@ -57,22 +89,37 @@ void TestParsePerformance::cleanup()
 void TestParsePerformance::parseSsrf()
 {
 	// parsing of a V2 file should work
-	QFile largeSsrfFile(SUBSURFACE_TEST_DATA "/dives/large-anon.ssrf");
-	if (!largeSsrfFile.exists()) {
+	QString fileName = SUBSURFACE_TEST_DATA "/dives/large-anon.ssrf";
+	if (!QFile::exists(fileName)) {
 		qDebug() << "missing large sample data file - available at " LARGE_TEST_REPO;
 		qDebug() << "clone the repo, uncompress the file and copy it to " SUBSURFACE_TEST_DATA "/dives/large-anon.ssrf";
-		return;
+		qDebug() << "parsing the synthetic log instead";
+		fileName = syntheticSsrf();
 	}
 	QBENCHMARK {
-		parse_file(SUBSURFACE_TEST_DATA "/dives/large-anon.ssrf", &dive_table, &trip_table,
+		parse_file(qPrintable(fileName), &dive_table, &trip_table,
 			   &dive_site_table, &device_table, &filter_preset_table);
 	}
 }
 
+void TestParsePerformance::parseGit_data()
+{
+	QTest::addColumn<bool>("parallel");
+	QTest::addColumn<bool>("snapshot");
+	QTest::newRow("serial") << false << false;
+	QTest::newRow("parallel") << true << false;
+	QTest::newRow("snapshot") << true << true;
+}
+
 void TestParsePerformance::parseGit()
 {
+	QFETCH(bool, parallel);
+	QFETCH(bool, snapshot);
+
 	// some more necessary setup
 	git_libgit2_init();
+	git_load_parallel = parallel;
+	git_use_snapshot = snapshot;
 
 	// first parse this once to populate the local cache - this way network
 	// effects don't dominate the parse time
@@ -85,6 +132,29 @@ void TestParsePerformance::parseGit()
 		parse_file(LARGE_TEST_REPO "[git]", &dive_table, &trip_table, &dive_site_table,
 			   &device_table, &filter_preset_table);
 	}
+	git_load_parallel = true;
+	git_use_snapshot = true;
+}
+
+void TestParsePerformance::parseSyntheticGit_data()
+{
+	parseGit_data();
+}
+
+// The same as parseGit() on a local repository, which doesn't need the network
+void TestParsePerformance::parseSyntheticGit()
+{
+	QFETCH(bool, parallel);
+	QFETCH(bool, snapshot);
+
+	git_load_parallel = parallel;
+	git_use_snapshot = snapshot;
+	QBENCHMARK {
+		parse_file(qPrintable(syntheticRepo()), &dive_table, &trip_table, &dive_site_table,
+			   &device_table, &filter_preset_table);
+	}
+	git_load_parallel = true;
+	git_use_snapshot = true;
 }
 
 QTEST_GUILESS_MAIN(TestParsePerformance)
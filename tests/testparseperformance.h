@@ -8,11 +8,15 @@ class TestParsePerformance : public QObject {
 	Q_OBJECT
 private slots:
 	void initTestCase();
+	void cleanupTestCase();
 	void init();
 	void cleanup();
 
 	void parseSsrf();
+	void parseGit_data();
 	void parseGit();
+	void parseSyntheticGit_data();
+	void parseSyntheticGit();
 };
 
 #endif
@@ -0,0 +1,296 @@
+// SPDX-License-Identifier: GPL-2.0
+#include "testperformance.h"
+#include "syntheticlog.h"
+#include "core/deco.h"
+#include "core/device.h"
+#include "core/dive.h"
+#include "core/divefilter.h"
+#include "core/divelist.h"
+#include "core/divesite.h"
+#include "core/file.h"
+#include "core/fulltext.h"
+#include "core/git-access.h"
+#include "core/planner.h"
+#include "core/profile.h"
+#include "core/trip.h"
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QDir>
+#include <QFile>
+#include <QTextStream>
+#include <QDebug>
+
+// An end-to-end benchmark of the core operations on a synthetic dive log.
+// The log is generated deterministically, see syntheticlog.h for the environment
+// variables that set its size.
+// This is not part of the "check" target, run it with "ctest -C benchmark -R TestPerformance".
+// For machine readable results, run the binary directly with "-o results.csv,csv", and
+// compare two such runs with "scripts/compare-benchmarks.pl old.csv new.csv".
+// scripts/run-benchmarks.sh does that for the logs of 1000, 10000 and 100000 dives
+// and keeps the results of every commit.
+// The number of randomized plans is set by SUBSURFACE_BENCHMARK_PLANS (default 1000).
+
+static QString benchmarkDir;
+static QString xmlFile;
+
+static int envValue(const char *name, int defaultValue)
+{
+	bool ok;
+	int res = qEnvironmentVariableIntValue(name, &ok);
+	return ok && res >= 0 ? res : defaultValue;
+}
+
+// A fixed pseudo-random sequence, so that every run sees the same log
+static unsigned int randomState;
+
+static unsigned int nextRandom(unsigned int range)
+{
+	randomState = randomState * 1103515245 + 12345;
+	return (randomState >> 8) % range;
+}
+
+static void generateLog(const QString &fileName)
+{
+	SyntheticLogOptions options = syntheticLogOptionsFromEnvironment();
+	qDebug() << "synthetic log:" << options.dives << "dives," << options.sampleInterval << "s sample interval,"
+		 << options.ccrPercent << "% CCR," << options.trimixPercent << "% trimix";
+	generateSyntheticLog(options);
+	QCOMPARE(save_dives(qPrintable(fileName)), 0);
+	clear_dive_file_data();
+}
+
+static void loadLog()
+{
+	QCOMPARE(parse_file(qPrintable(xmlFile), &dive_table, &trip_table, &dive_site_table,
+			    &device_table, &filter_preset_table), 0);
+	process_loaded_dives();
+}
+
+void TestPerformance::initTestCase()
+{
+	/* we need to manually tell that the resource exists, because we are using it as library. */
+	Q_INIT_RESOURCE(subsurface);
+
+	copy_prefs(&default_prefs, &prefs);
+	git_libgit2_init();
+
+	benchmarkDir = QDir::tempPath() + "/subsurface-benchmark";
+	QDir dir(benchmarkDir);
+	QCOMPARE(dir.removeRecursively(), true);
+	QVERIFY(QDir().mkpath(benchmarkDir));
+	xmlFile = benchmarkDir + "/synthetic.ssrf";
+	generateLog(xmlFile);
+}
+
+void TestPerformance::cleanupTestCase()
+{
+	QDir dir(benchmarkDir);
+	dir.removeRecursively();
+}
+
+void TestPerformance::cleanup()
+{
+	clear_dive_file_data();
+}
+
+void TestPerformance::loadXml()
+{
+	QBENCHMARK {
+		clear_dive_file_data();
+		parse_file(qPrintable(xmlFile), &dive_table, &trip_table, &dive_site_table,
+			   &device_table, &filter_preset_table);
+	}
+}
+
+void TestPerformance::processLoadedDives()
+{
+	QCOMPARE(parse_file(qPrintable(xmlFile), &dive_table, &trip_table, &dive_site_table,
+			    &device_table, &filter_preset_table), 0);
+	// this sorts, merges and groups the dives - it can only run once on a freshly loaded log
+	QBENCHMARK_ONCE {
+		process_loaded_dives();
+	}
+}
+
+void TestPerformance::fulltextPopulate()
+{
+	loadLog();
+	QBENCHMARK {
+		fulltext_unregister_all();
+		fulltext_populate();
+	}
+}
+
+void TestPerformance::filterUpdateAll()
+{
+	loadLog();
+	FilterData data;
+	data.fullText = QStringLiteral("reef");
+	DiveFilter::instance()->setFilter(data);
+	QBENCHMARK {
+		DiveFilter::instance()->invalidateCache();
+		DiveFilter::instance()->updateAll();
+	}
+	DiveFilter::instance()->setFilter(FilterData());
+}
+
+void TestPerformance::createPlotInfo()
+{
+	int i;
+	struct dive *d;
+	struct plot_info pi;
+
+	loadLog();
+	init_plot_info(&pi);
+	QBENCHMARK {
+		for_each_dive (i, d) {
+			create_plot_info_new(d, &d->dc, &pi, false, NULL);
+			free_plot_info_data(&pi);
+		}
+	}
+}
+
+// A plan to the given depth on the given bottom gas, with EAN50 and oxygen for deco
+static void setupPlan(struct diveplan *dp, int depth, int bottomTime, struct gasmix bottomgas)
+{
+	dp->salinity = 10300;
+	dp->surface_pressure = 1013;
+	dp->gfhigh = 70;
+	dp->gflow = 30;
+	dp->bottomsac = prefs.bottomsac;
+	dp->decosac = prefs.decosac;
+
+	struct gasmix ean50 = {{500}, {0}};
+	struct gasmix oxygen = {{1000}, {0}};
+	pressure_t po2 = {1600};
+	cylinder_t *cyl0 = get_or_create_cylinder(&displayed_dive, 0);
+	cylinder_t *cyl1 = get_or_create_cylinder(&displayed_dive, 1);
+	cylinder_t *cyl2 = get_or_create_cylinder(&displayed_dive, 2);
+	cyl0->gasmix = bottomgas;
+	cyl0->type.size.mliter = 36000;
+	cyl0->type.workingpressure.mbar = 232000;
+	cyl1->gasmix = ean50;
+	cyl2->gasmix = oxygen;
+	reset_cylinders(&displayed_dive, true);
+	free_dps(dp);
+
+	int droptime = depth * 60 / 23000;
+	plan_add_segment(dp, 0, gas_mod(ean50, po2, &displayed_dive, 3000).mm, 1, 0, 1, OC);
+	plan_add_segment(dp, 0, gas_mod(oxygen, po2, &displayed_dive, 3000).mm, 2, 0, 1, OC);
+	plan_add_segment(dp, droptime, depth, 0, 0, 1, OC);
+	plan_add_segment(dp, bottomTime - droptime, depth, 0, 0, 1, OC);
+}
+
+static struct decostop stoptable[60];
+
+void TestPerformance::planTrimix()
+{
+	struct deco_state ds;
+	struct diveplan diveplan = {};
+	struct gasmix tx15_45 = {{150}, {450}};
+
+	prefs.planner_deco_mode = BUEHLMANN;
+	QBENCHMARK {
+		struct deco_state *cache = NULL;
+		clear_dive(&displayed_dive);
+		setupPlan(&diveplan, 79000, 30 * 60, tx15_45);
+		plan(&ds, &diveplan, &displayed_dive, 60, stoptable, &cache, true, false);
+		free(cache);
+	}
+	free_dps(&diveplan);
+	clear_dive(&displayed_dive);
+	copy_prefs(&default_prefs, &prefs);
+}
+
+void TestPerformance::planRandomized_data()
+{
+	QTest::addColumn<int>("decoMode");
+	QTest::newRow("buehlmann") << (int)BUEHLMANN;
+	QTest::newRow("vpmb") << (int)VPMB;
+}
+
+// Many seeded random plans between 20m and 90m. Reports the throughput and writes
+// the runtime and stops of every plan, which are compared to a reference file so that
+// an optimization of the deco code can't silently change the results. To update the
+// reference after an intentional change, copy planrandomized-<mode>.csv to dives/.
+void TestPerformance::planRandomized()
+{
+	QFETCH(int, decoMode);
+	int nrPlans = envValue("SUBSURFACE_BENCHMARK_PLANS", 1000);
+	struct deco_state ds;
+	struct diveplan diveplan = {};
+	QString result;
+	QTextStream out(&result);
+	int segments = 0;
+	QElapsedTimer timer;
+
+	copy_prefs(&default_prefs, &prefs);
+	prefs.planner_deco_mode = (enum deco_mode)decoMode;
+	prefs.vpmb_conservatism = 1;
+	randomState = 1;
+	timer.start();
+	QBENCHMARK_ONCE {
+		for (int i = 0; i < nrPlans; i++) {
+			struct deco_state *cache = NULL;
+			int depth = 20000 + nextRandom(70) * 1000;
+			int bottomTime = (10 + nextRandom(30)) * 60;
+			int o2 = depth > 40000 ? 180 : 210;
+			int he = depth > 40000 ? 450 : 0;
+			struct gasmix bottomgas = {{o2}, {he}};
+
+			clear_dive(&displayed_dive);
+			setupPlan(&diveplan, depth, bottomTime, bottomgas);
+			plan(&ds, &diveplan, &displayed_dive, 60, stoptable, &cache, true, false);
+			free(cache);
+
+			out << depth << "," << bottomTime << "," << displayed_dive.dc.duration.seconds;
+			for (struct divedatapoint *dp = diveplan.dp; dp; dp = dp->next) {
+				if (!dp->entered && dp->time)
+					out << "," << dp->time << ":" << dp->depth.mm << ":" << dp->cylinderid;
+				segments++;
+			}
+			out << "\n";
+		}
+	}
+	qint64 elapsed = timer.elapsed();
+	free_dps(&diveplan);
+	clear_dive(&displayed_dive);
+	copy_prefs(&default_prefs, &prefs);
+
+	if (elapsed > 0)
+		qDebug() << QTest::currentDataTag() << ":" << nrPlans * 1000.0 / elapsed << "plans/s,"
+			 << segments * 1000.0 / elapsed << "segments/s";
+	out.flush();
+	QString name = QStringLiteral("planrandomized-%1.csv").arg(QTest::currentDataTag());
+	QFile outFile(name);
+	QVERIFY(outFile.open(QIODevice::WriteOnly | QIODevice::Truncate));
+	outFile.write(result.toUtf8());
+	outFile.close();
+
+	// the reference only applies to the default number of plans
+	QFile reference(SUBSURFACE_TEST_DATA "/dives/" + name);
+	if (nrPlans != 1000 || !reference.open(QIODevice::ReadOnly))
+		QSKIP("no reference for this set of plans - not comparing the stops");
+	QCOMPARE(result, QString::fromUtf8(reference.readAll()));
+}
+
+void TestPerformance::saveXml()
+{
+	loadLog();
+	QString saveFile = benchmarkDir + "/saved.ssrf";
+	QBENCHMARK {
+		QCOMPARE(save_dives(qPrintable(saveFile)), 0);
+	}
+}
+
+void TestPerformance::saveGit()
+{
+	loadLog();
+	QString repo = benchmarkDir + "/git[benchmark]";
+	QCOMPARE(git_create_local_repo(qPrintable(repo)), 0);
+	QBENCHMARK {
+		QCOMPARE(save_dives(qPrintable(repo)), 0);
+	}
+}
+
+QTEST_GUILESS_MAIN(TestPerformance)
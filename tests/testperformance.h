@@ -0,0 +1,26 @@
+// SPDX-License-Identifier: GPL-2.0
+#ifndef TESTPERFORMANCE_H
+#define TESTPERFORMANCE_H
+
+#include <QtTest>
+
+class TestPerformance : public QObject {
+	Q_OBJECT
+private slots:
+	void initTestCase();
+	void cleanupTestCase();
+	void cleanup();
+
+	void loadXml();
+	void processLoadedDives();
+	void fulltextPopulate();
+	void filterUpdateAll();
+	void createPlotInfo();
+	void planTrimix();
+	void planRandomized_data();
+	void planRandomized();
+	void saveXml();
+	void saveGit();
+};
+
+#endif
@@ -7,7 +7,9 @@
 #include "core/picture.h"
 #include "core/trip.h"
 #include "core/file.h"
+#include "core/localfilenamestore.h"
 #include <QString>
+#include <QTemporaryDir>
 #include <core/qthelper.h>
 
 void TestPicture::initTestCase()
@@ -64,4 +66,54 @@ void TestPicture::addPicture()
 	QCOMPARE(localFilePath(pic2->filename), QString(PIC2_NAME));
 }
 
+void TestPicture::localFilenameStore()
+{
+	QTemporaryDir dir;
+	QVERIFY(dir.isValid());
+	QString filename = dir.filePath("localfilenames");
+	{
+		LocalFilenameStore store(filename);
+		QVERIFY(!store.exists());
+		QVERIFY(store.lookup("/a.jpg").isNull());
+		store.learn("/a.jpg", "/local/a.jpg");
+		store.learn("/b.jpg", "/local/b.jpg");
+		store.learn("/c.jpg", "/local/c.jpg");
+		QCOMPARE(store.lookup("/a.jpg"), QString("/local/a.jpg"));
+		store.flush();
+		QVERIFY(store.exists());
+	}
+	{
+		// Overwrite, remove and add entries, which are appended to the file
+		LocalFilenameStore store(filename);
+		QCOMPARE(store.lookup("/b.jpg"), QString("/local/b.jpg"));
+		store.learn("/a.jpg", "/moved/a.jpg");
+		store.learn("/b.jpg", QString());
+		store.learn("/d.jpg", "/local/d.jpg");
+		store.flush();
+		QCOMPARE(store.lookup("/a.jpg"), QString("/moved/a.jpg"));
+		QVERIFY(store.lookup("/b.jpg").isNull());
+	}
+
+	// Simulate a crash while appending: a record that is cut off is ignored
+	QFile file(filename);
+	QVERIFY(file.open(QIODevice::Append));
+	file.write(QByteArray("\x10\0\0\0\x10\0\0\0/e.jpg", 14));
+	file.close();
+	{
+		LocalFilenameStore store(filename);
+		QCOMPARE(store.lookup("/a.jpg"), QString("/moved/a.jpg"));
+		QVERIFY(store.lookup("/b.jpg").isNull());
+		QCOMPARE(store.lookup("/c.jpg"), QString("/local/c.jpg"));
+		QCOMPARE(store.lookup("/d.jpg"), QString("/local/d.jpg"));
+		QVERIFY(store.lookup("/e.jpg").isNull());
+		store.learn("/e.jpg", "/local/e.jpg");
+		store.flush();
+	}
+	{
+		LocalFilenameStore store(filename);
+		QCOMPARE(store.lookup("/e.jpg"), QString("/local/e.jpg"));
+		QCOMPARE(store.lookup("/d.jpg"), QString("/local/d.jpg"));
+	}
+}
+
 QTEST_GUILESS_MAIN(TestPicture)
@@ -9,6 +9,7 @@ class TestPicture : public QObject {
 private slots:
 	void initTestCase();
 	void addPicture();
+	void localFilenameStore();
 };
 
 #endif
@@ -4,6 +4,7 @@
 #include "core/dive.h"
 #include "core/event.h"
 #include "core/planner.h"
+#include "core/planseries.h"
 #include "core/qthelper.h"
 #include "core/subsurfacestartup.h"
 #include "core/units.h"
@@ -896,4 +897,63 @@ void TestPlan::testVpmbMetricRepeat()
 	QCOMPARE(finalDiveRunTimeSeconds, firstDiveRunTimeSeconds);
 }
 
+static void setupSeriesDive(struct SeriesDive *sd, int surfaceInterval)
+{
+	sd->dive = alloc_dive();
+	sd->surfaceInterval = surfaceInterval;
+	sd->plan.salinity = 10300;
+	sd->plan.surface_pressure = 1013;
+	sd->plan.bottomsac = prefs.bottomsac;
+	sd->plan.decosac = prefs.decosac;
+
+	cylinder_t *cyl0 = get_or_create_cylinder(sd->dive, 0);
+	cyl0->gasmix.o2.permille = 320;
+	cyl0->type.size.mliter = 24000;
+	cyl0->type.workingpressure.mbar = 232000;
+	sd->dive->surface_pressure.mbar = 1013;
+	reset_cylinders(sd->dive, true);
+
+	int droptime = M_OR_FT(30, 100) * 60 / M_OR_FT(18, 60);
+	plan_add_segment(&sd->plan, droptime, M_OR_FT(30, 100), 0, 0, 1, OC);
+	plan_add_segment(&sd->plan, 30 * 60 - droptime, M_OR_FT(30, 100), 0, 0, 1, OC);
+}
+
+/* The second of two dives with a short surface interval needs more deco than the same dive alone */
+void TestPlan::testPlanSeries()
+{
+	setupPrefs();
+	prefs.unit_system = METRIC;
+	prefs.units.length = units::METERS;
+	setAppState(ApplicationState::PlanDive);
+
+	std::vector<std::vector<SeriesDive>> series(2);
+	series[0].resize(1);
+	series[1].resize(2);
+	setupSeriesDive(&series[0][0], 0);
+	setupSeriesDive(&series[1][0], 0);
+	setupSeriesDive(&series[1][1], 60 * 60);
+
+	std::vector<SeriesDiveResult> results = plan_series(series);
+	QCOMPARE(results.size(), (size_t)3);
+	QCOMPARE(results[0].series, 0);
+	QCOMPARE(results[2].series, 1);
+	QCOMPARE(results[2].index, 1);
+	QCOMPARE(results[1].runtime, results[0].runtime);
+	QCOMPARE(results[1].otu, results[0].otu);
+	QVERIFY(results[2].runtime > results[1].runtime);
+	QVERIFY(results[2].leadingTissue > results[1].leadingTissue);
+	QVERIFY(results[2].otu > results[1].otu);
+	QVERIFY(results[2].cns > results[1].cns);
+	QCOMPARE(series[1][1].dive->when, dive_endtime(series[1][0].dive) + 60 * 60);
+	QVERIFY(results[2].enoughGas);
+	QVERIFY(results[2].gasUsed[0].mliter > 0);
+
+	for (std::vector<SeriesDive> &dives: series) {
+		for (SeriesDive &sd: dives) {
+			free_dps(&sd.plan);
+			free_dive(sd.dive);
+		}
+	}
+}
+
 QTEST_GUILESS_MAIN(TestPlan)
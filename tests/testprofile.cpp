@@ -1,10 +1,15 @@
 // SPDX-License-Identifier: GPL-2.0
 #include "testprofile.h"
 #include "core/device.h"
+#include "core/divelist.h"
 #include "core/divesite.h"
 #include "core/trip.h"
 #include "core/file.h"
 #include "core/save-profiledata.h"
+#include "core/display.h"
+#include "core/profile.h"
+#include <QtEndian>
+#include <vector>
 
 // This test compares the content of struct profile against a known reference version for a list
 // of dives to prevent accidental regressions. Thus is you change anything in the profile this
@@ -29,4 +34,64 @@ void TestProfile::testProfileExport()
 
 }
 
+static quint32 readLe32(const QByteArray &data, int pos)
+{
+	return qFromLittleEndian<quint32>(reinterpret_cast<const uchar *>(data.constData()) + pos);
+}
+
+void TestProfile::testProfileExportColumns()
+{
+	clear_dive_file_data();
+	parse_file("../dives/abitofeverything.ssrf", &dive_table, &trip_table, &dive_site_table, &device_table, &filter_preset_table);
+	QCOMPARE(save_profiledata_columns("exportprofile.sspd", false), 0);
+	QFile out("exportprofile.sspd");
+	QVERIFY(out.open(QFile::ReadOnly));
+	QByteArray data = out.readAll();
+
+	QCOMPARE(data.left(4), QByteArray("SSPD"));
+	QCOMPARE(readLe32(data, 4), 1u);
+	quint32 nrDives = readLe32(data, 8);
+	quint32 nrRows = readLe32(data, 12);
+	quint32 nrColumns = readLe32(data, 16);
+	QCOMPARE(nrDives, (quint32)dive_table.nr);
+	QVERIFY(nrRows > 0);
+	QCOMPARE(readLe32(data, 20 + 8 * nrDives), nrRows);
+
+	// the first column name follows the dive offsets
+	int pos = 24 + 8 * nrDives;
+	QCOMPARE(readLe32(data, pos), 7u);
+	QCOMPARE(data.mid(pos + 4, 7), QByteArray("in_deco"));
+
+	// skip all column names, the values of all columns remain
+	for (quint32 col = 0; col < nrColumns; col++)
+		pos += 4 + readLe32(data, pos);
+	QCOMPARE((qint64)data.size() - pos, (qint64)nrColumns * nrRows * 8);
+}
+
+// The divecomputers calculated in parallel give the same plot info as one after the other
+void TestProfile::testPlotInfoAllDcs()
+{
+	clear_dive_file_data();
+	parse_file("../dives/abitofeverything.ssrf", &dive_table, &trip_table, &dive_site_table, &device_table, &filter_preset_table);
+	int i;
+	struct dive *d;
+	for_each_dive (i, d) {
+		int nr = (int)number_of_computers(d);
+		std::vector<plot_info> all(nr);
+		for (plot_info &pi: all)
+			init_plot_info(&pi);
+		create_plot_info_all_dcs(d, all.data(), false);
+		for (int dc = 0; dc < nr; dc++) {
+			struct plot_info pi;
+			init_plot_info(&pi);
+			create_plot_info_new(d, get_dive_dc(d, dc), &pi, false, NULL);
+			QCOMPARE(all[dc].nr, pi.nr);
+			QCOMPARE(all[dc].nr_cylinders, pi.nr_cylinders);
+			QVERIFY(memcmp(all[dc].entry, pi.entry, pi.nr * sizeof(*pi.entry)) == 0);
+			free_plot_info_data(&pi);
+			free_plot_info_data(&all[dc]);
+		}
+	}
+}
+
 QTEST_GUILESS_MAIN(TestProfile)
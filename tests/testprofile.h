@@ -9,6 +9,8 @@ class TestProfile : public QObject {
 	Q_OBJECT
 private slots:
 	void testProfileExport();
+	void testProfileExportColumns();
+	void testPlotInfoAllDcs();
 };
 
 #endif
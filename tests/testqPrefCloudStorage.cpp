@@ -24,6 +24,7 @@ void TestQPrefCloudStorage::test_struct_get()
 	prefs.cloud_auto_sync = true;
 	prefs.cloud_base_url = copy_qstring("new url");
 	prefs.cloud_git_url = copy_qstring("new again url");
+	prefs.cloud_metered_connection = true;
 	prefs.cloud_storage_email = copy_qstring("myEmail");
 	prefs.cloud_storage_email_encoded = copy_qstring("encodedMyEMail");
 	prefs.cloud_storage_password = copy_qstring("more secret");
@@ -35,6 +36,7 @@ void TestQPrefCloudStorage::test_struct_get()
 	QCOMPARE(tst->cloud_auto_sync(), prefs.cloud_auto_sync);
 	QCOMPARE(tst->cloud_base_url(), QString(prefs.cloud_base_url));
 	QCOMPARE(tst->cloud_git_url(), QString(prefs.cloud_git_url));
+	QCOMPARE(tst->cloud_metered_connection(), prefs.cloud_metered_connection);
 	QCOMPARE(tst->cloud_storage_email(), QString(prefs.cloud_storage_email));
 	QCOMPARE(tst->cloud_storage_email_encoded(), QString(prefs.cloud_storage_email_encoded));
 	QCOMPARE(tst->cloud_storage_password(), QString(prefs.cloud_storage_password));
@@ -52,6 +54,7 @@ void TestQPrefCloudStorage::test_set_struct()
 
 	tst->set_cloud_auto_sync(false);
 	tst->set_cloud_base_url("t2 base");
+	tst->set_cloud_metered_connection(false);
 	tst->set_cloud_storage_email("t2 email");
 	tst->set_cloud_storage_email_encoded("t2 email2");
 	tst->set_cloud_storage_password("t2 pass2");
@@ -62,6 +65,7 @@ void TestQPrefCloudStorage::test_set_struct()
 
 	QCOMPARE(prefs.cloud_auto_sync, false);
 	QCOMPARE(QString(prefs.cloud_base_url), QString("t2 base"));
+	QCOMPARE(prefs.cloud_metered_connection, false);
 	QCOMPARE(QString(prefs.cloud_storage_email), QString("t2 email"));
 	QCOMPARE(QString(prefs.cloud_storage_email_encoded), QString("t2 email2"));
 	QCOMPARE(QString(prefs.cloud_storage_password), QString("t2 pass2"));
@@ -85,6 +89,7 @@ void TestQPrefCloudStorage::test_set_load_struct()
 	tst->set_cloud_storage_email_encoded("t3 email2");
 	tst->set_save_password_local(true);
 	tst->set_cloud_auto_sync(true);
+	tst->set_cloud_metered_connection(true);
 	tst->set_cloud_storage_password("t3 pass2");
 	tst->set_cloud_storage_pin("t3 pin");
 	tst->set_cloud_timeout(321);
@@ -93,6 +98,7 @@ void TestQPrefCloudStorage::test_set_load_struct()
 	prefs.cloud_auto_sync = false;
 	prefs.cloud_base_url = copy_qstring("error1");
 	prefs.cloud_git_url = copy_qstring("error1");
+	prefs.cloud_metered_connection = false;
 	prefs.cloud_storage_email = copy_qstring("error1");
 	prefs.cloud_storage_email_encoded = copy_qstring("error1");
 	prefs.cloud_storage_password = copy_qstring("error1");
@@ -104,6 +110,7 @@ void TestQPrefCloudStorage::test_set_load_struct()
 	tst->load();
 	QCOMPARE(prefs.cloud_auto_sync, true);
 	QCOMPARE(QString(prefs.cloud_base_url), QString("t3 base"));
+	QCOMPARE(prefs.cloud_metered_connection, true);
 	QCOMPARE(QString(prefs.cloud_storage_email), QString("t3 email"));
 	QCOMPARE(QString(prefs.cloud_storage_email_encoded), QString("t3 email2"));
 	QCOMPARE(QString(prefs.cloud_storage_password), QString("t3 pass2"));